@@ -32,6 +32,7 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "config.h"
 #include "avs_blend.h"
+#include "avs_simd.h"
 
 static int max(int x, int y)
 {
@@ -52,8 +53,8 @@ __inline int  BLEND(int a, int b)
 	t|=min(r,0xff00);
 	r=(a&0xff0000)+(b&0xff0000);
 	t|=min(r,0xff0000);
-	r=(a&0xff000000)+(b&0xff000000);
-	return t|min(r,0xff000000);
+	r=((a>>24)&0xff)+((b>>24)&0xff);
+	return t|(min(r,0xff)<<24);
 }
 
 #if 1
@@ -186,8 +187,8 @@ __inline int  BLEND_SUB(int a, int b)
 	t|=max(r,0);
 	r=(a&0xff0000)-(b&0xff0000);
 	t|=max(r,0);
-	r=(a&0xff000000)-(b&0xff000000);
-	return t|max(r,0);
+	r=((a>>24)&0xff)-((b>>24)&0xff);
+	return t|(max(r,0)<<24);
 }
 
 #ifdef NO_MMX
@@ -229,381 +230,479 @@ __inline void BLEND_LINE(int *fb, int color, unsigned char blendtable[256][256],
   }
 }
 
-__inline int BLEND4(unsigned char blendtable[256][256], int *p1, int w, int xp, int yp)
+/* The table based blends are done with arithmetic in the SIMD versions, they
+ * give the same results as long as blendtable holds i*j/255 like the one
+ * the pipeline sets up.  x/255 is (x+1+(x>>8))>>8 for every product of two
+ * bytes. */
+
+static __inline int blend4_c(unsigned char blendtable[256][256], int *p1, int w, int a1, int a2, int a3, int a4)
 {
-#ifdef NO_MMX
   register int t;
-  unsigned char a1,a2,a3,a4;
-  a1=blendtable[255-xp][255-yp];
-  a2=blendtable[xp][255-yp];
-  a3=blendtable[255-xp][yp];
-  a4=blendtable[xp][yp];
   t=blendtable[p1[0]&0xff][a1]+blendtable[p1[1]&0xff][a2]+blendtable[p1[w]&0xff][a3]+blendtable[p1[w+1]&0xff][a4];
   t|=(blendtable[(p1[0]>>8)&0xff][a1]+blendtable[(p1[1]>>8)&0xff][a2]+blendtable[(p1[w]>>8)&0xff][a3]+blendtable[(p1[w+1]>>8)&0xff][a4])<<8;
   t|=(blendtable[(p1[0]>>16)&0xff][a1]+blendtable[(p1[1]>>16)&0xff][a2]+blendtable[(p1[w]>>16)&0xff][a3]+blendtable[(p1[w+1]>>16)&0xff][a4])<<16;
-  return t;      
-#else
-  __asm
-  {
-    movd mm6, xp
-    mov eax, p1
-
-    movd mm7, yp
-    mov esi, w
-
-    movq mm4, mmx_blend4_revn
-    punpcklwd mm6,mm6
-
-    movq mm5, mmx_blend4_revn
-    punpcklwd mm7,mm7
-
-    movd mm0, [eax]
-    punpckldq mm6,mm6
-
-    movd mm1, [eax+4]
-    punpckldq mm7,mm7
-
-    movd mm2, [eax+esi*4]
-    punpcklbw mm0, [mmx_blend4_zero]
-
-    movd mm3, [eax+esi*4+4]
-    psubw mm4, mm6
-
-    punpcklbw mm1, [mmx_blend4_zero]
-    pmullw mm0, mm4
-
-    punpcklbw mm2, [mmx_blend4_zero]
-    pmullw mm1, mm6
-
-    punpcklbw mm3, [mmx_blend4_zero]
-    psubw mm5, mm7
-
-    pmullw mm2, mm4
-    pmullw mm3, mm6
-
-    paddw mm0, mm1
-    // stall (mm0)
-
-    psrlw mm0, 8
-    // stall (waiting for mm3/mm2)
+  return t;
+}
 
-    paddw mm2, mm3
-    pmullw mm0, mm5
+#if defined(AVS_HAVE_SSE2)
+static __inline __m128i div255_sse2(__m128i x)
+{
+  return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+}
 
-    psrlw mm2, 8
-    // stall (mm2)
+static __inline int blend4_sse2(int *p1, int w, int a1, int a2, int a3, int a4)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i top = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) p1), zero);
+  __m128i bottom = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (p1 + w)), zero);
+  __m128i t;
 
-    pmullw mm2, mm7
-    // stall
+  t = _mm_add_epi16(div255_sse2(_mm_mullo_epi16(top, _mm_set_epi16(a2, a2, a2, a2, a1, a1, a1, a1))),
+                    div255_sse2(_mm_mullo_epi16(bottom, _mm_set_epi16(a4, a4, a4, a4, a3, a3, a3, a3))));
+  t = _mm_add_epi16(t, _mm_srli_si128(t, 8));
 
-    // stall (mm2)
+  return _mm_cvtsi128_si32(_mm_packus_epi16(t, t)) & 0xffffff;
+}
+#endif
 
-    paddw mm0, mm2
-    // stall
+#if defined(AVS_HAVE_NEON)
+static __inline uint16x8_t div255_neon(uint16x8_t x)
+{
+  return vshrq_n_u16(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16(x, 8)), 8);
+}
 
-    psrlw mm0, 8
-    // stall
+static __inline int blend4_neon(int *p1, int w, int a1, int a2, int a3, int a4)
+{
+  uint8x8_t top = vreinterpret_u8_u32(vld1_u32((const uint32_t *) p1));
+  uint8x8_t bottom = vreinterpret_u8_u32(vld1_u32((const uint32_t *) (p1 + w)));
+  uint8x8_t wtop = vext_u8(vdup_n_u8(a1), vdup_n_u8(a2), 4);
+  uint8x8_t wbottom = vext_u8(vdup_n_u8(a3), vdup_n_u8(a4), 4);
+  uint16x8_t t;
+  uint16x4_t sum;
 
-    packuswb mm0, mm0
-    // stall
+  t = vaddq_u16(div255_neon(vmull_u8(top, wtop)), div255_neon(vmull_u8(bottom, wbottom)));
+  sum = vadd_u16(vget_low_u16(t), vget_high_u16(t));
 
-    movd eax, mm0
-  }
-#endif
+  return vget_lane_u32(vreinterpret_u32_u8(vmovn_u16(vcombine_u16(sum, sum))), 0) & 0xffffff;
 }
+#endif
 
-
-__inline int BLEND4_16(unsigned char blendtable[256][256], int *p1, int w, int xp, int yp)
+__inline int BLEND4(unsigned char blendtable[256][256], int *p1, int w, int xp, int yp)
 {
-#ifdef NO_MMX
-  register int t;
-  unsigned char a1,a2,a3,a4;
-  xp=(xp>>8)&0xff;
-  yp=(yp>>8)&0xff;
+  int a1,a2,a3,a4;
   a1=blendtable[255-xp][255-yp];
   a2=blendtable[xp][255-yp];
   a3=blendtable[255-xp][yp];
   a4=blendtable[xp][yp];
-  t=blendtable[p1[0]&0xff][a1]+blendtable[p1[1]&0xff][a2]+blendtable[p1[w]&0xff][a3]+blendtable[p1[w+1]&0xff][a4];
-  t|=(blendtable[(p1[0]>>8)&0xff][a1]+blendtable[(p1[1]>>8)&0xff][a2]+blendtable[(p1[w]>>8)&0xff][a3]+blendtable[(p1[w+1]>>8)&0xff][a4])<<8;
-  t|=(blendtable[(p1[0]>>16)&0xff][a1]+blendtable[(p1[1]>>16)&0xff][a2]+blendtable[(p1[w]>>16)&0xff][a3]+blendtable[(p1[w+1]>>16)&0xff][a4])<<16;
-  return t;      
+#if defined(AVS_HAVE_SSE2)
+  return blend4_sse2(p1,w,a1,a2,a3,a4);
+#elif defined(AVS_HAVE_NEON)
+  return blend4_neon(p1,w,a1,a2,a3,a4);
 #else
-  __asm
-  {
-    movd mm6, xp
-    mov eax, p1
+  return blend4_c(blendtable,p1,w,a1,a2,a3,a4);
+#endif
+}
+
+__inline int BLEND4_16(unsigned char blendtable[256][256], int *p1, int w, int xp, int yp)
+{
+  return BLEND4(blendtable,p1,w,(xp>>8)&0xff,(yp>>8)&0xff);
+}
 
-    movd mm7, yp
-    mov esi, w
+/* Block blends, output is blended with input in place.  Every version
+ * matches the per pixel functions above to the bit, the alpha byte included */
 
-    movq mm4, mmx_blend4_revn
-    psrlw mm6, 8
+static void avgblend_c(int *output, int *input, int l)
+{
+  while (l--)
+  {
+    *output=BLEND_AVG(*input++,*output);
+    output++;
+  }
+}
 
-    movq mm5, mmx_blend4_revn
-    psrlw mm7, 8
+static void addblend_c(int *output, int *input, int l)
+{
+  while (l--)
+  {
+    *output=BLEND(*input++,*output);
+    output++;
+  }
+}
 
-    movd mm0, [eax]
-    punpcklwd mm6,mm6
+static void maxblend_c(int *output, int *input, int l)
+{
+  while (l--)
+  {
+    *output=BLEND_MAX(*output,*input++);
+    output++;
+  }
+}
 
-    movd mm1, [eax+4]
-    punpcklwd mm7,mm7
+static void minblend_c(int *output, int *input, int l)
+{
+  while (l--)
+  {
+    *output=BLEND_MIN(*output,*input++);
+    output++;
+  }
+}
 
-    movd mm2, [eax+esi*4]
-    punpckldq mm6,mm6
+static void subblend_c(int *output, int *input, int l)
+{
+  while (l--)
+  {
+    *output=BLEND_SUB(*output,*input++);
+    output++;
+  }
+}
 
-    movd mm3, [eax+esi*4+4]
-    punpckldq mm7,mm7
+static void revsubblend_c(int *output, int *input, int l)
+{
+  while (l--)
+  {
+    *output=BLEND_SUB(*input++,*output);
+    output++;
+  }
+}
 
-    punpcklbw mm0, [mmx_blend4_zero]
-    psubw mm4, mm6
+static void xorblend_c(int *output, int *input, int l)
+{
+  while (l--)
+    *output++^=*input++;
+}
 
-    punpcklbw mm1, [mmx_blend4_zero]
-    pmullw mm0, mm4
+static void mulblend_c(unsigned char blendtable[256][256], int *output, int *input, int l)
+{
+  while (l--)
+  {
+    *output=BLEND_MUL(blendtable, *input++,*output);
+    output++;
+  }
+}
 
-    punpcklbw mm2, [mmx_blend4_zero]
-    pmullw mm1, mm6
+static void adjblend_c(unsigned char blendtable[256][256], int *o, int *in1, int *in2, int len, int v)
+{
+  while (len--)
+  {
+    *o++=BLEND_ADJ(blendtable, *in1++,*in2++,v);
+  }
+}
 
-    punpcklbw mm3, [mmx_blend4_zero]
-    psubw mm5, mm7
+typedef struct {
+  void (*avg)(int *output, int *input, int l);
+  void (*add)(int *output, int *input, int l);
+  void (*max)(int *output, int *input, int l);
+  void (*min)(int *output, int *input, int l);
+  void (*sub)(int *output, int *input, int l);
+  void (*revsub)(int *output, int *input, int l);
+  void (*xor)(int *output, int *input, int l);
+  void (*mul)(unsigned char blendtable[256][256], int *output, int *input, int l);
+  void (*adj)(unsigned char blendtable[256][256], int *o, int *in1, int *in2, int len, int v);
+} BlendBlockOps;
+
+static const BlendBlockOps blend_ops_c = {
+  avgblend_c, addblend_c, maxblend_c, minblend_c, subblend_c, revsubblend_c, xorblend_c,
+  mulblend_c, adjblend_c
+};
+
+/* Kernels that only combine the two pixels, o and s, into the expression e */
+#define BLEND_BLOCK_SSE2(name, e) \
+static void name##_sse2(int *output, int *input, int l) \
+{ \
+  int i; \
+  for (i = 0; i + 4 <= l; i += 4) \
+  { \
+    __m128i o = _mm_loadu_si128((const __m128i *) (output + i)); \
+    __m128i s = _mm_loadu_si128((const __m128i *) (input + i)); \
+    _mm_storeu_si128((__m128i *) (output + i), (e)); \
+  } \
+  name##_c(output + i, input + i, l - i); \
+}
 
-    pmullw mm2, mm4
-    pmullw mm3, mm6
+#define BLEND_BLOCK_AVX2(name, e) \
+AVS_TARGET_AVX2 \
+static void name##_avx2(int *output, int *input, int l) \
+{ \
+  int i; \
+  for (i = 0; i + 8 <= l; i += 8) \
+  { \
+    __m256i o = _mm256_loadu_si256((const __m256i *) (output + i)); \
+    __m256i s = _mm256_loadu_si256((const __m256i *) (input + i)); \
+    _mm256_storeu_si256((__m256i *) (output + i), (e)); \
+  } \
+  name##_c(output + i, input + i, l - i); \
+}
 
-    paddw mm0, mm1
-    // stall (mm0)
+#define BLEND_BLOCK_NEON(name, e) \
+static void name##_neon(int *output, int *input, int l) \
+{ \
+  int i; \
+  for (i = 0; i + 4 <= l; i += 4) \
+  { \
+    uint8x16_t o = vreinterpretq_u8_s32(vld1q_s32(output + i)); \
+    uint8x16_t s = vreinterpretq_u8_s32(vld1q_s32(input + i)); \
+    vst1q_s32(output + i, vreinterpretq_s32_u8(e)); \
+  } \
+  name##_c(output + i, input + i, l - i); \
+}
 
-    psrlw mm0, 8
-    // stall (waiting for mm3/mm2)
+/* BLEND_AVG shifts the sign into the alpha byte, so does psrad */
+#define AVG_MASK (~((1<<7)|(1<<15)|(1<<23)))
+#define RGB_MASK 0x00ffffff
+
+#if defined(AVS_HAVE_SSE2)
+BLEND_BLOCK_SSE2(avgblend, _mm_add_epi32(_mm_and_si128(_mm_srai_epi32(o, 1), _mm_set1_epi32(AVG_MASK)),
+                                         _mm_and_si128(_mm_srai_epi32(s, 1), _mm_set1_epi32(AVG_MASK))))
+BLEND_BLOCK_SSE2(addblend, _mm_adds_epu8(o, s))
+BLEND_BLOCK_SSE2(maxblend, _mm_and_si128(_mm_max_epu8(o, s), _mm_set1_epi32(RGB_MASK)))
+BLEND_BLOCK_SSE2(minblend, _mm_and_si128(_mm_min_epu8(o, s), _mm_set1_epi32(RGB_MASK)))
+BLEND_BLOCK_SSE2(subblend, _mm_subs_epu8(o, s))
+BLEND_BLOCK_SSE2(revsubblend, _mm_subs_epu8(s, o))
+BLEND_BLOCK_SSE2(xorblend, _mm_xor_si128(o, s))
+
+static __inline __m128i mul_sse2(__m128i a, __m128i b)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = div255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero)));
+  __m128i hi = div255_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero)));
 
-    paddw mm2, mm3
-    pmullw mm0, mm5
+  return _mm_and_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32(RGB_MASK));
+}
 
-    psrlw mm2, 8
-    // stall (mm2)
+static void mulblend_sse2(unsigned char blendtable[256][256], int *output, int *input, int l)
+{
+  int i;
+  for (i = 0; i + 4 <= l; i += 4)
+  {
+    __m128i o = _mm_loadu_si128((const __m128i *) (output + i));
+    __m128i s = _mm_loadu_si128((const __m128i *) (input + i));
+    _mm_storeu_si128((__m128i *) (output + i), mul_sse2(s, o));
+  }
+  mulblend_c(blendtable, output + i, input + i, l - i);
+}
 
-    pmullw mm2, mm7
-    // stall
+static void adjblend_sse2(unsigned char blendtable[256][256], int *o, int *in1, int *in2, int len, int v)
+{
+  __m128i zero = _mm_setzero_si128();
+  __m128i va = _mm_set1_epi16(v);
+  __m128i vb = _mm_set1_epi16(0xff-v);
+  int i;
+  for (i = 0; i + 4 <= len; i += 4)
+  {
+    __m128i a = _mm_loadu_si128((const __m128i *) (in1 + i));
+    __m128i b = _mm_loadu_si128((const __m128i *) (in2 + i));
+    __m128i lo = _mm_add_epi16(div255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), va)),
+                               div255_sse2(_mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), vb)));
+    __m128i hi = _mm_add_epi16(div255_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), va)),
+                               div255_sse2(_mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), vb)));
+    _mm_storeu_si128((__m128i *) (o + i), _mm_and_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32(RGB_MASK)));
+  }
+  adjblend_c(blendtable, o + i, in1 + i, in2 + i, len - i, v);
+}
 
-    // stall (mm2)
+static const BlendBlockOps blend_ops_sse2 = {
+  avgblend_sse2, addblend_sse2, maxblend_sse2, minblend_sse2, subblend_sse2, revsubblend_sse2, xorblend_sse2,
+  mulblend_sse2, adjblend_sse2
+};
+#endif /* AVS_HAVE_SSE2 */
 
-    paddw mm0, mm2
-    // stall
+#if defined(AVS_HAVE_AVX2)
+AVS_TARGET_AVX2
+static __inline __m256i div255_avx2(__m256i x)
+{
+  return _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(x, _mm256_set1_epi16(1)), _mm256_srli_epi16(x, 8)), 8);
+}
 
-    psrlw mm0, 8
-    // stall
+/* Unpacking and packing both work within 128 bit lanes, so pixels stay in place */
+AVS_TARGET_AVX2
+static __inline __m256i mul_avx2(__m256i a, __m256i b)
+{
+  __m256i zero = _mm256_setzero_si256();
+  __m256i lo = div255_avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpacklo_epi8(b, zero)));
+  __m256i hi = div255_avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), _mm256_unpackhi_epi8(b, zero)));
 
-    packuswb mm0, mm0
-    // stall
+  return _mm256_and_si256(_mm256_packus_epi16(lo, hi), _mm256_set1_epi32(RGB_MASK));
+}
 
-    movd eax, mm0
+BLEND_BLOCK_AVX2(avgblend, _mm256_add_epi32(_mm256_and_si256(_mm256_srai_epi32(o, 1), _mm256_set1_epi32(AVG_MASK)),
+                                            _mm256_and_si256(_mm256_srai_epi32(s, 1), _mm256_set1_epi32(AVG_MASK))))
+BLEND_BLOCK_AVX2(addblend, _mm256_adds_epu8(o, s))
+BLEND_BLOCK_AVX2(maxblend, _mm256_and_si256(_mm256_max_epu8(o, s), _mm256_set1_epi32(RGB_MASK)))
+BLEND_BLOCK_AVX2(minblend, _mm256_and_si256(_mm256_min_epu8(o, s), _mm256_set1_epi32(RGB_MASK)))
+BLEND_BLOCK_AVX2(subblend, _mm256_subs_epu8(o, s))
+BLEND_BLOCK_AVX2(revsubblend, _mm256_subs_epu8(s, o))
+BLEND_BLOCK_AVX2(xorblend, _mm256_xor_si256(o, s))
+
+AVS_TARGET_AVX2
+static void mulblend_avx2(unsigned char blendtable[256][256], int *output, int *input, int l)
+{
+  int i;
+  for (i = 0; i + 8 <= l; i += 8)
+  {
+    __m256i o = _mm256_loadu_si256((const __m256i *) (output + i));
+    __m256i s = _mm256_loadu_si256((const __m256i *) (input + i));
+    _mm256_storeu_si256((__m256i *) (output + i), mul_avx2(s, o));
   }
-#endif
+  mulblend_c(blendtable, output + i, input + i, l - i);
 }
 
-__inline void mmx_avgblend_block(int *output, int *input, int l)
+AVS_TARGET_AVX2
+static void adjblend_avx2(unsigned char blendtable[256][256], int *o, int *in1, int *in2, int len, int v)
 {
-#ifdef NO_MMX
-  while (l--)
+  __m256i zero = _mm256_setzero_si256();
+  __m256i va = _mm256_set1_epi16(v);
+  __m256i vb = _mm256_set1_epi16(0xff-v);
+  int i;
+  for (i = 0; i + 8 <= len; i += 8)
   {
-    *output=BLEND_AVG(*input++,*output);
-    output++;
+    __m256i a = _mm256_loadu_si256((const __m256i *) (in1 + i));
+    __m256i b = _mm256_loadu_si256((const __m256i *) (in2 + i));
+    __m256i lo = _mm256_add_epi16(div255_avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), va)),
+                                  div255_avx2(_mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), vb)));
+    __m256i hi = _mm256_add_epi16(div255_avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), va)),
+                                  div255_avx2(_mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), vb)));
+    _mm256_storeu_si256((__m256i *) (o + i), _mm256_and_si256(_mm256_packus_epi16(lo, hi), _mm256_set1_epi32(RGB_MASK)));
   }
-#else
-  static int mask[2]=
-  {
-    ~((1<<7)|(1<<15)|(1<<23)),
-      ~((1<<7)|(1<<15)|(1<<23))
-  };
-  __asm 
-  {
-    mov eax, input
-    mov edi, output
-    mov ecx, l
-    shr ecx, 2
-    align 16
-mmx_avgblend_loop:
-    movq mm0, [eax]
-    movq mm1, [edi]
-    psrlq mm0, 1
-    movq mm2, [eax+8]
-    psrlq mm1, 1
-    movq mm3, [edi+8]
-    psrlq mm2, 1
-    pand mm0, [mask]
-    psrlq mm3, 1
-    pand mm1, [mask]
-    pand mm2, [mask]
-    paddusb mm0, mm1
-    pand mm3, [mask]
-    add eax, 16
-    paddusb mm2, mm3
-
-    movq [edi], mm0
-    movq [edi+8], mm2
-
-    add edi, 16
-
-    dec ecx
-    jnz mmx_avgblend_loop
-    emms
-  };
-#endif
+  adjblend_c(blendtable, o + i, in1 + i, in2 + i, len - i, v);
 }
 
+static const BlendBlockOps blend_ops_avx2 = {
+  avgblend_avx2, addblend_avx2, maxblend_avx2, minblend_avx2, subblend_avx2, revsubblend_avx2, xorblend_avx2,
+  mulblend_avx2, adjblend_avx2
+};
+#endif /* AVS_HAVE_AVX2 */
 
-__inline void mmx_addblend_block(int *output, int *input, int l)
+#if defined(AVS_HAVE_NEON)
+static __inline uint8x8_t mul8_neon(uint8x8_t a, uint8x8_t b)
 {
-#ifdef NO_MMX
-  while (l--)
-  {
-    *output=BLEND(*input++,*output);
-    output++;
-  }
-#else
-  __asm 
-  {
-    mov eax, input
-    mov edi, output
-    mov ecx, l
-    shr ecx, 2
-    align 16
-mmx_addblend_loop:
-    movq mm0, [eax]
-    movq mm1, [edi]
-    movq mm2, [eax+8]
-    movq mm3, [edi+8]
-    paddusb mm0, mm1
-    paddusb mm2, mm3
-    add eax, 16
-
-    movq [edi], mm0
-    movq [edi+8], mm2
-
-    add edi, 16
-
-    dec ecx
-    jnz mmx_addblend_loop
-    emms
-  };
-#endif
+  uint16x8_t x = vmull_u8(a, b);
+  return vshrn_n_u16(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16(x, 8)), 8);
 }
 
-__inline void mmx_mulblend_block(unsigned char blendtable[256][256], int *output, int *input, int l)
+static __inline uint8x16_t mul_neon(uint8x16_t a, uint8x16_t b)
 {
-#ifdef NO_MMX
-  while (l--)
+  uint8x16_t t = vcombine_u8(mul8_neon(vget_low_u8(a), vget_low_u8(b)), mul8_neon(vget_high_u8(a), vget_high_u8(b)));
+  return vandq_u8(t, vreinterpretq_u8_u32(vdupq_n_u32(RGB_MASK)));
+}
+
+static __inline uint8x16_t avg_neon(uint8x16_t a, uint8x16_t b)
+{
+  int32x4_t mask = vdupq_n_s32(AVG_MASK);
+  return vreinterpretq_u8_s32(vaddq_s32(vandq_s32(vshrq_n_s32(vreinterpretq_s32_u8(a), 1), mask),
+                                        vandq_s32(vshrq_n_s32(vreinterpretq_s32_u8(b), 1), mask)));
+}
+
+BLEND_BLOCK_NEON(avgblend, avg_neon(o, s))
+BLEND_BLOCK_NEON(addblend, vqaddq_u8(o, s))
+BLEND_BLOCK_NEON(maxblend, vandq_u8(vmaxq_u8(o, s), vreinterpretq_u8_u32(vdupq_n_u32(RGB_MASK))))
+BLEND_BLOCK_NEON(minblend, vandq_u8(vminq_u8(o, s), vreinterpretq_u8_u32(vdupq_n_u32(RGB_MASK))))
+BLEND_BLOCK_NEON(subblend, vqsubq_u8(o, s))
+BLEND_BLOCK_NEON(revsubblend, vqsubq_u8(s, o))
+BLEND_BLOCK_NEON(xorblend, veorq_u8(o, s))
+
+static void mulblend_neon(unsigned char blendtable[256][256], int *output, int *input, int l)
+{
+  int i;
+  for (i = 0; i + 4 <= l; i += 4)
   {
-    *output=BLEND_MUL(blendtable, *input++,*output);
-    output++;
+    uint8x16_t o = vreinterpretq_u8_s32(vld1q_s32(output + i));
+    uint8x16_t s = vreinterpretq_u8_s32(vld1q_s32(input + i));
+    vst1q_s32(output + i, vreinterpretq_s32_u8(mul_neon(s, o)));
   }
-#else
-  __asm 
-  {
-    mov eax, input
-    mov edi, output
-    mov ecx, l
-    shr ecx, 1
-    align 16
-mmx_mulblend_loop:
-    movd mm0, [eax]
-    movd mm1, [edi]
-    movd mm2, [eax+4]
-    punpcklbw mm0, [mmx_blend4_zero]
-    movd mm3, [edi+4]
-    punpcklbw mm1, [mmx_blend4_zero]
-    punpcklbw mm2, [mmx_blend4_zero]
-    pmullw mm0, mm1
-    punpcklbw mm3, [mmx_blend4_zero]
-    psrlw mm0, 8
-    pmullw mm2, mm3
-    packuswb mm0, mm0
-    psrlw mm2, 8
-    packuswb mm2, mm2
-    add eax, 8
-
-    movd [edi], mm0
-    movd [edi+4], mm2
-
-    add edi, 8
-
-    dec ecx
-    jnz mmx_mulblend_loop
-    emms
-  };
-#endif
+  mulblend_c(blendtable, output + i, input + i, l - i);
 }
 
-void __inline mmx_adjblend_block(unsigned char blendtable[256][256], int *o, int *in1, int *in2, int len, int v)
+/* Each product is rounded down on its own, the sum never exceeds 255 */
+static void adjblend_neon(unsigned char blendtable[256][256], int *o, int *in1, int *in2, int len, int v)
 {
-#ifdef NO_MMX
-  while (len--)
+  uint8x8_t va = vdup_n_u8(v);
+  uint8x8_t vb = vdup_n_u8(0xff-v);
+  uint8x16_t mask = vreinterpretq_u8_u32(vdupq_n_u32(RGB_MASK));
+  int i;
+  for (i = 0; i + 4 <= len; i += 4)
   {
-    *o++=BLEND_ADJ(blendtable, *in1++,*in2++,v);
+    uint8x16_t a = vreinterpretq_u8_s32(vld1q_s32(in1 + i));
+    uint8x16_t b = vreinterpretq_u8_s32(vld1q_s32(in2 + i));
+    uint8x8_t lo = vadd_u8(mul8_neon(vget_low_u8(a), va), mul8_neon(vget_low_u8(b), vb));
+    uint8x8_t hi = vadd_u8(mul8_neon(vget_high_u8(a), va), mul8_neon(vget_high_u8(b), vb));
+    vst1q_s32(o + i, vreinterpretq_s32_u8(vandq_u8(vcombine_u8(lo, hi), mask)));
   }
-#else
-  __asm
-  {
-    movd mm3, [v] // VVVVVVVV
-    mov ecx, len
+  adjblend_c(blendtable, o + i, in1 + i, in2 + i, len - i, v);
+}
 
-    packuswb mm3, mm3 // 0000HHVV
-    mov edx, o
+static const BlendBlockOps blend_ops_neon = {
+  avgblend_neon, addblend_neon, maxblend_neon, minblend_neon, subblend_neon, revsubblend_neon, xorblend_neon,
+  mulblend_neon, adjblend_neon
+};
+#endif /* AVS_HAVE_NEON */
 
-    punpcklwd mm3, mm3 // HHVVHHVV
-    mov esi, in1
+/* Every plugin links its own copy of this file, so each picks on first use.
+ * Racing threads all store the same pointer. */
+static const BlendBlockOps *blend_ops(void)
+{
+  static const BlendBlockOps *ops = NULL;
 
-    movq mm4, [mmx_blend4_revn]
-    punpckldq mm3, mm3 // HHVVHHVV HHVVHHVV
-    
-    pand mm3, [mmx_blendadj_mask]
-    mov edi, in2
+  if (ops == NULL)
+  {
+    const BlendBlockOps *best = &blend_ops_c;
+#if defined(AVS_HAVE_SSE2)
+    best = &blend_ops_sse2;
+#endif
+#if defined(AVS_HAVE_AVX2)
+    if (visual_cpu_has_avx2())
+      best = &blend_ops_avx2;
+#endif
+#if defined(AVS_HAVE_NEON)
+    best = &blend_ops_neon;
+#endif
+    ops = best;
+  }
 
-    shr ecx, 1
-    psubw mm4, mm3
-    
-    align 16
-_mmx_adjblend_loop:
-    
-    movd mm0, [esi]
-    
-    movd mm1, [edi]
-    punpcklbw mm0, [mmx_blend4_zero]
-    
-    movd mm6, [esi+4]
-    punpcklbw mm1, [mmx_blend4_zero]
-    
-    movd mm7, [edi+4]        
-    punpcklbw mm6, [mmx_blend4_zero]
+  return ops;
+}
+
+void mmx_avgblend_block(int *output, int *input, int l)
+{
+  blend_ops()->avg(output, input, l);
+}
 
-    pmullw mm0, mm3
-    punpcklbw mm7, [mmx_blend4_zero]
+void mmx_addblend_block(int *output, int *input, int l)
+{
+  blend_ops()->add(output, input, l);
+}
 
-    pmullw mm1, mm4
-    pmullw mm6, mm3
+void mmx_maxblend_block(int *output, int *input, int l)
+{
+  blend_ops()->max(output, input, l);
+}
 
-    pmullw mm7, mm4
-    paddw mm0, mm1
+void mmx_minblend_block(int *output, int *input, int l)
+{
+  blend_ops()->min(output, input, l);
+}
 
-    paddw mm6, mm7
-    add edi, 8
+void mmx_subblend_block(int *output, int *input, int l)
+{
+  blend_ops()->sub(output, input, l);
+}
 
-    psrlw mm0, 8
-    add esi, 8
+void mmx_revsubblend_block(int *output, int *input, int l)
+{
+  blend_ops()->revsub(output, input, l);
+}
 
-    psrlw mm6, 8
-    packuswb mm0, mm0
-    
-    packuswb mm6, mm6
-    movd [edx], mm0
+void mmx_xorblend_block(int *output, int *input, int l)
+{
+  blend_ops()->xor(output, input, l);
+}
 
-    movd [edx+4], mm6
-    add edx, 8
-    dec ecx
-    jnz _mmx_adjblend_loop
+void mmx_mulblend_block(unsigned char blendtable[256][256], int *output, int *input, int l)
+{
+  blend_ops()->mul(blendtable, output, input, l);
+}
 
-    emms
-  };
-#endif
+void mmx_adjblend_block(unsigned char blendtable[256][256], int *o, int *in1, int *in2, int len, int v)
+{
+  blend_ops()->adj(blendtable, o, in1, in2, len, v);
 }
 #endif
@@ -48,5 +48,10 @@ void mmx_mulblend_block(unsigned char blendtable[256][256], int *output, int *in
 void mmx_adjblend_block(unsigned char blendtable[256][256], int *o, int *in1, int *in2, int len, int v);
 void mmx_addblend_block(int *output, int *input, int l);
 void mmx_avgblend_block(int *output, int *input, int l);
+void mmx_maxblend_block(int *output, int *input, int l);
+void mmx_minblend_block(int *output, int *input, int l);
+void mmx_subblend_block(int *output, int *input, int l);
+void mmx_revsubblend_block(int *output, int *input, int l);
+void mmx_xorblend_block(int *output, int *input, int l);
 
 #endif
@@ -0,0 +1,33 @@
+#ifndef _AVS_SIMD_H
+#define _AVS_SIMD_H
+
+/* Compile time availability of SIMD intrinsics, like libvisual's private
+ * lv_simd.h. SSE2 and NEON are only defined when the compiler already
+ * targets them, AVX2 code must check visual_cpu_has_avx2() before running. */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define AVS_HAVE_SSE2 1
+# include <emmintrin.h>
+#endif
+
+/* AVX2 code is built into every SSE2 capable binary where the compiler allows
+ * enabling it per function, and must be marked AVS_TARGET_AVX2 */
+#if defined(AVS_HAVE_SSE2)
+# if defined(__AVX2__) || defined(_MSC_VER)
+#  define AVS_HAVE_AVX2 1
+#  define AVS_TARGET_AVX2
+# elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#  define AVS_HAVE_AVX2 1
+#  define AVS_TARGET_AVX2 __attribute__ ((target ("avx2")))
+# endif
+# if defined(AVS_HAVE_AVX2)
+#  include <immintrin.h>
+# endif
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+# define AVS_HAVE_NEON 1
+# include <arm_neon.h>
+#endif
+
+#endif /* _AVS_SIMD_H */
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <libvisual/libvisual.h>
+
+/* The block ops are static, test them where they live */
+#include "avs_blend.c"
+
+/* Checks every SIMD version of the block blends and BLEND4 against the C
+ * version: random pixels, every length up to a few vectors so the tails
+ * run, and buffers that start off the vector alignment.  mul and adj also
+ * get every pair of bytes, which covers the rounding of x/255. */
+
+#define MAX_LENGTH 67
+#define MAX_SHIFT  7
+#define GUARD      8
+#define ROUNDS     16
+#define WIDTH      8
+
+typedef struct {
+  const char *name;
+  const BlendBlockOps *ops;
+} BlendImpl;
+
+static unsigned char blendtable[256][256];
+static int fails;
+
+static int *aligned_buffer(void)
+{
+  static int storage[4][MAX_LENGTH + MAX_SHIFT + 2 * GUARD + 16];
+  static int next;
+  int *p = storage[next++ % 4];
+
+  /* 64 byte aligned, the shift is added to it */
+  return (int *) (((uintptr_t) p + 63) & ~(uintptr_t) 63);
+}
+
+static void randomize(int *p, int l)
+{
+  while (l--)
+    *p++ = (rand() << 16) ^ rand();
+}
+
+static void check(const char *impl, const char *op, int l, int shift, int *expected, int *result, int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+  {
+    if (expected[i] == result[i])
+      continue;
+
+    fprintf(stderr, "%s %s, length %d, shifted by %d: pixel %d is %08x, expected %08x\n",
+        impl, op, l, shift, i, result[i], expected[i]);
+    fails++;
+    return;
+  }
+}
+
+/* Runs one op of the C and the tested version on copies of the same pixels,
+ * the guard pixels around the output must stay untouched */
+static void run_op(const BlendImpl *impl, int op, int l, int shift, int v)
+{
+  int *in1 = aligned_buffer() + shift;
+  int *in2 = aligned_buffer() + shift;
+  int *expected = aligned_buffer();
+  int *result = aligned_buffer() + shift;
+  static const char *names[] = { "avg", "add", "max", "min", "sub", "revsub", "xor", "mul", "adj" };
+  const BlendBlockOps *ops[2] = { &blend_ops_c, impl->ops };
+  int *out[2];
+  int i;
+
+  randomize(in1, l);
+  randomize(in2, l);
+  randomize(expected, l + 2 * GUARD);
+  memcpy(result, expected, (l + 2 * GUARD) * sizeof(int));
+  out[0] = expected + GUARD;
+  out[1] = result + GUARD;
+
+  for (i = 0; i < 2; i++)
+  {
+    switch (op)
+    {
+      case 0: ops[i]->avg(out[i], in1, l); break;
+      case 1: ops[i]->add(out[i], in1, l); break;
+      case 2: ops[i]->max(out[i], in1, l); break;
+      case 3: ops[i]->min(out[i], in1, l); break;
+      case 4: ops[i]->sub(out[i], in1, l); break;
+      case 5: ops[i]->revsub(out[i], in1, l); break;
+      case 6: ops[i]->xor(out[i], in1, l); break;
+      case 7: ops[i]->mul(blendtable, out[i], in1, l); break;
+      case 8: ops[i]->adj(blendtable, out[i], in1, in2, l, v); break;
+    }
+  }
+
+  /* Pixel GUARD is the first one blended */
+  check(impl->name, names[op], l, shift, expected, result, l + 2 * GUARD);
+}
+
+/* Every pair of bytes in every channel, alpha included, all 256 weights for adj */
+static void run_rounding(const BlendImpl *impl)
+{
+  static int a[65536], b[65536], expected[65536], result[65536];
+  int i, v;
+
+  for (i = 0; i < 65536; i++)
+  {
+    a[i] = (i & 0xff) * 0x01010101;
+    b[i] = (i >> 8) * 0x01010101;
+  }
+
+  memcpy(expected, b, sizeof(b));
+  memcpy(result, b, sizeof(b));
+  blend_ops_c.mul(blendtable, expected, a, 65536);
+  impl->ops->mul(blendtable, result, a, 65536);
+  check(impl->name, "mul of every byte pair", 65536, 0, expected, result, 65536);
+
+  for (v = 0; v < 256; v++)
+  {
+    blend_ops_c.adj(blendtable, expected, a, b, 65536, v);
+    impl->ops->adj(blendtable, result, a, b, 65536, v);
+    check(impl->name, "adj of every byte pair", 65536, 0, expected, result, 65536);
+  }
+}
+
+static void run_blend4(void)
+{
+  int *p = aligned_buffer(), *q;
+  int i, xp, yp, a1, a2, a3, a4, expected, result;
+
+  for (i = 0; i < 100000; i++)
+  {
+    randomize(p, 2 * WIDTH);
+    xp = i < 65536 ? i & 0xff : rand() & 0xff;
+    yp = i < 65536 ? i >> 8 : rand() & 0xff;
+    a1 = blendtable[255-xp][255-yp];
+    a2 = blendtable[xp][255-yp];
+    a3 = blendtable[255-xp][yp];
+    a4 = blendtable[xp][yp];
+
+    /* Any of the pixels of a row can be the top left one */
+    q = p + i % (WIDTH - 1);
+    expected = blend4_c(blendtable, q, WIDTH, a1, a2, a3, a4);
+#if defined(AVS_HAVE_SSE2)
+    result = blend4_sse2(q, WIDTH, a1, a2, a3, a4);
+#elif defined(AVS_HAVE_NEON)
+    result = blend4_neon(q, WIDTH, a1, a2, a3, a4);
+#else
+    result = expected;
+#endif
+
+    if (expected != result)
+    {
+      fprintf(stderr, "blend4 at %d,%d: %08x, expected %08x\n", xp, yp, result, expected);
+      fails++;
+      return;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  BlendImpl impls[4];
+  int nimpls = 0;
+  int i, j, op, l, shift;
+
+  visual_init(&argc, &argv);
+  srand(1);
+
+  for (i = 0; i < 256; i++)
+    for (j = 0; j < 256; j++)
+      blendtable[i][j] = (i * j) / 255;
+
+#if defined(AVS_HAVE_SSE2)
+  impls[nimpls].name = "sse2";
+  impls[nimpls++].ops = &blend_ops_sse2;
+#endif
+#if defined(AVS_HAVE_AVX2)
+  if (visual_cpu_has_avx2())
+  {
+    impls[nimpls].name = "avx2";
+    impls[nimpls++].ops = &blend_ops_avx2;
+  }
+#endif
+#if defined(AVS_HAVE_NEON)
+  impls[nimpls].name = "neon";
+  impls[nimpls++].ops = &blend_ops_neon;
+#endif
+
+  for (i = 0; i < nimpls; i++)
+  {
+    for (op = 0; op < 9; op++)
+      for (l = 0; l <= MAX_LENGTH; l++)
+        for (shift = 0; shift <= MAX_SHIFT; shift++)
+          for (j = 0; j < ROUNDS; j++)
+            run_op(&impls[i], op, l, shift, rand() & 0xff);
+
+    run_rounding(&impls[i]);
+    printf("%s: checked\n", impls[i].name);
+  }
+
+  run_blend4();
+
+  printf("%d SIMD versions, %d mismatches\n", nimpls, fails);
+
+  return fails != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
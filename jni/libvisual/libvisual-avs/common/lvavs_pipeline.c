@@ -44,6 +44,13 @@
 static int lvavs_pipeline_dtor (VisObject *object);
 static int lvavs_pipeline_element_dtor (VisObject *object);
 static int lvavs_pipeline_container_dtor (VisObject *object);
+static int lvavs_pipeline_table_dtor (VisObject *object);
+
+static int pipeline_block_destroyer (void *data);
+static void pipeline_block_acquire (LVAVSPipeline *pipeline, LVAVSPipelineBlock *block, int size);
+static void pipeline_block_release (LVAVSPipeline *pipeline, LVAVSPipelineBlock *block);
+static void pipeline_buffers_resize (LVAVSPipeline *pipeline, VisVideo *video);
+static void pipeline_report (LVAVSPipeline *pipeline);
 
 int pipeline_from_preset (LVAVSPipelineContainer *container, LVAVSPresetContainer *presetcont);
 int pipeline_container_realize (LVAVSPipelineContainer *container);
@@ -55,6 +62,7 @@ int pipeline_container_run (LVAVSPipelineContainer *container, VisVideo *video,
 static int lvavs_pipeline_dtor (VisObject *object)
 {
     LVAVSPipeline *pipeline = LVAVS_PIPELINE (object);
+    int i;
 
     if (pipeline->renderstate != NULL)
         visual_object_unref (VISUAL_OBJECT (pipeline->renderstate));
@@ -62,8 +70,59 @@ static int lvavs_pipeline_dtor (VisObject *object)
     if (pipeline->container != NULL)
         visual_object_unref (VISUAL_OBJECT (pipeline->container));
 
+    if (pipeline->pool != NULL)
+        visual_object_unref (VISUAL_OBJECT (pipeline->pool));
+
+    if (pipeline->codecache != NULL)
+        visual_object_unref (VISUAL_OBJECT (pipeline->codecache));
+
+    for (i = 0; i < LVAVS_MAX_BUFFERS; i++) {
+        if (pipeline->buffers[i] != NULL)
+            visual_object_unref (VISUAL_OBJECT (pipeline->buffers[i]));
+
+        pipeline_block_release (pipeline, &pipeline->buffer_blocks[i]);
+        pipeline->buffers[i] = NULL;
+    }
+
+    if (pipeline->dummy_vid != NULL)
+        visual_object_unref (VISUAL_OBJECT (pipeline->dummy_vid));
+
+    if (pipeline->last_vid != NULL)
+        visual_object_unref (VISUAL_OBJECT (pipeline->last_vid));
+
+    pipeline_block_release (pipeline, &pipeline->dummy_block);
+    pipeline_block_release (pipeline, &pipeline->last_block);
+
+    if (pipeline->blocks != NULL)
+        visual_object_unref (VISUAL_OBJECT (pipeline->blocks));
+
+    /* Tables that outlive the pipeline are no longer found through it */
+    if (pipeline->tables != NULL) {
+        VisListEntry *le = NULL;
+        LVAVSPipelineTable *table;
+
+        while ((table = visual_list_next (pipeline->tables, &le)) != NULL)
+            table->pipeline = NULL;
+
+        visual_object_unref (VISUAL_OBJECT (pipeline->tables));
+    }
+
+    if (pipeline->frame_timer != NULL)
+        visual_timer_free (pipeline->frame_timer);
+
+    if (pipeline->report_timer != NULL)
+        visual_timer_free (pipeline->report_timer);
+
     pipeline->renderstate = NULL;
     pipeline->container = NULL;
+    pipeline->pool = NULL;
+    pipeline->codecache = NULL;
+    pipeline->tables = NULL;
+    pipeline->frame_timer = NULL;
+    pipeline->report_timer = NULL;
+    pipeline->dummy_vid = NULL;
+    pipeline->last_vid = NULL;
+    pipeline->blocks = NULL;
 
     return TRUE;
 }
@@ -106,8 +165,12 @@ static int lvavs_pipeline_element_dtor (VisObject *object)
             break;
     }
 
+    if (element->timer != NULL)
+        visual_timer_free (element->timer);
+
     element->pipeline = NULL;
     element->params = NULL;
+    element->timer = NULL;
 
     return TRUE;
 }
@@ -119,13 +182,47 @@ static int lvavs_pipeline_container_dtor (VisObject *object)
     if (container->members != NULL)
         ;//visual_object_unref (VISUAL_OBJECT (container->members));
 
+    if (container->steps != NULL)
+        visual_mem_free (container->steps);
+
     container->members = NULL;
+    container->steps = NULL;
+    container->nsteps = 0;
 
     lvavs_pipeline_element_dtor (object);
 
     return TRUE;
 }
 
+static int lvavs_pipeline_table_dtor (VisObject *object)
+{
+    LVAVSPipelineTable *table = LVAVS_PIPELINE_TABLE (object);
+
+    if (table->pipeline != NULL && table->key != NULL) {
+        VisListEntry *le = NULL;
+        LVAVSPipelineTable *entry;
+
+        while ((entry = visual_list_next (table->pipeline->tables, &le)) != NULL) {
+            if (entry == table) {
+                visual_list_delete (table->pipeline->tables, &le);
+                break;
+            }
+        }
+    }
+
+    if (table->key != NULL)
+        visual_mem_free (table->key);
+
+    if (table->data != NULL)
+        visual_mem_free (table->data);
+
+    table->pipeline = NULL;
+    table->key = NULL;
+    table->data = NULL;
+
+    return TRUE;
+}
+
 /* LVAVS Preset */
 LVAVSPipeline *lvavs_pipeline_new ()
 {
@@ -136,16 +233,23 @@ LVAVSPipeline *lvavs_pipeline_new ()
 
     pipeline = visual_mem_new0 (LVAVSPipeline, 1);
 
-    pipeline->dummy_vid = visual_video_new_with_buffer(0, 0, 1);
+    /* Get their pixels on the first frame, Buffer Save slots when they're used */
+    pipeline->dummy_vid = visual_video_new ();
+    pipeline->last_vid = visual_video_new ();
+
+    pipeline->blocks = visual_list_new (pipeline_block_destroyer);
 
-    pipeline->last_vid = visual_video_new_with_buffer(0, 0, 1);
-    
-    for(i = 0; i < sizeof(pipeline->buffers) / sizeof(VisVideo); i++) {
-        pipeline->buffers[i] = visual_video_new_with_buffer(0, 0, 1);
-    }
     for (j=0;j<256;j++)
         for (i=0;i<256;i++)
-            pipeline->blendtable[i][j] = (unsigned char)((i / 255.0) * (float)j);
+            pipeline->blendtable[i][j] = (i * j) / 255;
+
+    /* One slice per CPU until lvavs_pipeline_set_threads() says otherwise */
+    pipeline->pool = visual_worker_pool_new (0);
+
+    pipeline->tables = visual_list_new (NULL);
+
+    pipeline->frame_timer = visual_timer_new ();
+    pipeline->report_timer = visual_timer_new ();
 
     /* Do the VisObject initialization */
     visual_object_set_allocated (VISUAL_OBJECT (pipeline), TRUE);
@@ -164,6 +268,7 @@ LVAVSPipelineElement *lvavs_pipeline_element_new (LVAVSPipelineElementType type)
     visual_object_initialize (VISUAL_OBJECT (element), TRUE, lvavs_pipeline_element_dtor);
 
     element->type = type;
+    element->timer = visual_timer_new ();
 
     return element;
 }
@@ -178,6 +283,7 @@ LVAVSPipelineContainer *lvavs_pipeline_container_new ()
     visual_object_initialize (VISUAL_OBJECT (container), TRUE, lvavs_pipeline_container_dtor);
 
     LVAVS_PIPELINE_ELEMENT (container)->type = LVAVS_PIPELINE_ELEMENT_TYPE_CONTAINER;
+    LVAVS_PIPELINE_ELEMENT (container)->timer = visual_timer_new ();
 
     container->members = visual_list_new (visual_object_collection_destroyer);
 
@@ -190,6 +296,12 @@ LVAVSPipeline *lvavs_pipeline_new_from_preset (LVAVSPreset *preset)
 
     pipeline = lvavs_pipeline_new ();
 
+    /* Before the elements get created, they pick it up on init */
+    if (preset->codecache != NULL) {
+        visual_object_ref (VISUAL_OBJECT (preset->codecache));
+        pipeline->codecache = preset->codecache;
+    }
+
     pipeline->container = lvavs_pipeline_container_new ();
     LVAVS_PIPELINE_ELEMENT (pipeline->container)->pipeline = pipeline;
 
@@ -233,6 +345,8 @@ int lvavs_pipeline_run (LVAVSPipeline *pipeline, VisVideo *video, VisAudio *audi
 
     float data[2][2][size];
 
+    visual_timer_start (pipeline->frame_timer);
+
     visual_buffer_init_allocate(&tmp, sizeof(float) * size, visual_buffer_destroyer_free);
 
     /* Left audio */
@@ -288,10 +402,379 @@ int lvavs_pipeline_run (LVAVSPipeline *pipeline, VisVideo *video, VisAudio *audi
 
     pipeline_container_run (LVAVS_PIPELINE_CONTAINER (pipeline->container), video, audio);
 
+    pipeline_report (pipeline);
+
+    return VISUAL_OK;
+}
+
+/* A thread count of 0 uses one thread per CPU */
+int lvavs_pipeline_set_threads (LVAVSPipeline *pipeline, int threads)
+{
+    visual_return_val_if_fail (pipeline != NULL, -VISUAL_ERROR_NULL);
+
+    return visual_worker_pool_set_threads (pipeline->pool, threads);
+}
+
+int lvavs_pipeline_get_threads (LVAVSPipeline *pipeline)
+{
+    visual_return_val_if_fail (pipeline != NULL, -VISUAL_ERROR_NULL);
+
+    return visual_worker_pool_get_threads (pipeline->pool);
+}
+
+/* Runs func once for every slice, as func (data, this_thread, max_threads)
+ * with max_threads the pipeline thread count, and returns when all are done */
+int lvavs_pipeline_run_slices (LVAVSPipeline *pipeline, LVAVSPipelineSliceFunc func, void *data)
+{
+    visual_return_val_if_fail (pipeline != NULL, -VISUAL_ERROR_NULL);
+    visual_return_val_if_fail (func != NULL, -VISUAL_ERROR_NULL);
+
+    return visual_worker_pool_run (pipeline->pool, func, data, visual_worker_pool_get_threads (pipeline->pool));
+}
+
+/* Creates a zeroed table of size bytes.  With a key the table is found by
+ * lvavs_pipeline_table_find() until it's destroyed, so it must be filled in
+ * before anyone else can look for it; without one it's private to the caller */
+LVAVSPipelineTable *lvavs_pipeline_table_new (LVAVSPipeline *pipeline, const void *key, int keysize, int size)
+{
+    LVAVSPipelineTable *table;
+
+    visual_return_val_if_fail (pipeline != NULL, NULL);
+    visual_return_val_if_fail (size > 0, NULL);
+
+    table = visual_mem_new0 (LVAVSPipelineTable, 1);
+
+    /* Do the VisObject initialization */
+    visual_object_set_allocated (VISUAL_OBJECT (table), TRUE);
+    visual_object_initialize (VISUAL_OBJECT (table), TRUE, lvavs_pipeline_table_dtor);
+
+    table->pipeline = pipeline;
+    table->data = visual_mem_malloc0 (size);
+    table->size = size;
+
+    if (key != NULL && keysize > 0) {
+        table->key = visual_mem_malloc (keysize);
+        table->keysize = keysize;
+        visual_mem_copy (table->key, key, keysize);
+
+        visual_list_add (pipeline->tables, table);
+    }
+
+    return table;
+}
+
+/* Returns a table created with the same key, or NULL.  Not referenced, ref it to keep it */
+LVAVSPipelineTable *lvavs_pipeline_table_find (LVAVSPipeline *pipeline, const void *key, int keysize)
+{
+    VisListEntry *le = NULL;
+    LVAVSPipelineTable *table;
+
+    visual_return_val_if_fail (pipeline != NULL, NULL);
+    visual_return_val_if_fail (key != NULL, NULL);
+
+    while ((table = visual_list_next (pipeline->tables, &le)) != NULL) {
+        if (table->keysize == keysize && memcmp (table->key, key, keysize) == 0)
+            return table;
+    }
+
+    return NULL;
+}
+
+/* Returns Buffer Save slot n at the size of the frames being rendered.  The
+ * pixels are allocated on first use and zeroed again when the frame size
+ * changes.  Not referenced, the slot belongs to the pipeline */
+VisVideo *lvavs_pipeline_get_buffer (LVAVSPipeline *pipeline, int n)
+{
+    VisVideo *frame;
+
+    visual_return_val_if_fail (pipeline != NULL, NULL);
+    visual_return_val_if_fail (n >= 0 && n < LVAVS_MAX_BUFFERS, NULL);
+
+    if (pipeline->buffers[n] == NULL)
+        pipeline->buffers[n] = visual_video_new ();
+
+    frame = pipeline->dummy_vid;
+
+    if (pipeline->buffer_blocks[n].pixels == NULL && visual_video_get_size (frame) > 0) {
+        visual_video_set_attributes (pipeline->buffers[n], frame->width, frame->height, frame->pitch, frame->depth);
+        pipeline_block_acquire (pipeline, &pipeline->buffer_blocks[n], visual_video_get_size (frame));
+        visual_video_set_buffer (pipeline->buffers[n], pipeline->buffer_blocks[n].pixels);
+    }
+
+    return pipeline->buffers[n];
+}
+
+static const char *pipeline_element_name (LVAVSPipelineElement *element)
+{
+    switch (element->type) {
+        case LVAVS_PIPELINE_ELEMENT_TYPE_ACTOR:
+            return visual_actor_get_plugin (element->data.actor)->info->plugname;
+
+        case LVAVS_PIPELINE_ELEMENT_TYPE_TRANSFORM:
+            return visual_transform_get_plugin (element->data.transform)->info->plugname;
+
+        case LVAVS_PIPELINE_ELEMENT_TYPE_CONTAINER:
+            return "effectlist";
+
+        default:
+            return "unknown";
+    }
+}
+
+static int pipeline_container_stats (LVAVSPipelineContainer *container, int depth,
+        LVAVSPipelineElementStats *stats, int count, int n)
+{
+    LVAVSPipelineElement *element;
+    int i;
+
+    for (i = 0; i < container->nsteps; i++) {
+        element = container->steps[i].element;
+
+        if (n < count) {
+            stats[n].element = element;
+            stats[n].name = pipeline_element_name (element);
+            stats[n].depth = depth;
+            stats[n].frames = element->render_count;
+            stats[n].last_usecs = element->render_usecs;
+            stats[n].min_usecs = element->render_min_usecs;
+            stats[n].max_usecs = element->render_max_usecs;
+            stats[n].total_usecs = element->render_total_usecs;
+            stats[n].script_executions = element->script_executions;
+            stats[n].bytes_touched = element->bytes_touched;
+        }
+
+        n++;
+
+        if (element->type == LVAVS_PIPELINE_ELEMENT_TYPE_CONTAINER)
+            n = pipeline_container_stats (LVAVS_PIPELINE_CONTAINER (element), depth + 1, stats, count, n);
+    }
+
+    return n;
+}
+
+/* Fills in the costs of at most count rendering elements, in preset order
+ * with the members of an effect list following it.  Returns the number of
+ * elements there are, so a NULL stats gets the count */
+int lvavs_pipeline_get_stats (LVAVSPipeline *pipeline, LVAVSPipelineElementStats *stats, int count)
+{
+    visual_return_val_if_fail (pipeline != NULL, -VISUAL_ERROR_NULL);
+
+    if (pipeline->container == NULL)
+        return 0;
+
+    return pipeline_container_stats (pipeline->container, 0, stats, stats != NULL ? count : 0, 0);
+}
+
+static void pipeline_container_reset_stats (LVAVSPipelineContainer *container)
+{
+    LVAVSPipelineElement *element;
+    int i;
+
+    for (i = 0; i < container->nsteps; i++) {
+        element = container->steps[i].element;
+
+        element->render_usecs = 0;
+        element->render_total_usecs = 0;
+        element->render_min_usecs = 0;
+        element->render_max_usecs = 0;
+        element->render_count = 0;
+        element->script_executions = 0;
+        element->bytes_touched = 0;
+
+        if (element->type == LVAVS_PIPELINE_ELEMENT_TYPE_CONTAINER)
+            pipeline_container_reset_stats (LVAVS_PIPELINE_CONTAINER (element));
+    }
+}
+
+void lvavs_pipeline_reset_stats (LVAVSPipeline *pipeline)
+{
+    visual_return_if_fail (pipeline != NULL);
+
+    if (pipeline->container != NULL)
+        pipeline_container_reset_stats (pipeline->container);
+}
+
+/* Logs the frame times and the slowest element every msecs, 0 turns it off */
+int lvavs_pipeline_set_report_interval (LVAVSPipeline *pipeline, int msecs)
+{
+    visual_return_val_if_fail (pipeline != NULL, -VISUAL_ERROR_NULL);
+    visual_return_val_if_fail (msecs >= 0, -VISUAL_ERROR_GENERAL);
+
+    pipeline->report_interval = msecs;
+    pipeline->report_count = 0;
+    pipeline->report_total_usecs = 0;
+
+    visual_timer_start (pipeline->report_timer);
+
     return VISUAL_OK;
 }
 
 /* Internal functions */
+static void pipeline_report (LVAVSPipeline *pipeline)
+{
+    LVAVSPipelineElementStats *stats;
+    LVAVSPipelineElementStats *slowest = NULL;
+    uint64_t usecs;
+    int count, i;
+
+    if (pipeline->report_interval <= 0)
+        return;
+
+    usecs = visual_timer_elapsed_usecs (pipeline->frame_timer);
+
+    if (pipeline->report_count == 0 || usecs < pipeline->report_min_usecs)
+        pipeline->report_min_usecs = usecs;
+    if (pipeline->report_count == 0 || usecs > pipeline->report_max_usecs)
+        pipeline->report_max_usecs = usecs;
+
+    pipeline->report_total_usecs += usecs;
+    pipeline->report_count++;
+
+    if (visual_timer_elapsed_msecs (pipeline->report_timer) < (uint64_t) pipeline->report_interval)
+        return;
+
+    count = lvavs_pipeline_get_stats (pipeline, NULL, 0);
+    stats = visual_mem_new0 (LVAVSPipelineElementStats, count > 0 ? count : 1);
+    lvavs_pipeline_get_stats (pipeline, stats, count);
+
+    /* Effect lists would always win, they include their members */
+    for (i = 0; i < count; i++) {
+        if (stats[i].element->type == LVAVS_PIPELINE_ELEMENT_TYPE_CONTAINER || stats[i].frames == 0)
+            continue;
+
+        if (slowest == NULL || stats[i].total_usecs / stats[i].frames > slowest->total_usecs / slowest->frames)
+            slowest = &stats[i];
+    }
+
+    visual_log (VISUAL_LOG_INFO, "frame ms (avg,min,max) = (%.1f,%.1f,%.1f), slowest element %s at %.1f ms",
+            pipeline->report_total_usecs / 1000.0 / pipeline->report_count,
+            pipeline->report_min_usecs / 1000.0, pipeline->report_max_usecs / 1000.0,
+            slowest != NULL ? slowest->name : "none",
+            slowest != NULL ? slowest->total_usecs / 1000.0 / slowest->frames : 0.0);
+
+    visual_mem_free (stats);
+
+    pipeline->report_count = 0;
+    pipeline->report_total_usecs = 0;
+
+    visual_timer_start (pipeline->report_timer);
+}
+
+static int pipeline_block_destroyer (void *data)
+{
+    LVAVSPipelineBlock *block = data;
+
+    visual_mem_free (block->pixels);
+    visual_mem_free (block);
+
+    return VISUAL_OK;
+}
+
+/* Rounding up to an eighth of the highest power of two below the size wastes
+ * at most 12.5%, and lets a block serve a range of frame sizes */
+static int pipeline_block_size_class (int size)
+{
+    int step = 4096;
+
+    while (step * 16 <= size)
+        step <<= 1;
+
+    return (size + step - 1) & ~(step - 1);
+}
+
+/* Gets a zeroed block of at least size bytes, the smallest pooled one that fits or a new one */
+static void pipeline_block_acquire (LVAVSPipeline *pipeline, LVAVSPipelineBlock *block, int size)
+{
+    VisListEntry *le = NULL;
+    VisListEntry *bestle = NULL;
+    LVAVSPipelineBlock *entry;
+    LVAVSPipelineBlock *best = NULL;
+
+    while ((entry = visual_list_next (pipeline->blocks, &le)) != NULL) {
+        if (entry->size >= size && (best == NULL || entry->size < best->size)) {
+            best = entry;
+            bestle = le;
+        }
+    }
+
+    if (best == NULL) {
+        block->size = pipeline_block_size_class (size);
+        block->pixels = visual_mem_malloc0 (block->size);
+
+        return;
+    }
+
+    *block = *best;
+    visual_mem_free (best);
+    visual_list_delete (pipeline->blocks, &bestle);
+
+    visual_mem_set (block->pixels, 0, size);
+}
+
+static void pipeline_block_release (LVAVSPipeline *pipeline, LVAVSPipelineBlock *block)
+{
+    LVAVSPipelineBlock *entry;
+
+    if (block->pixels == NULL)
+        return;
+
+    entry = visual_mem_new0 (LVAVSPipelineBlock, 1);
+    *entry = *block;
+
+    visual_list_add (pipeline->blocks, entry);
+
+    block->pixels = NULL;
+    block->size = 0;
+}
+
+/* Gives every framebuffer the format of video.  The old blocks go back in
+ * the pool first so the new buffers can use them, Buffer Save slots get
+ * theirs again on their next lvavs_pipeline_get_buffer() */
+static void pipeline_buffers_resize (LVAVSPipeline *pipeline, VisVideo *video)
+{
+    VisListEntry *le;
+    LVAVSPipelineBlock *entry;
+    int size = visual_video_get_size (video);
+    int largest;
+    int i;
+
+    pipeline_block_release (pipeline, &pipeline->dummy_block);
+    pipeline_block_release (pipeline, &pipeline->last_block);
+
+    for (i = 0; i < LVAVS_MAX_BUFFERS; i++) {
+        if (pipeline->buffers[i] != NULL)
+            visual_video_set_buffer (pipeline->buffers[i], NULL);
+
+        pipeline_block_release (pipeline, &pipeline->buffer_blocks[i]);
+    }
+
+    /* Blocks too small for the new size won't be used again, and blocks left
+     * from a much larger size would only hold on to memory.  One size class
+     * of slack keeps them over small back and forth resizes */
+    largest = pipeline_block_size_class (size + size / 8);
+
+    do {
+        le = NULL;
+
+        while ((entry = visual_list_next (pipeline->blocks, &le)) != NULL &&
+                entry->size >= size && entry->size <= largest)
+            ;
+
+        if (entry != NULL)
+            visual_list_destroy (pipeline->blocks, &le);
+    } while (entry != NULL);
+
+    visual_video_set_buffer (pipeline->dummy_vid, NULL);
+    visual_video_set_attributes (pipeline->dummy_vid, video->width, video->height, video->pitch, video->depth);
+    pipeline_block_acquire (pipeline, &pipeline->dummy_block, size);
+    visual_video_set_buffer (pipeline->dummy_vid, pipeline->dummy_block.pixels);
+
+    visual_video_set_buffer (pipeline->last_vid, NULL);
+    visual_video_set_attributes (pipeline->last_vid, video->width, video->height, video->pitch, video->depth);
+    pipeline_block_acquire (pipeline, &pipeline->last_block, size);
+    visual_video_set_buffer (pipeline->last_vid, pipeline->last_block.pixels);
+}
+
 int pipeline_from_preset (LVAVSPipelineContainer *container, LVAVSPresetContainer *presetcont)
 {
     VisListEntry *le = NULL;
@@ -443,6 +926,91 @@ int pipeline_container_realize (LVAVSPipelineContainer *container)
     return 0;
 }
 
+/* An actor or transform reads the frame, and writes a second one when it swaps */
+static void step_count_bytes (LVAVSPipelineStep *step, VisVideo *video)
+{
+    LVAVSPipeline *pipeline = step->element->pipeline;
+
+    pipeline->bytes_touched += (uint64_t) visual_video_get_size (video) * ((pipeline->swap & 1) ? 2 : 1);
+}
+
+static void step_run_actor (LVAVSPipelineStep *step, VisVideo *video, VisAudio *audio)
+{
+    VisActor *actor = step->element->data.actor;
+
+    if (step->video != video) {
+        visual_actor_set_video (actor, video);
+        step->video = video;
+    }
+
+    visual_actor_run (actor, audio);
+
+    step_count_bytes (step, video);
+}
+
+static void step_run_transform (LVAVSPipelineStep *step, VisVideo *video, VisAudio *audio)
+{
+    VisTransform *transform = step->element->data.transform;
+
+    if (step->video != video) {
+        visual_transform_set_video (transform, video);
+        step->video = video;
+    }
+
+    visual_transform_run (transform, audio);
+
+    step_count_bytes (step, video);
+}
+
+static void step_run_container (LVAVSPipelineStep *step, VisVideo *video, VisAudio *audio)
+{
+    pipeline_container_run (LVAVS_PIPELINE_CONTAINER (step->element), video, audio);
+}
+
+/* Lays out the members that render in an array, so running the container
+ * doesn't walk the member list or look at element types every frame */
+static void pipeline_container_plan (LVAVSPipelineContainer *container, VisVideo *video)
+{
+    VisListEntry *le = NULL;
+    LVAVSPipelineElement *element;
+    LVAVSPipelineStep *step;
+
+    if (container->steps != NULL)
+        visual_mem_free (container->steps);
+
+    container->steps = visual_mem_new0 (LVAVSPipelineStep, visual_list_count (container->members));
+    container->nsteps = 0;
+
+    while ((element = visual_list_next (container->members, &le)) != NULL) {
+        step = &container->steps[container->nsteps];
+
+        switch (element->type) {
+            case LVAVS_PIPELINE_ELEMENT_TYPE_ACTOR:
+                step->run = step_run_actor;
+                step->video = video;
+
+                break;
+
+            case LVAVS_PIPELINE_ELEMENT_TYPE_TRANSFORM:
+                step->run = step_run_transform;
+                step->video = video;
+
+                break;
+
+            case LVAVS_PIPELINE_ELEMENT_TYPE_CONTAINER:
+                step->run = step_run_container;
+
+                break;
+
+            default:
+                continue;
+        }
+
+        step->element = element;
+        container->nsteps++;
+    }
+}
+
 int pipeline_container_negotiate (LVAVSPipelineContainer *container, VisVideo *video)
 {
     VisListEntry *le = NULL;
@@ -476,6 +1044,8 @@ int pipeline_container_negotiate (LVAVSPipelineContainer *container, VisVideo *v
         }
     }
 
+    pipeline_container_plan (container, video);
+
     return VISUAL_OK;
 }
 
@@ -527,49 +1097,130 @@ static void set_blendin(int v, int *mode) { *mode&=~(31<<8); *mode|=(v&31)<<8; }
 static int blendout(int  mode) { return ((mode>>16)&31)^1; }
 static void set_blendout(int v, int *mode) { *mode&=~(31<<16); *mode|=((v^1)&31)<<16; }
 
+/* Blends the w*h pixels of in into out, mode is one of the blendin/blendout
+ * values and v the adjustable blend weight */
+static void blend_buffers(LVAVSPipeline *pipeline, int mode, int *out, int *in, int w, int h, int v)
+{
+    int x = w*h;
+
+    /* Copying a buffer onto itself, or an adjustable blend taking none of it */
+    if((mode == 1 && out == in) || (mode == 10 && v <= 0))
+        return;
+
+    /* Blends read both buffers and write one, copies read one and write the
+     * other, line and checkerboard copies do that for half the pixels */
+    if(mode >= 1 && mode <= 13 && mode != 12)
+        pipeline->bytes_touched += (uint64_t) x * sizeof(int) * (mode == 1 ? 2 : (mode == 7 || mode == 8) ? 1 : 3);
+
+    switch (mode)
+    {
+        case 1:
+            visual_mem_copy(out, in, x*sizeof(int));
+        break;
+        case 2:
+            mmx_avgblend_block(out, in, x);
+        break;
+        case 3:
+            mmx_maxblend_block(out, in, x);
+        break;
+        case 4:
+            mmx_addblend_block(out, in, x);
+        break;
+        case 5:
+            mmx_subblend_block(out, in, x);
+        break;
+        case 6:
+            mmx_revsubblend_block(out, in, x);
+        break;
+        case 7:
+        {
+            int y=h/2;
+            while(y-- > 0)
+            {
+                visual_mem_copy(out, in, w*sizeof(int));
+                in+=w*2;
+                out+=w*2;
+            }
+        }
+        break;
+        case 8:
+        {
+            int r = 0;
+            int y = h;
+            while(y-- > 0)
+            {
+                int *o, *i;
+                int x=w/2;
+                o=out+r;
+                i=in+r;
+                r^=1;
+                while(x-- > 0)
+                {
+                    *o=*i;
+                    o+=2;
+                    i+=2;
+                }
+                out+=w;
+                in+=w;
+            }
+        }
+        break;
+        case 9:
+            mmx_xorblend_block(out, in, x);
+        break;
+        case 10:
+            mmx_adjblend_block(pipeline->blendtable, out, in, out, x, v);
+        break;
+        case 11:
+            mmx_mulblend_block(pipeline->blendtable, out, in, x);
+        break;
+        case 13:
+            mmx_minblend_block(out, in, x);
+        break;
+        case 12:
+            /* Global buffer blending, not supported yet */
+        break;
+        default:
+        break;
+    }
+}
+
+
 static int render_now(LVAVSPipelineContainer *container, VisVideo *video, VisAudio *audio, int s)
 {
     LVAVSPipeline *pipeline = LVAVS_PIPELINE_ELEMENT(container)->pipeline;
+    int *dummy = visual_video_get_pixels(pipeline->dummy_vid);
+    int *pixels = visual_video_get_pixels(video);
 
     int i;
-    int count = visual_list_count(container->members);
-    for(i = 0; i < count; i++) {
-        LVAVSPipelineElement *element = visual_list_get(container->members, i);
-        VisVideo *tmpvid;
+    for(i = 0; i < container->nsteps; i++) {
+        LVAVSPipelineStep *step = &container->steps[i];
+        LVAVSPipelineElement *element = step->element;
+        uint64_t executions = pipeline->script_executions;
+        uint64_t bytes = pipeline->bytes_touched;
 
         if(s) {
-            pipeline->framebuffer = visual_video_get_pixels(pipeline->dummy_vid);
-            pipeline->fbout = visual_video_get_pixels(video);
+            pipeline->framebuffer = dummy;
+            pipeline->fbout = pixels;
         } else {
-            pipeline->fbout = visual_video_get_pixels(pipeline->dummy_vid);
-            pipeline->framebuffer = visual_video_get_pixels(video);
+            pipeline->fbout = dummy;
+            pipeline->framebuffer = pixels;
         }
 
-        switch (element->type) {
-            case LVAVS_PIPELINE_ELEMENT_TYPE_ACTOR:
-
-                visual_actor_set_video (element->data.actor, video);
-                visual_actor_run (element->data.actor, audio);
-
-                break;
-
-            case LVAVS_PIPELINE_ELEMENT_TYPE_TRANSFORM:
-
-                visual_transform_set_video (element->data.transform, video);
-                visual_transform_run (element->data.transform, audio);
-
-                break;
-
-            case LVAVS_PIPELINE_ELEMENT_TYPE_CONTAINER:
-
-                pipeline_container_run (LVAVS_PIPELINE_CONTAINER (element), video, audio);
+        visual_timer_start (element->timer);
 
-                break;
+        step->run (step, video, audio);
 
-            default:
+        element->render_usecs = visual_timer_elapsed_usecs (element->timer);
+        element->render_total_usecs += element->render_usecs;
+        if(element->render_count == 0 || element->render_usecs < element->render_min_usecs)
+            element->render_min_usecs = element->render_usecs;
+        if(element->render_count == 0 || element->render_usecs > element->render_max_usecs)
+            element->render_max_usecs = element->render_usecs;
+        element->render_count++;
 
-                break;
-        }
+        element->script_executions += pipeline->script_executions - executions;
+        element->bytes_touched += pipeline->bytes_touched - bytes;
 
         if(pipeline->swap&1) {
             s^=1;
@@ -582,7 +1233,7 @@ static int render_now(LVAVSPipelineContainer *container, VisVideo *video, VisAud
 }
 int pipeline_container_run (LVAVSPipelineContainer *container, VisVideo *video, VisAudio *audio)
 {
-    int i, s = 0;
+    int s = 0;
     VisListEntry *le = NULL;
     LVAVSPipelineElement *element;
     VisBuffer pcmbuf1;
@@ -594,30 +1245,20 @@ int pipeline_container_run (LVAVSPipelineContainer *container, VisVideo *video,
     int *framebuffer;
     LVAVSPipeline *pipeline = LVAVS_PIPELINE_ELEMENT(container)->pipeline;
     int w = video->width, h = video->height;
-
-    if(video->width != pipeline->dummy_vid->width || video->height != pipeline->dummy_vid->height || video->depth != pipeline->dummy_vid->depth) {
-
-        if(pipeline->dummy_vid)
-            visual_object_unref(VISUAL_OBJECT(pipeline->dummy_vid));
-
-        if(pipeline->last_vid)
-            visual_object_unref(VISUAL_OBJECT(pipeline->last_vid));
-    
-        pipeline->dummy_vid = visual_video_scale_depth_new(video, video->width, video->height, video->depth, VISUAL_VIDEO_COMPOSITE_TYPE_SRC);
-
-        pipeline->last_vid = visual_video_scale_depth_new(video, video->width, video->height, video->depth, VISUAL_VIDEO_COMPOSITE_TYPE_SRC);
-        
-        for(i = 0; i < 16; i++) {
-            VisVideo *vid = pipeline->buffers[i];
-            if(vid)
-                visual_object_unref(VISUAL_OBJECT(vid));
-            vid = visual_video_scale_depth_new(video, video->width, video->height, video->depth, VISUAL_VIDEO_COMPOSITE_TYPE_NONE);
-            pipeline->buffers[i] = vid;
-        }
+    int is_root;
+
+    if(video->width != pipeline->dummy_vid->width || video->height != pipeline->dummy_vid->height ||
+            video->pitch != pipeline->dummy_vid->pitch || video->depth != pipeline->dummy_vid->depth)
+        pipeline_buffers_resize(pipeline, video);
+
+    /* Effect lists inside the preset continue on the frame as it is, only
+     * the whole preset starts from the last one */
+    is_root = (container == pipeline->container);
+    if(is_root) {
+        visual_mem_copy(visual_video_get_pixels(video), visual_video_get_pixels(pipeline->last_vid), visual_video_get_size(video));
+        pipeline->bytes_touched += 2 * (uint64_t) visual_video_get_size(video);
     }
 
-    visual_video_blit_overlay(video, pipeline->last_vid, 0, 0, 0.5);
-      
     fbout = visual_video_get_pixels(video);
     framebuffer = visual_video_get_pixels(pipeline->dummy_vid);
 
@@ -630,117 +1271,14 @@ int pipeline_container_run (LVAVSPipelineContainer *container, VisVideo *video,
 
     if(!is_preinit)
     {
-        int x = video->width * video->height;
         int *tfb=framebuffer;
         int *o = fbout;
         int use_blendin=blendin(pipeline->blendmode);
         if(use_blendin == 10 && pipeline->use_inblendval >= 255)
             use_blendin=1;
 
-        switch (use_blendin)
-        {
-            case 1:
-                visual_mem_copy(o, tfb, w*h*sizeof(int));
-            break;
-            case 2:
-                mmx_avgblend_block(o,tfb,x);
-            break;
-            case 3:
-                while(x--)
-                {
-                    *o=BLEND_MAX(*o, *tfb++);
-                    o++;
-                }
-            break;
-            case 4:
-            //mmx_addblend_block(pipeline->blendtable, o, tfb, x);
-            break;
-            case 5:
-                while(x--)
-                {
-                    *o=BLEND_SUB(*o,*tfb++);
-                    o++;
-                }
-            break;
-            case 6:
-                while(x--)
-                {
-                    *o=BLEND_SUB(*tfb++, *o);
-                    o++;
-                }
-            break;
-            case 7:
-            {
-                int y=h/2;
-                while(x-- > 0)
-                {
-                    visual_mem_copy(o,tfb,w*sizeof(int));
-                    tfb+=w*2;
-                    o+=w*2;
-                }
-            break;
-            }
-            case 8:
-            {
-                int r = 0;
-                int y = h;
-                while(y-- > 0)
-                {
-                    int *out, *in;
-                    int x=w/2;
-                    out=o+r;
-                    in=tfb+r;
-                    r^=1;
-                    while(x-- > 0)
-                    {
-                        *out=*in;
-                        out+=2;
-                        in+=2;
-                    }
-                    o+=w;
-                    tfb+=w;
-                }
-            break;
-            }
-            case 9:
-                while(x--)
-                {
-                    *o=*o^*tfb++;
-                    o++;
-                }
-            break;
-            case 10:
-                mmx_adjblend_block(pipeline->blendtable,o,tfb,o,x,pipeline->use_inblendval);
-            break;
-            case 11:
-                mmx_mulblend_block(pipeline->blendtable, o,tfb,x);
-            break;
-            case 13:
-                while(x--)
-                {
-                    *o=BLEND_MIN(*o,*tfb++);
-                    o++;
-                }
-            break;
-            case 12:
-    /*
-                                    {
-                                            int *buf=(int*)getGlobalBuffer(w,h,bufferin,0);
-                                            if (!buf) break;
-                                            while (x--)
-                                            {
-                                                    *o=BLEND_ADJ(*tfb++,*o, depthof(*buf, ininvert));
-                                                    o++;
-                                                    buf++;
-                                            }
-                                    }
-    */
-            break;
-            default:
-            break;
-        }
+        blend_buffers(pipeline, use_blendin, o, tfb, w, h, pipeline->use_inblendval);
     }
-    int x;
     int line_blend_mode_save=pipeline->blendmode;
     //if(!is_preinit) pipeline->blendmode = 0;
 
@@ -749,111 +1287,26 @@ int pipeline_container_run (LVAVSPipelineContainer *container, VisVideo *video,
 
     if(!is_preinit)
     {
-        if(s) visual_mem_copy(framebuffer, fbout, w*h*sizeof(int));
+        /* Replace does this copy itself */
+        if(s && blendout(pipeline->blendmode) != 1) {
+            visual_mem_copy(framebuffer, fbout, w*h*sizeof(int));
+            pipeline->bytes_touched += 2 * (uint64_t) w*h*sizeof(int);
+        }
 
         int *tfb=s?fbout:framebuffer;
         int *o=framebuffer;
-        x=w*h;
         int use_blendout=blendout(pipeline->blendmode);
         int use_outblendval = 100;
         if(use_blendout == 10 && use_outblendval >= 255)
             use_blendout=1;
-        switch(use_blendout)
-        {
-            case 1:
-                visual_mem_copy(o,tfb,x*sizeof(int));
-            break;
-            case 2:
-                mmx_avgblend_block(o,tfb,x);
-            break;
-            case 3:
-                while(x--)
-                {
-                    *o=BLEND_MAX(*o, *tfb++);
-                    o++;
-                }
-            break;
-            case 4:
-                mmx_addblend_block(o, tfb, x);
-            break;
-            case 5:
-                while(x--)
-                {
-                    *o = BLEND_SUB(*o, *tfb++);
-                    o++;
-                }
-            break;
-            case 6:
-                while(x--)
-                {
-                    *o=BLEND_SUB(*tfb++, *o);
-                    o++;
-                }
-            break;
-            case 7:
-            {
-                int y=h/2;
-                while(y-- > 0)
-                {
-                    visual_mem_copy(o, tfb, w*sizeof(int));
-                    tfb+=w*2;
-                    o+=w*2;
-                }
-            }
-            break;
-            case 8:
-            {
-                int r = 0;
-                int y = h;
-                while(y-- > 0)
-                {
-                    int *out, *in;
-                    int x=w/2;
-                    out=o+r;
-                    in=tfb+r;
-                    r^=1;
-                    while(x-- > 0)
-                    {
-                        *out=*in;
-                        out+=2;
-                        in+=2;
-                    }
-                    o+=w;
-                    tfb+=2;
-                }
-            }
-            case 9:
-                while(x--)
-                {
-                    *o=*o^*tfb++;
-                    o++;
-                }
-            break;
-            case 10:
-                mmx_adjblend_block(pipeline->blendtable,o, tfb, o, x, use_outblendval);
-            break;
-            case 11:
-                mmx_mulblend_block(pipeline->blendtable, o, tfb, x);
-            break;
-            case 13:
-                while(x--)
-                {
-                    *o=BLEND_MIN(*o, *tfb++);
-                    o++;
-                }
-            break;
-            case 12:
-            {
-                //uint32_t *buf = buffer[bufferout]
-            }
-            break;
-            default:
-            break;
-        }
-    } 
+        blend_buffers(pipeline, use_blendout, o, tfb, w, h, use_outblendval);
+    }
 
     // Save state for next frame.
-    visual_video_blit_overlay(pipeline->last_vid, video, 0, 0, 0);
+    if(is_root) {
+        visual_mem_copy(visual_video_get_pixels(pipeline->last_vid), visual_video_get_pixels(video), visual_video_get_size(video));
+        pipeline->bytes_touched += 2 * (uint64_t) visual_video_get_size(video);
+    }
     return VISUAL_OK;
 }
 
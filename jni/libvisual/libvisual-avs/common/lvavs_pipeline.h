@@ -38,6 +38,7 @@ extern "C" {
 #define LVAVS_PIPELINE_RENDERSTATE(obj)			(VISUAL_CHECK_CAST ((obj), LVAVSPipelineRenderState))
 #define LVAVS_PIPELINE_ELEMENT(obj)			(VISUAL_CHECK_CAST ((obj), LVAVSPipelineElement))
 #define LVAVS_PIPELINE_CONTAINER(obj)			(VISUAL_CHECK_CAST ((obj), LVAVSPipelineContainer))
+#define LVAVS_PIPELINE_TABLE(obj)			(VISUAL_CHECK_CAST ((obj), LVAVSPipelineTable))
 
 #define LVAVS_MAX_BUFFERS 16
 
@@ -45,6 +46,17 @@ typedef struct _LVAVSPipeline LVAVSPipeline;
 typedef struct _LVAVSPipelineRenderState LVAVSPipelineRenderState;
 typedef struct _LVAVSPipelineElement LVAVSPipelineElement;
 typedef struct _LVAVSPipelineContainer LVAVSPipelineContainer;
+typedef struct _LVAVSPipelineTable LVAVSPipelineTable;
+typedef struct _LVAVSPipelineBlock LVAVSPipelineBlock;
+typedef struct _LVAVSPipelineStep LVAVSPipelineStep;
+typedef struct _LVAVSPipelineElementStats LVAVSPipelineElementStats;
+
+/* Renders slice this_thread of max_threads, Winamp's smp_render signature.
+ * Slices run concurrently, each must only write its own rows. */
+typedef VisWorkerFunc LVAVSPipelineSliceFunc;
+
+/* Renders the element of step on video */
+typedef void (*LVAVSPipelineStepFunc) (LVAVSPipelineStep *step, VisVideo *video, VisAudio *audio);
 
 
 typedef enum {
@@ -69,6 +81,13 @@ typedef enum {
 	LVAVS_PIPELINE_RENDER_STATE_BLEND_TYPE_MINIMUM
 } LVAVSPipelineRenderStateBlendMode;
 
+/* Pixel memory of a pipeline framebuffer, size is rounded up to a size class
+ * so blocks can be reused when the frame size changes a little */
+struct _LVAVSPipelineBlock {
+	void				*pixels;
+	int				 size;
+};
+
 /* The AVS data structure */
 struct _LVAVSPipeline {
 	VisObject			 object;
@@ -79,10 +98,17 @@ struct _LVAVSPipeline {
 
 	VisVideo			*target;
 
+	/* Buffer Save slots, allocated on first use by lvavs_pipeline_get_buffer() */
 	VisVideo			*buffers[LVAVS_MAX_BUFFERS];
+	LVAVSPipelineBlock		 buffer_blocks[LVAVS_MAX_BUFFERS];
 
 	VisVideo *dummy_vid;
         VisVideo *last_vid;
+	LVAVSPipelineBlock		 dummy_block;
+	LVAVSPipelineBlock		 last_block;
+
+	/* Blocks not in use, kept over resizes for the next buffer that fits */
+	VisList				*blocks;
 
 	float audiodata[2][2][1024];
 
@@ -116,6 +142,29 @@ struct _LVAVSPipeline {
         int use_inblendval;
 
 	LVAVSPipelineContainer		*container;
+
+	/* Threads that the slices of the SMP elements run on */
+	VisWorkerPool			*pool;
+
+	/* Compiled scripts of the preset, for the runnable contexts of the elements */
+	struct _AvsCodeCache		*codecache;
+
+	/* Keyed tables of the elements, not referenced, see LVAVSPipelineTable */
+	VisList				*tables;
+
+	/* Running totals the elements' costs are taken from, script executions
+	 * are counted by the elements' runnable contexts */
+	uint64_t			 script_executions;
+	uint64_t			 bytes_touched;
+
+	/* Frame times for the periodic report, over the current period */
+	VisTimer			*frame_timer;
+	VisTimer			*report_timer;
+	int				 report_interval;
+	uint64_t			 report_total_usecs;
+	uint64_t			 report_min_usecs;
+	uint64_t			 report_max_usecs;
+	int				 report_count;
 };
 
 // For removal. I don't see any reason to separatet these fields from the VisPipeline. Maybe there's a reason to exhcange RenderStates between pipelines? Leaving this here for now.
@@ -147,12 +196,72 @@ struct _LVAVSPipelineElement {
 		LVAVSPipelineRenderState	*renderstate;
 		LVAVSPipelineContainer		*container;
 	} data;
+
+	/* Render time, of the last frame and summed over render_count frames */
+	VisTimer			*timer;
+	uint64_t			 render_usecs;
+	uint64_t			 render_total_usecs;
+	uint64_t			 render_min_usecs;
+	uint64_t			 render_max_usecs;
+	int				 render_count;
+
+	/* Summed over render_count frames, like render_total_usecs */
+	uint64_t			 script_executions;
+	uint64_t			 bytes_touched;
 };
 
 struct _LVAVSPipelineContainer {
 	LVAVSPipelineElement		 element;
 
 	VisList				*members;
+
+	/* The members that render, in order, set up when the container is negotiated */
+	LVAVSPipelineStep		*steps;
+	int				 nsteps;
+};
+
+/* A member of a container bound to its render function */
+struct _LVAVSPipelineStep {
+	LVAVSPipelineStepFunc		 run;
+
+	LVAVSPipelineElement		*element;
+
+	/* The video the actor or transform was last given */
+	VisVideo			*video;
+};
+
+/* Data computed from element settings, like movement tables, that elements
+ * with the same settings can share instead of each computing its own.  The key
+ * holds everything the data depends on, keyed tables are not changed after
+ * they are filled in. */
+struct _LVAVSPipelineTable {
+	VisObject			 object;
+
+	LVAVSPipeline			*pipeline;
+
+	void				*key;
+	int				 keysize;
+
+	void				*data;
+	int				 size;
+};
+
+
+/* The costs of one element, see lvavs_pipeline_get_stats().  Nested effect
+ * lists include the costs of their members.  Bytes touched are estimated from
+ * the framebuffers an element reads and writes. */
+struct _LVAVSPipelineElementStats {
+	LVAVSPipelineElement		*element;
+	const char			*name;
+	int				 depth;
+
+	int				 frames;
+	uint64_t			 last_usecs;
+	uint64_t			 min_usecs;
+	uint64_t			 max_usecs;
+	uint64_t			 total_usecs;
+	uint64_t			 script_executions;
+	uint64_t			 bytes_touched;
 };
 
 
@@ -167,6 +276,19 @@ int lvavs_pipeline_negotiate (LVAVSPipeline *pipeline, VisVideo *video);
 int lvavs_pipeline_propagate_event (LVAVSPipeline *pipeline, VisEvent *event);
 int lvavs_pipeline_run (LVAVSPipeline *pipeline, VisVideo *video, VisAudio *audio);
 
+int lvavs_pipeline_set_threads (LVAVSPipeline *pipeline, int threads);
+int lvavs_pipeline_get_threads (LVAVSPipeline *pipeline);
+int lvavs_pipeline_run_slices (LVAVSPipeline *pipeline, LVAVSPipelineSliceFunc func, void *data);
+
+LVAVSPipelineTable *lvavs_pipeline_table_new (LVAVSPipeline *pipeline, const void *key, int keysize, int size);
+LVAVSPipelineTable *lvavs_pipeline_table_find (LVAVSPipeline *pipeline, const void *key, int keysize);
+
+VisVideo *lvavs_pipeline_get_buffer (LVAVSPipeline *pipeline, int n);
+
+int lvavs_pipeline_get_stats (LVAVSPipeline *pipeline, LVAVSPipelineElementStats *stats, int count);
+void lvavs_pipeline_reset_stats (LVAVSPipeline *pipeline);
+int lvavs_pipeline_set_report_interval (LVAVSPipeline *pipeline, int msecs);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
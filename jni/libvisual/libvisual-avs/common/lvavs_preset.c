@@ -121,8 +121,12 @@ static int lvavs_preset_dtor (VisObject *object)
 	if (preset->main != NULL)
 		visual_object_unref (VISUAL_OBJECT (preset->main));
 
+	if (preset->codecache != NULL)
+		visual_object_unref (VISUAL_OBJECT (preset->codecache));
+
 	preset->origfile = NULL;
 	preset->main = NULL;
+	preset->codecache = NULL;
 
 	return TRUE;
 }
@@ -272,6 +276,7 @@ LVAVSPreset *lvavs_preset_new_from_preset (char *filename)
 		{
 			xmlNodePtr child;
 			LVAVSPresetContainer *cont = lvavs_preset_container_new();
+			visual_object_ref(VISUAL_OBJECT(pcont));
 			LVAVS_PRESET_ELEMENT(cont)->pcont = pcont;
 			visual_list_add(preset->main->members, cont);
 			cont = lvavs_preset_container_from_xml_node(cont, cur);
@@ -41,6 +41,8 @@ typedef struct _LVAVSPreset LVAVSPreset;
 typedef struct _LVAVSPresetElement LVAVSPresetElement;
 typedef struct _LVAVSPresetContainer LVAVSPresetContainer;
 
+struct _AvsCodeCache;
+
 typedef enum {
 	LVAVS_PRESET_ELEMENT_TYPE_NULL,
 	LVAVS_PRESET_ELEMENT_TYPE_PLUGIN,
@@ -58,6 +60,9 @@ struct _LVAVSPreset {
 	char			*origfile;
 
 	LVAVSPresetContainer	*main;
+
+	/* Compiled scripts, when loaded from a compiled preset */
+	struct _AvsCodeCache	*codecache;
 };
 
 struct _LVAVSPresetElement {
@@ -85,6 +90,11 @@ LVAVSPreset *lvavs_preset_new_from_preset (char *filename);
 LVAVSPresetElement *lvavs_preset_element_new (LVAVSPresetElementType type, const char *name);
 LVAVSPresetContainer *lvavs_preset_container_new (void);
 
+/* lvavs_preset_cache.c */
+int lvavs_preset_cache_compile (char *filename, const char *cachedir);
+LVAVSPreset *lvavs_preset_new_from_cache (char *filename, const char *cachedir);
+LVAVSPreset *lvavs_preset_new_from_preset_cached (char *filename, const char *cachedir);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
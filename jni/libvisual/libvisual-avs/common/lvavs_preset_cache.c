@@ -0,0 +1,810 @@
+/* Libvisual-AVS - Advanced visual studio for libvisual
+ *
+ * Copyright (C) 2005, 2006 Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * Authors: Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+
+#include <libvisual/libvisual.h>
+
+#include "lvavs_preset.h"
+#include "avs.h"
+
+/*
+ * A compiled preset is the element tree of a preset together with the
+ * bytecode of its scripts, so loading it needs neither libxml nor the
+ * VisScript lexer, parser and compiler.  It is made of 32 bit words in host
+ * byte order and used straight from a mapped file:
+ *
+ *	header		magic, version, source hash and length, offsets
+ *	tree		the elements, depth first
+ *	scripts		source and bytecode offset and length per script
+ *	bytecode	one blob per script, padded to a word
+ *
+ * An element is its type, name and flags, followed by its params unless it
+ * shares the params of its parent, and by its members if it is a container.
+ * Strings are a length followed by the NUL terminated bytes, padded to a
+ * word, script sources point at the string params in the tree.
+ *
+ * Compiled presets are named after a hash of the preset source, an edited
+ * preset simply misses the cache.
+ */
+
+#define CACHE_MAGIC		0x43505641	/* "AVPC" */
+#define CACHE_VERSION		1
+#define CACHE_SUFFIX		".avsc"
+#define CACHE_MAX_DEPTH		64
+
+#define CACHE_STRING_NULL	0xffffffff
+
+#define CACHE_ELEMENT_SHARED	1
+
+#define LVAVS_PRESET_MAP(obj)	(VISUAL_CHECK_CAST ((obj), LVAVSPresetMap))
+
+typedef struct {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	bytecode_version;
+	uint32_t	hash[2];
+	uint32_t	source_length;
+	uint32_t	tree_offset;
+	uint32_t	tree_length;
+	uint32_t	scripts;
+	uint32_t	scripts_offset;
+	uint32_t	length;
+} CacheHeader;
+
+typedef struct {
+	uint32_t	source_offset;
+	uint32_t	source_length;
+	uint32_t	code_offset;
+	uint32_t	code_length;
+} CacheScript;
+
+typedef struct {
+	unsigned char	*data;
+	uint32_t	 length;
+	uint32_t	 size;
+} CacheBuffer;
+
+typedef struct {
+	const unsigned char	*data;
+	uint32_t		 pos;
+	uint32_t		 end;
+	int			 error;
+} CacheReader;
+
+typedef struct {
+	uint32_t	 source_offset;
+	uint32_t	 source_length;
+	unsigned char	*code;
+	unsigned int	 code_length;
+} CacheWriterScript;
+
+typedef struct {
+	CacheBuffer		 buf;
+	CacheWriterScript	*scripts;
+	int			 count;
+} CacheWriter;
+
+/* Keeps a compiled preset mapped for as long as its code cache is around */
+typedef struct {
+	VisObject	 object;
+	void		*data;
+	size_t		 size;
+} LVAVSPresetMap;
+
+static int preset_map_dtor (VisObject *object)
+{
+	LVAVSPresetMap *map = LVAVS_PRESET_MAP (object);
+
+	if (map->data != NULL)
+		munmap (map->data, map->size);
+
+	map->data = NULL;
+
+	return TRUE;
+}
+
+static uint64_t source_hash (const unsigned char *data, uint32_t length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+		hash = (hash ^ data[i]) * 1099511628211ULL;
+
+	return hash;
+}
+
+static unsigned char *source_read (const char *filename, uint32_t *length)
+{
+	unsigned char *data;
+	struct stat st;
+	ssize_t n;
+	size_t done = 0;
+	int fd;
+
+	if ((fd = open (filename, O_RDONLY)) < 0)
+		return NULL;
+
+	if (fstat (fd, &st) < 0 || st.st_size > UINT32_MAX) {
+		close (fd);
+
+		return NULL;
+	}
+
+	data = visual_mem_malloc (st.st_size + 1);
+
+	while (done < (size_t) st.st_size) {
+		if ((n = read (fd, data + done, st.st_size - done)) <= 0)
+			break;
+
+		done += n;
+	}
+
+	close (fd);
+
+	if (done != (size_t) st.st_size) {
+		visual_mem_free (data);
+
+		return NULL;
+	}
+
+	*length = done;
+
+	return data;
+}
+
+static char *cache_path (const char *filename, const char *cachedir, uint64_t hash)
+{
+	const char *slash = strrchr (filename, '/');
+	int dirlength;
+	char *path;
+
+	if (cachedir == NULL && slash == NULL)
+		cachedir = ".";
+
+	if (cachedir != NULL)
+		dirlength = strlen (cachedir);
+	else
+		dirlength = slash - filename;
+
+	path = visual_mem_malloc (dirlength + 32);
+	snprintf (path, dirlength + 32, "%.*s/%016" PRIx64 CACHE_SUFFIX,
+			dirlength, cachedir != NULL ? cachedir : filename, hash);
+
+	return path;
+}
+
+/* Writer */
+static uint32_t buffer_reserve (CacheBuffer *buf, uint32_t length)
+{
+	uint32_t offset = buf->length;
+
+	if (buf->length + length > buf->size) {
+		while (buf->length + length > buf->size)
+			buf->size = buf->size ? buf->size * 2 : 4096;
+
+		buf->data = realloc (buf->data, buf->size);
+	}
+
+	memset (buf->data + offset, 0, length);
+	buf->length += length;
+
+	return offset;
+}
+
+static void buffer_word (CacheBuffer *buf, uint32_t word)
+{
+	uint32_t offset = buffer_reserve (buf, sizeof (uint32_t));
+
+	memcpy (buf->data + offset, &word, sizeof (uint32_t));
+}
+
+/* Always leaves a NUL behind the data */
+static uint32_t buffer_bytes (CacheBuffer *buf, const void *data, uint32_t length)
+{
+	uint32_t offset = buffer_reserve (buf, (length + 4) & ~3);
+
+	memcpy (buf->data + offset, data, length);
+
+	return offset;
+}
+
+static uint32_t buffer_string (CacheBuffer *buf, const char *string)
+{
+	if (string == NULL) {
+		buffer_word (buf, CACHE_STRING_NULL);
+
+		return 0;
+	}
+
+	buffer_word (buf, strlen (string));
+
+	return buffer_bytes (buf, string, strlen (string));
+}
+
+static void writer_script (CacheWriter *writer, uint32_t offset, uint32_t length)
+{
+	CacheWriterScript *script;
+	AvsRunnableContext *ctx;
+	AvsRunnableVariableManager *vm;
+	AvsRunnable *obj;
+	int i;
+
+	for (i = 0; i < writer->count; i++) {
+		script = &writer->scripts[i];
+
+		if (script->source_length == length &&
+				memcmp (writer->buf.data + script->source_offset, writer->buf.data + offset, length) == 0)
+			return;
+	}
+
+	/* A context per script, like every plugin instance has its own */
+	ctx = avs_runnable_context_new ();
+	vm = avs_runnable_variable_manager_new ();
+	obj = avs_runnable_new (ctx);
+	avs_runnable_set_variable_manager (obj, vm);
+
+	avs_runnable_compile (obj, writer->buf.data + offset, length);
+
+	if ((writer->count & 31) == 0)
+		writer->scripts = realloc (writer->scripts, sizeof (CacheWriterScript) * (writer->count + 32));
+
+	script = &writer->scripts[writer->count];
+	script->source_offset = offset;
+	script->source_length = length;
+
+	if (avs_runnable_save (obj, &script->code, &script->code_length) == VISUAL_OK)
+		writer->count++;
+
+	visual_object_unref (VISUAL_OBJECT (obj));
+	visual_object_unref (VISUAL_OBJECT (vm));
+	visual_object_unref (VISUAL_OBJECT (ctx));
+}
+
+static int writer_params (CacheWriter *writer, VisParamContainer *pcont)
+{
+	VisParamEntry *param;
+	VisListEntry *le = NULL;
+	uint32_t offset;
+	double value;
+	int count = 0;
+
+	while (visual_list_next (&pcont->entries, &le) != NULL)
+		count++;
+
+	buffer_word (&writer->buf, count);
+
+	while ((param = visual_list_next (&pcont->entries, &le)) != NULL) {
+		buffer_string (&writer->buf, param->name);
+		buffer_word (&writer->buf, param->type);
+
+		switch (param->type) {
+			case VISUAL_PARAM_ENTRY_TYPE_NULL:
+				break;
+
+			case VISUAL_PARAM_ENTRY_TYPE_STRING:
+				offset = buffer_string (&writer->buf, param->string);
+
+				if (param->string != NULL)
+					writer_script (writer, offset, strlen (param->string));
+
+				break;
+
+			case VISUAL_PARAM_ENTRY_TYPE_INTEGER:
+				buffer_word (&writer->buf, param->numeric.integer);
+
+				break;
+
+			case VISUAL_PARAM_ENTRY_TYPE_FLOAT:
+			case VISUAL_PARAM_ENTRY_TYPE_DOUBLE:
+				value = param->type == VISUAL_PARAM_ENTRY_TYPE_FLOAT ?
+					param->numeric.floating : param->numeric.doubleflt;
+				offset = buffer_reserve (&writer->buf, sizeof (double));
+				memcpy (writer->buf.data + offset, &value, sizeof (double));
+
+				break;
+
+			case VISUAL_PARAM_ENTRY_TYPE_COLOR:
+				buffer_word (&writer->buf, param->color.r);
+				buffer_word (&writer->buf, param->color.g);
+				buffer_word (&writer->buf, param->color.b);
+
+				break;
+
+			default:
+				visual_log (VISUAL_LOG_WARNING, "Can't store param %s in a compiled preset", param->name);
+
+				return -VISUAL_ERROR_GENERAL;
+		}
+	}
+
+	return VISUAL_OK;
+}
+
+static int writer_element (CacheWriter *writer, LVAVSPresetElement *element, VisParamContainer *parent)
+{
+	LVAVSPresetElement *member;
+	VisListEntry *le = NULL;
+	int shared = element->pcont != NULL && element->pcont == parent;
+	int count = 0;
+
+	buffer_word (&writer->buf, element->type);
+	buffer_string (&writer->buf, element->element_name);
+	buffer_word (&writer->buf, shared ? CACHE_ELEMENT_SHARED : 0);
+
+	if (!shared) {
+		VisParamContainer *empty = NULL;
+
+		if (element->pcont == NULL)
+			empty = visual_param_container_new ();
+
+		if (writer_params (writer, empty != NULL ? empty : element->pcont) != VISUAL_OK)
+			return -VISUAL_ERROR_GENERAL;
+
+		if (empty != NULL)
+			visual_object_unref (VISUAL_OBJECT (empty));
+	}
+
+	if (element->type != LVAVS_PRESET_ELEMENT_TYPE_CONTAINER)
+		return VISUAL_OK;
+
+	while (visual_list_next (LVAVS_PRESET_CONTAINER (element)->members, &le) != NULL)
+		count++;
+
+	buffer_word (&writer->buf, count);
+
+	while ((member = visual_list_next (LVAVS_PRESET_CONTAINER (element)->members, &le)) != NULL) {
+		if (writer_element (writer, member, element->pcont) != VISUAL_OK)
+			return -VISUAL_ERROR_GENERAL;
+	}
+
+	return VISUAL_OK;
+}
+
+static int cache_file_write (const char *path, const void *data, uint32_t length)
+{
+	char *tmp = visual_mem_malloc (strlen (path) + 16);
+	FILE *f;
+	int ret = VISUAL_OK;
+
+	sprintf (tmp, "%s.%d", path, (int) getpid ());
+
+	if ((f = fopen (tmp, "wb")) == NULL) {
+		visual_mem_free (tmp);
+
+		return -VISUAL_ERROR_GENERAL;
+	}
+
+	if (fwrite (data, 1, length, f) != length)
+		ret = -VISUAL_ERROR_GENERAL;
+
+	if (fclose (f) != 0)
+		ret = -VISUAL_ERROR_GENERAL;
+
+	/* Readers only ever see a complete file */
+	if (ret == VISUAL_OK && rename (tmp, path) != 0)
+		ret = -VISUAL_ERROR_GENERAL;
+
+	if (ret != VISUAL_OK)
+		unlink (tmp);
+
+	visual_mem_free (tmp);
+
+	return ret;
+}
+
+/* Reader */
+static uint32_t reader_word (CacheReader *reader)
+{
+	uint32_t word;
+
+	if (reader->error || reader->end - reader->pos < sizeof (uint32_t)) {
+		reader->error = TRUE;
+
+		return 0;
+	}
+
+	memcpy (&word, reader->data + reader->pos, sizeof (uint32_t));
+	reader->pos += sizeof (uint32_t);
+
+	return word;
+}
+
+static const char *reader_string (CacheReader *reader)
+{
+	const char *string;
+	uint32_t length = reader_word (reader);
+	uint32_t padded;
+
+	if (reader->error || length == CACHE_STRING_NULL)
+		return NULL;
+
+	padded = (length + 4) & ~3;
+	if (length > padded || reader->end - reader->pos < padded || reader->data[reader->pos + length] != '\0') {
+		reader->error = TRUE;
+
+		return NULL;
+	}
+
+	string = (const char *) reader->data + reader->pos;
+	reader->pos += padded;
+
+	return string;
+}
+
+static int reader_params (CacheReader *reader, VisParamContainer *pcont)
+{
+	VisParamEntry *param;
+	const char *name, *string;
+	uint32_t count, i, type;
+	uint32_t r, g, b;
+	double value;
+
+	count = reader_word (reader);
+
+	for (i = 0; i < count && !reader->error; i++) {
+		name = reader_string (reader);
+		type = reader_word (reader);
+
+		if (name == NULL)
+			reader->error = TRUE;
+
+		if (reader->error)
+			break;
+
+		param = visual_param_entry_new ((char *) name);
+
+		switch (type) {
+			case VISUAL_PARAM_ENTRY_TYPE_NULL:
+				break;
+
+			case VISUAL_PARAM_ENTRY_TYPE_STRING:
+				string = reader_string (reader);
+				visual_param_entry_set_string (param, (char *) string);
+
+				break;
+
+			case VISUAL_PARAM_ENTRY_TYPE_INTEGER:
+				visual_param_entry_set_integer (param, (int32_t) reader_word (reader));
+
+				break;
+
+			case VISUAL_PARAM_ENTRY_TYPE_FLOAT:
+			case VISUAL_PARAM_ENTRY_TYPE_DOUBLE:
+				if (reader->end - reader->pos < sizeof (double)) {
+					reader->error = TRUE;
+
+					break;
+				}
+
+				memcpy (&value, reader->data + reader->pos, sizeof (double));
+				reader->pos += sizeof (double);
+
+				if (type == VISUAL_PARAM_ENTRY_TYPE_FLOAT)
+					visual_param_entry_set_float (param, value);
+				else
+					visual_param_entry_set_double (param, value);
+
+				break;
+
+			case VISUAL_PARAM_ENTRY_TYPE_COLOR:
+				r = reader_word (reader);
+				g = reader_word (reader);
+				b = reader_word (reader);
+				visual_param_entry_set_color (param, r, g, b);
+
+				break;
+
+			default:
+				reader->error = TRUE;
+
+				break;
+		}
+
+		visual_param_container_add (pcont, param);
+	}
+
+	return reader->error ? -VISUAL_ERROR_GENERAL : VISUAL_OK;
+}
+
+static LVAVSPresetElement *reader_element (CacheReader *reader, VisParamContainer *parent, int depth)
+{
+	LVAVSPresetElement *element, *member;
+	const char *name;
+	uint32_t type, flags, count, i;
+
+	type = reader_word (reader);
+	name = reader_string (reader);
+	flags = reader_word (reader);
+
+	if (reader->error || depth > CACHE_MAX_DEPTH || type > LVAVS_PRESET_ELEMENT_TYPE_BPM ||
+			((flags & CACHE_ELEMENT_SHARED) && parent == NULL)) {
+		reader->error = TRUE;
+
+		return NULL;
+	}
+
+	if (type == LVAVS_PRESET_ELEMENT_TYPE_CONTAINER) {
+		element = LVAVS_PRESET_ELEMENT (lvavs_preset_container_new ());
+
+		if (name != NULL) {
+			visual_mem_free (element->element_name);
+			element->element_name = strdup (name);
+		}
+	} else {
+		element = lvavs_preset_element_new (type, name != NULL ? name : "");
+		visual_object_unref (VISUAL_OBJECT (element->pcont));
+		element->pcont = NULL;
+	}
+
+	if (flags & CACHE_ELEMENT_SHARED) {
+		visual_object_ref (VISUAL_OBJECT (parent));
+		element->pcont = parent;
+	} else {
+		element->pcont = visual_param_container_new ();
+		reader_params (reader, element->pcont);
+	}
+
+	if (type == LVAVS_PRESET_ELEMENT_TYPE_CONTAINER) {
+		count = reader_word (reader);
+
+		for (i = 0; i < count && !reader->error; i++) {
+			if ((member = reader_element (reader, element->pcont, depth + 1)) != NULL)
+				visual_list_add (LVAVS_PRESET_CONTAINER (element)->members, member);
+		}
+	}
+
+	if (reader->error) {
+		visual_object_unref (VISUAL_OBJECT (element));
+
+		return NULL;
+	}
+
+	return element;
+}
+
+static int reader_range (const CacheHeader *header, uint32_t offset, uint32_t length)
+{
+	return (offset & 3) == 0 && offset <= header->length && length <= header->length - offset;
+}
+
+/**
+ * Compile a preset, writing its element tree and the bytecode of its scripts
+ * to the cache for lvavs_preset_new_from_cache() to load.
+ *
+ * @param filename Preset to compile.
+ * @param cachedir Directory to write the compiled preset to, NULL for the directory of the preset.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_GENERAL on failure.
+ */
+int lvavs_preset_cache_compile (char *filename, const char *cachedir)
+{
+	LVAVSPreset *preset;
+	CacheWriter writer;
+	CacheHeader header;
+	CacheScript script;
+	unsigned char *source;
+	uint32_t length;
+	uint64_t hash;
+	char *path;
+	int ret = VISUAL_OK;
+	int i;
+
+	visual_return_val_if_fail (filename != NULL, -VISUAL_ERROR_GENERAL);
+
+	if ((source = source_read (filename, &length)) == NULL)
+		return -VISUAL_ERROR_GENERAL;
+
+	hash = source_hash (source, length);
+	visual_mem_free (source);
+
+	if ((preset = lvavs_preset_new_from_preset (filename)) == NULL)
+		return -VISUAL_ERROR_GENERAL;
+
+	memset (&writer, 0, sizeof (CacheWriter));
+	memset (&header, 0, sizeof (CacheHeader));
+
+	buffer_reserve (&writer.buf, sizeof (CacheHeader));
+
+	header.tree_offset = writer.buf.length;
+	if (writer_element (&writer, LVAVS_PRESET_ELEMENT (preset->main), NULL) != VISUAL_OK)
+		ret = -VISUAL_ERROR_GENERAL;
+	header.tree_length = writer.buf.length - header.tree_offset;
+
+	header.scripts = writer.count;
+	header.scripts_offset = buffer_reserve (&writer.buf, sizeof (CacheScript) * writer.count);
+
+	for (i = 0; i < writer.count; i++) {
+		script.source_offset = writer.scripts[i].source_offset;
+		script.source_length = writer.scripts[i].source_length;
+		script.code_offset = buffer_bytes (&writer.buf, writer.scripts[i].code, writer.scripts[i].code_length);
+		script.code_length = writer.scripts[i].code_length;
+
+		memcpy (writer.buf.data + header.scripts_offset + sizeof (CacheScript) * i, &script, sizeof (CacheScript));
+
+		free (writer.scripts[i].code);
+	}
+
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.bytecode_version = AVS_BYTECODE_VERSION;
+	header.hash[0] = hash & 0xffffffff;
+	header.hash[1] = hash >> 32;
+	header.source_length = length;
+	header.length = writer.buf.length;
+
+	memcpy (writer.buf.data, &header, sizeof (CacheHeader));
+
+	if (ret == VISUAL_OK) {
+		path = cache_path (filename, cachedir, hash);
+		ret = cache_file_write (path, writer.buf.data, writer.buf.length);
+		visual_mem_free (path);
+	}
+
+	free (writer.scripts);
+	free (writer.buf.data);
+
+	visual_object_unref (VISUAL_OBJECT (preset));
+
+	return ret;
+}
+
+/**
+ * Load a preset from its compiled form, as written by lvavs_preset_cache_compile().
+ * Scripts of the preset are picked up from the code cache of the preset.
+ *
+ * @param filename Preset to load.
+ * @param cachedir Directory holding compiled presets, NULL for the directory of the preset.
+ *
+ * @return The preset, NULL when there is no valid compiled preset for the current preset source.
+ */
+LVAVSPreset *lvavs_preset_new_from_cache (char *filename, const char *cachedir)
+{
+	LVAVSPreset *preset;
+	LVAVSPresetElement *root;
+	LVAVSPresetMap *map;
+	AvsCodeCache *cache;
+	CacheReader reader;
+	CacheHeader header;
+	CacheScript script;
+	unsigned char *source, *data;
+	struct stat st;
+	uint32_t length, i;
+	uint64_t hash;
+	char *path;
+	int fd;
+
+	visual_return_val_if_fail (filename != NULL, NULL);
+
+	if ((source = source_read (filename, &length)) == NULL)
+		return NULL;
+
+	hash = source_hash (source, length);
+	visual_mem_free (source);
+
+	path = cache_path (filename, cachedir, hash);
+	fd = open (path, O_RDONLY);
+	visual_mem_free (path);
+
+	if (fd < 0)
+		return NULL;
+
+	if (fstat (fd, &st) < 0 || st.st_size < (off_t) sizeof (CacheHeader) || st.st_size > UINT32_MAX) {
+		close (fd);
+
+		return NULL;
+	}
+
+	data = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close (fd);
+
+	if (data == MAP_FAILED)
+		return NULL;
+
+	map = visual_mem_new0 (LVAVSPresetMap, 1);
+	visual_object_initialize (VISUAL_OBJECT (map), TRUE, preset_map_dtor);
+	map->data = data;
+	map->size = st.st_size;
+
+	memcpy (&header, data, sizeof (CacheHeader));
+
+	if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+			header.bytecode_version != AVS_BYTECODE_VERSION ||
+			header.hash[0] != (hash & 0xffffffff) || header.hash[1] != (hash >> 32) ||
+			header.source_length != length || header.length != st.st_size ||
+			!reader_range (&header, header.tree_offset, header.tree_length) ||
+			header.scripts > header.length / sizeof (CacheScript) ||
+			!reader_range (&header, header.scripts_offset, header.scripts * sizeof (CacheScript))) {
+
+		visual_log (VISUAL_LOG_INFO, "Stale compiled preset for %s", filename);
+		visual_object_unref (VISUAL_OBJECT (map));
+
+		return NULL;
+	}
+
+	reader.data = data;
+	reader.pos = header.tree_offset;
+	reader.end = header.tree_offset + header.tree_length;
+	reader.error = FALSE;
+
+	root = reader_element (&reader, NULL, 0);
+
+	if (root == NULL || root->type != LVAVS_PRESET_ELEMENT_TYPE_CONTAINER) {
+		visual_log (VISUAL_LOG_WARNING, "Corrupt compiled preset for %s", filename);
+
+		if (root != NULL)
+			visual_object_unref (VISUAL_OBJECT (root));
+
+		visual_object_unref (VISUAL_OBJECT (map));
+
+		return NULL;
+	}
+
+	/* The cache holds on to the mapping, entries point into it */
+	cache = avs_code_cache_new ();
+	cache->owner = VISUAL_OBJECT (map);
+
+	for (i = 0; i < header.scripts; i++) {
+		memcpy (&script, data + header.scripts_offset + sizeof (CacheScript) * i, sizeof (CacheScript));
+
+		if (!reader_range (&header, script.source_offset, script.source_length) ||
+				!reader_range (&header, script.code_offset, script.code_length))
+			continue;
+
+		avs_code_cache_add (cache, data + script.source_offset, script.source_length,
+				data + script.code_offset, script.code_length);
+	}
+
+	preset = lvavs_preset_new ();
+	preset->main = LVAVS_PRESET_CONTAINER (root);
+	preset->origfile = strdup (filename);
+	preset->codecache = cache;
+
+	return preset;
+}
+
+/**
+ * Load a preset, from its compiled form when there is a valid one and
+ * from the preset itself otherwise.
+ *
+ * @param filename Preset to load.
+ * @param cachedir Directory holding compiled presets, NULL for the directory of the preset.
+ *
+ * @return The preset, NULL on failure.
+ */
+LVAVSPreset *lvavs_preset_new_from_preset_cached (char *filename, const char *cachedir)
+{
+	LVAVSPreset *preset;
+
+	if ((preset = lvavs_preset_new_from_cache (filename, cachedir)) != NULL)
+		return preset;
+
+	return lvavs_preset_new_from_preset (filename);
+}
@@ -43,6 +43,9 @@
 
 AvsNumber PI = M_PI;
 
+/* Points run through the point code at once */
+#define SCOPE_BATCH_LANES 256
+
 typedef enum scope_runnable ScopeRunnable;
 
 enum scope_runnable {
@@ -57,6 +60,13 @@ typedef struct {
     AvsRunnableVariableManager  *vm;
     AvsRunnable         *runnable[4];
     AvsNumber           n, b, x, y, i, v, w, h, red, green, blue, linesize, skip, drawmode, t, d; 
+
+    /* Per point values of the point code */
+    AvsRunnableBatch    *batch;
+    AvsNumber           lane_x[SCOPE_BATCH_LANES], lane_y[SCOPE_BATCH_LANES];
+    AvsNumber           lane_i[SCOPE_BATCH_LANES], lane_v[SCOPE_BATCH_LANES];
+    AvsNumber           lane_red[SCOPE_BATCH_LANES], lane_green[SCOPE_BATCH_LANES], lane_blue[SCOPE_BATCH_LANES];
+    AvsNumber           lane_skip[SCOPE_BATCH_LANES], lane_drawmode[SCOPE_BATCH_LANES];
     LVAVSPipeline *pipeline;
 
 
@@ -119,6 +129,24 @@ int scope_load_runnable(SuperScopePrivate *priv, ScopeRunnable runnable, char *b
     avs_runnable_set_variable_manager(obj, priv->vm);
     priv->runnable[runnable] = obj;
     avs_runnable_compile(obj, (unsigned char *)buf, strlen(buf));
+
+    if (runnable == SCOPE_RUNNABLE_POINT) {
+        if (priv->batch != NULL)
+            visual_object_unref(VISUAL_OBJECT(priv->batch));
+
+        priv->batch = avs_runnable_batch_new(obj, SCOPE_BATCH_LANES);
+
+        avs_runnable_batch_bind(priv->batch, "i", priv->lane_i, AvsRunnableBatchInput);
+        avs_runnable_batch_bind(priv->batch, "v", priv->lane_v, AvsRunnableBatchInput);
+        avs_runnable_batch_bind(priv->batch, "skip", priv->lane_skip, AvsRunnableBatchInput | AvsRunnableBatchOutput);
+        avs_runnable_batch_bind(priv->batch, "x", priv->lane_x, AvsRunnableBatchOutput);
+        avs_runnable_batch_bind(priv->batch, "y", priv->lane_y, AvsRunnableBatchOutput);
+        avs_runnable_batch_bind(priv->batch, "red", priv->lane_red, AvsRunnableBatchOutput);
+        avs_runnable_batch_bind(priv->batch, "green", priv->lane_green, AvsRunnableBatchOutput);
+        avs_runnable_batch_bind(priv->batch, "blue", priv->lane_blue, AvsRunnableBatchOutput);
+        avs_runnable_batch_bind(priv->batch, "drawmode", priv->lane_drawmode, AvsRunnableBatchOutput);
+    }
+
     return 0;
 }
 
@@ -168,6 +196,8 @@ int lv_superscope_init (VisPluginData *plugin)
 
     /* Init super scope */
     priv->ctx = avs_runnable_context_new();
+    avs_runnable_context_set_cache(priv->ctx, priv->pipeline->codecache);
+    avs_runnable_context_set_counter(priv->ctx, &priv->pipeline->script_executions);
     priv->vm = avs_runnable_variable_manager_new();
 
     /* Bind variables to context */
@@ -199,6 +229,9 @@ int lv_superscope_cleanup (VisPluginData *plugin)
     if(priv->pipeline != NULL)
         visual_object_unref(VISUAL_OBJECT(priv->pipeline));
 
+    if(priv->batch != NULL)
+        visual_object_unref(VISUAL_OBJECT(priv->batch));
+
     visual_mem_free (priv);
 
     return 0;
@@ -327,7 +360,7 @@ int lv_superscope_render (VisPluginData *plugin, VisVideo *video, VisAudio *audi
         scope_run(priv, SCOPE_RUNNABLE_INIT);
     }
 
-    int a, l, lx = 0, ly = 0, x = 0, y = 0;
+    int a, k, l, count, lx = 0, ly = 0, x = 0, y = 0;
     int32_t current_color;
     int ws=(priv->channel_source&4)?1:0;
     int xorv=(ws*128)^128;
@@ -387,44 +420,53 @@ int lv_superscope_render (VisPluginData *plugin, VisVideo *video, VisAudio *audi
     if (l >= 128*size)
         l = 128*size - 1;
 
-    for (a=0; a < l; a++) 
+    for (a=0; a < l; a += count)
     {
-        double r=(a*size)/(double)l;
-        double s1=r-(int)r;
-        int val1 = (pcmbuf[(int)r] + 1) / 2.0 * 128;
-        int val2 = (pcmbuf[(int)r+1] + 1) / 2.0  * 128;
-        double yr=(val1^xorv)*(1.0-s1)+(val2^xorv)*(s1);
-        priv->v = yr/128.0;
-        priv->i = (AvsNumber)a/(AvsNumber)(l-1);
-        priv->skip = 0.0;
-        scope_run(priv, SCOPE_RUNNABLE_POINT);
+        count = l - a < SCOPE_BATCH_LANES ? l - a : SCOPE_BATCH_LANES;
+
+        for (k=0; k < count; k++)
+        {
+            double r=((a+k)*size)/(double)l;
+            double s1=r-(int)r;
+            int val1 = (pcmbuf[(int)r] + 1) / 2.0 * 128;
+            int val2 = (pcmbuf[(int)r+1] + 1) / 2.0  * 128;
+            double yr=(val1^xorv)*(1.0-s1)+(val2^xorv)*(s1);
+            priv->lane_v[k] = yr/128.0;
+            priv->lane_i[k] = (AvsNumber)(a+k)/(AvsNumber)(l-1);
+            priv->lane_skip[k] = 0.0;
+        }
 
-        x = (int)((priv->x + 1.0) * (AvsNumber)video->width * 0.5);
-        y = (int)((priv->y + 1.0) * (AvsNumber)video->height * 0.5);
+        avs_runnable_batch_execute(priv->batch, count);
 
+        for (k=0; k < count; k++)
+        {
+            x = (int)((priv->lane_x[k] + 1.0) * (AvsNumber)video->width * 0.5);
+            y = (int)((priv->lane_y[k] + 1.0) * (AvsNumber)video->height * 0.5);
 
-        if (priv->skip >= 0.00001)
-            continue;
 
-        uint32_t this_color = makeint(priv->blue) | (makeint(priv->green) << 8) | (makeint(priv->red) << 16) | (255 << 24);
+            if (priv->lane_skip[k] >= 0.00001)
+                continue;
 
-        if (priv->drawmode < 0.00001) {
-            if (y >= 0 && y < video->height && x >= 0 && x < video->width) {
-                BLEND_LINE(buf+x+y*video->width, this_color, pipeline->blendtable, pipeline->blendmode);
-            }
-        } else {
-            if (a > 0) {
-                if (y >= 0 && y < video->height && x >= 0 && x < video->width &&
-                    ly >= 0 && ly < video->height && lx >= 0 && lx < video->width) {
-                        VisColor color;
-                        visual_color_from_uint32(&color, this_color);
-
-                        avs_gfx_line_ints(video, lx, ly, x, y, &color);
+            uint32_t this_color = makeint(priv->lane_blue[k]) | (makeint(priv->lane_green[k]) << 8) | (makeint(priv->lane_red[k]) << 16) | (255 << 24);
+
+            if (priv->lane_drawmode[k] < 0.00001) {
+                if (y >= 0 && y < video->height && x >= 0 && x < video->width) {
+                    BLEND_LINE(buf+x+y*video->width, this_color, pipeline->blendtable, pipeline->blendmode);
+                }
+            } else {
+                if (a+k > 0) {
+                    if (y >= 0 && y < video->height && x >= 0 && x < video->width &&
+                        ly >= 0 && ly < video->height && lx >= 0 && lx < video->width) {
+                            VisColor color;
+                            visual_color_from_uint32(&color, this_color);
+
+                            avs_gfx_line_ints(video, lx, ly, x, y, &color);
+                    }
                 }
             }
+            lx = x;
+            ly = y;
         }
-       	lx = x;
-        ly = y;
     }
 
     return 0;
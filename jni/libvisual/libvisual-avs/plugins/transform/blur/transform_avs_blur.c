@@ -34,10 +34,6 @@
 #include <sys/mman.h>
 #include <math.h>
 
-#ifdef __OPENMP
-#include <omp.h>
-#endif
-
 #include <libvisual/libvisual.h>
 
 #include "avs_common.h"
@@ -174,19 +170,33 @@ int lv_blur_palette (VisPluginData *plugin, VisPalette *pal, VisAudio *audio)
 	return 0;
 }
 
+typedef struct {
+    BlurPrivate *priv;
+    LVAVSPipeline *pipeline;
+    int w, h;
+} BlurSlice;
+
+static void blur_slice (void *data, int this_thread, int max_threads)
+{
+    BlurSlice *slice = data;
+    LVAVSPipeline *pipeline = slice->pipeline;
+
+    smp_render(this_thread, max_threads, slice->priv, pipeline->audiodata, pipeline->isBeat,
+            pipeline->framebuffer, pipeline->fbout, slice->w, slice->h);
+}
+
 int lv_blur_video (VisPluginData *plugin, VisVideo *video, VisAudio *audio)
 {
 	BlurPrivate *priv = visual_object_get_private (VISUAL_OBJECT (plugin));
-    	uint8_t isBeat = priv->pipeline->isBeat;
-#ifdef __OPENMP
-#pragma omp parallel 
-	int i = 0, num_threads = omp_get_num_threads();
-	#pragma omp for
-#else
-    int i = 0, num_threads = 1;
-#endif
-    for(i = num_threads - 1; i>=0; i--)
-		smp_render(i, num_threads, priv, priv->pipeline->audiodata, priv->pipeline->isBeat, priv->pipeline->framebuffer, priv->pipeline->fbout, video->width, video->height);
+    BlurSlice slice;
+
+    slice.priv = priv;
+    slice.pipeline = priv->pipeline;
+    slice.w = video->width;
+    slice.h = video->height;
+
+    lvavs_pipeline_run_slices(priv->pipeline, blur_slice, &slice);
+
 	priv->pipeline->swap = 1;
 	return 0;
 }
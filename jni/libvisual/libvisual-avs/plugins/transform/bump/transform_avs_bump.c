@@ -141,6 +141,8 @@ printf("---------------------\n");
     visual_param_container_add_many (paramcontainer, params);
 
     priv->ctx = avs_runnable_context_new();
+    avs_runnable_context_set_cache(priv->ctx, priv->pipeline->codecache);
+    avs_runnable_context_set_counter(priv->ctx, &priv->pipeline->script_executions);
     priv->vm = avs_runnable_variable_manager_new();
 
     avs_runnable_variable_bind(priv->vm, "x", &priv->var_x);
@@ -283,7 +285,7 @@ int bump_render(BumpPrivate *priv, float visdata[2][2][1024], int isBeat, int *f
 
     if (isBeat&0x80000000) return 0;
 
-    int *depthbuffer = !priv->buffern ? framebuffer : visual_video_get_pixels(priv->pipeline->buffers[priv->buffern - 1]);
+    int *depthbuffer = !priv->buffern ? framebuffer : visual_video_get_pixels(lvavs_pipeline_get_buffer(priv->pipeline, priv->buffern - 1));
     if (!depthbuffer) return 0;
 
     curbuf = (depthbuffer==framebuffer);
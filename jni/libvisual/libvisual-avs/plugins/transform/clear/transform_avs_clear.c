@@ -141,6 +141,8 @@ int lv_clear_init (VisPluginData *plugin)
 	visual_param_entry_default_set_integer(entry, 35);
 */
 	priv->ctx = avs_runnable_context_new();
+	avs_runnable_context_set_cache(priv->ctx, priv->pipeline->codecache);
+	avs_runnable_context_set_counter(priv->ctx, &priv->pipeline->script_executions);
 	priv->vm = avs_runnable_variable_manager_new();
 
 	avs_runnable_variable_bind(priv->vm, "clear", &priv->clear);
@@ -33,7 +33,6 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <math.h>
-#include <omp.h>
 
 #include <libvisual/libvisual.h>
 
@@ -43,6 +42,9 @@
 
 AvsNumber PI = M_PI;
 
+/* Largest grid row, run through the pixel code at once */
+#define TRANS_BATCH_LANES 256
+
 typedef enum trans_runnable TransRunnable;
 
 enum trans_runnable {
@@ -60,11 +62,26 @@ typedef struct {
     AvsRunnable *runnable[4];
     AvsNumber var_d, var_b, var_r, var_x, var_y, var_w, var_h, var_alpha;
 
+    /* Per vertex values of the pixel code */
+    AvsRunnableBatch *batch;
+    AvsNumber lane_d[TRANS_BATCH_LANES], lane_r[TRANS_BATCH_LANES];
+    AvsNumber lane_x[TRANS_BATCH_LANES], lane_y[TRANS_BATCH_LANES];
+    AvsNumber lane_alpha[TRANS_BATCH_LANES];
+
+    /* Vertices of the grid, shared with equal elements when the pixel code
+     * only depends on its variables, followed by their values after it ran */
+    LVAVSPipelineTable *grid;
+    unsigned char *grid_key;
+    int grid_keysize;
+    char *pixel_code;
+
+    /* Interpolation rows, one per slice */
     int *m_tab;
     int *m_wmul;
 
     int32_t m_lastw, m_lasth;
     int32_t m_lastxres, m_lastyres, m_xres, m_yres;
+    int32_t m_lastthreads;
 
     int32_t buffern;
     int32_t preset;
@@ -151,6 +168,25 @@ static int trans_load_runnable(DMovementPrivate *priv, TransRunnable runnable, c
     avs_runnable_set_variable_manager(obj, priv->vm);
     priv->runnable[runnable] = obj;
     avs_runnable_compile(obj, (unsigned char *)buf, strlen(buf));
+
+    if (runnable == TRANS_RUNNABLE_PIXEL) {
+        if (priv->batch != NULL)
+            visual_object_unref(VISUAL_OBJECT(priv->batch));
+
+        if (priv->pixel_code != NULL)
+            visual_mem_free(priv->pixel_code);
+
+        priv->pixel_code = strdup(buf);
+
+        priv->batch = avs_runnable_batch_new(obj, TRANS_BATCH_LANES);
+
+        avs_runnable_batch_bind(priv->batch, "d", priv->lane_d, AvsRunnableBatchInput | AvsRunnableBatchOutput);
+        avs_runnable_batch_bind(priv->batch, "r", priv->lane_r, AvsRunnableBatchInput | AvsRunnableBatchOutput);
+        avs_runnable_batch_bind(priv->batch, "x", priv->lane_x, AvsRunnableBatchInput | AvsRunnableBatchOutput);
+        avs_runnable_batch_bind(priv->batch, "y", priv->lane_y, AvsRunnableBatchInput | AvsRunnableBatchOutput);
+        avs_runnable_batch_bind(priv->batch, "alpha", priv->lane_alpha, AvsRunnableBatchOutput);
+    }
+
     return 0;
 }
 
@@ -193,6 +229,8 @@ int lv_dmovement_init (VisPluginData *plugin)
 	visual_param_container_add_many (paramcontainer, params);
 
     priv->ctx = avs_runnable_context_new();
+    avs_runnable_context_set_cache(priv->ctx, priv->pipeline->codecache);
+    avs_runnable_context_set_counter(priv->ctx, &priv->pipeline->script_executions);
     priv->vm = avs_runnable_variable_manager_new();
 
     avs_runnable_variable_bind(priv->vm, "d", &priv->var_d);
@@ -211,6 +249,24 @@ int lv_dmovement_cleanup (VisPluginData *plugin)
 {
 	DMovementPrivate *priv = visual_object_get_private (VISUAL_OBJECT (plugin));
 
+    if (priv->batch != NULL)
+        visual_object_unref(VISUAL_OBJECT(priv->batch));
+
+    if (priv->grid != NULL)
+        visual_object_unref(VISUAL_OBJECT(priv->grid));
+
+    if (priv->grid_key != NULL)
+        visual_mem_free(priv->grid_key);
+
+    if (priv->pixel_code != NULL)
+        visual_mem_free(priv->pixel_code);
+
+    if (priv->m_tab != NULL)
+        visual_mem_free(priv->m_tab);
+
+    if (priv->m_wmul != NULL)
+        visual_mem_free(priv->m_wmul);
+
 	visual_mem_free (priv);
 
 	return 0;
@@ -283,9 +339,9 @@ int lv_dmovement_events (VisPluginData *plugin, VisEventQueue *events)
                 else if (visual_param_entry_is (param, "rectcoords"))
                     priv->rectcoords = visual_param_entry_get_integer(param);
                 else if (visual_param_entry_is (param, "xres"))
-                    priv->xres = visual_param_entry_get_integer(param);
+                    priv->m_xres = visual_param_entry_get_integer(param);
                 else if (visual_param_entry_is (param, "yres"))
-                    priv->yres = visual_param_entry_get_integer(param);
+                    priv->m_yres = visual_param_entry_get_integer(param);
                 else if (visual_param_entry_is (param, "blend"))
                     priv->blend = visual_param_entry_get_integer(param);
                 else if (visual_param_entry_is (param, "wrap"))
@@ -314,32 +370,47 @@ int lv_dmovement_palette (VisPluginData *plugin, VisPalette *pal, VisAudio *audi
 	return 0;
 }
 
+typedef struct {
+    DMovementPrivate *priv;
+    void *visdata;
+    int isBeat;
+    int *framebuffer;
+    int *fbout;
+    int w, h;
+} DMovementSlice;
+
+static void dmovement_slice (void *data, int this_thread, int max_threads)
+{
+    DMovementSlice *slice = data;
+
+    trans_render(slice->priv, this_thread, max_threads, slice->visdata, slice->isBeat,
+            slice->framebuffer, slice->fbout, slice->w, slice->h);
+}
+
 int lv_dmovement_video (VisPluginData *plugin, VisVideo *video, VisAudio *audio)
 {
 	DMovementPrivate *priv = visual_object_get_private (VISUAL_OBJECT (plugin));
+    DMovementSlice slice;
     uint8_t isBeat = priv->pipeline->isBeat;
-    int max_threads = 4;
     int w = video->width, h = video->height;
     void *visdata = priv->pipeline->audiodata;
     int *framebuffer = priv->pipeline->framebuffer;
     int *fbout = priv->pipeline->fbout;
-    int this_thread = 0;
-
 
-#pragma omp parallel
-{
-    max_threads = omp_get_num_threads();
-}
-    trans_begin(priv, max_threads, visdata, isBeat, framebuffer, fbout, w, h);
+    trans_begin(priv, lvavs_pipeline_get_threads(priv->pipeline), visdata, isBeat, framebuffer, fbout, w, h);
     //if(!isBeat)
     //    return 0;
 
-#pragma omp parallel
-{
-#pragma omp for private(this_thread)
-    for( this_thread = max_threads - 1; this_thread>=0; this_thread--)
-        trans_render(priv, this_thread, max_threads, visdata, isBeat, framebuffer,fbout, w, h);
-}
+    slice.priv = priv;
+    slice.visdata = visdata;
+    slice.isBeat = isBeat;
+    slice.framebuffer = framebuffer;
+    slice.fbout = fbout;
+    slice.w = w;
+    slice.h = h;
+
+    lvavs_pipeline_run_slices(priv->pipeline, dmovement_slice, &slice);
+
     priv->pipeline->swap = !priv->__nomove;
 
     return 0;
@@ -348,6 +419,179 @@ int lv_dmovement_video (VisPluginData *plugin, VisVideo *video, VisAudio *audio)
 ///////////////////////////////////////
 
 
+/* Runs the pixel code over the grid, a row at a time */
+static void trans_fill_grid(DMovementPrivate *priv, int *tabptr, int w, int h)
+{
+  int x;
+  int y;
+
+  double xsc=2.0/w,ysc=2.0/h;
+  double dw2=((double)w*32768.0);
+  double dh2=((double)h*32768.0);
+  double max_screen_d=sqrt((double)(w*w+h*h))*0.5;
+  
+  double divmax_d=1.0/max_screen_d;
+
+  max_screen_d *= 65536.0;
+
+  int yc_pos, yc_dpos, xc_pos, xc_dpos;
+  yc_pos=0;
+  xc_dpos = (w<<16)/(priv->xres-1);
+  yc_dpos = (h<<16)/(priv->yres-1);
+  for (y = 0; y < priv->yres; y ++)
+  {
+    xc_pos=0;
+    for (x = 0; x < priv->xres; x ++)
+    {
+      double xd,yd;
+      
+      xd=((double)xc_pos-dw2)*(1.0/65536.0);
+      yd=((double)yc_pos-dh2)*(1.0/65536.0);
+
+      xc_pos+=xc_dpos;
+
+      priv->lane_x[x]=xd*xsc;
+      priv->lane_y[x]=yd*ysc;
+      priv->lane_d[x]=sqrt(xd*xd+yd*yd)*divmax_d;
+      priv->lane_r[x]=atan2(yd,xd) + M_PI*0.5;
+    }
+
+    avs_runnable_batch_execute(priv->batch, priv->xres);
+
+    for (x = 0; x < priv->xres; x ++)
+    {
+      int tmp1,tmp2;
+      if (!priv->__rectcoords)
+      {
+        double var_d = priv->lane_d[x] * max_screen_d;
+        double var_r = priv->lane_r[x] - M_PI*0.5;
+        tmp1=(int) (dw2 + cos(var_r) * var_d);
+        tmp2=(int) (dh2 + sin(var_r) * var_d);
+      }
+      else
+      {
+        tmp1=(int) ((priv->lane_x[x]+1.0)*dw2);
+        tmp2=(int) ((priv->lane_y[x]+1.0)*dh2);
+      }
+      if (!priv->__wrap)
+      {
+        if (tmp1 < 0) tmp1=0;
+        if (tmp1 > priv->w_adj) tmp1=priv->w_adj;
+        if (tmp2 < 0) tmp2=0;
+        if (tmp2 > priv->h_adj) tmp2=priv->h_adj;
+      }
+      *tabptr++ = tmp1;
+      *tabptr++ = tmp2;
+      double va=priv->lane_alpha[x];
+      if (va < 0.0) va=0.0;
+      else if (va > 1.0) va=1.0;
+      int a=(int)(va*255.0*65536.0);
+      *tabptr++ = a;
+    }
+    yc_pos+=yc_dpos;
+  }
+}
+
+/* The grid depends on the geometry, the pixel code and the values its
+ * variables hold before it runs; d, r, x and y are set per vertex */
+typedef struct {
+    int32_t w, h, xres, yres;
+    int32_t rectcoords, wrap, subpixel;
+    int32_t ninputs;
+} DMovementGridKey;
+
+static int trans_is_vertex_variable(DMovementPrivate *priv, AvsRunnableVariable *var)
+{
+    return var->value == &priv->var_d || var->value == &priv->var_r ||
+        var->value == &priv->var_x || var->value == &priv->var_y;
+}
+
+/* Pure pixel code that starts out with the same values computes the same
+ * grid and leaves its variables with the same values, so the grid is only
+ * computed again when one of them changes, and just once for equal elements */
+static void trans_update_grid(DMovementPrivate *priv, int w, int h)
+{
+    AvsRunnable *pixel = priv->runnable[TRANS_RUNNABLE_PIXEL];
+    LVAVSPipelineTable *grid = priv->grid;
+    AvsRunnableVariable **refs;
+    DMovementGridKey *key;
+    AvsNumber *values, *post;
+    int points = priv->xres * priv->yres * 3;
+    int nrefs, codesize, keysize, size, i;
+
+    nrefs = avs_runnable_get_references(pixel, &refs);
+    codesize = priv->pixel_code != NULL ? strlen(priv->pixel_code) : 0;
+    keysize = sizeof(DMovementGridKey) + nrefs * sizeof(AvsNumber) + codesize;
+    size = points * sizeof(int) + nrefs * sizeof(AvsNumber);
+
+    if (keysize > priv->grid_keysize) {
+        if (priv->grid_key != NULL)
+            visual_mem_free(priv->grid_key);
+
+        priv->grid_key = visual_mem_malloc(keysize);
+        priv->grid_keysize = keysize;
+    }
+
+    key = (DMovementGridKey *) priv->grid_key;
+    memset(key, 0, sizeof(DMovementGridKey));
+    key->w = w;
+    key->h = h;
+    key->xres = priv->xres;
+    key->yres = priv->yres;
+    key->rectcoords = priv->__rectcoords;
+    key->wrap = priv->__wrap;
+    key->subpixel = priv->__subpixel;
+
+    values = (AvsNumber *) (key + 1);
+    for (i = 0; i < nrefs; i++) {
+        if (!trans_is_vertex_variable(priv, refs[i]))
+            values[key->ninputs++] = *refs[i]->value;
+    }
+
+    visual_mem_copy(values + key->ninputs, priv->pixel_code, codesize);
+    keysize = sizeof(DMovementGridKey) + key->ninputs * sizeof(AvsNumber) + codesize;
+
+    if (avs_runnable_is_pure(pixel)) {
+        if (grid == NULL || grid->keysize != keysize || memcmp(grid->key, key, keysize) != 0)
+            grid = lvavs_pipeline_table_find(priv->pipeline, key, keysize);
+
+        if (grid != NULL) {
+            if (grid != priv->grid) {
+                visual_object_ref(VISUAL_OBJECT(grid));
+
+                if (priv->grid != NULL)
+                    visual_object_unref(VISUAL_OBJECT(priv->grid));
+
+                priv->grid = grid;
+            }
+
+            post = (AvsNumber *) ((int *) grid->data + points);
+            for (i = 0; i < nrefs; i++)
+                *refs[i]->value = post[i];
+
+            return;
+        }
+
+        grid = lvavs_pipeline_table_new(priv->pipeline, key, keysize, size);
+    } else if (grid == NULL || grid->key != NULL || grid->size != size) {
+        /* Random numbers, audio or time, computed every frame */
+        grid = lvavs_pipeline_table_new(priv->pipeline, NULL, 0, size);
+    }
+
+    if (grid != priv->grid) {
+        if (priv->grid != NULL)
+            visual_object_unref(VISUAL_OBJECT(priv->grid));
+
+        priv->grid = grid;
+    }
+
+    trans_fill_grid(priv, grid->data, w, h);
+
+    post = (AvsNumber *) ((int *) grid->data + points);
+    for (i = 0; i < nrefs; i++)
+        post[i] = *refs[i]->value;
+}
+
 int trans_begin(DMovementPrivate *priv, int max_threads, char visdata[2][2][576], int isBeat, int *framebuffer, int *fbout, int w, int h)
 {
   priv->__subpixel=priv->subpixel;
@@ -366,12 +610,14 @@ int trans_begin(DMovementPrivate *priv, int max_threads, char visdata[2][2][576]
   if (priv->yres < 2) priv->yres=2;
   if (priv->yres > 256) priv->yres=256;
 
+  /* One interpolation row per slice */
   if (priv->m_lasth != h || priv->m_lastw != w || !priv->m_tab || !priv->m_wmul || 
-    priv->m_lastxres != priv->xres || priv->m_lastyres != priv->yres)
+    priv->m_lastxres != priv->xres || priv->m_lastyres != priv->yres || priv->m_lastthreads != max_threads)
   {
     int y;
     priv->m_lastxres = priv->xres;
     priv->m_lastyres = priv->yres;
+    priv->m_lastthreads = max_threads;
     priv->m_lastw=w;
     priv->m_lasth=h;
 
@@ -386,7 +632,7 @@ int trans_begin(DMovementPrivate *priv, int max_threads, char visdata[2][2][576]
     if (priv->m_tab) 
         visual_mem_free(priv->m_tab);
 
-    priv->m_tab= visual_mem_malloc((priv->xres*priv->yres*3 + (priv->xres*6 + 6)*max_threads)*sizeof(int));
+    priv->m_tab= visual_mem_malloc((priv->xres*6 + 6)*max_threads*sizeof(int));
   }
 
   if (!priv->__subpixel)
@@ -413,74 +659,7 @@ int trans_begin(DMovementPrivate *priv, int max_threads, char visdata[2][2][576]
   if (isBeat)
     trans_run_runnable(priv, TRANS_RUNNABLE_BEAT);
 
-  {
-    int x;
-    int y;
-    int *tabptr=priv->m_tab;
-
-    double xsc=2.0/w,ysc=2.0/h;
-    double dw2=((double)w*32768.0);
-    double dh2=((double)h*32768.0);
-    double max_screen_d=sqrt((double)(w*w+h*h))*0.5;
-    
-    double divmax_d=1.0/max_screen_d;
-
-    max_screen_d *= 65536.0;
-
-    int yc_pos, yc_dpos, xc_pos, xc_dpos;
-    yc_pos=0;
-    xc_dpos = (w<<16)/(priv->xres-1);
-    yc_dpos = (h<<16)/(priv->yres-1);
-    for (y = 0; y < priv->yres; y ++)
-    {
-      xc_pos=0;
-      for (x = 0; x < priv->xres; x ++)
-      {
-        double xd,yd;
-        
-        xd=((double)xc_pos-dw2)*(1.0/65536.0);
-        yd=((double)yc_pos-dh2)*(1.0/65536.0);
-
-        xc_pos+=xc_dpos;
-
-        priv->var_x=xd*xsc;
-        priv->var_y=yd*ysc;
-        priv->var_d=sqrt(xd*xd+yd*yd)*divmax_d;
-        priv->var_r=atan2(yd,xd) + M_PI*0.5;
-
-        trans_run_runnable(priv, TRANS_RUNNABLE_PIXEL);
-
-        int tmp1,tmp2;
-        if (!priv->__rectcoords)
-        {
-          priv->var_d *= max_screen_d;
-          priv->var_r -= M_PI*0.5;
-          tmp1=(int) (dw2 + cos(priv->var_r) * priv->var_d);
-          tmp2=(int) (dh2 + sin(priv->var_r) * priv->var_d);
-        }
-        else
-        {
-          tmp1=(int) ((priv->var_x+1.0)*dw2);
-          tmp2=(int) ((priv->var_y+1.0)*dh2);
-        }
-        if (!priv->__wrap)
-        {
-          if (tmp1 < 0) tmp1=0;
-          if (tmp1 > priv->w_adj) tmp1=priv->w_adj;
-          if (tmp2 < 0) tmp2=0;
-          if (tmp2 > priv->h_adj) tmp2=priv->h_adj;
-        }
-        *tabptr++ = tmp1;
-        *tabptr++ = tmp2;
-        double va=priv->var_alpha;
-        if (va < 0.0) va=0.0;
-        else if (va > 1.0) va=1.0;
-        int a=(int)(va*255.0*65536.0);
-        *tabptr++ = a;
-      }
-      yc_pos+=yc_dpos;
-    }
-  }
+  trans_update_grid(priv, w, h);
 
   return max_threads;
 }
@@ -508,8 +687,8 @@ int trans_render(DMovementPrivate *priv, int this_thread, int max_threads, char
 
   {
     LVAVSPipeline *pipeline = priv->pipeline;
-    int *interptab=priv->m_tab+priv->xres*priv->yres*3 + this_thread * (priv->xres*6+6);
-    int *rdtab=priv->m_tab;
+    int *interptab=priv->m_tab + this_thread * (priv->xres*6+6);
+    int *rdtab=priv->grid->data;
     int *in=(int *)fbin;
     int *blendin=(int *)framebuffer;
     int *out=(int *)fbout;
@@ -33,7 +33,6 @@
 #include <string.h>
 #include <sys/mman.h>
 #include <math.h>
-#include <omp.h>
 
 #include <libvisual/libvisual.h>
 
@@ -74,6 +73,13 @@ static t_reffect *radial_effects[REFFECT_MAX-REFFECT_MIN+1]=
   NULL/*22*/, NULL/*23*/,
 };
 
+/* Everything besides the code that goes into a table */
+typedef struct {
+    int32_t w, h, effect, subpixel;
+    int32_t rectangular, wrap;
+    int32_t codesize;
+} MovementTableKey;
+
 typedef struct {
     LVAVSPipeline *pipeline;
     AvsRunnableContext *ctx;
@@ -86,11 +92,16 @@ typedef struct {
     int *tab;
     int width, height;
 
+    /* The table, shared with elements that have the same key, and what it was made from */
+    LVAVSPipelineTable *trans_table;
+    MovementTableKey trans_key;
+    char *trans_code;
+    char *runnable_code;
+
     int *trans_tab, trans_tab_w, trans_tab_h, trans_tab_subpixel;
     int tab_w, tab_h, tab_subpixel;
     int trans_effect;
     char *effect_exp;
-    int effect_exp_ch;
     int effect, blend;
     int sourcemapped;
     int rectangular;
@@ -166,14 +177,23 @@ int lv_movement_events (VisPluginData *plugin, VisEventQueue *events);
 int lv_movement_palette (VisPluginData *plugin, VisPalette *pal, VisAudio *audio);
 int lv_movement_video (VisPluginData *plugin, VisVideo *video, VisAudio *audio);
 
-static void trans_generate_blend_table(MovementPrivate *priv);
-
 VISUAL_PLUGIN_API_VERSION_VALIDATOR
 
 static int load_runnable(MovementPrivate *priv, char *buf) {
-        AvsRunnable *obj = avs_runnable_new(priv->ctx);
+        AvsRunnable *obj;
+
+        if (priv->runnable != NULL && strcmp(priv->runnable_code, buf) == 0)
+            return 0;
+
+        if (priv->runnable != NULL) {
+            visual_object_unref(VISUAL_OBJECT(priv->runnable));
+            visual_mem_free(priv->runnable_code);
+        }
+
+        obj = avs_runnable_new(priv->ctx);
         avs_runnable_set_variable_manager(obj, priv->vm);
         priv->runnable = obj;
+        priv->runnable_code = strdup(buf);
         avs_runnable_compile(obj, (unsigned char *)buf, strlen(buf));
         return 0;
 }
@@ -241,13 +261,15 @@ int lv_movement_init (VisPluginData *plugin)
     priv->vm = avs_runnable_variable_manager_new();
     avs_runnable_variable_bind(priv->vm, "d", &priv->d);
     avs_runnable_variable_bind(priv->vm, "r", &priv->r);
-    avs_runnable_variable_bind(priv->vm, "x", &priv->x);
-    avs_runnable_variable_bind(priv->vm, "y", &priv->y);
+    avs_runnable_variable_bind(priv->vm, "x", &priv->px);
+    avs_runnable_variable_bind(priv->vm, "y", &priv->py);
     avs_runnable_variable_bind(priv->vm, "sw", &priv->sw);
     avs_runnable_variable_bind(priv->vm, "sh", &priv->sh);
 
     priv->pipeline = (LVAVSPipeline *)visual_object_get_private(VISUAL_OBJECT(plugin));
     visual_object_ref(VISUAL_OBJECT(priv->pipeline));
+    avs_runnable_context_set_cache(priv->ctx, priv->pipeline->codecache);
+    avs_runnable_context_set_counter(priv->ctx, &priv->pipeline->script_executions);
 
     visual_object_set_private (VISUAL_OBJECT (plugin), priv);
 
@@ -268,6 +290,17 @@ int lv_movement_cleanup (VisPluginData *plugin)
     if(priv->effect_exp)
         visual_mem_free(priv->effect_exp);
 
+    if (priv->trans_table != NULL)
+        visual_object_unref(VISUAL_OBJECT(priv->trans_table));
+
+    if (priv->trans_code != NULL)
+        visual_mem_free(priv->trans_code);
+
+    if (priv->runnable != NULL) {
+        visual_object_unref(VISUAL_OBJECT(priv->runnable));
+        visual_mem_free(priv->runnable_code);
+    }
+
     visual_mem_free (priv);
 
     return 0;
@@ -308,6 +341,9 @@ int lv_movement_events (VisPluginData *plugin, VisEventQueue *events)
                 else if (visual_param_entry_is (param, "wrap"))
                     priv->wrap = visual_param_entry_get_integer (param);
                 else if (visual_param_entry_is (param, "code"))  {
+                    if (priv->effect_exp != NULL)
+                        visual_mem_free(priv->effect_exp);
+
                     priv->effect_exp = strdup(visual_param_entry_get_string(param));
                     load_runnable(priv, priv->effect_exp);
 		}
@@ -331,64 +367,127 @@ int smp_begin(MovementPrivate *priv, int max_threads, float visdata[2][2][1024],
 int smp_finish(MovementPrivate *priv, float visdata[2][2][1024], int isBeat, int *framebuffer, int *fbout, int w, int h);
 int smp_render(MovementPrivate *priv, int this_thread, int max_threads, float visdata[2][2][1024], int isBeat, int *framebuffer, int *fbout, int w, int h);
 
-void trans_generate_blend_table(MovementPrivate *priv)
+typedef struct {
+    MovementPrivate *priv;
+    void *visdata;
+    int isBeat;
+    int *framebuffer;
+    int *fbout;
+    int w, h;
+} MovementSlice;
+
+static void movement_slice (void *data, int this_thread, int max_threads)
 {
-    int i,j;
-
-    for (j=0; j < 256; j++)
-        for (i=0; i < 256; i++)
-            priv->pipeline->blendtable[i][j] = (unsigned char)((i / 255.0) * (float)j);
+    MovementSlice *slice = data;
 
+    smp_render(slice->priv, this_thread, max_threads, slice->visdata, slice->isBeat,
+            slice->framebuffer, slice->fbout, slice->w, slice->h);
 }
 
 int lv_movement_video (VisPluginData *plugin, VisVideo *video, VisAudio *audio)
 {
     MovementPrivate *priv = visual_object_get_private (VISUAL_OBJECT (plugin));
+    MovementSlice slice;
     int *framebuffer = priv->pipeline->framebuffer;// = visual_video_get_pixels (video);
     int *fbout = priv->pipeline->fbout;
-    uint8_t *vidbuf, *vidoutbuf;
     int isBeat = priv->pipeline->isBeat;
-    int i;
     int w = video->width, h = video->height;
     void *visdata = priv->pipeline->audiodata;
-    trans_generate_blend_table(priv);
-    int this_thread = 0, max_threads = 1;
-
-    trans_generate_blend_table(priv);
 
-#pragma omp parallel
-{
-    max_threads = omp_get_num_threads();
-}
-    smp_begin(priv, max_threads, visdata, isBeat, framebuffer, fbout, w, h);
+    smp_begin(priv, lvavs_pipeline_get_threads(priv->pipeline), visdata, isBeat, framebuffer, fbout, w, h);
     if(isBeat & 0x80000000) return 0;
 
-#pragma omp parallel for
-    for(this_thread = omp_get_num_threads() - 1; this_thread >= 0; this_thread--) {
-        smp_render(priv, this_thread, max_threads, visdata, isBeat, framebuffer, fbout, w, h);
-    }
+    slice.priv = priv;
+    slice.visdata = visdata;
+    slice.isBeat = isBeat;
+    slice.framebuffer = framebuffer;
+    slice.fbout = fbout;
+    slice.w = w;
+    slice.h = h;
+
+    lvavs_pipeline_run_slices(priv->pipeline, movement_slice, &slice);
+
     priv->pipeline->swap = smp_finish(priv, visdata,isBeat,framebuffer,fbout,w,h);
     return VISUAL_OK;
 }
 
+/* Switches to the table for key, returns TRUE when it still has to be filled in */
+static int acquire_table(MovementPrivate *priv, MovementTableKey *key, char *code, int uses_eval)
+{
+    LVAVSPipelineTable *table = NULL;
+    unsigned char *keydata;
+    int keysize = sizeof(MovementTableKey) + key->codesize;
+    int shared;
+
+    priv->trans_key = *key;
+    if (priv->trans_code != NULL)
+        visual_mem_free(priv->trans_code);
+    priv->trans_code = strdup(code);
+
+    if (uses_eval)
+        load_runnable(priv, code);
+
+    shared = key->effect != 1 && (!uses_eval || avs_runnable_is_pure(priv->runnable));
+
+    keydata = visual_mem_malloc(keysize);
+    visual_mem_copy(keydata, key, sizeof(MovementTableKey));
+    visual_mem_copy(keydata + sizeof(MovementTableKey), code, key->codesize);
+
+    if (shared)
+        table = lvavs_pipeline_table_find(priv->pipeline, keydata, keysize);
+
+    if (table != NULL)
+        visual_object_ref(VISUAL_OBJECT(table));
+
+    if (priv->trans_table != NULL)
+        visual_object_unref(VISUAL_OBJECT(priv->trans_table));
+
+    priv->trans_table = table != NULL ? table :
+        lvavs_pipeline_table_new(priv->pipeline, shared ? keydata : NULL, keysize, key->w*key->h*sizeof(int));
+
+    visual_mem_free(keydata);
+
+    priv->trans_tab_w = key->w;
+    priv->trans_tab_h = key->h;
+    priv->trans_tab = priv->trans_table->data;
+    priv->trans_effect = key->effect;
+    priv->trans_tab_subpixel = key->subpixel;
+
+    return table == NULL;
+}
+
 int smp_begin(MovementPrivate *priv, int max_threads, float visdata[2][2][1024], int isBeat, int *framebuffer, int *fbout, int w, int h)
 {
+  MovementTableKey key;
+  int uses_eval;
+  char *code;
+
   if (!priv->effect) return 0;
 
-  if (!priv->trans_tab || priv->trans_tab_w != w || priv->trans_tab_h != h || priv->effect != priv->trans_effect || 
-       priv->effect_exp_ch)
+  /* The table only changes with the settings, it's made again when one of
+   * them changes and taken from an element with the same settings if there is
+   * one.  Effect 1 and scripts that call rand() differ every time they're made. */
+  uses_eval = priv->effect == 32767 || effect_uses_eval(priv->effect);
+  code = !uses_eval ? "" : priv->effect == 32767 ? priv->effect_exp : __movement_descriptions[priv->effect].eval_desc;
+  if (code == NULL) code = "";
+
+  memset(&key, 0, sizeof(MovementTableKey));
+  key.w = w;
+  key.h = h;
+  key.effect = priv->effect;
+  key.subpixel = (priv->subpixel && w*h < (1<<22) &&
+                  ((priv->effect >= REFFECT_MIN && priv->effect <= REFFECT_MAX
+                  && priv->effect != 1 && priv->effect != 2 && priv->effect != 7
+                  )||priv->effect ==32767));
+  key.rectangular = priv->rectangular;
+  key.wrap = priv->wrap;
+  key.codesize = strlen(code);
+
+  if ((!priv->trans_table || memcmp(&key, &priv->trans_key, sizeof(MovementTableKey)) != 0 ||
+       strcmp(code, priv->trans_code) != 0) && acquire_table(priv, &key, code, uses_eval))
   {
     int p;
     int *transp,x;
-    //if (priv->trans_tab) visual_mem_free(priv->trans_tab); //GlobalFree(trans_tab);
-    priv->trans_tab_w=w; 
-    priv->trans_tab_h=h;
-    priv->trans_tab=visual_mem_malloc0(priv->trans_tab_w*priv->trans_tab_h*sizeof(int));
-    priv->trans_effect=priv->effect;
-    priv->trans_tab_subpixel=(priv->subpixel && priv->trans_tab_w*priv->trans_tab_h < (1<<22) &&
-                  ((priv->trans_effect >= REFFECT_MIN && priv->trans_effect <= REFFECT_MAX
-                  && priv->trans_effect != 1 && priv->trans_effect != 2 && priv->trans_effect != 7
-                  )||priv->trans_effect ==32767));
 
     /* generate trans_tab */
     transp=priv->trans_tab;
@@ -523,9 +622,8 @@ int smp_begin(MovementPrivate *priv, int max_threads, float visdata[2][2][1024],
 
       priv->pw = priv->width;
       priv->ph = priv->height;
-
-      char *t = priv->trans_effect == 32767 ? priv->effect_exp : __movement_descriptions[priv->trans_effect].eval_desc;
-      load_runnable(priv, t);
+      priv->sw = w;
+      priv->sh = h;
 
       if (1)         
       {
@@ -616,7 +714,6 @@ int smp_begin(MovementPrivate *priv, int max_threads, float visdata[2][2][1024],
           *transp++=x;
       }
     }
-    priv->effect_exp_ch=0;
   }
 
   if (!(isBeat & 0x80000000))
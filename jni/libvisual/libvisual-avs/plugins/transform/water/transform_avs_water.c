@@ -34,10 +34,6 @@
 #include <sys/mman.h>
 #include <math.h>
 
-#ifdef __OPENMP
-#include <omp.h>
-#endif
-
 #include <libvisual/libvisual.h>
 
 #include "avs_common.h"
@@ -174,9 +170,27 @@ int lv_water_palette (VisPluginData *plugin, VisPalette *pal, VisAudio *audio)
 #define _B(x) ((( x )) & 0xff0000)
 #define _RGB(r,g,b) (( r ) | (( g ) & 0xff00) | (( b ) & 0xff0000))
 
+typedef struct {
+    WaterPrivate *priv;
+    void *visdata;
+    int isBeat;
+    int *framebuffer;
+    int *fbout;
+    int w, h;
+} WaterSlice;
+
+static void water_slice (void *data, int this_thread, int max_threads)
+{
+    WaterSlice *slice = data;
+
+    trans_render(this_thread, max_threads, slice->priv, slice->visdata, slice->isBeat,
+            slice->framebuffer, slice->fbout, slice->w, slice->h);
+}
+
 int lv_water_video (VisPluginData *plugin, VisVideo *video, VisAudio *audio)
 {
     WaterPrivate *priv = visual_object_get_private (VISUAL_OBJECT (plugin));
+    WaterSlice slice;
     int8_t isBeat = priv->pipeline->isBeat;
     int w = video->width;
     int h = video->height;
@@ -190,17 +204,15 @@ int lv_water_video (VisPluginData *plugin, VisVideo *video, VisAudio *audio)
 
     if(isBeat & 0x80000000) return 0;
 
-#ifdef __OPENMP
-#   pragma omp parallel
-    int i = 0, num_threads = omp_get_num_threads();
+    slice.priv = priv;
+    slice.visdata = priv->pipeline->audiodata;
+    slice.isBeat = isBeat;
+    slice.framebuffer = framebuffer;
+    slice.fbout = fbout;
+    slice.w = w;
+    slice.h = h;
 
-    
-#   pragma omp for
-#else
-    int i = 0, num_threads = 1;
-#endif
-    for(i = num_threads - 1; i>=0; i--)
-       trans_render(i, num_threads, priv, priv->pipeline->audiodata, isBeat, framebuffer, fbout, w, h);
+    lvavs_pipeline_run_slices(priv->pipeline, water_slice, &slice);
 
     priv->pipeline->swap = !!priv->enabled;
     return 0;
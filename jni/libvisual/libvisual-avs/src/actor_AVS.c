@@ -38,6 +38,7 @@ typedef struct {
     LVAVSPipeline   *pipeline;  /* The LV AVS Render pipeline */
 
     int      needsnego; /* Pipeline out of sync, needs reneg ? */
+    int      threads;   /* Render threads, 0 is one per CPU */
 } AVSPrivate;
 
 int act_avs_init (VisPluginData *plugin);
@@ -147,6 +148,7 @@ int act_avs_init (VisPluginData *plugin)
     }
     priv->pipeline = lvavs_pipeline_new_from_preset (priv->lvtree);
 
+    lvavs_pipeline_set_threads (priv->pipeline, priv->threads);
     lvavs_pipeline_realize (priv->pipeline);
 
     priv->needsnego = TRUE;
@@ -166,6 +168,7 @@ int act_avs_init (VisPluginData *plugin)
         VISUAL_PARAM_LIST_ENTRY_INTEGER("outinvert", 0),
         VISUAL_PARAM_LIST_ENTRY_INTEGER("beat_render", 0),
         VISUAL_PARAM_LIST_ENTRY_INTEGER("beat_render_frames", 1),
+        VISUAL_PARAM_LIST_ENTRY_INTEGER("threads", 0),
         
         VISUAL_PARAM_LIST_END
     };
@@ -291,6 +294,11 @@ int act_avs_events (VisPluginData *plugin, VisEventQueue *events)
                     if(priv->pipeline != NULL)
                     priv->pipeline->beat_render_frames = visual_param_entry_get_integer(param);
                 }
+                if(visual_param_entry_is(param, "threads")) {
+                    priv->threads = visual_param_entry_get_integer(param);
+                    if(priv->pipeline != NULL)
+                    lvavs_pipeline_set_threads(priv->pipeline, priv->threads);
+                }
                 if(visual_param_entry_is (param, "blendmode")) {
                     
                     if(priv->pipeline != NULL)
@@ -313,7 +321,7 @@ int act_avs_events (VisPluginData *plugin, VisEventQueue *events)
 
 
                     if (filename != NULL)
-                        priv->lvtree = lvavs_preset_new_from_preset (filename);
+                        priv->lvtree = lvavs_preset_new_from_preset_cached (filename, NULL);
 
                     if(priv->pipeline != NULL) {
                         visual_object_unref(VISUAL_OBJECT(priv->pipeline));
@@ -321,6 +329,7 @@ int act_avs_events (VisPluginData *plugin, VisEventQueue *events)
                     }
                     priv->pipeline = lvavs_pipeline_new_from_preset (priv->lvtree);
 
+                    lvavs_pipeline_set_threads (priv->pipeline, priv->threads);
                     lvavs_pipeline_realize (priv->pipeline);
 
                     priv->needsnego = TRUE;
@@ -0,0 +1,86 @@
+/* Libvisual-AVS - Advanced visual studio for libvisual
+ *
+ * Copyright (C) 2005, 2006 Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * Authors: Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/* Compiles every preset in a directory, so the AVS actor can load them
+ * without parsing and compiling on the fly. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include <libvisual/libvisual.h>
+
+#include "lvavs_preset.h"
+
+#define PRESET_SUFFIX	".pip"
+
+static int has_suffix (const char *name, const char *suffix)
+{
+	size_t length = strlen (name);
+	size_t slength = strlen (suffix);
+
+	return length > slength && strcmp (name + length - slength, suffix) == 0;
+}
+
+int main (int argc, char *argv[])
+{
+	struct dirent *entry;
+	DIR *dir;
+	char path[4096];
+	int compiled = 0, failed = 0;
+
+	if (argc < 2 || argc > 3) {
+		fprintf (stderr, "Usage: %s <preset directory> [cache directory]\n", argv[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	visual_init (&argc, &argv);
+
+	if ((dir = opendir (argv[1])) == NULL) {
+		fprintf (stderr, "Can't open %s\n", argv[1]);
+
+		return EXIT_FAILURE;
+	}
+
+	while ((entry = readdir (dir)) != NULL) {
+		if (!has_suffix (entry->d_name, PRESET_SUFFIX))
+			continue;
+
+		snprintf (path, sizeof (path), "%s/%s", argv[1], entry->d_name);
+
+		if (lvavs_preset_cache_compile (path, argc == 3 ? argv[2] : NULL) == VISUAL_OK) {
+			compiled++;
+		} else {
+			fprintf (stderr, "Failed to compile %s\n", path);
+			failed++;
+		}
+	}
+
+	closedir (dir);
+
+	printf ("%d presets compiled, %d failed\n", compiled, failed);
+
+	visual_quit ();
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
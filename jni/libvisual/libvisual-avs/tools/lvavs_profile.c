@@ -0,0 +1,162 @@
+/* Libvisual-AVS - Advanced visual studio for libvisual
+ *
+ * Copyright (C) 2005, 2006 Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * Authors: Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+/* Runs every preset in a directory for a number of frames without a display,
+ * and writes what each element costs per frame as CSV on stdout.  The first
+ * frame, which sets up tables and runs init code, is left out.  There's no
+ * audio, so beats never happen. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+
+#include <libvisual/libvisual.h>
+
+#include "lvavs_preset.h"
+#include "lvavs_pipeline.h"
+
+#define PRESET_SUFFIX	".pip"
+
+static int has_suffix (const char *name, const char *suffix)
+{
+	size_t length = strlen (name);
+	size_t slength = strlen (suffix);
+
+	return length > slength && strcmp (name + length - slength, suffix) == 0;
+}
+
+static int profile_preset (const char *name, char *path, int frames, int width, int height)
+{
+	LVAVSPreset *preset;
+	LVAVSPipeline *pipeline;
+	LVAVSPipelineElementStats *stats;
+	VisVideo *video;
+	VisAudio *audio;
+	VisTimer *timer;
+	uint64_t usecs;
+	int count, i;
+
+	if ((preset = lvavs_preset_new_from_preset (path)) == NULL)
+		return -VISUAL_ERROR_GENERAL;
+
+	pipeline = lvavs_pipeline_new_from_preset (preset);
+	lvavs_pipeline_realize (pipeline);
+
+	video = visual_video_new_with_buffer (width, height, VISUAL_VIDEO_DEPTH_32BIT);
+	audio = visual_audio_new ();
+	timer = visual_timer_new ();
+
+	lvavs_pipeline_negotiate (pipeline, video);
+
+	lvavs_pipeline_run (pipeline, video, audio);
+	lvavs_pipeline_reset_stats (pipeline);
+
+	visual_timer_start (timer);
+
+	for (i = 0; i < frames; i++)
+		lvavs_pipeline_run (pipeline, video, audio);
+
+	usecs = visual_timer_elapsed_usecs (timer);
+
+	count = lvavs_pipeline_get_stats (pipeline, NULL, 0);
+	stats = visual_mem_new0 (LVAVSPipelineElementStats, count > 0 ? count : 1);
+	lvavs_pipeline_get_stats (pipeline, stats, count);
+
+	printf ("%s,frame,0,%d,%llu,,,,\n", name, frames, (unsigned long long) (usecs / frames));
+
+	for (i = 0; i < count; i++) {
+		int n = stats[i].frames > 0 ? stats[i].frames : 1;
+
+		printf ("%s,%s,%d,%d,%llu,%llu,%llu,%llu,%llu\n", name, stats[i].name, stats[i].depth, stats[i].frames,
+				(unsigned long long) (stats[i].total_usecs / n),
+				(unsigned long long) stats[i].min_usecs,
+				(unsigned long long) stats[i].max_usecs,
+				(unsigned long long) (stats[i].script_executions / n),
+				(unsigned long long) (stats[i].bytes_touched / n));
+	}
+
+	visual_mem_free (stats);
+	visual_timer_free (timer);
+
+	visual_object_unref (VISUAL_OBJECT (audio));
+	visual_object_unref (VISUAL_OBJECT (video));
+	visual_object_unref (VISUAL_OBJECT (pipeline));
+	visual_object_unref (VISUAL_OBJECT (preset));
+
+	return VISUAL_OK;
+}
+
+int main (int argc, char *argv[])
+{
+	struct dirent *entry;
+	DIR *dir;
+	char path[4096];
+	int frames = 100, width = 320, height = 240;
+	int failed = 0;
+
+	if (argc < 2 || argc > 5) {
+		fprintf (stderr, "Usage: %s <preset directory> [frames] [width] [height]\n", argv[0]);
+
+		return EXIT_FAILURE;
+	}
+
+	if (argc > 2)
+		frames = atoi (argv[2]);
+	if (argc > 3)
+		width = atoi (argv[3]);
+	if (argc > 4)
+		height = atoi (argv[4]);
+
+	if (frames <= 0 || width <= 0 || height <= 0) {
+		fprintf (stderr, "Frames and size must be positive\n");
+
+		return EXIT_FAILURE;
+	}
+
+	visual_init (&argc, &argv);
+
+	if ((dir = opendir (argv[1])) == NULL) {
+		fprintf (stderr, "Can't open %s\n", argv[1]);
+
+		return EXIT_FAILURE;
+	}
+
+	printf ("preset,element,depth,frames,avg_usecs,min_usecs,max_usecs,executions_per_frame,bytes_per_frame\n");
+
+	while ((entry = readdir (dir)) != NULL) {
+		if (!has_suffix (entry->d_name, PRESET_SUFFIX))
+			continue;
+
+		snprintf (path, sizeof (path), "%s/%s", argv[1], entry->d_name);
+
+		if (profile_preset (entry->d_name, path, frames, width, height) != VISUAL_OK) {
+			fprintf (stderr, "Failed to load %s\n", path);
+			failed++;
+		}
+	}
+
+	closedir (dir);
+
+	visual_quit ();
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
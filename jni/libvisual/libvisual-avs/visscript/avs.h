@@ -44,6 +44,7 @@ typedef float AvsNumber;
 #include "avs_parser.h"
 #include "avs_compiler.h"
 #include "avs_il_assembler.h"
+#include "avs_bytecode.h"
 #include "avs_runnable.h"
 #include "avs_functions.h"
 
@@ -0,0 +1,664 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include "avs.h"
+
+#define BYTECODE_MAGIC		0x43425356	/* "VSBC" */
+#define BYTECODE_BYTE_ORDER	0x01020304
+
+typedef struct _AvsBytecodeHeader {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	byte_order;
+	uint32_t	number_size;
+	uint32_t	variables;
+	uint32_t	registers;
+	uint32_t	instructions;
+	uint32_t	arguments;
+} BytecodeHeader;
+
+typedef struct _AvsBytecodeRegister {
+	uint32_t	type;
+	uint32_t	flags;
+	uint32_t	value;
+} BytecodeRegister;
+
+typedef struct _AvsBytecodeInstruction {
+	uint32_t	type;
+	uint32_t	reg[3];
+	uint32_t	ex[3];
+} BytecodeInstruction;
+
+/* Pointer to index map, open addressing */
+typedef struct _AvsBytecodeMap {
+	const void	**keys;
+	uint32_t	*values;
+	uint32_t	mask;
+	uint32_t	count;
+} BytecodeMap;
+
+typedef struct _AvsBytecodeBuffer {
+	unsigned char	*data;
+	unsigned int	length;
+	unsigned int	size;
+} BytecodeBuffer;
+
+static int code_cache_dtor(VisObject *object);
+
+/**
+ *	Hash a script source, FNV-1a.
+ *
+ *	@param data Source to hash.
+ *	@param length Length of source.
+ *
+ *	@return 32 bit hash of source.
+ */
+uint32_t avs_bytecode_hash(const unsigned char *data, unsigned int length)
+{
+	uint32_t hash = 2166136261u;
+	unsigned int i;
+
+	for (i = 0; i < length; i++)
+		hash = (hash ^ data[i]) * 16777619u;
+
+	return hash;
+}
+
+static void map_init(BytecodeMap *map, uint32_t capacity)
+{
+	uint32_t size = 16;
+
+	while (size < capacity * 2)
+		size <<= 1;
+
+	map->keys = calloc(size, sizeof(void *));
+	map->values = malloc(size * sizeof(uint32_t));
+	map->mask = size - 1;
+	map->count = 0;
+}
+
+static void map_cleanup(BytecodeMap *map)
+{
+	free(map->keys);
+	free(map->values);
+}
+
+/* Index of key, new keys get the next free index */
+static uint32_t map_insert(BytecodeMap *map, const void *key, int *created)
+{
+	uint32_t i = ((uintptr_t) key >> 4) * 2654435761u;
+
+	for (i &= map->mask; map->keys[i] != NULL; i = (i + 1) & map->mask) {
+		if (map->keys[i] == key) {
+			*created = FALSE;
+			return map->values[i];
+		}
+	}
+
+	map->keys[i] = key;
+	map->values[i] = map->count++;
+	*created = TRUE;
+
+	return map->values[i];
+}
+
+static uint32_t map_find(BytecodeMap *map, const void *key)
+{
+	uint32_t i = ((uintptr_t) key >> 4) * 2654435761u;
+
+	for (i &= map->mask; map->keys[i] != NULL; i = (i + 1) & map->mask) {
+		if (map->keys[i] == key)
+			return map->values[i];
+	}
+
+	return ~0u;
+}
+
+static void buffer_put(BytecodeBuffer *buf, const void *data, unsigned int size)
+{
+	if (buf->length + size > buf->size) {
+		while (buf->length + size > buf->size)
+			buf->size = buf->size ? buf->size * 2 : 1024;
+
+		buf->data = realloc(buf->data, buf->size);
+	}
+
+	memcpy(buf->data + buf->length, data, size);
+	buf->length += size;
+}
+
+static void buffer_put_word(BytecodeBuffer *buf, uint32_t word)
+{
+	buffer_put(buf, &word, sizeof(uint32_t));
+}
+
+/* Operands the cores expect to be there, by instruction type */
+static const unsigned char required_registers[ILInstructionCount] = {
+	[ILInstructionCall]		= 1,
+	[ILInstructionNegate]		= 2,
+	[ILInstructionAssign]		= 3,
+	[ILInstructionAdd]		= 3,
+	[ILInstructionSub]		= 3,
+	[ILInstructionMul]		= 3,
+	[ILInstructionDiv]		= 3,
+	[ILInstructionMod]		= 3,
+	[ILInstructionAnd]		= 3,
+	[ILInstructionOr]		= 3,
+	[ILInstructionLoopInit]		= 2,
+	[ILInstructionJumpTrue]		= 1,
+	[ILInstructionLoadReference]	= 2,
+	[ILInstructionStoreReference]	= 3,
+};
+
+static int register_count(ILInstruction *insn)
+{
+	switch (insn->type) {
+		case ILInstructionCall:
+			return 1;
+
+		default:
+			return 3;
+	}
+}
+
+/**
+ *	Encode the IL of the runnable compiled last.
+ *
+ *	The IL assembler keeps the IL tree of the runnable it finished last until
+ *	the next one is started, so this has to follow its compilation directly.
+ *
+ *	@param ctx IL Assembler context.
+ *	@param obj Runnable object the IL tree was compiled for.
+ *	@param code Location to store the newly allocated bytecode, free() it when done.
+ *	@param length Location to store the bytecode length.
+ *
+ *	@return VISUAL_OK on success, VISUAL_ERROR_GENERAL on error.
+ */
+int avs_bytecode_write(AvsILAssemblerContext *ctx, AvsRunnable *obj, unsigned char **code, unsigned int *length)
+{
+	BytecodeHeader header;
+	BytecodeMap insns, regs, vars;
+	BytecodeBuffer buf;
+	ILInstruction *insn;
+	ILRegister **reglist;
+	AvsRunnableVariable **varlist;
+	uint32_t ninsns = 0, nargs = 0, i, index;
+	int j, created;
+
+	visual_return_val_if_fail(ctx != NULL, VISUAL_ERROR_GENERAL);
+	visual_return_val_if_fail(code != NULL, VISUAL_ERROR_GENERAL);
+	visual_return_val_if_fail(length != NULL, VISUAL_ERROR_GENERAL);
+
+	for (insn = avs_il_tree_base(&ctx->tree); insn != NULL; insn = insn->next) {
+		ninsns++;
+
+		if (insn->type == ILInstructionCall)
+			nargs += insn->ex.call.argc;
+	}
+
+	map_init(&insns, ninsns);
+	map_init(&regs, ninsns * 3 + nargs);
+	map_init(&vars, ninsns * 3 + nargs);
+	reglist = malloc(sizeof(ILRegister *) * (ninsns * 3 + nargs + 1));
+	varlist = malloc(sizeof(AvsRunnableVariable *) * (ninsns * 3 + nargs + 1));
+
+	/* Number everything in program order */
+	for (insn = avs_il_tree_base(&ctx->tree); insn != NULL; insn = insn->next) {
+		ILRegister *used[3 + 256];
+		int nused = 0;
+
+		map_insert(&insns, insn, &created);
+
+		for (j = 0; j < register_count(insn); j++)
+			used[nused++] = insn->reg[j];
+
+		if (insn->type == ILInstructionCall) {
+			if (insn->ex.call.argc > 256 || (int) avs_builtin_function_index(insn->ex.call.call) < 0) {
+				avs_debug(print("bytecode: Can not encode call to %s", insn->ex.call.call->name));
+				goto fail;
+			}
+
+			for (j = 0; j < insn->ex.call.argc; j++)
+				used[nused++] = insn->ex.call.argv[j];
+		}
+
+		for (j = 0; j < nused; j++) {
+			if (used[j] == NULL)
+				continue;
+
+			index = map_insert(&regs, used[j], &created);
+			if (created)
+				reglist[index] = used[j];
+
+			if (created && used[j]->type == ILRegisterTypeVariable) {
+				index = map_insert(&vars, used[j]->value.variable, &created);
+				if (created)
+					varlist[index] = used[j]->value.variable;
+			}
+		}
+	}
+
+	memset(&buf, 0, sizeof(BytecodeBuffer));
+
+	header.magic = BYTECODE_MAGIC;
+	header.version = AVS_BYTECODE_VERSION;
+	header.byte_order = BYTECODE_BYTE_ORDER;
+	header.number_size = sizeof(AvsNumber);
+	header.variables = vars.count;
+	header.registers = regs.count;
+	header.instructions = ninsns;
+	header.arguments = nargs;
+	buffer_put(&buf, &header, sizeof(BytecodeHeader));
+
+	for (i = 0; i < vars.count; i++) {
+		static const unsigned char pad[4];
+		uint32_t namelen = strlen(varlist[i]->name);
+
+		buffer_put_word(&buf, namelen);
+		buffer_put(&buf, varlist[i]->name, namelen);
+		buffer_put(&buf, pad, -namelen & 3);
+	}
+
+	for (i = 0; i < regs.count; i++) {
+		BytecodeRegister breg;
+
+		breg.type = reglist[i]->type;
+		breg.flags = reglist[i]->flags;
+		if (reglist[i]->type == ILRegisterTypeVariable)
+			breg.value = map_find(&vars, reglist[i]->value.variable);
+		else
+			memcpy(&breg.value, &reglist[i]->value.constant, sizeof(AvsNumber));
+
+		buffer_put(&buf, &breg, sizeof(BytecodeRegister));
+	}
+
+	nargs = 0;
+	for (insn = avs_il_tree_base(&ctx->tree); insn != NULL; insn = insn->next) {
+		BytecodeInstruction binsn;
+
+		memset(&binsn, 0, sizeof(BytecodeInstruction));
+		binsn.type = insn->type;
+
+		for (j = 0; j < register_count(insn); j++)
+			binsn.reg[j] = insn->reg[j] != NULL ? map_find(&regs, insn->reg[j]) + 1 : 0;
+
+		switch (insn->type) {
+			case ILInstructionCall:
+				binsn.ex[0] = avs_builtin_function_index(insn->ex.call.call);
+				binsn.ex[1] = insn->ex.call.argc;
+				binsn.ex[2] = nargs;
+				nargs += insn->ex.call.argc;
+				break;
+
+			case ILInstructionLoop:
+			case ILInstructionJump:
+			case ILInstructionJumpTrue:
+				binsn.ex[0] = insn->ex.jmp.pointer != NULL ? map_find(&insns, insn->ex.jmp.pointer) + 1 : 0;
+				break;
+
+			default:
+				break;
+		}
+
+		buffer_put(&buf, &binsn, sizeof(BytecodeInstruction));
+	}
+
+	for (insn = avs_il_tree_base(&ctx->tree); insn != NULL; insn = insn->next) {
+		if (insn->type != ILInstructionCall)
+			continue;
+
+		for (j = 0; j < insn->ex.call.argc; j++)
+			buffer_put_word(&buf, map_find(&regs, insn->ex.call.argv[j]) + 1);
+	}
+
+	map_cleanup(&insns);
+	map_cleanup(&regs);
+	map_cleanup(&vars);
+	free(reglist);
+	free(varlist);
+
+	*code = buf.data;
+	*length = buf.length;
+
+	return VISUAL_OK;
+
+fail:
+	map_cleanup(&insns);
+	map_cleanup(&regs);
+	map_cleanup(&vars);
+	free(reglist);
+	free(varlist);
+
+	return VISUAL_ERROR_GENERAL;
+}
+
+static const void * read_section(const unsigned char *code, unsigned int length, unsigned int *offset, uint64_t size)
+{
+	const void *section = code + *offset;
+
+	if (size > length - *offset)
+		return NULL;
+
+	*offset += size;
+	return section;
+}
+
+static int check_register(const BytecodeHeader *header, uint32_t index)
+{
+	return index <= header->registers;
+}
+
+/* Operands have to hold a number, the cores read them unchecked */
+static int check_operand(const BytecodeHeader *header, const BytecodeRegister *bregs, uint32_t index)
+{
+	return index != 0 && index <= header->registers &&
+		(bregs[index - 1].type == ILRegisterTypeConstant || bregs[index - 1].type == ILRegisterTypeVariable);
+}
+
+/**
+ *	Load bytecode into a runnable object, in place of compiling its source.
+ *
+ *	@param ctx IL Assembler context.
+ *	@param obj Runnable object to load the code into.
+ *	@param code Bytecode written by avs_bytecode_write().
+ *	@param length Length of the bytecode.
+ *
+ *	@return VISUAL_OK on success, VISUAL_ERROR_GENERAL on invalid or outdated bytecode.
+ */
+int avs_bytecode_read(AvsILAssemblerContext *ctx, AvsRunnable *obj, const unsigned char *code, unsigned int length)
+{
+	BytecodeHeader header;
+	const BytecodeRegister *bregs;
+	const BytecodeInstruction *binsns;
+	const uint32_t *bargs;
+	const uint32_t **names;
+	AvsRunnableVariable **vars;
+	ILRegister **regs;
+	ILInstruction **insns;
+	unsigned int offset = sizeof(BytecodeHeader);
+	uint32_t i, depth = 0;
+	int j;
+
+	visual_return_val_if_fail(ctx != NULL, VISUAL_ERROR_GENERAL);
+	visual_return_val_if_fail(obj != NULL, VISUAL_ERROR_GENERAL);
+	visual_return_val_if_fail(code != NULL, VISUAL_ERROR_GENERAL);
+
+	if (length < sizeof(BytecodeHeader))
+		return VISUAL_ERROR_GENERAL;
+
+	memcpy(&header, code, sizeof(BytecodeHeader));
+	if (header.magic != BYTECODE_MAGIC || header.version != AVS_BYTECODE_VERSION ||
+			header.byte_order != BYTECODE_BYTE_ORDER || header.number_size != sizeof(AvsNumber)) {
+		avs_debug(print("bytecode: Version or format mismatch"));
+		return VISUAL_ERROR_GENERAL;
+	}
+
+	/* Everything is checked before the runnable is touched */
+	if (header.variables > length / sizeof(uint32_t))
+		goto corrupt;
+
+	names = malloc(sizeof(uint32_t *) * (header.variables + 1));
+	for (i = 0; i < header.variables; i++) {
+		names[i] = read_section(code, length, &offset, sizeof(uint32_t));
+
+		if (names[i] == NULL || read_section(code, length, &offset, ((uint64_t) *names[i] + 3) & ~3ull) == NULL) {
+			free(names);
+			goto corrupt;
+		}
+	}
+
+	bregs = read_section(code, length, &offset, (uint64_t) header.registers * sizeof(BytecodeRegister));
+	binsns = read_section(code, length, &offset, (uint64_t) header.instructions * sizeof(BytecodeInstruction));
+	bargs = read_section(code, length, &offset, (uint64_t) header.arguments * sizeof(uint32_t));
+	if (bregs == NULL || binsns == NULL || bargs == NULL)
+		goto corrupt_names;
+
+	for (i = 0; i < header.registers; i++) {
+		if (bregs[i].type == ILRegisterTypeVariable && bregs[i].value >= header.variables)
+			goto corrupt_names;
+	}
+
+	for (i = 0; i < header.arguments; i++) {
+		if (!check_operand(&header, bregs, bargs[i]))
+			goto corrupt_names;
+	}
+
+	for (i = 0; i < header.instructions; i++) {
+		if (binsns[i].type >= ILInstructionCount)
+			goto corrupt_names;
+
+		for (j = 0; j < 3; j++) {
+			if (!check_register(&header, binsns[i].reg[j]) ||
+					(j < required_registers[binsns[i].type] && !check_operand(&header, bregs, binsns[i].reg[j])))
+				goto corrupt_names;
+		}
+
+		switch (binsns[i].type) {
+			case ILInstructionCall:
+				if (binsns[i].ex[0] >= AVS_BUILTIN_FUNCTION_IF || binsns[i].ex[2] > header.arguments ||
+						binsns[i].ex[1] > header.arguments - binsns[i].ex[2])
+					goto corrupt_names;
+				break;
+
+			/* The compilers pair every Loop with the innermost open LoopInit */
+			case ILInstructionLoopInit:
+				depth++;
+				break;
+
+			case ILInstructionLoop:
+				if (depth == 0 || binsns[i].ex[0] > header.instructions)
+					goto corrupt_names;
+				depth--;
+				break;
+
+			/* Jump targets are followed when the code is linked */
+			case ILInstructionJump:
+			case ILInstructionJumpTrue:
+				if (binsns[i].ex[0] == 0 || binsns[i].ex[0] > header.instructions)
+					goto corrupt_names;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	if (depth != 0)
+		goto corrupt_names;
+
+	/* Variables are looked up or created by name, like the compiler does */
+	vars = malloc(sizeof(AvsRunnableVariable *) * (header.variables + 1));
+	for (i = 0; i < header.variables; i++) {
+		char *name = avs_blob_new(&obj->bm, *names[i] + 1);
+
+		memcpy(name, names[i] + 1, *names[i]);
+		name[*names[i]] = 0;
+
+		vars[i] = avs_runnable_variable_find(obj->variable_manager, name);
+		if (vars[i] == NULL)
+			vars[i] = avs_runnable_variable_create(obj->variable_manager, name, 0);
+	}
+
+	/* Rebuild the IL tree */
+	avs_il_runnable_init(ctx, obj);
+
+	regs = malloc(sizeof(ILRegister *) * (header.registers + 1));
+	regs[0] = NULL;
+	for (i = 0; i < header.registers; i++) {
+		ILRegister *reg = regs[i + 1] = avs_il_register_create();
+
+		reg->type = bregs[i].type;
+		reg->flags = bregs[i].flags;
+
+		if (bregs[i].type == ILRegisterTypeVariable)
+			reg->value.variable = vars[bregs[i].value];
+		else
+			memcpy(&reg->value.constant, &bregs[i].value, sizeof(AvsNumber));
+	}
+
+	insns = malloc(sizeof(ILInstruction *) * (header.instructions + 1));
+	insns[0] = NULL;
+	for (i = 0; i < header.instructions; i++)
+		insns[i + 1] = avs_il_instruction_create(ctx, obj);
+
+	for (i = 0; i < header.instructions; i++) {
+		ILInstruction *insn = insns[i + 1];
+
+		insn->type = binsns[i].type;
+
+		for (j = 0; j < 3; j++)
+			insn->reg[j] = regs[binsns[i].reg[j]];
+
+		switch (insn->type) {
+			case ILInstructionCall:
+				insn->ex.call.call = avs_builtin_function_lookup(binsns[i].ex[0]);
+				insn->ex.call.argc = binsns[i].ex[1];
+				insn->ex.call.argv = malloc(sizeof(ILRegister **) * insn->ex.call.argc);
+				for (j = 0; j < insn->ex.call.argc; j++)
+					insn->ex.call.argv[j] = regs[bargs[binsns[i].ex[2] + j]];
+				break;
+
+			case ILInstructionLoop:
+			case ILInstructionJump:
+			case ILInstructionJumpTrue:
+				insn->ex.jmp.pointer = insns[binsns[i].ex[0]];
+				break;
+
+			default:
+				break;
+		}
+
+		avs_il_tree_add(&ctx->tree, insn);
+	}
+
+	free(names);
+	free(vars);
+	free(regs);
+	free(insns);
+
+	/* Already optimized when it was written */
+	avs_il_core_compile(ctx->core, &ctx->tree, obj);
+
+	return VISUAL_OK;
+
+corrupt_names:
+	free(names);
+corrupt:
+	avs_debug(print("bytecode: Truncated or corrupt bytecode"));
+
+	return VISUAL_ERROR_GENERAL;
+}
+
+static int entry_compare(const void *a, const void *b)
+{
+	const AvsCodeCacheEntry *ea = a, *eb = b;
+
+	return ea->hash < eb->hash ? -1 : ea->hash > eb->hash;
+}
+
+/**
+ *	Find compiled code for a script source.
+ *
+ *	@param cache Code cache to search.
+ *	@param source Script source.
+ *	@param length Length of source.
+ *
+ *	@return Matching cache entry on success, NULL when the source is not cached.
+ */
+AvsCodeCacheEntry * avs_code_cache_lookup(AvsCodeCache *cache, const unsigned char *source, unsigned int length)
+{
+	AvsCodeCacheEntry key, *entry;
+	int i;
+
+	visual_return_val_if_fail(cache != NULL, NULL);
+
+	if (cache->count == 0)
+		return NULL;
+
+	if (!cache->sorted) {
+		qsort(cache->entries, cache->count, sizeof(AvsCodeCacheEntry), entry_compare);
+		cache->sorted = TRUE;
+	}
+
+	key.hash = avs_bytecode_hash(source, length);
+	entry = bsearch(&key, cache->entries, cache->count, sizeof(AvsCodeCacheEntry), entry_compare);
+	if (entry == NULL)
+		return NULL;
+
+	/* Back to the first entry of a run of equal hashes */
+	while (entry > cache->entries && entry[-1].hash == key.hash)
+		entry--;
+
+	for (i = entry - cache->entries; i < cache->count && cache->entries[i].hash == key.hash; i++) {
+		if (cache->entries[i].source_length == length &&
+				memcmp(cache->entries[i].source, source, length) == 0)
+			return &cache->entries[i];
+	}
+
+	return NULL;
+}
+
+/**
+ *	Add compiled code for a script source, neither is copied.
+ *
+ *	@param cache Code cache to add to.
+ *	@param source Script source.
+ *	@param source_length Length of source.
+ *	@param code Bytecode for source.
+ *	@param code_length Length of bytecode.
+ *
+ *	@return VISUAL_OK on success, VISUAL_ERROR_GENERAL on error.
+ */
+int avs_code_cache_add(AvsCodeCache *cache, const unsigned char *source, unsigned int source_length,
+		const unsigned char *code, unsigned int code_length)
+{
+	AvsCodeCacheEntry *entry;
+
+	visual_return_val_if_fail(cache != NULL, VISUAL_ERROR_GENERAL);
+
+	if ((cache->count & 63) == 0)
+		cache->entries = realloc(cache->entries, sizeof(AvsCodeCacheEntry) * (cache->count + 64));
+
+	entry = &cache->entries[cache->count++];
+	entry->hash = avs_bytecode_hash(source, source_length);
+	entry->source = source;
+	entry->source_length = source_length;
+	entry->code = code;
+	entry->code_length = code_length;
+
+	cache->sorted = FALSE;
+
+	return VISUAL_OK;
+}
+
+static int code_cache_dtor(VisObject *object)
+{
+	AvsCodeCache *cache = AVS_CODE_CACHE(object);
+
+	free(cache->entries);
+	cache->entries = NULL;
+
+	if (cache->owner != NULL)
+		visual_object_unref(cache->owner);
+
+	cache->owner = NULL;
+
+	return VISUAL_OK;
+}
+
+/**
+ *	Create a new, empty code cache.
+ *
+ *	@return Newly created code cache on success, NULL on failure.
+ */
+AvsCodeCache * avs_code_cache_new(void)
+{
+	AvsCodeCache *cache = visual_mem_new0(AvsCodeCache, 1);
+
+	visual_object_initialize(VISUAL_OBJECT(cache), TRUE, code_cache_dtor);
+
+	return cache;
+}
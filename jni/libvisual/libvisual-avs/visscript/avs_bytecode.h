@@ -0,0 +1,55 @@
+#ifndef _AVS_BYTECODE_H
+#define _AVS_BYTECODE_H 1
+
+#define AVS_CODE_CACHE(obj)	(VISUAL_CHECK_CAST ((obj), AvsCodeCache))
+
+/* Bumped whenever the IL or its encoding changes, older code is rejected */
+#define AVS_BYTECODE_VERSION	1
+
+struct _AvsCodeCache;
+typedef struct _AvsCodeCache AvsCodeCache;
+struct _AvsCodeCacheEntry;
+typedef struct _AvsCodeCacheEntry AvsCodeCacheEntry;
+
+/*
+ * Bytecode is the optimized IL of a script, as 32 bit words in host byte
+ * order so it can be used straight from a mapped file:
+ *
+ *	header		magic, version, byte order mark, counts
+ *	variables	length and name, padded to a word
+ *	registers	type, flags, constant or variable index
+ *	instructions	type, three register indices, three extra words
+ *	arguments	register indices of all call arguments
+ *
+ * Register indices are one based, zero is no register.  Calls keep the
+ * builtin function index, argument count and first argument, jumps the
+ * index of their target instruction plus one.
+ */
+
+struct _AvsCodeCacheEntry {
+	uint32_t		hash;
+	const unsigned char	*source;
+	unsigned int		source_length;
+	const unsigned char	*code;
+	unsigned int		code_length;
+};
+
+/* Compiled code by script source.  Entries point into memory that owner keeps
+ * around, usually a mapped compiled preset, it is unreferenced with the cache. */
+struct _AvsCodeCache {
+	VisObject		object;
+	AvsCodeCacheEntry	*entries;
+	int			count;
+	int			sorted;
+	VisObject		*owner;
+};
+
+/* prototypes */
+uint32_t avs_bytecode_hash(const unsigned char *data, unsigned int length);
+int avs_bytecode_write(AvsILAssemblerContext *ctx, AvsRunnable *obj, unsigned char **code, unsigned int *length);
+int avs_bytecode_read(AvsILAssemblerContext *ctx, AvsRunnable *obj, const unsigned char *code, unsigned int length);
+AvsCodeCacheEntry *avs_code_cache_lookup(AvsCodeCache *cache, const unsigned char *source, unsigned int length);
+int avs_code_cache_add(AvsCodeCache *cache, const unsigned char *source, unsigned int source_length, const unsigned char *code, unsigned int code_length);
+AvsCodeCache *avs_code_cache_new(void);
+
+#endif /* !_AVS_BYTECODE_H */
@@ -144,6 +144,36 @@ AvsRunnableFunction * avs_builtin_function_find(char *name)
 	return &avs_builtin_functions[tok->lookup];
 }
 
+/**
+ *	Translate a builtin function back into its avs_builtin_functions table index number.
+ *
+ *	@param fn Function to look up.
+ *
+ *	@return AvsBuiltinFunctionType index number of 'fn' on success, -1 when it is not a builtin.
+ */
+AvsBuiltinFunctionType avs_builtin_function_index(AvsRunnableFunction *fn)
+{
+	if (fn < avs_builtin_functions || fn >= avs_builtin_functions + AVS_BUILTIN_FUNCTION_IF)
+		return -1;
+
+	return fn - avs_builtin_functions;
+}
+
+/**
+ *	Check whether a function always returns the same value for the same arguments.
+ *
+ *	@param fn Function to check.
+ *
+ *	@return TRUE for pure builtin functions, FALSE for anything reading time,
+ *		audio, random state or that is not a builtin.
+ */
+int avs_builtin_function_pure(AvsRunnableFunction *fn)
+{
+	int lookup = avs_builtin_function_index(fn);
+
+	return lookup >= 0 && lookup != AVS_BUILTIN_FUNCTION_RAND && lookup < AVS_BUILTIN_FUNCTION_GETOSC;
+}
+
 static float getvis(unsigned char *visdata, int bc, int bw, int ch, int xorv)
 {
     int x;
@@ -56,5 +56,7 @@ struct _AvsBuiltinFunctionToken {
 AvsBuiltinFunctionType avs_builtin_function_type(char *name);
 AvsRunnableFunction *avs_builtin_function_lookup(AvsBuiltinFunctionType lookup);
 AvsRunnableFunction *avs_builtin_function_find(char *name);
+AvsBuiltinFunctionType avs_builtin_function_index(AvsRunnableFunction *fn);
+int avs_builtin_function_pure(AvsRunnableFunction *fn);
 
 #endif /* !_AVS_FUNCTIONS_H */
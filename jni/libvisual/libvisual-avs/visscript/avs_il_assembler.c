@@ -455,6 +455,9 @@ int avs_il_runnable_finish(AvsILAssemblerContext *ctx, AvsRunnable *obj)
 
 	}
 	
+	if (ctx->optimize)
+		avs_il_optimize(ctx, obj);
+
 	/* Level up */
 	avs_il_core_compile(ctx->core, &ctx->tree, obj);
 	return VISUAL_OK;
@@ -502,6 +505,7 @@ int avs_il_init(AvsILAssemblerContext *ctx, ILCoreContext *core)
 {
 	memset(ctx, 0, sizeof(AvsILAssemblerContext));
 	ctx->core = core;
+	ctx->optimize = TRUE;
 	avs_il_core_init(core);
 	return avs_il_tree_init(&ctx->tree);
 }
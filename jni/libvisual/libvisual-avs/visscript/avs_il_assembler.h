@@ -16,6 +16,7 @@ struct _AvsILAssemblerContext {
 	AvsILTreeContext	tree;
 	ILCoreContext		*core;
 	int			nestlevel;
+	int			optimize;	/* Run avs_il_optimize() before compiling */
 };
 
 struct _AvsILRunnableData {
@@ -31,6 +32,9 @@ int avs_il_runnable_init(AvsILAssemblerContext *ctx, AvsRunnable *obj);
 int avs_il_cleanup(AvsILAssemblerContext *ctx);
 int avs_il_init(AvsILAssemblerContext *ctx, ILCoreContext *core);
 
+/* avs_il_optimizer.c */
+int avs_il_optimize(AvsILAssemblerContext *ctx, AvsRunnable *obj);
+
 /* avs_il_tree.c */
 ILInstruction *avs_il_tree_base(AvsILTreeContext *ctx);
 void avs_il_tree_merge(AvsILTreeContext *ctx, AvsILTreeNode *node);
@@ -9,6 +9,7 @@
 
 extern ILCore il_core_ix;
 extern ILCore il_core_x86;
+extern ILCore il_core_jit;
 
 static ILCore * get_core(void)
 {
@@ -16,10 +17,17 @@ static ILCore * get_core(void)
 	{
 		&il_core_ix,
 		&il_core_x86,
+		&il_core_jit,
 		NULL,
 	};
 
+	/* The x86 core emits 32 bit code with absolute addresses, the JIT core
+	 * targets x86-64 and AArch64 and runs anything else on the IX machine */
+#if defined(__i386__)
 	return cores[1];
+#else
+	return cores[2];
+#endif
 }
 
 
@@ -37,8 +45,50 @@ static ILCoreContext * create_context(ILCore *core)
 	return ctx;
 }
 
+static void add_reference(AvsRunnable *obj, ILRegister *reg)
+{
+	int i;
+
+	if (reg == NULL || reg->type != ILRegisterTypeVariable)
+		return;
+
+	for (i = 0; i < obj->nrefs; i++)
+		if (obj->refs[i] == reg->value.variable)
+			return;
+
+	obj->refs = realloc(obj->refs, (obj->nrefs + 1) * sizeof(AvsRunnableVariable *));
+	obj->refs[obj->nrefs++] = reg->value.variable;
+}
+
+/* Collect the variables the code touches and whether those alone decide what
+ * it does, done here so compiled and cached code get the same answer */
+static void analyze(AvsILTreeContext *tree, AvsRunnable *obj)
+{
+	ILInstruction *insn;
+	unsigned int i;
+
+	free(obj->refs);
+	obj->refs = NULL;
+	obj->nrefs = 0;
+	obj->pure = TRUE;
+
+	for (insn = avs_il_tree_base(tree); insn != NULL; insn = insn->next) {
+		if (insn->type == ILInstructionCall) {
+			if (!avs_builtin_function_pure(insn->ex.call.call))
+				obj->pure = FALSE;
+
+			for (i = 0; i < insn->ex.call.argc; i++)
+				add_reference(obj, insn->ex.call.argv[i]);
+		}
+
+		for (i = 0; i < 3; i++)
+			add_reference(obj, insn->reg[i]);
+	}
+}
+
 int avs_il_core_compile(ILCoreContext *ctx, AvsILTreeContext *tree, AvsRunnable *obj)
 {
+	analyze(tree, obj);
 	return ctx->core->compile(ctx, tree, obj);
 }
 
@@ -47,6 +97,14 @@ int avs_il_core_init(ILCoreContext *ctx)
 	return ctx->core->init(ctx);
 }
 
+int avs_il_core_runnable_cleanup(ILCoreContext *ctx, AvsRunnable *obj)
+{
+	if (ctx->core->runnable_cleanup != NULL)
+		return ctx->core->runnable_cleanup(ctx, obj);
+
+	return VISUAL_OK;
+}
+
 int avs_il_core_context_init(ILCoreContext *ctx)
 {
 	context_ctor(ctx, get_core());
@@ -55,7 +113,8 @@ int avs_il_core_context_init(ILCoreContext *ctx)
 
 int avs_il_core_context_cleanup(ILCoreContext *ctx)
 {
-    ctx->core->cleanup(ctx);
+    if (ctx->core->cleanup != NULL)
+        ctx->core->cleanup(ctx);
     return VISUAL_OK;
 }
 
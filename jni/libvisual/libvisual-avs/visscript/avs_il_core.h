@@ -10,6 +10,7 @@ typedef struct _AvsILCore ILCore;
 typedef int (*ILCoreVirtualInit)(ILCoreContext *);
 typedef int (*ILCoreVirtualCompile)(ILCoreContext *, AvsILTreeContext *, AvsRunnable *);
 typedef int (*ILCoreVirtualCleanup)(ILCoreContext *);
+typedef int (*ILCoreVirtualRunnableCleanup)(ILCoreContext *, AvsRunnable *);
 	
 struct _AvsILCoreContext {
 	ILCore		*core;
@@ -21,6 +22,9 @@ struct _AvsILCore {
 	ILCoreVirtualInit	init;
 	ILCoreVirtualCompile	compile;
     ILCoreVirtualCleanup    cleanup;    
+
+	/* Optional, releases what compile attached to the runnable */
+	ILCoreVirtualRunnableCleanup	runnable_cleanup;
 };
 
 #define IL_CORE_INIT(fn) \
@@ -29,9 +33,13 @@ struct _AvsILCore {
 #define IL_CORE_COMPILE(fn) \
 	int fn (ILCoreContext *ctx, AvsILTreeContext *tree, AvsRunnable *obj)
 
+#define IL_CORE_RUNNABLE_CLEANUP(fn) \
+	int fn (ILCoreContext *ctx, AvsRunnable *obj)
+
 /* prototypes */
 int avs_il_core_compile(ILCoreContext *ctx, AvsILTreeContext *tree, AvsRunnable *obj);
 int avs_il_core_init(ILCoreContext *ctx);
+int avs_il_core_runnable_cleanup(ILCoreContext *ctx, AvsRunnable *obj);
 int avs_il_core_context_init(ILCoreContext *ctx);
 int avs_il_core_context_cleanup(ILCoreContext *ctx);
 ILCoreContext *avs_il_core_context_create(void);
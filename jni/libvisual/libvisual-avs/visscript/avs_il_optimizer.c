@@ -0,0 +1,589 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include "avs.h"
+
+/*
+ * Optimizer for finished IL trees.
+ *
+ * The assembler emits a fresh worker register for every intermediate result,
+ * so a worker written by exactly one instruction keeps its value from there
+ * on and every read of it comes after that write.  Constants share the same
+ * register type, they are the registers nothing writes to.  The passes lean
+ * on that:
+ *
+ *  - constant folding, pure instructions and pure builtins over constants
+ *    turn their worker into a constant
+ *  - copy propagation, reads of a worker copied from another worker or a
+ *    constant read the source instead
+ *  - common subexpression elimination, within a basic block an instruction
+ *    computing what an earlier one did reuses its worker
+ *  - dead store elimination, pure instructions whose worker is never read,
+ *    and stores to a variable overwritten before it is read again
+ *
+ * Instructions are never unlinked, since jumps point at them, optimized out
+ * ones become nops that the cores skip.
+ */
+
+#define OPT_MAX_OPERANDS	8
+
+typedef struct _AvsILOptimizerRegister {
+	ILRegister	*reg;
+	int		defs;
+	int		uses;
+	int		escaped;	/* A reference may write it */
+	ILRegister	*replace;	/* Reads go to this register instead */
+} OptRegister;
+
+typedef struct _AvsILOptimizerOperands {
+	ILRegister	**use[OPT_MAX_OPERANDS];
+	int		nuses;
+	ILRegister	**def[2];
+	int		ndefs;
+} OptOperands;
+
+typedef struct _AvsILOptimizerExpression {
+	ILInstruction	*insn;
+	ILRegister	*args[OPT_MAX_OPERANDS];
+	int		nargs;
+} OptExpression;
+
+typedef struct _AvsILOptimizerContext {
+	AvsRunnable	*runnable;
+	ILInstruction	*base;
+
+	OptRegister	**regs;
+	int		nregs;
+
+	ILInstruction	**targets;
+	int		ntargets;
+
+	OptExpression	*exprs;
+	int		nexprs;
+
+	int		folded, merged, removed;
+} OptContext;
+
+#define OPT_REGISTER(reg) \
+	((OptRegister *) (reg)->private)
+
+static void operands_get(ILInstruction *insn, OptOperands *ops)
+{
+	int i;
+
+	ops->nuses = ops->ndefs = 0;
+
+	switch (insn->type) {
+		case ILInstructionCall:
+			ops->def[ops->ndefs++] = &insn->reg[0];
+			for (i = 0; i < insn->ex.call.argc && i < OPT_MAX_OPERANDS; i++)
+				ops->use[ops->nuses++] = &insn->ex.call.argv[i];
+			break;
+
+		case ILInstructionNegate:
+		case ILInstructionLoadReference:
+			ops->def[ops->ndefs++] = &insn->reg[0];
+			ops->use[ops->nuses++] = &insn->reg[1];
+			break;
+
+		case ILInstructionAssign:
+		case ILInstructionStoreReference:
+			ops->def[ops->ndefs++] = &insn->reg[0];
+			ops->def[ops->ndefs++] = &insn->reg[1];
+			ops->use[ops->nuses++] = &insn->reg[2];
+			break;
+
+		case ILInstructionAdd:
+		case ILInstructionSub:
+		case ILInstructionMul:
+		case ILInstructionDiv:
+		case ILInstructionMod:
+		case ILInstructionAnd:
+		case ILInstructionOr:
+			ops->def[ops->ndefs++] = &insn->reg[0];
+			ops->use[ops->nuses++] = &insn->reg[1];
+			ops->use[ops->nuses++] = &insn->reg[2];
+			break;
+
+		case ILInstructionLoopInit:
+			ops->use[ops->nuses++] = &insn->reg[1];
+			break;
+
+		case ILInstructionJumpTrue:
+			ops->use[ops->nuses++] = &insn->reg[0];
+			break;
+
+		default:
+			break;
+	}
+}
+
+static OptRegister * register_info(OptContext *ctx, ILRegister *reg)
+{
+	OptRegister *info = OPT_REGISTER(reg);
+
+	if (info)
+		return info;
+
+	info = malloc(sizeof(OptRegister));
+	memset(info, 0, sizeof(OptRegister));
+	info->reg = reg;
+	reg->private = info;
+
+	if ((ctx->nregs & 63) == 0)
+		ctx->regs = realloc(ctx->regs, sizeof(OptRegister *) * (ctx->nregs + 64));
+	ctx->regs[ctx->nregs++] = info;
+
+	return info;
+}
+
+static ILRegister * register_resolve(ILRegister *reg)
+{
+	while (OPT_REGISTER(reg)->replace)
+		reg = OPT_REGISTER(reg)->replace;
+
+	return reg;
+}
+
+/* Value known at compile time */
+static int register_constant(ILRegister *reg)
+{
+	OptRegister *info = OPT_REGISTER(reg);
+
+	return reg->type == ILRegisterTypeConstant && info->defs == 0 && !info->escaped;
+}
+
+/* Worker with a single write, its value never changes after it */
+static int register_stable(ILRegister *reg)
+{
+	OptRegister *info = OPT_REGISTER(reg);
+
+	return reg->type == ILRegisterTypeConstant && info->defs <= 1 && !info->escaped;
+}
+
+static int register_equal(ILRegister *a, ILRegister *b)
+{
+	if (a == b)
+		return TRUE;
+
+	if (register_constant(a) && register_constant(b))
+		return memcmp(&a->value.constant, &b->value.constant, sizeof(AvsNumber)) == 0;
+
+	if (a->type == ILRegisterTypeVariable && b->type == ILRegisterTypeVariable)
+		return a->value.variable == b->value.variable;
+
+	return FALSE;
+}
+
+static int insn_pure(ILInstruction *insn)
+{
+	switch (insn->type) {
+		case ILInstructionNegate:
+		case ILInstructionAdd:
+		case ILInstructionSub:
+		case ILInstructionMul:
+		case ILInstructionDiv:
+		case ILInstructionMod:
+		case ILInstructionAnd:
+		case ILInstructionOr:
+			return TRUE;
+
+		case ILInstructionCall:
+			return insn->ex.call.argc <= OPT_MAX_OPERANDS &&
+				avs_builtin_function_pure(insn->ex.call.call);
+
+		default:
+			return FALSE;
+	}
+}
+
+static int insn_target(OptContext *ctx, ILInstruction *insn)
+{
+	int i;
+
+	for (i = 0; i < ctx->ntargets; i++) {
+		if (ctx->targets[i] == insn)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Instructions control flow can enter other than from the previous one */
+static int insn_block_start(OptContext *ctx, ILInstruction *insn)
+{
+	switch (insn->type) {
+		case ILInstructionLoopInit:
+		case ILInstructionLoop:
+		case ILInstructionMergeMarker:
+			return TRUE;
+
+		default:
+			return insn_target(ctx, insn);
+	}
+}
+
+/* Instructions control flow may leave from, or that write through references */
+static int insn_block_end(ILInstruction *insn)
+{
+	switch (insn->type) {
+		case ILInstructionLoopInit:
+		case ILInstructionLoop:
+		case ILInstructionJump:
+		case ILInstructionJumpTrue:
+		case ILInstructionStoreReference:
+			return TRUE;
+
+		default:
+			return FALSE;
+	}
+}
+
+static void insn_remove(ILInstruction *insn)
+{
+	insn->type = ILInstructionNop;
+}
+
+static int insn_count(OptContext *ctx)
+{
+	ILInstruction *insn;
+	int count = 0;
+
+	for (insn = ctx->base; insn != NULL; insn = insn->next) {
+		if (insn->type != ILInstructionNop && insn->type != ILInstructionMergeMarker)
+			count++;
+	}
+
+	return count;
+}
+
+static void analyze(OptContext *ctx)
+{
+	ILInstruction *insn;
+	OptOperands ops;
+	int i;
+
+	for (insn = ctx->base; insn != NULL; insn = insn->next) {
+		operands_get(insn, &ops);
+
+		for (i = 0; i < ops.nuses; i++)
+			register_info(ctx, *ops.use[i])->uses++;
+
+		for (i = 0; i < ops.ndefs; i++)
+			register_info(ctx, *ops.def[i])->defs++;
+
+		/* Stores through the reference may land in it */
+		if (insn->type == ILInstructionLoadReference)
+			register_info(ctx, insn->reg[1])->escaped = TRUE;
+
+		switch (insn->type) {
+			case ILInstructionJump:
+			case ILInstructionJumpTrue:
+			case ILInstructionLoop:
+				if ((ctx->ntargets & 31) == 0)
+					ctx->targets = realloc(ctx->targets, sizeof(ILInstruction *) * (ctx->ntargets + 32));
+				ctx->targets[ctx->ntargets++] = insn->ex.jmp.pointer;
+				break;
+
+			default:
+				break;
+		}
+	}
+}
+
+static void count_uses(OptContext *ctx)
+{
+	ILInstruction *insn;
+	OptOperands ops;
+	int i;
+
+	for (i = 0; i < ctx->nregs; i++)
+		ctx->regs[i]->uses = 0;
+
+	for (insn = ctx->base; insn != NULL; insn = insn->next) {
+		operands_get(insn, &ops);
+
+		for (i = 0; i < ops.nuses; i++)
+			OPT_REGISTER(*ops.use[i])->uses++;
+	}
+}
+
+static int fold(OptContext *ctx, ILInstruction *insn, OptOperands *ops)
+{
+	AvsNumber args[OPT_MAX_OPERANDS], *argv[OPT_MAX_OPERANDS], value;
+	ILRegister *dest = insn->reg[0];
+	int i;
+
+	if (!insn_pure(insn) || !register_stable(dest))
+		return FALSE;
+
+	for (i = 0; i < ops->nuses; i++) {
+		if (!register_constant(*ops->use[i]))
+			return FALSE;
+
+		args[i] = (*ops->use[i])->value.constant;
+		argv[i] = &args[i];
+	}
+
+	/* The same expressions the IX machine evaluates */
+	switch (insn->type) {
+		case ILInstructionNegate:	value = -args[0];		break;
+		case ILInstructionAdd:		value = args[0] + args[1];	break;
+		case ILInstructionSub:		value = args[0] - args[1];	break;
+		case ILInstructionMul:		value = args[0] * args[1];	break;
+		case ILInstructionDiv:		value = args[0] / args[1];	break;
+		case ILInstructionAnd:	value = (unsigned int) args[0] & (unsigned int) args[1];	break;
+		case ILInstructionOr:	value = (unsigned int) args[0] | (unsigned int) args[1];	break;
+
+		case ILInstructionMod:
+			if ((unsigned int) args[1] == 0)
+				return FALSE;
+
+			value = (unsigned int) args[0] % (unsigned int) args[1];
+			break;
+
+		case ILInstructionCall:
+			insn->ex.call.call->run(ctx->runnable, &value, argv, insn->ex.call.argc);
+			break;
+
+		default:
+			return FALSE;
+	}
+
+	dest->value.constant = value;
+	OPT_REGISTER(dest)->defs = 0;
+	insn_remove(insn);
+
+	ctx->folded++;
+	return TRUE;
+}
+
+static int propagate(OptContext *ctx, ILInstruction *insn)
+{
+	ILRegister *dest = insn->reg[0], *src = insn->reg[2];
+
+	if (insn->type != ILInstructionAssign || dest == insn->reg[1])
+		return FALSE;
+
+	if (!register_stable(dest) || !register_stable(src) || OPT_REGISTER(src)->defs > 1)
+		return FALSE;
+
+	/* The store to the variable stays, the worker copy goes */
+	OPT_REGISTER(dest)->replace = src;
+	OPT_REGISTER(dest)->defs = 0;
+	insn->reg[0] = insn->reg[1];
+	OPT_REGISTER(insn->reg[1])->defs++;
+
+	ctx->merged++;
+	return TRUE;
+}
+
+static void expressions_invalidate(OptContext *ctx, ILRegister *reg)
+{
+	int i, j;
+
+	for (i = 0; i < ctx->nexprs; i++) {
+		for (j = 0; j < ctx->exprs[i].nargs; j++) {
+			if (register_equal(ctx->exprs[i].args[j], reg))
+				break;
+		}
+
+		if (j < ctx->exprs[i].nargs)
+			ctx->exprs[i--] = ctx->exprs[--ctx->nexprs];
+	}
+}
+
+static int eliminate(OptContext *ctx, ILInstruction *insn, OptOperands *ops)
+{
+	OptExpression *expr;
+	int i, j;
+
+	if (!insn_pure(insn) || !register_stable(insn->reg[0]))
+		return FALSE;
+
+	for (i = 0; i < ctx->nexprs; i++) {
+		expr = &ctx->exprs[i];
+
+		if (expr->insn->type != insn->type || expr->nargs != ops->nuses)
+			continue;
+
+		if (insn->type == ILInstructionCall && expr->insn->ex.call.call != insn->ex.call.call)
+			continue;
+
+		for (j = 0; j < ops->nuses; j++) {
+			if (!register_equal(expr->args[j], *ops->use[j]))
+				break;
+		}
+
+		if (j < ops->nuses)
+			continue;
+
+		OPT_REGISTER(insn->reg[0])->replace = expr->insn->reg[0];
+		OPT_REGISTER(insn->reg[0])->defs = 0;
+		insn_remove(insn);
+
+		ctx->merged++;
+		return TRUE;
+	}
+
+	if ((ctx->nexprs & 31) == 0)
+		ctx->exprs = realloc(ctx->exprs, sizeof(OptExpression) * (ctx->nexprs + 32));
+
+	expr = &ctx->exprs[ctx->nexprs++];
+	expr->insn = insn;
+	expr->nargs = ops->nuses;
+	for (j = 0; j < ops->nuses; j++)
+		expr->args[j] = *ops->use[j];
+
+	return FALSE;
+}
+
+/* Folding, copy propagation and common subexpressions, in one forward walk */
+static void forward(OptContext *ctx)
+{
+	ILInstruction *insn;
+	OptOperands ops;
+	int i;
+
+	ctx->nexprs = 0;
+
+	for (insn = ctx->base; insn != NULL; insn = insn->next) {
+		if (insn_block_start(ctx, insn))
+			ctx->nexprs = 0;
+
+		operands_get(insn, &ops);
+
+		for (i = 0; i < ops.nuses; i++)
+			*ops.use[i] = register_resolve(*ops.use[i]);
+
+		if (fold(ctx, insn, &ops) || eliminate(ctx, insn, &ops))
+			continue;
+
+		propagate(ctx, insn);
+
+		/* Anything computed from what this writes is stale now */
+		for (i = 0; i < ops.ndefs; i++) {
+			if (!register_stable(*ops.def[i]))
+				expressions_invalidate(ctx, *ops.def[i]);
+		}
+
+		if (insn_block_end(insn))
+			ctx->nexprs = 0;
+	}
+}
+
+static int remove_dead_workers(OptContext *ctx)
+{
+	ILInstruction *insn;
+	OptOperands ops;
+	int i, removed = 0;
+
+	for (insn = ctx->base; insn != NULL; insn = insn->next) {
+		if (!insn_pure(insn) || !register_stable(insn->reg[0]) || OPT_REGISTER(insn->reg[0])->uses > 0)
+			continue;
+
+		operands_get(insn, &ops);
+		for (i = 0; i < ops.nuses; i++)
+			OPT_REGISTER(*ops.use[i])->uses--;
+
+		insn_remove(insn);
+		removed++;
+	}
+
+	return removed;
+}
+
+/* Stores to a variable that the same block overwrites before reading it */
+static int remove_dead_stores(OptContext *ctx)
+{
+	ILInstruction *insn, **stores = NULL;
+	OptOperands ops;
+	int i, j, nstores = 0, removed = 0;
+
+	for (insn = ctx->base; insn != NULL; insn = insn->next) {
+		if (insn_block_start(ctx, insn) || insn->type == ILInstructionLoadReference)
+			nstores = 0;
+
+		operands_get(insn, &ops);
+
+		for (i = 0; i < ops.nuses; i++) {
+			for (j = 0; j < nstores; j++) {
+				if (register_equal(stores[j]->reg[1], *ops.use[i]))
+					stores[j--] = stores[--nstores];
+			}
+		}
+
+		if (insn->type == ILInstructionAssign && insn->reg[1]->type == ILRegisterTypeVariable &&
+				!OPT_REGISTER(insn->reg[1])->escaped) {
+			for (j = 0; j < nstores; j++) {
+				if (!register_equal(stores[j]->reg[1], insn->reg[1]))
+					continue;
+
+				/* Nothing may read the result of the overwritten store either */
+				if (stores[j]->reg[0] == stores[j]->reg[1] || OPT_REGISTER(stores[j]->reg[0])->uses == 0) {
+					OPT_REGISTER(stores[j]->reg[2])->uses--;
+					insn_remove(stores[j]);
+					removed++;
+				}
+
+				stores[j--] = stores[--nstores];
+			}
+
+			if ((nstores & 31) == 0)
+				stores = realloc(stores, sizeof(ILInstruction *) * (nstores + 32));
+			stores[nstores++] = insn;
+		}
+
+		if (insn_block_end(insn))
+			nstores = 0;
+	}
+
+	free(stores);
+
+	return removed;
+}
+
+/**
+ *	Optimize a finished IL tree before it is handed to the core.
+ *
+ *	@param ctx IL Assembler context holding the tree.
+ *	@param obj Runnable object the tree was assembled for.
+ *
+ *	@return VISUAL_OK on success, VISUAL_ERROR_GENERAL on error.
+ */
+int avs_il_optimize(AvsILAssemblerContext *ctx, AvsRunnable *obj)
+{
+	OptContext opt;
+	int before, i;
+
+	memset(&opt, 0, sizeof(OptContext));
+	opt.runnable = obj;
+	opt.base = avs_il_tree_base(&ctx->tree);
+
+	before = insn_count(&opt);
+
+	analyze(&opt);
+	forward(&opt);
+
+	count_uses(&opt);
+	while (remove_dead_workers(&opt) + remove_dead_stores(&opt) > 0)
+		opt.removed++;
+
+	avs_debug(print("il: optimizer: %d instructions before, %d after (%d folded, %d merged, %d dead store passes)",
+				before, insn_count(&opt), opt.folded, opt.merged, opt.removed));
+
+	/* The cores keep their own data in the register private pointers */
+	for (i = 0; i < opt.nregs; i++) {
+		opt.regs[i]->reg->private = NULL;
+		free(opt.regs[i]);
+	}
+
+	free(opt.regs);
+	free(opt.targets);
+	free(opt.exprs);
+
+	return VISUAL_OK;
+}
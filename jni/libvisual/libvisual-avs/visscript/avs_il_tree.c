@@ -69,20 +69,17 @@ int avs_il_tree_reset(AvsILTreeContext *ctx)
 {
     AvsILTreeNode *node, *tmp_node;
     ILInstruction *instruction, *tmp_instruction;
-    int i = 0;
+
 	/* Reset instruction stack */
 	avs_stack_reset(ctx->ixstack);
 
     for(node = tmp_node = ctx->base; node; node = tmp_node)
     {
 
+            /* Registers are left alone, compiled code keeps pointing at their values */
             for(instruction = node->insn.base; instruction; instruction = tmp_instruction)
             {
-                for(i = 0; i < 3; i++)
-                {
-                    avs_il_register_dereference(instruction->reg[i]);
-                    tmp_instruction = instruction->next;
-                }
+                tmp_instruction = instruction->next;
                 free(instruction);
             }
 
@@ -119,13 +116,10 @@ int avs_il_tree_cleanup(AvsILTreeContext *ctx)
     for(node = tmp_node = ctx->base; node; node = tmp_node)
     {
 
+            /* Registers are left alone, compiled code keeps pointing at their values */
             for(instruction = node->insn.base; instruction; instruction = tmp_instruction)
             {
-                for(i = 0; i < 3; i++)
-                {
-                    avs_il_register_dereference(instruction->reg[i]);
-                    tmp_instruction = instruction->next;
-                }
+                tmp_instruction = instruction->next;
                 free(instruction);
             }
 
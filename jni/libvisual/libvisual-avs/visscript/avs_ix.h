@@ -59,6 +59,10 @@ struct _AvsIXOpcode {
 
 typedef struct _AvsIXRunnableData {
 	IXOpcode	*base, *end;
+
+	/* Native code for the opcodes, set by the JIT core */
+	void		*native;
+	size_t		native_size;
 } IXRunnableData;
 
 struct _AvsIXExLoop {
@@ -0,0 +1,458 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include "avs.h"
+#include "avs_ix.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#define IX_BATCH_SSE 1
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define IX_BATCH_NEON 1
+#endif
+
+/*
+ * Batch execution of straight line IX code. Every register the code touches
+ * becomes an array with one value per lane, and every opcode one sweep over
+ * those arrays. Code with jumps or references, or which carries a variable
+ * from one lane to the next, runs lane by lane through the machine instead.
+ */
+
+#define IXBatchSlotLiveIn	1	/* Read before it is written */
+#define IXBatchSlotWritten	2
+
+typedef struct _AvsIXBatchSlot {
+	AvsNumber	*ref;		/* Register the IX code uses */
+	AvsNumber	*lanes;
+	unsigned int	flags;
+	int		binding;	/* Index into the batch bindings, or -1 */
+} IXBatchSlot;
+
+typedef struct _AvsIXBatchOp {
+	IXOpcodeType	opcode;
+	int		nregs;
+	int		slot[3];
+	AvsNumber	*reg[3];	/* Lane arrays of the slots */
+	AvsRunnableFunction *call;
+	int		argc;
+	int		*argslot;
+	AvsNumber	**argv;		/* Argument lane arrays */
+	AvsNumber	**args;		/* Argument pointers of a single lane */
+} IXBatchOp;
+
+typedef struct _AvsIXBatchPlan {
+	IXRunnableData	*rd;		/* Code the plan was made for */
+	int		nbindings;
+	int		lanewise;	/* Can't batch, run lane by lane */
+
+	IXBatchSlot	*slots;
+	int		nslots;
+	IXBatchOp	*ops;
+	int		nops;
+	AvsNumber	*storage;
+} IXBatchPlan;
+
+static int slot_get(IXBatchPlan *plan, AvsNumber *ref)
+{
+	int i;
+
+	for (i = 0; i < plan->nslots; i++) {
+		if (plan->slots[i].ref == ref)
+			return i;
+	}
+
+	plan->slots[i].ref = ref;
+	plan->slots[i].binding = -1;
+	plan->nslots++;
+
+	return i;
+}
+
+static void slot_read(IXBatchPlan *plan, int slot)
+{
+	if (!(plan->slots[slot].flags & IXBatchSlotWritten))
+		plan->slots[slot].flags |= IXBatchSlotLiveIn;
+}
+
+static void slot_write(IXBatchPlan *plan, int slot)
+{
+	plan->slots[slot].flags |= IXBatchSlotWritten;
+}
+
+static void plan_free(IXBatchPlan *plan)
+{
+	int i;
+
+	for (i = 0; i < plan->nops; i++) {
+		free(plan->ops[i].argslot);
+		free(plan->ops[i].argv);
+		free(plan->ops[i].args);
+	}
+
+	free(plan->slots);
+	free(plan->ops);
+	free(plan->storage);
+	free(plan);
+}
+
+static IXBatchPlan * plan_create(AvsRunnableBatch *batch)
+{
+	IXRunnableData *rd = IX_RUNNABLE_DATA(batch->runnable);
+	IXBatchPlan *plan;
+	IXOpcode *op;
+	int maxslots = 0, i, j;
+
+	plan = malloc(sizeof(IXBatchPlan));
+	memset(plan, 0, sizeof(IXBatchPlan));
+	plan->rd = rd;
+	plan->nbindings = batch->nbindings;
+
+	for (op = rd->base; op != NULL; op = op->next) {
+		plan->nops++;
+		maxslots += op->opcode == IXOpcodeCall ? op->ex.call.argc + 1 : 3;
+	}
+
+	plan->slots = malloc(sizeof(IXBatchSlot) * (maxslots + 1));
+	memset(plan->slots, 0, sizeof(IXBatchSlot) * (maxslots + 1));
+	plan->ops = malloc(sizeof(IXBatchOp) * (plan->nops + 1));
+	memset(plan->ops, 0, sizeof(IXBatchOp) * (plan->nops + 1));
+
+	/* Map the registers to slots, in program order */
+	for (op = rd->base, i = 0; op != NULL; op = op->next, i++) {
+		IXBatchOp *bop = &plan->ops[i];
+		int *reg = bop->slot;
+
+		bop->opcode = op->opcode;
+
+		switch (op->opcode) {
+			case IXOpcodeNop:
+				break;
+
+			case IXOpcodeCall:
+				bop->call = op->ex.call.call;
+				bop->argc = op->ex.call.argc;
+				bop->argslot = malloc(sizeof(int) * (bop->argc + 1));
+				bop->argv = malloc(sizeof(AvsNumber *) * (bop->argc + 1));
+				bop->args = malloc(sizeof(AvsNumber *) * (bop->argc + 1));
+
+				for (j = 0; j < bop->argc; j++) {
+					bop->argslot[j] = slot_get(plan, op->ex.call.argv[j]);
+					slot_read(plan, bop->argslot[j]);
+				}
+
+				reg[0] = slot_get(plan, op->reg[0]);
+				slot_write(plan, reg[0]);
+				bop->nregs = 1;
+				break;
+
+			case IXOpcodeNegate:
+				reg[1] = slot_get(plan, op->reg[1]);
+				slot_read(plan, reg[1]);
+				reg[0] = slot_get(plan, op->reg[0]);
+				slot_write(plan, reg[0]);
+				bop->nregs = 2;
+				break;
+
+			case IXOpcodeAssign:
+				reg[2] = slot_get(plan, op->reg[2]);
+				slot_read(plan, reg[2]);
+				reg[1] = slot_get(plan, op->reg[1]);
+				slot_write(plan, reg[1]);
+				reg[0] = slot_get(plan, op->reg[0]);
+				slot_write(plan, reg[0]);
+				bop->nregs = 3;
+				break;
+
+			case IXOpcodeAdd:
+			case IXOpcodeSub:
+			case IXOpcodeMul:
+			case IXOpcodeDiv:
+			case IXOpcodeMod:
+			case IXOpcodeAnd:
+			case IXOpcodeOr:
+				reg[1] = slot_get(plan, op->reg[1]);
+				reg[2] = slot_get(plan, op->reg[2]);
+				slot_read(plan, reg[1]);
+				slot_read(plan, reg[2]);
+				reg[0] = slot_get(plan, op->reg[0]);
+				slot_write(plan, reg[0]);
+				bop->nregs = 3;
+				break;
+
+			default:
+				/* Jumps, compares and references */
+				plan->lanewise = TRUE;
+				return plan;
+		}
+	}
+
+	for (i = 0; i < plan->nslots; i++) {
+		IXBatchSlot *slot = &plan->slots[i];
+
+		for (j = 0; j < batch->nbindings; j++) {
+			if (batch->bindings[j].variable->value == slot->ref)
+				slot->binding = j;
+		}
+
+		/* A variable read before written carries its value to the next lane,
+		 * unless every lane gets its own value */
+		if ((slot->flags & IXBatchSlotLiveIn) && (slot->flags & IXBatchSlotWritten) &&
+			(slot->binding < 0 || !(batch->bindings[slot->binding].flags & AvsRunnableBatchInput))) {
+			plan->lanewise = TRUE;
+			return plan;
+		}
+	}
+
+	plan->storage = malloc(sizeof(AvsNumber) * (plan->nslots * batch->lanes + 1));
+
+	for (i = 0; i < plan->nslots; i++)
+		plan->slots[i].lanes = plan->storage + i * batch->lanes;
+
+	for (i = 0; i < plan->nops; i++) {
+		IXBatchOp *bop = &plan->ops[i];
+
+		for (j = 0; j < bop->nregs; j++)
+			bop->reg[j] = plan->slots[bop->slot[j]].lanes;
+
+		for (j = 0; j < bop->argc; j++)
+			bop->argv[j] = plan->slots[bop->argslot[j]].lanes;
+	}
+
+	return plan;
+}
+
+static void lanes_fill(AvsNumber *dest, AvsNumber value, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		dest[i] = value;
+}
+
+static void batch_negate(AvsNumber *d, const AvsNumber *a, int count)
+{
+	int i = 0;
+
+#if defined(IX_BATCH_SSE)
+	const __m128 sign = _mm_set1_ps(-0.0f);
+
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(d + i, _mm_xor_ps(_mm_loadu_ps(a + i), sign));
+#elif defined(IX_BATCH_NEON)
+	for (; i + 4 <= count; i += 4)
+		vst1q_f32(d + i, vnegq_f32(vld1q_f32(a + i)));
+#endif
+
+	for (; i < count; i++)
+		d[i] = -a[i];
+}
+
+#if defined(IX_BATCH_SSE)
+#define BATCH_ARITH_SIMD(vop) \
+	for (; i + 4 <= count; i += 4) \
+		_mm_storeu_ps(d + i, vop(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+#elif defined(IX_BATCH_NEON)
+#define BATCH_ARITH_SIMD(vop) \
+	for (; i + 4 <= count; i += 4) \
+		vst1q_f32(d + i, vop(vld1q_f32(a + i), vld1q_f32(b + i)));
+#else
+#define BATCH_ARITH_SIMD(vop)
+#endif
+
+#define BATCH_ARITH(name, vop, expr) \
+	static void name (AvsNumber *d, const AvsNumber *a, const AvsNumber *b, int count) \
+	{ \
+		int i = 0; \
+		BATCH_ARITH_SIMD(vop) \
+		for (; i < count; i++) \
+			d[i] = (expr); \
+	}
+
+#define BATCH_SCALAR(name, expr) \
+	static void name (AvsNumber *d, const AvsNumber *a, const AvsNumber *b, int count) \
+	{ \
+		int i; \
+		for (i = 0; i < count; i++) \
+			d[i] = (expr); \
+	}
+
+#if defined(IX_BATCH_SSE)
+BATCH_ARITH(batch_add, _mm_add_ps, a[i] + b[i])
+BATCH_ARITH(batch_sub, _mm_sub_ps, a[i] - b[i])
+BATCH_ARITH(batch_mul, _mm_mul_ps, a[i] * b[i])
+BATCH_ARITH(batch_div, _mm_div_ps, a[i] / b[i])
+#elif defined(IX_BATCH_NEON)
+BATCH_ARITH(batch_add, vaddq_f32, a[i] + b[i])
+BATCH_ARITH(batch_sub, vsubq_f32, a[i] - b[i])
+BATCH_ARITH(batch_mul, vmulq_f32, a[i] * b[i])
+#if defined(__aarch64__)
+BATCH_ARITH(batch_div, vdivq_f32, a[i] / b[i])
+#else
+/* ARMv7 NEON only has a reciprocal estimate, which isn't exact */
+BATCH_SCALAR(batch_div, a[i] / b[i])
+#endif
+#else
+BATCH_SCALAR(batch_add, a[i] + b[i])
+BATCH_SCALAR(batch_sub, a[i] - b[i])
+BATCH_SCALAR(batch_mul, a[i] * b[i])
+BATCH_SCALAR(batch_div, a[i] / b[i])
+#endif
+
+BATCH_SCALAR(batch_mod, (unsigned int)a[i] % (unsigned int)b[i])
+BATCH_SCALAR(batch_and, (unsigned int)a[i] & (unsigned int)b[i])
+BATCH_SCALAR(batch_or,  (unsigned int)a[i] | (unsigned int)b[i])
+
+static void batch_call(AvsRunnable *obj, IXBatchOp *bop, int count)
+{
+	int lane, j;
+
+	for (lane = 0; lane < count; lane++) {
+		for (j = 0; j < bop->argc; j++)
+			bop->args[j] = bop->argv[j] + lane;
+
+		bop->call->run(obj, bop->reg[0] + lane, bop->args, bop->argc);
+	}
+}
+
+static void plan_run(AvsRunnableBatch *batch, IXBatchPlan *plan, int count)
+{
+	AvsRunnableBatchBinding *binding;
+	IXBatchSlot *slot;
+	IXBatchOp *bop;
+	int i;
+
+	/* Load the lanes */
+	for (i = 0; i < plan->nslots; i++) {
+		slot = &plan->slots[i];
+		binding = slot->binding >= 0 ? &batch->bindings[slot->binding] : NULL;
+
+		if (binding != NULL && (binding->flags & AvsRunnableBatchInput))
+			memcpy(slot->lanes, binding->array, sizeof(AvsNumber) * count);
+		else if (slot->flags & IXBatchSlotLiveIn)
+			lanes_fill(slot->lanes, *slot->ref, count);
+	}
+
+	for (i = 0, bop = plan->ops; i < plan->nops; i++, bop++) {
+		switch (bop->opcode) {
+			case IXOpcodeCall:
+				batch_call(batch->runnable, bop, count);
+				break;
+
+			case IXOpcodeNegate:
+				batch_negate(bop->reg[0], bop->reg[1], count);
+				break;
+
+			case IXOpcodeAssign:
+				if (bop->reg[1] != bop->reg[2])
+					memcpy(bop->reg[1], bop->reg[2], sizeof(AvsNumber) * count);
+				memcpy(bop->reg[0], bop->reg[2], sizeof(AvsNumber) * count);
+				break;
+
+			case IXOpcodeAdd:
+				batch_add(bop->reg[0], bop->reg[1], bop->reg[2], count);
+				break;
+
+			case IXOpcodeSub:
+				batch_sub(bop->reg[0], bop->reg[1], bop->reg[2], count);
+				break;
+
+			case IXOpcodeMul:
+				batch_mul(bop->reg[0], bop->reg[1], bop->reg[2], count);
+				break;
+
+			case IXOpcodeDiv:
+				batch_div(bop->reg[0], bop->reg[1], bop->reg[2], count);
+				break;
+
+			case IXOpcodeMod:
+				batch_mod(bop->reg[0], bop->reg[1], bop->reg[2], count);
+				break;
+
+			case IXOpcodeAnd:
+				batch_and(bop->reg[0], bop->reg[1], bop->reg[2], count);
+				break;
+
+			case IXOpcodeOr:
+				batch_or(bop->reg[0], bop->reg[1], bop->reg[2], count);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	/* Leave every variable as the last lane left it */
+	for (i = 0; i < plan->nslots; i++) {
+		slot = &plan->slots[i];
+		binding = slot->binding >= 0 ? &batch->bindings[slot->binding] : NULL;
+
+		if ((slot->flags & IXBatchSlotWritten) ||
+			(binding != NULL && (binding->flags & AvsRunnableBatchInput)))
+			*slot->ref = slot->lanes[count - 1];
+	}
+
+	/* Store the lanes */
+	for (i = 0; i < batch->nbindings; i++) {
+		binding = &batch->bindings[i];
+		slot = NULL;
+
+		if (!(binding->flags & AvsRunnableBatchOutput)) {
+			/* Not used by the code, but the variable still ends up with the last input */
+			if (binding->flags & AvsRunnableBatchInput)
+				*binding->variable->value = binding->array[count - 1];
+			continue;
+		}
+
+		for (slot = plan->slots; slot < plan->slots + plan->nslots; slot++) {
+			if (slot->ref == binding->variable->value)
+				break;
+		}
+
+		if (slot < plan->slots + plan->nslots &&
+			((slot->flags & IXBatchSlotWritten) || (binding->flags & AvsRunnableBatchInput))) {
+			memcpy(binding->array, slot->lanes, sizeof(AvsNumber) * count);
+		} else if (!(binding->flags & AvsRunnableBatchInput)) {
+			lanes_fill(binding->array, *binding->variable->value, count);
+		} else {
+			*binding->variable->value = binding->array[count - 1];
+		}
+	}
+}
+
+int avs_ix_machine_run_batch(AvsRunnableBatch *batch, int count)
+{
+	IXBatchPlan *plan = batch->pcore;
+
+	/* Replan when the runnable was recompiled or the bindings changed */
+	if (plan != NULL && (plan->rd != IX_RUNNABLE_DATA(batch->runnable) || plan->nbindings != batch->nbindings)) {
+		plan_free(plan);
+		plan = NULL;
+	}
+
+	if (plan == NULL) {
+		plan = plan_create(batch);
+		batch->pcore = plan;
+
+		avs_debug(print("IX: Batch plan: %d slots, %d opcodes%s", plan->nslots, plan->nops,
+					plan->lanewise ? ", lane by lane" : ""));
+	}
+
+	if (plan->lanewise)
+		return avs_runnable_batch_execute_lanes(batch, count);
+
+	plan_run(batch, plan, count);
+
+	return VISUAL_OK;
+}
+
+void avs_ix_machine_batch_cleanup(AvsRunnableBatch *batch)
+{
+	if (batch->pcore != NULL)
+		plan_free(batch->pcore);
+
+	batch->pcore = NULL;
+}
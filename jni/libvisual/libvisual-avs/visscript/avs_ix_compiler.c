@@ -73,9 +73,11 @@ static void bottom_halve(IXGlobalData *gd, IXOpcode *op)
 
 static void bottom_halve_context(IXGlobalData *gd, ILInstruction *ctx, IXOpcode *op)
 {
-	IXExInfo *xi;
+	IXExInfo *xi, *prev;
+
+	for (xi=gd->bh.queued; xi != NULL; xi = prev) {
+		prev = xi->prev;
 
-	for (xi=gd->bh.queued; xi != NULL; xi = xi->prev) {
 		switch (xi->type) {
 			case IXExInfoTypeLinkJumpNext:
 				xi->ex.jmp.from->ex.jmp.dest = op;
@@ -107,6 +109,10 @@ static void check_link_jump(IXGlobalData *gd, ILInstruction *ctx)
 	IXExInfo *xi;
 	xi = IX_EXINFO(ctx);
 	
+	/* Optimized out jump targets emit nothing, link to whatever comes next */
+	if (xi && xi->type == IXExInfoTypeLinkJump && ctx->type == ILInstructionNop)
+		xi->type = IXExInfoTypeLinkJumpNext;
+
 	if (!xi || xi->type != IXExInfoTypeLinkJumpNext)
 		return;
 
@@ -229,8 +235,15 @@ static int compile_opcode(IXGlobalData *gd, IXRunnableData *rd, ILInstruction *i
 		}
 		
 		case ILInstructionLoopInit: {
-			AvsNumber *counter = get_operand(insn->reg[1]);
+			AvsNumber *counter = get_number(0);
 			IXExLoop *l;
+
+			/* Count down a truncated copy, like the x86 core, the count
+			 * register may be a constant that has to survive the run */
+			op = opcode_add(insn, gd, rd, IXOpcodeOr);
+			op->reg[0] = counter;
+			op->reg[1] = get_operand(insn->reg[1]);
+			op->reg[2] = get_number(0);
 			
 			op = opcode_add(insn, gd, rd, IXOpcodeCmp);
 			op->reg[0] = counter;
@@ -246,9 +259,11 @@ static int compile_opcode(IXGlobalData *gd, IXRunnableData *rd, ILInstruction *i
 		}
 					    
 		case ILInstructionLoop: {
-			IXExLoop *l = loop_get(gd);
+			IXExLoop *l;
 
+			/* Adding the opcode first retires a nested loop ending here */
 			op = opcode_add(insn, gd, rd, IXOpcodeSub);
+			l = loop_get(gd);
 			op->reg[0] = l->counter;
 			op->reg[1] = l->counter;
 			op->reg[2] = get_number(1);
@@ -335,6 +350,10 @@ static IL_CORE_COMPILE(avs_ix_compiler_compile)
 
 	/* Link machine */
 	obj->run = avs_ix_machine_run;
+	obj->batch = avs_ix_machine_run_batch;
+	obj->batch_cleanup = avs_ix_machine_batch_cleanup;
+
+	avs_debug(call(avs_ix_machine_dump(obj)));
 
 	avs_debug(print("IX: Compiling finished..."));
 	return 0;
@@ -180,15 +180,17 @@ static IXOpcodeHandler opcode_handler[] =
 	ix_storeref,
 };
 
+void avs_ix_machine_dump(AvsRunnable *obj)
+{
+	dump_tree(IX_RUNNABLE_DATA(obj)->base);
+}
+
+/* Runs once per point or pixel for some elements, so no logging in here */
 int avs_ix_machine_run(AvsRunnable *obj)
 {
 	IXRunnableData *rd = IX_RUNNABLE_DATA(obj);
 	IXMachineState state;
 	IXOpcode *ip;
-	
-	avs_debug(print("IX: Runnable data: %p", obj));
-	dump_tree(rd->base);
-	avs_debug(print("IX: Running..."));
 
 	memset(&state, 0, sizeof(IXMachineState));
 	state.runnable = obj;
@@ -197,7 +199,6 @@ int avs_ix_machine_run(AvsRunnable *obj)
 		state.ip = ip->next;
 		opcode_handler[ip->opcode](&state, ip);
 	}
-	
-	avs_debug(print("IX: Halting..."));
+
 	return VISUAL_OK;
 }
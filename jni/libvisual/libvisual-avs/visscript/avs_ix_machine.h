@@ -16,5 +16,10 @@ typedef void (*IXOpcodeHandler)(IXMachineState *, IXOpcode *);
 
 /* prototypes */
 int avs_ix_machine_run(AvsRunnable *obj);
+void avs_ix_machine_dump(AvsRunnable *obj);
+
+/* avs_ix_batch.c */
+int avs_ix_machine_run_batch(AvsRunnableBatch *batch, int count);
+void avs_ix_machine_batch_cleanup(AvsRunnableBatch *batch);
 
 #endif /* !_AVS_IX_MACHINE_H */
@@ -0,0 +1,102 @@
+#ifndef _AVS_JIT_H
+#define _AVS_JIT_H 1
+
+#include "avs_ix.h"
+
+/*
+ * The JIT core compiles a runnable with the IX core first and translates the
+ * resulting opcodes to native code.  The opcodes are kept, so the IX machine
+ * stays available as a fallback for anything the JIT does not handle, and
+ * avs_ix_machine_run() on a JIT compiled runnable runs the very same program
+ * interpreted, which is what differential tests compare against.
+ *
+ * Generated code addresses every number by its absolute address.  The most
+ * used numbers are pinned into floating point registers for the whole run:
+ * loaded on entry, written back on exit and around calls that read or write
+ * them through pointers.
+ */
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#define AVS_JIT_NATIVE 1
+#endif
+
+typedef enum _AvsJitOp {
+	JitOpAdd,
+	JitOpSub,
+	JitOpMul,
+	JitOpDiv,
+	JitOpMod,
+	JitOpAnd,
+	JitOpOr,
+	JitOpMin,
+	JitOpMax,
+	JitOpNegate,
+	JitOpAbs,
+	JitOpSqrt,
+} JitOp;
+
+typedef enum _AvsJitJump {
+	JitJumpAlways,
+	JitJumpEqual,		/* Taken when the last compare was equal */
+	JitJumpNotEqual,
+} JitJump;
+
+typedef struct _AvsJitSlot {
+	AvsNumber	*ref;
+	int		uses;
+	int		written;
+	int		aliased;	/* Written through a reference, never pinned */
+	int		reg;		/* Pinned register, -1 when it lives in memory */
+} JitSlot;
+
+typedef struct _AvsJitFixup {
+	size_t		position;	/* Of the branch instruction */
+	JitJump		type;
+	IXOpcode	*dest;		/* NULL jumps to the exit */
+} JitFixup;
+
+typedef struct _AvsJitContext {
+	AvsRunnable	*runnable;
+
+	unsigned char	*buf;
+	size_t		length;
+	size_t		position;
+
+	JitSlot		*slots;
+	int		nslots;
+	JitSlot		**pinned;
+	int		npinned;
+
+	JitFixup	*fixups;
+	int		nfixups;
+} JitContext;
+
+/* Temporaries every operation works on, never pinned */
+#define JIT_T0		0
+#define JIT_T1		1
+
+/* avs_jit_compiler.c */
+void avs_jit_emit(JitContext *ctx, const void *data, size_t size);
+void avs_jit_emit_fixup(JitContext *ctx, JitJump type, IXOpcode *dest);
+
+/* Backend, avs_jit_amd64.c or avs_jit_arm64.c */
+extern const int avs_jit_arch_registers;
+
+void avs_jit_arch_prologue(JitContext *ctx);
+void avs_jit_arch_epilogue(JitContext *ctx);
+void avs_jit_arch_load(JitContext *ctx, int temp, JitSlot *slot);
+void avs_jit_arch_store(JitContext *ctx, JitSlot *slot, int temp);
+void avs_jit_arch_pin_load(JitContext *ctx, JitSlot *slot);
+void avs_jit_arch_pin_store(JitContext *ctx, JitSlot *slot);
+void avs_jit_arch_spill(JitContext *ctx, JitSlot *slot, int unspill);
+void avs_jit_arch_op(JitContext *ctx, JitOp op);
+void avs_jit_arch_compare(JitContext *ctx);
+void avs_jit_arch_jump(JitContext *ctx, JitJump type);
+void avs_jit_arch_link(JitContext *ctx, JitFixup *fixup, size_t target);
+void avs_jit_arch_call_math(JitContext *ctx, void *fn);
+void avs_jit_arch_call(JitContext *ctx, IXOpcode *op);
+void avs_jit_arch_ref_load(JitContext *ctx, IXRegisterReference *ref, AvsNumber *target);
+void avs_jit_arch_ref_store(JitContext *ctx, IXRegisterReference *ref, int temp);
+void avs_jit_arch_flush(void *code, size_t size);
+
+#endif /* !_AVS_JIT_H */
@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include "avs.h"
+#include "avs_jit.h"
+
+#if defined(__x86_64__)
+
+/*
+ * x86-64 SSE2 backend, System V calling convention.
+ *
+ * xmm0 and xmm1 are the temporaries, xmm2 to xmm15 hold pinned numbers.  Every
+ * xmm register is caller saved, so pinned numbers are spilled to the stack
+ * frame around calls.  rax and rcx are scratch, ebx keeps the last compare
+ * result between a cmp and its jump.
+ */
+
+#define REG_RAX		0
+#define REG_RCX		1
+#define REG_RDX		2
+#define REG_RSI		6
+#define REG_RDI		7
+
+#define PINNED_XMM(slot)	((slot)->reg + 2)
+
+const int avs_jit_arch_registers = 14;
+
+static int frame_size(JitContext *ctx)
+{
+	/* Keeps rsp 16 byte aligned at calls, after pushing rbp and rbx */
+	return ((ctx->npinned * 4 + 15) & ~15) + 8;
+}
+
+static void emit_mov_imm64(JitContext *ctx, int gpr, const void *imm)
+{
+	unsigned char code[10];
+	uint64_t value = (uintptr_t) imm;
+	int i;
+
+	code[0] = 0x48;
+	code[1] = 0xb8 + gpr;
+	for (i = 0; i < 8; i++)
+		code[2 + i] = value >> (i * 8);
+
+	avs_jit_emit(ctx, code, sizeof(code));
+}
+
+/* Scalar single SSE instruction, register to register */
+static void emit_sse_rr(JitContext *ctx, unsigned char prefix, unsigned char opcode, int reg, int rm)
+{
+	unsigned char code[5];
+	int n = 0;
+
+	if (prefix)
+		code[n++] = prefix;
+	if (reg >= 8 || rm >= 8)
+		code[n++] = 0x40 | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0);
+	code[n++] = 0x0f;
+	code[n++] = opcode;
+	code[n++] = 0xc0 | ((reg & 7) << 3) | (rm & 7);
+
+	avs_jit_emit(ctx, code, n);
+}
+
+/* movss between an xmm register and [rax], or [rsp + disp] with a frame offset */
+static void emit_movss_mem(JitContext *ctx, int store, int xmm, int disp)
+{
+	unsigned char code[8];
+	int n = 0;
+
+	code[n++] = 0xf3;
+	if (xmm >= 8)
+		code[n++] = 0x44;
+	code[n++] = 0x0f;
+	code[n++] = store ? 0x11 : 0x10;
+
+	if (disp < 0) {
+		code[n++] = ((xmm & 7) << 3) | REG_RAX;
+	} else {
+		code[n++] = 0x44 | ((xmm & 7) << 3);
+		code[n++] = 0x24;
+		code[n++] = disp;
+	}
+
+	avs_jit_emit(ctx, code, n);
+}
+
+void avs_jit_arch_prologue(JitContext *ctx)
+{
+	/* push rbp; mov rbp, rsp; push rbx; sub rsp, frame */
+	unsigned char code[] = { 0x55, 0x48, 0x89, 0xe5, 0x53, 0x48, 0x81, 0xec, 0, 0, 0, 0 };
+	int frame = frame_size(ctx);
+
+	memcpy(&code[8], &frame, 4);
+	avs_jit_emit(ctx, code, sizeof(code));
+}
+
+void avs_jit_arch_epilogue(JitContext *ctx)
+{
+	/* add rsp, frame; pop rbx; pop rbp; xor eax, eax; ret */
+	unsigned char code[] = { 0x48, 0x81, 0xc4, 0, 0, 0, 0, 0x5b, 0x5d, 0x31, 0xc0, 0xc3 };
+	int frame = frame_size(ctx);
+
+	memcpy(&code[3], &frame, 4);
+	avs_jit_emit(ctx, code, sizeof(code));
+}
+
+void avs_jit_arch_load(JitContext *ctx, int temp, JitSlot *slot)
+{
+	if (slot->reg >= 0) {
+		/* movaps, copies the whole register without merging */
+		emit_sse_rr(ctx, 0, 0x28, temp, PINNED_XMM(slot));
+		return;
+	}
+
+	emit_mov_imm64(ctx, REG_RAX, slot->ref);
+	emit_movss_mem(ctx, FALSE, temp, -1);
+}
+
+void avs_jit_arch_store(JitContext *ctx, JitSlot *slot, int temp)
+{
+	if (slot->reg >= 0) {
+		emit_sse_rr(ctx, 0, 0x28, PINNED_XMM(slot), temp);
+		return;
+	}
+
+	emit_mov_imm64(ctx, REG_RAX, slot->ref);
+	emit_movss_mem(ctx, TRUE, temp, -1);
+}
+
+void avs_jit_arch_pin_load(JitContext *ctx, JitSlot *slot)
+{
+	emit_mov_imm64(ctx, REG_RAX, slot->ref);
+	emit_movss_mem(ctx, FALSE, PINNED_XMM(slot), -1);
+}
+
+void avs_jit_arch_pin_store(JitContext *ctx, JitSlot *slot)
+{
+	emit_mov_imm64(ctx, REG_RAX, slot->ref);
+	emit_movss_mem(ctx, TRUE, PINNED_XMM(slot), -1);
+}
+
+void avs_jit_arch_spill(JitContext *ctx, JitSlot *slot, int unspill)
+{
+	emit_movss_mem(ctx, !unspill, PINNED_XMM(slot), slot->reg * 4);
+}
+
+void avs_jit_arch_op(JitContext *ctx, JitOp op)
+{
+	/* cvttss2si rax, xmm0; cvttss2si rcx, xmm1 */
+	static const unsigned char to_int[] = {
+		0xf3, 0x48, 0x0f, 0x2c, 0xc0, 0xf3, 0x48, 0x0f, 0x2c, 0xc9 };
+	/* mov eax, eax; cvtsi2ss xmm0, rax */
+	static const unsigned char from_int[] = {
+		0x89, 0xc0, 0xf3, 0x48, 0x0f, 0x2a, 0xc0 };
+	/* test ecx, ecx; jnz 1f; xor eax, eax; jmp 2f; 1: xor edx, edx; div ecx; mov eax, edx; 2: */
+	static const unsigned char mod[] = {
+		0x85, 0xc9, 0x75, 0x04, 0x31, 0xc0, 0xeb, 0x06, 0x31, 0xd2, 0xf7, 0xf1, 0x89, 0xd0 };
+	/* movd eax, xmm0; xor or and eax, mask; movd xmm0, eax */
+	unsigned char sign[] = {
+		0x66, 0x0f, 0x7e, 0xc0, 0x35, 0x00, 0x00, 0x00, 0x80, 0x66, 0x0f, 0x6e, 0xc0 };
+
+	switch (op) {
+		case JitOpAdd:
+			emit_sse_rr(ctx, 0xf3, 0x58, JIT_T0, JIT_T1);
+			break;
+
+		case JitOpSub:
+			emit_sse_rr(ctx, 0xf3, 0x5c, JIT_T0, JIT_T1);
+			break;
+
+		case JitOpMul:
+			emit_sse_rr(ctx, 0xf3, 0x59, JIT_T0, JIT_T1);
+			break;
+
+		case JitOpDiv:
+			emit_sse_rr(ctx, 0xf3, 0x5e, JIT_T0, JIT_T1);
+			break;
+
+		/* minss and maxss pick the second operand when unordered, like a < b ? a : b */
+		case JitOpMin:
+			emit_sse_rr(ctx, 0xf3, 0x5d, JIT_T0, JIT_T1);
+			break;
+
+		case JitOpMax:
+			emit_sse_rr(ctx, 0xf3, 0x5f, JIT_T0, JIT_T1);
+			break;
+
+		case JitOpSqrt:
+			emit_sse_rr(ctx, 0xf3, 0x51, JIT_T0, JIT_T0);
+			break;
+
+		case JitOpNegate:
+			avs_jit_emit(ctx, sign, sizeof(sign));
+			break;
+
+		case JitOpAbs:
+			sign[4] = 0x25;
+			sign[5] = sign[6] = sign[7] = 0xff;
+			sign[8] = 0x7f;
+			avs_jit_emit(ctx, sign, sizeof(sign));
+			break;
+
+		/* Same conversions as the (unsigned int) casts in the IX machine,
+		 * except that a modulo by zero gives zero instead of trapping */
+		case JitOpMod:
+		case JitOpAnd:
+		case JitOpOr: {
+			static const unsigned char and_code[] = { 0x21, 0xc8 };
+			static const unsigned char or_code[] = { 0x09, 0xc8 };
+
+			avs_jit_emit(ctx, to_int, sizeof(to_int));
+			if (op == JitOpMod)
+				avs_jit_emit(ctx, mod, sizeof(mod));
+			else
+				avs_jit_emit(ctx, op == JitOpAnd ? and_code : or_code, 2);
+			avs_jit_emit(ctx, from_int, sizeof(from_int));
+			break;
+		}
+	}
+}
+
+void avs_jit_arch_compare(JitContext *ctx)
+{
+	/* ucomiss xmm0, xmm1; sete al; setnp cl; and al, cl; movzx ebx, al */
+	static const unsigned char code[] = {
+		0x0f, 0x2e, 0xc1, 0x0f, 0x94, 0xc0, 0x0f, 0x9b, 0xc1, 0x20, 0xc8, 0x0f, 0xb6, 0xd8 };
+
+	avs_jit_emit(ctx, code, sizeof(code));
+}
+
+void avs_jit_arch_jump(JitContext *ctx, JitJump type)
+{
+	/* jmp rel32, or test ebx, ebx; jnz/jz rel32 */
+	static const unsigned char jmp[] = { 0xe9, 0, 0, 0, 0 };
+	unsigned char jcc[] = { 0x85, 0xdb, 0x0f, 0x85, 0, 0, 0, 0 };
+
+	if (type == JitJumpAlways) {
+		avs_jit_emit(ctx, jmp, sizeof(jmp));
+		return;
+	}
+
+	if (type == JitJumpNotEqual)
+		jcc[3] = 0x84;
+
+	avs_jit_emit(ctx, jcc, sizeof(jcc));
+}
+
+void avs_jit_arch_link(JitContext *ctx, JitFixup *fixup, size_t target)
+{
+	size_t end = fixup->position + (fixup->type == JitJumpAlways ? 5 : 8);
+	int32_t rel = (int32_t) (target - end);
+
+	memcpy(ctx->buf + end - 4, &rel, 4);
+}
+
+void avs_jit_arch_call_math(JitContext *ctx, void *fn)
+{
+	/* cvtss2sd xmm0, xmm0; cvtss2sd xmm1, xmm1 */
+	static const unsigned char widen[] = { 0xf3, 0x0f, 0x5a, 0xc0, 0xf3, 0x0f, 0x5a, 0xc9 };
+	/* call rax; cvtsd2ss xmm0, xmm0 */
+	static const unsigned char call[] = { 0xff, 0xd0, 0xf2, 0x0f, 0x5a, 0xc0 };
+
+	avs_jit_emit(ctx, widen, sizeof(widen));
+	emit_mov_imm64(ctx, REG_RAX, fn);
+	avs_jit_emit(ctx, call, sizeof(call));
+}
+
+void avs_jit_arch_call(JitContext *ctx, IXOpcode *op)
+{
+	/* mov ecx, argc */
+	unsigned char argc[] = { 0xb9, 0, 0, 0, 0 };
+	static const unsigned char call[] = { 0xff, 0xd0 };
+
+	emit_mov_imm64(ctx, REG_RDI, ctx->runnable);
+	emit_mov_imm64(ctx, REG_RSI, op->reg[0]);
+	emit_mov_imm64(ctx, REG_RDX, op->ex.call.argv);
+	memcpy(&argc[1], &op->ex.call.argc, 4);
+	avs_jit_emit(ctx, argc, sizeof(argc));
+	emit_mov_imm64(ctx, REG_RAX, op->ex.call.call->run);
+	avs_jit_emit(ctx, call, sizeof(call));
+}
+
+void avs_jit_arch_ref_load(JitContext *ctx, IXRegisterReference *ref, AvsNumber *target)
+{
+	/* mov [rcx], rax */
+	static const unsigned char store[] = { 0x48, 0x89, 0x01 };
+
+	emit_mov_imm64(ctx, REG_RAX, target);
+	emit_mov_imm64(ctx, REG_RCX, &ref->ref);
+	avs_jit_emit(ctx, store, sizeof(store));
+}
+
+void avs_jit_arch_ref_store(JitContext *ctx, IXRegisterReference *ref, int temp)
+{
+	/* mov rax, [rax] */
+	static const unsigned char load[] = { 0x48, 0x8b, 0x00 };
+
+	emit_mov_imm64(ctx, REG_RAX, &ref->ref);
+	avs_jit_emit(ctx, load, sizeof(load));
+	emit_movss_mem(ctx, TRUE, temp, -1);
+}
+
+void avs_jit_arch_flush(void *code, size_t size)
+{
+	/* Instruction and data caches are coherent on x86 */
+	(void) code;
+	(void) size;
+}
+
+#endif /* __x86_64__ */
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include "avs.h"
+#include "avs_jit.h"
+
+#if defined(__aarch64__)
+
+/*
+ * AArch64 backend, AAPCS64 calling convention.
+ *
+ * s0 and s1 are the temporaries, s16 to s31 hold pinned numbers.  Those are
+ * caller saved, so pinned numbers are spilled to the stack frame around calls.
+ * x16 and x17 are scratch, w19 keeps the last compare result between a cmp
+ * and its branch.
+ */
+
+#define REG_X16		16
+#define REG_X17		17
+#define REG_X19		19
+#define REG_SP		31
+
+#define PINNED_S(slot)	((slot)->reg + 16)
+
+const int avs_jit_arch_registers = 16;
+
+static int frame_size(JitContext *ctx)
+{
+	return (ctx->npinned * 4 + 15) & ~15;
+}
+
+static void emit32(JitContext *ctx, uint32_t insn)
+{
+	avs_jit_emit(ctx, &insn, 4);
+}
+
+/* movz and movk, one per non zero halfword */
+static void emit_mov_imm64(JitContext *ctx, int reg, const void *imm)
+{
+	uint64_t value = (uintptr_t) imm;
+	int hw;
+
+	emit32(ctx, 0xd2800000 | ((value & 0xffff) << 5) | reg);
+	for (hw = 1; hw < 4; hw++) {
+		uint32_t part = (value >> (hw * 16)) & 0xffff;
+
+		if (part != 0)
+			emit32(ctx, 0xf2800000 | (hw << 21) | (part << 5) | reg);
+	}
+}
+
+/* ldr/str st, [xn, #offset] */
+static void emit_ldst_s(JitContext *ctx, int store, int st, int xn, int offset)
+{
+	emit32(ctx, (store ? 0xbd000000 : 0xbd400000) | ((offset / 4) << 10) | (xn << 5) | st);
+}
+
+/* fmov sd, sn */
+static void emit_fmov(JitContext *ctx, int sd, int sn)
+{
+	emit32(ctx, 0x1e204000 | (sn << 5) | sd);
+}
+
+void avs_jit_arch_prologue(JitContext *ctx)
+{
+	int frame = frame_size(ctx);
+
+	emit32(ctx, 0xa9be7bfd);	/* stp x29, x30, [sp, #-32]! */
+	emit32(ctx, 0xf9000bf3);	/* str x19, [sp, #16] */
+	emit32(ctx, 0x910003fd);	/* mov x29, sp */
+	if (frame)
+		emit32(ctx, 0xd10003ff | (frame << 10));	/* sub sp, sp, #frame */
+}
+
+void avs_jit_arch_epilogue(JitContext *ctx)
+{
+	int frame = frame_size(ctx);
+
+	if (frame)
+		emit32(ctx, 0x910003ff | (frame << 10));	/* add sp, sp, #frame */
+	emit32(ctx, 0xf9400bf3);	/* ldr x19, [sp, #16] */
+	emit32(ctx, 0xa8c27bfd);	/* ldp x29, x30, [sp], #32 */
+	emit32(ctx, 0x52800000);	/* mov w0, #0 */
+	emit32(ctx, 0xd65f03c0);	/* ret */
+}
+
+void avs_jit_arch_load(JitContext *ctx, int temp, JitSlot *slot)
+{
+	if (slot->reg >= 0) {
+		emit_fmov(ctx, temp, PINNED_S(slot));
+		return;
+	}
+
+	emit_mov_imm64(ctx, REG_X16, slot->ref);
+	emit_ldst_s(ctx, FALSE, temp, REG_X16, 0);
+}
+
+void avs_jit_arch_store(JitContext *ctx, JitSlot *slot, int temp)
+{
+	if (slot->reg >= 0) {
+		emit_fmov(ctx, PINNED_S(slot), temp);
+		return;
+	}
+
+	emit_mov_imm64(ctx, REG_X16, slot->ref);
+	emit_ldst_s(ctx, TRUE, temp, REG_X16, 0);
+}
+
+void avs_jit_arch_pin_load(JitContext *ctx, JitSlot *slot)
+{
+	emit_mov_imm64(ctx, REG_X16, slot->ref);
+	emit_ldst_s(ctx, FALSE, PINNED_S(slot), REG_X16, 0);
+}
+
+void avs_jit_arch_pin_store(JitContext *ctx, JitSlot *slot)
+{
+	emit_mov_imm64(ctx, REG_X16, slot->ref);
+	emit_ldst_s(ctx, TRUE, PINNED_S(slot), REG_X16, 0);
+}
+
+void avs_jit_arch_spill(JitContext *ctx, JitSlot *slot, int unspill)
+{
+	emit_ldst_s(ctx, !unspill, PINNED_S(slot), REG_SP, slot->reg * 4);
+}
+
+void avs_jit_arch_op(JitContext *ctx, JitOp op)
+{
+	switch (op) {
+		case JitOpAdd:
+			emit32(ctx, 0x1e212800);	/* fadd s0, s0, s1 */
+			break;
+
+		case JitOpSub:
+			emit32(ctx, 0x1e213800);	/* fsub s0, s0, s1 */
+			break;
+
+		case JitOpMul:
+			emit32(ctx, 0x1e210800);	/* fmul s0, s0, s1 */
+			break;
+
+		case JitOpDiv:
+			emit32(ctx, 0x1e211800);	/* fdiv s0, s0, s1 */
+			break;
+
+		/* Not fmin and fmax, a < b ? a : b picks b when unordered */
+		case JitOpMin:
+			emit32(ctx, 0x1e212000);	/* fcmp s0, s1 */
+			emit32(ctx, 0x1e214c00);	/* fcsel s0, s0, s1, mi */
+			break;
+
+		case JitOpMax:
+			emit32(ctx, 0x1e212000);	/* fcmp s0, s1 */
+			emit32(ctx, 0x1e21cc00);	/* fcsel s0, s0, s1, gt */
+			break;
+
+		case JitOpSqrt:
+			emit32(ctx, 0x1e21c000);	/* fsqrt s0, s0 */
+			break;
+
+		case JitOpNegate:
+			emit32(ctx, 0x1e214000);	/* fneg s0, s0 */
+			break;
+
+		case JitOpAbs:
+			emit32(ctx, 0x1e20c000);	/* fabs s0, s0 */
+			break;
+
+		/* Same conversions as the (unsigned int) casts in the IX machine */
+		case JitOpMod:
+		case JitOpAnd:
+		case JitOpOr:
+			emit32(ctx, 0x1e390000);	/* fcvtzu w0, s0 */
+			emit32(ctx, 0x1e390021);	/* fcvtzu w1, s1 */
+
+			if (op == JitOpMod) {
+				emit32(ctx, 0x1ac10802);	/* udiv w2, w0, w1 */
+				emit32(ctx, 0x1b018040);	/* msub w0, w2, w1, w0 */
+			} else if (op == JitOpAnd) {
+				emit32(ctx, 0x0a010000);	/* and w0, w0, w1 */
+			} else {
+				emit32(ctx, 0x2a010000);	/* orr w0, w0, w1 */
+			}
+
+			emit32(ctx, 0x1e230000);	/* ucvtf s0, w0 */
+			break;
+	}
+}
+
+void avs_jit_arch_compare(JitContext *ctx)
+{
+	emit32(ctx, 0x1e212000);	/* fcmp s0, s1 */
+	emit32(ctx, 0x1a9f17f3);	/* cset w19, eq */
+}
+
+void avs_jit_arch_jump(JitContext *ctx, JitJump type)
+{
+	switch (type) {
+		case JitJumpAlways:
+			emit32(ctx, 0x14000000);		/* b */
+			break;
+
+		case JitJumpEqual:
+			emit32(ctx, 0x35000000 | REG_X19);	/* cbnz w19 */
+			break;
+
+		case JitJumpNotEqual:
+			emit32(ctx, 0x34000000 | REG_X19);	/* cbz w19 */
+			break;
+	}
+}
+
+void avs_jit_arch_link(JitContext *ctx, JitFixup *fixup, size_t target)
+{
+	int32_t rel = ((int32_t) target - (int32_t) fixup->position) / 4;
+	uint32_t insn;
+
+	memcpy(&insn, ctx->buf + fixup->position, 4);
+
+	if (fixup->type == JitJumpAlways)
+		insn |= rel & 0x3ffffff;
+	else
+		insn |= (rel & 0x7ffff) << 5;
+
+	memcpy(ctx->buf + fixup->position, &insn, 4);
+}
+
+void avs_jit_arch_call_math(JitContext *ctx, void *fn)
+{
+	emit32(ctx, 0x1e22c000);	/* fcvt d0, s0 */
+	emit32(ctx, 0x1e22c021);	/* fcvt d1, s1 */
+	emit_mov_imm64(ctx, REG_X16, fn);
+	emit32(ctx, 0xd63f0200);	/* blr x16 */
+	emit32(ctx, 0x1e624000);	/* fcvt s0, d0 */
+}
+
+void avs_jit_arch_call(JitContext *ctx, IXOpcode *op)
+{
+	emit_mov_imm64(ctx, 0, ctx->runnable);
+	emit_mov_imm64(ctx, 1, op->reg[0]);
+	emit_mov_imm64(ctx, 2, op->ex.call.argv);
+	emit32(ctx, 0x52800003 | (op->ex.call.argc << 5));	/* mov w3, #argc */
+	emit_mov_imm64(ctx, REG_X16, op->ex.call.call->run);
+	emit32(ctx, 0xd63f0200);	/* blr x16 */
+}
+
+void avs_jit_arch_ref_load(JitContext *ctx, IXRegisterReference *ref, AvsNumber *target)
+{
+	emit_mov_imm64(ctx, REG_X16, target);
+	emit_mov_imm64(ctx, REG_X17, &ref->ref);
+	emit32(ctx, 0xf9000230);	/* str x16, [x17] */
+}
+
+void avs_jit_arch_ref_store(JitContext *ctx, IXRegisterReference *ref, int temp)
+{
+	emit_mov_imm64(ctx, REG_X16, &ref->ref);
+	emit32(ctx, 0xf9400210);	/* ldr x16, [x16] */
+	emit_ldst_s(ctx, TRUE, temp, REG_X16, 0);
+}
+
+void avs_jit_arch_flush(void *code, size_t size)
+{
+	__builtin___clear_cache((char *) code, (char *) code + size);
+}
+
+#endif /* __aarch64__ */
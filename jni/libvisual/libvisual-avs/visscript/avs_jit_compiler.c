@@ -0,0 +1,455 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <sys/mman.h>
+
+#include "avs.h"
+#include "avs_jit.h"
+
+extern ILCore il_core_ix;
+
+#ifdef AVS_JIT_NATIVE
+
+/* Builtins short enough to generate inline, sqr is a multiply by itself */
+static const struct {
+	char	*name;
+	int	argc;
+	JitOp	op;
+} inline_functions[] = {
+	{ "sqr",	1,	JitOpMul,	},
+	{ "abs",	1,	JitOpAbs,	},
+	{ "sqrt",	1,	JitOpSqrt,	},
+	{ "min",	2,	JitOpMin,	},
+	{ "max",	2,	JitOpMax,	},
+	{ NULL, },
+};
+
+/* Builtins that only wrap libm, called directly with the value in a register */
+static const struct {
+	char	*name;
+	int	argc;
+	void	*fn;
+} math_functions[] = {
+	{ "sin",	1,	(void *) sin,	},
+	{ "cos",	1,	(void *) cos,	},
+	{ "tan",	1,	(void *) tan,	},
+	{ "asin",	1,	(void *) asin,	},
+	{ "acos",	1,	(void *) acos,	},
+	{ "atan",	1,	(void *) atan,	},
+	{ "atan2",	2,	(void *) atan2,	},
+	{ "pow",	2,	(void *) pow,	},
+	{ "exp",	1,	(void *) exp,	},
+	{ "log",	1,	(void *) log,	},
+	{ "log10",	1,	(void *) log10,	},
+	{ "floor",	1,	(void *) floor,	},
+	{ "ceil",	1,	(void *) ceil,	},
+	{ NULL, },
+};
+
+void avs_jit_emit(JitContext *ctx, const void *data, size_t size)
+{
+	if (ctx->position + size > ctx->length) {
+		ctx->length = (ctx->position + size) * 2;
+		ctx->buf = realloc(ctx->buf, ctx->length);
+	}
+
+	memcpy(ctx->buf + ctx->position, data, size);
+	ctx->position += size;
+}
+
+void avs_jit_emit_fixup(JitContext *ctx, JitJump type, IXOpcode *dest)
+{
+	JitFixup *fixup;
+
+	ctx->fixups = realloc(ctx->fixups, sizeof(JitFixup) * (ctx->nfixups + 1));
+	fixup = &ctx->fixups[ctx->nfixups++];
+	fixup->position = ctx->position;
+	fixup->type = type;
+	fixup->dest = dest;
+
+	avs_jit_arch_jump(ctx, type);
+}
+
+static JitSlot * slot_get(JitContext *ctx, AvsNumber *ref)
+{
+	int i;
+
+	for (i = 0; i < ctx->nslots; i++) {
+		if (ctx->slots[i].ref == ref)
+			return &ctx->slots[i];
+	}
+
+	return NULL;
+}
+
+static void slot_use(JitContext *ctx, AvsNumber *ref, int written)
+{
+	JitSlot *slot = slot_get(ctx, ref);
+
+	if (!slot) {
+		if ((ctx->nslots & 31) == 0)
+			ctx->slots = realloc(ctx->slots, sizeof(JitSlot) * (ctx->nslots + 32));
+
+		slot = &ctx->slots[ctx->nslots++];
+		memset(slot, 0, sizeof(JitSlot));
+		slot->ref = ref;
+		slot->reg = -1;
+	}
+
+	slot->uses++;
+	slot->written |= written;
+}
+
+static int slot_compare(const void *a, const void *b)
+{
+	const JitSlot *sa = *(JitSlot * const *) a, *sb = *(JitSlot * const *) b;
+
+	return sb->uses - sa->uses;
+}
+
+/* Collects every number the program touches and pins the most used ones */
+static void slots_assign(JitContext *ctx, IXRunnableData *rd)
+{
+	JitSlot **order;
+	IXOpcode *op;
+	int i;
+
+	for (op = rd->base; op != NULL; op = op->next) {
+		switch (op->opcode) {
+			case IXOpcodeCall:
+				slot_use(ctx, op->reg[0], TRUE);
+				for (i = 0; i < op->ex.call.argc; i++)
+					slot_use(ctx, op->ex.call.argv[i], FALSE);
+				break;
+
+			case IXOpcodeNegate:
+			case IXOpcodeLoadRef:
+				slot_use(ctx, op->reg[0], TRUE);
+				slot_use(ctx, op->reg[1], FALSE);
+				break;
+
+			case IXOpcodeAssign:
+			case IXOpcodeStoreRef:
+				slot_use(ctx, op->reg[0], TRUE);
+				slot_use(ctx, op->reg[1], TRUE);
+				slot_use(ctx, op->reg[2], FALSE);
+				break;
+
+			case IXOpcodeAdd:
+			case IXOpcodeSub:
+			case IXOpcodeMul:
+			case IXOpcodeDiv:
+			case IXOpcodeMod:
+			case IXOpcodeAnd:
+			case IXOpcodeOr:
+				slot_use(ctx, op->reg[0], TRUE);
+				slot_use(ctx, op->reg[1], FALSE);
+				slot_use(ctx, op->reg[2], FALSE);
+				break;
+
+			case IXOpcodeCmp:
+				slot_use(ctx, op->reg[0], FALSE);
+				slot_use(ctx, op->reg[1], FALSE);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	/* Anything a reference may point at is stored through that pointer */
+	for (op = rd->base; op != NULL; op = op->next) {
+		if (op->opcode == IXOpcodeLoadRef)
+			slot_get(ctx, op->reg[1])->aliased = TRUE;
+	}
+
+	order = malloc(sizeof(JitSlot *) * (ctx->nslots + 1));
+	for (i = 0; i < ctx->nslots; i++)
+		order[i] = &ctx->slots[i];
+
+	qsort(order, ctx->nslots, sizeof(JitSlot *), slot_compare);
+
+	ctx->pinned = order;
+	ctx->npinned = 0;
+
+	for (i = 0; i < ctx->nslots && ctx->npinned < avs_jit_arch_registers; i++) {
+		if (order[i]->aliased || order[i]->uses < 2)
+			continue;
+
+		order[i]->reg = ctx->npinned;
+		order[ctx->npinned++] = order[i];
+	}
+}
+
+static void spill_all(JitContext *ctx, int unspill)
+{
+	int i;
+
+	for (i = 0; i < ctx->npinned; i++)
+		avs_jit_arch_spill(ctx, ctx->pinned[i], unspill);
+}
+
+static void translate_call(JitContext *ctx, IXOpcode *op)
+{
+	AvsRunnableFunction *fn = op->ex.call.call;
+	int argc = op->ex.call.argc;
+	JitSlot *slot;
+	int i;
+
+	for (i = 0; inline_functions[i].name != NULL; i++) {
+		if (argc != inline_functions[i].argc || strcmp(fn->name, inline_functions[i].name) != 0)
+			continue;
+
+		avs_jit_arch_load(ctx, JIT_T0, slot_get(ctx, op->ex.call.argv[0]));
+		avs_jit_arch_load(ctx, JIT_T1, slot_get(ctx, op->ex.call.argv[argc - 1]));
+		avs_jit_arch_op(ctx, inline_functions[i].op);
+		avs_jit_arch_store(ctx, slot_get(ctx, op->reg[0]), JIT_T0);
+		return;
+	}
+
+	for (i = 0; math_functions[i].name != NULL; i++) {
+		if (argc != math_functions[i].argc || strcmp(fn->name, math_functions[i].name) != 0)
+			continue;
+
+		avs_jit_arch_load(ctx, JIT_T0, slot_get(ctx, op->ex.call.argv[0]));
+		avs_jit_arch_load(ctx, JIT_T1, slot_get(ctx, op->ex.call.argv[argc - 1]));
+		spill_all(ctx, FALSE);
+		avs_jit_arch_call_math(ctx, math_functions[i].fn);
+		spill_all(ctx, TRUE);
+		avs_jit_arch_store(ctx, slot_get(ctx, op->reg[0]), JIT_T0);
+		return;
+	}
+
+	/* Anything else reads its arguments through pointers */
+	for (i = 0; i < argc; i++) {
+		slot = slot_get(ctx, op->ex.call.argv[i]);
+		if (slot->reg >= 0 && slot->written)
+			avs_jit_arch_pin_store(ctx, slot);
+	}
+
+	spill_all(ctx, FALSE);
+	avs_jit_arch_call(ctx, op);
+	spill_all(ctx, TRUE);
+
+	slot = slot_get(ctx, op->reg[0]);
+	if (slot->reg >= 0)
+		avs_jit_arch_pin_load(ctx, slot);
+}
+
+static void translate_opcode(JitContext *ctx, IXOpcode *op)
+{
+	static const JitOp ops[] = {
+		[IXOpcodeAdd]	= JitOpAdd,	[IXOpcodeSub]	= JitOpSub,
+		[IXOpcodeMul]	= JitOpMul,	[IXOpcodeDiv]	= JitOpDiv,
+		[IXOpcodeMod]	= JitOpMod,	[IXOpcodeAnd]	= JitOpAnd,
+		[IXOpcodeOr]	= JitOpOr,
+	};
+
+	switch (op->opcode) {
+		case IXOpcodeCall:
+			translate_call(ctx, op);
+			break;
+
+		case IXOpcodeNegate:
+			avs_jit_arch_load(ctx, JIT_T0, slot_get(ctx, op->reg[1]));
+			avs_jit_arch_op(ctx, JitOpNegate);
+			avs_jit_arch_store(ctx, slot_get(ctx, op->reg[0]), JIT_T0);
+			break;
+
+		case IXOpcodeAssign:
+			avs_jit_arch_load(ctx, JIT_T0, slot_get(ctx, op->reg[2]));
+			avs_jit_arch_store(ctx, slot_get(ctx, op->reg[1]), JIT_T0);
+			avs_jit_arch_store(ctx, slot_get(ctx, op->reg[0]), JIT_T0);
+			break;
+
+		case IXOpcodeAdd:
+		case IXOpcodeSub:
+		case IXOpcodeMul:
+		case IXOpcodeDiv:
+		case IXOpcodeMod:
+		case IXOpcodeAnd:
+		case IXOpcodeOr:
+			avs_jit_arch_load(ctx, JIT_T0, slot_get(ctx, op->reg[1]));
+			avs_jit_arch_load(ctx, JIT_T1, slot_get(ctx, op->reg[2]));
+			avs_jit_arch_op(ctx, ops[op->opcode]);
+			avs_jit_arch_store(ctx, slot_get(ctx, op->reg[0]), JIT_T0);
+			break;
+
+		case IXOpcodeCmp:
+			avs_jit_arch_load(ctx, JIT_T0, slot_get(ctx, op->reg[0]));
+			avs_jit_arch_load(ctx, JIT_T1, slot_get(ctx, op->reg[1]));
+			avs_jit_arch_compare(ctx);
+			break;
+
+		case IXOpcodeJmp:
+			avs_jit_emit_fixup(ctx, JitJumpAlways, op->ex.jmp.dest);
+			break;
+
+		case IXOpcodeJmpZ:
+			avs_jit_emit_fixup(ctx, JitJumpEqual, op->ex.jmp.dest);
+			break;
+
+		case IXOpcodeJmpNz:
+			avs_jit_emit_fixup(ctx, JitJumpNotEqual, op->ex.jmp.dest);
+			break;
+
+		case IXOpcodeLoadRef:
+			avs_jit_arch_load(ctx, JIT_T0, slot_get(ctx, op->reg[1]));
+			avs_jit_arch_store(ctx, slot_get(ctx, op->reg[0]), JIT_T0);
+			avs_jit_arch_ref_load(ctx, op->ex.ref, op->reg[1]);
+			break;
+
+		case IXOpcodeStoreRef:
+			avs_jit_arch_load(ctx, JIT_T0, slot_get(ctx, op->reg[2]));
+			avs_jit_arch_store(ctx, slot_get(ctx, op->reg[1]), JIT_T0);
+			avs_jit_arch_store(ctx, slot_get(ctx, op->reg[0]), JIT_T0);
+			avs_jit_arch_ref_store(ctx, op->ex.ref, JIT_T0);
+			break;
+
+		default:
+			break;
+	}
+}
+
+static void translate(JitContext *ctx, IXRunnableData *rd)
+{
+	IXOpcode *op;
+	size_t *offsets, exit;
+	int count, i, j;
+
+	for (count = 0, op = rd->base; op != NULL; op = op->next)
+		count++;
+
+	offsets = malloc(sizeof(size_t) * (count + 1));
+
+	avs_jit_arch_prologue(ctx);
+	for (i = 0; i < ctx->npinned; i++)
+		avs_jit_arch_pin_load(ctx, ctx->pinned[i]);
+
+	for (i = 0, op = rd->base; op != NULL; op = op->next, i++) {
+		offsets[i] = ctx->position;
+		translate_opcode(ctx, op);
+	}
+
+	exit = ctx->position;
+	for (i = 0; i < ctx->npinned; i++) {
+		if (ctx->pinned[i]->written)
+			avs_jit_arch_pin_store(ctx, ctx->pinned[i]);
+	}
+	avs_jit_arch_epilogue(ctx);
+
+	for (i = 0; i < ctx->nfixups; i++) {
+		size_t target = exit;
+
+		for (j = 0, op = rd->base; op != NULL; op = op->next, j++) {
+			if (op == ctx->fixups[i].dest) {
+				target = offsets[j];
+				break;
+			}
+		}
+
+		avs_jit_arch_link(ctx, &ctx->fixups[i], target);
+	}
+
+	free(offsets);
+}
+
+static void * jit_map(JitContext *ctx)
+{
+	void *code;
+
+	code = mmap(NULL, ctx->position, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (code == MAP_FAILED)
+		return NULL;
+
+	memcpy(code, ctx->buf, ctx->position);
+
+	if (mprotect(code, ctx->position, PROT_READ | PROT_EXEC) != 0) {
+		munmap(code, ctx->position);
+		return NULL;
+	}
+
+	avs_jit_arch_flush(code, ctx->position);
+
+	return code;
+}
+
+static int jit_compile(AvsRunnable *obj)
+{
+	IXRunnableData *rd = IX_RUNNABLE_DATA(obj);
+	JitContext ctx;
+
+	memset(&ctx, 0, sizeof(JitContext));
+	ctx.runnable = obj;
+
+	slots_assign(&ctx, rd);
+	translate(&ctx, rd);
+
+	rd->native = jit_map(&ctx);
+	rd->native_size = ctx.position;
+
+	avs_debug(print("JIT: %d numbers, %d pinned, %d bytes of code at %p",
+				ctx.nslots, ctx.npinned, (int) ctx.position, rd->native));
+
+	free(ctx.buf);
+	free(ctx.slots);
+	free(ctx.pinned);
+	free(ctx.fixups);
+
+	return rd->native != NULL ? VISUAL_OK : VISUAL_ERROR_GENERAL;
+}
+
+#endif /* AVS_JIT_NATIVE */
+
+static void jit_unmap(IXRunnableData *rd)
+{
+	if (rd == NULL || rd->native == NULL)
+		return;
+
+	munmap(rd->native, rd->native_size);
+	rd->native = NULL;
+}
+
+static IL_CORE_COMPILE(avs_jit_compiler_compile)
+{
+	IXRunnableData *prev = IX_RUNNABLE_DATA(obj);
+	int ret;
+
+	avs_debug(print("JIT: Compiling started..."));
+
+	/* The IX core lowers the IL, and stays the fallback */
+	if ((ret = il_core_ix.compile(ctx, tree, obj)) != 0)
+		return ret;
+
+	jit_unmap(prev);
+
+#ifdef AVS_JIT_NATIVE
+	if (jit_compile(obj) == VISUAL_OK)
+		obj->run = (AvsRunnableExecuteCall) IX_RUNNABLE_DATA(obj)->native;
+#endif
+
+	avs_debug(print("JIT: Compiling finished..."));
+	return 0;
+}
+
+static IL_CORE_RUNNABLE_CLEANUP(avs_jit_compiler_runnable_cleanup)
+{
+	jit_unmap(IX_RUNNABLE_DATA(obj));
+	return 0;
+}
+
+static IL_CORE_INIT(avs_jit_compiler_init)
+{
+	return il_core_ix.init(ctx);
+}
+
+ILCore il_core_jit =
+{
+	.name			=	"Native JIT",
+	.init			=	avs_jit_compiler_init,
+	.compile		=	avs_jit_compiler_compile,
+	.runnable_cleanup	=	avs_jit_compiler_runnable_cleanup,
+};
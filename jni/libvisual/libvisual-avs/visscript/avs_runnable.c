@@ -170,9 +170,142 @@ int avs_runnable_execute(AvsRunnable *obj)
 	if (!obj->run)
 		return VISUAL_ERROR_GENERAL;
 
+	if (obj->ctx->executions != NULL)
+		(*obj->ctx->executions)++;
+
 	return obj->run(obj);
 }
 
+static int batch_dtor(VisObject *object)
+{
+	AvsRunnableBatch *batch = AVS_RUNNABLE_BATCH(object);
+
+	if (batch->pcore != NULL && batch->runnable->batch_cleanup != NULL)
+		batch->runnable->batch_cleanup(batch);
+
+	visual_object_unref(VISUAL_OBJECT(batch->runnable));
+
+	return VISUAL_OK;
+}
+
+/**
+ * Create a batch, to execute a compiled runnable object over many lanes at once.
+ *
+ * @param obj Runnable object, compiled with avs_runnable_compile().
+ * @param lanes Maximum number of lanes per execution.
+ *
+ * @see avs_runnable_batch_bind
+ * @return Newly created batch on success, NULL on failure.
+ */
+AvsRunnableBatch * avs_runnable_batch_new(AvsRunnable *obj, int lanes)
+{
+	AvsRunnableBatch *batch;
+
+	visual_return_val_if_fail(obj != NULL, NULL);
+	visual_return_val_if_fail(lanes > 0, NULL);
+
+	batch = visual_mem_new0(AvsRunnableBatch, 1);
+	visual_object_initialize(VISUAL_OBJECT(batch), TRUE, batch_dtor);
+
+	visual_object_ref(VISUAL_OBJECT(obj));
+	batch->runnable = obj;
+	batch->lanes = lanes;
+
+	return batch;
+}
+
+/**
+ * Bind a variable to an array holding one value per lane.
+ *
+ * Variables that are not bound keep a single value, as they do when
+ * the runnable is executed once per lane.
+ *
+ * @param batch Batch to bind the array to.
+ * @param name Name of the variable.
+ * @param array Array of at least as many values as the batch has lanes.
+ * @param flags AvsRunnableBatchInput, AvsRunnableBatchOutput or both.
+ *
+ * @return VISUAL_OK on success, VISUAL_ERROR_GENERAL on failure.
+ */
+int avs_runnable_batch_bind(AvsRunnableBatch *batch, char *name, AvsNumber *array, AvsRunnableBatchFlag flags)
+{
+	AvsRunnableBatchBinding *binding;
+	AvsRunnableVariable *var;
+
+	visual_return_val_if_fail(batch != NULL, VISUAL_ERROR_GENERAL);
+	visual_return_val_if_fail(array != NULL, VISUAL_ERROR_GENERAL);
+
+	var = avs_runnable_variable_find(batch->runnable->variable_manager, name);
+	if (var == NULL || batch->nbindings >= AVS_RUNNABLE_BATCH_MAX_BINDINGS)
+		return VISUAL_ERROR_GENERAL;
+
+	binding = &batch->bindings[batch->nbindings++];
+	binding->variable = var;
+	binding->array = array;
+	binding->flags = flags;
+
+	return VISUAL_OK;
+}
+
+/**
+ * Execute a batch lane by lane, through the variables the bound arrays belong to.
+ * Used for cores without batch support and for code that can't run on all lanes at once.
+ *
+ * @param batch Batch to execute.
+ * @param count Number of lanes to run.
+ *
+ * @return VISUAL_OK on success, VISUAL_ERROR_GENERAL on failure.
+ */
+int avs_runnable_batch_execute_lanes(AvsRunnableBatch *batch, int count)
+{
+	AvsRunnable *obj = batch->runnable;
+	int lane, i;
+
+	if (!obj->run)
+		return VISUAL_ERROR_GENERAL;
+
+	for (lane = 0; lane < count; lane++) {
+		for (i = 0; i < batch->nbindings; i++) {
+			if (batch->bindings[i].flags & AvsRunnableBatchInput)
+				*batch->bindings[i].variable->value = batch->bindings[i].array[lane];
+		}
+
+		obj->run(obj);
+
+		for (i = 0; i < batch->nbindings; i++) {
+			if (batch->bindings[i].flags & AvsRunnableBatchOutput)
+				batch->bindings[i].array[lane] = *batch->bindings[i].variable->value;
+		}
+	}
+
+	return VISUAL_OK;
+}
+
+/**
+ * Execute a runnable object over the first @a count lanes of a batch.
+ *
+ * @param batch Batch to execute.
+ * @param count Number of lanes to run, at most the number of lanes of the batch.
+ *
+ * @return VISUAL_OK on success, VISUAL_ERROR_GENERAL on failure.
+ */
+int avs_runnable_batch_execute(AvsRunnableBatch *batch, int count)
+{
+	visual_return_val_if_fail(batch != NULL, VISUAL_ERROR_GENERAL);
+	visual_return_val_if_fail(count <= batch->lanes, VISUAL_ERROR_GENERAL);
+
+	if (count <= 0)
+		return VISUAL_OK;
+
+	if (batch->runnable->ctx->executions != NULL)
+		*batch->runnable->ctx->executions += count;
+
+	if (batch->runnable->batch != NULL)
+		return batch->runnable->batch(batch, count);
+
+	return avs_runnable_batch_execute_lanes(batch, count);
+}
+
 /**
  * Parse and compile code buffer into runnable object code.
  *
@@ -187,6 +320,14 @@ int avs_runnable_execute(AvsRunnable *obj)
  */
 int avs_runnable_compile(AvsRunnable *obj, unsigned char *data, unsigned int length)
 {
+	AvsCodeCacheEntry *entry;
+
+	/* Precompiled, skip straight to the core */
+	if (obj->ctx->cache != NULL && (entry = avs_code_cache_lookup(obj->ctx->cache, data, length)) != NULL) {
+		if (avs_bytecode_read(&obj->ctx->assembler, obj, entry->code, entry->code_length) == VISUAL_OK)
+			return VISUAL_OK;
+	}
+
 	/* Point lexer to new input data */
 	avs_lexer_reset(&obj->ctx->lexer, data, length);
 
@@ -205,13 +346,47 @@ int avs_runnable_compile(AvsRunnable *obj, unsigned char *data, unsigned int len
 	return VISUAL_OK;
 }
 
+/**
+ * Encode the code of a runnable object, for avs_runnable_load() to load later on.
+ * Has to follow avs_runnable_compile() directly, before the runnable context compiles anything else.
+ *
+ * @param obj Runnable Object, compiled last with its runnable context.
+ * @param code Location to store the newly allocated bytecode, free() it when done.
+ * @param length Location to store the bytecode length.
+ *
+ * @return VISUAL_OK on success, VISUAL_ERROR_GENERAL on failure.
+ */
+int avs_runnable_save(AvsRunnable *obj, unsigned char **code, unsigned int *length)
+{
+	visual_return_val_if_fail(obj != NULL, VISUAL_ERROR_GENERAL);
+
+	return avs_bytecode_write(&obj->ctx->assembler, obj, code, length);
+}
+
+/**
+ * Load bytecode saved with avs_runnable_save() into a runnable object, in place of compiling its source.
+ *
+ * @param obj Runnable Object, previously initialized or created with avs_runnable_new()
+ * @param code Bytecode to load.
+ * @param length Length of bytecode.
+ *
+ * @return VISUAL_OK on success, VISUAL_ERROR_GENERAL on invalid bytecode or a version mismatch.
+ */
+int avs_runnable_load(AvsRunnable *obj, const unsigned char *code, unsigned int length)
+{
+	visual_return_val_if_fail(obj != NULL, VISUAL_ERROR_GENERAL);
+
+	return avs_bytecode_read(&obj->ctx->assembler, obj, code, length);
+}
+
 static int runnable_dtor(VisObject *object)
 {	
 	AvsRunnable *obj = AVS_RUNNABLE(object);
 	//AvsRunnableVariable *var, *next;
 	
-	/* Cleanup assembler for output object */
+	/* Cleanup assembler and core for output object */
 	avs_il_runnable_cleanup(&obj->ctx->assembler, obj);
+	avs_il_core_runnable_cleanup(&obj->ctx->core, obj);
 
 	/* Cleanup variables */ // FIXME
 //	for (var=obj->variables; var != NULL; var=next) {
@@ -219,6 +394,8 @@ static int runnable_dtor(VisObject *object)
 //		visual_mem_free(var);
 //	}
 
+	free(obj->refs);
+
 	/* Cleanup blob manager */
 	visual_object_unref(VISUAL_OBJECT(&obj->bm));
 
@@ -246,6 +423,36 @@ void avs_runnable_set_variable_manager(AvsRunnable *obj, AvsRunnableVariableMana
 	obj->variable_manager = manager;
 }
 
+/**
+ * Get the variables the compiled code of a runnable object reads or writes.
+ *
+ * Together with avs_runnable_is_pure() this tells callers when results of an
+ * earlier run can be reused: pure code given the same values for these
+ * variables ends up with the same values again.
+ *
+ * @param obj Runnable Object, compiled or loaded.
+ * @param refs Location to store the array of variables, owned by the object.
+ *
+ * @return Number of variables in the array.
+ */
+int avs_runnable_get_references(AvsRunnable *obj, AvsRunnableVariable ***refs)
+{
+	*refs = obj->refs;
+	return obj->nrefs;
+}
+
+/**
+ * Check whether anything besides its variables can change what the code does.
+ *
+ * @param obj Runnable Object, compiled or loaded.
+ *
+ * @return TRUE when the code calls no random, audio, time or input builtins.
+ */
+int avs_runnable_is_pure(AvsRunnable *obj)
+{
+	return obj->pure;
+}
+
 /**
  * Initialize a static runnable object
  *
@@ -294,11 +501,18 @@ static int context_dtor(VisObject *object)
 	avs_compiler_cleanup(&ctx->compiler);
 	avs_il_cleanup(&ctx->assembler);
     avs_il_core_context_cleanup(&ctx->core);
+
+	if (ctx->cache != NULL)
+		visual_object_unref(VISUAL_OBJECT(ctx->cache));
+
 	return VISUAL_OK;
 }
 
 static int context_ctor(AvsRunnableContext *ctx)
 {
+	ctx->cache = NULL;
+	ctx->executions = NULL;
+
 	/* Initialize avs system contexts */
 	avs_il_core_context_init(&ctx->core);
 	avs_il_init(&ctx->assembler, &ctx->core);
@@ -343,3 +557,37 @@ AvsRunnableContext * avs_runnable_context_new(void)
 	context_ctor(ctx);
 	return ctx;
 }
+
+/**
+ * Set the code cache a runnable context looks up sources in before compiling them.
+ *
+ * @param ctx Runnable Context.
+ * @param cache Code cache to use, NULL to always compile.
+ */
+void avs_runnable_context_set_cache(AvsRunnableContext *ctx, AvsCodeCache *cache)
+{
+	visual_return_if_fail(ctx != NULL);
+
+	if (cache != NULL)
+		visual_object_ref(VISUAL_OBJECT(cache));
+
+	if (ctx->cache != NULL)
+		visual_object_unref(VISUAL_OBJECT(ctx->cache));
+
+	ctx->cache = cache;
+}
+
+/**
+ * Set the counter a runnable context adds every execution of its runnable objects to.
+ *
+ * Batches count one execution per lane. The counter is not updated atomically.
+ *
+ * @param ctx Runnable Context.
+ * @param executions Counter to add to, NULL to stop counting.
+ */
+void avs_runnable_context_set_counter(AvsRunnableContext *ctx, uint64_t *executions)
+{
+	visual_return_if_fail(ctx != NULL);
+
+	ctx->executions = executions;
+}
@@ -3,9 +3,18 @@
 
 #define AVS_RUNNABLE_CONTEXT(obj)	(VISUAL_CHECK_CAST ((obj), AvsRunnableContext))
 #define AVS_RUNNABLE(obj)		(VISUAL_CHECK_CAST ((obj), AvsRunnable))
+#define AVS_RUNNABLE_BATCH(obj)		(VISUAL_CHECK_CAST ((obj), AvsRunnableBatch))
+
+#define AVS_RUNNABLE_BATCH_MAX_BINDINGS	16
 
 enum _AvsRunnableVariableFlag;
 typedef enum _AvsRunnableVariableFlag AvsRunnableVariableFlag;
+enum _AvsRunnableBatchFlag;
+typedef enum _AvsRunnableBatchFlag AvsRunnableBatchFlag;
+struct _AvsRunnableBatch;
+typedef struct _AvsRunnableBatch AvsRunnableBatch;
+struct _AvsRunnableBatchBinding;
+typedef struct _AvsRunnableBatchBinding AvsRunnableBatchBinding;
 
 struct _AvsRunnableContext {
 	VisObject		object;
@@ -14,6 +23,8 @@ struct _AvsRunnableContext {
 	AvsCompilerContext	compiler;
 	AvsILAssemblerContext	assembler; //assembler->tree->base
 	ILCoreContext		core;
+	AvsCodeCache		*cache;		/* Precompiled sources, optional */
+	uint64_t		*executions;	/* Counts every run of the code, optional */
 };
 
 enum _AvsRunnableVariableFlag {
@@ -52,6 +63,8 @@ struct _AvsRunnableFunction {
 };
 
 typedef int (*AvsRunnableExecuteCall)(AvsRunnable *);
+typedef int (*AvsRunnableBatchCall)(AvsRunnableBatch *, int count);
+typedef void (*AvsRunnableBatchCleanupCall)(AvsRunnableBatch *);
 
 struct _AvsRunnable {
 	VisObject			object;
@@ -63,6 +76,40 @@ struct _AvsRunnable {
 	void				*pcore;
 
 	AvsRunnableExecuteCall		run;
+
+	/* Optional, cores without it run batches lane by lane */
+	AvsRunnableBatchCall		batch;
+	AvsRunnableBatchCleanupCall	batch_cleanup;
+
+	/* Variables the code refers to, pure when nothing else (random numbers,
+	 * audio, time, input) can change its results */
+	AvsRunnableVariable		**refs;
+	int				nrefs;
+	int				pure;
+};
+
+enum _AvsRunnableBatchFlag {
+	AvsRunnableBatchInput		= 1,	/* Every lane starts out with its array value */
+	AvsRunnableBatchOutput		= 2,	/* Every lane result is stored in the array */
+};
+
+struct _AvsRunnableBatchBinding {
+	AvsRunnableVariable		*variable;
+	AvsNumber			*array;
+	AvsRunnableBatchFlag		flags;
+};
+
+/* Runs a runnable over many lanes, a superscope point or a dynamic movement
+ * grid vertex each, with the same result as executing it once per lane */
+struct _AvsRunnableBatch {
+	VisObject			object;
+	AvsRunnable			*runnable;
+	int				lanes;
+	int				nbindings;
+	AvsRunnableBatchBinding		bindings[AVS_RUNNABLE_BATCH_MAX_BINDINGS];
+
+	/* Private pointer for the core that runs the batch */
+	void				*pcore;
 };
 
 /* prototypes */
@@ -72,12 +119,22 @@ AvsRunnableVariable *avs_runnable_variable_find(AvsRunnableVariableManager *mana
 int avs_runnable_variable_post_bind(AvsRunnableVariableManager *manager, char *name, AvsNumber **retval);
 int avs_runnable_variable_bind(AvsRunnableVariableManager *manager, char *name, AvsNumber *value);
 int avs_runnable_execute(AvsRunnable *obj);
+AvsRunnableBatch *avs_runnable_batch_new(AvsRunnable *obj, int lanes);
+int avs_runnable_batch_bind(AvsRunnableBatch *batch, char *name, AvsNumber *array, AvsRunnableBatchFlag flags);
+int avs_runnable_batch_execute(AvsRunnableBatch *batch, int count);
+int avs_runnable_batch_execute_lanes(AvsRunnableBatch *batch, int count);
 int avs_runnable_compile(AvsRunnable *obj, unsigned char *data, unsigned int length);
+int avs_runnable_save(AvsRunnable *obj, unsigned char **code, unsigned int *length);
+int avs_runnable_load(AvsRunnable *obj, const unsigned char *code, unsigned int length);
 AvsRunnableVariableManager *avs_runnable_get_variable_manager(AvsRunnable *obj);
 void avs_runnable_set_variable_manager(AvsRunnable *obj, AvsRunnableVariableManager *manager);
+int avs_runnable_get_references(AvsRunnable *obj, AvsRunnableVariable ***refs);
+int avs_runnable_is_pure(AvsRunnable *obj);
 int avs_runnable_init(AvsRunnableContext *ctx, AvsRunnable *obj);
 AvsRunnable *avs_runnable_new(AvsRunnableContext *ctx);
 int avs_runnable_context_init(AvsRunnableContext *ctx);
 AvsRunnableContext *avs_runnable_context_new(void);
+void avs_runnable_context_set_cache(AvsRunnableContext *ctx, AvsCodeCache *cache);
+void avs_runnable_context_set_counter(AvsRunnableContext *ctx, uint64_t *executions);
 
 #endif /* !_AVS_RUNNABLE_H */
@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <libvisual/libvisual.h>
+
+#include "avs.h"
+
+/*
+ * Feeds avs_runnable_load() truncated, bit flipped and hand corrupted
+ * bytecode.  Every blob must either load or be refused, never crash the
+ * compilers behind it.  The offsets mirror the layout in avs_bytecode.c.
+ */
+
+#define HEADER_SIZE		(8 * sizeof(uint32_t))
+#define REGISTER_SIZE		(3 * sizeof(uint32_t))
+#define INSTRUCTION_SIZE	(7 * sizeof(uint32_t))
+#define FLIPS			4000
+
+static const char *script =
+	"loop(2, loop(n, k=k+1)); x=if(below(x,0.5), x+1, x-1); y=y*0.5+k;";
+
+static AvsRunnableContext *ctx;
+static AvsNumber x, y, n = 3, k;
+
+static uint32_t word(const unsigned char *code, unsigned int offset)
+{
+	uint32_t value;
+
+	memcpy(&value, code + offset, sizeof(uint32_t));
+	return value;
+}
+
+static void set_word(unsigned char *code, unsigned int offset, uint32_t value)
+{
+	memcpy(code + offset, &value, sizeof(uint32_t));
+}
+
+static AvsRunnable *runnable_new(void)
+{
+	AvsRunnableVariableManager *vm = avs_runnable_variable_manager_new();
+	AvsRunnable *obj;
+
+	avs_runnable_variable_bind(vm, "x", &x);
+	avs_runnable_variable_bind(vm, "y", &y);
+	avs_runnable_variable_bind(vm, "n", &n);
+	avs_runnable_variable_bind(vm, "k", &k);
+
+	obj = avs_runnable_new(ctx);
+	avs_runnable_set_variable_manager(obj, vm);
+
+	return obj;
+}
+
+static int load(const unsigned char *code, unsigned int length)
+{
+	AvsRunnable *obj = runnable_new();
+	int ret = avs_runnable_load(obj, code, length);
+
+	visual_object_unref(VISUAL_OBJECT(obj));
+
+	return ret;
+}
+
+/* Offset of the first instruction of the given type, 0 if there is none */
+static unsigned int find_instruction(const unsigned char *code, unsigned int type)
+{
+	unsigned int offset = HEADER_SIZE, i;
+
+	for (i = 0; i < word(code, 16); i++)
+		offset += sizeof(uint32_t) + ((word(code, offset) + 3) & ~3u);
+
+	offset += word(code, 20) * REGISTER_SIZE;
+
+	for (i = 0; i < word(code, 24); i++, offset += INSTRUCTION_SIZE) {
+		if (word(code, offset) == type)
+			return offset;
+	}
+
+	return 0;
+}
+
+static int refused(const char *what, const unsigned char *code, unsigned int length)
+{
+	if (load(code, length) != 0)
+		return 0;
+
+	fprintf(stderr, "%s: loaded\n", what);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	AvsRunnable *obj;
+	unsigned char *code, *copy;
+	unsigned int length, offset, i;
+	int fails = 0;
+
+	visual_init(&argc, &argv);
+	ctx = avs_runnable_context_new();
+
+	obj = runnable_new();
+	if (avs_runnable_compile(obj, (unsigned char *) script, strlen(script)) != 0 ||
+			avs_runnable_save(obj, &code, &length) != 0) {
+		fprintf(stderr, "%s\n\tdoes not compile\n", script);
+		return EXIT_FAILURE;
+	}
+
+	if (find_instruction(code, ILInstructionLoopInit) == 0 ||
+			find_instruction(code, ILInstructionLoop) == 0 ||
+			find_instruction(code, ILInstructionJump) == 0) {
+		fprintf(stderr, "%s\n\thas no loop or jump\n", script);
+		return EXIT_FAILURE;
+	}
+
+	copy = malloc(length);
+
+	if (load(code, length) != 0) {
+		fprintf(stderr, "untouched bytecode: refused\n");
+		fails++;
+	}
+
+	/* Every section is needed, no prefix may load */
+	for (i = 0; i < length; i++) {
+		memcpy(copy, code, i);
+		if (refused("truncated bytecode", copy, i))
+			fails++;
+	}
+
+	memcpy(copy, code, length);
+	set_word(copy, HEADER_SIZE, 0xffffffff);
+	fails += refused("variable name of 4 GB", copy, length);
+
+	memcpy(copy, code, length);
+	set_word(copy, find_instruction(copy, ILInstructionLoopInit), ILInstructionNop);
+	fails += refused("loop without its init", copy, length);
+
+	memcpy(copy, code, length);
+	set_word(copy, find_instruction(copy, ILInstructionLoop), ILInstructionNop);
+	fails += refused("loop init without its loop", copy, length);
+
+	memcpy(copy, code, length);
+	offset = find_instruction(copy, ILInstructionJump);
+	set_word(copy, offset + 4 * sizeof(uint32_t), 0);
+	fails += refused("jump to nowhere", copy, length);
+
+	set_word(copy, offset + 4 * sizeof(uint32_t), word(copy, 24) + 1);
+	fails += refused("jump past the end", copy, length);
+
+	/* Whatever random damage past the format magic does, it must not crash */
+	srand(1);
+	for (i = 0; i < FLIPS; i++) {
+		int bits = 1 + rand() % 4;
+
+		memcpy(copy, code, length);
+		while (bits--) {
+			unsigned int bit = rand() % ((length - 16) * 8);
+
+			copy[16 + bit / 8] ^= 1 << (bit % 8);
+		}
+
+		load(copy, length);
+	}
+
+	printf("%u bytes of bytecode, %d corrupt blobs loaded\n", length, fails);
+
+	free(copy);
+	free(code);
+
+	return fails != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libvisual/libvisual.h>
+
+#include "avs.h"
+#include "avs_ix.h"
+
+/*
+ * Differential test of the JIT core: every script is compiled once, run as
+ * native code and then through avs_ix_machine_run(), which interprets the
+ * very same opcodes.  The bytecode of every script is also saved, loaded
+ * into a fresh runnable and run again.  All three must leave the variables
+ * bit for bit the same.
+ */
+
+#define FRAMES		5
+#define NVARS		8
+
+static char *names[NVARS] = { "x", "y", "i", "v", "q1", "q2", "n", "k" };
+static const AvsNumber initial[NVARS] = { 0.25, -0.5, 0.33, 0.7, 1.5, -2.25, 3, 0 };
+static AvsNumber vars[NVARS];
+
+static const char *scripts[] = {
+	"x=x*0.9+sin(i*3.14)*0.1; y=y+cos(x)*q1; k=k+1;",
+	"q1=sqr(x)+abs(y)-sqrt(abs(q2)); q2=min(q1,x)*max(y,q1);",
+	"n=n%7+3; k=(n&5)|2; x=-x;",
+	"k = if(equal(x,y), 1, 2) + if(above(q1,q2), x, y); x=x+0.125;",
+	"x=atan2(y,x)+pow(abs(q1),0.5)+exp(-abs(y))+log(abs(x)+1)+floor(q1)+ceil(q2);",
+	"a=x; b=y; c=a*b+a/b-a+b; d=c*c; e=d-c; x=e*0.01; y=y+a; v=v+b*0.5+c+d+e+i+q1+q2+n+k+x+y; i=v*0.001; q1=q1*0.99; q2=q2*1.01;",
+	"loop(2, loop(2, k=k+1));",
+	"loop(n, k=k+2);",
+	"loop(3, exec2(k=k+1, x=x*1.1));",
+	"x=if(below(x,0.5), x+1, x-1); y=bnot(band(x,y)); q1=bor(0,q2); q2=sign(q1)*sigmoid(x);",
+	"assign(x, y+1); exec2(q1=q1+1, q2=q2*2);",
+	"t=x*y; x=3; t2=x*y; q1=t+t2; x=1; x=2; y=x; x=y+1;",
+	"d=sqrt(sqr(x)+sqr(y)); r=atan2(y,x); x=cos(r)*d*0.9; y=sin(r)*d*0.9; x=x*2-x*2+x;",
+	"k=k+1; x=x+k; y=y+x; q1=q1+y; q2=q2+q1; n=n+q2; v=v+n; i=i+v; k=k+i; x=x*k; y=y*x; "
+		"q1=q1*y; q2=q2*q1; n=n*q2; v=v*n; i=i*v; a1=x+y+q1+q2+n+v+i+k; a2=a1*a1; "
+		"a3=a2+a1; a4=a3*a2; a5=a4-a3; a6=a5+a4; a7=a6*0.5; a8=a7+a6; a9=a8+a7; x=a9*0.0001;",
+	NULL
+};
+
+typedef int (*RunFunc)(AvsRunnable *obj);
+
+static AvsRunnable *runnable_new(void)
+{
+	AvsRunnableContext *ctx = avs_runnable_context_new();
+	AvsRunnableVariableManager *vm = avs_runnable_variable_manager_new();
+	AvsRunnable *obj;
+	int i;
+
+	for (i = 0; i < NVARS; i++)
+		avs_runnable_variable_bind(vm, names[i], &vars[i]);
+
+	obj = avs_runnable_new(ctx);
+	avs_runnable_set_variable_manager(obj, vm);
+
+	return obj;
+}
+
+static void run_frames(AvsRunnable *obj, RunFunc run, AvsNumber *result)
+{
+	int i;
+
+	memcpy(vars, initial, sizeof(vars));
+
+	for (i = 0; i < FRAMES; i++)
+		run(obj);
+
+	memcpy(result, vars, sizeof(vars));
+}
+
+static int compare(const char *script, const char *what, AvsNumber *expected, AvsNumber *result)
+{
+	int i, fails = 0;
+
+	for (i = 0; i < NVARS; i++) {
+		if (memcmp(&expected[i], &result[i], sizeof(AvsNumber)) == 0)
+			continue;
+
+		if (isnan(expected[i]) && isnan(result[i]))
+			continue;
+
+		fprintf(stderr, "%s\n\t%s: %s is %.9g, expected %.9g\n",
+				script, what, names[i], result[i], expected[i]);
+		fails++;
+	}
+
+	return fails;
+}
+
+int main(int argc, char **argv)
+{
+	AvsNumber native[NVARS], interpreted[NVARS], loaded[NVARS];
+	int i, fails = 0, compiled = 0;
+
+	visual_init(&argc, &argv);
+
+	for (i = 0; scripts[i] != NULL; i++) {
+		AvsRunnable *obj = runnable_new(), *copy = runnable_new();
+		unsigned char *code;
+		unsigned int length;
+
+		if (avs_runnable_compile(obj, (unsigned char *) scripts[i], strlen(scripts[i])) != 0) {
+			fprintf(stderr, "%s\n\tdoes not compile\n", scripts[i]);
+			fails++;
+			continue;
+		}
+
+		if (IX_RUNNABLE_DATA(obj)->native != NULL)
+			compiled++;
+
+		run_frames(obj, avs_runnable_execute, native);
+		run_frames(obj, avs_ix_machine_run, interpreted);
+		fails += compare(scripts[i], "interpreted", native, interpreted);
+
+		if (avs_runnable_save(obj, &code, &length) != 0 ||
+				avs_runnable_load(copy, code, length) != 0) {
+			fprintf(stderr, "%s\n\tbytecode does not round trip\n", scripts[i]);
+			fails++;
+			continue;
+		}
+
+		run_frames(copy, avs_runnable_execute, loaded);
+		fails += compare(scripts[i], "loaded", native, loaded);
+
+		free(code);
+	}
+
+	printf("%d scripts, %d as native code, %d mismatches\n", i, compiled, fails);
+
+	return fails != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
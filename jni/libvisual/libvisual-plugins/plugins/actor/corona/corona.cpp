@@ -37,6 +37,16 @@
 #include <cmath>
 using namespace std;
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define CORONA_HAVE_SSE2 1
+# include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+# define CORONA_HAVE_NEON 1
+# include <arm_neon.h>
+#endif
+
 
 /////////////////////////////////////////////////////////////////////////////
 // Corona::Corona
@@ -109,7 +119,7 @@ bool Corona::setUpSurface(int width, int height) {
 	m_reflArray  = (int*)malloc((m_real_height - m_height) + m_width);
 
 	// Allocate the delta-field memory, and initialise it
-	m_deltafield = (unsigned char**)malloc(m_width * m_height * sizeof(unsigned char*));
+	m_deltafield = (uint32_t*)malloc(m_width * m_height * sizeof(uint32_t));
 
 	for (int x = 0; x < m_width; ++x) {
 		for (int y = 0; y < m_height; ++y) {
@@ -194,31 +204,34 @@ void Corona::setPointDelta(int x, int y)
 	if (x + dx >= m_width) dx = 2 * m_width - 2 * x - dx - 1;
 	if (y + dy < 0) dy = -dy - y;
 	if (y + dy >= m_height) dy = 2 * m_height - 2 * y - dy - 1;
-	m_deltafield[x + y * m_width] = &(m_image[x + dx + (y + dy) * m_width]);
+	m_deltafield[x + y * m_width] = x + dx + (y + dy) * m_width;
 }
 
+/* The image is updated in place, and a pixel may take from one updated
+ * just before it, so this has to go pixel by pixel. There's no byte
+ * gather in SSE2 or NEON to speed it up anyway, what matters is that the
+ * field is half the size it was with pointers. */
 void Corona::applyDeltaField(bool heavy)
 {
-	/* FIXME MMXify */
-	if (heavy) {
-		for (int y = 0; y < m_height; ++y) {
-			unsigned char *s = &(m_image[y * m_width]);
-			unsigned char **p = &(m_deltafield[y * m_width]);
-			for (int x = 0; x < m_width; ++x, ++s, ++p) {
-				*s = (*s + *(*p)) >> 1;
-				if (*s >= 2) *s -= 2;
-			}
-		}
+	unsigned char *s = m_image;
+	const unsigned char *image = m_image;
+	const uint32_t *p = m_deltafield;
+	const uint32_t *end = m_deltafield + m_width * m_height;
+	const int fade = heavy ? 2 : 1;
+
+	for (; p + 4 <= end; p += 4, s += 4) {
+		int v;
+
+		v = (s[0] + image[p[0]]) >> 1; s[0] = v >= fade ? v - fade : v;
+		v = (s[1] + image[p[1]]) >> 1; s[1] = v >= fade ? v - fade : v;
+		v = (s[2] + image[p[2]]) >> 1; s[2] = v >= fade ? v - fade : v;
+		v = (s[3] + image[p[3]]) >> 1; s[3] = v >= fade ? v - fade : v;
 	}
-	else {
-		for (int y = 0; y < m_height; ++y) {
-			unsigned char *s = &(m_image[y * m_width]);
-			unsigned char **p = &(m_deltafield[y * m_width]);
-			for (int x = 0; x < m_width; ++x, ++s, ++p) {
-				*s = (*s + **p) >> 1;
-				if (*s >= 1) *s -= 1;
-			}
-		}
+
+	for (; p < end; ++p, ++s) {
+		int v = (*s + image[*p]) >> 1;
+
+		*s = v >= fade ? v - fade : v;
 	}
 }
 
@@ -333,56 +346,65 @@ void Corona::drawReflected()
 	}
 }
 
+/* The SIMD versions work on 16 pixels at a time. Each one takes its left
+ * neighbour from before the blur, except for the first, which the scalar
+ * loop does for all of them. That's the way the old MMX code did it. */
 void Corona::blurImage()
 {
 	uint8_t *ptr = m_real_image + m_width;
 	int n = (m_real_height - 2) * m_width;
-
-	if (visual_cpu_has_mmx ()) {
-#if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
-		__asm __volatile
-			("pxor %%mm6, %%mm6"
-			 ::);
-
-		while (n -= 4) {
-			__asm __volatile
-				("\n\t movd %[dest], %%mm0"
-				 "\n\t movd %[pix2], %%mm1"
-				 "\n\t punpcklbw %%mm6, %%mm0"
-				 "\n\t movd %[pix3], %%mm2"
-				 "\n\t punpcklbw %%mm6, %%mm1"
-				 "\n\t movd %[pix4], %%mm3"
-				 "\n\t punpcklbw %%mm6, %%mm2"
-				 "\n\t movd %[pix5], %%mm4"
-				 "\n\t punpcklbw %%mm6, %%mm3"
-				 "\n\t paddw %%mm1, %%mm2"
-				 "\n\t punpcklbw %%mm6, %%mm4"
-				 "\n\t paddw %%mm3, %%mm2"
-				 "\n\t paddw %%mm2, %%mm4"
-				 "\n\t psrlw $2, %%mm4"
-				 "\n\t packuswb %%mm6, %%mm4"
-				 "\n\t movd %%mm4, %[dest]"
-				 :: [dest] "m" (*(ptr))
-				 , [pix2] "m" (*(ptr - m_width))
-				 , [pix3] "m" (*(ptr - 1))
-				 , [pix4] "m" (*(ptr + 1))
-				 , [pix5] "m" (*(ptr + m_width)));
-			ptr += 4;
+	const int w = m_width;
+
+	// The row above has to be done with before a block starts
+	if (w >= 16) {
+#if defined(CORONA_HAVE_SSE2)
+		if (visual_cpu_has_sse2 ()) {
+			const __m128i zero = _mm_setzero_si128 ();
+
+			for (; n >= 16; n -= 16, ptr += 16) {
+				__m128i up    = _mm_loadu_si128 ((const __m128i *) (ptr - w));
+				__m128i left  = _mm_loadu_si128 ((const __m128i *) (ptr - 1));
+				__m128i right = _mm_loadu_si128 ((const __m128i *) (ptr + 1));
+				__m128i down  = _mm_loadu_si128 ((const __m128i *) (ptr + w));
+
+				__m128i lo = _mm_add_epi16 (_mm_add_epi16 (_mm_unpacklo_epi8 (up, zero), _mm_unpacklo_epi8 (left, zero)),
+						_mm_add_epi16 (_mm_unpacklo_epi8 (right, zero), _mm_unpacklo_epi8 (down, zero)));
+				__m128i hi = _mm_add_epi16 (_mm_add_epi16 (_mm_unpackhi_epi8 (up, zero), _mm_unpackhi_epi8 (left, zero)),
+						_mm_add_epi16 (_mm_unpackhi_epi8 (right, zero), _mm_unpackhi_epi8 (down, zero)));
+
+				_mm_storeu_si128 ((__m128i *) ptr,
+						_mm_packus_epi16 (_mm_srli_epi16 (lo, 2), _mm_srli_epi16 (hi, 2)));
+			}
 		}
-
-		__asm __volatile
-			("\n\t emms");
 #endif
-	} else {
-		while (n--) {
-			int val = *(ptr + 1);
-			val += *(ptr - 1);
-			val += *(ptr - m_width);
-			val += *(ptr + m_width);
-			val >>= 2;
-
-			*(ptr++) = val;
+
+#if defined(CORONA_HAVE_NEON)
+		if (visual_cpu_has_neon ()) {
+			for (; n >= 16; n -= 16, ptr += 16) {
+				uint8x16_t up    = vld1q_u8 (ptr - w);
+				uint8x16_t left  = vld1q_u8 (ptr - 1);
+				uint8x16_t right = vld1q_u8 (ptr + 1);
+				uint8x16_t down  = vld1q_u8 (ptr + w);
+
+				uint16x8_t lo = vaddq_u16 (vaddl_u8 (vget_low_u8 (up), vget_low_u8 (left)),
+						vaddl_u8 (vget_low_u8 (right), vget_low_u8 (down)));
+				uint16x8_t hi = vaddq_u16 (vaddl_u8 (vget_high_u8 (up), vget_high_u8 (left)),
+						vaddl_u8 (vget_high_u8 (right), vget_high_u8 (down)));
+
+				vst1q_u8 (ptr, vcombine_u8 (vshrn_n_u16 (lo, 2), vshrn_n_u16 (hi, 2)));
+			}
 		}
+#endif
+	}
+
+	while (n--) {
+		int val = *(ptr + 1);
+		val += *(ptr - 1);
+		val += *(ptr - m_width);
+		val += *(ptr + m_width);
+		val >>= 2;
+
+		*(ptr++) = val;
 	}
 }
 
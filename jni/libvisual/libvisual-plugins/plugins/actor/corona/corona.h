@@ -81,7 +81,7 @@ class Corona
     int m_real_height;
 
     Swirl m_swirl;
-    unsigned char** m_deltafield;
+    uint32_t* m_deltafield;    // Offset into m_image of the source of every pixel
 
     // Particle movement info
     int   m_swirltime;
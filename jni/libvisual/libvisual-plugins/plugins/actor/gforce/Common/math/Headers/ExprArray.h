@@ -36,6 +36,9 @@ class ExprArray {
 
 		inline float		Evaluate( long inN ) {  return mExprs[ inN ].Evaluate();  }
 
+		// The value element inN got from the last Evaluate()
+		inline float		GetValue( long inN ) const { return mVals[ inN ];  }
+
 		// See Expression::IsDependent()
 		// Returns if any of the elements of this ExprArray are dependent
 		bool				IsDependent( const char* inStr );
@@ -5,6 +5,18 @@
 #include "ArgList.h"
 #include <math.h>
 #include "EgOSUtils.h"
+#include <string.h>
+
+#ifdef UNIX_X
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 
 DeltaField::DeltaField() {
@@ -18,6 +30,26 @@ DeltaField::DeltaField() {
 	mWidth = mHeight = mRowSize = 0;
 	mCurrentY = -1;
 	mPI = 3.141592653589793;
+
+	mCacheable = false;
+	mCacheMap = 0;
+	mCacheMapSize = 0;
+
+	mWorker = 0;
+	mCancel = false;
+	mDone = false;
+	mLock = visual_thread_is_supported() ? visual_mutex_new() : 0;
+}
+
+
+
+DeltaField::~DeltaField() {
+
+	StopWorker();
+	ReleaseCache();
+
+	if ( mLock )
+		visual_mutex_free( mLock );
 }
 
 
@@ -28,6 +60,13 @@ DeltaField::DeltaField() {
 DeltaFieldData* DeltaField::GetField() {
 	if ( mCurrentY >= 0 ) {
 
+		// Wait for the worker to finish, it publishes the field when it's done
+		if ( mWorker ) {
+			visual_thread_join( mWorker );
+			visual_thread_free( mWorker );
+			mWorker = 0;
+		}
+
 		if ( ! IsCalculated() ) {
 
 			EgOSUtils::ShowCursor();
@@ -50,8 +89,28 @@ DeltaFieldData* DeltaField::GetField() {
 
 
 
+bool DeltaField::IsCalculated() {
+	bool done;
+
+	if ( ! mLock )
+		return mCurrentY == mHeight;
+
+	visual_mutex_lock( mLock );
+	done = mDone;
+	visual_mutex_unlock( mLock );
+
+	return done;
+}
+
+
+
+
 void DeltaField::Assign( ArgList& inArgs, UtilStr& inName ) {
 	UtilStr fx, fy;
+	long i;
+
+	// The expressions are about to change under any running worker
+	StopWorker();
 
 	mName.Assign( inName );
 
@@ -84,6 +143,21 @@ void DeltaField::Assign( ArgList& inArgs, UtilStr& inName ) {
 	mHasRTerm		= mXField.IsDependent( "R" )		|| mYField.IsDependent( "R" )			|| mDVars.IsDependent( "R" );
 	mHasThetaTerm	= mXField.IsDependent( "THETA" )	|| mYField.IsDependent( "THETA" )		|| mDVars.IsDependent( "THETA" );
 
+	// A field that calls rnd() is different every time, there's no point keeping it
+	mCacheable = ! ( mAVars.IsDependent( "RND" ) || mDVars.IsDependent( "RND" ) ||
+					 mXField.IsDependent( "RND" ) || mYField.IsDependent( "RND" ) );
+
+	// The A-vars are part of the key all the same, a field is only made for the values they got
+	inArgs.ExportTo( mCacheKey );
+	for ( i = 0; i < mAVars.Count(); i++ ) {
+		float val = mAVars.GetValue( i );
+		uint32_t bits;
+
+		memcpy( &bits, &val, sizeof( bits ) );
+		mCacheKey.Append( ',' );
+		mCacheKey.Append( (long) bits );
+	}
+
 	// Reset all computation of this delta field...
 	SetSize( mWidth, mHeight, mRowSize, true );
 }
@@ -95,6 +169,9 @@ void DeltaField::SetSize( long inWidth, long inHeight, long inRowSize, bool inFo
 	// Only resize if the new size is different...
 	if ( inWidth != mWidth || inHeight != mHeight || inForceRegen ) {
 
+		StopWorker();
+		ReleaseCache();
+
 		mWidth = inWidth;
 		mHeight = inHeight;
 		mRowSize = inRowSize;
@@ -116,21 +193,96 @@ void DeltaField::SetSize( long inWidth, long inHeight, long inRowSize, bool inFo
 
 		// Reset all computation of this delta field
 		mCurrentY = 0;
+		mDone = false;
+
+		if ( mWidth > 0 && mHeight > 0 ) {
+			if ( LoadFromCache() ) {
+				mCurrentY = mHeight;
+				mDone = true;
+			}
+			else if ( mLock )
+				StartWorker();
+		}
 	}
 }
 
 
 
 
+void DeltaField::StartWorker() {
+
+	mCancel = false;
+	mWorker = visual_thread_create( WorkerMain, this, true );
+}
+
+
+
+
+void DeltaField::StopWorker() {
+
+	if ( mWorker ) {
+		mCancel = true;
+		visual_thread_join( mWorker );
+		visual_thread_free( mWorker );
+		mWorker = 0;
+		mCancel = false;
+	}
+}
+
+
+
+
+void* DeltaField::WorkerMain( void* inField ) {
+	DeltaField* field = (DeltaField*) inField;
+
+	while ( field -> mCurrentY < field -> mHeight ) {
+		if ( field -> mCancel )
+			return 0;
+
+		field -> CalcRow();
+	}
+
+	field -> SaveToCache();
+
+	// Publish the whole field at once
+	visual_mutex_lock( field -> mLock );
+	field -> mDone = true;
+	visual_mutex_unlock( field -> mLock );
+
+	return 0;
+}
+
+
+
+
 
 void DeltaField::CalcSome() {
+
+	// The worker has it
+	if ( mWorker )
+		return;
+
+	// If we're still have stuff left to compute...
+	if ( mCurrentY >= 0 && mCurrentY < mHeight ) {
+		CalcRow();
+
+		if ( mCurrentY == mHeight ) {
+			SaveToCache();
+			mDone = true;
+		}
+	}
+}
+
+
+
+
+void DeltaField::CalcRow() {
 	float xscale2, yscale2, r, fx, fy;
 	long px, sx, sy, t;
 	unsigned long addrOffset;
 	char* g;
 	bool outOfBounds;
 
-	// If we're still have stuff left to compute...
 	if ( mCurrentY >= 0 && mCurrentY < mHeight ) {
 
 		// Calc the y we're currently at
@@ -206,19 +358,259 @@ void DeltaField::CalcSome() {
 		// Signal the compution of the next row
 		mCurrentY++;
 	}
+}
+
+
+
+
+#ifdef UNIX_X
+
+// Computed fields are kept in $XDG_CACHE_HOME/gforce (or ~/.cache/gforce), one file per field, named after a
+// hash of the field's source text, size and aspect flag.  A file holds a header, the full key (so a hash collision
+// is just a miss) and the field, which is mapped straight into memory when it's used again.
+
+#define CACHE_MAGIC			0x46444647
+#define CACHE_VERSION		1
+#define CACHE_MAX_BYTES		( 256L << 20 )
 
+struct DeltaFieldCacheHeader {
+	uint32_t				mMagic, mVersion;
+	uint32_t				mWidth, mHeight, mRowSize, mAspect1to1;
+	uint32_t				mKeyLen, mFieldOffset, mFieldLen;
+};
 
-	if ( IsCalculated() ) {
 
-		// Give PixPort some needed info and scrap ptrs
-		/*mFieldData.mNegYExtents = 1 - ( mNegYExtents >> DEC_SIZE );
-		if ( mFieldData.mNegYExtents > mHeight )
-			mFieldData.mNegYExtents = mHeight;
+static bool GetCacheDir( UtilStr& outDir, bool inCreate ) {
+	const char* base = getenv( "XDG_CACHE_HOME" );
 
-		// 8-bit pixels, so once byte per pixel
-		mFieldData.mYExtentsBuf = mYExtentsBuf.Dim( mFieldData.mNegYExtents * mWidth ); */
+	if ( base && *base )
+		outDir.Assign( base );
+	else if ( ( base = getenv( "HOME" ) ) != 0 ) {
+		outDir.Assign( base );
+		outDir.Append( "/.cache" );
 	}
+	else
+		return false;
+
+	if ( inCreate )
+		mkdir( outDir.getCStr(), 0700 );
+
+	outDir.Append( "/gforce" );
+
+	if ( inCreate )
+		mkdir( outDir.getCStr(), 0700 );
+
+	return true;
+}
+
+
+static void GetCachePath( const UtilStr& inDir, const UtilStr& inKey, long inWidth, long inHeight, long inRowSize, long inAspect, UtilStr& outPath ) {
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	uint32_t dims[ 4 ] = { (uint32_t) inWidth, (uint32_t) inHeight, (uint32_t) inRowSize, (uint32_t) inAspect };
+	const unsigned char* c;
+	char name[ 32 ];
+	long i;
+
+	// FNV-1a over the key and the dimensions
+	c = (const unsigned char*) inKey.getCStr();
+	for ( i = 0; i < (long) inKey.length(); i++ )
+		hash = ( hash ^ c[ i ] ) * 0x100000001B3ULL;
+
+	c = (const unsigned char*) dims;
+	for ( i = 0; i < (long) sizeof( dims ); i++ )
+		hash = ( hash ^ c[ i ] ) * 0x100000001B3ULL;
+
+	snprintf( name, sizeof( name ), "/%016llx.gdf", (unsigned long long) hash );
+
+	outPath.Assign( inDir );
+	outPath.Append( name );
+}
+
+
+static bool IsCacheFile( const char* inName ) {
+	size_t len = strlen( inName );
+
+	// Not the .gdf.XXXXXX files still being written
+	return len > 4 && strcmp( inName + len - 4, ".gdf" ) == 0;
+}
+
+
+// Drop the least recently used fields until the rest fit in CACHE_MAX_BYTES.  A field is 4 bytes a pixel,
+// about 8 MB at 1920x1080, so the size of the cache is what counts, not the number of files.
+static void TrimCache( const UtilStr& inDir ) {
+	DIR* dir;
+	struct dirent* entry;
+	struct stat info;
+	UtilStr path, oldest;
+	time_t oldestTime;
+	long long total;
+	long count;
+
+	do {
+		dir = opendir( inDir.getCStr() );
+		if ( ! dir )
+			return;
+
+		total = 0;
+		count = 0;
+		oldestTime = 0;
+
+		while ( ( entry = readdir( dir ) ) != 0 ) {
+			if ( ! IsCacheFile( entry -> d_name ) )
+				continue;
+
+			path.Assign( inDir );
+			path.Append( '/' );
+			path.Append( entry -> d_name );
+
+			if ( stat( path.getCStr(), &info ) != 0 )
+				continue;
+
+			if ( count == 0 || info.st_mtime < oldestTime ) {
+				oldestTime = info.st_mtime;
+				oldest.Assign( path );
+			}
+			total += info.st_size;
+			count++;
+		}
+
+		closedir( dir );
+
+	} while ( total > CACHE_MAX_BYTES && count > 1 && unlink( oldest.getCStr() ) == 0 );
+}
+
+
+
+bool DeltaField::LoadFromCache() {
+	const DeltaFieldCacheHeader* header;
+	UtilStr dir, path;
+	struct stat info;
+	void* map;
+	int fd;
+
+	if ( ! mCacheable || ! GetCacheDir( dir, false ) )
+		return false;
+
+	GetCachePath( dir, mCacheKey, mWidth, mHeight, mRowSize, mAspect1to1, path );
+
+	fd = open( path.getCStr(), O_RDONLY );
+	if ( fd < 0 )
+		return false;
+
+	if ( fstat( fd, &info ) != 0 || info.st_size < (off_t) sizeof( DeltaFieldCacheHeader ) ) {
+		close( fd );
+		return false;
+	}
+
+	map = mmap( 0, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+
+	if ( map == MAP_FAILED )
+		return false;
+
+	header = (const DeltaFieldCacheHeader*) map;
+
+	if ( header -> mMagic != CACHE_MAGIC || header -> mVersion != CACHE_VERSION ||
+		 header -> mWidth != (uint32_t) mWidth || header -> mHeight != (uint32_t) mHeight ||
+		 header -> mRowSize != (uint32_t) mRowSize || header -> mAspect1to1 != (uint32_t) mAspect1to1 ||
+		 header -> mKeyLen != (uint32_t) mCacheKey.length() ||
+		 header -> mFieldLen != (uint32_t) ( 4 * mWidth * mHeight ) ||
+		 (off_t) header -> mFieldOffset + header -> mFieldLen > info.st_size ||
+		 sizeof( DeltaFieldCacheHeader ) + header -> mKeyLen > header -> mFieldOffset ||
+		 memcmp( (const char*) map + sizeof( DeltaFieldCacheHeader ), mCacheKey.getCStr(), header -> mKeyLen ) != 0 ) {
+
+		munmap( map, info.st_size );
+		return false;
+	}
+
+	mCacheMap = map;
+	mCacheMapSize = info.st_size;
+	mFieldData.mField = (const char*) map + header -> mFieldOffset;
+
+	// Mark it as recently used
+	utime( path.getCStr(), 0 );
+
+	return true;
+}
+
+
+
+void DeltaField::SaveToCache() {
+	DeltaFieldCacheHeader header;
+	UtilStr dir, path, temp;
+	static const char pad[ 4 ] = { 0, 0, 0, 0 };
+	uint32_t keyEnd;
+	bool ok;
+	int fd;
+
+	if ( ! mCacheable || ! GetCacheDir( dir, true ) )
+		return;
+
+	GetCachePath( dir, mCacheKey, mWidth, mHeight, mRowSize, mAspect1to1, path );
+
+	keyEnd = sizeof( header ) + mCacheKey.length();
+
+	header.mMagic		= CACHE_MAGIC;
+	header.mVersion		= CACHE_VERSION;
+	header.mWidth		= mWidth;
+	header.mHeight		= mHeight;
+	header.mRowSize		= mRowSize;
+	header.mAspect1to1	= mAspect1to1;
+	header.mKeyLen		= mCacheKey.length();
+	header.mFieldOffset	= ( keyEnd + 3 ) & ~3;
+	header.mFieldLen	= 4 * mWidth * mHeight;
+
+	// Write it aside and move it in place, so no one ever maps half a file
+	temp.Assign( path );
+	temp.Append( ".XXXXXX" );
+
+	fd = mkstemp( temp.getCStr() );
+	if ( fd < 0 )
+		return;
+
+	ok = write( fd, &header, sizeof( header ) ) == (ssize_t) sizeof( header ) &&
+		 write( fd, mCacheKey.getCStr(), header.mKeyLen ) == (ssize_t) header.mKeyLen &&
+		 write( fd, pad, header.mFieldOffset - keyEnd ) == (ssize_t) ( header.mFieldOffset - keyEnd ) &&
+		 write( fd, mFieldData.mField, header.mFieldLen ) == (ssize_t) header.mFieldLen;
+
+	if ( close( fd ) != 0 )
+		ok = false;
+
+	if ( ok && rename( temp.getCStr(), path.getCStr() ) == 0 )
+		TrimCache( dir );
+	else
+		unlink( temp.getCStr() );
+}
+
+
+
+void DeltaField::ReleaseCache() {
+
+	if ( mCacheMap ) {
+		munmap( mCacheMap, mCacheMapSize );
+		mCacheMap = 0;
+		mCacheMapSize = 0;
+	}
+}
+
+#else
+
+bool DeltaField::LoadFromCache() {
+
+	return false;
 }
 
 
 
+void DeltaField::SaveToCache() {
+}
+
+
+
+void DeltaField::ReleaseCache() {
+}
+
+#endif
+
+
+
@@ -7,6 +7,8 @@
 #include "TempMem.h"
 #include "PixPort.h"
 
+#include <libvisual/libvisual.h>
+
 
 
 class ArgList;
@@ -16,18 +18,21 @@ class DeltaField {
 
 	public:
 								DeltaField();
+								~DeltaField();
 
 		// Suck in a new grad field.  Note: Resize must be called after Assign()
 		void					Assign( ArgList& inArgs, UtilStr& inName );
 
-		// Reinitiate/reset the computation of this grad field.
+		// Reinitiate/reset the computation of this grad field.  The field is taken from the disk cache if it's
+		// there, otherwise it's computed on a worker thread (or by CalcSome() if there are no threads).
 		void					SetSize( long inWidth, long inHeight, long inRowSize, bool inForceRegen = false );
 
 		// Compute a small portion of the grad field.  Call GetField() to see if the field finished.
+		// Does nothing while a worker thread is computing the field.
 		void					CalcSome();
 
-		// See if this delta field is 100% calculated
-		bool					IsCalculated()								{ return mCurrentY == mHeight;	}
+		// See if this delta field is 100% calculated.  A field computed on a worker thread only shows up once it's whole.
+		bool					IsCalculated();
 
 		//  Returns a ptr to the buf of this grad field.
 		//	Note:  If the field is not 100% calculated, it will finish calculating and may take a couple seconds.
@@ -55,6 +60,29 @@ class DeltaField {
 		DeltaFieldData			mFieldData;
 
 		char*					mCurrentRow;
+
+		// The source text of the field, with the values the A-vars got.  Fields are cached under it.
+		UtilStr					mCacheKey;
+		bool					mCacheable;
+		void*					mCacheMap;
+		long					mCacheMapSize;
+
+		VisThread*				mWorker;
+		VisMutex*				mLock;
+		volatile bool			mCancel;
+		bool					mDone;
+
+		// Compute row mCurrentY at mCurrentRow and move on to the next row
+		void					CalcRow();
+
+		static void*			WorkerMain( void* inField );
+		void					StartWorker();
+		void					StopWorker();
+
+		// Point the field at a cached copy if there is one
+		bool					LoadFromCache();
+		void					SaveToCache();
+		void					ReleaseCache();
 };
 
 
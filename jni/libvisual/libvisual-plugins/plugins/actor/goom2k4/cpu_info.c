@@ -56,6 +56,14 @@ static void autoset_cpu_info (void)
     if (mmx_supported()) CPU_FLAVOUR |= CPU_OPTION_MMX;
     if (xmmx_supported()) CPU_FLAVOUR |= CPU_OPTION_XMMX;
 #endif /* CPU_X86 */
+
+    /* part of the x86-64 and ARMv8 baselines, so known when compiling */
+#if defined(__SSE2__)
+    CPU_FLAVOUR |= CPU_OPTION_SSE2;
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    CPU_FLAVOUR |= CPU_OPTION_NEON;
+#endif
 }
 
 unsigned int cpu_flavour (void)
@@ -29,6 +29,14 @@
 #include "goom_fx.h"
 #include "v3d.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
 /* TODO : MOVE THIS AWAY !!! */
 /* jeko: j'ai essayer de le virer, mais si on veut les laisser inline c'est un peu lourdo... */
 static inline void setPixelRGB (PluginInfo *goomInfo, Pixel *buffer, Uint x, Uint y, Color c)
@@ -135,6 +143,17 @@ typedef struct _ZOOM_FILTER_FX_WRAPPER_DATA {
     int wave;
     int wavesp;
     
+    /** generation of brutT in the background, NULL lock when there are no threads */
+    VisThread *worker;
+    VisMutex *worker_lock;
+    int worker_done;
+    int worker_cancel;
+    
+    /** what the worker makes, copied when it starts */
+    signed int *worker_brutT;
+    Uint worker_prevX, worker_prevY;
+    int worker_middleX, worker_middleY;
+    
 } ZoomFilterFXWrapperData;
 
 
@@ -231,34 +250,29 @@ static inline v2g zoomVector(ZoomFilterFXWrapperData *data, float X, float Y)
 
 
 /*
- * Makes a stripe of a transform buffer (brutT)
+ * Makes the rows [start, end) of a transform buffer prevX wide
  *
  * The transform is (in order) :
- * Translation (-data->middleX, -data->middleY)
- * Homothetie (Center : 0,0   Coeff : 2/data->prevX)
+ * Translation (-middleX, -middleY)
+ * Homothetie (Center : 0,0   Coeff : 2/prevX)
  */
-static void makeZoomBufferStripe(ZoomFilterFXWrapperData * data, int INTERLACE_INCR)
+static void makeZoomBufferRows(ZoomFilterFXWrapperData * data, signed int *brutT, Uint prevX, int middleX, int middleY, int start, int end)
 {
     // Position of the pixel to compute in pixmap coordinates
-    Uint x, y;
-    // Where (verticaly) to stop generating the buffer stripe
-    int maxEnd = (data->interlace_start + INTERLACE_INCR);
+    Uint x;
+    int y;
     // Ratio from pixmap to normalized coordinates
-    float ratio = 2.0f/((float)data->prevX);
+    float ratio = 2.0f/((float)prevX);
     // Ratio from normalized to virtual pixmap coordinates
     float inv_ratio = BUFFPOINTNBF/ratio;
     float min = ratio/BUFFPOINTNBF;
     // Y position of the pixel to compute in normalized coordinates
-    float Y = ((float)(data->interlace_start - data->middleY)) * ratio;
-    
-    maxEnd = data->prevY;
-    if (maxEnd > (data->interlace_start + INTERLACE_INCR))
-        maxEnd = (data->interlace_start + INTERLACE_INCR);
+    float Y = ((float)(start - middleY)) * ratio;
     
-    for (y = data->interlace_start; (y < data->prevY) && ((signed int)y<maxEnd); y++) {
-        Uint premul_y_prevX = y * data->prevX * 2;
-        float X = - ((float)data->middleX) * ratio;
-        for (x = 0; x < data->prevX; x++)
+    for (y = start; y < end; y++) {
+        Uint premul_y_prevX = y * prevX * 2;
+        float X = - ((float)middleX) * ratio;
+        for (x = 0; x < prevX; x++)
         {
             v2g vector = zoomVector (data, X, Y);
             
@@ -266,15 +280,100 @@ static void makeZoomBufferStripe(ZoomFilterFXWrapperData * data, int INTERLACE_I
             if (fabs(vector.x) < min) vector.x = (vector.x < 0.0f) ? -min : min;
             if (fabs(vector.y) < min) vector.y = (vector.y < 0.0f) ? -min : min;
             
-            data->brutT[premul_y_prevX] = ((int)((X-vector.x)*inv_ratio)+((int)(data->middleX*BUFFPOINTNB)));
-            data->brutT[premul_y_prevX+1] = ((int)((Y-vector.y)*inv_ratio)+((int)(data->middleY*BUFFPOINTNB)));
+            brutT[premul_y_prevX] = ((int)((X-vector.x)*inv_ratio)+((int)(middleX*BUFFPOINTNB)));
+            brutT[premul_y_prevX+1] = ((int)((Y-vector.y)*inv_ratio)+((int)(middleY*BUFFPOINTNB)));
             premul_y_prevX += 2;
             X += ratio;
         }
         Y += ratio;
     }
+}
+
+/*
+ * Makes a stripe of a transform buffer (brutT)
+ */
+static void makeZoomBufferStripe(ZoomFilterFXWrapperData * data, int INTERLACE_INCR)
+{
+    // Where (verticaly) to stop generating the buffer stripe
+    int maxEnd = data->prevY;
+    if (maxEnd > (data->interlace_start + INTERLACE_INCR))
+        maxEnd = (data->interlace_start + INTERLACE_INCR);
+    
+    makeZoomBufferRows(data, data->brutT, data->prevX, data->middleX, data->middleY, data->interlace_start, maxEnd);
+    
     data->interlace_start += INTERLACE_INCR;
-    if (y >= data->prevY-1) data->interlace_start = -1;
+    if (maxEnd >= (signed int)data->prevY-1) data->interlace_start = -1;
+}
+
+/*
+ * The worker makes the whole of brutT at once, in the same stripes as
+ * makeZoomBufferStripe(). The buffer and its size are copied for it by
+ * startZoomBufferWorker(), a resize stops it before freeing the buffers.
+ * The effects it reads only change with a new config, which is taken once
+ * the last buffer has been swapped in.
+ */
+static int zoomBufferWorkerCancelled(ZoomFilterFXWrapperData *data)
+{
+    int cancel;
+    
+    visual_mutex_lock(data->worker_lock);
+    cancel = data->worker_cancel;
+    visual_mutex_unlock(data->worker_lock);
+    
+    return cancel;
+}
+
+static void *zoomBufferWorker(void *arg)
+{
+    ZoomFilterFXWrapperData *data = (ZoomFilterFXWrapperData*)arg;
+    int height = (signed int)data->worker_prevY;
+    int incr = height / 16 > 0 ? height / 16 : 1;
+    int y;
+    
+    for (y = 0; (y < height) && !zoomBufferWorkerCancelled(data); y += incr)
+        makeZoomBufferRows(data, data->worker_brutT, data->worker_prevX, data->worker_middleX, data->worker_middleY,
+                           y, (y + incr < height) ? y + incr : height);
+    
+    visual_mutex_lock(data->worker_lock);
+    data->worker_done = 1;
+    visual_mutex_unlock(data->worker_lock);
+    
+    return NULL;
+}
+
+static void startZoomBufferWorker(ZoomFilterFXWrapperData *data)
+{
+    data->worker_done = 0;
+    data->worker_cancel = 0;
+    data->worker_brutT = data->brutT;
+    data->worker_prevX = data->prevX;
+    data->worker_prevY = data->prevY;
+    data->worker_middleX = data->middleX;
+    data->worker_middleY = data->middleY;
+    data->worker = visual_thread_create(zoomBufferWorker, data, TRUE);
+}
+
+static int zoomBufferWorkerDone(ZoomFilterFXWrapperData *data)
+{
+    int done;
+    
+    visual_mutex_lock(data->worker_lock);
+    done = data->worker_done;
+    visual_mutex_unlock(data->worker_lock);
+    
+    return done;
+}
+
+static void stopZoomBufferWorker(ZoomFilterFXWrapperData *data)
+{
+    if (data->worker == NULL) return;
+    
+    visual_mutex_lock(data->worker_lock);
+    data->worker_cancel = 1;
+    visual_mutex_unlock(data->worker_lock);
+    visual_thread_join(data->worker);
+    visual_thread_free(data->worker);
+    data->worker = NULL;
 }
 
 
@@ -466,6 +565,111 @@ static void c_zoom (Pixel *expix1, Pixel *expix2, unsigned int prevX, unsigned i
     }
 }
 
+#if defined(HAVE_ZOOM_FILTER_SSE2) || defined(HAVE_ZOOM_FILTER_NEON)
+
+/* source pixel and coefs of a destination pixel, as in c_zoom */
+static inline int zoomSourcePos (signed int *brutS, signed int *brutD, int myPos, int buffratio, unsigned int prevX,
+                                 unsigned int ax, unsigned int ay, int precalCoef[16][16], int *coeffs)
+{
+    int brutSmypos = brutS[myPos];
+    int px, py;
+    
+    px = brutSmypos + (((brutD[myPos] - brutSmypos) * buffratio) >> BUFFPOINTNB);
+    brutSmypos = brutS[myPos + 1];
+    py = brutSmypos + (((brutD[myPos + 1] - brutSmypos) * buffratio) >> BUFFPOINTNB);
+    
+    if (((unsigned int)py >= ay) || ((unsigned int)px >= ax)) {
+        *coeffs = 0;
+        return 0;
+    }
+    
+    *coeffs = precalCoef[px & PERTEMASK][py & PERTEMASK];
+    return (px >> PERTEDEC) + prevX * (py >> PERTEDEC);
+}
+
+#endif
+
+#ifdef HAVE_ZOOM_FILTER_SSE2
+
+/* c_zoom with the four pixels of a pair of rows weighed in 16 bits lanes.
+ * The sums never pass 255 * 255, and dropping 5 with unsigned saturation
+ * leaves the same after the shift as c_zoom's test. Alpha is kept. */
+void zoom_filter_sse2 (int prevX, int prevY, Pixel *expix1, Pixel *expix2, int *brutS, int *brutD, int buffratio, int precalCoef[16][16])
+{
+    unsigned int ax = (prevX - 1) << PERTEDEC, ay = (prevY - 1) << PERTEDEC;
+    int bufsize = prevX * prevY;
+    const __m128i zero = _mm_setzero_si128 ();
+    const __m128i five = _mm_set1_epi16 (5);
+    int i;
+    
+    expix1[0].val=expix1[prevX-1].val=expix1[prevX*prevY-1].val=expix1[prevX*prevY-prevX].val=0;
+    
+    for (i = 0; i < bufsize; i++) {
+        __m128i w, top, bottom, sum;
+        Pixel couleur;
+        int coeffs;
+        int pos = zoomSourcePos (brutS, brutD, i << 1, buffratio, prevX, ax, ay, precalCoef, &coeffs);
+        
+        /* c1 x4 c2 x4, c3 x4 c4 x4 */
+        w = _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (coeffs), zero);
+        w = _mm_unpacklo_epi16 (w, w);
+        
+        top = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (expix1 + pos)), zero);
+        bottom = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (expix1 + pos + prevX)), zero);
+        
+        sum = _mm_add_epi16 (_mm_mullo_epi16 (top, _mm_unpacklo_epi32 (w, w)),
+                             _mm_mullo_epi16 (bottom, _mm_unpackhi_epi32 (w, w)));
+        sum = _mm_add_epi16 (sum, _mm_srli_si128 (sum, 8));
+        sum = _mm_srli_epi16 (_mm_subs_epu16 (sum, five), 8);
+        
+        couleur.val = _mm_cvtsi128_si32 (_mm_packus_epi16 (sum, sum));
+        couleur.channels.a = expix2[i].channels.a;
+        expix2[i] = couleur;
+    }
+}
+
+#endif /* HAVE_ZOOM_FILTER_SSE2 */
+
+#ifdef HAVE_ZOOM_FILTER_NEON
+
+/* zoom_filter_sse2 with 8 bits weights widened by the multiply */
+void zoom_filter_neon (int prevX, int prevY, Pixel *expix1, Pixel *expix2, int *brutS, int *brutD, int buffratio, int precalCoef[16][16])
+{
+    static const uint8_t top_lanes[8] = { 0, 0, 0, 0, 1, 1, 1, 1 };
+    static const uint8_t bottom_lanes[8] = { 2, 2, 2, 2, 3, 3, 3, 3 };
+    unsigned int ax = (prevX - 1) << PERTEDEC, ay = (prevY - 1) << PERTEDEC;
+    int bufsize = prevX * prevY;
+    const uint8x8_t top_index = vld1_u8 (top_lanes);
+    const uint8x8_t bottom_index = vld1_u8 (bottom_lanes);
+    const uint16x4_t five = vdup_n_u16 (5);
+    int i;
+    
+    expix1[0].val=expix1[prevX-1].val=expix1[prevX*prevY-1].val=expix1[prevX*prevY-prevX].val=0;
+    
+    for (i = 0; i < bufsize; i++) {
+        uint8x8_t w;
+        uint16x8_t acc;
+        uint16x4_t sum;
+        Pixel couleur;
+        int coeffs;
+        int pos = zoomSourcePos (brutS, brutD, i << 1, buffratio, prevX, ax, ay, precalCoef, &coeffs);
+        
+        w = vreinterpret_u8_u32 (vdup_n_u32 ((uint32_t) coeffs));
+        
+        acc = vmull_u8 (vld1_u8 ((const uint8_t *) (expix1 + pos)), vtbl1_u8 (w, top_index));
+        acc = vmlal_u8 (acc, vld1_u8 ((const uint8_t *) (expix1 + pos + prevX)), vtbl1_u8 (w, bottom_index));
+        
+        sum = vadd_u16 (vget_low_u16 (acc), vget_high_u16 (acc));
+        sum = vshr_n_u16 (vqsub_u16 (sum, five), 8);
+        
+        couleur.val = vget_lane_u32 (vreinterpret_u32_u8 (vmovn_u16 (vcombine_u16 (sum, sum))), 0);
+        couleur.channels.a = expix2[i].channels.a;
+        expix2[i] = couleur;
+    }
+}
+
+#endif /* HAVE_ZOOM_FILTER_NEON */
+
 /** generate the water fx horizontal direction buffer */
 static void generateTheWaterFXHorizontalDirectionBuffer(PluginInfo *goomInfo, ZoomFilterFXWrapperData *data) {
     
@@ -533,6 +737,8 @@ void zoomFilterFastRGB (PluginInfo *goomInfo, Pixel * pix1, Pixel * pix2, ZoomFi
     
     /** changement de taille **/
     if ((data->prevX != resx) || (data->prevY != resy)) {
+        stopZoomBufferWorker(data);
+        
         data->prevX = resx;
         data->prevY = resy;
         
@@ -595,6 +801,12 @@ void zoomFilterFastRGB (PluginInfo *goomInfo, Pixel * pix1, Pixel * pix2, ZoomFi
         visual_mem_copy(data->brutD,data->brutT,resx * resy * 2 * sizeof(int));
     }
     
+    /* le worker a fini la nouvelle destination */
+    if ((data->worker != NULL) && zoomBufferWorkerDone(data)) {
+        stopZoomBufferWorker(data);
+        data->interlace_start = -1;
+    }
+    
     /* generation du buffer de trans */
     if (data->interlace_start == -1) {
         
@@ -625,8 +837,12 @@ void zoomFilterFastRGB (PluginInfo *goomInfo, Pixel * pix1, Pixel * pix2, ZoomFi
     
     if (data->interlace_start>=0)
     {
-        /* creation de la nouvelle destination */
-        makeZoomBufferStripe(data,resy/16);
+        /* creation de la nouvelle destination, d'un coup sur le worker
+         * ou par bandes d'une image a l'autre */
+        if ((data->worker == NULL) && (data->worker_lock != NULL) && (data->interlace_start == 0))
+            startZoomBufferWorker(data);
+        if (data->worker == NULL)
+            makeZoomBufferStripe(data,resy/16);
     }
     
     if (switchIncr != 0) {
@@ -719,6 +935,11 @@ static void zoomFilterVisualFXWrapper_init (struct _VISUAL_FX *_this, PluginInfo
     
     data->wave = data->wavesp = 0;
     
+    data->worker = NULL;
+    data->worker_lock = visual_thread_is_supported() ? visual_mutex_new() : NULL;
+    data->worker_done = 0;
+    data->worker_cancel = 0;
+    
     data->enabled_bp = secure_b_param("Enabled", 1);
     
     data->params = plugin_parameters ("Zoom Filter", 1);
@@ -733,6 +954,11 @@ static void zoomFilterVisualFXWrapper_init (struct _VISUAL_FX *_this, PluginInfo
 
 static void zoomFilterVisualFXWrapper_free (struct _VISUAL_FX *_this)
 {
+    ZoomFilterFXWrapperData *data = (ZoomFilterFXWrapperData*)_this->fx_data;
+    
+    stopZoomBufferWorker(data);
+    if (data->worker_lock) visual_mutex_free(data->worker_lock);
+    
     free(_this->fx_data);
 }
 
@@ -9,4 +9,14 @@ VisualFX flying_star_create (void);
 
 void zoom_filter_c(int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]);
 
+#if defined(__SSE2__)
+#define HAVE_ZOOM_FILTER_SSE2
+void zoom_filter_sse2(int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]);
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define HAVE_ZOOM_FILTER_NEON
+void zoom_filter_neon(int sizeX, int sizeY, Pixel *src, Pixel *dest, int *brutS, int *brutD, int buffratio, int precalCoef[16][16]);
+#endif
+
 #endif
@@ -8,55 +8,6 @@
 
 /*#define TRACE_SCRIPT*/
 
- /* {{{ definition of the instructions number */
-#define INSTR_SETI_VAR_INTEGER     1
-#define INSTR_SETI_VAR_VAR         2
-#define INSTR_SETF_VAR_FLOAT       3
-#define INSTR_SETF_VAR_VAR         4
-#define INSTR_NOP                  5
-/* #define INSTR_JUMP              6 */
-#define INSTR_SETP_VAR_PTR         7
-#define INSTR_SETP_VAR_VAR         8
-#define INSTR_SUBI_VAR_INTEGER     9
-#define INSTR_SUBI_VAR_VAR         10
-#define INSTR_SUBF_VAR_FLOAT       11
-#define INSTR_SUBF_VAR_VAR         12
-#define INSTR_ISLOWERF_VAR_VAR     13
-#define INSTR_ISLOWERF_VAR_FLOAT   14
-#define INSTR_ISLOWERI_VAR_VAR     15
-#define INSTR_ISLOWERI_VAR_INTEGER 16
-#define INSTR_ADDI_VAR_INTEGER     17
-#define INSTR_ADDI_VAR_VAR         18
-#define INSTR_ADDF_VAR_FLOAT       19
-#define INSTR_ADDF_VAR_VAR         20
-#define INSTR_MULI_VAR_INTEGER     21
-#define INSTR_MULI_VAR_VAR         22
-#define INSTR_MULF_VAR_FLOAT       23
-#define INSTR_MULF_VAR_VAR         24
-#define INSTR_DIVI_VAR_INTEGER     25
-#define INSTR_DIVI_VAR_VAR         26
-#define INSTR_DIVF_VAR_FLOAT       27
-#define INSTR_DIVF_VAR_VAR         28
-/* #define INSTR_JZERO             29 */
-#define INSTR_ISEQUALP_VAR_VAR     30
-#define INSTR_ISEQUALP_VAR_PTR     31
-#define INSTR_ISEQUALI_VAR_VAR     32
-#define INSTR_ISEQUALI_VAR_INTEGER 33
-#define INSTR_ISEQUALF_VAR_VAR     34
-#define INSTR_ISEQUALF_VAR_FLOAT   35
-/* #define INSTR_CALL              36 */
-/* #define INSTR_RET               37 */
-/* #define INSTR_EXT_CALL          38 */
-#define INSTR_NOT_VAR              39
-/* #define INSTR_JNZERO            40 */
-#define  INSTR_SETS_VAR_VAR        41
-#define  INSTR_ISEQUALS_VAR_VAR    42
-#define  INSTR_ADDS_VAR_VAR        43
-#define  INSTR_SUBS_VAR_VAR        44
-#define  INSTR_MULS_VAR_VAR        45
-#define  INSTR_DIVS_VAR_VAR        46
-
- /* }}} */
 /* {{{ definition of the validation error types */
 static const char *VALIDATE_OK = "ok"; 
 #define VALIDATE_ERROR "error while validating "
@@ -445,17 +396,8 @@ const char *gsl_instr_validate(Instruction *_this)
   /*************/
  /* EXECUTION */
 /*************/
-void iflow_execute(FastInstructionFlow *_this, GoomSL *gsl)
-{ /* {{{ */
-  int flag = 0;
-  int ip = 0;
-  FastInstruction *instr = _this->instr;
-  int stack[0x10000];
-  int stack_pointer = 0;
-
-  stack[stack_pointer++] = -1;
 
-  /* Quelques Macro pour rendre le code plus lisible */
+/* Quelques Macro pour rendre le code plus lisible */
 #define pSRC_VAR        instr[ip].data.usrc.var
 #define SRC_VAR_INT    *instr[ip].data.usrc.var_int
 #define SRC_VAR_FLOAT  *instr[ip].data.usrc.var_float
@@ -488,9 +430,114 @@ void iflow_execute(FastInstructionFlow *_this, GoomSL *gsl)
   ((float*)((char*)pSRC_VAR  + gsl->gsl_struct[SRC_STRUCT_ID]->fBlock[i].data))[j]
 #define DEST_STRUCT_SIZE      gsl->gsl_struct[DEST_STRUCT_ID]->size
 
+void gsl_execute_struct_instr(GoomSL *gsl, FastInstruction *instr)
+{ /* {{{ */
+  int ip = 0;
+  int i;
+
+  switch (instr[ip].id) {
+    case INSTR_SETS_VAR_VAR:
+      memcpy(pDEST_VAR, pSRC_VAR, DEST_STRUCT_SIZE);
+      break;
+
+    case INSTR_ADDS_VAR_VAR:
+      /* process integers */
+      i=0;
+      while (DEST_STRUCT_IBLOCK(i).size > 0) {
+        int j=DEST_STRUCT_IBLOCK(i).size;
+        while (j--) {
+          DEST_STRUCT_IBLOCK_VAR(i,j) += SRC_STRUCT_IBLOCK_VAR(i,j);
+        }
+        ++i;
+      }
+      /* process floats */
+      i=0;
+      while (DEST_STRUCT_FBLOCK(i).size > 0) {
+        int j=DEST_STRUCT_FBLOCK(i).size;
+        while (j--) {
+          DEST_STRUCT_FBLOCK_VAR(i,j) += SRC_STRUCT_FBLOCK_VAR(i,j);
+        }
+        ++i;
+      }
+      break;
+
+    case INSTR_SUBS_VAR_VAR:
+      /* process integers */
+      i=0;
+      while (DEST_STRUCT_IBLOCK(i).size > 0) {
+        int j=DEST_STRUCT_IBLOCK(i).size;
+        while (j--) {
+          DEST_STRUCT_IBLOCK_VAR(i,j) -= SRC_STRUCT_IBLOCK_VAR(i,j);
+        }
+        ++i;
+      }
+      /* process floats */
+      i=0;
+      while (DEST_STRUCT_FBLOCK(i).size > 0) {
+        int j=DEST_STRUCT_FBLOCK(i).size;
+        while (j--) {
+          DEST_STRUCT_FBLOCK_VAR(i,j) -= SRC_STRUCT_FBLOCK_VAR(i,j);
+        }
+        ++i;
+      }
+      break;
+
+    case INSTR_MULS_VAR_VAR:
+      /* process integers */
+      i=0;
+      while (DEST_STRUCT_IBLOCK(i).size > 0) {
+        int j=DEST_STRUCT_IBLOCK(i).size;
+        while (j--) {
+          DEST_STRUCT_IBLOCK_VAR(i,j) *= SRC_STRUCT_IBLOCK_VAR(i,j);
+        }
+        ++i;
+      }
+      /* process floats */
+      i=0;
+      while (DEST_STRUCT_FBLOCK(i).size > 0) {
+        int j=DEST_STRUCT_FBLOCK(i).size;
+        while (j--) {
+          DEST_STRUCT_FBLOCK_VAR(i,j) *= SRC_STRUCT_FBLOCK_VAR(i,j);
+        }
+        ++i;
+      }
+      break;
+      
+    case INSTR_DIVS_VAR_VAR:
+      /* process integers */
+      i=0;
+      while (DEST_STRUCT_IBLOCK(i).size > 0) {
+        int j=DEST_STRUCT_IBLOCK(i).size;
+        while (j--) {
+          DEST_STRUCT_IBLOCK_VAR(i,j) /= SRC_STRUCT_IBLOCK_VAR(i,j);
+        }
+        ++i;
+      }
+      /* process floats */
+      i=0;
+      while (DEST_STRUCT_FBLOCK(i).size > 0) {
+        int j=DEST_STRUCT_FBLOCK(i).size;
+        while (j--) {
+          DEST_STRUCT_FBLOCK_VAR(i,j) /= SRC_STRUCT_FBLOCK_VAR(i,j);
+        }
+        ++i;
+      }
+      break;
+  }
+} /* }}} */
+
+void iflow_execute(FastInstructionFlow *_this, GoomSL *gsl)
+{ /* {{{ */
+  int flag = 0;
+  int ip = 0;
+  FastInstruction *instr = _this->instr;
+  int stack[0x10000];
+  int stack_pointer = 0;
+
+  stack[stack_pointer++] = -1;
+
   while (1)
   {
-    int i;
 #ifdef TRACE_SCRIPT 
     printf("execute "); gsl_instr_display(instr[ip].proto); printf("\n");
 #endif
@@ -677,96 +724,16 @@ void iflow_execute(FastInstructionFlow *_this, GoomSL *gsl)
         ip += (flag ? JUMP_OFFSET : 1); break;
 
       case INSTR_SETS_VAR_VAR:
-        memcpy(pDEST_VAR, pSRC_VAR, DEST_STRUCT_SIZE);
-        ++ip; break;
-
-      case INSTR_ISEQUALS_VAR_VAR:
-        break;
-
       case INSTR_ADDS_VAR_VAR:
-        /* process integers */
-        i=0;
-        while (DEST_STRUCT_IBLOCK(i).size > 0) {
-          int j=DEST_STRUCT_IBLOCK(i).size;
-          while (j--) {
-            DEST_STRUCT_IBLOCK_VAR(i,j) += SRC_STRUCT_IBLOCK_VAR(i,j);
-          }
-          ++i;
-        }
-        /* process floats */
-        i=0;
-        while (DEST_STRUCT_FBLOCK(i).size > 0) {
-          int j=DEST_STRUCT_FBLOCK(i).size;
-          while (j--) {
-            DEST_STRUCT_FBLOCK_VAR(i,j) += SRC_STRUCT_FBLOCK_VAR(i,j);
-          }
-          ++i;
-        }
-        ++ip; break;
-
       case INSTR_SUBS_VAR_VAR:
-        /* process integers */
-        i=0;
-        while (DEST_STRUCT_IBLOCK(i).size > 0) {
-          int j=DEST_STRUCT_IBLOCK(i).size;
-          while (j--) {
-            DEST_STRUCT_IBLOCK_VAR(i,j) -= SRC_STRUCT_IBLOCK_VAR(i,j);
-          }
-          ++i;
-        }
-        /* process floats */
-        i=0;
-        while (DEST_STRUCT_FBLOCK(i).size > 0) {
-          int j=DEST_STRUCT_FBLOCK(i).size;
-          while (j--) {
-            DEST_STRUCT_FBLOCK_VAR(i,j) -= SRC_STRUCT_FBLOCK_VAR(i,j);
-          }
-          ++i;
-        }
-        ++ip; break;
-
       case INSTR_MULS_VAR_VAR:
-        /* process integers */
-        i=0;
-        while (DEST_STRUCT_IBLOCK(i).size > 0) {
-          int j=DEST_STRUCT_IBLOCK(i).size;
-          while (j--) {
-            DEST_STRUCT_IBLOCK_VAR(i,j) *= SRC_STRUCT_IBLOCK_VAR(i,j);
-          }
-          ++i;
-        }
-        /* process floats */
-        i=0;
-        while (DEST_STRUCT_FBLOCK(i).size > 0) {
-          int j=DEST_STRUCT_FBLOCK(i).size;
-          while (j--) {
-            DEST_STRUCT_FBLOCK_VAR(i,j) *= SRC_STRUCT_FBLOCK_VAR(i,j);
-          }
-          ++i;
-        }
-        ++ip; break;
-        
       case INSTR_DIVS_VAR_VAR:
-        /* process integers */
-        i=0;
-        while (DEST_STRUCT_IBLOCK(i).size > 0) {
-          int j=DEST_STRUCT_IBLOCK(i).size;
-          while (j--) {
-            DEST_STRUCT_IBLOCK_VAR(i,j) /= SRC_STRUCT_IBLOCK_VAR(i,j);
-          }
-          ++i;
-        }
-        /* process floats */
-        i=0;
-        while (DEST_STRUCT_FBLOCK(i).size > 0) {
-          int j=DEST_STRUCT_FBLOCK(i).size;
-          while (j--) {
-            DEST_STRUCT_FBLOCK_VAR(i,j) /= SRC_STRUCT_FBLOCK_VAR(i,j);
-          }
-          ++i;
-        }
+        gsl_execute_struct_instr(gsl, &instr[ip]);
         ++ip; break;
 
+      case INSTR_ISEQUALS_VAR_VAR:
+        break;
+
       default:
         printf("NOT IMPLEMENTED : %d\n", instr[ip].id);
         ++ip;
@@ -1282,11 +1249,16 @@ static void gsl_create_fast_iflow(void)
     fastiflow->instr[i].proto = iflow->instr[i];
   }
   currentGoomSL->fastiflow = fastiflow;
+
+  /* et en code natif quand le cpu le permet */
+  if (currentGoomSL->native != NULL)
+    gsl_native_free(currentGoomSL->native);
+  currentGoomSL->native = gsl_native_new(currentGoomSL, fastiflow);
 #endif
 } /* }}} */
 
 void yy_scan_string(const char *str);
-void yyparse(void);
+int yyparse(void);
 
 GoomHash *gsl_globals(GoomSL *_this)
 {
@@ -1374,7 +1346,10 @@ void gsl_execute(GoomSL *scanner)
 #if USE_JITC_X86
     scanner->jitc_func();
 #else
-    iflow_execute(scanner->fastiflow, scanner);
+    if ((scanner->native != NULL) && scanner->use_native)
+      gsl_native_execute(scanner->native);
+    else
+      iflow_execute(scanner->fastiflow, scanner);
 #endif
   }
 } /* }}} */
@@ -1402,6 +1377,9 @@ GoomSL *gsl_new(void)
   gss->ptrArray = (void**)malloc(gss->ptrArraySize * sizeof(void*));
 #ifdef USE_JITC_X86
   gss->jitc = NULL;
+#else
+  gss->native = NULL;
+  gss->use_native = 1;
 #endif
   return gss;
 } /* }}} */
@@ -1416,6 +1394,13 @@ void gsl_bind_function(GoomSL *gss, const char *fname, GoomSL_ExternalFunction f
   else fprintf(stderr, "Unable to bind function %s\n", fname);
 } /* }}} */
 
+void gsl_use_native(GoomSL *gss, int use_native)
+{ /* {{{ */
+#ifndef USE_JITC_X86
+  gss->use_native = use_native;
+#endif
+} /* }}} */
+
 int gsl_is_compiled(GoomSL *gss)
 { /* {{{ */
   return gss->compilationOK;
@@ -1423,6 +1408,10 @@ int gsl_is_compiled(GoomSL *gss)
 
 void gsl_free(GoomSL *gss)
 { /* {{{ */
+#ifndef USE_JITC_X86
+  if (gss->native != NULL)
+    gsl_native_free(gss->native);
+#endif
   iflow_free(gss->iflow);
   free(gss->vars);
   free(gss->functions);
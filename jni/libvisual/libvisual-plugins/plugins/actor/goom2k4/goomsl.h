@@ -17,6 +17,10 @@ void   gsl_execute (GoomSL *scanner);
 int    gsl_is_compiled  (GoomSL *gss);
 void   gsl_bind_function(GoomSL *gss, const char *fname, GoomSL_ExternalFunction func);
 
+/* Scripts run as native code where the cpu has a backend, the interpreter
+ * otherwise. Turning this off forces the interpreter. */
+void   gsl_use_native   (GoomSL *gss, int use_native);
+
 int    gsl_malloc  (GoomSL *_this, int size);
 void  *gsl_get_ptr (GoomSL *_this, int id);
 void   gsl_free_ptr(GoomSL *_this, int id);
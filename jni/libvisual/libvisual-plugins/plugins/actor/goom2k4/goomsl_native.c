@@ -0,0 +1,843 @@
+/* MAP_ANONYMOUS isn't declared under -std=c99 otherwise */
+#define _DEFAULT_SOURCE
+#define _BSD_SOURCE
+
+#include "goomsl_native.h"
+#include "goomsl_private.h"
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define GSL_NATIVE_X86_64
+#elif defined(__aarch64__) && !defined(__APPLE__)
+#define GSL_NATIVE_AARCH64
+#endif
+
+#if defined(GSL_NATIVE_X86_64) || defined(GSL_NATIVE_AARCH64)
+#define GSL_NATIVE_BACKEND
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+typedef void (*GslNativeFunc)(void);
+
+struct _GSL_NATIVE { /* {{{ */
+  void         *code;
+  size_t        size;
+  GslNativeFunc func;
+}; /* }}} */
+
+#ifdef GSL_NATIVE_BACKEND
+
+/* The code is one function : an entry that saves what it uses, clears the
+ * flag and calls the first instruction. Every instruction of the flow
+ * follows, in order. CALL and RET become the cpu's call and return, so a
+ * script's top level RET goes back to the entry. The interpreter's flag
+ * lives in a callee saved register, external functions and struct
+ * instructions are C calls. */
+
+#define FIXUP_REL32 0 /* x86-64 rel32 of a jmp, jcc or call */
+#define FIXUP_IMM26 1 /* AArch64 b and bl */
+#define FIXUP_IMM19 2 /* AArch64 cbz and cbnz */
+
+typedef struct _GSL_NATIVE_FIXUP { /* {{{ */
+  int at;     /* where the branch is in the code */
+  int target; /* the instruction it goes to */
+  int kind;
+} GslNativeFixup; /* }}} */
+
+typedef struct _GSL_NATIVE_CODE { /* {{{ */
+  unsigned char *bytes;
+  int size;
+  int capacity;
+  int failed;
+
+  int *offsets; /* where each instruction starts in the code */
+
+  GslNativeFixup *fixups;
+  int nb_fixups;
+  int fixups_capacity;
+} GslNativeCode; /* }}} */
+
+static void code_emit(GslNativeCode *c, const void *bytes, int size)
+{ /* {{{ */
+  if (c->failed)
+    return;
+  if (c->size + size > c->capacity) {
+    int capacity = c->capacity * 2;
+    unsigned char *grown;
+    while (capacity < c->size + size)
+      capacity *= 2;
+    grown = (unsigned char*)realloc(c->bytes, capacity);
+    if (grown == NULL) {
+      c->failed = 1;
+      return;
+    }
+    c->bytes = grown;
+    c->capacity = capacity;
+  }
+  memcpy(c->bytes + c->size, bytes, size);
+  c->size += size;
+} /* }}} */
+
+/* both targets are little endian */
+static void code_emit_u32(GslNativeCode *c, uint32_t v)
+{ /* {{{ */
+  unsigned char b[4];
+  b[0] = v; b[1] = v >> 8; b[2] = v >> 16; b[3] = v >> 24;
+  code_emit(c, b, 4);
+} /* }}} */
+
+static void code_add_fixup(GslNativeCode *c, int at, int target, int kind)
+{ /* {{{ */
+  if (c->failed)
+    return;
+  if (c->nb_fixups == c->fixups_capacity) {
+    GslNativeFixup *grown;
+    c->fixups_capacity *= 2;
+    grown = (GslNativeFixup*)realloc(c->fixups, c->fixups_capacity * sizeof(GslNativeFixup));
+    if (grown == NULL) {
+      c->failed = 1;
+      return;
+    }
+    c->fixups = grown;
+  }
+  c->fixups[c->nb_fixups].at = at;
+  c->fixups[c->nb_fixups].target = target;
+  c->fixups[c->nb_fixups].kind = kind;
+  c->nb_fixups++;
+} /* }}} */
+
+#define EMIT(c, ...) do { \
+  static const unsigned char emit_bytes_[] = { __VA_ARGS__ }; \
+  code_emit((c), emit_bytes_, sizeof(emit_bytes_)); \
+} while (0)
+
+#endif /* GSL_NATIVE_BACKEND */
+
+#ifdef GSL_NATIVE_X86_64
+
+/* ebx is the flag, rdi and rsi hold the addresses of the destination and
+ * source variables, eax, ecx, xmm0 and xmm1 their values. r12 keeps rsp
+ * while it is aligned for a C call. */
+
+static void code_emit_u64(GslNativeCode *c, uint64_t v)
+{ /* {{{ */
+  code_emit_u32(c, (uint32_t)v);
+  code_emit_u32(c, (uint32_t)(v >> 32));
+} /* }}} */
+
+static void x86_mov_rax(GslNativeCode *c, const void *p) { EMIT(c, 0x48, 0xb8); code_emit_u64(c, (uintptr_t)p); }
+static void x86_mov_rsi(GslNativeCode *c, const void *p) { EMIT(c, 0x48, 0xbe); code_emit_u64(c, (uintptr_t)p); }
+static void x86_mov_rdi(GslNativeCode *c, const void *p) { EMIT(c, 0x48, 0xbf); code_emit_u64(c, (uintptr_t)p); }
+
+static void x86_branch(GslNativeCode *c, int target)
+{ /* {{{ */
+  code_add_fixup(c, c->size, target, FIXUP_REL32);
+  code_emit_u32(c, 0);
+} /* }}} */
+
+/* calls the function at rax */
+static void x86_call_rax(GslNativeCode *c)
+{ /* {{{ */
+  EMIT(c, 0x49, 0x89, 0xe4);        /* mov  r12, rsp */
+  EMIT(c, 0x48, 0x83, 0xe4, 0xf0);  /* and  rsp, -16 */
+  EMIT(c, 0xff, 0xd0);              /* call rax */
+  EMIT(c, 0x4c, 0x89, 0xe4);        /* mov  rsp, r12 */
+} /* }}} */
+
+static void x86_emit_entry(GslNativeCode *c)
+{ /* {{{ */
+  EMIT(c, 0x53);                    /* push rbx */
+  EMIT(c, 0x41, 0x54);              /* push r12 */
+  EMIT(c, 0x31, 0xdb);              /* xor  ebx, ebx */
+  EMIT(c, 0xe8);                    /* call instruction 0 */
+  x86_branch(c, 0);
+  EMIT(c, 0x41, 0x5c);              /* pop  r12 */
+  EMIT(c, 0x5b);                    /* pop  rbx */
+  EMIT(c, 0xc3);                    /* ret */
+} /* }}} */
+
+/* eax = source variable or value */
+static void x86_load_src_int(GslNativeCode *c, FastInstruction *instr, int is_var)
+{ /* {{{ */
+  if (is_var) {
+    x86_mov_rsi(c, instr->data.usrc.var);
+    EMIT(c, 0x8b, 0x06);            /* mov eax, [rsi] */
+  }
+  else {
+    EMIT(c, 0xb8);                  /* mov eax, value */
+    code_emit_u32(c, instr->data.usrc.value_int);
+  }
+} /* }}} */
+
+/* xmm0 = destination variable, xmm1 = source variable or value */
+static void x86_load_floats(GslNativeCode *c, FastInstruction *instr, int is_var)
+{ /* {{{ */
+  if (is_var) {
+    x86_mov_rsi(c, instr->data.usrc.var);
+    EMIT(c, 0xf3, 0x0f, 0x10, 0x0e);  /* movss xmm1, [rsi] */
+  }
+  else {
+    EMIT(c, 0xb8);                    /* mov   eax, value */
+    code_emit_u32(c, instr->data.usrc.value_int);
+    EMIT(c, 0x66, 0x0f, 0x6e, 0xc8);  /* movd  xmm1, eax */
+  }
+  x86_mov_rdi(c, instr->data.udest.var);
+  EMIT(c, 0xf3, 0x0f, 0x10, 0x07);    /* movss xmm0, [rdi] */
+} /* }}} */
+
+static void x86_emit_instr(GslNativeCode *c, GoomSL *gsl, FastInstruction *instr, int ip)
+{ /* {{{ */
+  int is_var = 0;
+
+  switch (instr->id) {
+
+    case INSTR_SETI_VAR_VAR:
+    case INSTR_SETF_VAR_VAR:
+    case INSTR_SETP_VAR_VAR:
+      x86_load_src_int(c, instr, 1);
+      x86_mov_rdi(c, instr->data.udest.var);
+      EMIT(c, 0x89, 0x07);                    /* mov [rdi], eax */
+      break;
+
+    case INSTR_SETI_VAR_INTEGER:
+    case INSTR_SETF_VAR_FLOAT:
+    case INSTR_SETP_VAR_PTR:
+      x86_mov_rdi(c, instr->data.udest.var);
+      EMIT(c, 0xc7, 0x07);                    /* mov dword [rdi], value */
+      code_emit_u32(c, instr->data.usrc.value_int);
+      break;
+
+    case INSTR_ADDI_VAR_VAR:
+    case INSTR_SUBI_VAR_VAR:
+      x86_load_src_int(c, instr, 1);
+      x86_mov_rdi(c, instr->data.udest.var);
+      if (instr->id == INSTR_ADDI_VAR_VAR)
+        EMIT(c, 0x01, 0x07);                  /* add [rdi], eax */
+      else
+        EMIT(c, 0x29, 0x07);                  /* sub [rdi], eax */
+      break;
+
+    case INSTR_ADDI_VAR_INTEGER:
+    case INSTR_SUBI_VAR_INTEGER:
+      x86_mov_rdi(c, instr->data.udest.var);
+      if (instr->id == INSTR_ADDI_VAR_INTEGER)
+        EMIT(c, 0x81, 0x07);                  /* add dword [rdi], value */
+      else
+        EMIT(c, 0x81, 0x2f);                  /* sub dword [rdi], value */
+      code_emit_u32(c, instr->data.usrc.value_int);
+      break;
+
+    case INSTR_MULI_VAR_VAR:
+      x86_load_src_int(c, instr, 1);
+      x86_mov_rdi(c, instr->data.udest.var);
+      EMIT(c, 0x0f, 0xaf, 0x07);              /* imul eax, [rdi] */
+      EMIT(c, 0x89, 0x07);                    /* mov  [rdi], eax */
+      break;
+
+    case INSTR_MULI_VAR_INTEGER:
+      x86_mov_rdi(c, instr->data.udest.var);
+      EMIT(c, 0x69, 0x07);                    /* imul eax, [rdi], value */
+      code_emit_u32(c, instr->data.usrc.value_int);
+      EMIT(c, 0x89, 0x07);                    /* mov  [rdi], eax */
+      break;
+
+    case INSTR_DIVI_VAR_VAR:
+    case INSTR_DIVI_VAR_INTEGER:
+      if (instr->id == INSTR_DIVI_VAR_VAR) {
+        x86_mov_rsi(c, instr->data.usrc.var);
+        EMIT(c, 0x8b, 0x0e);                  /* mov  ecx, [rsi] */
+      }
+      else {
+        EMIT(c, 0xb9);                        /* mov  ecx, value */
+        code_emit_u32(c, instr->data.usrc.value_int);
+      }
+      x86_mov_rdi(c, instr->data.udest.var);
+      EMIT(c, 0x8b, 0x07);                    /* mov  eax, [rdi] */
+      EMIT(c, 0x99);                          /* cdq */
+      EMIT(c, 0xf7, 0xf9);                    /* idiv ecx */
+      EMIT(c, 0x89, 0x07);                    /* mov  [rdi], eax */
+      break;
+
+    case INSTR_ISLOWERI_VAR_VAR:
+    case INSTR_ISEQUALI_VAR_VAR:
+    case INSTR_ISEQUALP_VAR_VAR:
+      x86_load_src_int(c, instr, 1);
+      x86_mov_rdi(c, instr->data.udest.var);
+      EMIT(c, 0x39, 0x07);                    /* cmp [rdi], eax */
+      if (instr->id == INSTR_ISLOWERI_VAR_VAR)
+        EMIT(c, 0x0f, 0x9c, 0xc3);            /* setl bl */
+      else
+        EMIT(c, 0x0f, 0x94, 0xc3);            /* sete bl */
+      EMIT(c, 0x0f, 0xb6, 0xdb);              /* movzx ebx, bl */
+      break;
+
+    case INSTR_ISLOWERI_VAR_INTEGER:
+    case INSTR_ISEQUALI_VAR_INTEGER:
+    case INSTR_ISEQUALP_VAR_PTR:
+      x86_mov_rdi(c, instr->data.udest.var);
+      EMIT(c, 0x81, 0x3f);                    /* cmp dword [rdi], value */
+      code_emit_u32(c, instr->data.usrc.value_int);
+      if (instr->id == INSTR_ISLOWERI_VAR_INTEGER)
+        EMIT(c, 0x0f, 0x9c, 0xc3);            /* setl bl */
+      else
+        EMIT(c, 0x0f, 0x94, 0xc3);            /* sete bl */
+      EMIT(c, 0x0f, 0xb6, 0xdb);              /* movzx ebx, bl */
+      break;
+
+    case INSTR_ADDF_VAR_VAR:
+    case INSTR_SUBF_VAR_VAR:
+    case INSTR_MULF_VAR_VAR:
+    case INSTR_DIVF_VAR_VAR:
+      is_var = 1;
+    case INSTR_ADDF_VAR_FLOAT:
+    case INSTR_SUBF_VAR_FLOAT:
+    case INSTR_MULF_VAR_FLOAT:
+    case INSTR_DIVF_VAR_FLOAT:
+      x86_load_floats(c, instr, is_var);
+      switch (instr->id) {
+        case INSTR_ADDF_VAR_VAR: case INSTR_ADDF_VAR_FLOAT:
+          EMIT(c, 0xf3, 0x0f, 0x58, 0xc1);    /* addss xmm0, xmm1 */
+          break;
+        case INSTR_SUBF_VAR_VAR: case INSTR_SUBF_VAR_FLOAT:
+          EMIT(c, 0xf3, 0x0f, 0x5c, 0xc1);    /* subss xmm0, xmm1 */
+          break;
+        case INSTR_MULF_VAR_VAR: case INSTR_MULF_VAR_FLOAT:
+          EMIT(c, 0xf3, 0x0f, 0x59, 0xc1);    /* mulss xmm0, xmm1 */
+          break;
+        default:
+          EMIT(c, 0xf3, 0x0f, 0x5e, 0xc1);    /* divss xmm0, xmm1 */
+          break;
+      }
+      EMIT(c, 0xf3, 0x0f, 0x11, 0x07);        /* movss [rdi], xmm0 */
+      break;
+
+    case INSTR_ISLOWERF_VAR_VAR:
+      is_var = 1;
+    case INSTR_ISLOWERF_VAR_FLOAT:
+      /* src > dest is false when unordered, as dest < src is in C */
+      x86_load_floats(c, instr, is_var);
+      EMIT(c, 0x0f, 0x2e, 0xc8);              /* ucomiss xmm1, xmm0 */
+      EMIT(c, 0x0f, 0x97, 0xc3);              /* seta    bl */
+      EMIT(c, 0x0f, 0xb6, 0xdb);              /* movzx   ebx, bl */
+      break;
+
+    case INSTR_ISEQUALF_VAR_VAR:
+      is_var = 1;
+    case INSTR_ISEQUALF_VAR_FLOAT:
+      x86_load_floats(c, instr, is_var);
+      EMIT(c, 0x0f, 0x2e, 0xc1);              /* ucomiss xmm0, xmm1 */
+      EMIT(c, 0x0f, 0x94, 0xc0);              /* sete    al */
+      EMIT(c, 0x0f, 0x9b, 0xc1);              /* setnp   cl */
+      EMIT(c, 0x20, 0xc8);                    /* and     al, cl */
+      EMIT(c, 0x0f, 0xb6, 0xd8);              /* movzx   ebx, al */
+      break;
+
+    case INSTR_NOT_VAR:
+      EMIT(c, 0x83, 0xf3, 0x01);              /* xor ebx, 1 */
+      break;
+
+    case INSTR_NOP:
+      break;
+
+    case INSTR_JUMP:
+      EMIT(c, 0xe9);                          /* jmp */
+      x86_branch(c, ip + instr->data.udest.jump_offset);
+      break;
+
+    case INSTR_JZERO:
+    case INSTR_JNZERO:
+      EMIT(c, 0x85, 0xdb);                    /* test ebx, ebx */
+      if (instr->id == INSTR_JZERO)
+        EMIT(c, 0x0f, 0x84);                  /* jz */
+      else
+        EMIT(c, 0x0f, 0x85);                  /* jnz */
+      x86_branch(c, ip + instr->data.udest.jump_offset);
+      break;
+
+    case INSTR_CALL:
+      EMIT(c, 0xe8);                          /* call */
+      x86_branch(c, ip + instr->data.udest.jump_offset);
+      break;
+
+    case INSTR_RET:
+      EMIT(c, 0xc3);                          /* ret */
+      break;
+
+    case INSTR_EXT_CALL:
+      /* function(gsl, gsl->vars, external_function->vars), read when called
+       * as the function is bound after compiling */
+      x86_mov_rdi(c, gsl);
+      x86_mov_rax(c, &gsl->vars);
+      EMIT(c, 0x48, 0x8b, 0x30);              /* mov rsi, [rax] */
+      x86_mov_rax(c, &instr->data.udest.external_function->vars);
+      EMIT(c, 0x48, 0x8b, 0x10);              /* mov rdx, [rax] */
+      x86_mov_rax(c, &instr->data.udest.external_function->function);
+      EMIT(c, 0x48, 0x8b, 0x00);              /* mov rax, [rax] */
+      x86_call_rax(c);
+      break;
+
+    case INSTR_SETS_VAR_VAR:
+    case INSTR_ADDS_VAR_VAR:
+    case INSTR_SUBS_VAR_VAR:
+    case INSTR_MULS_VAR_VAR:
+    case INSTR_DIVS_VAR_VAR:
+      x86_mov_rdi(c, gsl);
+      x86_mov_rsi(c, instr);
+      x86_mov_rax(c, (const void*)gsl_execute_struct_instr);
+      x86_call_rax(c);
+      break;
+  }
+} /* }}} */
+
+#define native_emit_entry x86_emit_entry
+#define native_emit_instr x86_emit_instr
+#define native_emit_end(c) EMIT(c, 0xc3)
+
+#endif /* GSL_NATIVE_X86_64 */
+
+#ifdef GSL_NATIVE_AARCH64
+
+/* w19 is the flag, x10 and x11 hold the addresses of the destination and
+ * source variables, w12, w13, s0 and s1 their values. x30 is pushed
+ * around every bl and blr, as the script functions don't save it. */
+
+#define A64_X0  0
+#define A64_X1  1
+#define A64_X2  2
+#define A64_X9  9
+#define A64_X10 10
+#define A64_X11 11
+#define A64_W12 12
+#define A64_W13 13
+#define A64_X16 16
+#define A64_W19 19
+
+#define A64_COND_EQ 0x0
+#define A64_COND_MI 0x4
+#define A64_COND_LT 0xb
+
+static void a64_mov_imm64(GslNativeCode *c, int rd, uint64_t v)
+{ /* {{{ */
+  int hw;
+  code_emit_u32(c, 0xd2800000 | ((uint32_t)(v & 0xffff) << 5) | rd);          /* movz xd, #v */
+  for (hw = 1; hw < 4; hw++) {
+    uint32_t chunk = (v >> (16 * hw)) & 0xffff;
+    if (chunk != 0)
+      code_emit_u32(c, 0xf2800000 | (hw << 21) | (chunk << 5) | rd);         /* movk xd, #chunk, lsl #16*hw */
+  }
+} /* }}} */
+
+static void a64_mov_ptr(GslNativeCode *c, int rd, const void *p)
+{ /* {{{ */
+  a64_mov_imm64(c, rd, (uintptr_t)p);
+} /* }}} */
+
+static void a64_mov_imm32(GslNativeCode *c, int rd, uint32_t v)
+{ /* {{{ */
+  code_emit_u32(c, 0x52800000 | ((v & 0xffff) << 5) | rd);                    /* movz wd, #v */
+  if (v >> 16)
+    code_emit_u32(c, 0x72800000 | (1 << 21) | ((v >> 16) << 5) | rd);         /* movk wd, #v >> 16, lsl #16 */
+} /* }}} */
+
+static void a64_ldr_w(GslNativeCode *c, int rt, int rn) { code_emit_u32(c, 0xb9400000 | (rn << 5) | rt); }
+static void a64_str_w(GslNativeCode *c, int rt, int rn) { code_emit_u32(c, 0xb9000000 | (rn << 5) | rt); }
+static void a64_ldr_s(GslNativeCode *c, int rt, int rn) { code_emit_u32(c, 0xbd400000 | (rn << 5) | rt); }
+static void a64_str_s(GslNativeCode *c, int rt, int rn) { code_emit_u32(c, 0xbd000000 | (rn << 5) | rt); }
+static void a64_ldr_x(GslNativeCode *c, int rt, int rn) { code_emit_u32(c, 0xf9400000 | (rn << 5) | rt); }
+
+/* wd = wd op wm, op being add, sub, mul (madd with wzr) or sdiv */
+static void a64_op_w(GslNativeCode *c, uint32_t op, int rd, int rm) { code_emit_u32(c, op | (rm << 16) | (rd << 5) | rd); }
+#define A64_ADD_W  0x0b000000
+#define A64_SUB_W  0x4b000000
+#define A64_MUL_W  0x1b007c00
+#define A64_SDIV_W 0x1ac00c00
+
+/* sd = sd op sm */
+#define A64_FADD 0x1e202800
+#define A64_FSUB 0x1e203800
+#define A64_FMUL 0x1e200800
+#define A64_FDIV 0x1e201800
+
+/* cset w19, cond */
+static void a64_set_flag(GslNativeCode *c, int cond) { code_emit_u32(c, 0x1a9f07e0 | ((cond ^ 1) << 12) | A64_W19); }
+
+static void a64_branch(GslNativeCode *c, uint32_t insn, int target, int kind)
+{ /* {{{ */
+  code_add_fixup(c, c->size, target, kind);
+  code_emit_u32(c, insn);
+} /* }}} */
+
+/* calls the function at x16 */
+static void a64_call_x16(GslNativeCode *c)
+{ /* {{{ */
+  code_emit_u32(c, 0xf81f0ffe);   /* str x30, [sp, #-16]! */
+  code_emit_u32(c, 0xd63f0200);   /* blr x16 */
+  code_emit_u32(c, 0xf84107fe);   /* ldr x30, [sp], #16 */
+} /* }}} */
+
+static void a64_emit_entry(GslNativeCode *c)
+{ /* {{{ */
+  code_emit_u32(c, 0xa9be7bfd);   /* stp x29, x30, [sp, #-32]! */
+  code_emit_u32(c, 0x910003fd);   /* mov x29, sp */
+  code_emit_u32(c, 0xf9000bf3);   /* str x19, [sp, #16] */
+  code_emit_u32(c, 0x2a1f03f3);   /* mov w19, wzr */
+  a64_branch(c, 0x94000000, 0, FIXUP_IMM26);  /* bl instruction 0 */
+  code_emit_u32(c, 0xf9400bf3);   /* ldr x19, [sp, #16] */
+  code_emit_u32(c, 0xa8c27bfd);   /* ldp x29, x30, [sp], #32 */
+  code_emit_u32(c, 0xd65f03c0);   /* ret */
+} /* }}} */
+
+/* w13 = source variable or value */
+static void a64_load_src_int(GslNativeCode *c, FastInstruction *instr, int is_var)
+{ /* {{{ */
+  if (is_var) {
+    a64_mov_ptr(c, A64_X11, instr->data.usrc.var);
+    a64_ldr_w(c, A64_W13, A64_X11);
+  }
+  else
+    a64_mov_imm32(c, A64_W13, instr->data.usrc.value_int);
+} /* }}} */
+
+/* s0 = destination variable, s1 = source variable or value */
+static void a64_load_floats(GslNativeCode *c, FastInstruction *instr, int is_var)
+{ /* {{{ */
+  if (is_var) {
+    a64_mov_ptr(c, A64_X11, instr->data.usrc.var);
+    a64_ldr_s(c, 1, A64_X11);
+  }
+  else {
+    a64_mov_imm32(c, A64_W13, instr->data.usrc.value_int);
+    code_emit_u32(c, 0x1e270000 | (A64_W13 << 5) | 1);     /* fmov s1, w13 */
+  }
+  a64_mov_ptr(c, A64_X10, instr->data.udest.var);
+  a64_ldr_s(c, 0, A64_X10);
+} /* }}} */
+
+static void a64_emit_instr(GslNativeCode *c, GoomSL *gsl, FastInstruction *instr, int ip)
+{ /* {{{ */
+  int is_var = 0;
+  uint32_t op = 0;
+
+  switch (instr->id) {
+
+    case INSTR_SETI_VAR_VAR:
+    case INSTR_SETF_VAR_VAR:
+    case INSTR_SETP_VAR_VAR:
+      is_var = 1;
+    case INSTR_SETI_VAR_INTEGER:
+    case INSTR_SETF_VAR_FLOAT:
+    case INSTR_SETP_VAR_PTR:
+      a64_load_src_int(c, instr, is_var);
+      a64_mov_ptr(c, A64_X10, instr->data.udest.var);
+      a64_str_w(c, A64_W13, A64_X10);
+      break;
+
+    case INSTR_ADDI_VAR_VAR:  is_var = 1;
+    case INSTR_ADDI_VAR_INTEGER: op = A64_ADD_W;
+      goto int_op;
+    case INSTR_SUBI_VAR_VAR:  is_var = 1;
+    case INSTR_SUBI_VAR_INTEGER: op = A64_SUB_W;
+      goto int_op;
+    case INSTR_MULI_VAR_VAR:  is_var = 1;
+    case INSTR_MULI_VAR_INTEGER: op = A64_MUL_W;
+      goto int_op;
+    case INSTR_DIVI_VAR_VAR:  is_var = 1;
+    case INSTR_DIVI_VAR_INTEGER: op = A64_SDIV_W;
+    int_op:
+      /* sdiv gives 0 where the interpreter would trap on a division by 0 */
+      a64_load_src_int(c, instr, is_var);
+      a64_mov_ptr(c, A64_X10, instr->data.udest.var);
+      a64_ldr_w(c, A64_W12, A64_X10);
+      a64_op_w(c, op, A64_W12, A64_W13);
+      a64_str_w(c, A64_W12, A64_X10);
+      break;
+
+    case INSTR_ISLOWERI_VAR_VAR:
+    case INSTR_ISEQUALI_VAR_VAR:
+    case INSTR_ISEQUALP_VAR_VAR:
+      is_var = 1;
+    case INSTR_ISLOWERI_VAR_INTEGER:
+    case INSTR_ISEQUALI_VAR_INTEGER:
+    case INSTR_ISEQUALP_VAR_PTR:
+      a64_load_src_int(c, instr, is_var);
+      a64_mov_ptr(c, A64_X10, instr->data.udest.var);
+      a64_ldr_w(c, A64_W12, A64_X10);
+      code_emit_u32(c, 0x6b00001f | (A64_W13 << 16) | (A64_W12 << 5));  /* cmp w12, w13 */
+      if ((instr->id == INSTR_ISLOWERI_VAR_VAR) || (instr->id == INSTR_ISLOWERI_VAR_INTEGER))
+        a64_set_flag(c, A64_COND_LT);
+      else
+        a64_set_flag(c, A64_COND_EQ);
+      break;
+
+    case INSTR_ADDF_VAR_VAR:  is_var = 1;
+    case INSTR_ADDF_VAR_FLOAT: op = A64_FADD;
+      goto float_op;
+    case INSTR_SUBF_VAR_VAR:  is_var = 1;
+    case INSTR_SUBF_VAR_FLOAT: op = A64_FSUB;
+      goto float_op;
+    case INSTR_MULF_VAR_VAR:  is_var = 1;
+    case INSTR_MULF_VAR_FLOAT: op = A64_FMUL;
+      goto float_op;
+    case INSTR_DIVF_VAR_VAR:  is_var = 1;
+    case INSTR_DIVF_VAR_FLOAT: op = A64_FDIV;
+    float_op:
+      a64_load_floats(c, instr, is_var);
+      code_emit_u32(c, op | (1 << 16));                                   /* fop s0, s0, s1 */
+      a64_str_s(c, 0, A64_X10);
+      break;
+
+    case INSTR_ISLOWERF_VAR_VAR:
+    case INSTR_ISEQUALF_VAR_VAR:
+      is_var = 1;
+    case INSTR_ISLOWERF_VAR_FLOAT:
+    case INSTR_ISEQUALF_VAR_FLOAT:
+      /* mi and eq are both false when unordered, as in C */
+      a64_load_floats(c, instr, is_var);
+      code_emit_u32(c, 0x1e212000);                                       /* fcmp s0, s1 */
+      if ((instr->id == INSTR_ISLOWERF_VAR_VAR) || (instr->id == INSTR_ISLOWERF_VAR_FLOAT))
+        a64_set_flag(c, A64_COND_MI);
+      else
+        a64_set_flag(c, A64_COND_EQ);
+      break;
+
+    case INSTR_NOT_VAR:
+      code_emit_u32(c, 0x52000000 | (A64_W19 << 5) | A64_W19);           /* eor w19, w19, #1 */
+      break;
+
+    case INSTR_NOP:
+      break;
+
+    case INSTR_JUMP:
+      a64_branch(c, 0x14000000, ip + instr->data.udest.jump_offset, FIXUP_IMM26);            /* b */
+      break;
+
+    case INSTR_JZERO:
+      a64_branch(c, 0x34000000 | A64_W19, ip + instr->data.udest.jump_offset, FIXUP_IMM19);  /* cbz w19 */
+      break;
+
+    case INSTR_JNZERO:
+      a64_branch(c, 0x35000000 | A64_W19, ip + instr->data.udest.jump_offset, FIXUP_IMM19);  /* cbnz w19 */
+      break;
+
+    case INSTR_CALL:
+      code_emit_u32(c, 0xf81f0ffe);                                       /* str x30, [sp, #-16]! */
+      a64_branch(c, 0x94000000, ip + instr->data.udest.jump_offset, FIXUP_IMM26);            /* bl */
+      code_emit_u32(c, 0xf84107fe);                                       /* ldr x30, [sp], #16 */
+      break;
+
+    case INSTR_RET:
+      code_emit_u32(c, 0xd65f03c0);                                       /* ret */
+      break;
+
+    case INSTR_EXT_CALL:
+      /* function(gsl, gsl->vars, external_function->vars), read when called
+       * as the function is bound after compiling */
+      a64_mov_ptr(c, A64_X0, gsl);
+      a64_mov_ptr(c, A64_X9, &gsl->vars);
+      a64_ldr_x(c, A64_X1, A64_X9);
+      a64_mov_ptr(c, A64_X9, &instr->data.udest.external_function->vars);
+      a64_ldr_x(c, A64_X2, A64_X9);
+      a64_mov_ptr(c, A64_X9, &instr->data.udest.external_function->function);
+      a64_ldr_x(c, A64_X16, A64_X9);
+      a64_call_x16(c);
+      break;
+
+    case INSTR_SETS_VAR_VAR:
+    case INSTR_ADDS_VAR_VAR:
+    case INSTR_SUBS_VAR_VAR:
+    case INSTR_MULS_VAR_VAR:
+    case INSTR_DIVS_VAR_VAR:
+      a64_mov_ptr(c, A64_X0, gsl);
+      a64_mov_ptr(c, A64_X1, instr);
+      a64_mov_ptr(c, A64_X16, (const void*)gsl_execute_struct_instr);
+      a64_call_x16(c);
+      break;
+  }
+} /* }}} */
+
+#define native_emit_entry a64_emit_entry
+#define native_emit_instr a64_emit_instr
+#define native_emit_end(c) code_emit_u32(c, 0xd65f03c0)
+
+#endif /* GSL_NATIVE_AARCH64 */
+
+#ifdef GSL_NATIVE_BACKEND
+
+/* Everything but ISEQUALS, which the interpreter doesn't run either, with
+ * every branch landing in the flow */
+static int flow_is_supported(FastInstructionFlow *flow)
+{ /* {{{ */
+  int ip;
+
+  for (ip = 0; ip < flow->number; ++ip) {
+    switch (flow->instr[ip].id) {
+      case INSTR_JUMP:
+      case INSTR_JZERO:
+      case INSTR_JNZERO:
+      case INSTR_CALL:
+        {
+          int target = ip + flow->instr[ip].data.udest.jump_offset;
+          if ((target < 0) || (target >= flow->number))
+            return 0;
+        }
+        break;
+
+      case INSTR_EXT_CALL:
+        if (flow->instr[ip].data.udest.external_function == NULL)
+          return 0;
+        break;
+
+      case INSTR_SETI_VAR_INTEGER: case INSTR_SETI_VAR_VAR:
+      case INSTR_SETF_VAR_FLOAT:   case INSTR_SETF_VAR_VAR:
+      case INSTR_SETP_VAR_PTR:     case INSTR_SETP_VAR_VAR:
+      case INSTR_ADDI_VAR_INTEGER: case INSTR_ADDI_VAR_VAR:
+      case INSTR_SUBI_VAR_INTEGER: case INSTR_SUBI_VAR_VAR:
+      case INSTR_MULI_VAR_INTEGER: case INSTR_MULI_VAR_VAR:
+      case INSTR_DIVI_VAR_INTEGER: case INSTR_DIVI_VAR_VAR:
+      case INSTR_ADDF_VAR_FLOAT:   case INSTR_ADDF_VAR_VAR:
+      case INSTR_SUBF_VAR_FLOAT:   case INSTR_SUBF_VAR_VAR:
+      case INSTR_MULF_VAR_FLOAT:   case INSTR_MULF_VAR_VAR:
+      case INSTR_DIVF_VAR_FLOAT:   case INSTR_DIVF_VAR_VAR:
+      case INSTR_ISLOWERI_VAR_INTEGER: case INSTR_ISLOWERI_VAR_VAR:
+      case INSTR_ISLOWERF_VAR_FLOAT:   case INSTR_ISLOWERF_VAR_VAR:
+      case INSTR_ISEQUALI_VAR_INTEGER: case INSTR_ISEQUALI_VAR_VAR:
+      case INSTR_ISEQUALF_VAR_FLOAT:   case INSTR_ISEQUALF_VAR_VAR:
+      case INSTR_ISEQUALP_VAR_PTR:     case INSTR_ISEQUALP_VAR_VAR:
+      case INSTR_NOT_VAR:
+      case INSTR_NOP:
+      case INSTR_RET:
+      case INSTR_SETS_VAR_VAR:
+      case INSTR_ADDS_VAR_VAR:
+      case INSTR_SUBS_VAR_VAR:
+      case INSTR_MULS_VAR_VAR:
+      case INSTR_DIVS_VAR_VAR:
+        break;
+
+      default:
+        return 0;
+    }
+  }
+  return 1;
+} /* }}} */
+
+static int code_resolve_fixups(GslNativeCode *c)
+{ /* {{{ */
+  int i;
+
+  for (i = 0; i < c->nb_fixups; ++i) {
+    GslNativeFixup *fixup = &c->fixups[i];
+    unsigned char *at = c->bytes + fixup->at;
+    int32_t delta;
+    uint32_t insn;
+
+    if (fixup->kind == FIXUP_REL32) {
+      delta = c->offsets[fixup->target] - (fixup->at + 4);
+      at[0] = delta; at[1] = delta >> 8; at[2] = delta >> 16; at[3] = delta >> 24;
+      continue;
+    }
+
+    delta = (c->offsets[fixup->target] - fixup->at) / 4;
+    insn = at[0] | (at[1] << 8) | (at[2] << 16) | ((uint32_t)at[3] << 24);
+    if (fixup->kind == FIXUP_IMM26) {
+      if ((delta < -(1 << 25)) || (delta >= (1 << 25)))
+        return 0;
+      insn |= (uint32_t)delta & 0x3ffffff;
+    }
+    else {
+      if ((delta < -(1 << 18)) || (delta >= (1 << 18)))
+        return 0;
+      insn |= ((uint32_t)delta & 0x7ffff) << 5;
+    }
+    at[0] = insn; at[1] = insn >> 8; at[2] = insn >> 16; at[3] = insn >> 24;
+  }
+  return 1;
+} /* }}} */
+
+static GslNative *code_install(GslNativeCode *c)
+{ /* {{{ */
+  GslNative *_this;
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t size = (c->size + page - 1) / page * page;
+  void *mem;
+
+  mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED)
+    return NULL;
+
+  memcpy(mem, c->bytes, c->size);
+  if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+    munmap(mem, size);
+    return NULL;
+  }
+  __builtin___clear_cache((char*)mem, (char*)mem + c->size);
+
+  _this = (GslNative*)malloc(sizeof(GslNative));
+  if (_this == NULL) {
+    munmap(mem, size);
+    return NULL;
+  }
+  _this->code = mem;
+  _this->size = size;
+  _this->func = (GslNativeFunc)mem;
+  return _this;
+} /* }}} */
+
+#endif /* GSL_NATIVE_BACKEND */
+
+GslNative *gsl_native_new(GoomSL *gsl, FastInstructionFlow *flow)
+{ /* {{{ */
+#ifdef GSL_NATIVE_BACKEND
+  GslNative *_this = NULL;
+  GslNativeCode c;
+  int ip;
+
+  if ((flow->number == 0) || !flow_is_supported(flow))
+    return NULL;
+
+  c.size = 0;
+  c.capacity = 1024;
+  c.bytes = (unsigned char*)malloc(c.capacity);
+  c.offsets = (int*)malloc((flow->number + 1) * sizeof(int));
+  c.nb_fixups = 0;
+  c.fixups_capacity = 64;
+  c.fixups = (GslNativeFixup*)malloc(c.fixups_capacity * sizeof(GslNativeFixup));
+  c.failed = (c.bytes == NULL) || (c.offsets == NULL) || (c.fixups == NULL);
+
+  if (!c.failed) {
+    native_emit_entry(&c);
+    for (ip = 0; ip < flow->number; ++ip) {
+      c.offsets[ip] = c.size;
+      native_emit_instr(&c, gsl, &flow->instr[ip], ip);
+    }
+    /* the flow ends with a RET, this only keeps a stray jump from running off */
+    c.offsets[flow->number] = c.size;
+    native_emit_end(&c);
+  }
+
+  if (!c.failed && code_resolve_fixups(&c))
+    _this = code_install(&c);
+
+  free(c.bytes);
+  free(c.offsets);
+  free(c.fixups);
+  return _this;
+#else
+  return NULL;
+#endif
+} /* }}} */
+
+void gsl_native_free(GslNative *_this)
+{ /* {{{ */
+#ifdef GSL_NATIVE_BACKEND
+  munmap(_this->code, _this->size);
+#endif
+  free(_this);
+} /* }}} */
+
+void gsl_native_execute(GslNative *_this)
+{ /* {{{ */
+  _this->func();
+} /* }}} */
@@ -0,0 +1,27 @@
+#ifndef _GOOMSL_NATIVE_H
+#define _GOOMSL_NATIVE_H
+
+/**
+ * Compiles an optimised instruction flow to machine code, so that scripts
+ * run every frame without going through the interpreter's switch.
+ *
+ * There is a backend for x86-64 and one for AArch64. The code works on
+ * the script's variables in place, so both can be used on the same
+ * GoomSL: they give the same results.
+ */
+
+#include "goomsl.h"
+
+typedef struct _GSL_NATIVE GslNative;
+
+struct _FastInstructionFlow;
+
+/* Returns NULL when there's no backend for this cpu, when executable
+ * memory can't be had or when the flow has an instruction the backends
+ * don't know. The interpreter runs the flow then. */
+GslNative *gsl_native_new(GoomSL *gsl, struct _FastInstructionFlow *flow);
+void       gsl_native_free(GslNative *_this);
+
+void       gsl_native_execute(GslNative *_this);
+
+#endif
@@ -0,0 +1,237 @@
+#include "goomsl.h"
+#include "goomsl_private.h"
+#include "default_scripts.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+/* Runs every script through the interpreter and through the native code
+ * and checks that both leave the same globals, frame after frame. */
+
+#define FRAMES 4
+
+static const char *scripts[] = {
+  GOOM_MAIN_SCRIPT,
+
+  /* integer and float arithmetic, variables and constants */
+  "int a = 7\n"
+  "int b = -3\n"
+  "int c = a * b + 100 / a - (b - a) * 2\n"
+  "int d = (0 - c) / 4\n"
+  "float x = 1.5\n"
+  "float y = -0.25\n"
+  "float z = x * y + x / 3.0 - (y - x) * 2.5\n"
+  "float w = (0.0 - z) / 7.0\n"
+  "a += 5\n"
+  "b -= a\n"
+  "c *= 3\n"
+  "d /= 2\n"
+  "x += 0.125\n"
+  "y -= x\n"
+  "z *= z\n"
+  "w /= 0.5\n",
+
+  /* tests, not and branches */
+  "int a = 3\n"
+  "int b = 5\n"
+  "float x = 0.5\n"
+  "float y = 0.5\n"
+  "int r = 0\n"
+  "(a < b) ? r += 1\n"
+  "(a > b) ? r += 2\n"
+  "(a <= 3) ? r += 4\n"
+  "(b >= 6) ? r += 8\n"
+  "(a = 3) ? r += 16\n"
+  "(a != b) ? r += 32\n"
+  "(not a = b) ? r += 64\n"
+  "(x = y) ? r += 128\n"
+  "(x < y) ? r += 256\n"
+  "(x <= y) ? r += 512\n"
+  "(x > 0.25) ? r += 1024\n"
+  "(x != 0.5) ? r += 2048\n"
+  "(a < 4) ?\n"
+  "{\n"
+  "  a = a * 10\n"
+  "  b = b + a\n"
+  "}\n",
+
+  /* loops, nested, and values carried over frames */
+  "int frame\n"
+  "int acc\n"
+  "float f\n"
+  "int i = 0\n"
+  "frame += 1\n"
+  "while i < 50 do\n"
+  "{\n"
+  "  int j = 0\n"
+  "  while j < i do\n"
+  "  {\n"
+  "    acc = acc / 3 + i * j - frame\n"
+  "    j += 3\n"
+  "  }\n"
+  "  f = f * 0.9 + 0.1\n"
+  "  i += 1\n"
+  "}\n"
+  "int k = 0\n"
+  "for k in (frame acc i) do acc += k\n",
+
+  /* script functions calling each other, with results */
+  "declare <sq: int x> : int\n"
+  "declare <hyp: float a, float b> : float\n"
+  "declare <fib: int n> : int\n"
+  "int s = [sq: x = 12]\n"
+  "float h = [hyp: a = 3.0 b = 4.0]\n"
+  "int f = [fib: n = 20]\n"
+  "int t = [sq: x = [fib: n = 7]]\n"
+  "<sq: int x> : int\n"
+  "  sq = x * x\n"
+  "<hyp: float a, float b> : float\n"
+  "  hyp = a * a + b * b\n"
+  "<fib: int n> : int\n"
+  "  int u = 0\n"
+  "  int v = 1\n"
+  "  while n > 0 do\n"
+  "  {\n"
+  "    int tmp = u + v\n"
+  "    u = v\n"
+  "    v = tmp\n"
+  "    n -= 1\n"
+  "  }\n"
+  "  fib = u\n",
+
+  /* external functions and pointers */
+  "string str = \"native code\"\n"
+  "ptr p = str\n"
+  "int eq = 0\n"
+  "(p = str) ? eq = 1\n"
+  "int c0 = [charAt: value = str index = 0]\n"
+  "int c7 = [charAt: value = p index = 7]\n"
+  "int n = [f2i: value = 3.75]\n"
+  "float g = [i2f: value = c0]\n"
+  "float r = g / 3.0 + [i2f: value = n]\n",
+
+  /* structures, copied and combined field by field */
+  "struct <vec: float x, float y, int n>\n"
+  "struct <seg: vec a, vec b>\n"
+  "vec u\n"
+  "vec v\n"
+  "seg s\n"
+  "u.x = 1.5\n"
+  "u.y = -2.0\n"
+  "u.n = 3\n"
+  "v = u\n"
+  "v += u\n"
+  "v *= u\n"
+  "v -= u\n"
+  "v /= u\n"
+  "s.a = v\n"
+  "s.b = u\n"
+  "s.b.n += s.a.n * 5\n",
+  NULL
+};
+
+static GoomHash *other_globals;
+static int       mismatches;
+
+static void compare_global(GoomHash *caller, const char *key, HashValue *value)
+{ /* {{{ */
+  HashValue *other;
+
+  /* the type of each variable is stored next to it, and temporaries are
+   * numbered across compilations */
+  if (key[0] == '_')
+    return;
+
+  other = goom_hash_get(other_globals, key);
+  if ((other == NULL) || memcmp(value->ptr, other->ptr, sizeof(int))) {
+    fprintf(stderr, "  %s: interpreter 0x%08x, native 0x%08x\n", key,
+        *(int*)value->ptr, other ? *(int*)other->ptr : 0);
+    mismatches++;
+  }
+} /* }}} */
+
+/* variables aren't initialised, both runs start from 0 */
+static void clear_global(GoomHash *caller, const char *key, HashValue *value)
+{ /* {{{ */
+  if (key[0] != '_')
+    *(int*)value->ptr = 0;
+} /* }}} */
+
+static double now(void)
+{ /* {{{ */
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+} /* }}} */
+
+/* time per frame of a script, both ways */
+static void bench(const char *script)
+{ /* {{{ */
+  GoomSL *gsl = gsl_new();
+  double start, interpreted, native;
+  int i;
+
+  gsl_compile(gsl, script);
+  goom_hash_for_each(gsl_globals(gsl), clear_global);
+
+  gsl_use_native(gsl, 0);
+  start = now();
+  for (i = 0; i < 1000; ++i)
+    gsl_execute(gsl);
+  interpreted = now() - start;
+
+  gsl_use_native(gsl, 1);
+  start = now();
+  for (i = 0; i < 1000; ++i)
+    gsl_execute(gsl);
+  native = now() - start;
+
+  printf("loop script: interpreter %.3f ms, native %.3f ms per frame\n",
+      interpreted, native);
+  gsl_free(gsl);
+} /* }}} */
+
+int main(int argc, char **argv)
+{
+  int i, frame, compiled = 0;
+
+  for (i = 0; scripts[i] != NULL; ++i) {
+    GoomSL *interpreter = gsl_new();
+    GoomSL *native = gsl_new();
+
+    gsl_use_native(interpreter, 0);
+    gsl_compile(interpreter, scripts[i]);
+    gsl_compile(native, scripts[i]);
+
+    if (!gsl_is_compiled(interpreter) || !gsl_is_compiled(native)) {
+      fprintf(stderr, "script %d: does not compile\n", i);
+      return 1;
+    }
+
+    if (native->native != NULL)
+      compiled++;
+
+    goom_hash_for_each(gsl_globals(interpreter), clear_global);
+    goom_hash_for_each(gsl_globals(native), clear_global);
+
+    for (frame = 0; frame < FRAMES; ++frame) {
+      gsl_execute(interpreter);
+      gsl_execute(native);
+
+      other_globals = gsl_globals(native);
+      goom_hash_for_each(gsl_globals(interpreter), compare_global);
+      if (mismatches) {
+        fprintf(stderr, "script %d, frame %d: the native code differs\n", i, frame);
+        return 1;
+      }
+    }
+
+    gsl_free(interpreter);
+    gsl_free(native);
+  }
+
+  printf("%d scripts, %d as native code: native code and interpreter agree\n", i, compiled);
+
+  bench(scripts[3]);
+  return 0;
+}
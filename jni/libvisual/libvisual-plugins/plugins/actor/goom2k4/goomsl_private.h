@@ -9,6 +9,8 @@
 #include "jitc_x86.h"
 #endif
 
+#include "goomsl_native.h"
+
 #include "goomsl_heap.h"
 
 /* {{{ type of nodes */
@@ -190,6 +192,9 @@ struct _GoomSL { /* {{{ */
 #ifdef USE_JITC_X86
     JitcX86Env *jitc;
     JitcFunc    jitc_func;
+#else
+    GslNative  *native;     /* fastiflow compiled for the cpu, or NULL */
+    int         use_native;
 #endif
 }; /* }}} */
 
@@ -211,6 +216,9 @@ GoomHash *gsl_find_namespace(const char *name);
 
 void gsl_commit_compilation(void);
 
+/* runs one struct instruction (SETS, ADDS, SUBS, MULS or DIVS) of a fast flow */
+void gsl_execute_struct_instr(GoomSL *gsl, FastInstruction *instr);
+
 /* #define TYPE_PARAM    1 */
 
 #define FIRST_RESERVED 0x80000
@@ -234,6 +242,56 @@ void gsl_commit_compilation(void);
 #define INSTR_EXT_CALL 38
 #define INSTR_JNZERO   40
 
+ /* {{{ definition of the instructions number */
+#define INSTR_SETI_VAR_INTEGER     1
+#define INSTR_SETI_VAR_VAR         2
+#define INSTR_SETF_VAR_FLOAT       3
+#define INSTR_SETF_VAR_VAR         4
+#define INSTR_NOP                  5
+/* #define INSTR_JUMP              6 */
+#define INSTR_SETP_VAR_PTR         7
+#define INSTR_SETP_VAR_VAR         8
+#define INSTR_SUBI_VAR_INTEGER     9
+#define INSTR_SUBI_VAR_VAR         10
+#define INSTR_SUBF_VAR_FLOAT       11
+#define INSTR_SUBF_VAR_VAR         12
+#define INSTR_ISLOWERF_VAR_VAR     13
+#define INSTR_ISLOWERF_VAR_FLOAT   14
+#define INSTR_ISLOWERI_VAR_VAR     15
+#define INSTR_ISLOWERI_VAR_INTEGER 16
+#define INSTR_ADDI_VAR_INTEGER     17
+#define INSTR_ADDI_VAR_VAR         18
+#define INSTR_ADDF_VAR_FLOAT       19
+#define INSTR_ADDF_VAR_VAR         20
+#define INSTR_MULI_VAR_INTEGER     21
+#define INSTR_MULI_VAR_VAR         22
+#define INSTR_MULF_VAR_FLOAT       23
+#define INSTR_MULF_VAR_VAR         24
+#define INSTR_DIVI_VAR_INTEGER     25
+#define INSTR_DIVI_VAR_VAR         26
+#define INSTR_DIVF_VAR_FLOAT       27
+#define INSTR_DIVF_VAR_VAR         28
+/* #define INSTR_JZERO             29 */
+#define INSTR_ISEQUALP_VAR_VAR     30
+#define INSTR_ISEQUALP_VAR_PTR     31
+#define INSTR_ISEQUALI_VAR_VAR     32
+#define INSTR_ISEQUALI_VAR_INTEGER 33
+#define INSTR_ISEQUALF_VAR_VAR     34
+#define INSTR_ISEQUALF_VAR_FLOAT   35
+/* #define INSTR_CALL              36 */
+/* #define INSTR_RET               37 */
+/* #define INSTR_EXT_CALL          38 */
+#define INSTR_NOT_VAR              39
+/* #define INSTR_JNZERO            40 */
+#define  INSTR_SETS_VAR_VAR        41
+#define  INSTR_ISEQUALS_VAR_VAR    42
+#define  INSTR_ADDS_VAR_VAR        43
+#define  INSTR_SUBS_VAR_VAR        44
+#define  INSTR_MULS_VAR_VAR        45
+#define  INSTR_DIVS_VAR_VAR        46
+
+ /* }}} */
+
 #define INSTR_SET     0x80001
 #define INSTR_INT     0x80002
 #define INSTR_FLOAT   0x80003
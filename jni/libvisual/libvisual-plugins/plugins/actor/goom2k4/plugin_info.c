@@ -23,7 +23,7 @@
 
 static void setOptimizedMethods(PluginInfo *p) {
 
-#if defined(CPU_X86) || defined(CPU_POWERPC)
+#if defined(CPU_X86) || defined(CPU_POWERPC) || defined(HAVE_ZOOM_FILTER_SSE2) || defined(HAVE_ZOOM_FILTER_NEON)
     unsigned int cpuFlavour = cpu_flavour();
 #endif
 
@@ -52,6 +52,16 @@ static void setOptimizedMethods(PluginInfo *p) {
             printf ("Too bad ! No SIMD optimization available for your CPU.\n");
 #endif
 #endif /* CPU_X86 */
+
+#ifdef HAVE_ZOOM_FILTER_SSE2
+	if (cpuFlavour & CPU_OPTION_SSE2)
+		p->methods.zoom_filter = zoom_filter_sse2;
+#endif
+
+#ifdef HAVE_ZOOM_FILTER_NEON
+	if (cpuFlavour & CPU_OPTION_NEON)
+		p->methods.zoom_filter = zoom_filter_neon;
+#endif
 	
 #ifdef CPU_POWERPC
 
@@ -119,11 +119,9 @@ static t_complex _inf_fct(InfinitePrivate *priv, t_complex a,int n,int p1,int p2
 }
 
 
-static void _inf_generate_sector(InfinitePrivate *priv, int g,int f,int p1,int p2,int debut,int step,t_interpol* vector_field)
+static void _inf_generate_sector(InfinitePrivate *priv, int f,int p1,int p2,int debut,int step,VisRemap *vector_field)
 {
 	int fin=debut+step;
-	const int prop_transmitted=249;
-	const int b_add=g*priv->plugwidth*priv->plugheight; 
 	t_coord c;
 
 
@@ -132,31 +130,15 @@ static void _inf_generate_sector(InfinitePrivate *priv, int g,int f,int p1,int p
 	for (c.y=debut;c.y<fin;c.y++) 
 		for (c.x=0;c.x<priv->plugwidth;c.x++) {
 			t_complex a;
-			float fpy;
-			int rw,lw,add;
-			uint32_t w1,w2,w3,w4;
-			uint32_t x,y;
 
 			a.x=(float)c.x;
 			a.y=(float)c.y;
 			a=_inf_fct(priv, a,f,p1,p2);
-			add=c.x+c.y*priv->plugwidth;
-			x=(int)(a.x);
-			y=(int)(a.y);
-			vector_field[b_add+add].coord=(x<<16)|y;
-
-			fpy=a.y-floor(a.y);
-			rw=(int)((a.x-floor(a.x))*prop_transmitted);
-			lw=prop_transmitted-rw;
-			w4=(int)(fpy*rw);
-			w2=rw-w4;
-			w3=(int)(fpy*lw);
-			w1=lw-w3; 
-			vector_field[b_add+add].weight=(w1<<24)|(w2<<16)|(w3<<8)|w4;
+			visual_remap_set_point(vector_field, c.x, c.y, a.x, a.y);
 		}
 }
 
-void _inf_generate_vector_field(InfinitePrivate *priv, t_interpol* vector_field) 
+void _inf_generate_vector_field(InfinitePrivate *priv) 
 {
 	int f;
 	int i,p1,p2;
@@ -165,7 +147,7 @@ void _inf_generate_vector_field(InfinitePrivate *priv, t_interpol* vector_field)
 		p1=2;
 		p2=2;
 		for (i=0;i<priv->plugheight;i+=10)
-			_inf_generate_sector(priv, f,f,p1,p2,i,10,vector_field);
+			_inf_generate_sector(priv, f,p1,p2,i,10,priv->vector_field[f]);
 	}
 }
 
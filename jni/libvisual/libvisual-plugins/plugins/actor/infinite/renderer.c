@@ -17,9 +17,7 @@
 
 void _inf_init_renderer(InfinitePrivate *priv)
 {
-	int allocsize;
-
-	allocsize = ((priv->plugwidth * priv->plugheight) + (priv->plugwidth * 2)) * NB_FCT * sizeof(t_interpol);
+	int f;
 
 	priv->teff = 500;
 	priv->tcol = 100;
@@ -29,16 +27,19 @@ void _inf_init_renderer(InfinitePrivate *priv)
 	_inf_load_effects(priv);
 	_inf_load_random_effect(priv, &priv->current_effect);
 
-	priv->vector_field = (t_interpol*) visual_mem_malloc0(allocsize);
-	visual_mem_set (priv->vector_field, 0, allocsize);
+	/* Every warp keeps 249/256 of the light, so the picture fades out */
+	for (f=0;f<NB_FCT;f++) {
+		priv->vector_field[f] = visual_remap_new(priv->plugwidth, priv->plugheight, VISUAL_REMAP_FETCH_WEIGHTED);
+		visual_remap_set_fade(priv->vector_field[f], 249);
+	}
 
-	_inf_generate_vector_field(priv, priv->vector_field);
+	_inf_generate_vector_field(priv);
 }
 
 
 void _inf_renderer(InfinitePrivate *priv)
 {
-	_inf_blur(priv, &priv->vector_field[priv->plugwidth*priv->plugheight*priv->current_effect.num_effect]);
+	_inf_blur(priv, priv->vector_field[priv->current_effect.num_effect]);
 	_inf_spectral(priv, &priv->current_effect, priv->pcm_data);
 	_inf_curve(priv, &priv->current_effect);
 
@@ -62,8 +63,14 @@ void _inf_renderer(InfinitePrivate *priv)
 
 void _inf_close_renderer(InfinitePrivate *priv)
 {
+	int f;
+
+	visual_object_unref(VISUAL_OBJECT(priv->surface1_video));
+	visual_object_unref(VISUAL_OBJECT(priv->surface2_video));
 	visual_mem_free(priv->surface1);
 	visual_mem_free(priv->surface2);
-	visual_mem_free(priv->vector_field);
+
+	for (f=0;f<NB_FCT;f++)
+		visual_object_unref(VISUAL_OBJECT(priv->vector_field[f]));
 }
 
@@ -66,9 +66,8 @@ typedef struct {
 	JakdawPlotterOptions	 plotter_scopetype;
 
 	/* Feedback privates */
-	uint32_t		*table;
-	uint32_t		*new_image;
-	int			 tableptr;
+	VisRemap		*table;
+	VisVideo		*new_image;
 
 	/* PCM Buffer */
 	VisBuffer		*pcmbuf;
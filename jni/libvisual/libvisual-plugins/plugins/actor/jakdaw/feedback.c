@@ -27,7 +27,7 @@
 typedef uint32_t (*transform_function) (JakdawPrivate *priv, int x, int y);
 
 static void init_table(JakdawPrivate *priv);
-static void table_store(JakdawPrivate *priv, int x);
+static void table_store(JakdawPrivate *priv, int x, int y, int tap, uint32_t offset);
 static void blur_then(JakdawPrivate *priv, int x, int y, transform_function func);
 
 /* Transforms */
@@ -43,7 +43,7 @@ void _jakdaw_feedback_init(JakdawPrivate *priv, int x, int y)
 	int a, b;
 
 	init_table(priv);
-	priv->new_image= visual_mem_malloc0 (priv->xres*priv->yres*4);
+	priv->new_image = visual_video_new_with_buffer (priv->xres, priv->yres, VISUAL_VIDEO_DEPTH_32BIT);
 
 	for(b=0;b<priv->yres;b++)
 		for(a=0;a<priv->xres;a++)
@@ -71,18 +71,19 @@ void _jakdaw_feedback_reset(JakdawPrivate *priv, int x, int y)
 void _jakdaw_feedback_close(JakdawPrivate *priv)
 {
 	if (priv->new_image != NULL)
-		visual_mem_free (priv->new_image);
+		visual_object_unref (VISUAL_OBJECT (priv->new_image));
 
 	if (priv->table != NULL)
-		visual_mem_free (priv->table);
+		visual_object_unref (VISUAL_OBJECT (priv->table));
+
+	priv->new_image = NULL;
+	priv->table = NULL;
 }
 
-void _jakdaw_feedback_render(JakdawPrivate *priv, uint32_t *vscr)
+void _jakdaw_feedback_render(JakdawPrivate *priv, VisVideo *video)
 {
-	int x,tptr,niptr,a;
-	int r,g,b;
-	int np, rdr, gdr, bdr;
-	
+	uint32_t *vscr = visual_video_get_pixels (video);
+
 	/* Most feedback effects don't take well to the middle pixel becoming
 	 * a bright colour - so we just blank it here. Most effects now rely on
 	 * this as a black pixel to be used instead of those that fall off the
@@ -90,63 +91,25 @@ void _jakdaw_feedback_render(JakdawPrivate *priv, uint32_t *vscr)
 
 	vscr[((priv->yres>>1)*priv->xres)+(priv->xres>>1)]=0;
 
-	tptr=niptr=0;
+	/* Every pixel is the average of its four table entries, less the
+	 * decay rate on every channel. */
+	visual_remap_apply (priv->table, priv->new_image, video);
 
-	np=priv->xres*priv->yres;
-	rdr=priv->decay_rate<<2;
-	gdr=priv->decay_rate<<10;
-	bdr=priv->decay_rate<<18;
-
-	for(x=0;x<np;x++)
-	{
-		/* I dunno how good a job the C compiler makes at optimizing this
-		 * loop. Since this is what the plugin spends pretty much all of
-		 * it's time doing it might be worth looking into the possiblilty
-		 * of optimizing it further. */
-
-		a=vscr[priv->table[tptr++]];
-		r=a&0xff;
-		g=a&0xff00;
-		b=a&0xff0000;
-
-		a=vscr[priv->table[tptr++]];
-		r+=a&0xff;
-		g+=a&0xff00;
-		b+=a&0xff0000;
-
-		a=vscr[priv->table[tptr++]];
-		r+=a&0xff;
-		g+=a&0xff00;
-		b+=a&0xff0000;
-
-		a=vscr[priv->table[tptr++]];
-		r+=a&0xff;
-		g+=a&0xff00;
-		b+=a&0xff0000;
-
-		r=r>rdr ? r-rdr : 0;
-		g=g>gdr ? g-gdr : 0;
-		b=b>bdr ? b-bdr : 0;
-	
-		a=(r&0x3fc)|(g&0x3fc00)|(b&0x3fc0000);
-		a>>=2;
-		
-		priv->new_image[niptr++]=a;
-
-	}
-	
-	visual_mem_copy(vscr, priv->new_image, priv->xres*priv->yres*4);
+	visual_video_blit (video, priv->new_image, 0, 0, FALSE);
 }
 
 static void init_table(JakdawPrivate *priv)
 {
-	priv->table=visual_mem_malloc0(priv->xres*priv->yres*sizeof(uint32_t)*4); // 4 points / pixel
-	priv->tableptr=0;
+	priv->table = visual_remap_new (priv->xres, priv->yres, VISUAL_REMAP_FETCH_AVERAGE4); // 4 points / pixel
+	visual_remap_set_decay (priv->table, priv->decay_rate);
 }
 
-static void table_store(JakdawPrivate *priv, int x)
+static void table_store(JakdawPrivate *priv, int x, int y, int tap, uint32_t offset)
 {
-	priv->table[priv->tableptr++]=x;
+	if (offset >= (uint32_t) (priv->xres * priv->yres))
+		offset = priv->xres * priv->yres - 1;
+
+	visual_remap_set_tap (priv->table, x, y, tap, offset % priv->xres, offset / priv->xres);
 }
 
 static void blur_then(JakdawPrivate *priv, int x, int y, transform_function func)
@@ -154,13 +117,13 @@ static void blur_then(JakdawPrivate *priv, int x, int y, transform_function func
 	uint32_t a;
 	
 	a=x+1<priv->xres ? x+1 : x;
-	table_store(priv, func(priv,a,y));
+	table_store(priv, x, y, 0, func(priv,a,y));
 	a=x-1<0 ? 0 : x-1;
-	table_store(priv, func(priv,a,y));
+	table_store(priv, x, y, 1, func(priv,a,y));
 	a=y+1<priv->yres ? y+1 : y;
-	table_store(priv, func(priv,x,a));
+	table_store(priv, x, y, 2, func(priv,x,a));
 	a=y-1<0 ? 0 : y-1;
-	table_store(priv, func(priv,x,a));
+	table_store(priv, x, y, 3, func(priv,x,a));
 	
 	return;
 }
@@ -28,6 +28,6 @@
 void _jakdaw_feedback_init (JakdawPrivate *priv, int x, int y);
 void _jakdaw_feedback_reset (JakdawPrivate *priv, int x, int y);
 void _jakdaw_feedback_close (JakdawPrivate *priv);
-void _jakdaw_feedback_render (JakdawPrivate *priv, uint32_t *vscr);
+void _jakdaw_feedback_render (JakdawPrivate *priv, VisVideo *video);
 
 #endif /* _FEEDBACK_H */
@@ -83,21 +83,7 @@ void create_tables(JessPrivate *priv)
 					y = 0;
 				}
 
-				switch(k)
-				{
-					case 1:
-						priv->table1[i * resx + j] = x + y * resx;
-						break;
-					case 2:
-						priv->table2[i * resx + j] = x + y * resx;
-						break;
-					case 3:
-						priv->table3[i * resx + j] = x + y * resx;
-						break;
-					case 4:
-						priv->table4[i * resx + j] = x + y * resx;
-						break;
-				}
+				visual_remap_set_tap (priv->table[k - 1], j, i, 0, x, y);
 			}
 		}
 	}
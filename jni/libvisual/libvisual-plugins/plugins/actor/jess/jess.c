@@ -170,17 +170,16 @@ static int act_jess_cleanup (VisPluginData *plugin)
 			visual_mem_free (priv->big_ball_scale[i]);
 	}
 
-	if (priv->table1 != NULL)
-		visual_mem_free (priv->table1);
-
-	if (priv->table2 != NULL)
-		visual_mem_free (priv->table2);
+	for (i = 0; i < 4; i++)
+	{
+		if (priv->table[i] != NULL)
+			visual_object_unref (VISUAL_OBJECT (priv->table[i]));
 
-	if (priv->table3 != NULL)
-		visual_mem_free (priv->table3);
+		priv->table[i] = NULL;
+	}
 
-	if (priv->table4 != NULL)
-		visual_mem_free (priv->table4);
+	if (priv->buffer_video != NULL)
+		visual_object_unref (VISUAL_OBJECT (priv->buffer_video));
 
 	if (priv->buffer != NULL)
 		visual_mem_free (priv->buffer);
@@ -226,21 +225,21 @@ static int act_jess_requisition (VisPluginData *plugin, int *width, int *height)
 static int act_jess_resize (VisPluginData *plugin, int width, int height)
 {
 	JessPrivate *priv = visual_object_get_private (VISUAL_OBJECT (plugin));
+	int i;
 
 	priv->resx = width;
 	priv->resy = height;
 
-	if (priv->table1 != NULL)
-		visual_mem_free (priv->table1);
-
-	if (priv->table2 != NULL)
-		visual_mem_free (priv->table2);
+	for (i = 0; i < 4; i++)
+	{
+		if (priv->table[i] != NULL)
+			visual_object_unref (VISUAL_OBJECT (priv->table[i]));
 
-	if (priv->table3 != NULL)
-		visual_mem_free (priv->table3);
+		priv->table[i] = NULL;
+	}
 
-	if (priv->table4 != NULL)
-		visual_mem_free (priv->table4);
+	if (priv->buffer_video != NULL)
+		visual_object_unref (VISUAL_OBJECT (priv->buffer_video));
 
 	if (priv->buffer != NULL)
 		visual_mem_free (priv->buffer);
@@ -334,6 +333,7 @@ static int act_jess_render (VisPluginData *plugin, VisVideo *video, VisAudio *au
 	priv->pitch = video->pitch;
 	priv->video = visual_video_depth_value_from_enum (video->depth);
 	priv->pixel = ((uint8_t *) visual_video_get_pixels (video));
+	priv->pixel_video = video;
 
 	renderer (priv);
 
@@ -342,6 +342,8 @@ static int act_jess_render (VisPluginData *plugin, VisVideo *video, VisAudio *au
 
 static void jess_init (JessPrivate *priv)
 {
+	int i;
+
 	visual_return_if_fail (priv != NULL);
 
 	priv->xres2 = priv->resx / 2;
@@ -350,15 +352,14 @@ static void jess_init (JessPrivate *priv)
 	priv->conteur.fullscreen = 0;
 	priv->conteur.blur_mode = 1;
 
-	priv->table1 = (uint32_t *) visual_mem_malloc0 (priv->resx * priv->resy * sizeof (int));
-	priv->table2 = (uint32_t *) visual_mem_malloc0 (priv->resx * priv->resy * sizeof (int));
-	priv->table3 = (uint32_t *) visual_mem_malloc0 (priv->resx * priv->resy * sizeof (int));
-	priv->table4 = (uint32_t *) visual_mem_malloc0 (priv->resx * priv->resy * sizeof (int));
+	for (i = 0; i < 4; i++)
+		priv->table[i] = visual_remap_new (priv->resx, priv->resy, VISUAL_REMAP_FETCH_NEAREST);
+
+	/* Room for 32 bit, the depth is only known once rendering starts */
+	priv->buffer = (uint8_t *) visual_mem_malloc0 (priv->resx * priv->resy * 4);
 
-	if (priv->video == 8)
-		priv->buffer = (uint8_t *) visual_mem_malloc0 (priv->resx * priv->resy); 
-	else
-		priv->buffer = (uint8_t *) visual_mem_malloc0 (priv->resx * priv->resy * 4);
+	/* Attributes are set on the first deformation */
+	priv->buffer_video = visual_video_new ();
 
 	create_tables(priv);
 }
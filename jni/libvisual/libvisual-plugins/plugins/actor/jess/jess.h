@@ -51,10 +51,7 @@ typedef struct {
 	VisBuffer *pcm_data2;
 	float pcm_data[2][512];
 
-	uint32_t *table1;
-	uint32_t *table2;
-	uint32_t *table3;
-	uint32_t *table4;
+	VisRemap *table[4];
 	uint32_t pitch;
 	uint32_t video;
 
@@ -65,6 +62,8 @@ typedef struct {
 	uint8_t *bits;
 	uint8_t *pixel;
 	uint8_t *buffer;
+	VisVideo *pixel_video;
+	VisVideo *buffer_video;
 
 	int resx;
 	int resy;
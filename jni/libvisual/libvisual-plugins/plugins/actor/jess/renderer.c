@@ -282,85 +282,30 @@ void fade(float variable, uint8_t * dim)
 
 void render_deformation(JessPrivate *priv, int defmode)
 {
-	intptr_t bmax;
-	uint32_t *tab1 = NULL, *tab2, *tab3, *tab4, i;
-	uint8_t *pix = priv->pixel, *aux;
+	VisVideo *pixel_video = priv->pixel_video;
 
 	/**************** BUFFER DEFORMATION ****************/
-	if (priv->video == 8)
+	if (defmode == 0)
 	{
-		tab1 = priv->table1;
-		tab2 = priv->table2;
-		tab3 = priv->table3;
-		tab4 = priv->table4;
-		bmax = priv->resx * priv->resy + (intptr_t) priv->pixel;
+		if (priv->video == 8)
+			visual_mem_copy(priv->pixel, priv->buffer, priv->resx * priv->resy);
+		else
+			visual_mem_copy(priv->pixel, priv->buffer, priv->pitch * priv->resy);
 
-		switch(defmode)
-		{
-			case 0:
-				visual_mem_copy(priv->pixel, priv->buffer, priv->resx * priv->resy);
-				break;
-			case 1:
-				for (pix = priv->pixel; pix < (uint8_t *) bmax ; pix++)
-					*pix = *(priv->buffer + *(tab1++)) ;
-				break;
-			case 2:
-				for (pix = priv->pixel; pix < (uint8_t *) bmax; pix++)
-					*pix = *(priv->buffer + *(tab2++)) ;
-				break;
-			case 3:
-				for (pix = priv->pixel; pix < (uint8_t *) bmax; pix++)
-					*pix = *(priv->buffer + *(tab3++)) ;
-				break;
-			case 4:
-				for (pix = priv->pixel; pix < (uint8_t *) bmax; pix++)
-					*pix = *(priv->buffer + *(tab4++)) ;
-				break;   
-			default:
-		
-				break;
-		}
+		return;
 	}
-	else
-	{
-		pix = priv->pixel;
 
-		bmax = priv->resx * priv->resy;
-		switch(defmode)
-		{
-			case 0:
-				visual_mem_copy(priv->pixel, priv->buffer, priv->pitch * priv->resy);
-				return;
-				break;
-			case 1:
-				tab1 = priv->table1;
-				break;
-			case 2:
-				tab1 = priv->table2;
-				break;
-			case 3:
-				tab1 = priv->table3;
-				break;
-			case 4:
-				tab1 = priv->table4;
-				break;
-
-			default:
-		
-				break;
-		}
-		for (i = 0; i < priv->resy * priv->resx; i++)
-		{
-			aux  =  (uint8_t *) ((*(tab1) << 2 ) + (intptr_t) priv->buffer);
-			*(pix++) = *(aux++) ;
-			*(pix++) = *(aux++);  
-			*(pix++) = *(aux);  
-			
-			pix++;
+	if (defmode < 1 || defmode > 4)
+		return;
 
-			tab1++;
-		}
+	if (priv->buffer_video->depth != pixel_video->depth)
+	{
+		visual_video_set_attributes (priv->buffer_video, priv->resx, priv->resy,
+				priv->resx * pixel_video->bpp, pixel_video->depth);
+		visual_video_set_buffer (priv->buffer_video, priv->buffer);
 	}
+
+	visual_remap_apply (priv->table[defmode - 1], pixel_video, priv->buffer_video);
 }
 
 void render_blur(JessPrivate *priv, int blur)
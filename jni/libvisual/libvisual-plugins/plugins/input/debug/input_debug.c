@@ -39,6 +39,9 @@ typedef struct {
 
 	float angle;
 	float angle_step;
+
+	int16_t    data[OUTPUT_SAMPLES];
+	VisBuffer *buffer;
 } DebugPriv;
 
 static int inp_debug_init (VisPluginData *plugin);
@@ -93,6 +96,9 @@ static int inp_debug_init (VisPluginData *plugin)
 	priv->ampltitude = DEFAULT_AMPLITUDE;
 	setup_wave (priv);
 
+	/* Wrapped once, uploads reuse it */
+	priv->buffer = visual_buffer_new_wrap_data (priv->data, sizeof (priv->data));
+
 	visual_param_container_add_many (paramcontainer, params);
 
 	param = visual_param_container_get (paramcontainer, "frequency");
@@ -108,6 +114,11 @@ static int inp_debug_init (VisPluginData *plugin)
 
 static int inp_debug_cleanup (VisPluginData *plugin)
 {
+	DebugPriv *priv = visual_object_get_private (VISUAL_OBJECT (plugin));
+
+	visual_buffer_free (priv->buffer);
+	visual_mem_free (priv);
+
 	return 0;
 }
 
@@ -146,10 +157,10 @@ static int inp_debug_upload (VisPluginData *plugin, VisAudio *audio)
 
 	DebugPriv *priv = visual_object_get_private (VISUAL_OBJECT (plugin));
 
-	int16_t data[OUTPUT_SAMPLES];
+	int16_t *data = priv->data;
 	int i;
 
-	for(i = 0; i < VISUAL_TABLESIZE(data); i++) {
+	for(i = 0; i < OUTPUT_SAMPLES; i++) {
 		data[i] = (int16_t) (65535/2 * priv->ampltitude * sin (priv->angle));
 
 		priv->angle += priv->angle_step;
@@ -158,12 +169,8 @@ static int inp_debug_upload (VisPluginData *plugin, VisAudio *audio)
 		}
 	}
 
-	VisBuffer *buffer = visual_buffer_new_wrap_data (data, VISUAL_TABLESIZE (data));
-
-	visual_audio_samplepool_input (audio->samplepool, buffer, VISUAL_AUDIO_SAMPLE_RATE_44100,
+	visual_audio_samplepool_input (audio->samplepool, priv->buffer, VISUAL_AUDIO_SAMPLE_RATE_44100,
 			VISUAL_AUDIO_SAMPLE_FORMAT_S16, VISUAL_AUDIO_SAMPLE_CHANNEL_STEREO);
 
-	visual_buffer_free (buffer);
-
 	return 0;
 }
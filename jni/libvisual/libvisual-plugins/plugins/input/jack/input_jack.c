@@ -36,7 +36,8 @@
 
 VISUAL_PLUGIN_API_VERSION_VALIDATOR
 
-#define PCM_BUF_SIZE	1024
+#define RING_SIZE	32768
+#define RING_SEGMENTS	64
 
 typedef struct {
 	jack_client_t	*client;
@@ -44,9 +45,9 @@ typedef struct {
 
 	int		 shutdown;
 
-	VisBuffer	*buffer;
-
-	short		 fakebuf[PCM_BUF_SIZE];
+	/* Filled from the jack process thread, drained in upload */
+	VisAudioRing	*left;
+	VisAudioRing	*right;
 } JackPrivate;
 
 static int process_callback (jack_nframes_t nframes, void *arg);
@@ -102,6 +103,9 @@ static int inp_jack_init (VisPluginData *plugin)
 		return -1;
 	}
 
+	priv->left = visual_audio_ring_new (RING_SIZE, RING_SEGMENTS);
+	priv->right = visual_audio_ring_new (RING_SIZE, RING_SEGMENTS);
+
 	jack_set_process_callback (priv->client, process_callback, priv);
 	jack_on_shutdown (priv->client, shutdown_callback, priv);
 
@@ -129,8 +133,6 @@ static int inp_jack_init (VisPluginData *plugin)
 
 	visual_mem_free (ports);
 
-//	visual_buffer_init_allocate (&priv->buffer, 65536,
-
 	return 0;
 }
 
@@ -145,6 +147,12 @@ static int inp_jack_cleanup (VisPluginData *plugin)
 	if (priv->client != NULL)
 		jack_client_close (priv->client);
 
+	if (priv->left != NULL)
+		visual_object_unref (VISUAL_OBJECT (priv->left));
+
+	if (priv->right != NULL)
+		visual_object_unref (VISUAL_OBJECT (priv->right));
+
 	visual_mem_free (priv);
 
 	return 0;
@@ -153,8 +161,6 @@ static int inp_jack_cleanup (VisPluginData *plugin)
 static int inp_jack_upload (VisPluginData *plugin, VisAudio *audio)
 {
 	JackPrivate *priv = NULL;
-/*	VisBuffer buffer; */
-	int i;
 
 	visual_return_val_if_fail (audio != NULL, -1);
 	visual_return_val_if_fail (plugin != NULL, -1);
@@ -169,17 +175,8 @@ static int inp_jack_upload (VisPluginData *plugin, VisAudio *audio)
 		return -1;
 	}
 
-/*
-	visual_buffer_init (&buffer, data, rcnt, NULL);
-
-	visual_audio_samplepool_input (audio->samplepool, &buffer, VISUAL_AUDIO_SAMPLE_RATE_44100,
-			VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT, VISUAL_AUDIO_SAMPLE_CHANNEL_STEREO);
-*/
-
-	for (i = 0; i < PCM_BUF_SIZE && i < 1024; i += 2) {
-		audio->plugpcm[0][i >> 1] = priv->fakebuf[i];
-		audio->plugpcm[1][i >> 1] = priv->fakebuf[i + 1];
-	}
+	visual_audio_samplepool_input_ring (audio->samplepool, priv->left, VISUAL_AUDIO_CHANNEL_LEFT);
+	visual_audio_samplepool_input_ring (audio->samplepool, priv->right, VISUAL_AUDIO_CHANNEL_RIGHT);
 
 	return 0;
 }
@@ -188,14 +185,13 @@ static int process_callback (jack_nframes_t nframes, void *arg)
 {
 	JackPrivate *priv = arg;
 	jack_default_audio_sample_t *in;
-	int i;
 
 	in = (jack_default_audio_sample_t *) jack_port_get_buffer (priv->input_port, nframes);
 
-	visual_mem_set (&priv->fakebuf, 0, sizeof (priv->fakebuf));
-
-	for (i = 0; i < nframes && i < 1024; i++)
-		priv->fakebuf[i] = in[i] * 32767;
+	/* Lock and allocation free, safe from the realtime thread. The
+	 * single capture port feeds both channels. */
+	visual_audio_ring_write (priv->left, in, nframes, NULL);
+	visual_audio_ring_write (priv->right, in, nframes, NULL);
 
 	return 0;
 }
@@ -55,6 +55,7 @@ typedef struct {
 	int fd;                    /**< file descriptor to mmaped area */
 	char *sharedfile;          /**< shared file name */
 	mplayer_data_t *mmap_area; /**< mmap()'ed area */
+	VisBuffer *buffer;         /**< wraps the pcm part of mmap_area */
 
 	int loaded;                /**< plugin state */
 } mplayer_priv_t;
@@ -183,6 +184,8 @@ static int inp_mplayer_init( VisPluginData *plugin )
 		return -7;
 	}
 
+	priv->buffer = visual_buffer_new_wrap_data( (uint8_t *)priv->mmap_area + sizeof( mplayer_data_t ), priv->mmap_area->bs );
+
 	priv->loaded = 1;
 	return 0;
 }
@@ -203,6 +206,9 @@ static int inp_mplayer_cleanup( VisPluginData *plugin )
 	priv = visual_object_get_private (VISUAL_OBJECT (plugin));
 	visual_return_val_if_fail( priv != NULL, -1 );
 
+	if ( priv->buffer != NULL )
+		visual_buffer_free( priv->buffer );
+
 	if ( priv->loaded == 1 )
 	{
 		void *mmap_area  = (void*)priv->mmap_area;
@@ -254,7 +260,6 @@ static int inp_mplayer_cleanup( VisPluginData *plugin )
 static int inp_mplayer_upload( VisPluginData *plugin, VisAudio *audio )
 {
 	mplayer_priv_t *priv = NULL;
-	VisBuffer *buffer;
 
 	visual_return_val_if_fail( audio != NULL, -1 );
 	visual_return_val_if_fail( plugin != NULL, -1 );
@@ -262,12 +267,10 @@ static int inp_mplayer_upload( VisPluginData *plugin, VisAudio *audio )
 	visual_return_val_if_fail( priv != NULL, -1 );
 	visual_return_val_if_fail( priv->mmap_area != NULL, -1 );
 
-	buffer = visual_buffer_new_wrap_data ( (uint8_t *)priv->mmap_area + sizeof( mplayer_data_t ), 2048 / sizeof( int16_t ) );
-	visual_audio_samplepool_input (audio->samplepool, buffer,
+	visual_audio_samplepool_input (audio->samplepool, priv->buffer,
 	                               VISUAL_AUDIO_SAMPLE_RATE_44100,
 	                               VISUAL_AUDIO_SAMPLE_FORMAT_S16,
 	                               VISUAL_AUDIO_SAMPLE_CHANNEL_STEREO);
-	visual_buffer_free (buffer);
 
 	return 0;
 }
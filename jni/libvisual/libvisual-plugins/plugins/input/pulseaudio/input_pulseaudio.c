@@ -32,6 +32,10 @@ pa_sample_spec sample_spec = {
 
 typedef struct {
     pa_simple *simple;
+
+    /* Read target and its wrapper, reused for every upload */
+    short pcm_data[PCM_BUF_SIZE];
+    VisBuffer *buffer;
 } pulseaudio_priv_t;
 
 
@@ -77,6 +81,7 @@ static int inp_pulseaudio_init( VisPluginData *plugin ) {
 
     memset(priv, 0, sizeof(pulseaudio_priv_t));
 
+    priv->buffer = visual_buffer_new_wrap_data (priv->pcm_data, sizeof (priv->pcm_data));
 
     priv->simple = pa_simple_new(
         NULL,
@@ -110,8 +115,10 @@ static int inp_pulseaudio_cleanup( VisPluginData *plugin ) {
 
     visual_return_val_if_fail( priv != NULL, VISUAL_ERROR_GENERAL);
 
-    pa_simple_free(priv->simple);
+    if (priv->simple != NULL)
+        pa_simple_free(priv->simple);
 
+    visual_buffer_free (priv->buffer);
     visual_mem_free (priv);
     return VISUAL_OK;
 }
@@ -162,12 +169,8 @@ static int inp_pulseaudio_events (VisPluginData *plugin, VisEventQueue *events)
 int inp_pulseaudio_upload( VisPluginData *plugin, VisAudio *audio )
 {
     pulseaudio_priv_t *priv = NULL;
-    short pcm_data[PCM_BUF_SIZE];
-    VisBuffer *buffer;
     int error;
 
-    memset(pcm_data, 0, sizeof(pcm_data));
-
     visual_return_val_if_fail( audio != NULL, -VISUAL_ERROR_GENERAL);
     visual_return_val_if_fail( plugin != NULL, -VISUAL_ERROR_GENERAL);
 
@@ -175,15 +178,13 @@ int inp_pulseaudio_upload( VisPluginData *plugin, VisAudio *audio )
 
     visual_return_val_if_fail( priv != NULL, -VISUAL_ERROR_GENERAL);
 
-    if(pa_simple_read(priv->simple, pcm_data, sizeof (pcm_data), &error) < 0) {
+    if(pa_simple_read(priv->simple, priv->pcm_data, sizeof (priv->pcm_data), &error) < 0) {
         visual_log(VISUAL_LOG_CRITICAL, "pa_simple_read() failed: %s", pa_strerror(error));
         return -VISUAL_ERROR_GENERAL;
     }
 
-    buffer = visual_buffer_new_wrap_data (pcm_data, PCM_BUF_SIZE);
-    visual_audio_samplepool_input(audio->samplepool, buffer, VISUAL_AUDIO_SAMPLE_RATE_44100,
+    visual_audio_samplepool_input(audio->samplepool, priv->buffer, VISUAL_AUDIO_SAMPLE_RATE_44100,
         VISUAL_AUDIO_SAMPLE_FORMAT_S16, VISUAL_AUDIO_SAMPLE_CHANNEL_STEREO);
-    visual_buffer_free (buffer);
 
     return 0;
 }
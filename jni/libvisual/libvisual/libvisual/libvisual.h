@@ -44,6 +44,7 @@
 #include <libvisual/lv_actor.h>
 #include <libvisual/lv_input.h>
 #include <libvisual/lv_audio.h>
+#include <libvisual/lv_audio_ring.h>
 #include <libvisual/lv_fourier.h>
 #include <libvisual/lv_list.h>
 #include <libvisual/lv_palette.h>
@@ -59,6 +60,8 @@
 #include <libvisual/lv_ringbuffer.h>
 #include <libvisual/lv_rectangle.h>
 #include <libvisual/lv_thread.h>
+#include <libvisual/lv_worker_pool.h>
+#include <libvisual/lv_remap.h>
 #include <libvisual/lv_gl.h>
 #include <libvisual/lv_math.h>
 #include <libvisual/lv_os.h>
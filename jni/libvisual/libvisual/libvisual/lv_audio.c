@@ -34,20 +34,58 @@
 #include <string.h>
 #include <limits.h>
 
+/* Number of distinct spectrum and mix requests remembered per VisAudio */
+#define AUDIO_CACHE_ENTRIES	16
+
+typedef enum {
+	AUDIO_CACHE_SPECTRUM,
+	AUDIO_CACHE_SAMPLE_MIXED
+} AudioCacheType;
+
+typedef struct {
+	AudioCacheType	 type;
+	char		*channels;	/* Channel ids, each one nul terminated, NULL for an unused entry */
+	int		 channels_size;
+	int		 nchannels;
+	int		 samplelen;
+	int		 normalised;
+	float		 multiplier;
+
+	float		*data;
+	int		 size;
+	int		 capacity;
+
+	uint32_t	 generation;	/* Samplepool generation data was computed for */
+	uint32_t	 stamp;		/* Last lookup, for replacement */
+} AudioCacheEntry;
+
+/* Actors, and both sides of a morph, tend to ask for the very same spectra
+ * every frame. Results are kept until the samplepool changes, which
+ * visual_input_run() does once per frame. */
+struct _VisAudioCache {
+	AudioCacheEntry	 entries[AUDIO_CACHE_ENTRIES];
+	uint32_t	 stamp;
+};
+
 static int audio_dtor (VisObject *object);
 static int audio_samplepool_dtor (VisObject *object);
 static int audio_samplepool_channel_dtor (VisObject *object);
 static int audio_sample_dtor (VisObject *object);
 
-/* Ringbuffer data provider functions */
-static VisBuffer *sample_data_func (VisRingBuffer *ringbuffer, VisRingBufferEntry *entry);
-static void sample_destroy_func (VisRingBufferEntry *entry);
-static int sample_size_func (VisRingBuffer *ringbuffer, VisRingBufferEntry *entry);
-
 /*  functions */
+static VisAudioSamplePoolChannel *samplepool_get_or_add_channel (VisAudioSamplePool *samplepool, const char *channelid);
+static void channel_input (VisAudioSamplePoolChannel *channel, const void *data, int count, int stride,
+		VisAudioSampleFormatType format, VisTime *timestamp);
 static int input_interleaved_stereo (VisAudioSamplePool *samplepool, VisBuffer *buffer,
 		VisAudioSampleFormatType format,
 		VisAudioSampleRateType rate);
+static AudioCacheEntry *audio_cache_lookup (VisAudio *audio, AudioCacheType type,
+		int samplelen, int size, int normalised, float multiplier,
+		int nchannels, char **chanids, int *valid);
+static void audio_cache_store (VisAudio *audio, AudioCacheEntry *entry, VisBuffer *buffer);
+static void audio_cache_free (VisAudioCache *cache);
+static int audio_get_spectrum (VisAudio *audio, VisBuffer *buffer, int samplelen, const char *channelid,
+		int normalised, float multiplier);
 
 
 static int audio_dtor (VisObject *object)
@@ -57,7 +95,11 @@ static int audio_dtor (VisObject *object)
 	if (audio->samplepool != NULL)
 		visual_object_unref (VISUAL_OBJECT (audio->samplepool));
 
+	if (audio->cache != NULL)
+		audio_cache_free (audio->cache);
+
 	audio->samplepool = NULL;
+	audio->cache = NULL;
 
 	return VISUAL_OK;
 }
@@ -92,6 +134,114 @@ static int audio_samplepool_channel_dtor (VisObject *object)
 	return VISUAL_OK;
 }
 
+static int channels_match (const char *channels, int nchannels, char **chanids)
+{
+	int i;
+
+	for (i = 0; i < nchannels; i++) {
+		if (strcmp (channels, chanids[i]) != 0)
+			return FALSE;
+
+		channels += strlen (channels) + 1;
+	}
+
+	return TRUE;
+}
+
+static AudioCacheEntry *audio_cache_lookup (VisAudio *audio, AudioCacheType type,
+		int samplelen, int size, int normalised, float multiplier,
+		int nchannels, char **chanids, int *valid)
+{
+	VisAudioCache *cache = audio->cache;
+	AudioCacheEntry *entry;
+	AudioCacheEntry *victim = NULL;
+	int channels_size = 0;
+	int i;
+
+	cache->stamp++;
+
+	for (i = 0; i < AUDIO_CACHE_ENTRIES; i++) {
+		entry = &cache->entries[i];
+
+		if (entry->channels == NULL) {
+			if (victim == NULL || victim->channels != NULL)
+				victim = entry;
+
+			continue;
+		}
+
+		if (entry->type == type && entry->samplelen == samplelen && entry->size == size &&
+				entry->normalised == normalised && entry->multiplier == multiplier &&
+				entry->nchannels == nchannels &&
+				channels_match (entry->channels, nchannels, chanids)) {
+
+			entry->stamp = cache->stamp;
+			*valid = entry->generation == audio->samplepool->generation;
+
+			return entry;
+		}
+
+		if (victim == NULL || (victim->channels != NULL && (int32_t) (entry->stamp - victim->stamp) < 0))
+			victim = entry;
+	}
+
+	/* Take over the unused or least recently asked for entry */
+	for (i = 0; i < nchannels; i++)
+		channels_size += strlen (chanids[i]) + 1;
+
+	if (victim->channels == NULL || victim->channels_size < channels_size) {
+		victim->channels = visual_mem_realloc (victim->channels, channels_size);
+		victim->channels_size = channels_size;
+	}
+
+	channels_size = 0;
+
+	for (i = 0; i < nchannels; i++) {
+		strcpy (victim->channels + channels_size, chanids[i]);
+		channels_size += strlen (chanids[i]) + 1;
+	}
+
+	victim->type = type;
+	victim->nchannels = nchannels;
+	victim->samplelen = samplelen;
+	victim->size = size;
+	victim->normalised = normalised;
+	victim->multiplier = multiplier;
+	victim->generation = audio->samplepool->generation - 1;
+	victim->stamp = cache->stamp;
+
+	*valid = FALSE;
+
+	return victim;
+}
+
+static void audio_cache_store (VisAudio *audio, AudioCacheEntry *entry, VisBuffer *buffer)
+{
+	if (entry->capacity < entry->size) {
+		entry->data = visual_mem_realloc (entry->data, entry->size);
+		entry->capacity = entry->size;
+	}
+
+	visual_mem_copy (entry->data, visual_buffer_get_data (buffer), entry->size);
+
+	entry->generation = audio->samplepool->generation;
+}
+
+static void audio_cache_free (VisAudioCache *cache)
+{
+	int i;
+
+	for (i = 0; i < AUDIO_CACHE_ENTRIES; i++) {
+		if (cache->entries[i].channels != NULL)
+			visual_mem_free (cache->entries[i].channels);
+
+		if (cache->entries[i].data != NULL)
+			visual_mem_free (cache->entries[i].data);
+	}
+
+	visual_mem_free (cache);
+}
+
 static int audio_sample_dtor (VisObject *object)
 {
 	VisAudioSample *sample = VISUAL_AUDIO_SAMPLE (object);
@@ -136,6 +286,7 @@ int visual_audio_init (VisAudio *audio)
 
 	/* Reset the VisAudio data */
 	audio->samplepool = visual_audio_samplepool_new ();
+	audio->cache = visual_mem_new0 (VisAudioCache, 1);
 
 	return VISUAL_OK;
 }
@@ -156,7 +307,8 @@ int visual_audio_get_sample (VisAudio *audio, VisBuffer *buffer, const char *cha
 		return -VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL;
 	}
 
-	visual_ringbuffer_get_data_from_end (channel->samples, buffer, visual_buffer_get_size (buffer));
+	visual_audio_ring_read_latest (channel->samples, visual_buffer_get_data (buffer),
+			visual_buffer_get_size (buffer) / sizeof (float));
 
 	return VISUAL_OK;
 }
@@ -165,17 +317,17 @@ int visual_audio_get_sample (VisAudio *audio, VisBuffer *buffer, const char *cha
 int visual_audio_get_sample_mixed_simple (VisAudio *audio, VisBuffer *buffer, int channels, ...)
 {
 	VisAudioSamplePoolChannel *channel;
+	AudioCacheEntry *entry;
 	VisBuffer *temp;
 	char **chanids;
 	va_list ap;
 	int i;
 	int first = TRUE;
+	int valid;
 
 	visual_return_val_if_fail (audio != NULL, -VISUAL_ERROR_AUDIO_NULL);
 	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
 
-	temp = visual_buffer_new_allocate (visual_buffer_get_size (buffer));
-
 	chanids = visual_mem_malloc (channels * sizeof (char *));
 
 	va_start (ap, channels);
@@ -184,6 +336,20 @@ int visual_audio_get_sample_mixed_simple (VisAudio *audio, VisBuffer *buffer, in
 	for (i = 0; i < channels; i++)
 		chanids[i] = va_arg (ap, char *);
 
+	va_end (ap);
+
+	entry = audio_cache_lookup (audio, AUDIO_CACHE_SAMPLE_MIXED, 0, visual_buffer_get_size (buffer),
+			FALSE, 1.0, channels, chanids, &valid);
+
+	if (valid) {
+		visual_mem_copy (visual_buffer_get_data (buffer), entry->data, entry->size);
+		visual_mem_free (chanids);
+
+		return VISUAL_OK;
+	}
+
+	temp = visual_buffer_new_allocate (visual_buffer_get_size (buffer));
+
 	visual_buffer_fill (buffer, 0);
 
 	/* The mixing loop */
@@ -201,7 +367,7 @@ int visual_audio_get_sample_mixed_simple (VisAudio *audio, VisBuffer *buffer, in
 		}
 	}
 
-	va_end (ap);
+	audio_cache_store (audio, entry, buffer);
 
 	visual_buffer_free (temp);
 
@@ -332,44 +498,60 @@ int visual_audio_get_sample_mixed_all (VisAudio *audio, VisBuffer *buffer, int d
 	return VISUAL_OK;
 }
 
-int visual_audio_get_spectrum (VisAudio *audio, VisBuffer *buffer, int samplelen, const char *channelid, int normalised)
+static int audio_get_spectrum (VisAudio *audio, VisBuffer *buffer, int samplelen, const char *channelid,
+		int normalised, float multiplier)
 {
+	AudioCacheEntry *entry;
 	VisBuffer *sample;
+	int valid;
 
-	visual_return_val_if_fail (audio != NULL, -VISUAL_ERROR_AUDIO_NULL);
-	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
-	visual_return_val_if_fail (channelid != NULL, -VISUAL_ERROR_BUFFER_NULL);
+	entry = audio_cache_lookup (audio, AUDIO_CACHE_SPECTRUM, samplelen, visual_buffer_get_size (buffer),
+			normalised, multiplier, 1, (char **) &channelid, &valid);
 
-	sample = visual_buffer_new_allocate (samplelen);
+	if (valid) {
+		visual_mem_copy (visual_buffer_get_data (buffer), entry->data, entry->size);
 
-	if (visual_audio_get_sample (audio, sample, channelid) == VISUAL_OK)
-		visual_audio_get_spectrum_for_sample (buffer, sample, normalised);
-	else
-		visual_buffer_fill (buffer, 0);
+		return VISUAL_OK;
+	}
 
-	visual_buffer_free (sample);
+	if (multiplier != 1.0) {
+		/* Scale the plain spectrum so it is shared with unmultiplied requests */
+		audio_get_spectrum (audio, buffer, samplelen, channelid, normalised, 1.0);
+
+		visual_math_simd_mul_floats_float (visual_buffer_get_data (buffer), visual_buffer_get_data (buffer),
+				visual_buffer_get_size (buffer) / sizeof (float), multiplier);
+	} else {
+		sample = visual_buffer_new_allocate (samplelen);
+
+		if (visual_audio_get_sample (audio, sample, channelid) == VISUAL_OK)
+			visual_audio_get_spectrum_for_sample (buffer, sample, normalised);
+		else
+			visual_buffer_fill (buffer, 0);
+
+		visual_buffer_free (sample);
+	}
+
+	audio_cache_store (audio, entry, buffer);
 
 	return VISUAL_OK;
 }
 
-int visual_audio_get_spectrum_multiplied (VisAudio *audio, VisBuffer *buffer, int samplelen, const char *channelid, int normalised, float multiplier)
+int visual_audio_get_spectrum (VisAudio *audio, VisBuffer *buffer, int samplelen, const char *channelid, int normalised)
 {
-	int ret;
-	float *data;
-	int datasize;
-
 	visual_return_val_if_fail (audio != NULL, -VISUAL_ERROR_AUDIO_NULL);
 	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
 	visual_return_val_if_fail (channelid != NULL, -VISUAL_ERROR_BUFFER_NULL);
 
-	ret = visual_audio_get_spectrum (audio, buffer, samplelen, channelid, normalised);
-
-	data = visual_buffer_get_data (buffer);
-	datasize = visual_buffer_get_size (buffer) / sizeof (float);
+	return audio_get_spectrum (audio, buffer, samplelen, channelid, normalised, 1.0);
+}
 
-	visual_math_simd_mul_floats_float (data, data, datasize, multiplier);
+int visual_audio_get_spectrum_multiplied (VisAudio *audio, VisBuffer *buffer, int samplelen, const char *channelid, int normalised, float multiplier)
+{
+	visual_return_val_if_fail (audio != NULL, -VISUAL_ERROR_AUDIO_NULL);
+	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
+	visual_return_val_if_fail (channelid != NULL, -VISUAL_ERROR_BUFFER_NULL);
 
-	return ret;
+	return audio_get_spectrum (audio, buffer, samplelen, channelid, normalised, multiplier);
 }
 
 int visual_audio_get_spectrum_for_sample (VisBuffer *buffer, VisBuffer *sample, int normalised)
@@ -461,17 +643,12 @@ int visual_audio_samplepool_add (VisAudioSamplePool *samplepool, VisAudioSample
 	visual_return_val_if_fail (sample != NULL, -VISUAL_ERROR_AUDIO_SAMPLE_NULL);
 	visual_return_val_if_fail (channelid != NULL, -VISUAL_ERROR_NULL);
 
-	channel = visual_audio_samplepool_get_channel (samplepool, channelid);
-
-	/* Channel not there yet, make it */
-	if (channel == NULL) {
-		channel = visual_audio_samplepool_channel_new (channelid);
-
-		visual_audio_samplepool_add_channel (samplepool, channel);
-	}
+	channel = samplepool_get_or_add_channel (samplepool, channelid);
 
 	visual_audio_samplepool_channel_add (channel, sample);
 
+	samplepool->generation++;
+
 	return VISUAL_OK;
 }
 
@@ -482,6 +659,8 @@ int visual_audio_samplepool_add_channel (VisAudioSamplePool *samplepool, VisAudi
 
 	visual_list_add (samplepool->channels, channel);
 
+	samplepool->generation++;
+
 	return VISUAL_OK;
 }
 
@@ -512,6 +691,8 @@ int visual_audio_samplepool_flush_old (VisAudioSamplePool *samplepool)
 		visual_audio_samplepool_channel_flush_old (channel);
 	}
 
+	samplepool->generation++;
+
 	return VISUAL_OK;
 }
 
@@ -526,6 +707,8 @@ int visual_audio_samplepool_input (VisAudioSamplePool *samplepool, VisBuffer *bu
 	if (channeltype == VISUAL_AUDIO_SAMPLE_CHANNEL_STEREO)
 		input_interleaved_stereo (samplepool, buffer, format, rate);
 
+	samplepool->generation++;
+
 	return VISUAL_OK;
 }
 
@@ -534,21 +717,37 @@ int visual_audio_samplepool_input_channel (VisAudioSamplePool *samplepool, VisBu
 		VisAudioSampleFormatType format,
 		const char *channelid)
 {
-	VisAudioSample *sample;
-	VisBuffer *pcmbuf;
-	VisTime *timestamp;
+	VisAudioSamplePoolChannel *channel;
 
 	visual_return_val_if_fail (samplepool != NULL, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_NULL);
 	visual_return_val_if_fail (buffer != NULL, -VISUAL_ERROR_BUFFER_NULL);
+	visual_return_val_if_fail (channelid != NULL, -VISUAL_ERROR_NULL);
+
+	channel = samplepool_get_or_add_channel (samplepool, channelid);
+
+	channel_input (channel, visual_buffer_get_data (buffer),
+			visual_buffer_get_size (buffer) / visual_audio_sample_format_get_size (format), 1,
+			format, NULL);
+
+	samplepool->generation++;
 
-	pcmbuf = visual_buffer_clone (buffer);
+	return VISUAL_OK;
+}
+
+int visual_audio_samplepool_input_ring (VisAudioSamplePool *samplepool, VisAudioRing *ring,
+		const char *channelid)
+{
+	VisAudioSamplePoolChannel *channel;
+
+	visual_return_val_if_fail (samplepool != NULL, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_NULL);
+	visual_return_val_if_fail (ring != NULL, -VISUAL_ERROR_AUDIO_RING_NULL);
+	visual_return_val_if_fail (channelid != NULL, -VISUAL_ERROR_NULL);
 
-	timestamp = visual_time_new_now ();
+	channel = samplepool_get_or_add_channel (samplepool, channelid);
 
-	sample = visual_audio_sample_new (pcmbuf, timestamp, format, rate);
-	visual_audio_samplepool_add (samplepool, sample, channelid);
+	visual_audio_ring_move (channel->samples, ring);
 
-	visual_time_free (timestamp);
+	samplepool->generation++;
 
 	return VISUAL_OK;
 }
@@ -578,7 +777,8 @@ int visual_audio_samplepool_channel_init (VisAudioSamplePoolChannel *channel, co
 	visual_object_set_allocated (VISUAL_OBJECT (channel), FALSE);
 
 	/* Reset the VisAudioSamplePoolChannel data */
-	channel->samples = visual_ringbuffer_new ();
+	channel->samples = visual_audio_ring_new (VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_RING_SIZE,
+			VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_RING_SEGMENTS);
 
 	channel->samples_timeout = visual_time_new_with_values (1, 0); /* FIXME not safe against time skews */
 
@@ -593,50 +793,21 @@ int visual_audio_samplepool_channel_add (VisAudioSamplePoolChannel *channel, Vis
 	visual_return_val_if_fail (channel != NULL, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL);
 	visual_return_val_if_fail (sample != NULL, -VISUAL_ERROR_AUDIO_SAMPLE_NULL);
 
-	visual_ringbuffer_add_function (channel->samples,
-			sample_data_func,
-			sample_destroy_func,
-			sample_size_func, sample);
+	channel_input (channel, visual_buffer_get_data (sample->buffer),
+			visual_buffer_get_size (sample->buffer) / visual_audio_sample_format_get_size (sample->format), 1,
+			sample->format, sample->timestamp);
+
+	/* The samples now live in the ring, drop the reference we were handed */
+	visual_object_unref (VISUAL_OBJECT (sample));
 
 	return VISUAL_OK;
 }
 
 int visual_audio_samplepool_channel_flush_old (VisAudioSamplePoolChannel *channel)
 {
-	VisList *list;
-	VisListEntry *le = NULL;
-	VisRingBufferEntry *rentry;
-	VisAudioSample *sample;
-	VisTime *diff;
-	VisTime *curtime;
-
 	visual_return_val_if_fail (channel != NULL, -VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL);
 
-	curtime = visual_time_new ();
-	diff = visual_time_new ();
-
-	list = visual_ringbuffer_get_list (channel->samples);
-
-	while ((rentry = visual_list_next (list, &le)) != NULL) {
-
-		sample = visual_ringbuffer_entry_get_functiondata (rentry);
-		visual_time_get_now (curtime);
-
-		visual_time_diff (diff, curtime, sample->timestamp);
-
-		if (visual_time_is_past (diff, channel->samples_timeout)) {
-			visual_list_destroy (list, &le);
-
-			if (le == NULL) {
-				break;
-			}
-		}
-	}
-
-	visual_time_free (diff);
-	visual_time_free (curtime);
-
-	return VISUAL_OK;
+	return visual_audio_ring_flush_old (channel->samples, channel->samples_timeout);
 }
 
 int visual_audio_sample_buffer_mix (VisBuffer *dest, VisBuffer *src, int divide, float multiplier)
@@ -854,73 +1025,70 @@ int visual_audio_sample_format_is_signed (VisAudioSampleFormatType format)
 	return formatsignedtable[format];
 }
 
-static VisBuffer *sample_data_func (VisRingBuffer *ringbuffer, VisRingBufferEntry *entry)
+static VisAudioSamplePoolChannel *samplepool_get_or_add_channel (VisAudioSamplePool *samplepool, const char *channelid)
 {
-	VisAudioSample *sample = entry->functiondata;
-
-	/* We have internal format ready */
-	if (sample->processed != NULL) {
-		visual_buffer_ref (sample->processed);
-
-		return sample->processed;
-	}
+	VisAudioSamplePoolChannel *channel;
 
-	sample->processed = visual_buffer_new_allocate (
-			(visual_buffer_get_size (sample->buffer) /
-			 visual_audio_sample_format_get_size (sample->format)) * sizeof (float));
+	channel = visual_audio_samplepool_get_channel (samplepool, channelid);
 
-	visual_audio_sample_convert (sample->processed, VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT,
-	                             sample->buffer, sample->format);
+	/* Channel not there yet, make it */
+	if (channel == NULL) {
+		channel = visual_audio_samplepool_channel_new (channelid);
 
-	visual_buffer_ref (sample->processed);
+		visual_audio_samplepool_add_channel (samplepool, channel);
+	}
 
-	return sample->processed;
+	return channel;
 }
 
-static void sample_destroy_func (VisRingBufferEntry *entry)
+/* Converts count samples, stride apart, straight into the channel ring */
+static void channel_input (VisAudioSamplePoolChannel *channel, const void *data, int count, int stride,
+		VisAudioSampleFormatType format, VisTime *timestamp)
 {
-	VisAudioSample *sample = entry->functiondata;
+	int ring_size = visual_audio_ring_get_size (channel->samples);
+	int sample_size = visual_audio_sample_format_get_size (format);
+	float *region1, *region2;
+	int count1, count2;
+
+	/* Only the newest samples fit */
+	if (count > ring_size) {
+		data = (const uint8_t *) data + (count - ring_size) * stride * sample_size;
+		count = ring_size;
+	}
 
-	visual_object_unref (VISUAL_OBJECT (sample));
-}
+	visual_audio_ring_write_begin (channel->samples, count, &region1, &count1, &region2, &count2);
 
-static int sample_size_func (VisRingBuffer *ringbuffer, VisRingBufferEntry *entry)
-{
-	VisAudioSample *sample = entry->functiondata;
+	visual_audio_sample_convert_to_float (region1, data, count1, stride, format);
+
+	if (region2 != NULL)
+		visual_audio_sample_convert_to_float (region2,
+				(const uint8_t *) data + count1 * stride * sample_size,
+				count2, stride, format);
 
-	return (visual_buffer_get_size (sample->buffer) /
-		visual_audio_sample_format_get_size (sample->format)) * sizeof (float);
+	visual_audio_ring_write_commit (channel->samples, count, timestamp);
 }
 
 static int input_interleaved_stereo (VisAudioSamplePool *samplepool, VisBuffer *buffer,
 		VisAudioSampleFormatType format,
 		VisAudioSampleRateType rate)
 {
-	VisBuffer *chan1 = NULL;
-	VisBuffer *chan2 = NULL;
+	VisAudioSamplePoolChannel *left;
+	VisAudioSamplePoolChannel *right;
+	const uint8_t *data;
 	int sample_size;
-	VisAudioSample *sample;
-	VisTime *timestamp;
+	int count;
 
 	sample_size = visual_audio_sample_format_get_size (format);
 
-	chan1 = visual_buffer_new_allocate (sample_size * (visual_buffer_get_size (buffer) / 2));
-	chan2 = visual_buffer_new_allocate (sample_size * (visual_buffer_get_size (buffer) / 2));
-
-	visual_audio_sample_deinterleave_stereo (chan1, chan2, buffer, format);
-
-	visual_return_val_if_fail (chan1 != NULL, -1);
-	visual_return_val_if_fail (chan2 != NULL, -1);
-
-	timestamp = visual_time_new_now ();
-
-	sample = visual_audio_sample_new (chan1, timestamp, format, rate);
-	visual_audio_samplepool_add (samplepool, sample, VISUAL_AUDIO_CHANNEL_LEFT);
+	data = visual_buffer_get_data (buffer);
+	count = visual_buffer_get_size (buffer) / (sample_size * 2);
 
-	sample = visual_audio_sample_new (chan2, timestamp, format, rate);
-	visual_audio_samplepool_add (samplepool, sample, VISUAL_AUDIO_CHANNEL_RIGHT);
+	left = samplepool_get_or_add_channel (samplepool, VISUAL_AUDIO_CHANNEL_LEFT);
+	right = samplepool_get_or_add_channel (samplepool, VISUAL_AUDIO_CHANNEL_RIGHT);
 
-	visual_time_free (timestamp);
+	/* Deinterleave and convert in one go, straight into the rings */
+	channel_input (left, data, count, 2, format, NULL);
+	channel_input (right, data + sample_size, count, 2, format, NULL);
 
 	return VISUAL_OK;
 }
@@ -25,7 +25,9 @@
 #define _LV_AUDIO_H
 
 #include <libvisual/lv_time.h>
-#include <libvisual/lv_ringbuffer.h>
+#include <libvisual/lv_list.h>
+#include <libvisual/lv_buffer.h>
+#include <libvisual/lv_audio_ring.h>
 
 /**
  * @defgroup VisAudio VisAudio
@@ -37,6 +39,9 @@
 #define VISUAL_AUDIO_SAMPLEPOOL_CHANNEL(obj)		(VISUAL_CHECK_CAST ((obj), VisAudioSamplePoolChannel))
 #define VISUAL_AUDIO_SAMPLE(obj)			(VISUAL_CHECK_CAST ((obj), VisAudioSample))
 
+#define VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_RING_SIZE	65536	/**< Samples kept per channel, a power of two. */
+#define VISUAL_AUDIO_SAMPLEPOOL_CHANNEL_RING_SEGMENTS	128	/**< Write timestamps kept per channel. */
+
 #define VISUAL_AUDIO_CHANNEL_LEFT	"front left 1"
 #define VISUAL_AUDIO_CHANNEL_RIGHT	"front right 1"
 
@@ -79,22 +84,25 @@ typedef struct _VisAudio VisAudio;
 typedef struct _VisAudioSamplePool VisAudioSamplePool;
 typedef struct _VisAudioSamplePoolChannel VisAudioSamplePoolChannel;
 typedef struct _VisAudioSample VisAudioSample;
+typedef struct _VisAudioCache VisAudioCache;
 
 struct _VisAudio {
 	VisObject            object;
 	VisAudioSamplePool	*samplepool;
+	VisAudioCache		*cache;		/* Spectra and mixes computed since the samplepool last changed */
 };
 
 struct _VisAudioSamplePool {
 	VisObject	 object;
 
 	VisList		*channels;
+	uint32_t	 generation;	/* Bumped on every change made through the samplepool */
 };
 
 struct _VisAudioSamplePoolChannel {
 	VisObject	 object;
 
-	VisRingBuffer	*samples;
+	VisAudioRing	*samples;
 	VisTime		    *samples_timeout;
 
 	char		*channelid;
@@ -166,6 +174,20 @@ LV_API int visual_audio_samplepool_input_channel (VisAudioSamplePool *samplepool
 		VisAudioSampleFormatType format,
 		const char *channelid);
 
+/**
+ * Moves everything a capture thread pushed into a VisAudioRing over into a
+ * channel of the samplepool, keeping the capture timestamps. The caller
+ * acts as the consumer of ring.
+ *
+ * @param samplepool Pointer to the VisAudioSamplePool.
+ * @param ring Pointer to the VisAudioRing holding float samples.
+ * @param channelid The channel to append to, it is created when needed.
+ *
+ * @return VISUAL_OK on success, or an error code on failure.
+ */
+LV_API int visual_audio_samplepool_input_ring (VisAudioSamplePool *samplepool, VisAudioRing *ring,
+		const char *channelid);
+
 VisAudioSamplePoolChannel *visual_audio_samplepool_channel_new (const char *channelid);
 LV_API int visual_audio_samplepool_channel_init (VisAudioSamplePoolChannel *channel, const char *channelid);
 LV_API int visual_audio_samplepool_channel_add (VisAudioSamplePoolChannel *channel, VisAudioSample *sample);
@@ -0,0 +1,472 @@
+/* Libvisual - The audio visualisation framework.
+ *
+ * Copyright (C) 2004, 2005, 2006 Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "config.h"
+#include "lv_audio_ring.h"
+#include "lv_common.h"
+#include "private/lv_atomic.h"
+
+/* All positions are free running sample counters, they are only masked
+ * when indexing the data. Differences between them are therefore valid
+ * across the 32 bit wrap as long as they are done in unsigned arithmetic.
+ *
+ * The producer owns head, reserve and seghead, the consumer owns tail.
+ * Before overwriting old samples the producer announces the end of the
+ * region it is about to write in reserve; a reader that copied samples
+ * from [start, end) checks afterwards that reserve - size <= start, much
+ * like a seqlock. */
+
+typedef struct {
+	uint32_t	 start;
+	uint64_t	 usecs;
+} AudioRingSegment;
+
+struct _VisAudioRing {
+	VisObject		 object;
+
+	float			*data;
+	uint32_t		 size;
+	uint32_t		 mask;
+
+	AudioRingSegment	*segments;
+	uint32_t		 nsegments;
+	uint32_t		 segmask;
+
+	/* Producer side */
+	uint32_t		 head;
+	uint32_t		 reserve;
+	uint32_t		 seghead;
+	VisTime			*produce_time;
+
+	/* Consumer side */
+	uint32_t		 tail;
+	VisTime			*consume_time;
+};
+
+#define AUDIO_RING_READ_RETRIES	3
+
+static int audio_ring_dtor (VisObject *object);
+
+static int is_power_of_two (int value);
+static void ring_reserve (VisAudioRing *ring, uint32_t count);
+static void ring_commit (VisAudioRing *ring, uint32_t count, uint64_t usecs);
+static uint32_t ring_overwritten (VisAudioRing *ring, uint32_t start, uint32_t count);
+static uint32_t ring_valid_start (VisAudioRing *ring, uint32_t head);
+static void ring_copy_out (VisAudioRing *ring, float *dest, uint32_t start, uint32_t count);
+static uint64_t time_to_usecs_or_now (VisTime *timestamp, VisTime *scratch);
+
+
+static int audio_ring_dtor (VisObject *object)
+{
+	VisAudioRing *ring = VISUAL_AUDIO_RING (object);
+
+	if (ring->data != NULL)
+		visual_mem_free (ring->data);
+
+	if (ring->segments != NULL)
+		visual_mem_free (ring->segments);
+
+	if (ring->produce_time != NULL)
+		visual_time_free (ring->produce_time);
+
+	if (ring->consume_time != NULL)
+		visual_time_free (ring->consume_time);
+
+	ring->data = NULL;
+	ring->segments = NULL;
+	ring->produce_time = NULL;
+	ring->consume_time = NULL;
+
+	return VISUAL_OK;
+}
+
+static int is_power_of_two (int value)
+{
+	return value > 0 && (value & (value - 1)) == 0;
+}
+
+static void ring_reserve (VisAudioRing *ring, uint32_t count)
+{
+	visual_atomic_store_u32_release (&ring->reserve, ring->head + count);
+
+	/* Readers must see the new reserve before any overwritten sample */
+	visual_atomic_fence ();
+}
+
+static void ring_commit (VisAudioRing *ring, uint32_t count, uint64_t usecs)
+{
+	AudioRingSegment *segment;
+
+	if (count == 0)
+		return;
+
+	segment = &ring->segments[ring->seghead & ring->segmask];
+	segment->start = ring->head;
+	segment->usecs = usecs;
+
+	visual_atomic_store_u32_release (&ring->head, ring->head + count);
+	visual_atomic_store_u32_release (&ring->seghead, ring->seghead + 1);
+}
+
+static uint32_t ring_overwritten (VisAudioRing *ring, uint32_t start, uint32_t count)
+{
+	uint32_t lowest;
+	int32_t lost;
+
+	visual_atomic_fence ();
+
+	lowest = visual_atomic_load_u32_acquire (&ring->reserve) - ring->size;
+	lost = (int32_t) (lowest - start);
+
+	if (lost <= 0)
+		return 0;
+
+	return (uint32_t) lost > count ? count : (uint32_t) lost;
+}
+
+static uint32_t ring_valid_start (VisAudioRing *ring, uint32_t head)
+{
+	uint32_t tail = ring->tail;
+
+	if (head - tail > ring->size)
+		return head - ring->size;
+
+	return tail;
+}
+
+static void ring_copy_out (VisAudioRing *ring, float *dest, uint32_t start, uint32_t count)
+{
+	uint32_t pos = start & ring->mask;
+	uint32_t first = ring->size - pos;
+
+	if (first > count)
+		first = count;
+
+	visual_mem_copy (dest, ring->data + pos, first * sizeof (float));
+
+	if (count > first)
+		visual_mem_copy (dest + first, ring->data, (count - first) * sizeof (float));
+}
+
+static uint64_t time_to_usecs_or_now (VisTime *timestamp, VisTime *scratch)
+{
+	if (timestamp != NULL)
+		return visual_time_to_usecs (timestamp);
+
+	visual_time_get_now (scratch);
+
+	return visual_time_to_usecs (scratch);
+}
+
+VisAudioRing *visual_audio_ring_new (int size, int nsegments)
+{
+	VisAudioRing *ring;
+
+	/* Checked in every build, the masking below relies on it */
+	if (!is_power_of_two (size) || !is_power_of_two (nsegments) || nsegments < 2)
+		return NULL;
+
+	ring = visual_mem_new0 (VisAudioRing, 1);
+
+	/* Do the VisObject initialization */
+	visual_object_initialize (VISUAL_OBJECT (ring), TRUE, audio_ring_dtor);
+
+	ring->data = visual_mem_malloc0 (size * sizeof (float));
+	ring->size = size;
+	ring->mask = size - 1;
+
+	ring->segments = visual_mem_new0 (AudioRingSegment, nsegments);
+	ring->nsegments = nsegments;
+	ring->segmask = nsegments - 1;
+
+	ring->produce_time = visual_time_new ();
+	ring->consume_time = visual_time_new ();
+
+	return ring;
+}
+
+int visual_audio_ring_get_size (VisAudioRing *ring)
+{
+	visual_return_val_if_fail (ring != NULL, -VISUAL_ERROR_AUDIO_RING_NULL);
+
+	return ring->size;
+}
+
+int visual_audio_ring_write (VisAudioRing *ring, const float *samples, int count, VisTime *timestamp)
+{
+	float *region1, *region2;
+	int count1, count2;
+
+	visual_return_val_if_fail (ring != NULL, -VISUAL_ERROR_AUDIO_RING_NULL);
+	visual_return_val_if_fail (samples != NULL, -VISUAL_ERROR_NULL);
+
+	if (count <= 0)
+		return VISUAL_OK;
+
+	/* Only the newest samples fit */
+	if ((uint32_t) count > ring->size) {
+		samples += count - ring->size;
+		count = ring->size;
+	}
+
+	visual_audio_ring_write_begin (ring, count, &region1, &count1, &region2, &count2);
+
+	visual_mem_copy (region1, samples, count1 * sizeof (float));
+
+	if (region2 != NULL)
+		visual_mem_copy (region2, samples + count1, count2 * sizeof (float));
+
+	return visual_audio_ring_write_commit (ring, count, timestamp);
+}
+
+int visual_audio_ring_write_begin (VisAudioRing *ring, int count,
+		float **region1, int *count1,
+		float **region2, int *count2)
+{
+	uint32_t pos;
+	uint32_t first;
+
+	visual_return_val_if_fail (ring != NULL, -VISUAL_ERROR_AUDIO_RING_NULL);
+	visual_return_val_if_fail (count >= 0 && (uint32_t) count <= ring->size, -VISUAL_ERROR_AUDIO_RING_INVALID_SIZE);
+
+	ring_reserve (ring, count);
+
+	pos = ring->head & ring->mask;
+	first = ring->size - pos;
+
+	if (first > (uint32_t) count)
+		first = count;
+
+	*region1 = ring->data + pos;
+	*count1 = first;
+
+	*region2 = (uint32_t) count > first ? ring->data : NULL;
+	*count2 = count - first;
+
+	return VISUAL_OK;
+}
+
+int visual_audio_ring_write_commit (VisAudioRing *ring, int count, VisTime *timestamp)
+{
+	visual_return_val_if_fail (ring != NULL, -VISUAL_ERROR_AUDIO_RING_NULL);
+
+	if (count <= 0)
+		return VISUAL_OK;
+
+	ring_commit (ring, count, time_to_usecs_or_now (timestamp, ring->produce_time));
+
+	return VISUAL_OK;
+}
+
+int visual_audio_ring_read_latest (VisAudioRing *ring, float *dest, int count)
+{
+	uint32_t head;
+	uint32_t start;
+	uint32_t avail;
+	uint32_t lost;
+	int retries = 0;
+
+	visual_return_val_if_fail (ring != NULL, -VISUAL_ERROR_AUDIO_RING_NULL);
+	visual_return_val_if_fail (dest != NULL, -VISUAL_ERROR_NULL);
+
+	if (count <= 0)
+		return 0;
+
+	for (;;) {
+		head = visual_atomic_load_u32_acquire (&ring->head);
+		start = ring_valid_start (ring, head);
+
+		avail = head - start;
+		if (avail > (uint32_t) count)
+			avail = count;
+
+		start = head - avail;
+
+		ring_copy_out (ring, dest + count - avail, start, avail);
+
+		lost = ring_overwritten (ring, start, avail);
+
+		if (lost == 0)
+			break;
+
+		/* The producer lapped us, either try again or give up on the
+		 * part that was overwritten while copying */
+		if (++retries == AUDIO_RING_READ_RETRIES) {
+			avail -= lost;
+
+			break;
+		}
+	}
+
+	if ((uint32_t) count > avail)
+		visual_mem_set (dest, 0, (count - avail) * sizeof (float));
+
+	return avail;
+}
+
+int visual_audio_ring_flush_old (VisAudioRing *ring, VisTime *timeout)
+{
+	AudioRingSegment *segment;
+	uint32_t seghead, head;
+	uint32_t nsegs, i, end;
+	uint32_t tail;
+	uint64_t now, cutoff;
+	int retries;
+
+	visual_return_val_if_fail (ring != NULL, -VISUAL_ERROR_AUDIO_RING_NULL);
+	visual_return_val_if_fail (timeout != NULL, -VISUAL_ERROR_NULL);
+
+	visual_time_get_now (ring->consume_time);
+
+	now = visual_time_to_usecs (ring->consume_time);
+	cutoff = visual_time_to_usecs (timeout);
+
+	if (now <= cutoff)
+		return VISUAL_OK;
+
+	cutoff = now - cutoff;
+
+	for (retries = 0; retries < AUDIO_RING_READ_RETRIES; retries++) {
+		seghead = visual_atomic_load_u32_acquire (&ring->seghead);
+		head = visual_atomic_load_u32_acquire (&ring->head);
+
+		/* The slot at seghead is the one the producer fills next */
+		nsegs = seghead < ring->segmask ? seghead : ring->segmask;
+
+		tail = ring->tail;
+		end = head;
+
+		/* Walk from the newest segment back, everything before the
+		 * first one that timed out goes */
+		for (i = 1; i <= nsegs; i++) {
+			segment = &ring->segments[(seghead - i) & ring->segmask];
+
+			if (segment->usecs <= cutoff) {
+				tail = end;
+
+				break;
+			}
+
+			end = segment->start;
+		}
+
+		if (i > nsegs)
+			i = nsegs;
+
+		/* Make sure none of the slots we looked at got reused meanwhile */
+		visual_atomic_fence ();
+
+		if (visual_atomic_load_u32_acquire (&ring->seghead) - seghead + i < ring->nsegments) {
+			if ((int32_t) (tail - ring->tail) > 0)
+				visual_atomic_store_u32_release (&ring->tail, tail);
+
+			break;
+		}
+	}
+
+	return VISUAL_OK;
+}
+
+int visual_audio_ring_move (VisAudioRing *dest, VisAudioRing *src)
+{
+	AudioRingSegment *segment;
+	uint32_t seghead, head;
+	uint32_t start, end, count, lost;
+	uint32_t nsegs, first, i;
+	uint64_t usecs;
+	float *region1, *region2;
+	int count1, count2;
+	int moved = 0;
+
+	visual_return_val_if_fail (dest != NULL, -VISUAL_ERROR_AUDIO_RING_NULL);
+	visual_return_val_if_fail (src != NULL, -VISUAL_ERROR_AUDIO_RING_NULL);
+
+	seghead = visual_atomic_load_u32_acquire (&src->seghead);
+	head = visual_atomic_load_u32_acquire (&src->head);
+
+	start = ring_valid_start (src, head);
+
+	if (start == head)
+		return 0;
+
+	nsegs = seghead < src->segmask ? seghead : src->segmask;
+
+	/* Find the oldest segment still holding valid samples, samples from
+	 * before the oldest remembered segment inherit its timestamp */
+	first = seghead - nsegs;
+
+	for (i = 1; i <= nsegs; i++) {
+		if ((int32_t) (src->segments[(seghead - i) & src->segmask].start - start) <= 0) {
+			first = seghead - i;
+
+			break;
+		}
+	}
+
+	for (i = first; i != seghead; i++) {
+		segment = &src->segments[i & src->segmask];
+
+		usecs = segment->usecs;
+		end = i + 1 == seghead ? head : src->segments[(i + 1) & src->segmask].start;
+
+		if (i != first)
+			start = segment->start;
+
+		/* Skip segments whose slots were reused while we were busy */
+		visual_atomic_fence ();
+
+		if (visual_atomic_load_u32_acquire (&src->seghead) - i >= src->nsegments)
+			continue;
+
+		count = end - start;
+
+		if ((int32_t) count <= 0)
+			continue;
+
+		if (count > dest->size) {
+			start = end - dest->size;
+			count = dest->size;
+		}
+
+		visual_audio_ring_write_begin (dest, count, &region1, &count1, &region2, &count2);
+
+		ring_copy_out (src, region1, start, count1);
+
+		if (region2 != NULL)
+			ring_copy_out (src, region2, start + count1, count2);
+
+		/* Silence whatever the producer of src overwrote while we copied */
+		lost = ring_overwritten (src, start, count);
+
+		if (lost > 0) {
+			visual_mem_set (region1, 0, (lost < (uint32_t) count1 ? lost : (uint32_t) count1) * sizeof (float));
+
+			if (lost > (uint32_t) count1)
+				visual_mem_set (region2, 0, (lost - count1) * sizeof (float));
+		}
+
+		ring_commit (dest, count, usecs);
+
+		moved += count;
+	}
+
+	visual_atomic_store_u32_release (&src->tail, head);
+
+	return moved;
+}
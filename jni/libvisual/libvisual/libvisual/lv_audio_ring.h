@@ -0,0 +1,153 @@
+/* Libvisual - The audio visualisation framework.
+ *
+ * Copyright (C) 2004, 2005, 2006 Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _LV_AUDIO_RING_H
+#define _LV_AUDIO_RING_H
+
+#include <libvisual/lvconfig.h>
+#include <libvisual/lv_defines.h>
+#include <libvisual/lv_types.h>
+#include <libvisual/lv_object.h>
+#include <libvisual/lv_time.h>
+
+/**
+ * @defgroup VisAudioRing VisAudioRing
+ * @{
+ */
+
+#define VISUAL_AUDIO_RING(obj)				(VISUAL_CHECK_CAST ((obj), VisAudioRing))
+
+/**
+ * A VisAudioRing is a fixed size, power of two sized ring of float samples
+ * for exactly one producer and one consumer thread. Neither side takes a
+ * lock or allocates memory once the ring has been created, which makes it
+ * safe to feed from realtime audio callbacks.
+ *
+ * Every write is remembered as a timestamped segment so the consumer can
+ * drop samples that are older than a given timeout. When the producer
+ * runs a full ring ahead of the consumer the oldest samples are simply
+ * overwritten; readers detect this and never return torn data.
+ */
+typedef struct _VisAudioRing VisAudioRing;
+
+LV_BEGIN_DECLS
+
+/**
+ * Creates a new VisAudioRing.
+ *
+ * @param size Number of samples the ring holds, must be a power of two.
+ * @param nsegments Number of write timestamps remembered, must be a power of two.
+ *
+ * @return A newly allocated VisAudioRing, or NULL on failure.
+ */
+LV_API VisAudioRing *visual_audio_ring_new (int size, int nsegments);
+
+/**
+ * Gives the number of samples a VisAudioRing can hold.
+ *
+ * @param ring Pointer to the VisAudioRing.
+ *
+ * @return The ring size in samples, or -VISUAL_ERROR_AUDIO_RING_NULL on failure.
+ */
+LV_API int visual_audio_ring_get_size (VisAudioRing *ring);
+
+/**
+ * Appends samples to the ring. Producer side only.
+ *
+ * @param ring Pointer to the VisAudioRing.
+ * @param samples The samples to append.
+ * @param count Number of samples, when larger than the ring only the newest are kept.
+ * @param timestamp Capture time of the samples, or NULL for the current time.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_AUDIO_RING_NULL or -VISUAL_ERROR_NULL on failure.
+ */
+LV_API int visual_audio_ring_write (VisAudioRing *ring, const float *samples, int count, VisTime *timestamp);
+
+/**
+ * Reserves room for count samples so they can be produced in place, for
+ * example by a format conversion. Because the space may wrap around the
+ * end of the ring it is returned as up to two regions. Producer side only,
+ * and must be followed by visual_audio_ring_write_commit().
+ *
+ * @param ring Pointer to the VisAudioRing.
+ * @param count Number of samples to reserve, at most the ring size.
+ * @param region1 Location to store the first region.
+ * @param count1 Location to store the number of samples in the first region.
+ * @param region2 Location to store the second region, NULL when there is none.
+ * @param count2 Location to store the number of samples in the second region.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_AUDIO_RING_NULL or
+ *	-VISUAL_ERROR_AUDIO_RING_INVALID_SIZE on failure.
+ */
+LV_API int visual_audio_ring_write_begin (VisAudioRing *ring, int count,
+		float **region1, int *count1,
+		float **region2, int *count2);
+
+/**
+ * Publishes samples produced in the regions handed out by visual_audio_ring_write_begin().
+ *
+ * @param ring Pointer to the VisAudioRing.
+ * @param count Number of samples that were reserved.
+ * @param timestamp Capture time of the samples, or NULL for the current time.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_AUDIO_RING_NULL on failure.
+ */
+LV_API int visual_audio_ring_write_commit (VisAudioRing *ring, int count, VisTime *timestamp);
+
+/**
+ * Copies the newest count samples into dest, oldest first, reading
+ * across the wrap around point. When fewer valid samples are available
+ * the start of dest is filled with silence. Consumer side only.
+ *
+ * @param ring Pointer to the VisAudioRing.
+ * @param dest Destination for the samples.
+ * @param count Number of samples to read.
+ *
+ * @return The number of valid samples copied, or -VISUAL_ERROR_AUDIO_RING_NULL on failure.
+ */
+LV_API int visual_audio_ring_read_latest (VisAudioRing *ring, float *dest, int count);
+
+/**
+ * Drops all samples that were written longer than timeout ago. Consumer side only.
+ *
+ * @param ring Pointer to the VisAudioRing.
+ * @param timeout Maximum age of the samples that are kept.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_AUDIO_RING_NULL or -VISUAL_ERROR_NULL on failure.
+ */
+LV_API int visual_audio_ring_flush_old (VisAudioRing *ring, VisTime *timeout);
+
+/**
+ * Moves all samples that src holds into dest, keeping their timestamps.
+ * The caller acts as the consumer of src and as the producer of dest.
+ *
+ * @param dest Pointer to the VisAudioRing the samples are appended to.
+ * @param src Pointer to the VisAudioRing the samples are taken from.
+ *
+ * @return The number of samples moved, or -VISUAL_ERROR_AUDIO_RING_NULL on failure.
+ */
+LV_API int visual_audio_ring_move (VisAudioRing *dest, VisAudioRing *src);
+
+LV_END_DECLS
+
+/**
+ * @}
+ */
+
+#endif /* _LV_AUDIO_RING_H */
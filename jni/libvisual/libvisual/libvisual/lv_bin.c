@@ -25,14 +25,50 @@
 #include "lv_bin.h"
 #include "lv_common.h"
 #include "lv_list.h"
+#include "lv_thread.h"
 #include "gettext.h"
 
 /* WARNING: Utterly shit ahead, i've screwed up on this and i need to
  * rewrite it. And i can't say i feel like it at the moment so be
  * patient :)  */
 
+typedef enum {
+	BIN_FRAME_FREE,		/* Can be rendered into */
+	BIN_FRAME_RENDERING,	/* Being filled by the render thread */
+	BIN_FRAME_READY,	/* Rendered, waiting for the caller */
+	BIN_FRAME_ACQUIRED	/* Handed out to the caller */
+} BinFrameState;
+
+struct _VisBinPipeline {
+	VisMutex	*mutex;
+	VisCond		*cond;		/* Broadcast on every state change */
+
+	VisThread	*capture_thread;
+	VisThread	*render_thread;
+	int		 running;
+
+	VisAudio	*staging;	/* Samples handed from capture to render */
+	int		 staged;	/* TRUE when staging holds samples not picked up yet */
+	VisAudio	*audio;		/* Samples owned by the render thread */
+
+	int		 nframes;
+	VisVideo	**frames;
+	BinFrameState	*states;
+	unsigned long	*serials;
+	unsigned long	 serial;
+};
+
 static int bin_dtor (VisObject *object);
 
+static int bin_run_frame (VisBin *bin, VisAudio *audio);
+static void bin_video_swap_pixels (VisVideo *video1, VisVideo *video2);
+
+static void pipeline_move_samples (VisAudio *dest, VisAudio *src);
+static void pipeline_publish_frame (VisBin *bin, VisBinPipeline *pipeline, int index);
+static void *pipeline_capture_thread (void *data);
+static void *pipeline_render_thread (void *data);
+static void pipeline_free (VisBinPipeline *pipeline);
+
 static void fix_depth_with_bin (VisBin *bin, VisVideo *video, int depth);
 static int bin_get_depth_using_preferred (VisBin *bin, int depthflag);
 
@@ -42,6 +78,9 @@ static int bin_dtor (VisObject *object)
 
 	visual_return_val_if_fail (bin != NULL, -1);
 
+	if (bin->pipeline != NULL)
+		visual_bin_pipeline_stop (bin);
+
 	if (bin->actor != NULL)
 		visual_object_unref (VISUAL_OBJECT (bin->actor));
 
@@ -804,8 +843,71 @@ int visual_bin_run (VisBin *bin)
 	visual_return_val_if_fail (bin->actor != NULL, -1);
 	visual_return_val_if_fail (bin->input != NULL, -1);
 
+	if (bin->pipeline != NULL) {
+		visual_log (VISUAL_LOG_ERROR, _("The VisBin is pipelined, use visual_bin_pipeline_acquire_frame instead"));
+
+		return -1;
+	}
+
 	visual_input_run (bin->input);
 
+	return bin_run_frame (bin, bin->input->audio);
+}
+
+int visual_bin_run_to_video (VisBin *bin, VisVideo *dest)
+{
+	int ret;
+
+	visual_return_val_if_fail (bin != NULL, -1);
+	visual_return_val_if_fail (bin->actvideo != NULL, -1);
+	visual_return_val_if_fail (dest != NULL, -1);
+	visual_return_val_if_fail (visual_video_get_pixels (dest) != NULL, -1);
+
+	if (bin->pipeline != NULL) {
+		visual_log (VISUAL_LOG_ERROR, _("The VisBin is pipelined, use visual_bin_pipeline_acquire_frame instead"));
+
+		return -1;
+	}
+
+	/* A pending switch can finalize during the run and change the depth of
+	 * the bin its video, so only a bin that isn't switching may render
+	 * straight into the destination */
+	if (bin->morphing || bin->actvideo->depth == VISUAL_VIDEO_DEPTH_GL ||
+		!visual_video_compare_attrs (dest, bin->actvideo)) {
+
+		ret = visual_bin_run (bin);
+
+		if (ret == 0)
+			visual_video_convert_depth (dest, bin->actvideo);
+
+		return ret;
+	}
+
+	/* The actor, morph and transforms all hold on to the bin its video,
+	 * so lend it the pixels of the destination for the duration of the run */
+	bin_video_swap_pixels (bin->actvideo, dest);
+
+	ret = visual_bin_run (bin);
+
+	bin_video_swap_pixels (bin->actvideo, dest);
+
+	return ret;
+}
+
+static void bin_video_swap_pixels (VisVideo *video1, VisVideo *video2)
+{
+	VisBuffer *buffer = video1->buffer;
+	void **pixel_rows = video1->pixel_rows;
+
+	video1->buffer = video2->buffer;
+	video1->pixel_rows = video2->pixel_rows;
+
+	video2->buffer = buffer;
+	video2->pixel_rows = pixel_rows;
+}
+
+static int bin_run_frame (VisBin *bin, VisAudio *audio)
+{
 	/* If we have a direct switch, do this BEFORE we run the actor,
 	 * else we can get into trouble especially with GL, also when
 	 * switching away from a GL plugin this is needed */
@@ -858,7 +960,7 @@ int visual_bin_run (VisBin *bin)
 	 * requested after the connect, thus we can realize there yet */
 	visual_actor_realize (bin->actor);
 
-	visual_actor_run (bin->actor, bin->input->audio);
+	visual_actor_run (bin->actor, audio);
 
 	if (bin->morphing) {
 		visual_return_val_if_fail (bin->actmorph != NULL, -1);
@@ -869,7 +971,7 @@ int visual_bin_run (VisBin *bin)
 			bin->actmorph->video->depth != VISUAL_VIDEO_DEPTH_GL &&
 			bin->actor->video->depth != VISUAL_VIDEO_DEPTH_GL) {
 
-			visual_actor_run (bin->actmorph, bin->input->audio);
+			visual_actor_run (bin->actmorph, audio);
 
 			if (bin->morph == NULL || bin->morph->plugin == NULL) {
 				visual_bin_switch_finalize (bin);
@@ -880,7 +982,7 @@ int visual_bin_run (VisBin *bin)
 			/* Same goes for the morph, we realize it here for depth changes
 			 * (especially the openGL case */
 			visual_morph_realize (bin->morph);
-			visual_morph_run (bin->morph, bin->input->audio, bin->actor->video, bin->actmorph->video);
+			visual_morph_run (bin->morph, audio, bin->actor->video, bin->actmorph->video);
 
 			if (visual_morph_is_done (bin->morph))
 				visual_bin_switch_finalize (bin);
@@ -891,3 +993,327 @@ int visual_bin_run (VisBin *bin)
 
 	return 0;
 }
+
+int visual_bin_pipeline_start (VisBin *bin, int latency)
+{
+	VisBinPipeline *pipeline;
+	int i;
+
+	visual_return_val_if_fail (bin != NULL, -1);
+	visual_return_val_if_fail (bin->actor != NULL, -1);
+	visual_return_val_if_fail (bin->input != NULL, -1);
+	visual_return_val_if_fail (bin->actvideo != NULL, -1);
+	visual_return_val_if_fail (latency >= 2 && latency <= 3, -1);
+
+	if (bin->pipeline != NULL)
+		return VISUAL_OK;
+
+	if (!visual_thread_is_supported ())
+		return -VISUAL_ERROR_THREAD_NOT_SUPPORTED;
+
+	/* The GL context is bound to the thread of the caller */
+	if (bin->actvideo->depth == VISUAL_VIDEO_DEPTH_GL) {
+		visual_log (VISUAL_LOG_ERROR, _("Can't pipeline a VisBin that renders using openGL"));
+
+		return -1;
+	}
+
+	pipeline = visual_mem_new0 (VisBinPipeline, 1);
+
+	pipeline->mutex = visual_mutex_new ();
+	pipeline->cond = visual_cond_new ();
+
+	pipeline->staging = visual_audio_new ();
+	pipeline->audio = visual_audio_new ();
+
+	/* One frame for the caller, one for the render thread, and the
+	 * rest can be queued up in between */
+	pipeline->nframes = latency + 1;
+	pipeline->frames = visual_mem_new0 (VisVideo *, pipeline->nframes);
+	pipeline->states = visual_mem_new0 (BinFrameState, pipeline->nframes);
+	pipeline->serials = visual_mem_new0 (unsigned long, pipeline->nframes);
+
+	for (i = 0; i < pipeline->nframes; i++) {
+		pipeline->frames[i] = visual_video_new ();
+		pipeline->states[i] = BIN_FRAME_FREE;
+	}
+
+	/* Samples captured before the pipeline started are carried over */
+	pipeline_move_samples (pipeline->audio, bin->input->audio);
+
+	pipeline->running = TRUE;
+	bin->pipeline = pipeline;
+
+	pipeline->render_thread = visual_thread_create (pipeline_render_thread, bin, TRUE);
+	pipeline->capture_thread = visual_thread_create (pipeline_capture_thread, bin, TRUE);
+
+	if (pipeline->render_thread == NULL || pipeline->capture_thread == NULL) {
+		visual_log (VISUAL_LOG_ERROR, _("Failed to start the VisBin pipeline threads"));
+
+		visual_bin_pipeline_stop (bin);
+
+		return -1;
+	}
+
+	return VISUAL_OK;
+}
+
+int visual_bin_pipeline_stop (VisBin *bin)
+{
+	VisBinPipeline *pipeline;
+
+	visual_return_val_if_fail (bin != NULL, -1);
+
+	pipeline = bin->pipeline;
+
+	if (pipeline == NULL)
+		return VISUAL_OK;
+
+	visual_mutex_lock (pipeline->mutex);
+	pipeline->running = FALSE;
+	visual_cond_broadcast (pipeline->cond);
+	visual_mutex_unlock (pipeline->mutex);
+
+	if (pipeline->capture_thread != NULL) {
+		visual_thread_join (pipeline->capture_thread);
+		visual_thread_free (pipeline->capture_thread);
+	}
+
+	if (pipeline->render_thread != NULL) {
+		visual_thread_join (pipeline->render_thread);
+		visual_thread_free (pipeline->render_thread);
+	}
+
+	bin->pipeline = NULL;
+
+	pipeline_free (pipeline);
+
+	return VISUAL_OK;
+}
+
+int visual_bin_is_pipelined (VisBin *bin)
+{
+	visual_return_val_if_fail (bin != NULL, FALSE);
+
+	return bin->pipeline != NULL;
+}
+
+VisVideo *visual_bin_pipeline_acquire_frame (VisBin *bin)
+{
+	VisBinPipeline *pipeline;
+	VisVideo *frame = NULL;
+	int newest;
+	int i;
+
+	visual_return_val_if_fail (bin != NULL, NULL);
+	visual_return_val_if_fail (bin->pipeline != NULL, NULL);
+
+	pipeline = bin->pipeline;
+
+	visual_mutex_lock (pipeline->mutex);
+
+	while (pipeline->running) {
+		newest = -1;
+
+		for (i = 0; i < pipeline->nframes; i++) {
+			if (pipeline->states[i] != BIN_FRAME_READY)
+				continue;
+
+			if (newest < 0 || pipeline->serials[i] > pipeline->serials[newest])
+				newest = i;
+		}
+
+		if (newest >= 0) {
+			/* Drop the frames we're skipping so the render thread can reuse them */
+			for (i = 0; i < pipeline->nframes; i++) {
+				if (pipeline->states[i] == BIN_FRAME_READY)
+					pipeline->states[i] = BIN_FRAME_FREE;
+			}
+
+			pipeline->states[newest] = BIN_FRAME_ACQUIRED;
+			frame = pipeline->frames[newest];
+
+			visual_cond_broadcast (pipeline->cond);
+
+			break;
+		}
+
+		visual_cond_wait (pipeline->cond, pipeline->mutex);
+	}
+
+	visual_mutex_unlock (pipeline->mutex);
+
+	return frame;
+}
+
+int visual_bin_pipeline_release_frame (VisBin *bin, VisVideo *frame)
+{
+	VisBinPipeline *pipeline;
+	int i;
+
+	visual_return_val_if_fail (bin != NULL, -1);
+	visual_return_val_if_fail (bin->pipeline != NULL, -1);
+	visual_return_val_if_fail (frame != NULL, -1);
+
+	pipeline = bin->pipeline;
+
+	visual_mutex_lock (pipeline->mutex);
+
+	for (i = 0; i < pipeline->nframes; i++) {
+		if (pipeline->frames[i] == frame && pipeline->states[i] == BIN_FRAME_ACQUIRED) {
+			pipeline->states[i] = BIN_FRAME_FREE;
+			visual_cond_broadcast (pipeline->cond);
+
+			break;
+		}
+	}
+
+	visual_mutex_unlock (pipeline->mutex);
+
+	return i < pipeline->nframes ? VISUAL_OK : -1;
+}
+
+static void pipeline_move_samples (VisAudio *dest, VisAudio *src)
+{
+	VisListEntry *le = NULL;
+	VisAudioSamplePoolChannel *channel;
+
+	/* Empties the source rings into the matching destination channels */
+	while ((channel = visual_list_next (src->samplepool->channels, &le)) != NULL)
+		visual_audio_samplepool_input_ring (dest->samplepool, channel->samples, channel->channelid);
+}
+
+static void pipeline_publish_frame (VisBin *bin, VisBinPipeline *pipeline, int index)
+{
+	VisVideo *frame = pipeline->frames[index];
+
+	/* The frame is copied out instead of rendering into it directly, so
+	 * actors that build upon their previous frame keep working */
+	if (!visual_video_compare_attrs (frame, bin->actvideo)) {
+		visual_video_copy_attrs (frame, bin->actvideo);
+		visual_video_allocate_buffer (frame);
+	}
+
+	visual_video_blit (frame, bin->actvideo, 0, 0, FALSE);
+
+	if (frame->depth == VISUAL_VIDEO_DEPTH_8BIT)
+		visual_video_set_palette (frame, visual_bin_get_palette (bin));
+}
+
+static void *pipeline_capture_thread (void *data)
+{
+	VisBin *bin = data;
+	VisBinPipeline *pipeline = bin->pipeline;
+
+	while (TRUE) {
+		/* Captures the samples for the next frame while the current one renders */
+		visual_input_run (bin->input);
+
+		visual_mutex_lock (pipeline->mutex);
+
+		while (pipeline->running && pipeline->staged)
+			visual_cond_wait (pipeline->cond, pipeline->mutex);
+
+		if (!pipeline->running) {
+			visual_mutex_unlock (pipeline->mutex);
+
+			break;
+		}
+
+		pipeline_move_samples (pipeline->staging, bin->input->audio);
+		pipeline->staged = TRUE;
+
+		visual_cond_broadcast (pipeline->cond);
+		visual_mutex_unlock (pipeline->mutex);
+	}
+
+	return NULL;
+}
+
+static void *pipeline_render_thread (void *data)
+{
+	VisBin *bin = data;
+	VisBinPipeline *pipeline = bin->pipeline;
+	int index;
+	int i;
+
+	while (TRUE) {
+		visual_mutex_lock (pipeline->mutex);
+
+		while (pipeline->running && !pipeline->staged)
+			visual_cond_wait (pipeline->cond, pipeline->mutex);
+
+		if (!pipeline->running) {
+			visual_mutex_unlock (pipeline->mutex);
+
+			break;
+		}
+
+		pipeline_move_samples (pipeline->audio, pipeline->staging);
+		pipeline->staged = FALSE;
+
+		visual_cond_broadcast (pipeline->cond);
+		visual_mutex_unlock (pipeline->mutex);
+
+		/* Only the render thread holds on to older samples, keep them bounded */
+		visual_audio_samplepool_flush_old (pipeline->audio->samplepool);
+
+		bin_run_frame (bin, pipeline->audio);
+
+		visual_mutex_lock (pipeline->mutex);
+
+		index = -1;
+		while (pipeline->running) {
+			for (i = 0; i < pipeline->nframes; i++) {
+				if (pipeline->states[i] == BIN_FRAME_FREE) {
+					index = i;
+					break;
+				}
+			}
+
+			if (index >= 0)
+				break;
+
+			visual_cond_wait (pipeline->cond, pipeline->mutex);
+		}
+
+		if (!pipeline->running) {
+			visual_mutex_unlock (pipeline->mutex);
+
+			break;
+		}
+
+		pipeline->states[index] = BIN_FRAME_RENDERING;
+		visual_mutex_unlock (pipeline->mutex);
+
+		pipeline_publish_frame (bin, pipeline, index);
+
+		visual_mutex_lock (pipeline->mutex);
+		pipeline->states[index] = BIN_FRAME_READY;
+		pipeline->serials[index] = ++pipeline->serial;
+		visual_cond_broadcast (pipeline->cond);
+		visual_mutex_unlock (pipeline->mutex);
+	}
+
+	return NULL;
+}
+
+static void pipeline_free (VisBinPipeline *pipeline)
+{
+	int i;
+
+	for (i = 0; i < pipeline->nframes; i++)
+		visual_object_unref (VISUAL_OBJECT (pipeline->frames[i]));
+
+	visual_mem_free (pipeline->frames);
+	visual_mem_free (pipeline->states);
+	visual_mem_free (pipeline->serials);
+
+	visual_object_unref (VISUAL_OBJECT (pipeline->staging));
+	visual_object_unref (VISUAL_OBJECT (pipeline->audio));
+
+	visual_cond_free (pipeline->cond);
+	visual_mutex_free (pipeline->mutex);
+
+	visual_mem_free (pipeline);
+}
@@ -49,6 +49,13 @@ typedef enum {
 
 typedef struct _VisBin VisBin;
 
+/**
+ * Private state of a pipelined VisBin.
+ *
+ * @see visual_bin_pipeline_start
+ */
+typedef struct _VisBinPipeline VisBinPipeline;
+
 struct _VisBin {
 	VisObject	 object;
 
@@ -83,6 +90,8 @@ struct _VisBin {
 	int		 depthfromGL;		/* Set when switching away from openGL */
 	int		 depthforced;		/* Contains forced depth value, for the actmorph so we've got smooth transformations */
 	int		 depthforcedmain;	/* Contains forced depth value, for the main actor */
+
+	VisBinPipeline	*pipeline;		/* Capture and render threads, NULL when not pipelined */
 };
 
 LV_BEGIN_DECLS
@@ -129,6 +138,96 @@ LV_API int visual_bin_switch_set_time (VisBin *bin, long sec, long usec);
 
 LV_API int visual_bin_run (VisBin *bin);
 
+/**
+ * Runs the VisBin like visual_bin_run, but delivers the frame into a
+ * caller owned VisVideo, such as a locked window or bitmap buffer.
+ *
+ * When the destination has the same depth, dimension and pitch as the
+ * bin its video, the actor renders straight into the destination
+ * buffer and no copy or depth conversion takes place. Otherwise the
+ * frame is rendered as usual and converted into the destination.
+ *
+ * Actors may build upon their previous frame, so for the direct path
+ * the destination buffer should keep its contents between frames,
+ * which is the case when the same bitmap or buffer is reused.
+ *
+ * @param bin Pointer to the VisBin to run.
+ * @param dest Pointer to the VisVideo the frame is delivered into.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+LV_API int visual_bin_run_to_video (VisBin *bin, VisVideo *dest);
+
+/**
+ * Splits the work of visual_bin_run over a capture thread and a
+ * render thread, so that audio capture, rendering and the output
+ * stage of the caller overlap instead of running back to back.
+ *
+ * The capture thread runs the VisInput and hands the new samples to
+ * the render thread, which runs the actor (and morph) and publishes
+ * a copy of the bin its video into one of a small ring of frames.
+ * The caller picks up finished frames using
+ * visual_bin_pipeline_acquire_frame and hands them back using
+ * visual_bin_pipeline_release_frame, instead of calling
+ * visual_bin_run.
+ *
+ * The bin must be fully connected, synced and have its video set up
+ * before the pipeline is started. While the pipeline is running the
+ * actor, input, morph and video of the bin are owned by the pipeline
+ * threads; to switch actors, sync or change the video, stop the
+ * pipeline first and restart it afterwards.
+ *
+ * @param bin Pointer to the VisBin to pipeline.
+ * @param latency The number of frames in flight, 2 or 3. A higher value
+ *	smooths out frame time jitter at the cost of one frame of latency.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_THREAD_NOT_SUPPORTED when
+ *	libvisual is built without thread support, or -1 on other failures.
+ */
+LV_API int visual_bin_pipeline_start (VisBin *bin, int latency);
+
+/**
+ * Stops the pipeline threads of a VisBin and returns it to the serial
+ * visual_bin_run mode. Frames that are still acquired become invalid.
+ *
+ * @param bin Pointer to the VisBin that is pipelined.
+ *
+ * @return VISUAL_OK on success, -1 on failure.
+ */
+LV_API int visual_bin_pipeline_stop (VisBin *bin);
+
+/**
+ * Checks if a VisBin is running in pipelined mode.
+ *
+ * @param bin Pointer to the VisBin.
+ *
+ * @return TRUE if pipelined, FALSE if not.
+ */
+LV_API int visual_bin_is_pipelined (VisBin *bin);
+
+/**
+ * Gets the most recently rendered frame of a pipelined VisBin, blocking
+ * until one is available. Older frames that were never acquired are
+ * dropped to keep the latency down.
+ *
+ * @param bin Pointer to the pipelined VisBin.
+ *
+ * @return The frame, which has the attributes of the bin its video, or
+ *	NULL when the pipeline is not running.
+ */
+LV_API VisVideo *visual_bin_pipeline_acquire_frame (VisBin *bin);
+
+/**
+ * Hands a frame obtained using visual_bin_pipeline_acquire_frame back
+ * to the render thread.
+ *
+ * @param bin Pointer to the pipelined VisBin.
+ * @param frame Pointer to the acquired frame.
+ *
+ * @return VISUAL_OK on success, -1 on failure.
+ */
+LV_API int visual_bin_pipeline_release_frame (VisBin *bin, VisVideo *frame);
+
 LV_END_DECLS
 
 /**
@@ -80,6 +80,7 @@ static int __lv_cpu_initialized = FALSE;
 #if defined(VISUAL_ARCH_X86) || defined(VISUAL_ARCH_X86_64)
 static int has_cpuid (void);
 static int cpuid (unsigned int ax, unsigned int *p);
+static unsigned int xgetbv_low (void);
 #endif
 
 #if defined(VISUAL_OS_WIN32)
@@ -328,10 +329,23 @@ static int cpuid (unsigned int ax, unsigned int *p)
 		 "xchgl %%ebx, %%esi"
 		 : "=a" (p[0]), "=S" (p[1]),
 		 "=c" (p[2]), "=d" (p[3])
-		 : "0" (ax));
+		 : "0" (ax), "2" (0));
 
 	return VISUAL_OK;
 }
+
+/* Low word of XCR0, tells which register states the OS saves */
+static unsigned int xgetbv_low (void)
+{
+	unsigned int eax, edx;
+
+	__asm __volatile
+		(".byte 0x0f, 0x01, 0xd0"
+		 : "=a" (eax), "=d" (edx)
+		 : "c" (0));
+
+	return eax;
+}
 #endif
 
 static int get_number_of_cores (void)
@@ -415,6 +429,8 @@ static void print_cpu_info (void)
 	visual_log (VISUAL_LOG_DEBUG, "CPU: MMX2 %d", __lv_cpu_caps.hasMMX2);
 	visual_log (VISUAL_LOG_DEBUG, "CPU: SSE %d", __lv_cpu_caps.hasSSE);
 	visual_log (VISUAL_LOG_DEBUG, "CPU: SSE2 %d", __lv_cpu_caps.hasSSE2);
+	visual_log (VISUAL_LOG_DEBUG, "CPU: SSSE3 %d", __lv_cpu_caps.hasSSSE3);
+	visual_log (VISUAL_LOG_DEBUG, "CPU: AVX2 %d", __lv_cpu_caps.hasAVX2);
 	visual_log (VISUAL_LOG_DEBUG, "CPU: 3DNow %d", __lv_cpu_caps.has3DNow);
 	visual_log (VISUAL_LOG_DEBUG, "CPU: 3DNowExt %d", __lv_cpu_caps.has3DNowExt);
 #elif defined(VISUAL_ARCH_POWERPC)
@@ -480,11 +496,21 @@ void visual_cpu_initialize ()
 		__lv_cpu_caps.hasMMX  = TEST_BIT (regs2[3], 23); /* 0x0800000 */
 		__lv_cpu_caps.hasSSE  = TEST_BIT (regs2[3], 25); /* 0x2000000 */
 		__lv_cpu_caps.hasSSE2 = TEST_BIT (regs2[3], 26); /* 0x4000000 */
+		__lv_cpu_caps.hasSSSE3 = TEST_BIT (regs2[2], 9); /* 0x200 */
 		__lv_cpu_caps.hasMMX2 = __lv_cpu_caps.hasSSE; /* SSE cpus supports mmxext too */
 
 		cacheline = ((regs2[1] >> 8) & 0xFF) * 8;
 		if (cacheline > 0)
 			__lv_cpu_caps.cacheline = cacheline;
+
+		/* AVX2 also needs the OS to save the ymm registers (OSXSAVE, AVX, XCR0) */
+		if (regs[0] >= 0x00000007 && TEST_BIT (regs2[2], 27) && TEST_BIT (regs2[2], 28)
+				&& (xgetbv_low () & 0x6) == 0x6) {
+			unsigned int regs7[4];
+
+			cpuid (0x00000007, regs7);
+			__lv_cpu_caps.hasAVX2 = TEST_BIT (regs7[1], 5); /* 0x20 */
+		}
 	}
 
 	cpuid (0x80000000, regs);
@@ -508,8 +534,11 @@ void visual_cpu_initialize ()
 	if (__lv_cpu_caps.hasSSE)
 		check_os_katmai_support ();
 
-	if (!__lv_cpu_caps.hasSSE)
+	if (!__lv_cpu_caps.hasSSE) {
 		__lv_cpu_caps.hasSSE2 = 0;
+		__lv_cpu_caps.hasSSSE3 = 0;
+		__lv_cpu_caps.hasAVX2 = 0;
+	}
 #endif
 
 #endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
@@ -562,6 +591,22 @@ int visual_cpu_has_sse2 ()
 	return __lv_cpu_caps.hasSSE2;
 }
 
+int visual_cpu_has_ssse3 ()
+{
+	if (!__lv_cpu_initialized)
+		visual_log (VISUAL_LOG_ERROR, _("The VisCPU system is not initialized."));
+
+	return __lv_cpu_caps.hasSSSE3;
+}
+
+int visual_cpu_has_avx2 ()
+{
+	if (!__lv_cpu_initialized)
+		visual_log (VISUAL_LOG_ERROR, _("The VisCPU system is not initialized."));
+
+	return __lv_cpu_caps.hasAVX2;
+}
+
 int visual_cpu_has_3dnow ()
 {
 	if (!__lv_cpu_initialized)
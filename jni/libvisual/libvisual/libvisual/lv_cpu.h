@@ -65,6 +65,8 @@ struct _VisCPU {
 	int		hasMMX2;		/**< The CPU has the mmx2 feature. */
 	int		hasSSE;			/**< The CPU has the sse feature. */
 	int		hasSSE2;		/**< The CPU has the sse2 feature. */
+	int		hasSSSE3;		/**< The CPU has the ssse3 feature. */
+	int		hasAVX2;		/**< The CPU and OS support the avx2 feature. */
 	int		has3DNow;		/**< The CPU has the 3dnow feature. */
 	int		has3DNowExt;		/**< The CPU has the 3dnowext feature. */
 	int		hasAltiVec;     /**< The CPU has the altivec feature. */
@@ -120,6 +122,20 @@ LV_API int visual_cpu_has_sse (void);
  */
 LV_API int visual_cpu_has_sse2 (void);
 
+/**
+ * Function to retrieve if the SSSE3 CPU feature is enabled.
+ *
+ * @return Whether SSSE3 is enabled or not.
+ */
+LV_API int visual_cpu_has_ssse3 (void);
+
+/**
+ * Function to retrieve if the AVX2 CPU feature is enabled.
+ *
+ * @return Whether AVX2 is enabled or not.
+ */
+LV_API int visual_cpu_has_avx2 (void);
+
 /**
  * Function to retrieve if the 3dnow CPU feature is enabled.
  *
@@ -47,6 +47,8 @@ static const char *__lv_error_human_readable[] = {
 	[VISUAL_ERROR_AUDIO_SAMPLEPOOL_NULL] =		N_("The VisAudioSamplePool is NULL"),
 	[VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL] =	N_("The VisAudioSamplePoolChannel is NULL"),
 	[VISUAL_ERROR_AUDIO_SAMPLE_NULL] =		N_("The VisAudioSample is NULL"),
+	[VISUAL_ERROR_AUDIO_RING_NULL] =		N_("The VisAudioRing is NULL"),
+	[VISUAL_ERROR_AUDIO_RING_INVALID_SIZE] =	N_("The VisAudioRing size is not a power of two"),
 
 	[VISUAL_ERROR_BMP_NO_BMP] =			N_("Bitmap is not a bitmap file"),
 	[VISUAL_ERROR_BMP_NOT_FOUND] =			N_("Bitmap can not be found"),
@@ -114,6 +116,9 @@ static const char *__lv_error_human_readable[] = {
 	[VISUAL_ERROR_RECTANGLE_NULL] =			N_("VisRectangle is NULL"),
 	[VISUAL_ERROR_RECTANGLE_OUT_OF_BOUNDS] =	N_("The VisRectangle operation is out of bounds"),
 
+	[VISUAL_ERROR_REMAP_NULL] =			N_("VisRemap is NULL"),
+	[VISUAL_ERROR_REMAP_OUT_OF_BOUNDS] =		N_("The pixel or tap is outside the VisRemap"),
+
 	[VISUAL_ERROR_RINGBUFFER_NULL] =		N_("The VisRingBuffer is NULL"),
 	[VISUAL_ERROR_RINGBUFFER_ENTRY_NULL] =		N_("The VisRingBufferEntry is NULL"),
 	[VISUAL_ERROR_RINGBUFFER_DATAFUNC_NULL] =	N_("The VisRingBufferDataFunc data provider function callback is NULL"),
@@ -129,6 +134,9 @@ static const char *__lv_error_human_readable[] = {
 	[VISUAL_ERROR_MUTEX_LOCK_FAILURE] =		N_("VisMutex lock failed"),
 	[VISUAL_ERROR_MUTEX_TRYLOCK_FAILURE] =		N_("VisMutex trylock failed"),
 	[VISUAL_ERROR_MUTEX_UNLOCK_FAILURE] =		N_("VisMutex unlock failed"),
+	[VISUAL_ERROR_COND_NULL] =			N_("VisCond is NULL"),
+	[VISUAL_ERROR_COND_WAIT_FAILURE] =		N_("VisCond wait failed"),
+	[VISUAL_ERROR_WORKER_POOL_NULL] =		N_("VisWorkerPool is NULL"),
 
 	[VISUAL_ERROR_TRANSFORM_NULL] =			N_("VisTransform is NULL"),
 	[VISUAL_ERROR_TRANSFORM_NEGOTIATE] =		N_("The VisTransform negotiate with the target VisVideo failed"),
@@ -57,6 +57,8 @@ enum {
 	VISUAL_ERROR_AUDIO_SAMPLEPOOL_NULL,		/**< The VisAudioSamplePool is NULL. */
 	VISUAL_ERROR_AUDIO_SAMPLEPOOL_CHANNEL_NULL,	/**< The VisAudioSamplePoolChannel is NULL. */
 	VISUAL_ERROR_AUDIO_SAMPLE_NULL,			/**< The VisAudioSample is NULL. */
+	VISUAL_ERROR_AUDIO_RING_NULL,			/**< The VisAudioRing is NULL. */
+	VISUAL_ERROR_AUDIO_RING_INVALID_SIZE,		/**< The VisAudioRing size is not a power of two. */
 
 	/* Error entries for the VisBMP system */
 	VISUAL_ERROR_BMP_NO_BMP,			/**< Not a bitmap file. */
@@ -142,6 +144,10 @@ enum {
 	VISUAL_ERROR_RECTANGLE_NULL,			/**< The VisRectangle is NULL. */
 	VISUAL_ERROR_RECTANGLE_OUT_OF_BOUNDS,		/**< The VisRectangle operation is out of bounds. */
 
+	/* Error entries for the VisRemap system */
+	VISUAL_ERROR_REMAP_NULL,			/**< The VisRemap is NULL. */
+	VISUAL_ERROR_REMAP_OUT_OF_BOUNDS,		/**< The pixel or tap is outside the VisRemap. */
+
 	/* Error entries for the VisRingBuffer system */
 	VISUAL_ERROR_RINGBUFFER_NULL,			/**< The VisRingBuffer is NULL. */
 	VISUAL_ERROR_RINGBUFFER_ENTRY_NULL,		/**< The VisRingBufferEntry is NULL. */
@@ -159,6 +165,9 @@ enum {
 	VISUAL_ERROR_MUTEX_LOCK_FAILURE,		/**< Failed locking the VisMutex. */
 	VISUAL_ERROR_MUTEX_TRYLOCK_FAILURE,		/**< Failed trylocking the VisMutex. */
 	VISUAL_ERROR_MUTEX_UNLOCK_FAILURE,		/**< Failed unlocking the VisMutex. */
+	VISUAL_ERROR_COND_NULL,				/**< The VisCond is NULL. */
+	VISUAL_ERROR_COND_WAIT_FAILURE,			/**< Failed waiting on the VisCond. */
+	VISUAL_ERROR_WORKER_POOL_NULL,			/**< The VisWorkerPool is NULL. */
 
 	/* Error entries for the VisTransform system */
 	VISUAL_ERROR_TRANSFORM_NULL,			/**< The VisTransform is NULL. */
@@ -29,10 +29,14 @@
 #include "lv_fourier.h"
 #include "lv_common.h"
 #include "lv_math.h"
+#include "lv_cpu.h"
+#include "lv_thread.h"
+#include "private/lv_simd.h"
 #include <cmath>
 #include <vector>
 #include <map>
 #include <utility>
+#include <algorithm>
 
 // Log scale settings
 #define AMP_LOG_SCALE_THRESHOLD0    0.001f
@@ -48,47 +52,71 @@ namespace LV {
         DFT_METHOD_FFT
     };
 
-    class DFTCache
+    // Precomputed tables for one transform size. Plans never change once
+    // built, so any number of DFTs in any thread can share them.
+    //
+    // A real FFT of size N is done as a complex FFT of size M = N/2 over
+    // z[n] = x[2n] + i x[2n+1], followed by a split step that separates
+    // the spectra of the even and odd samples again.
+    class DFTPlan
     {
     public:
 
-        class Entry
-        {
-        public:
+        DFTMethod method;
+        unsigned int sample_count;
 
-            std::vector<float> bitrevtable;
-            std::vector<float> sintable;
-            std::vector<float> costable;
+        // FFT: input permutation of the size M complex FFT
+        std::vector<unsigned int> bitrevtable;
 
-            // FIXME: Eliminate this constructor
-            Entry () {}
+        // FFT: W_2h^k for k < h, stage h starting at offset h - 1
+        std::vector<float> twiddle_real;
+        std::vector<float> twiddle_imag;
 
-            Entry (DFTMethod method, unsigned int sample_count);
+        // FFT: W_N^k for k <= M, used by the split step
+        std::vector<float> split_real;
+        std::vector<float> split_imag;
 
-        private:
+        // Brute force: W_N^k for k < N
+        std::vector<float> costable;
+        std::vector<float> sintable;
 
-            void fft_bitrev_table_init (unsigned int sample_count);
-            void fft_cossin_table_init (unsigned int sample_count);
-            void dft_cossin_table_init (unsigned int sample_count);
-        };
+        DFTPlan (unsigned int sample_count);
 
-        Entry const& get_entry (DFTMethod method, unsigned int sample_count);
+        float const* twiddle_real_for_stage (unsigned int h) const { return &twiddle_real[h - 1]; }
+        float const* twiddle_imag_for_stage (unsigned int h) const { return &twiddle_imag[h - 1]; }
 
     private:
 
-        typedef std::map<unsigned int, Entry> Table;
-
-        Table m_cache;
+        void fft_bitrev_table_init (unsigned int size);
+        void fft_twiddle_table_init (unsigned int size);
+        void fft_split_table_init (unsigned int sample_count);
+        void dft_cossin_table_init (unsigned int sample_count);
     };
 
-    DFTCache dft_cache;
+    DFTMethod best_method (unsigned int sample_count)
+    {
+        if (sample_count >= 2 && visual_math_is_power_of_2 (sample_count))
+            return DFT_METHOD_FFT;
+        else
+            return DFT_METHOD_BRUTE_FORCE;
+    }
 
   } // anonymous namespace
 
 
   class Fourier::Impl
   {
-      // nothing for now
+  public:
+
+      typedef std::map<unsigned int, DFTPlan*> PlanTable;
+
+      PlanTable plans;
+      VisMutex* plans_mutex;
+
+      Impl ();
+      ~Impl ();
+
+      DFTPlan const* get_plan (unsigned int sample_count);
   };
 
   class DFT::Impl
@@ -98,33 +126,26 @@ namespace LV {
       unsigned int       spectrum_size;
       unsigned int       samples_out;
       DFTMethod          method;
+      DFTPlan const*     plan;
+      ScopedPtr<DFTPlan> own_plan;
       std::vector<float> real;
       std::vector<float> imag;
 
-      Impl (unsigned int samples_out, unsigned int samples_in);
+      void (*fft_func) (DFTPlan const& plan, float* output, float const* input,
+                        float* re, float* im, unsigned int samples_out);
 
-      void perform_brute_force (float const* input);
-      void perform_fft_radix2_dit (float const* input);
+      Impl (unsigned int samples_out, unsigned int samples_in);
 
-      DFTMethod best_method (unsigned int sample_count);
+      void perform_brute_force (float* output, float const* input);
+      void perform_fft (float* output, float const* input);
   };
 
 
   namespace {
 
-    DFTCache::Entry const& DFTCache::get_entry (DFTMethod method, unsigned int sample_count)
-    {
-        Table::const_iterator entry = m_cache.find (sample_count);
-        if (entry != m_cache.end ())
-            return entry->second;
-
-        // FIXME: Eliminate the copying
-        m_cache.insert (std::make_pair (sample_count, Entry (method, sample_count)));
-
-        return m_cache[sample_count];
-    }
-
-    DFTCache::Entry::Entry (DFTMethod method, unsigned int sample_count)
+    DFTPlan::DFTPlan (unsigned int sample_count_)
+        : method       (best_method (sample_count_)),
+          sample_count (sample_count_)
     {
         switch (method) {
             case DFT_METHOD_BRUTE_FORCE:
@@ -132,28 +153,28 @@ namespace LV {
                 break;
 
             case DFT_METHOD_FFT:
-                fft_bitrev_table_init (sample_count);
-                fft_cossin_table_init (sample_count);
+                fft_bitrev_table_init (sample_count / 2);
+                fft_twiddle_table_init (sample_count / 2);
+                fft_split_table_init (sample_count);
                 break;
         }
     }
 
-    void DFTCache::Entry::fft_bitrev_table_init (unsigned int sample_count)
+    void DFTPlan::fft_bitrev_table_init (unsigned int size)
     {
-        bitrevtable.clear ();
-        bitrevtable.reserve (sample_count);
+        bitrevtable.resize (size);
 
-        for (unsigned int i = 0; i < sample_count; i++)
-            bitrevtable.push_back (i);
+        for (unsigned int i = 0; i < size; i++)
+            bitrevtable[i] = i;
 
         unsigned int j = 0;
 
-        for (unsigned int i = 0; i < sample_count; i++) {
+        for (unsigned int i = 0; i < size; i++) {
             if (j > i) {
                 std::swap (bitrevtable[i], bitrevtable[j]);
             }
 
-            unsigned int m = sample_count >> 1;
+            unsigned int m = size >> 1;
 
             while (m >= 1 && j >= m) {
                 j -= m;
@@ -164,35 +185,38 @@ namespace LV {
         }
     }
 
-    void DFTCache::Entry::fft_cossin_table_init (unsigned int sample_count)
+    void DFTPlan::fft_twiddle_table_init (unsigned int size)
     {
-        unsigned int dft_size = 2;
-        unsigned int tab_size = 0;
+        // Stages h = 1, 2, 4, .. size/2 take h entries each
+        twiddle_real.resize (size > 1 ? size - 1 : 1);
+        twiddle_imag.resize (size > 1 ? size - 1 : 1);
 
-        while (dft_size <= sample_count) {
-            tab_size++;
-            dft_size <<= 1;
-        }
-
-        sintable.clear ();
-        sintable.reserve (tab_size);
+        for (unsigned int h = 1; h < size; h <<= 1) {
+            for (unsigned int k = 0; k < h; k++) {
+                double theta = -VISUAL_MATH_PI * double (k) / h;
 
-        costable.clear ();
-        costable.reserve (tab_size);
+                twiddle_real[h - 1 + k] = std::cos (theta);
+                twiddle_imag[h - 1 + k] = std::sin (theta);
+            }
+        }
+    }
 
-        dft_size = 2;
+    void DFTPlan::fft_split_table_init (unsigned int sample_count)
+    {
+        unsigned int size = sample_count / 2 + 1;
 
-        while (dft_size <= sample_count) {
-            float theta = -2.0f * VISUAL_MATH_PI / dft_size;
+        split_real.resize (size);
+        split_imag.resize (size);
 
-            costable.push_back (std::cos (theta));
-            sintable.push_back (std::sin (theta));
+        for (unsigned int k = 0; k < size; k++) {
+            double theta = -2.0 * VISUAL_MATH_PI * double (k) / sample_count;
 
-            dft_size <<= 1;
+            split_real[k] = std::cos (theta);
+            split_imag[k] = std::sin (theta);
         }
     }
 
-    void DFTCache::Entry::dft_cossin_table_init (unsigned int sample_count)
+    void DFTPlan::dft_cossin_table_init (unsigned int sample_count)
     {
         sintable.clear ();
         sintable.reserve (sample_count);
@@ -208,6 +232,309 @@ namespace LV {
         }
     }
 
+    // Butterflies are written once against these small vector types and
+    // instantiated for plain floats, SSE2 and NEON.
+
+    struct ScalarOps
+    {
+        typedef float V;
+        static const unsigned int width = 1;
+
+        static V load (float const* p)     { return *p; }
+        static void store (float* p, V v)  { *p = v; }
+        static V set (float x)             { return x; }
+        static V add (V a, V b)            { return a + b; }
+        static V sub (V a, V b)            { return a - b; }
+        static V mul (V a, V b)            { return a * b; }
+        static V neg (V a)                 { return -a; }
+        static V reverse (V a)             { return a; }
+        static V sqrt (V a)                { return std::sqrt (a); }
+    };
+
+#if defined(VISUAL_HAVE_SSE2)
+
+    struct SSE2Ops
+    {
+        typedef __m128 V;
+        static const unsigned int width = 4;
+
+        static V load (float const* p)     { return _mm_loadu_ps (p); }
+        static void store (float* p, V v)  { _mm_storeu_ps (p, v); }
+        static V set (float x)             { return _mm_set1_ps (x); }
+        static V add (V a, V b)            { return _mm_add_ps (a, b); }
+        static V sub (V a, V b)            { return _mm_sub_ps (a, b); }
+        static V mul (V a, V b)            { return _mm_mul_ps (a, b); }
+        static V neg (V a)                 { return _mm_sub_ps (_mm_setzero_ps (), a); }
+        static V reverse (V a)             { return _mm_shuffle_ps (a, a, _MM_SHUFFLE (0, 1, 2, 3)); }
+        static V sqrt (V a)                { return _mm_sqrt_ps (a); }
+    };
+
+#endif
+
+#if defined(VISUAL_HAVE_NEON)
+
+    struct NEONOps
+    {
+        typedef float32x4_t V;
+        static const unsigned int width = 4;
+
+        static V load (float const* p)     { return vld1q_f32 (p); }
+        static void store (float* p, V v)  { vst1q_f32 (p, v); }
+        static V set (float x)             { return vdupq_n_f32 (x); }
+        static V add (V a, V b)            { return vaddq_f32 (a, b); }
+        static V sub (V a, V b)            { return vsubq_f32 (a, b); }
+        static V mul (V a, V b)            { return vmulq_f32 (a, b); }
+        static V neg (V a)                 { return vnegq_f32 (a); }
+
+        static V reverse (V a)
+        {
+            float32x4_t r = vrev64q_f32 (a);
+            return vcombine_f32 (vget_high_f32 (r), vget_low_f32 (r));
+        }
+
+        static V sqrt (V a)
+        {
+#if defined(__aarch64__)
+            return vsqrtq_f32 (a);
+#else
+            // sqrt (a) = a / sqrt (a), refined twice. The clamp keeps
+            // a = 0 from turning into 0 * inf.
+            float32x4_t r = vrsqrteq_f32 (vmaxq_f32 (a, vdupq_n_f32 (1e-30f)));
+            r = vmulq_f32 (r, vrsqrtsq_f32 (vmulq_f32 (a, r), r));
+            r = vmulq_f32 (r, vrsqrtsq_f32 (vmulq_f32 (a, r), r));
+            return vmulq_f32 (a, r);
+#endif
+        }
+    };
+
+#endif
+
+    // One radix-2 DIT stage, pairs h apart
+    template <class Ops>
+    void fft_radix2_pass (float* re, float* im, unsigned int size, unsigned int h,
+                          float const* wr, float const* wi)
+    {
+        typedef typename Ops::V V;
+
+        for (unsigned int base = 0; base < size; base += 2 * h) {
+            float* r0 = re + base;
+            float* i0 = im + base;
+            float* r1 = r0 + h;
+            float* i1 = i0 + h;
+
+            for (unsigned int k = 0; k < h; k += Ops::width) {
+                V ar = Ops::load (wr + k);
+                V ai = Ops::load (wi + k);
+
+                V x1r = Ops::load (r1 + k);
+                V x1i = Ops::load (i1 + k);
+
+                V tr = Ops::sub (Ops::mul (x1r, ar), Ops::mul (x1i, ai));
+                V ti = Ops::add (Ops::mul (x1r, ai), Ops::mul (x1i, ar));
+
+                V x0r = Ops::load (r0 + k);
+                V x0i = Ops::load (i0 + k);
+
+                Ops::store (r1 + k, Ops::sub (x0r, tr));
+                Ops::store (i1 + k, Ops::sub (x0i, ti));
+                Ops::store (r0 + k, Ops::add (x0r, tr));
+                Ops::store (i0 + k, Ops::add (x0i, ti));
+            }
+        }
+    }
+
+    // Two radix-2 DIT stages (h and 2h) fused into a radix-4 pass, which
+    // halves the number of sweeps over the data
+    template <class Ops>
+    void fft_radix4_pass (float* re, float* im, unsigned int size, unsigned int h,
+                          float const* w1r, float const* w1i,
+                          float const* w2r, float const* w2i)
+    {
+        typedef typename Ops::V V;
+
+        for (unsigned int base = 0; base < size; base += 4 * h) {
+            float* r0 = re + base;
+            float* i0 = im + base;
+            float* r1 = r0 + h;
+            float* i1 = i0 + h;
+            float* r2 = r1 + h;
+            float* i2 = i1 + h;
+            float* r3 = r2 + h;
+            float* i3 = i2 + h;
+
+            for (unsigned int k = 0; k < h; k += Ops::width) {
+                V ar = Ops::load (w1r + k);
+                V ai = Ops::load (w1i + k);
+                V br = Ops::load (w2r + k);
+                V bi = Ops::load (w2i + k);
+
+                V x0r = Ops::load (r0 + k);
+                V x0i = Ops::load (i0 + k);
+                V x1r = Ops::load (r1 + k);
+                V x1i = Ops::load (i1 + k);
+                V x2r = Ops::load (r2 + k);
+                V x2i = Ops::load (i2 + k);
+                V x3r = Ops::load (r3 + k);
+                V x3i = Ops::load (i3 + k);
+
+                // First stage, W_2h^k
+                V t1r = Ops::sub (Ops::mul (x1r, ar), Ops::mul (x1i, ai));
+                V t1i = Ops::add (Ops::mul (x1r, ai), Ops::mul (x1i, ar));
+                V t3r = Ops::sub (Ops::mul (x3r, ar), Ops::mul (x3i, ai));
+                V t3i = Ops::add (Ops::mul (x3r, ai), Ops::mul (x3i, ar));
+
+                V y0r = Ops::add (x0r, t1r);
+                V y0i = Ops::add (x0i, t1i);
+                V y1r = Ops::sub (x0r, t1r);
+                V y1i = Ops::sub (x0i, t1i);
+                V y2r = Ops::add (x2r, t3r);
+                V y2i = Ops::add (x2i, t3i);
+                V y3r = Ops::sub (x2r, t3r);
+                V y3i = Ops::sub (x2i, t3i);
+
+                // Second stage, W_4h^k and W_4h^(k+h) = -i W_4h^k
+                V u2r = Ops::sub (Ops::mul (y2r, br), Ops::mul (y2i, bi));
+                V u2i = Ops::add (Ops::mul (y2r, bi), Ops::mul (y2i, br));
+                V u3r = Ops::add (Ops::mul (y3r, bi), Ops::mul (y3i, br));
+                V u3i = Ops::neg (Ops::sub (Ops::mul (y3r, br), Ops::mul (y3i, bi)));
+
+                Ops::store (r0 + k, Ops::add (y0r, u2r));
+                Ops::store (i0 + k, Ops::add (y0i, u2i));
+                Ops::store (r2 + k, Ops::sub (y0r, u2r));
+                Ops::store (i2 + k, Ops::sub (y0i, u2i));
+                Ops::store (r1 + k, Ops::add (y1r, u3r));
+                Ops::store (i1 + k, Ops::add (y1i, u3i));
+                Ops::store (r3 + k, Ops::sub (y1r, u3r));
+                Ops::store (i3 + k, Ops::sub (y1i, u3i));
+            }
+        }
+    }
+
+    // The first two stages have trivial twiddles (1 and -i) and too few
+    // points per butterfly group to vectorize
+    void fft_first_pass (float* re, float* im, unsigned int size)
+    {
+        if (size == 2) {
+            float r = re[1];
+            float i = im[1];
+
+            re[1] = re[0] - r;
+            im[1] = im[0] - i;
+            re[0] += r;
+            im[0] += i;
+
+            return;
+        }
+
+        for (unsigned int base = 0; base < size; base += 4) {
+            float* r = re + base;
+            float* i = im + base;
+
+            float y0r = r[0] + r[1], y0i = i[0] + i[1];
+            float y1r = r[0] - r[1], y1i = i[0] - i[1];
+            float y2r = r[2] + r[3], y2i = i[2] + i[3];
+            float y3r = r[2] - r[3], y3i = i[2] - i[3];
+
+            r[0] = y0r + y2r;  i[0] = y0i + y2i;
+            r[2] = y0r - y2r;  i[2] = y0i - y2i;
+            r[1] = y1r + y3i;  i[1] = y1i - y3r;
+            r[3] = y1r - y3i;  i[3] = y1i + y3r;
+        }
+    }
+
+    template <class Ops>
+    void fft_complex (DFTPlan const& plan, float* re, float* im, unsigned int size)
+    {
+        if (size < 2)
+            return;
+
+        fft_first_pass (re, im, size);
+
+        unsigned int h = 4;
+
+        while (h < size) {
+            if (4 * h <= size) {
+                fft_radix4_pass<Ops> (re, im, size, h,
+                                      plan.twiddle_real_for_stage (h), plan.twiddle_imag_for_stage (h),
+                                      plan.twiddle_real_for_stage (2 * h), plan.twiddle_imag_for_stage (2 * h));
+                h <<= 2;
+            } else {
+                fft_radix2_pass<Ops> (re, im, size, h,
+                                      plan.twiddle_real_for_stage (h), plan.twiddle_imag_for_stage (h));
+                h <<= 1;
+            }
+        }
+    }
+
+    // Turns bins [begin, end) of the packed complex FFT Z into amplitudes
+    // of the real input:
+    //
+    //   X[k] = E + W_N^k O,  E = (Z[k] + Z*[M-k]) / 2,  O = (Z[k] - Z*[M-k]) / 2i
+    template <class Ops>
+    unsigned int fft_split (DFTPlan const& plan, float* output, float const* re, float const* im,
+                            unsigned int size, unsigned int begin, unsigned int end, float scale)
+    {
+        typedef typename Ops::V V;
+
+        V const half = Ops::set (0.5f);
+        V const vscale = Ops::set (scale);
+
+        unsigned int k = begin;
+
+        for (; k + Ops::width <= end; k += Ops::width) {
+            unsigned int mirror = size - k - (Ops::width - 1);
+
+            V zr = Ops::load (re + k);
+            V zi = Ops::load (im + k);
+            V cr = Ops::reverse (Ops::load (re + mirror));
+            V ci = Ops::reverse (Ops::load (im + mirror));
+
+            V er = Ops::mul (Ops::add (zr, cr), half);
+            V ei = Ops::mul (Ops::sub (zi, ci), half);
+            V orr = Ops::mul (Ops::add (zi, ci), half);
+            V oi = Ops::mul (Ops::sub (cr, zr), half);
+
+            V wr = Ops::load (&plan.split_real[k]);
+            V wi = Ops::load (&plan.split_imag[k]);
+
+            V xr = Ops::add (er, Ops::sub (Ops::mul (wr, orr), Ops::mul (wi, oi)));
+            V xi = Ops::add (ei, Ops::add (Ops::mul (wr, oi), Ops::mul (wi, orr)));
+
+            Ops::store (output + k, Ops::mul (Ops::sqrt (Ops::add (Ops::mul (xr, xr), Ops::mul (xi, xi))), vscale));
+        }
+
+        return k;
+    }
+
+    template <class Ops>
+    void fft_perform (DFTPlan const& plan, float* output, float const* input,
+                      float* re, float* im, unsigned int samples_out)
+    {
+        unsigned int size = plan.sample_count / 2;
+        float scale = 1.0f / plan.sample_count;
+
+        // Even samples go into the real, odd samples into the imaginary part
+        for (unsigned int i = 0; i < size; i++) {
+            unsigned int idx = plan.bitrevtable[i];
+
+            re[i] = input[2 * idx];
+            im[i] = input[2 * idx + 1];
+        }
+
+        fft_complex<Ops> (plan, re, im, size);
+
+        // Bins 0 and M are real and need no split
+        output[0] = std::fabs (re[0] + im[0]) * scale;
+
+        if (samples_out > size)
+            output[size] = std::fabs (re[0] - im[0]) * scale;
+
+        unsigned int end = std::min (samples_out, size);
+
+        unsigned int k = fft_split<Ops> (plan, output, re, im, size, 1, end, scale);
+        fft_split<ScalarOps> (plan, output, re, im, size, k, end, scale);
+    }
+
   } // anonymous namespace
 
   template <>
@@ -230,10 +557,51 @@ namespace LV {
       // empty
   }
 
+  Fourier::Impl::Impl ()
+      : plans_mutex (0)
+  {
+      if (visual_thread_is_supported ())
+          plans_mutex = visual_mutex_new ();
+  }
+
+  Fourier::Impl::~Impl ()
+  {
+      for (PlanTable::iterator plan = plans.begin (); plan != plans.end (); ++plan)
+          delete plan->second;
+
+      if (plans_mutex)
+          visual_mutex_free (plans_mutex);
+  }
+
+  DFTPlan const* Fourier::Impl::get_plan (unsigned int sample_count)
+  {
+      if (plans_mutex)
+          visual_mutex_lock (plans_mutex);
+
+      DFTPlan*& plan = plans[sample_count];
+
+      if (!plan)
+          plan = new DFTPlan (sample_count);
+
+      if (plans_mutex)
+          visual_mutex_unlock (plans_mutex);
+
+      return plan;
+  }
+
   DFT::DFT (unsigned int samples_out, unsigned int samples_in)
       : m_impl (new Impl (samples_out, samples_in))
   {
-      // empty
+      Fourier* fourier = Fourier::instance ();
+
+      // Plans are shared through the Fourier system, DFTs created before
+      // it is up build their own
+      if (fourier) {
+          m_impl->plan = fourier->m_impl->get_plan (m_impl->sample_count);
+      } else {
+          m_impl->own_plan.reset (new DFTPlan (m_impl->sample_count));
+          m_impl->plan = m_impl->own_plan.get ();
+      }
   }
 
   DFT::~DFT ()
@@ -248,16 +616,13 @@ namespace LV {
 
       switch (m_impl->method) {
           case DFT_METHOD_BRUTE_FORCE:
-              m_impl->perform_brute_force (input);
+              m_impl->perform_brute_force (output, input);
               break;
 
           case DFT_METHOD_FFT:
-              m_impl->perform_fft_radix2_dit (input);
+              m_impl->perform_fft (output, input);
               break;
       }
-
-      visual_math_simd_complex_norm_mul_float (output, &m_impl->real[0], &m_impl->imag[0],
-                                               m_impl->samples_out, 1.0 / m_impl->sample_count);
   }
 
   void DFT::log_scale (float *output, float const* input, unsigned int size)
@@ -291,28 +656,37 @@ namespace LV {
 
   DFT::Impl::Impl (unsigned int samples_out_, unsigned int samples_in_)
       : sample_count  (samples_in_),
-		spectrum_size (sample_count/2 + 1),
+        spectrum_size (sample_count/2 + 1),
         samples_out   (std::min (samples_out_, spectrum_size)),
         method        (best_method (sample_count)),
-        real          (sample_count),
-        imag          (sample_count)
+        plan          (0),
+        fft_func      (fft_perform<ScalarOps>)
   {
-      // empty
-  }
-
-  DFTMethod DFT::Impl::best_method (unsigned int sample_count)
-  {
-      if (visual_math_is_power_of_2 (sample_count))
-          return DFT_METHOD_FFT;
-      else
-          return DFT_METHOD_BRUTE_FORCE;
+      if (method == DFT_METHOD_FFT) {
+          real.resize (sample_count / 2);
+          imag.resize (sample_count / 2);
+
+          // CPU features are only known once libvisual is initialized,
+          // which also brings up the Fourier system
+          if (Fourier::instance ()) {
+#if defined(VISUAL_HAVE_SSE2)
+              if (visual_cpu_has_sse2 ())
+                  fft_func = fft_perform<SSE2Ops>;
+#endif
+
+#if defined(VISUAL_HAVE_NEON)
+              if (visual_cpu_has_neon ())
+                  fft_func = fft_perform<NEONOps>;
+#endif
+          }
+      }
   }
 
-  void DFT::Impl::perform_brute_force (float const* input)
+  void DFT::Impl::perform_brute_force (float* output, float const* input)
   {
-      DFTCache::Entry const& fcache = dft_cache.get_entry (method, sample_count);
+      float scale = 1.0f / sample_count;
 
-      for (unsigned int i = 0; i < spectrum_size; i++) {
+      for (unsigned int i = 0; i < samples_out; i++) {
           float xr = 0.0f;
           float xi = 0.0f;
 
@@ -325,63 +699,17 @@ namespace LV {
 
               float wtemp = wr;
 
-              wr = wr    * fcache.costable[i] - wi * fcache.sintable[i];
-              wi = wtemp * fcache.sintable[i] + wi * fcache.costable[i];
+              wr = wr    * plan->costable[i] - wi * plan->sintable[i];
+              wi = wtemp * plan->sintable[i] + wi * plan->costable[i];
           }
 
-          real[i] = xr;
-          imag[i] = xi;
+          output[i] = std::sqrt (xr * xr + xi * xi) * scale;
       }
   }
 
-  void DFT::Impl::perform_fft_radix2_dit (float const* input)
+  void DFT::Impl::perform_fft (float* output, float const* input)
   {
-    DFTCache::Entry const& fcache = dft_cache.get_entry (method, sample_count);
-
-    for (unsigned int i = 0; i < sample_count; i++) {
-        unsigned int idx = fcache.bitrevtable[i];
-
-        if (idx < sample_count)
-            real[i] = input[idx];
-        else
-            real[i] = 0;
-    }
-
-    unsigned int dft_size = 2;
-    unsigned int t = 0;
-
-    while (dft_size <= sample_count) {
-        float wpr = fcache.costable[t];
-        float wpi = fcache.sintable[t];
-
-        float wr = 1.0f;
-        float wi = 0.0f;
-
-        unsigned int half_dft_size = dft_size >> 1;
-
-        for (unsigned int m = 0; m < half_dft_size; m++) {
-            for (unsigned int i = m; i < sample_count; i += dft_size) {
-                unsigned int j = i + half_dft_size;
-
-                float tempr = wr * real[j] - wi * imag[j];
-                float tempi = wr * imag[j] + wi * real[j];
-
-                real[j] = real[i] - tempr;
-                imag[j] = imag[i] - tempi;
-
-                real[i] += tempr;
-                imag[i] += tempi;
-            }
-
-            float wtemp;
-
-            wr = (wtemp = wr) * wpr - wi * wpi;
-            wi = wi * wpr + wtemp * wpi;
-        }
-
-        dft_size <<= 1;
-        t++;
-    }
+      fft_func (*plan, output, input, &real[0], &imag[0], samples_out);
   }
 
 } // LV namespace
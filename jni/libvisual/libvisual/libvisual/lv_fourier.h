@@ -50,6 +50,8 @@ namespace LV {
 
   private:
 
+      friend class DFT;
+
       class Impl;
 
       ScopedPtr<Impl> m_impl;
@@ -46,7 +46,13 @@ extern "C" {
   void visual_alpha_blend_initialize (void);
   void visual_cpu_initialize (void);
   void visual_mem_initialize (void);
+  void visual_remap_initialize (void);
+  void visual_remap_deinitialize (void);
   void visual_thread_initialize (void);
+  void visual_video_blit_initialize (void);
+  void visual_video_convert_initialize (void);
+  void visual_video_scale_initialize (void);
+  void visual_video_scale_deinitialize (void);
 }
 
 namespace LV
@@ -150,6 +156,8 @@ namespace LV
 
       /* Initialize CPU-accelerated graphics functions */
       visual_alpha_blend_initialize ();
+      visual_video_convert_initialize ();
+      visual_video_blit_initialize ();
 
       /* Initialize high-resolution timer system */
 	  Time::init ();
@@ -157,6 +165,12 @@ namespace LV
       /* Initialize Thread system */
       visual_thread_initialize ();
 
+      /* Initialize the scaler and its worker threads */
+      visual_video_scale_initialize ();
+
+      /* Initialize the remap kernels and their worker threads */
+      visual_remap_initialize ();
+
       /* Initialize FFT system */
       Fourier::init ();
 
@@ -172,6 +186,9 @@ namespace LV
       PluginRegistry::deinit ();
 	  Fourier::deinit();
 
+      visual_remap_deinitialize ();
+      visual_video_scale_deinitialize ();
+
       visual_object_unref (VISUAL_OBJECT (m_impl->params));
   }
 
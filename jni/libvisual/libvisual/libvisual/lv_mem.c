@@ -26,6 +26,8 @@
 #include "lv_common.h"
 #include "lv_cpu.h"
 #include "lv_bits.h"
+#include "private/lv_atomic.h"
+#include "private/lv_simd.h"
 #include <string.h>
 #include <stdlib.h>
 #include "gettext.h"
@@ -59,6 +61,28 @@ static void *mem_set32_mmx (void *dest, int c, visual_size_t n);
 static void *mem_set32_mmx2 (void *dest, int c, visual_size_t n);
 #endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
 
+/* SSE2 and NEON versions */
+#if defined(VISUAL_HAVE_SSE2)
+/* Blocks at least this large are written with non-temporal stores. Below
+ * the size of the last level cache streaming only makes things slower, the
+ * data would still have been there for the next reader. */
+#define MEM_STREAM_THRESHOLD	(16 * 1024 * 1024)
+
+static void *mem_copy_sse2 (void *dest, const void *src, visual_size_t n);
+static void *mem_copy_pitch_sse2 (void *dest, const void *src, int pitch1, int pitch2, int width, int rows);
+static void *mem_set8_sse2 (void *dest, int c, visual_size_t n);
+static void *mem_set16_sse2 (void *dest, int c, visual_size_t n);
+static void *mem_set32_sse2 (void *dest, int c, visual_size_t n);
+#endif /* VISUAL_HAVE_SSE2 */
+
+#if defined(VISUAL_HAVE_NEON)
+static void *mem_copy_neon (void *dest, const void *src, visual_size_t n);
+static void *mem_copy_pitch_neon (void *dest, const void *src, int pitch1, int pitch2, int width, int rows);
+static void *mem_set8_neon (void *dest, int c, visual_size_t n);
+static void *mem_set16_neon (void *dest, int c, visual_size_t n);
+static void *mem_set32_neon (void *dest, int c, visual_size_t n);
+#endif /* VISUAL_HAVE_NEON */
+
 
 /* Optimal performance functions set by visual_mem_initialize(). */
 VisMemCopyFunc visual_mem_copy = mem_copy_c;
@@ -68,6 +92,9 @@ VisMemSet8Func visual_mem_set = mem_set8_c;
 VisMemSet16Func visual_mem_set16 = mem_set16_c;
 VisMemSet32Func visual_mem_set32 = mem_set32_c;
 
+/* Number of heap allocations done through visual_mem_* */
+static uint32_t mem_alloc_count = 0;
+
 
 void visual_mem_initialize ()
 {
@@ -109,6 +136,28 @@ void visual_mem_initialize ()
 	}
 
 #endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+#if defined(VISUAL_HAVE_SSE2)
+	if (visual_cpu_has_sse2 ()) {
+		visual_mem_copy = mem_copy_sse2;
+		visual_mem_copy_pitch = mem_copy_pitch_sse2;
+
+		visual_mem_set = mem_set8_sse2;
+		visual_mem_set16 = mem_set16_sse2;
+		visual_mem_set32 = mem_set32_sse2;
+	}
+#endif /* VISUAL_HAVE_SSE2 */
+
+#if defined(VISUAL_HAVE_NEON)
+	if (visual_cpu_has_neon ()) {
+		visual_mem_copy = mem_copy_neon;
+		visual_mem_copy_pitch = mem_copy_pitch_neon;
+
+		visual_mem_set = mem_set8_neon;
+		visual_mem_set16 = mem_set16_neon;
+		visual_mem_set32 = mem_set32_neon;
+	}
+#endif /* VISUAL_HAVE_NEON */
 }
 
 void *visual_mem_malloc (visual_size_t nbytes)
@@ -117,6 +166,8 @@ void *visual_mem_malloc (visual_size_t nbytes)
 
 	visual_return_val_if_fail (nbytes > 0, NULL);
 
+	visual_atomic_inc_u32 (&mem_alloc_count);
+
 	buf = malloc (nbytes);
 
 	if (buf == NULL) {
@@ -143,9 +194,16 @@ void *visual_mem_malloc0 (visual_size_t nbytes)
 
 void *visual_mem_realloc (void *ptr, visual_size_t nbytes)
 {
+	visual_atomic_inc_u32 (&mem_alloc_count);
+
 	return realloc (ptr, nbytes);
 }
 
+uint32_t visual_mem_get_alloc_count (void)
+{
+	return visual_atomic_load_u32_acquire (&mem_alloc_count);
+}
+
 int visual_mem_free (void *ptr)
 {
 	/* FIXME remove eventually, we keep it for now for explicit debug */
@@ -911,3 +969,313 @@ static void *mem_set32_mmx2 (void *dest, int c, visual_size_t n)
 }
 
 #endif /* VISUAL_ARCH_X86 || VISUAL_ARCH_X86_64 */
+
+
+#if defined(VISUAL_HAVE_SSE2)
+
+static void mem_copy_block_sse2 (uint8_t *d, const uint8_t *s, visual_size_t n, int stream)
+{
+	/* Align the destination, the loads stay unaligned */
+	while (!VISUAL_ALIGNED (d, 16) && n > 0) {
+		*d++ = *s++;
+		n--;
+	}
+
+	if (stream) {
+		while (n >= 64) {
+			__m128i v0 = _mm_loadu_si128 ((const __m128i *) s);
+			__m128i v1 = _mm_loadu_si128 ((const __m128i *) (s + 16));
+			__m128i v2 = _mm_loadu_si128 ((const __m128i *) (s + 32));
+			__m128i v3 = _mm_loadu_si128 ((const __m128i *) (s + 48));
+
+			_mm_prefetch ((const char *) (s + 512), _MM_HINT_NTA);
+
+			_mm_stream_si128 ((__m128i *) d, v0);
+			_mm_stream_si128 ((__m128i *) (d + 16), v1);
+			_mm_stream_si128 ((__m128i *) (d + 32), v2);
+			_mm_stream_si128 ((__m128i *) (d + 48), v3);
+
+			d += 64;
+			s += 64;
+			n -= 64;
+		}
+	} else {
+		while (n >= 64) {
+			__m128i v0 = _mm_loadu_si128 ((const __m128i *) s);
+			__m128i v1 = _mm_loadu_si128 ((const __m128i *) (s + 16));
+			__m128i v2 = _mm_loadu_si128 ((const __m128i *) (s + 32));
+			__m128i v3 = _mm_loadu_si128 ((const __m128i *) (s + 48));
+
+			_mm_store_si128 ((__m128i *) d, v0);
+			_mm_store_si128 ((__m128i *) (d + 16), v1);
+			_mm_store_si128 ((__m128i *) (d + 32), v2);
+			_mm_store_si128 ((__m128i *) (d + 48), v3);
+
+			d += 64;
+			s += 64;
+			n -= 64;
+		}
+	}
+
+	while (n >= 16) {
+		_mm_store_si128 ((__m128i *) d, _mm_loadu_si128 ((const __m128i *) s));
+
+		d += 16;
+		s += 16;
+		n -= 16;
+	}
+
+	while (n--)
+		*d++ = *s++;
+}
+
+/* Fills n bytes with the 16 byte pattern v, d must be 16 byte aligned for
+ * streaming. The pattern must repeat every element so the tail can be
+ * taken from its start. */
+static void mem_fill_sse2 (uint8_t *d, __m128i v, visual_size_t n, int stream)
+{
+	uint8_t tail[16];
+
+	if (stream) {
+		while (n >= 64) {
+			_mm_stream_si128 ((__m128i *) d, v);
+			_mm_stream_si128 ((__m128i *) (d + 16), v);
+			_mm_stream_si128 ((__m128i *) (d + 32), v);
+			_mm_stream_si128 ((__m128i *) (d + 48), v);
+
+			d += 64;
+			n -= 64;
+		}
+
+		_mm_sfence ();
+	} else {
+		while (n >= 64) {
+			_mm_storeu_si128 ((__m128i *) d, v);
+			_mm_storeu_si128 ((__m128i *) (d + 16), v);
+			_mm_storeu_si128 ((__m128i *) (d + 32), v);
+			_mm_storeu_si128 ((__m128i *) (d + 48), v);
+
+			d += 64;
+			n -= 64;
+		}
+	}
+
+	while (n >= 16) {
+		_mm_storeu_si128 ((__m128i *) d, v);
+
+		d += 16;
+		n -= 16;
+	}
+
+	_mm_storeu_si128 ((__m128i *) tail, v);
+	memcpy (d, tail, n);
+}
+
+static void *mem_copy_sse2 (void *dest, const void *src, visual_size_t n)
+{
+	int stream = n >= MEM_STREAM_THRESHOLD;
+
+	if (n < 64)
+		return memcpy (dest, src, n);
+
+	mem_copy_block_sse2 (dest, src, n, stream);
+
+	if (stream)
+		_mm_sfence ();
+
+	return dest;
+}
+
+static void *mem_copy_pitch_sse2 (void *dest, const void *src, int pitch1, int pitch2, int width, int rows)
+{
+	uint8_t *d = dest;
+	const uint8_t *s = src;
+	int stream = (visual_size_t) width * rows >= MEM_STREAM_THRESHOLD;
+	int i;
+
+	for (i = 0; i < rows; i++) {
+		if (width < 64)
+			memcpy (d, s, width);
+		else
+			mem_copy_block_sse2 (d, s, width, stream);
+
+		d += pitch1;
+		s += pitch2;
+	}
+
+	if (stream)
+		_mm_sfence ();
+
+	return dest;
+}
+
+static void *mem_set8_sse2 (void *dest, int c, visual_size_t n)
+{
+	uint8_t *d = dest;
+
+	if (n < 64)
+		return memset (dest, c, n);
+
+	while (!VISUAL_ALIGNED (d, 16)) {
+		*d++ = c;
+		n--;
+	}
+
+	mem_fill_sse2 (d, _mm_set1_epi8 (c), n, n >= MEM_STREAM_THRESHOLD);
+
+	return dest;
+}
+
+static void *mem_set16_sse2 (void *dest, int c, visual_size_t n)
+{
+	uint16_t *d = dest;
+
+	/* Element writes keep the pattern in phase, which an odd address can't */
+	if (VISUAL_ALIGNED (d, 2)) {
+		while (!VISUAL_ALIGNED (d, 16) && n > 0) {
+			*d++ = c;
+			n--;
+		}
+	}
+
+	mem_fill_sse2 ((uint8_t *) d, _mm_set1_epi16 (c), n * 2,
+			n * 2 >= MEM_STREAM_THRESHOLD && VISUAL_ALIGNED (d, 16));
+
+	return dest;
+}
+
+static void *mem_set32_sse2 (void *dest, int c, visual_size_t n)
+{
+	uint32_t *d = dest;
+
+	if (VISUAL_ALIGNED (d, 4)) {
+		while (!VISUAL_ALIGNED (d, 16) && n > 0) {
+			*d++ = c;
+			n--;
+		}
+	}
+
+	mem_fill_sse2 ((uint8_t *) d, _mm_set1_epi32 (c), n * 4,
+			n * 4 >= MEM_STREAM_THRESHOLD && VISUAL_ALIGNED (d, 16));
+
+	return dest;
+}
+
+#endif /* VISUAL_HAVE_SSE2 */
+
+
+#if defined(VISUAL_HAVE_NEON)
+
+/* NEON has no non-temporal stores, so these only widen the data path */
+
+static void mem_copy_block_neon (uint8_t *d, const uint8_t *s, visual_size_t n)
+{
+	while (n >= 64) {
+		uint8x16_t v0 = vld1q_u8 (s);
+		uint8x16_t v1 = vld1q_u8 (s + 16);
+		uint8x16_t v2 = vld1q_u8 (s + 32);
+		uint8x16_t v3 = vld1q_u8 (s + 48);
+
+		__builtin_prefetch (s + 256);
+
+		vst1q_u8 (d, v0);
+		vst1q_u8 (d + 16, v1);
+		vst1q_u8 (d + 32, v2);
+		vst1q_u8 (d + 48, v3);
+
+		d += 64;
+		s += 64;
+		n -= 64;
+	}
+
+	while (n >= 16) {
+		vst1q_u8 (d, vld1q_u8 (s));
+
+		d += 16;
+		s += 16;
+		n -= 16;
+	}
+
+	while (n--)
+		*d++ = *s++;
+}
+
+static void mem_fill_neon (uint8_t *d, uint8x16_t v, visual_size_t n)
+{
+	uint8_t tail[16];
+
+	while (n >= 64) {
+		vst1q_u8 (d, v);
+		vst1q_u8 (d + 16, v);
+		vst1q_u8 (d + 32, v);
+		vst1q_u8 (d + 48, v);
+
+		d += 64;
+		n -= 64;
+	}
+
+	while (n >= 16) {
+		vst1q_u8 (d, v);
+
+		d += 16;
+		n -= 16;
+	}
+
+	vst1q_u8 (tail, v);
+	memcpy (d, tail, n);
+}
+
+static void *mem_copy_neon (void *dest, const void *src, visual_size_t n)
+{
+	if (n < 64)
+		return memcpy (dest, src, n);
+
+	mem_copy_block_neon (dest, src, n);
+
+	return dest;
+}
+
+static void *mem_copy_pitch_neon (void *dest, const void *src, int pitch1, int pitch2, int width, int rows)
+{
+	uint8_t *d = dest;
+	const uint8_t *s = src;
+	int i;
+
+	for (i = 0; i < rows; i++) {
+		if (width < 64)
+			memcpy (d, s, width);
+		else
+			mem_copy_block_neon (d, s, width);
+
+		d += pitch1;
+		s += pitch2;
+	}
+
+	return dest;
+}
+
+static void *mem_set8_neon (void *dest, int c, visual_size_t n)
+{
+	if (n < 64)
+		return memset (dest, c, n);
+
+	mem_fill_neon (dest, vdupq_n_u8 (c), n);
+
+	return dest;
+}
+
+static void *mem_set16_neon (void *dest, int c, visual_size_t n)
+{
+	mem_fill_neon (dest, vreinterpretq_u8_u16 (vdupq_n_u16 (c)), n * 2);
+
+	return dest;
+}
+
+static void *mem_set32_neon (void *dest, int c, visual_size_t n)
+{
+	mem_fill_neon (dest, vreinterpretq_u8_u32 (vdupq_n_u32 (c)), n * 4);
+
+	return dest;
+}
+
+#endif /* VISUAL_HAVE_NEON */
@@ -26,6 +26,7 @@
 
 #include <libvisual/lvconfig.h>
 #include <libvisual/lv_defines.h>
+#include <libvisual/lv_types.h>
 
 /**
  * @defgroup VisMem VisMem
@@ -133,6 +134,16 @@ LV_API void *visual_mem_realloc (void *ptr, visual_size_t nbytes) LV_ATTR_MALLOC
  */
 LV_API int visual_mem_free (void *ptr);
 
+/**
+ * Gives the number of allocations made through visual_mem_malloc(),
+ * visual_mem_malloc0() and visual_mem_realloc() so far. Taking the
+ * difference around a piece of code tells whether it hits the heap.
+ * The counter wraps around after 2^32 allocations.
+ *
+ * @return The number of allocations.
+ */
+LV_API uint32_t visual_mem_get_alloc_count (void);
+
 LV_API void *visual_mem_malloc_aligned (visual_size_t size, visual_size_t alignment);
 LV_API void  visual_mem_free_aligned   (void* ptr);
 
@@ -0,0 +1,769 @@
+/* Libvisual - The audio visualisation framework.
+ *
+ * Copyright (C) 2004, 2005, 2006 Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "config.h"
+#include "lv_remap.h"
+#include "lv_common.h"
+#include "lv_cpu.h"
+#include "lv_worker_pool.h"
+#include "private/lv_simd.h"
+#include <string.h>
+
+/* A frame is warped row by row. A row function fetches a whole destination
+ * row, then, when fade or decay are set, a second pass fades that row while
+ * it is still in cache. Rows are independent, so the frame is split into
+ * bands of rows run on the worker pool.
+ *
+ * Fetching is a gather, which SSE2 and NEON have no instruction for. The
+ * SIMD versions load the source pixels one by one and do the weighing,
+ * averaging and fading on whole vectors. Nearest fetch has nothing left
+ * to vectorize and is C only. The C and SIMD versions give identical
+ * results.
+ *
+ * infinite, jess and jakdaw use it. The other feedback actors keep their
+ * own warps, which a VisRemap can't reproduce:
+ *  - goom2k4 blends two coordinate tables by a ratio that moves every
+ *    frame, its fetch point is never the same twice.
+ *  - corona warps its image in place and averages every fetched value
+ *    with the pixel it replaces.
+ *  - G-Force marks pixels that go black, folds its 31/32 fade into the
+ *    bilinear weights and rounds once, and maps its fields straight from
+ *    the disk cache. */
+
+/* Smallest band of rows worth handing to another thread */
+#define REMAP_MIN_BAND_ROWS	16
+
+/* Weighted sums are divided by VISUAL_REMAP_WEIGHT_ONE with this shift,
+ * rounding to nearest. Truncating would darken feedback a little more on
+ * every pass. */
+#define REMAP_WEIGHT_SHIFT	7
+#define REMAP_WEIGHT_ROUND	(1 << (REMAP_WEIGHT_SHIFT - 1))
+
+struct _VisRemap {
+	VisObject	 object;
+
+	int		 width;
+	int		 height;
+	VisRemapFetch	 fetch;
+	int		 taps;		/* Coordinates per pixel */
+
+	uint32_t	*coords;
+	uint32_t	*weights;	/* Weighted fetch only */
+
+	int		 fade;
+	int		 decay;
+};
+
+typedef void (*RemapRowFunc) (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width);
+typedef void (*RemapFadeRowFunc) (uint8_t *row, int size, int fade, int decay);
+
+typedef struct {
+	VisRemap	*remap;
+	uint8_t		*dest;
+	const uint8_t	*src;
+	int		 dest_pitch;
+	int		 src_pitch;
+	int		 bpp;
+	RemapRowFunc	 row;
+	int		 fade;
+} RemapJob;
+
+static int remap_dtor (VisObject *object);
+
+static void remap_band (void *data, int index, int count);
+
+static void nearest_row8_c (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void nearest_row32_c (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void weighted_row8_c (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void weighted_row32_c (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void average_row8_c (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void average_row32_c (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void fade_row_c (uint8_t *row, int size, int fade, int decay);
+
+#if defined(VISUAL_HAVE_SSE2)
+static void weighted_row8_sse2 (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void weighted_row32_sse2 (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void average_row32_sse2 (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void fade_row_sse2 (uint8_t *row, int size, int fade, int decay);
+#endif
+
+#if defined(VISUAL_HAVE_NEON)
+static void weighted_row8_neon (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void weighted_row32_neon (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void average_row32_neon (uint8_t *dest, const uint8_t *src, int pitch, const uint32_t *coords, const uint32_t *weights, int width);
+static void fade_row_neon (uint8_t *row, int size, int fade, int decay);
+#endif
+
+/* Fastest versions, set by visual_remap_initialize() */
+static RemapRowFunc     weighted_row8  = weighted_row8_c;
+static RemapRowFunc     weighted_row32 = weighted_row32_c;
+static RemapRowFunc     average_row32  = average_row32_c;
+static RemapFadeRowFunc fade_row       = fade_row_c;
+
+static VisWorkerPool *remap_pool = NULL;
+
+
+void visual_remap_initialize (void)
+{
+#if defined(VISUAL_HAVE_SSE2)
+	if (visual_cpu_has_sse2 ()) {
+		weighted_row8  = weighted_row8_sse2;
+		weighted_row32 = weighted_row32_sse2;
+		average_row32  = average_row32_sse2;
+		fade_row       = fade_row_sse2;
+	}
+#endif
+
+#if defined(VISUAL_HAVE_NEON)
+	if (visual_cpu_has_neon ()) {
+		weighted_row8  = weighted_row8_neon;
+		weighted_row32 = weighted_row32_neon;
+		average_row32  = average_row32_neon;
+		fade_row       = fade_row_neon;
+	}
+#endif
+
+	if (remap_pool == NULL)
+		remap_pool = visual_worker_pool_new (0);
+}
+
+void visual_remap_deinitialize (void)
+{
+	if (remap_pool != NULL)
+		visual_object_unref (VISUAL_OBJECT (remap_pool));
+
+	remap_pool = NULL;
+}
+
+void visual_remap_set_threads (int threads)
+{
+	visual_return_if_fail (remap_pool != NULL);
+
+	visual_worker_pool_set_threads (remap_pool, threads);
+}
+
+int visual_remap_get_threads (void)
+{
+	if (remap_pool == NULL)
+		return 1;
+
+	return visual_worker_pool_get_threads (remap_pool);
+}
+
+static int remap_dtor (VisObject *object)
+{
+	VisRemap *remap = VISUAL_REMAP (object);
+
+	if (remap->coords != NULL)
+		visual_mem_free (remap->coords);
+
+	if (remap->weights != NULL)
+		visual_mem_free (remap->weights);
+
+	remap->coords = NULL;
+	remap->weights = NULL;
+
+	return VISUAL_OK;
+}
+
+VisRemap *visual_remap_new (int width, int height, VisRemapFetch fetch)
+{
+	VisRemap *remap;
+
+	visual_return_val_if_fail (width > 0 && width <= 0xffff, NULL);
+	visual_return_val_if_fail (height > 0 && height <= 0xffff, NULL);
+	visual_return_val_if_fail (fetch != VISUAL_REMAP_FETCH_WEIGHTED || (width >= 2 && height >= 2), NULL);
+
+	remap = visual_mem_new0 (VisRemap, 1);
+
+	/* Do the VisObject initialization */
+	visual_object_initialize (VISUAL_OBJECT (remap), TRUE, remap_dtor);
+
+	remap->width = width;
+	remap->height = height;
+	remap->fetch = fetch;
+	remap->taps = fetch == VISUAL_REMAP_FETCH_AVERAGE4 ? 4 : 1;
+	remap->fade = VISUAL_REMAP_FADE_NONE;
+	remap->decay = 0;
+
+	remap->coords = visual_mem_new0 (uint32_t, width * height * remap->taps);
+
+	if (fetch == VISUAL_REMAP_FETCH_WEIGHTED)
+		remap->weights = visual_mem_new0 (uint32_t, width * height);
+
+	return remap;
+}
+
+int visual_remap_get_width (VisRemap *remap)
+{
+	visual_return_val_if_fail (remap != NULL, -VISUAL_ERROR_REMAP_NULL);
+
+	return remap->width;
+}
+
+int visual_remap_get_height (VisRemap *remap)
+{
+	visual_return_val_if_fail (remap != NULL, -VISUAL_ERROR_REMAP_NULL);
+
+	return remap->height;
+}
+
+VisRemapFetch visual_remap_get_fetch (VisRemap *remap)
+{
+	visual_return_val_if_fail (remap != NULL, VISUAL_REMAP_FETCH_NEAREST);
+
+	return remap->fetch;
+}
+
+uint32_t *visual_remap_get_coords (VisRemap *remap)
+{
+	visual_return_val_if_fail (remap != NULL, NULL);
+
+	return remap->coords;
+}
+
+uint32_t *visual_remap_get_weights (VisRemap *remap)
+{
+	visual_return_val_if_fail (remap != NULL, NULL);
+
+	return remap->weights;
+}
+
+int visual_remap_set_point (VisRemap *remap, int x, int y, float sx, float sy)
+{
+	int ix, iy, fx, fy, tap;
+	int left, right;
+
+	visual_return_val_if_fail (remap != NULL, -VISUAL_ERROR_REMAP_NULL);
+	visual_return_val_if_fail (x >= 0 && x < remap->width, -VISUAL_ERROR_REMAP_OUT_OF_BOUNDS);
+	visual_return_val_if_fail (y >= 0 && y < remap->height, -VISUAL_ERROR_REMAP_OUT_OF_BOUNDS);
+
+	/* Written so NaN ends up at 0 as well */
+	if (!(sx >= 0))
+		sx = 0;
+	if (!(sy >= 0))
+		sy = 0;
+	if (sx > remap->width - 1)
+		sx = remap->width - 1;
+	if (sy > remap->height - 1)
+		sy = remap->height - 1;
+
+	ix = (int) sx;
+	iy = (int) sy;
+
+	if (remap->fetch != VISUAL_REMAP_FETCH_WEIGHTED) {
+		for (tap = 0; tap < remap->taps; tap++)
+			remap->coords[(y * remap->width + x) * remap->taps + tap] = VISUAL_REMAP_COORD (ix, iy);
+
+		return VISUAL_OK;
+	}
+
+	fx = (int) ((sx - ix) * VISUAL_REMAP_WEIGHT_ONE);
+	fy = (int) ((sy - iy) * VISUAL_REMAP_WEIGHT_ONE);
+
+	/* On the last row or column all weight goes to the pixels on it */
+	if (ix > remap->width - 2) {
+		ix = remap->width - 2;
+		fx = VISUAL_REMAP_WEIGHT_ONE;
+	}
+
+	if (iy > remap->height - 2) {
+		iy = remap->height - 2;
+		fy = VISUAL_REMAP_WEIGHT_ONE;
+	}
+
+	/* Split per column first so the four always add up to exactly one */
+	right = fx;
+	left = VISUAL_REMAP_WEIGHT_ONE - fx;
+
+	remap->coords[y * remap->width + x] = VISUAL_REMAP_COORD (ix, iy);
+	remap->weights[y * remap->width + x] = VISUAL_REMAP_WEIGHTS (
+			left - ((left * fy) >> REMAP_WEIGHT_SHIFT),
+			right - ((right * fy) >> REMAP_WEIGHT_SHIFT),
+			(left * fy) >> REMAP_WEIGHT_SHIFT,
+			(right * fy) >> REMAP_WEIGHT_SHIFT);
+
+	return VISUAL_OK;
+}
+
+int visual_remap_set_tap (VisRemap *remap, int x, int y, int tap, int sx, int sy)
+{
+	int maxx, maxy;
+
+	visual_return_val_if_fail (remap != NULL, -VISUAL_ERROR_REMAP_NULL);
+	visual_return_val_if_fail (x >= 0 && x < remap->width, -VISUAL_ERROR_REMAP_OUT_OF_BOUNDS);
+	visual_return_val_if_fail (y >= 0 && y < remap->height, -VISUAL_ERROR_REMAP_OUT_OF_BOUNDS);
+	visual_return_val_if_fail (tap >= 0 && tap < remap->taps, -VISUAL_ERROR_REMAP_OUT_OF_BOUNDS);
+
+	maxx = remap->width - 1;
+	maxy = remap->height - 1;
+
+	if (remap->fetch == VISUAL_REMAP_FETCH_WEIGHTED) {
+		maxx--;
+		maxy--;
+	}
+
+	sx = sx < 0 ? 0 : sx > maxx ? maxx : sx;
+	sy = sy < 0 ? 0 : sy > maxy ? maxy : sy;
+
+	remap->coords[(y * remap->width + x) * remap->taps + tap] = VISUAL_REMAP_COORD (sx, sy);
+
+	return VISUAL_OK;
+}
+
+int visual_remap_set_fade (VisRemap *remap, int fade)
+{
+	visual_return_val_if_fail (remap != NULL, -VISUAL_ERROR_REMAP_NULL);
+
+	remap->fade = fade < 0 ? 0 : fade > VISUAL_REMAP_FADE_NONE ? VISUAL_REMAP_FADE_NONE : fade;
+
+	return VISUAL_OK;
+}
+
+int visual_remap_set_decay (VisRemap *remap, int decay)
+{
+	visual_return_val_if_fail (remap != NULL, -VISUAL_ERROR_REMAP_NULL);
+
+	remap->decay = decay < 0 ? 0 : decay > 255 ? 255 : decay;
+
+	return VISUAL_OK;
+}
+
+int visual_remap_apply (VisRemap *remap, VisVideo *dest, VisVideo *src)
+{
+	RemapJob job;
+	int threads, bands;
+
+	visual_return_val_if_fail (remap != NULL, -VISUAL_ERROR_REMAP_NULL);
+	visual_return_val_if_fail (dest != NULL, -VISUAL_ERROR_VIDEO_NULL);
+	visual_return_val_if_fail (src != NULL, -VISUAL_ERROR_VIDEO_NULL);
+	visual_return_val_if_fail (dest->depth == src->depth, -VISUAL_ERROR_VIDEO_INVALID_DEPTH);
+	visual_return_val_if_fail (dest->depth == VISUAL_VIDEO_DEPTH_8BIT || dest->depth == VISUAL_VIDEO_DEPTH_32BIT,
+			-VISUAL_ERROR_VIDEO_INVALID_DEPTH);
+	visual_return_val_if_fail (dest->width == remap->width && dest->height == remap->height,
+			-VISUAL_ERROR_VIDEO_NOT_INDENTICAL);
+	visual_return_val_if_fail (src->width == remap->width && src->height == remap->height,
+			-VISUAL_ERROR_VIDEO_NOT_INDENTICAL);
+
+	job.remap = remap;
+	job.dest = visual_video_get_pixels (dest);
+	job.src = visual_video_get_pixels (src);
+	job.dest_pitch = dest->pitch;
+	job.src_pitch = src->pitch;
+	job.bpp = dest->bpp;
+	job.fade = remap->fade != VISUAL_REMAP_FADE_NONE || remap->decay != 0;
+
+	visual_return_val_if_fail (job.dest != NULL && job.src != NULL, -VISUAL_ERROR_VIDEO_PIXELS_NULL);
+
+	switch (remap->fetch) {
+		case VISUAL_REMAP_FETCH_WEIGHTED:
+			job.row = job.bpp == 1 ? weighted_row8 : weighted_row32;
+			break;
+
+		case VISUAL_REMAP_FETCH_AVERAGE4:
+			job.row = job.bpp == 1 ? average_row8_c : average_row32;
+			break;
+
+		default:
+			job.row = job.bpp == 1 ? nearest_row8_c : nearest_row32_c;
+			break;
+	}
+
+	threads = visual_remap_get_threads ();
+	bands = threads > 1 ? threads * 2 : 1;
+
+	if (bands * REMAP_MIN_BAND_ROWS > remap->height)
+		bands = remap->height / REMAP_MIN_BAND_ROWS;
+
+	if (bands < 1)
+		bands = 1;
+
+	if (remap_pool != NULL) {
+		visual_worker_pool_run (remap_pool, remap_band, &job, bands);
+	} else {
+		int i;
+
+		for (i = 0; i < bands; i++)
+			remap_band (&job, i, bands);
+	}
+
+	return VISUAL_OK;
+}
+
+static void remap_band (void *data, int index, int count)
+{
+	RemapJob *job = data;
+	VisRemap *remap = job->remap;
+	int y = remap->height * index / count;
+	int end = remap->height * (index + 1) / count;
+
+	for (; y < end; y++) {
+		uint8_t *dest = job->dest + y * job->dest_pitch;
+		const uint32_t *coords = remap->coords + y * remap->width * remap->taps;
+		const uint32_t *weights = remap->weights != NULL ? remap->weights + y * remap->width : NULL;
+
+		job->row (dest, job->src, job->src_pitch, coords, weights, remap->width);
+
+		if (job->fade)
+			fade_row (dest, remap->width * job->bpp, remap->fade, remap->decay);
+	}
+}
+
+/* Start of the source pixel a coordinate points at */
+#define REMAP_PIXEL(src, pitch, coord, bpp) \
+	((src) + ((coord) >> 16) * (pitch) + ((coord) & 0xffff) * (bpp))
+
+static inline uint32_t fetch32 (const uint8_t *src, int pitch, uint32_t coord)
+{
+	uint32_t pixel;
+
+	memcpy (&pixel, REMAP_PIXEL (src, pitch, coord, 4), 4);
+
+	return pixel;
+}
+
+/* Top left, top right, bottom left and bottom right 8 bit pixel, in the byte order of the weights */
+static inline uint32_t fetch2x2_8 (const uint8_t *src, int pitch, uint32_t coord)
+{
+	const uint8_t *p = REMAP_PIXEL (src, pitch, coord, 1);
+
+	return p[0] | (p[1] << 8) | (p[pitch] << 16) | ((uint32_t) p[pitch + 1] << 24);
+}
+
+static void nearest_row8_c (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	int i;
+
+	for (i = 0; i < width; i++)
+		dest[i] = *REMAP_PIXEL (src, pitch, coords[i], 1);
+}
+
+static void nearest_row32_c (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	uint32_t *dbuf = (uint32_t *) dest;
+	int i;
+
+	for (i = 0; i < width; i++)
+		dbuf[i] = fetch32 (src, pitch, coords[i]);
+}
+
+static void weighted_row8_c (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	int i;
+
+	for (i = 0; i < width; i++) {
+		uint32_t p = fetch2x2_8 (src, pitch, coords[i]);
+		uint32_t w = weights[i];
+
+		dest[i] = ((p & 0xff) * (w & 0xff) +
+				((p >> 8) & 0xff) * ((w >> 8) & 0xff) +
+				((p >> 16) & 0xff) * ((w >> 16) & 0xff) +
+				(p >> 24) * (w >> 24) + REMAP_WEIGHT_ROUND) >> REMAP_WEIGHT_SHIFT;
+	}
+}
+
+static void weighted_row32_c (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	int i, c;
+
+	for (i = 0; i < width; i++) {
+		const uint8_t *p = REMAP_PIXEL (src, pitch, coords[i], 4);
+		uint32_t w = weights[i];
+		int tl = w & 0xff, tr = (w >> 8) & 0xff, bl = (w >> 16) & 0xff, br = w >> 24;
+
+		for (c = 0; c < 4; c++)
+			dest[i * 4 + c] = (p[c] * tl + p[c + 4] * tr + p[pitch + c] * bl + p[pitch + c + 4] * br + REMAP_WEIGHT_ROUND) >> REMAP_WEIGHT_SHIFT;
+	}
+}
+
+static void average_row8_c (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	int i;
+
+	for (i = 0; i < width; i++, coords += 4) {
+		dest[i] = (*REMAP_PIXEL (src, pitch, coords[0], 1) +
+				*REMAP_PIXEL (src, pitch, coords[1], 1) +
+				*REMAP_PIXEL (src, pitch, coords[2], 1) +
+				*REMAP_PIXEL (src, pitch, coords[3], 1)) >> 2;
+	}
+}
+
+static void average_row32_c (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	uint32_t *dbuf = (uint32_t *) dest;
+	int i;
+
+	/* Two channels at a time, every channel has 8 bits to spare */
+	for (i = 0; i < width; i++, coords += 4) {
+		uint32_t p0 = fetch32 (src, pitch, coords[0]);
+		uint32_t p1 = fetch32 (src, pitch, coords[1]);
+		uint32_t p2 = fetch32 (src, pitch, coords[2]);
+		uint32_t p3 = fetch32 (src, pitch, coords[3]);
+
+		uint32_t even = (p0 & 0x00ff00ff) + (p1 & 0x00ff00ff) + (p2 & 0x00ff00ff) + (p3 & 0x00ff00ff);
+		uint32_t odd  = ((p0 >> 8) & 0x00ff00ff) + ((p1 >> 8) & 0x00ff00ff) +
+			((p2 >> 8) & 0x00ff00ff) + ((p3 >> 8) & 0x00ff00ff);
+
+		dbuf[i] = ((even >> 2) & 0x00ff00ff) | (((odd >> 2) & 0x00ff00ff) << 8);
+	}
+}
+
+static void fade_row_c (uint8_t *row, int size, int fade, int decay)
+{
+	int i;
+
+	if (fade == VISUAL_REMAP_FADE_NONE) {
+		for (i = 0; i < size; i++)
+			row[i] = row[i] > decay ? row[i] - decay : 0;
+
+		return;
+	}
+
+	for (i = 0; i < size; i++) {
+		int value = (row[i] * fade) >> 8;
+
+		row[i] = value > decay ? value - decay : 0;
+	}
+}
+
+#if defined(VISUAL_HAVE_SSE2)
+
+static void weighted_row8_sse2 (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i round = _mm_set1_epi32 (REMAP_WEIGHT_ROUND);
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4) {
+		__m128i pixels = _mm_set_epi32 (fetch2x2_8 (src, pitch, coords[i + 3]),
+				fetch2x2_8 (src, pitch, coords[i + 2]),
+				fetch2x2_8 (src, pitch, coords[i + 1]),
+				fetch2x2_8 (src, pitch, coords[i]));
+		__m128i w = _mm_loadu_si128 ((const __m128i *) (weights + i));
+
+		/* Top and bottom sums of pixels 0 and 1, then of 2 and 3 */
+		__m128i lo = _mm_madd_epi16 (_mm_unpacklo_epi8 (pixels, zero), _mm_unpacklo_epi8 (w, zero));
+		__m128i hi = _mm_madd_epi16 (_mm_unpackhi_epi8 (pixels, zero), _mm_unpackhi_epi8 (w, zero));
+
+		__m128i top = _mm_castps_si128 (_mm_shuffle_ps (_mm_castsi128_ps (lo), _mm_castsi128_ps (hi), _MM_SHUFFLE (2, 0, 2, 0)));
+		__m128i bottom = _mm_castps_si128 (_mm_shuffle_ps (_mm_castsi128_ps (lo), _mm_castsi128_ps (hi), _MM_SHUFFLE (3, 1, 3, 1)));
+		__m128i sum = _mm_srli_epi32 (_mm_add_epi32 (_mm_add_epi32 (top, bottom), round), REMAP_WEIGHT_SHIFT);
+		int32_t out;
+
+		sum = _mm_packs_epi32 (sum, sum);
+		out = _mm_cvtsi128_si32 (_mm_packus_epi16 (sum, sum));
+
+		memcpy (dest + i, &out, 4);
+	}
+
+	if (i < width)
+		weighted_row8_c (dest + i, src, pitch, coords + i, weights + i, width - i);
+}
+
+static void weighted_row32_sse2 (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i round = _mm_set1_epi16 (REMAP_WEIGHT_ROUND);
+	int i;
+
+	for (i = 0; i < width; i++) {
+		const uint8_t *p = REMAP_PIXEL (src, pitch, coords[i], 4);
+		__m128i top = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) p), zero);
+		__m128i bottom = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *) (p + pitch)), zero);
+
+		/* Spread the weights over the channels: tl x4, tr x4 and bl x4, br x4 */
+		__m128i w = _mm_unpacklo_epi8 (_mm_cvtsi32_si128 ((int) weights[i]), zero);
+		__m128i wtop, wbottom, sum;
+
+		w = _mm_unpacklo_epi16 (w, w);
+		wtop = _mm_unpacklo_epi32 (w, w);
+		wbottom = _mm_unpackhi_epi32 (w, w);
+
+		sum = _mm_add_epi16 (_mm_mullo_epi16 (top, wtop), _mm_mullo_epi16 (bottom, wbottom));
+		sum = _mm_add_epi16 (sum, _mm_srli_si128 (sum, 8));
+		sum = _mm_srli_epi16 (_mm_add_epi16 (sum, round), REMAP_WEIGHT_SHIFT);
+
+		((uint32_t *) dest)[i] = _mm_cvtsi128_si32 (_mm_packus_epi16 (sum, sum));
+	}
+}
+
+static void average_row32_sse2 (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	int i;
+
+	for (i = 0; i < width; i++, coords += 4) {
+		__m128i pixels = _mm_set_epi32 (fetch32 (src, pitch, coords[3]),
+				fetch32 (src, pitch, coords[2]),
+				fetch32 (src, pitch, coords[1]),
+				fetch32 (src, pitch, coords[0]));
+		__m128i sum = _mm_add_epi16 (_mm_unpacklo_epi8 (pixels, zero), _mm_unpackhi_epi8 (pixels, zero));
+
+		sum = _mm_add_epi16 (sum, _mm_srli_si128 (sum, 8));
+		sum = _mm_srli_epi16 (sum, 2);
+
+		((uint32_t *) dest)[i] = _mm_cvtsi128_si32 (_mm_packus_epi16 (sum, sum));
+	}
+}
+
+static void fade_row_sse2 (uint8_t *row, int size, int fade, int decay)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i vfade = _mm_set1_epi16 (fade);
+	const __m128i vdecay = _mm_set1_epi8 ((char) decay);
+	int i;
+
+	for (i = 0; i + 16 <= size; i += 16) {
+		__m128i v = _mm_loadu_si128 ((const __m128i *) (row + i));
+
+		if (fade != VISUAL_REMAP_FADE_NONE) {
+			__m128i lo = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_unpacklo_epi8 (v, zero), vfade), 8);
+			__m128i hi = _mm_srli_epi16 (_mm_mullo_epi16 (_mm_unpackhi_epi8 (v, zero), vfade), 8);
+
+			v = _mm_packus_epi16 (lo, hi);
+		}
+
+		_mm_storeu_si128 ((__m128i *) (row + i), _mm_subs_epu8 (v, vdecay));
+	}
+
+	if (i < size)
+		fade_row_c (row + i, size - i, fade, decay);
+}
+
+#endif /* VISUAL_HAVE_SSE2 */
+
+#if defined(VISUAL_HAVE_NEON)
+
+static void weighted_row8_neon (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4) {
+		uint32_t gathered[4];
+		uint8x16_t pixels, w;
+		uint16x8_t lo, hi;
+		uint16x4_t sum;
+		uint32_t out;
+
+		gathered[0] = fetch2x2_8 (src, pitch, coords[i]);
+		gathered[1] = fetch2x2_8 (src, pitch, coords[i + 1]);
+		gathered[2] = fetch2x2_8 (src, pitch, coords[i + 2]);
+		gathered[3] = fetch2x2_8 (src, pitch, coords[i + 3]);
+
+		pixels = vreinterpretq_u8_u32 (vld1q_u32 (gathered));
+		w = vreinterpretq_u8_u32 (vld1q_u32 (weights + i));
+
+		lo = vmull_u8 (vget_low_u8 (pixels), vget_low_u8 (w));
+		hi = vmull_u8 (vget_high_u8 (pixels), vget_high_u8 (w));
+
+		/* Pairwise to top and bottom sums, then to the four pixels */
+		sum = vpadd_u16 (vpadd_u16 (vget_low_u16 (lo), vget_high_u16 (lo)),
+				vpadd_u16 (vget_low_u16 (hi), vget_high_u16 (hi)));
+		sum = vrshr_n_u16 (sum, REMAP_WEIGHT_SHIFT);
+
+		out = vget_lane_u32 (vreinterpret_u32_u8 (vqmovn_u16 (vcombine_u16 (sum, sum))), 0);
+
+		memcpy (dest + i, &out, 4);
+	}
+
+	if (i < width)
+		weighted_row8_c (dest + i, src, pitch, coords + i, weights + i, width - i);
+}
+
+static void weighted_row32_neon (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	static const uint8_t top_index[8] = { 0, 0, 0, 0, 1, 1, 1, 1 };
+	static const uint8_t bottom_index[8] = { 2, 2, 2, 2, 3, 3, 3, 3 };
+	const uint8x8_t vtop_index = vld1_u8 (top_index);
+	const uint8x8_t vbottom_index = vld1_u8 (bottom_index);
+	int i;
+
+	for (i = 0; i < width; i++) {
+		const uint8_t *p = REMAP_PIXEL (src, pitch, coords[i], 4);
+		uint8x8_t w = vreinterpret_u8_u32 (vdup_n_u32 (weights[i]));
+		uint16x8_t sum;
+		uint16x4_t half;
+
+		sum = vmull_u8 (vld1_u8 (p), vtbl1_u8 (w, vtop_index));
+		sum = vmlal_u8 (sum, vld1_u8 (p + pitch), vtbl1_u8 (w, vbottom_index));
+
+		half = vrshr_n_u16 (vadd_u16 (vget_low_u16 (sum), vget_high_u16 (sum)), REMAP_WEIGHT_SHIFT);
+
+		((uint32_t *) dest)[i] = vget_lane_u32 (vreinterpret_u32_u8 (vqmovn_u16 (vcombine_u16 (half, half))), 0);
+	}
+}
+
+static void average_row32_neon (uint8_t *dest, const uint8_t *src, int pitch,
+		const uint32_t *coords, const uint32_t *weights, int width)
+{
+	int i;
+
+	for (i = 0; i < width; i++, coords += 4) {
+		uint32_t gathered[4];
+		uint8x16_t pixels;
+		uint16x8_t sum;
+		uint16x4_t half;
+
+		gathered[0] = fetch32 (src, pitch, coords[0]);
+		gathered[1] = fetch32 (src, pitch, coords[1]);
+		gathered[2] = fetch32 (src, pitch, coords[2]);
+		gathered[3] = fetch32 (src, pitch, coords[3]);
+
+		pixels = vreinterpretq_u8_u32 (vld1q_u32 (gathered));
+		sum = vaddl_u8 (vget_low_u8 (pixels), vget_high_u8 (pixels));
+
+		half = vshr_n_u16 (vadd_u16 (vget_low_u16 (sum), vget_high_u16 (sum)), 2);
+
+		((uint32_t *) dest)[i] = vget_lane_u32 (vreinterpret_u32_u8 (vmovn_u16 (vcombine_u16 (half, half))), 0);
+	}
+}
+
+static void fade_row_neon (uint8_t *row, int size, int fade, int decay)
+{
+	const uint8x8_t vfade = vdup_n_u8 ((uint8_t) (fade < 255 ? fade : 255));
+	const uint8x16_t vdecay = vdupq_n_u8 ((uint8_t) decay);
+	int i;
+
+	for (i = 0; i + 16 <= size; i += 16) {
+		uint8x16_t v = vld1q_u8 (row + i);
+
+		if (fade != VISUAL_REMAP_FADE_NONE)
+			v = vcombine_u8 (vshrn_n_u16 (vmull_u8 (vget_low_u8 (v), vfade), 8),
+					vshrn_n_u16 (vmull_u8 (vget_high_u8 (v), vfade), 8));
+
+		vst1q_u8 (row + i, vqsubq_u8 (v, vdecay));
+	}
+
+	if (i < size)
+		fade_row_c (row + i, size - i, fade, decay);
+}
+
+#endif /* VISUAL_HAVE_NEON */
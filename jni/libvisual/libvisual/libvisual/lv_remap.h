@@ -0,0 +1,208 @@
+/* Libvisual - The audio visualisation framework.
+ *
+ * Copyright (C) 2004, 2005, 2006 Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _LV_REMAP_H
+#define _LV_REMAP_H
+
+#include <libvisual/lvconfig.h>
+#include <libvisual/lv_defines.h>
+#include <libvisual/lv_types.h>
+#include <libvisual/lv_object.h>
+#include <libvisual/lv_video.h>
+
+/**
+ * @defgroup VisRemap VisRemap
+ * @{
+ */
+
+#define VISUAL_REMAP(obj)				(VISUAL_CHECK_CAST ((obj), VisRemap))
+
+/**
+ * Packs a source coordinate into a VisRemap coordinate entry.
+ */
+#define VISUAL_REMAP_COORD(x, y)			((((uint32_t) (y)) << 16) | ((uint32_t) (x) & 0xffff))
+
+/**
+ * Packs the weights of the top left, top right, bottom left and bottom
+ * right source pixel into a VisRemap weight entry.
+ */
+#define VISUAL_REMAP_WEIGHTS(tl, tr, bl, br)		((uint32_t) (tl) | ((uint32_t) (tr) << 8) | \
+							((uint32_t) (bl) << 16) | ((uint32_t) (br) << 24))
+
+/** The weight of a whole source pixel. The weights of an entry add up to at most this. */
+#define VISUAL_REMAP_WEIGHT_ONE				128
+
+/** A fade that keeps the fetched value as it is. */
+#define VISUAL_REMAP_FADE_NONE				256
+
+/**
+ * How a VisRemap fetches a destination pixel from the source.
+ */
+typedef enum {
+	VISUAL_REMAP_FETCH_NEAREST,	/**< Copies the one source pixel. */
+	VISUAL_REMAP_FETCH_WEIGHTED,	/**< Weighs the 2x2 source pixels from the coordinate right and down. */
+	VISUAL_REMAP_FETCH_AVERAGE4	/**< Averages four source pixels anywhere in the source. */
+} VisRemapFetch;
+
+/**
+ * A VisRemap is a displacement map: for every destination pixel, where in
+ * the previous frame to take it from. Feedback visualisers whose warp only
+ * changes now and then warp their last frame through one of these every
+ * frame. Warps that change every frame, or that blend the fetched value
+ * with the pixel being replaced, don't fit it.
+ *
+ * Coordinates are packed with VISUAL_REMAP_COORD(). Nearest fetch has
+ * one per pixel, average4 fetch four, the first four belonging to the
+ * first pixel. Weighted fetch has one coordinate and one
+ * VISUAL_REMAP_WEIGHTS() entry per pixel.
+ *
+ * The fetched value is then faded, multiplied by fade / 256, and decayed,
+ * decay is subtracted with a floor of 0. Both are per channel.
+ *
+ * Applying runs in bands of rows on worker threads, with SSE2 or NEON
+ * kernels where the CPU has them.
+ */
+typedef struct _VisRemap VisRemap;
+
+LV_BEGIN_DECLS
+
+/**
+ * Creates a new VisRemap. All coordinates point at the top left pixel,
+ * all weights are zero.
+ *
+ * @param width Width of the map and of the videos it is applied to.
+ * @param height Height of the map.
+ * @param fetch How pixels are fetched. Weighted fetch needs a width and height of at least 2.
+ *
+ * @return A newly allocated VisRemap, or NULL on failure.
+ */
+LV_API VisRemap *visual_remap_new (int width, int height, VisRemapFetch fetch);
+
+LV_API int visual_remap_get_width (VisRemap *remap);
+LV_API int visual_remap_get_height (VisRemap *remap);
+LV_API VisRemapFetch visual_remap_get_fetch (VisRemap *remap);
+
+/**
+ * Gives the coordinate entries, for filling a VisRemap directly. Every
+ * coordinate must lie within the map, for weighted fetch also one pixel
+ * away from the right and bottom edge.
+ *
+ * @param remap Pointer to the VisRemap.
+ *
+ * @return The coordinates, row by row, or NULL on failure.
+ */
+LV_API uint32_t *visual_remap_get_coords (VisRemap *remap);
+
+/**
+ * Gives the weight entries of a weighted VisRemap.
+ *
+ * @param remap Pointer to the VisRemap.
+ *
+ * @return The weights, row by row, or NULL when the VisRemap isn't weighted.
+ */
+LV_API uint32_t *visual_remap_get_weights (VisRemap *remap);
+
+/**
+ * Points a destination pixel at a source position. Weighted fetch spreads
+ * the pixel over the four source pixels around the position, nearest
+ * fetch rounds it down and average4 fetch points all four taps at it.
+ * Positions outside the map are clamped to the edge.
+ *
+ * @param remap Pointer to the VisRemap.
+ * @param x X coordinate of the destination pixel.
+ * @param y Y coordinate of the destination pixel.
+ * @param sx X position in the source.
+ * @param sy Y position in the source.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_REMAP_NULL or -VISUAL_ERROR_REMAP_OUT_OF_BOUNDS on failure.
+ */
+LV_API int visual_remap_set_point (VisRemap *remap, int x, int y, float sx, float sy);
+
+/**
+ * Points one tap of a destination pixel at a source pixel. Nearest and
+ * weighted fetch have tap 0 only, average4 fetch has taps 0 to 3.
+ * Weights are left alone. Positions outside the map are clamped to the
+ * edge.
+ *
+ * @param remap Pointer to the VisRemap.
+ * @param x X coordinate of the destination pixel.
+ * @param y Y coordinate of the destination pixel.
+ * @param tap The tap.
+ * @param sx X coordinate of the source pixel.
+ * @param sy Y coordinate of the source pixel.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_REMAP_NULL or -VISUAL_ERROR_REMAP_OUT_OF_BOUNDS on failure.
+ */
+LV_API int visual_remap_set_tap (VisRemap *remap, int x, int y, int tap, int sx, int sy);
+
+/**
+ * Sets what fetched values are multiplied by, in 256ths.
+ *
+ * @param remap Pointer to the VisRemap.
+ * @param fade From 0 to VISUAL_REMAP_FADE_NONE, which is the default.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_REMAP_NULL on failure.
+ */
+LV_API int visual_remap_set_fade (VisRemap *remap, int fade);
+
+/**
+ * Sets what is subtracted from every channel of a fetched value, after
+ * fading.
+ *
+ * @param remap Pointer to the VisRemap.
+ * @param decay From 0, the default, to 255.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_REMAP_NULL on failure.
+ */
+LV_API int visual_remap_set_decay (VisRemap *remap, int decay);
+
+/**
+ * Warps a video through a VisRemap. Both videos must be the size of the
+ * map and of the same 8 or 32 bit depth. They must not share pixels.
+ *
+ * @param remap Pointer to the VisRemap.
+ * @param dest The video to write.
+ * @param src The video to fetch from.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_REMAP_NULL, -VISUAL_ERROR_VIDEO_NULL,
+ *	-VISUAL_ERROR_VIDEO_INVALID_DEPTH or -VISUAL_ERROR_VIDEO_NOT_INDENTICAL on failure.
+ */
+LV_API int visual_remap_apply (VisRemap *remap, VisVideo *dest, VisVideo *src);
+
+/**
+ * Sets the number of threads visual_remap_apply() divides a frame over.
+ *
+ * @param threads Number of threads including the calling one, 0 for one per CPU.
+ */
+LV_API void visual_remap_set_threads (int threads);
+
+/**
+ * Gives the number of threads visual_remap_apply() uses.
+ *
+ * @return The number of threads.
+ */
+LV_API int visual_remap_get_threads (void);
+
+LV_END_DECLS
+
+/**
+ * @}
+ */
+
+#endif /* _LV_REMAP_H */
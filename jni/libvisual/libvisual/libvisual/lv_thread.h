@@ -31,6 +31,13 @@ typedef struct _VisThread VisThread;
  */
 typedef struct _VisMutex VisMutex;
 
+/**
+ * The VisCond data structure and the VisCond subsystem is a wrapper
+ * system for native condition variable implementations. A VisCond is
+ * always used together with a VisMutex.
+ */
+typedef struct _VisCond VisCond;
+
 /**
  * The function defination for a function that forms the base of a new
  * VisThread when visual_thread_create is used.
@@ -166,6 +173,58 @@ LV_API int visual_mutex_trylock (VisMutex *mutex);
  */
 LV_API int visual_mutex_unlock (VisMutex *mutex);
 
+/**
+ * Creates a new VisCond that is used to let threads wait on each
+ * other until a certain condition, protected by a VisMutex, is met.
+ *
+ * @return A newly allocated VisCond or NULL on failure.
+ */
+LV_API VisCond *visual_cond_new (void);
+
+/**
+ * Frees a VisCond. No thread may be waiting on the VisCond when it
+ * is freed.
+ *
+ * @param cond Pointer to the VisCond that needs to be freed.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_COND_NULL or
+ *	-VISUAL_ERROR_THREAD_NOT_SUPPORTED on failure.
+ */
+LV_API int visual_cond_free (VisCond *cond);
+
+/**
+ * Atomically unlocks the VisMutex and blocks until the VisCond is
+ * signalled. The VisMutex is locked again before returning. Spurious
+ * wakeups are possible, so the condition must be checked in a loop.
+ *
+ * @param cond Pointer to the VisCond to wait on.
+ * @param mutex Pointer to the VisMutex, locked by the calling thread.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_COND_NULL, -VISUAL_ERROR_MUTEX_NULL,
+ *	-VISUAL_ERROR_COND_WAIT_FAILURE or -VISUAL_ERROR_THREAD_NOT_SUPPORTED on failure.
+ */
+LV_API int visual_cond_wait (VisCond *cond, VisMutex *mutex);
+
+/**
+ * Wakes up one of the threads waiting on the VisCond.
+ *
+ * @param cond Pointer to the VisCond to signal.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_COND_NULL or
+ *	-VISUAL_ERROR_THREAD_NOT_SUPPORTED on failure.
+ */
+LV_API int visual_cond_signal (VisCond *cond);
+
+/**
+ * Wakes up all threads waiting on the VisCond.
+ *
+ * @param cond Pointer to the VisCond to broadcast.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_COND_NULL or
+ *	-VISUAL_ERROR_THREAD_NOT_SUPPORTED on failure.
+ */
+LV_API int visual_cond_broadcast (VisCond *cond);
+
 LV_END_DECLS
 
 /**
@@ -26,6 +26,8 @@
 #include "lv_common.h"
 #include "gettext.h"
 
+#ifndef VISUAL_HAVE_THREADS
+
 int visual_thread_initialize (void)
 {
     return FALSE;
@@ -106,3 +108,40 @@ int visual_mutex_unlock (VisMutex *mutex)
 
     return -VISUAL_ERROR_THREAD_NOT_SUPPORTED;
 }
+
+VisCond *visual_cond_new (void)
+{
+    visual_log (VISUAL_LOG_ERROR, "Threading is not supported");
+
+    return NULL;
+}
+
+int visual_cond_free (VisCond *cond)
+{
+    visual_log (VISUAL_LOG_ERROR, "Threading is not supported");
+
+    return -VISUAL_ERROR_THREAD_NOT_SUPPORTED;
+}
+
+int visual_cond_wait (VisCond *cond, VisMutex *mutex)
+{
+    visual_log (VISUAL_LOG_ERROR, "Threading is not supported");
+
+    return -VISUAL_ERROR_THREAD_NOT_SUPPORTED;
+}
+
+int visual_cond_signal (VisCond *cond)
+{
+    visual_log (VISUAL_LOG_ERROR, "Threading is not supported");
+
+    return -VISUAL_ERROR_THREAD_NOT_SUPPORTED;
+}
+
+int visual_cond_broadcast (VisCond *cond)
+{
+    visual_log (VISUAL_LOG_ERROR, "Threading is not supported");
+
+    return -VISUAL_ERROR_THREAD_NOT_SUPPORTED;
+}
+
+#endif /* !VISUAL_HAVE_THREADS */
@@ -504,6 +504,12 @@ VisVideoComposeFunc visual_video_get_compose_function (VisVideo *dest, VisVideo
 			else
 				return blit_overlay_alphasrc;
 
+		case VISUAL_VIDEO_COMPOSE_TYPE_SRC_PREMULTIPLIED:
+			if (!alpha || src->depth != VISUAL_VIDEO_DEPTH_32BIT)
+				return blit_overlay_noalpha;
+			else
+				return blit_overlay_alphasrc_premultiplied;
+
 		case VISUAL_VIDEO_COMPOSE_TYPE_COLORKEY:
 			return blit_overlay_colorkey;
 
@@ -1124,7 +1130,8 @@ void visual_video_convert_depth (VisVideo *dest, VisVideo *src)
 static inline int is_valid_scale_method (VisVideoScaleMethod scale_method)
 {
     return scale_method == VISUAL_VIDEO_SCALE_NEAREST
-	    || scale_method == VISUAL_VIDEO_SCALE_BILINEAR;
+	    || scale_method == VISUAL_VIDEO_SCALE_BILINEAR
+	    || scale_method == VISUAL_VIDEO_SCALE_AREA;
 }
 
 void visual_video_scale (VisVideo *dest, VisVideo *src, VisVideoScaleMethod method)
@@ -1147,6 +1154,8 @@ void visual_video_scale (VisVideo *dest, VisVideo *src, VisVideoScaleMethod meth
 				visual_video_scale_nearest_color8 (dest, src);
 			else if (method == VISUAL_VIDEO_SCALE_BILINEAR)
 				visual_video_scale_bilinear_color8 (dest, src);
+			else
+				visual_video_scale_area_color8 (dest, src);
 
 			break;
 
@@ -1155,6 +1164,8 @@ void visual_video_scale (VisVideo *dest, VisVideo *src, VisVideoScaleMethod meth
 				visual_video_scale_nearest_color16 (dest, src);
 			else if (method == VISUAL_VIDEO_SCALE_BILINEAR)
 				visual_video_scale_bilinear_color16 (dest, src);
+			else
+				visual_video_scale_area_color16 (dest, src);
 
 			break;
 
@@ -1163,18 +1174,18 @@ void visual_video_scale (VisVideo *dest, VisVideo *src, VisVideoScaleMethod meth
 				visual_video_scale_nearest_color24 (dest, src);
 			else if (method == VISUAL_VIDEO_SCALE_BILINEAR)
 				visual_video_scale_bilinear_color24 (dest, src);
+			else
+				visual_video_scale_area_color24 (dest, src);
 
 			break;
 
 		case VISUAL_VIDEO_DEPTH_32BIT:
 			if (method == VISUAL_VIDEO_SCALE_NEAREST)
 				visual_video_scale_nearest_color32 (dest, src);
-			else if (method == VISUAL_VIDEO_SCALE_BILINEAR) {
-				if (visual_cpu_has_mmx ())
-					_lv_scale_bilinear_32_mmx (dest, src);
-				else
-					visual_video_scale_bilinear_color32 (dest, src);
-			}
+			else if (method == VISUAL_VIDEO_SCALE_BILINEAR)
+				visual_video_scale_bilinear_color32 (dest, src);
+			else
+				visual_video_scale_area_color32 (dest, src);
 
 			break;
 
@@ -92,7 +92,8 @@ typedef enum {
  */
 typedef enum {
 	VISUAL_VIDEO_SCALE_NEAREST  = 0,    /**< Nearest neighbour. */
-	VISUAL_VIDEO_SCALE_BILINEAR = 1	    /**< Bilinearly interpolated. */
+	VISUAL_VIDEO_SCALE_BILINEAR = 1,    /**< Bilinearly interpolated. */
+	VISUAL_VIDEO_SCALE_AREA     = 2	    /**< Averaged over the covered area, for downscaling. */
 } VisVideoScaleMethod;
 
 /**
@@ -104,7 +105,8 @@ typedef enum {
 	VISUAL_VIDEO_COMPOSE_TYPE_COLORKEY,   /**< Colorkey alpha. */
 	VISUAL_VIDEO_COMPOSE_TYPE_SURFACE,    /**< One alpha channel for the complete surface. */
 	VISUAL_VIDEO_COMPOSE_TYPE_SURFACECOLORKEY, /**< Use surface alpha on colorkey. */
-	VISUAL_VIDEO_COMPOSE_TYPE_CUSTOM      /**< Custom compose function (looks up on the source VisVideo. */
+	VISUAL_VIDEO_COMPOSE_TYPE_CUSTOM,     /**< Custom compose function (looks up on the source VisVideo. */
+	VISUAL_VIDEO_COMPOSE_TYPE_SRC_PREMULTIPLIED /**< Source alpha channel, colors premultiplied by it. */
 } VisVideoComposeType;
 
 
@@ -503,6 +505,21 @@ LV_API void visual_video_scale (VisVideo *dest, VisVideo *src, VisVideoScaleMeth
  */
 LV_API void visual_video_scale_depth (VisVideo *dest, VisVideo *src, VisVideoScaleMethod scale_method);
 
+/**
+ * Sets the number of threads visual_video_scale() divides bilinear and
+ * area scaling over. Every thread scales a band of destination rows.
+ *
+ * @param threads Number of threads including the calling one, 0 for one per CPU.
+ */
+LV_API void visual_video_scale_set_threads (int threads);
+
+/**
+ * Gives the number of threads visual_video_scale() uses.
+ *
+ * @return The number of threads.
+ */
+LV_API int visual_video_scale_get_threads (void);
+
 
 /**
  * Checks if a certain depth is supported by checking against an ORred depthflag.
@@ -610,7 +627,6 @@ LV_API int visual_video_bpp_from_depth (VisVideoDepth depth);
 /* Optimized versions of performance sensitive routines */
 /* mmx from lv_video_simd.c */ /* FIXME can we do this nicer ? */
 int _lv_blit_overlay_alphasrc_mmx (VisVideo *dest, VisVideo *src);
-int _lv_scale_bilinear_32_mmx (VisVideo *dest, VisVideo *src);
 
 LV_END_DECLS
 
@@ -0,0 +1,262 @@
+/* Libvisual - The audio visualisation framework.
+ *
+ * Copyright (C) 2004, 2005, 2006 Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "config.h"
+#include "lv_worker_pool.h"
+#include "lv_common.h"
+#include "lv_cpu.h"
+#include "lv_thread.h"
+
+/* Jobs are handed out one at a time under the mutex. They are meant to be
+ * coarse, a band of rows and not a pixel, so the lock is not contended.
+ *
+ * Workers sleep on work_cond until a run publishes new jobs or the pool
+ * stops them. The last thread to finish a job signals done_cond, which
+ * the thread that started the run waits on. */
+
+#define WORKER_POOL_MAX_THREADS		16
+
+struct _VisWorkerPool {
+	VisObject	 object;
+
+	int		 threads;
+	int		 started;
+	VisThread	*workers[WORKER_POOL_MAX_THREADS];
+
+	VisMutex	*run_mutex;
+	VisMutex	*mutex;
+	VisCond		*work_cond;
+	VisCond		*done_cond;
+
+	/* Current run, protected by mutex */
+	VisWorkerFunc	 func;
+	void		*data;
+	int		 count;
+	int		 next;
+	int		 pending;
+	int		 quit;
+};
+
+static int worker_pool_dtor (VisObject *object);
+
+static int threads_wanted (int threads);
+static void *worker_thread (void *data);
+static void run_jobs_locked (VisWorkerPool *pool);
+static void start_workers (VisWorkerPool *pool);
+static void stop_workers (VisWorkerPool *pool);
+
+
+static int worker_pool_dtor (VisObject *object)
+{
+	VisWorkerPool *pool = VISUAL_WORKER_POOL (object);
+
+	if (pool->mutex != NULL) {
+		stop_workers (pool);
+
+		visual_mutex_free (pool->run_mutex);
+		visual_mutex_free (pool->mutex);
+		visual_cond_free (pool->work_cond);
+		visual_cond_free (pool->done_cond);
+	}
+
+	pool->run_mutex = NULL;
+	pool->mutex = NULL;
+	pool->work_cond = NULL;
+	pool->done_cond = NULL;
+
+	return VISUAL_OK;
+}
+
+static int threads_wanted (int threads)
+{
+	if (!visual_thread_is_supported ())
+		return 1;
+
+	if (threads <= 0)
+		threads = visual_cpu_get_caps ()->nrcpu;
+
+	if (threads < 1)
+		threads = 1;
+
+	return threads > WORKER_POOL_MAX_THREADS ? WORKER_POOL_MAX_THREADS : threads;
+}
+
+/* Takes and runs jobs until none are left, called with the mutex held */
+static void run_jobs_locked (VisWorkerPool *pool)
+{
+	while (pool->next < pool->count) {
+		int index = pool->next++;
+
+		visual_mutex_unlock (pool->mutex);
+
+		pool->func (pool->data, index, pool->count);
+
+		visual_mutex_lock (pool->mutex);
+
+		if (--pool->pending == 0)
+			visual_cond_signal (pool->done_cond);
+	}
+}
+
+static void *worker_thread (void *data)
+{
+	VisWorkerPool *pool = data;
+
+	visual_mutex_lock (pool->mutex);
+
+	while (!pool->quit) {
+		if (pool->next < pool->count)
+			run_jobs_locked (pool);
+		else
+			visual_cond_wait (pool->work_cond, pool->mutex);
+	}
+
+	visual_mutex_unlock (pool->mutex);
+
+	return NULL;
+}
+
+static void start_workers (VisWorkerPool *pool)
+{
+	int i;
+
+	pool->quit = FALSE;
+
+	for (i = 0; i < pool->threads - 1; i++) {
+		pool->workers[i] = visual_thread_create (worker_thread, pool, TRUE);
+
+		if (pool->workers[i] == NULL)
+			break;
+	}
+
+	pool->started = i;
+}
+
+static void stop_workers (VisWorkerPool *pool)
+{
+	int i;
+
+	if (pool->started == 0)
+		return;
+
+	visual_mutex_lock (pool->mutex);
+	pool->quit = TRUE;
+	visual_cond_broadcast (pool->work_cond);
+	visual_mutex_unlock (pool->mutex);
+
+	for (i = 0; i < pool->started; i++) {
+		visual_thread_join (pool->workers[i]);
+		visual_thread_free (pool->workers[i]);
+
+		pool->workers[i] = NULL;
+	}
+
+	pool->started = 0;
+}
+
+VisWorkerPool *visual_worker_pool_new (int threads)
+{
+	VisWorkerPool *pool;
+
+	pool = visual_mem_new0 (VisWorkerPool, 1);
+
+	/* Do the VisObject initialization */
+	visual_object_initialize (VISUAL_OBJECT (pool), TRUE, worker_pool_dtor);
+
+	pool->threads = threads_wanted (threads);
+
+	if (visual_thread_is_supported ()) {
+		pool->run_mutex = visual_mutex_new ();
+		pool->mutex = visual_mutex_new ();
+		pool->work_cond = visual_cond_new ();
+		pool->done_cond = visual_cond_new ();
+	}
+
+	return pool;
+}
+
+int visual_worker_pool_set_threads (VisWorkerPool *pool, int threads)
+{
+	visual_return_val_if_fail (pool != NULL, -VISUAL_ERROR_WORKER_POOL_NULL);
+
+	if (pool->mutex == NULL)
+		return VISUAL_OK;
+
+	visual_mutex_lock (pool->run_mutex);
+
+	stop_workers (pool);
+	pool->threads = threads_wanted (threads);
+
+	visual_mutex_unlock (pool->run_mutex);
+
+	return VISUAL_OK;
+}
+
+int visual_worker_pool_get_threads (VisWorkerPool *pool)
+{
+	visual_return_val_if_fail (pool != NULL, -VISUAL_ERROR_WORKER_POOL_NULL);
+
+	return pool->threads;
+}
+
+int visual_worker_pool_run (VisWorkerPool *pool, VisWorkerFunc func, void *data, int count)
+{
+	int i;
+
+	visual_return_val_if_fail (pool != NULL, -VISUAL_ERROR_WORKER_POOL_NULL);
+	visual_return_val_if_fail (func != NULL, -VISUAL_ERROR_NULL);
+
+	if (pool->threads == 1 || count < 2) {
+		for (i = 0; i < count; i++)
+			func (data, i, count);
+
+		return VISUAL_OK;
+	}
+
+	visual_mutex_lock (pool->run_mutex);
+
+	if (pool->started == 0)
+		start_workers (pool);
+
+	visual_mutex_lock (pool->mutex);
+
+	pool->func = func;
+	pool->data = data;
+	pool->count = count;
+	pool->next = 0;
+	pool->pending = count;
+
+	visual_cond_broadcast (pool->work_cond);
+
+	run_jobs_locked (pool);
+
+	while (pool->pending > 0)
+		visual_cond_wait (pool->done_cond, pool->mutex);
+
+	pool->func = NULL;
+	pool->data = NULL;
+	pool->count = 0;
+	pool->next = 0;
+
+	visual_mutex_unlock (pool->mutex);
+
+	visual_mutex_unlock (pool->run_mutex);
+
+	return VISUAL_OK;
+}
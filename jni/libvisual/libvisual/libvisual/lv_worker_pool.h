@@ -0,0 +1,106 @@
+/* Libvisual - The audio visualisation framework.
+ *
+ * Copyright (C) 2004, 2005, 2006 Dennis Smit <ds@nerds-incorporated.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef _LV_WORKER_POOL_H
+#define _LV_WORKER_POOL_H
+
+#include <libvisual/lvconfig.h>
+#include <libvisual/lv_defines.h>
+#include <libvisual/lv_types.h>
+#include <libvisual/lv_object.h>
+
+/**
+ * @defgroup VisWorkerPool VisWorkerPool
+ * @{
+ */
+
+#define VISUAL_WORKER_POOL(obj)				(VISUAL_CHECK_CAST ((obj), VisWorkerPool))
+
+/**
+ * A VisWorkerPool runs a number of independent jobs, such as the row
+ * bands of an image, on a small set of persistent threads. The thread
+ * calling visual_worker_pool_run() takes jobs as well and returns once
+ * all of them are done, so a pool of one thread simply runs the jobs in
+ * order. Worker threads are started on first use and sleep between runs.
+ *
+ * Runs on the same pool from different threads are serialized. A job
+ * must not run the pool it is running on.
+ */
+typedef struct _VisWorkerPool VisWorkerPool;
+
+/**
+ * A job function.
+ *
+ * @param data The data passed to visual_worker_pool_run().
+ * @param index Index of the job, from 0 to count - 1.
+ * @param count The total number of jobs in this run.
+ */
+typedef void (*VisWorkerFunc) (void *data, int index, int count);
+
+LV_BEGIN_DECLS
+
+/**
+ * Creates a new VisWorkerPool.
+ *
+ * @param threads Number of threads including the calling one, 0 for one per CPU.
+ *
+ * @return A newly allocated VisWorkerPool.
+ */
+LV_API VisWorkerPool *visual_worker_pool_new (int threads);
+
+/**
+ * Changes the number of threads of a VisWorkerPool. Running workers are
+ * stopped, the new ones are started on the next run.
+ *
+ * @param pool Pointer to the VisWorkerPool.
+ * @param threads Number of threads including the calling one, 0 for one per CPU.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_WORKER_POOL_NULL on failure.
+ */
+LV_API int visual_worker_pool_set_threads (VisWorkerPool *pool, int threads);
+
+/**
+ * Gives the number of threads a VisWorkerPool runs jobs on. This is 1
+ * when threads are not supported.
+ *
+ * @param pool Pointer to the VisWorkerPool.
+ *
+ * @return The number of threads, or -VISUAL_ERROR_WORKER_POOL_NULL on failure.
+ */
+LV_API int visual_worker_pool_get_threads (VisWorkerPool *pool);
+
+/**
+ * Runs count jobs and waits for all of them to finish.
+ *
+ * @param pool Pointer to the VisWorkerPool.
+ * @param func The job function.
+ * @param data Data passed to every job.
+ * @param count Number of jobs.
+ *
+ * @return VISUAL_OK on success, -VISUAL_ERROR_WORKER_POOL_NULL or -VISUAL_ERROR_NULL on failure.
+ */
+LV_API int visual_worker_pool_run (VisWorkerPool *pool, VisWorkerFunc func, void *data, int count);
+
+LV_END_DECLS
+
+/**
+ * @}
+ */
+
+#endif /* _LV_WORKER_POOL_H */
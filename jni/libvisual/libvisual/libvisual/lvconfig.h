@@ -60,9 +60,9 @@ typedef unsigned int visual_size_t;
 /* #undef VISUAL_WITH_CYGWIN */
 /* #undef VISUAL_WITH_MINGW */
 
-/*#define VISUAL_HAVE_THREADS*/
+#define VISUAL_HAVE_THREADS
 /* #undef VISUAL_THREAD_MODEL_WIN32 */
-/*#define VISUAL_THREAD_MODEL_POSIX*/
+#define VISUAL_THREAD_MODEL_POSIX
 /* #undef VISUAL_THREAD_MODEL_DCE */
 /* #undef VISUAL_THREAD_MODEL_GTHREAD2 */
 
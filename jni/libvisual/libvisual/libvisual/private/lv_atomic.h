@@ -0,0 +1,93 @@
+#ifndef _LV_ATOMIC_H
+#define _LV_ATOMIC_H
+
+#include "lv_types.h"
+
+/* Minimal set of atomic operations, enough for the lock free single
+ * producer, single consumer structures in libvisual. */
+
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+
+static inline uint32_t visual_atomic_load_u32_acquire (const uint32_t *ptr)
+{
+	return __atomic_load_n (ptr, __ATOMIC_ACQUIRE);
+}
+
+static inline void visual_atomic_store_u32_release (uint32_t *ptr, uint32_t value)
+{
+	__atomic_store_n (ptr, value, __ATOMIC_RELEASE);
+}
+
+static inline void visual_atomic_fence (void)
+{
+	__atomic_thread_fence (__ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t visual_atomic_inc_u32 (uint32_t *ptr)
+{
+	return __atomic_add_fetch (ptr, 1, __ATOMIC_RELAXED);
+}
+
+#elif defined(__GNUC__)
+
+static inline uint32_t visual_atomic_load_u32_acquire (const uint32_t *ptr)
+{
+	uint32_t value = *(const volatile uint32_t *) ptr;
+
+	__sync_synchronize ();
+
+	return value;
+}
+
+static inline void visual_atomic_store_u32_release (uint32_t *ptr, uint32_t value)
+{
+	__sync_synchronize ();
+
+	*(volatile uint32_t *) ptr = value;
+}
+
+static inline void visual_atomic_fence (void)
+{
+	__sync_synchronize ();
+}
+
+static inline uint32_t visual_atomic_inc_u32 (uint32_t *ptr)
+{
+	return __sync_add_and_fetch (ptr, 1);
+}
+
+#elif defined(_MSC_VER)
+
+#include <windows.h>
+
+static __inline uint32_t visual_atomic_load_u32_acquire (const uint32_t *ptr)
+{
+	uint32_t value = *(const volatile uint32_t *) ptr;
+
+	MemoryBarrier ();
+
+	return value;
+}
+
+static __inline void visual_atomic_store_u32_release (uint32_t *ptr, uint32_t value)
+{
+	MemoryBarrier ();
+
+	*(volatile uint32_t *) ptr = value;
+}
+
+static __inline void visual_atomic_fence (void)
+{
+	MemoryBarrier ();
+}
+
+static __inline uint32_t visual_atomic_inc_u32 (uint32_t *ptr)
+{
+	return (uint32_t) InterlockedIncrement ((volatile LONG *) ptr);
+}
+
+#else
+# error "No atomic operations available for this compiler"
+#endif
+
+#endif /* _LV_ATOMIC_H */
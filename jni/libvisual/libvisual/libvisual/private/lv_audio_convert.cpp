@@ -2,6 +2,8 @@
 #include "lv_audio_convert.h"
 #include "lv_audio.h"
 #include "lv_mem.h"
+#include "lv_cpu.h"
+#include "lv_simd.h"
 #include "lv_enable_if.hpp"
 #include "lv_int_traits.hpp"
 #include <limits>
@@ -98,8 +100,8 @@ namespace {
   typename enable_if<is_integral<S> >::type
   inline convert_sample_array (float* dst, S const* src, std::size_t count)
   {
-      float a = 1.0 / (half_range<S> () + 1);
-      float b = -zero<S>() * a;
+      float a = 1.0 / (double (half_range<S> ()) + 1);
+      float b = -float (zero<S> ()) * a;
 
       S const* src_end = src + count;
 
@@ -287,6 +289,333 @@ namespace {
       }
   };
 
+  // strided int->float conversion, reads every stride-th sample
+  template <typename S>
+  typename enable_if<is_integral<S> >::type
+  inline convert_sample_array_to_float (float* dst, S const* src, std::size_t count, std::size_t stride)
+  {
+      float a = 1.0 / (double (half_range<S> ()) + 1);
+      float b = -float (zero<S> ()) * a;
+
+      float* dst_end = dst + count;
+
+      while (dst != dst_end) {
+          *dst = *src * a + b;
+          dst++;
+          src += stride;
+      }
+  }
+
+  // strided float->float copy
+  inline void convert_sample_array_to_float (float* dst, float const* src, std::size_t count, std::size_t stride)
+  {
+      if (stride == 1) {
+          visual_mem_copy (dst, src, sizeof (float) * count);
+          return;
+      }
+
+      float* dst_end = dst + count;
+
+      while (dst != dst_end) {
+          *dst = *src;
+          dst++;
+          src += stride;
+      }
+  }
+
+  template <typename S>
+  void convert_to_float (float* dst, void const* src, std::size_t count, std::size_t stride)
+  {
+      convert_sample_array_to_float (dst, static_cast<S const*> (src), count, stride);
+  }
+
+  typedef void (*ConvertToFloatFunc)(float*, void const*, std::size_t, std::size_t);
+
+  ConvertToFloatFunc const convert_to_float_func_table[7] = {
+      convert_to_float<uint8_t>,
+      convert_to_float<int8_t>,
+      convert_to_float<uint16_t>,
+      convert_to_float<int16_t>,
+      convert_to_float<uint32_t>,
+      convert_to_float<int32_t>,
+      convert_to_float<float>
+  };
+
+#if defined(VISUAL_HAVE_SSE2) || defined(VISUAL_HAVE_NEON)
+
+  // The SIMD kernels below convert as many leading samples as they can in
+  // whole vectors and return that number, the scalar code does the rest.
+  // A vector may only be loaded if it does not reach past the last source
+  // sample, which matters when picking one channel out of interleaved data.
+  inline bool vector_fits (std::size_t i, std::size_t n, std::size_t count, std::size_t stride)
+  {
+      return (i + n) * stride <= (count - 1) * stride + 1;
+  }
+
+#endif
+
+#if defined(VISUAL_HAVE_SSE2)
+
+  inline void store_s16x8_sse2 (float* dst, __m128i v, __m128 scale)
+  {
+      __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16);
+      __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16);
+
+      _mm_storeu_ps (dst,     _mm_mul_ps (_mm_cvtepi32_ps (lo), scale));
+      _mm_storeu_ps (dst + 4, _mm_mul_ps (_mm_cvtepi32_ps (hi), scale));
+  }
+
+  // Unsigned formats are flipped into signed ones by toggling the top bit,
+  // which is the same as subtracting zero<T>()
+  std::size_t convert_8_to_float_sse2 (float* dst, uint8_t const* src, std::size_t count, std::size_t stride, bool is_unsigned)
+  {
+      __m128 const scale = _mm_set1_ps (1.0f / 128.0f);
+      __m128i const flip = _mm_set1_epi8 (is_unsigned ? char (0x80) : 0);
+      std::size_t i = 0;
+
+      if (stride == 1) {
+          for (; vector_fits (i, 16, count, 1); i += 16) {
+              __m128i v = _mm_xor_si128 (_mm_loadu_si128 ((__m128i const*) (src + i)), flip);
+
+              store_s16x8_sse2 (dst + i,     _mm_srai_epi16 (_mm_unpacklo_epi8 (v, v), 8), scale);
+              store_s16x8_sse2 (dst + i + 8, _mm_srai_epi16 (_mm_unpackhi_epi8 (v, v), 8), scale);
+          }
+      } else if (stride == 2) {
+          for (; vector_fits (i, 16, count, 2); i += 16) {
+              __m128i a = _mm_xor_si128 (_mm_loadu_si128 ((__m128i const*) (src + i * 2)), flip);
+              __m128i b = _mm_xor_si128 (_mm_loadu_si128 ((__m128i const*) (src + i * 2 + 16)), flip);
+
+              store_s16x8_sse2 (dst + i,     _mm_srai_epi16 (_mm_slli_epi16 (a, 8), 8), scale);
+              store_s16x8_sse2 (dst + i + 8, _mm_srai_epi16 (_mm_slli_epi16 (b, 8), 8), scale);
+          }
+      }
+
+      return i;
+  }
+
+  std::size_t convert_16_to_float_sse2 (float* dst, uint16_t const* src, std::size_t count, std::size_t stride, bool is_unsigned)
+  {
+      __m128 const scale = _mm_set1_ps (1.0f / 32768.0f);
+      __m128i const flip = _mm_set1_epi16 (is_unsigned ? short (0x8000) : 0);
+      std::size_t i = 0;
+
+      if (stride == 1) {
+          for (; vector_fits (i, 8, count, 1); i += 8) {
+              __m128i v = _mm_xor_si128 (_mm_loadu_si128 ((__m128i const*) (src + i)), flip);
+
+              store_s16x8_sse2 (dst + i, v, scale);
+          }
+      } else if (stride == 2) {
+          for (; vector_fits (i, 8, count, 2); i += 8) {
+              __m128i a = _mm_xor_si128 (_mm_loadu_si128 ((__m128i const*) (src + i * 2)), flip);
+              __m128i b = _mm_xor_si128 (_mm_loadu_si128 ((__m128i const*) (src + i * 2 + 8)), flip);
+
+              // Sign extend the even lanes
+              a = _mm_srai_epi32 (_mm_slli_epi32 (a, 16), 16);
+              b = _mm_srai_epi32 (_mm_slli_epi32 (b, 16), 16);
+
+              _mm_storeu_ps (dst + i,     _mm_mul_ps (_mm_cvtepi32_ps (a), scale));
+              _mm_storeu_ps (dst + i + 4, _mm_mul_ps (_mm_cvtepi32_ps (b), scale));
+          }
+      }
+
+      return i;
+  }
+
+  std::size_t convert_32_to_float_sse2 (float* dst, uint32_t const* src, std::size_t count, std::size_t stride, bool is_unsigned)
+  {
+      __m128 const scale = _mm_set1_ps (1.0f / 2147483648.0f);
+      __m128i const flip = _mm_set1_epi32 (is_unsigned ? int (0x80000000) : 0);
+      std::size_t i = 0;
+
+      if (stride == 1) {
+          for (; vector_fits (i, 4, count, 1); i += 4) {
+              __m128i v = _mm_xor_si128 (_mm_loadu_si128 ((__m128i const*) (src + i)), flip);
+
+              _mm_storeu_ps (dst + i, _mm_mul_ps (_mm_cvtepi32_ps (v), scale));
+          }
+      } else if (stride == 2) {
+          for (; vector_fits (i, 4, count, 2); i += 4) {
+              __m128i a = _mm_shuffle_epi32 (_mm_loadu_si128 ((__m128i const*) (src + i * 2)), _MM_SHUFFLE (3, 1, 2, 0));
+              __m128i b = _mm_shuffle_epi32 (_mm_loadu_si128 ((__m128i const*) (src + i * 2 + 4)), _MM_SHUFFLE (3, 1, 2, 0));
+              __m128i v = _mm_xor_si128 (_mm_unpacklo_epi64 (a, b), flip);
+
+              _mm_storeu_ps (dst + i, _mm_mul_ps (_mm_cvtepi32_ps (v), scale));
+          }
+      }
+
+      return i;
+  }
+
+  std::size_t convert_float_to_float_sse2 (float* dst, float const* src, std::size_t count, std::size_t stride)
+  {
+      std::size_t i = 0;
+
+      // Plain copies are left to visual_mem_copy ()
+      if (stride == 2) {
+          for (; vector_fits (i, 4, count, 2); i += 4) {
+              __m128 a = _mm_loadu_ps (src + i * 2);
+              __m128 b = _mm_loadu_ps (src + i * 2 + 4);
+
+              _mm_storeu_ps (dst + i, _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0)));
+          }
+      }
+
+      return i;
+  }
+
+  std::size_t convert_to_float_simd (float* dst, void const* src, std::size_t count, std::size_t stride, VisAudioSampleFormatType format)
+  {
+      if (!visual_cpu_has_sse2 ())
+          return 0;
+
+      switch (format) {
+          case VISUAL_AUDIO_SAMPLE_FORMAT_U8:
+          case VISUAL_AUDIO_SAMPLE_FORMAT_S8:
+              return convert_8_to_float_sse2 (dst, static_cast<uint8_t const*> (src), count, stride,
+                                              format == VISUAL_AUDIO_SAMPLE_FORMAT_U8);
+          case VISUAL_AUDIO_SAMPLE_FORMAT_U16:
+          case VISUAL_AUDIO_SAMPLE_FORMAT_S16:
+              return convert_16_to_float_sse2 (dst, static_cast<uint16_t const*> (src), count, stride,
+                                               format == VISUAL_AUDIO_SAMPLE_FORMAT_U16);
+          case VISUAL_AUDIO_SAMPLE_FORMAT_U32:
+          case VISUAL_AUDIO_SAMPLE_FORMAT_S32:
+              return convert_32_to_float_sse2 (dst, static_cast<uint32_t const*> (src), count, stride,
+                                               format == VISUAL_AUDIO_SAMPLE_FORMAT_U32);
+          case VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT:
+              return convert_float_to_float_sse2 (dst, static_cast<float const*> (src), count, stride);
+          default:
+              return 0;
+      }
+  }
+
+#elif defined(VISUAL_HAVE_NEON)
+
+  inline void store_s16x8_neon (float* dst, int16x8_t v, float32x4_t scale)
+  {
+      vst1q_f32 (dst,     vmulq_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (v))), scale));
+      vst1q_f32 (dst + 4, vmulq_f32 (vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (v))), scale));
+  }
+
+  inline void store_s8x16_neon (float* dst, int8x16_t v, float32x4_t scale)
+  {
+      store_s16x8_neon (dst,     vmovl_s8 (vget_low_s8 (v)), scale);
+      store_s16x8_neon (dst + 8, vmovl_s8 (vget_high_s8 (v)), scale);
+  }
+
+  // Unsigned formats are flipped into signed ones by toggling the top bit,
+  // which is the same as subtracting zero<T>()
+  std::size_t convert_8_to_float_neon (float* dst, uint8_t const* src, std::size_t count, std::size_t stride, bool is_unsigned)
+  {
+      float32x4_t const scale = vdupq_n_f32 (1.0f / 128.0f);
+      uint8x16_t const flip = vdupq_n_u8 (is_unsigned ? 0x80 : 0);
+      std::size_t i = 0;
+
+      if (stride == 1) {
+          for (; vector_fits (i, 16, count, 1); i += 16)
+              store_s8x16_neon (dst + i, vreinterpretq_s8_u8 (veorq_u8 (vld1q_u8 (src + i), flip)), scale);
+      } else if (stride == 2) {
+          for (; vector_fits (i, 16, count, 2); i += 16) {
+              uint8x16x2_t v = vld2q_u8 (src + i * 2);
+
+              store_s8x16_neon (dst + i, vreinterpretq_s8_u8 (veorq_u8 (v.val[0], flip)), scale);
+          }
+      }
+
+      return i;
+  }
+
+  std::size_t convert_16_to_float_neon (float* dst, uint16_t const* src, std::size_t count, std::size_t stride, bool is_unsigned)
+  {
+      float32x4_t const scale = vdupq_n_f32 (1.0f / 32768.0f);
+      uint16x8_t const flip = vdupq_n_u16 (is_unsigned ? 0x8000 : 0);
+      std::size_t i = 0;
+
+      if (stride == 1) {
+          for (; vector_fits (i, 8, count, 1); i += 8)
+              store_s16x8_neon (dst + i, vreinterpretq_s16_u16 (veorq_u16 (vld1q_u16 (src + i), flip)), scale);
+      } else if (stride == 2) {
+          for (; vector_fits (i, 8, count, 2); i += 8) {
+              uint16x8x2_t v = vld2q_u16 (src + i * 2);
+
+              store_s16x8_neon (dst + i, vreinterpretq_s16_u16 (veorq_u16 (v.val[0], flip)), scale);
+          }
+      }
+
+      return i;
+  }
+
+  std::size_t convert_32_to_float_neon (float* dst, uint32_t const* src, std::size_t count, std::size_t stride, bool is_unsigned)
+  {
+      float32x4_t const scale = vdupq_n_f32 (1.0f / 2147483648.0f);
+      uint32x4_t const flip = vdupq_n_u32 (is_unsigned ? 0x80000000 : 0);
+      std::size_t i = 0;
+
+      if (stride == 1) {
+          for (; vector_fits (i, 4, count, 1); i += 4) {
+              int32x4_t v = vreinterpretq_s32_u32 (veorq_u32 (vld1q_u32 (src + i), flip));
+
+              vst1q_f32 (dst + i, vmulq_f32 (vcvtq_f32_s32 (v), scale));
+          }
+      } else if (stride == 2) {
+          for (; vector_fits (i, 4, count, 2); i += 4) {
+              uint32x4x2_t p = vld2q_u32 (src + i * 2);
+              int32x4_t v = vreinterpretq_s32_u32 (veorq_u32 (p.val[0], flip));
+
+              vst1q_f32 (dst + i, vmulq_f32 (vcvtq_f32_s32 (v), scale));
+          }
+      }
+
+      return i;
+  }
+
+  std::size_t convert_float_to_float_neon (float* dst, float const* src, std::size_t count, std::size_t stride)
+  {
+      std::size_t i = 0;
+
+      // Plain copies are left to visual_mem_copy ()
+      if (stride == 2) {
+          for (; vector_fits (i, 4, count, 2); i += 4)
+              vst1q_f32 (dst + i, vld2q_f32 (src + i * 2).val[0]);
+      }
+
+      return i;
+  }
+
+  std::size_t convert_to_float_simd (float* dst, void const* src, std::size_t count, std::size_t stride, VisAudioSampleFormatType format)
+  {
+      if (!visual_cpu_has_neon ())
+          return 0;
+
+      switch (format) {
+          case VISUAL_AUDIO_SAMPLE_FORMAT_U8:
+          case VISUAL_AUDIO_SAMPLE_FORMAT_S8:
+              return convert_8_to_float_neon (dst, static_cast<uint8_t const*> (src), count, stride,
+                                              format == VISUAL_AUDIO_SAMPLE_FORMAT_U8);
+          case VISUAL_AUDIO_SAMPLE_FORMAT_U16:
+          case VISUAL_AUDIO_SAMPLE_FORMAT_S16:
+              return convert_16_to_float_neon (dst, static_cast<uint16_t const*> (src), count, stride,
+                                               format == VISUAL_AUDIO_SAMPLE_FORMAT_U16);
+          case VISUAL_AUDIO_SAMPLE_FORMAT_U32:
+          case VISUAL_AUDIO_SAMPLE_FORMAT_S32:
+              return convert_32_to_float_neon (dst, static_cast<uint32_t const*> (src), count, stride,
+                                               format == VISUAL_AUDIO_SAMPLE_FORMAT_U32);
+          case VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT:
+              return convert_float_to_float_neon (dst, static_cast<float const*> (src), count, stride);
+          default:
+              return 0;
+      }
+  }
+
+#else
+
+  inline std::size_t convert_to_float_simd (float*, void const*, std::size_t, std::size_t, VisAudioSampleFormatType)
+  {
+      return 0;
+  }
+
+#endif
+
   template <typename T>
   inline void deinterleave_stereo_sample_array (T* dest1, T* dest2, T const* src, std::size_t count)
   {
@@ -346,3 +675,16 @@ void visual_audio_sample_deinterleave_stereo (VisBuffer *dest1, VisBuffer *dest2
 
     deinterleave_stereo_func_table[i] (dbuf1, dbuf2, sbuf, size);
 }
+
+void visual_audio_sample_convert_to_float (float *dest, void const *src, visual_size_t count, visual_size_t stride, VisAudioSampleFormatType format)
+{
+    int i = int (format) - 1;
+    std::size_t done = 0;
+
+    if (count > 0)
+        done = convert_to_float_simd (dest, src, count, stride, format);
+
+    convert_to_float_func_table[i] (dest + done,
+                                    static_cast<uint8_t const*> (src) + done * stride * visual_audio_sample_format_get_size (format),
+                                    count - done, stride);
+}
@@ -15,6 +15,12 @@ void visual_audio_sample_deinterleave_stereo (VisBuffer *dest1,
                                               VisBuffer *src,
                                               VisAudioSampleFormatType format);
 
+void visual_audio_sample_convert_to_float (float *dest,
+                                           void const *src,
+                                           visual_size_t count,
+                                           visual_size_t stride,
+                                           VisAudioSampleFormatType format);
+
 LV_END_DECLS
 
 #endif
@@ -0,0 +1,48 @@
+#ifndef _LV_SIMD_H
+#define _LV_SIMD_H
+
+#include "lvconfig.h"
+
+/* Compile time availability of SIMD intrinsics. Code built on these must
+ * still check the matching visual_cpu_has_*() before running it. */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define VISUAL_HAVE_SSE2 1
+# include <emmintrin.h>
+#endif
+
+/* SSSE3 code is built into every SSE2 capable binary where the compiler
+ * allows enabling it per function, and must be marked VISUAL_TARGET_SSSE3 */
+#if defined(VISUAL_HAVE_SSE2)
+# if defined(__SSSE3__) || defined(_MSC_VER)
+#  define VISUAL_HAVE_SSSE3 1
+#  define VISUAL_TARGET_SSSE3
+# elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#  define VISUAL_HAVE_SSSE3 1
+#  define VISUAL_TARGET_SSSE3 __attribute__ ((target ("ssse3")))
+# endif
+# if defined(VISUAL_HAVE_SSSE3)
+#  include <tmmintrin.h>
+# endif
+#endif
+
+/* Same for AVX2, marked VISUAL_TARGET_AVX2 */
+#if defined(VISUAL_HAVE_SSE2)
+# if defined(__AVX2__) || defined(_MSC_VER)
+#  define VISUAL_HAVE_AVX2 1
+#  define VISUAL_TARGET_AVX2
+# elif defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#  define VISUAL_HAVE_AVX2 1
+#  define VISUAL_TARGET_AVX2 __attribute__ ((target ("avx2")))
+# endif
+# if defined(VISUAL_HAVE_AVX2)
+#  include <immintrin.h>
+# endif
+#endif
+
+#if defined(HAVE_NEON) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+# define VISUAL_HAVE_NEON 1
+# include <arm_neon.h>
+#endif
+
+#endif /* _LV_SIMD_H */
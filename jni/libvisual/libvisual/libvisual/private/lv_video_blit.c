@@ -2,6 +2,7 @@
 #include "lv_video_blit.h"
 #include "lv_common.h"
 #include "lv_cpu.h"
+#include "lv_simd.h"
 
 #pragma pack(1)
 
@@ -15,6 +16,169 @@ typedef struct {
 
 #pragma pack()
 
+/* Composes pixels x to width - 1 of a row, dest and src point at the start
+ * of the row. alpha is the surface alpha and key the colorkey, as a palette
+ * index or pixel value of the depth, for the spans that use them. */
+typedef void (*BlitSpanFunc) (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+
+/* d + alpha * (s - d) / 256, the blend every non premultiplied compose uses.
+ * The SIMD versions produce the same bytes, they work modulo 256. */
+#define BLEND(s, d, alpha)	((((alpha) * ((s) - (d))) >> 8) + (d))
+
+static void blit_rows (VisVideo *dest, VisVideo *src, BlitSpanFunc span, uint8_t alpha, uint32_t key);
+static int find_colorkey_index (VisVideo *src);
+
+static void alphasrc32_span_c             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void premultiplied32_span_c        (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey8_span_c              (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey16_span_c             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey24_span_c             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey32_span_c             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha8_span_c          (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha16_span_c         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha24_span_c         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha32_span_c         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey8_span_c  (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey16_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey24_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+
+#if VISUAL_LITTLE_ENDIAN == 1
+
+#if defined(VISUAL_HAVE_SSE2)
+static void alphasrc32_span_sse2             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void premultiplied32_span_sse2        (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey8_span_sse2              (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey16_span_sse2             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey32_span_sse2             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha8_span_sse2          (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha16_span_sse2         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha24_span_sse2         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha32_span_sse2         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey8_span_sse2  (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey16_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey32_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+#endif
+
+#if defined(VISUAL_HAVE_AVX2)
+static void alphasrc32_span_avx2             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void premultiplied32_span_avx2        (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey32_span_avx2             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha8_span_avx2          (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha24_span_avx2         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha32_span_avx2         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey32_span_avx2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+#endif
+
+#if defined(VISUAL_HAVE_NEON)
+static void alphasrc32_span_neon             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void premultiplied32_span_neon        (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey8_span_neon              (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey16_span_neon             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void colorkey32_span_neon             (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha8_span_neon          (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha16_span_neon         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha24_span_neon         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealpha32_span_neon         (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey8_span_neon  (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey16_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+static void surfacealphacolorkey32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key);
+#endif
+
+#endif /* VISUAL_LITTLE_ENDIAN */
+
+/* Fastest versions, set by visual_video_blit_initialize(). There are no
+ * SIMD versions of the 24 bit colorkey spans, the three byte compare
+ * does not map onto vector lanes. */
+static BlitSpanFunc alphasrc32_span             = alphasrc32_span_c;
+static BlitSpanFunc premultiplied32_span        = premultiplied32_span_c;
+static BlitSpanFunc colorkey8_span              = colorkey8_span_c;
+static BlitSpanFunc colorkey16_span             = colorkey16_span_c;
+static BlitSpanFunc colorkey32_span             = colorkey32_span_c;
+static BlitSpanFunc surfacealpha8_span          = surfacealpha8_span_c;
+static BlitSpanFunc surfacealpha16_span         = surfacealpha16_span_c;
+static BlitSpanFunc surfacealpha24_span         = surfacealpha24_span_c;
+static BlitSpanFunc surfacealpha32_span         = surfacealpha32_span_c;
+static BlitSpanFunc surfacealphacolorkey8_span  = surfacealphacolorkey8_span_c;
+static BlitSpanFunc surfacealphacolorkey16_span = surfacealphacolorkey16_span_c;
+static BlitSpanFunc surfacealphacolorkey32_span = surfacealphacolorkey32_span_c;
+
+void visual_video_blit_initialize (void)
+{
+#if VISUAL_LITTLE_ENDIAN == 1
+
+#if defined(VISUAL_HAVE_SSE2)
+	if (visual_cpu_has_sse2 ()) {
+		alphasrc32_span             = alphasrc32_span_sse2;
+		premultiplied32_span        = premultiplied32_span_sse2;
+		colorkey8_span              = colorkey8_span_sse2;
+		colorkey16_span             = colorkey16_span_sse2;
+		colorkey32_span             = colorkey32_span_sse2;
+		surfacealpha8_span          = surfacealpha8_span_sse2;
+		surfacealpha16_span         = surfacealpha16_span_sse2;
+		surfacealpha24_span         = surfacealpha24_span_sse2;
+		surfacealpha32_span         = surfacealpha32_span_sse2;
+		surfacealphacolorkey8_span  = surfacealphacolorkey8_span_sse2;
+		surfacealphacolorkey16_span = surfacealphacolorkey16_span_sse2;
+		surfacealphacolorkey32_span = surfacealphacolorkey32_span_sse2;
+	}
+#endif
+
+#if defined(VISUAL_HAVE_AVX2)
+	if (visual_cpu_has_avx2 ()) {
+		alphasrc32_span             = alphasrc32_span_avx2;
+		premultiplied32_span        = premultiplied32_span_avx2;
+		colorkey32_span             = colorkey32_span_avx2;
+		surfacealpha8_span          = surfacealpha8_span_avx2;
+		surfacealpha24_span         = surfacealpha24_span_avx2;
+		surfacealpha32_span         = surfacealpha32_span_avx2;
+		surfacealphacolorkey32_span = surfacealphacolorkey32_span_avx2;
+	}
+#endif
+
+#if defined(VISUAL_HAVE_NEON)
+	if (visual_cpu_has_neon ()) {
+		alphasrc32_span             = alphasrc32_span_neon;
+		premultiplied32_span        = premultiplied32_span_neon;
+		colorkey8_span              = colorkey8_span_neon;
+		colorkey16_span             = colorkey16_span_neon;
+		colorkey32_span             = colorkey32_span_neon;
+		surfacealpha8_span          = surfacealpha8_span_neon;
+		surfacealpha16_span         = surfacealpha16_span_neon;
+		surfacealpha24_span         = surfacealpha24_span_neon;
+		surfacealpha32_span         = surfacealpha32_span_neon;
+		surfacealphacolorkey8_span  = surfacealphacolorkey8_span_neon;
+		surfacealphacolorkey16_span = surfacealphacolorkey16_span_neon;
+		surfacealphacolorkey32_span = surfacealphacolorkey32_span_neon;
+	}
+#endif
+
+#endif /* VISUAL_LITTLE_ENDIAN */
+}
+
+static void blit_rows (VisVideo *dest, VisVideo *src, BlitSpanFunc span, uint8_t alpha, uint32_t key)
+{
+	uint8_t *destbuf = visual_video_get_pixels (dest);
+	const uint8_t *srcbuf = visual_video_get_pixels (src);
+	int y;
+
+	for (y = 0; y < src->height; y++) {
+		span (destbuf, srcbuf, 0, src->width, alpha, key);
+
+		destbuf += dest->pitch;
+		srcbuf += src->pitch;
+	}
+}
+
+/* Palette index of the colorkey for 8 bit, or -1 when nothing is keyed out */
+static int find_colorkey_index (VisVideo *src)
+{
+	if (src->pal == NULL || src->colorkey == NULL)
+		return -1;
+
+	return visual_palette_find_color (src->pal, src->colorkey);
+}
+
 int blit_overlay_noalpha (VisVideo *dest, VisVideo *src)
 {
 	int y;
@@ -41,276 +205,977 @@ int blit_overlay_noalpha (VisVideo *dest, VisVideo *src)
 
 int blit_overlay_alphasrc (VisVideo *dest, VisVideo *src)
 {
-	int x, y;
-	uint8_t *destbuf = visual_video_get_pixels (dest);
-	uint8_t *srcbuf  = visual_video_get_pixels (src);
-	uint8_t alpha;
+	blit_rows (dest, src, alphasrc32_span, 0, 0);
+
+	return VISUAL_OK;
+}
 
-	if (visual_cpu_has_mmx ())
-		return _lv_blit_overlay_alphasrc_mmx (dest, src);
+int blit_overlay_alphasrc_premultiplied (VisVideo *dest, VisVideo *src)
+{
+	blit_rows (dest, src, premultiplied32_span, 0, 0);
 
-	for (y = 0; y < src->height; y++) {
-		for (x = 0; x < src->width; x++) {
-			alpha = srcbuf[3];
+	return VISUAL_OK;
+}
+
+int blit_overlay_colorkey (VisVideo *dest, VisVideo *src)
+{
+	int index;
 
-			destbuf[0] = (alpha * (srcbuf[0] - destbuf[0]) >> 8) + destbuf[0];
-			destbuf[1] = (alpha * (srcbuf[1] - destbuf[1]) >> 8) + destbuf[1];
-			destbuf[2] = (alpha * (srcbuf[2] - destbuf[2]) >> 8) + destbuf[2];
+	switch (dest->depth) {
+		case VISUAL_VIDEO_DEPTH_8BIT:
+			index = find_colorkey_index (src);
 
-			destbuf += dest->bpp;
-			srcbuf  += src->bpp;
-		}
+			if (index < 0)
+				return blit_overlay_noalpha (dest, src);
 
-		destbuf += dest->pitch - (dest->width * dest->bpp);
-		srcbuf  += src->pitch  - (src->width  * src->bpp);
+			blit_rows (dest, src, colorkey8_span, 0, index);
+			break;
+
+		case VISUAL_VIDEO_DEPTH_16BIT:
+			blit_rows (dest, src, colorkey16_span, 0, visual_color_to_uint16 (src->colorkey));
+			break;
+
+		case VISUAL_VIDEO_DEPTH_24BIT:
+			blit_rows (dest, src, colorkey24_span_c, 0,
+					src->colorkey->r << 16 | src->colorkey->g << 8 | src->colorkey->b);
+			break;
+
+		case VISUAL_VIDEO_DEPTH_32BIT:
+			blit_rows (dest, src, colorkey32_span, 0, visual_color_to_uint32 (src->colorkey));
+			break;
+
+		default:
+			break;
 	}
 
 	return VISUAL_OK;
 }
 
-int blit_overlay_colorkey (VisVideo *dest, VisVideo *src)
+int blit_overlay_surfacealpha (VisVideo *dest, VisVideo *src)
 {
-	unsigned int i;
-	unsigned int pixel_count = dest->width * dest->height;
+	switch (dest->depth) {
+		case VISUAL_VIDEO_DEPTH_8BIT:
+			blit_rows (dest, src, surfacealpha8_span, src->alpha, 0);
+			break;
 
-	if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT) {
-		uint8_t *destbuf = visual_video_get_pixels (dest);
-		uint8_t *srcbuf = visual_video_get_pixels (src);
-		VisPalette *pal = src->pal;
+		case VISUAL_VIDEO_DEPTH_16BIT:
+			blit_rows (dest, src, surfacealpha16_span, src->alpha, 0);
+			break;
 
-		if (pal == NULL) {
-			blit_overlay_noalpha (dest, src);
+		case VISUAL_VIDEO_DEPTH_24BIT:
+			blit_rows (dest, src, surfacealpha24_span, src->alpha, 0);
+			break;
 
-			return VISUAL_OK;
-		}
+		case VISUAL_VIDEO_DEPTH_32BIT:
+			blit_rows (dest, src, surfacealpha32_span, src->alpha, 0);
+			break;
 
-		int index = visual_palette_find_color (pal, src->colorkey);
+		default:
+			break;
+	}
 
-		for (i = 0; i < pixel_count; i++) {
-			if (*srcbuf != index)
-				*destbuf = *srcbuf;
+	return VISUAL_OK;
+}
 
-			destbuf++;
-			srcbuf++;
-		}
+int blit_overlay_surfacealphacolorkey (VisVideo *dest, VisVideo *src)
+{
+	int index;
 
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_16BIT) {
-		uint16_t *destbuf = visual_video_get_pixels (dest);
-		uint16_t *srcbuf = visual_video_get_pixels (src);
-		uint16_t color = visual_color_to_uint16 (src->colorkey);
+	switch (dest->depth) {
+		case VISUAL_VIDEO_DEPTH_8BIT:
+			if (src->pal == NULL)
+				return blit_overlay_noalpha (dest, src);
 
-		for (i = 0; i < pixel_count; i++) {
-			if (color != *srcbuf)
-				*destbuf = *srcbuf;
+			index = find_colorkey_index (src);
 
-			destbuf++;
-			srcbuf++;
-		}
+			if (index < 0)
+				blit_rows (dest, src, surfacealpha8_span, src->alpha, 0);
+			else
+				blit_rows (dest, src, surfacealphacolorkey8_span, src->alpha, index);
+			break;
 
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_24BIT) {
-		uint8_t *destbuf = visual_video_get_pixels (dest);
-		uint8_t *srcbuf = visual_video_get_pixels (src);
-		uint8_t r = src->colorkey->r;
-		uint8_t g = src->colorkey->g;
-		uint8_t b = src->colorkey->b;
-
-		for (i = 0; i < pixel_count; i++) {
-			if (b != srcbuf[0] && g != srcbuf[1] && r != srcbuf[2]) {
-				destbuf[0] = srcbuf[0];
-				destbuf[1] = srcbuf[1];
-				destbuf[2] = srcbuf[2];
-			}
-
-			destbuf += 3;
-			srcbuf  += 3;
-		}
+		case VISUAL_VIDEO_DEPTH_16BIT:
+			blit_rows (dest, src, surfacealphacolorkey16_span, src->alpha, visual_color_to_uint16 (src->colorkey));
+			break;
 
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_32BIT) {
-		uint32_t *destbuf = visual_video_get_pixels (dest);
-		uint32_t *srcbuf = visual_video_get_pixels (src);
-		uint32_t color = visual_color_to_uint32 (src->colorkey);
+		case VISUAL_VIDEO_DEPTH_24BIT:
+			blit_rows (dest, src, surfacealphacolorkey24_span_c, src->alpha,
+					src->colorkey->r << 16 | src->colorkey->g << 8 | src->colorkey->b);
+			break;
 
-		for (i = 0; i < pixel_count; i++) {
-			if (color != *srcbuf)
-				*destbuf = *srcbuf;
+		case VISUAL_VIDEO_DEPTH_32BIT:
+			blit_rows (dest, src, surfacealphacolorkey32_span, src->alpha, visual_color_to_uint32 (src->colorkey));
+			break;
 
-			destbuf++;
-			srcbuf++;
-		}
+		default:
+			break;
 	}
 
 	return VISUAL_OK;
 }
 
-int blit_overlay_surfacealpha (VisVideo *dest, VisVideo *src)
+/* Plain C versions */
+
+static void alphasrc32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
 {
-	int x, y;
-	uint8_t *destbuf = visual_video_get_pixels (dest);
-	uint8_t *srcbuf = visual_video_get_pixels (src);
-	uint8_t alpha = src->alpha;
+	uint8_t *d = dest + x * 4;
+	const uint8_t *s = src + x * 4;
+
+	for (; x < width; x++) {
+		uint8_t a = s[3];
 
-	if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT) {
+		d[0] = BLEND (s[0], d[0], a);
+		d[1] = BLEND (s[1], d[1], a);
+		d[2] = BLEND (s[2], d[2], a);
 
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				*destbuf = ((alpha * (*srcbuf - *destbuf) >> 8) + *destbuf);
+		d += 4;
+		s += 4;
+	}
+}
 
-				destbuf += dest->bpp;
-				srcbuf += src->bpp;
-			}
+/* s + d * (255 - a) / 255 on all four channels, rounded and saturated */
+static inline uint8_t over_premultiplied (int s, int d, int inv_alpha)
+{
+	int t = d * inv_alpha + 128;
 
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf  += src->pitch  - (src->width  * src->bpp);
-		}
+	t = s + ((t + (t >> 8)) >> 8);
 
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_16BIT) {
+	return t > 255 ? 255 : t;
+}
 
-		for (y = 0; y < src->height; y++) {
-			rgb16_t *destr = (rgb16_t *) destbuf;
-			rgb16_t *srcr  = (rgb16_t *) srcbuf;
+static void premultiplied32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	uint8_t *d = dest + x * 4;
+	const uint8_t *s = src + x * 4;
 
-			for (x = 0; x < src->width; x++) {
-				destr->r = (alpha * (srcr->r - destr->r) >> 8) + destr->r;
-				destr->g = (alpha * (srcr->g - destr->g) >> 8) + destr->g;
-				destr->b = (alpha * (srcr->b - destr->b) >> 8) + destr->b;
+	for (; x < width; x++) {
+		int inv_alpha = 255 - s[3];
 
-				destr++;
-				srcr++;
-			}
+		d[0] = over_premultiplied (s[0], d[0], inv_alpha);
+		d[1] = over_premultiplied (s[1], d[1], inv_alpha);
+		d[2] = over_premultiplied (s[2], d[2], inv_alpha);
+		d[3] = over_premultiplied (s[3], d[3], inv_alpha);
 
-			destbuf += dest->pitch;
-			srcbuf += src->pitch;
-		}
+		d += 4;
+		s += 4;
+	}
+}
 
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_24BIT) {
+static void colorkey8_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	for (; x < width; x++) {
+		if (src[x] != key)
+			dest[x] = src[x];
+	}
+}
 
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				destbuf[0] = (alpha * (srcbuf[0] - destbuf[0]) >> 8) + destbuf[0];
-				destbuf[1] = (alpha * (srcbuf[1] - destbuf[1]) >> 8) + destbuf[1];
-				destbuf[2] = (alpha * (srcbuf[2] - destbuf[2]) >> 8) + destbuf[2];
+static void colorkey16_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	uint16_t *d = (uint16_t *) dest;
+	const uint16_t *s = (const uint16_t *) src;
 
-				destbuf += dest->bpp;
-				srcbuf  += src->bpp;
-			}
+	for (; x < width; x++) {
+		if (s[x] != key)
+			d[x] = s[x];
+	}
+}
 
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf  += src->pitch  - (src->width  * src->bpp);
+static void colorkey24_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	uint8_t *d = dest + x * 3;
+	const uint8_t *s = src + x * 3;
+	uint8_t r = key >> 16;
+	uint8_t g = key >> 8;
+	uint8_t b = key;
+
+	for (; x < width; x++) {
+		if (b != s[0] || g != s[1] || r != s[2]) {
+			d[0] = s[0];
+			d[1] = s[1];
+			d[2] = s[2];
 		}
 
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_32BIT) {
+		d += 3;
+		s += 3;
+	}
+}
 
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				destbuf[0] = (alpha * (srcbuf[0] - destbuf[0]) >> 8) + destbuf[0];
-				destbuf[1] = (alpha * (srcbuf[1] - destbuf[1]) >> 8) + destbuf[1];
-				destbuf[2] = (alpha * (srcbuf[2] - destbuf[2]) >> 8) + destbuf[2];
+static void colorkey32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	uint32_t *d = (uint32_t *) dest;
+	const uint32_t *s = (const uint32_t *) src;
 
-				destbuf += dest->bpp;
-				srcbuf  += src->bpp;
-			}
+	for (; x < width; x++) {
+		if (s[x] != key)
+			d[x] = s[x];
+	}
+}
 
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf  += src->pitch  - (src->width  * src->bpp);
-		}
+static void surfacealpha8_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	for (; x < width; x++)
+		dest[x] = BLEND (src[x], dest[x], alpha);
+}
+
+static void surfacealpha16_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	rgb16_t *d = (rgb16_t *) dest;
+	const rgb16_t *s = (const rgb16_t *) src;
+
+	for (; x < width; x++) {
+		d[x].r = BLEND (s[x].r, d[x].r, alpha);
+		d[x].g = BLEND (s[x].g, d[x].g, alpha);
+		d[x].b = BLEND (s[x].b, d[x].b, alpha);
 	}
+}
 
-	return VISUAL_OK;
+static void surfacealpha24_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	int i;
+
+	for (i = x * 3; i < width * 3; i++)
+		dest[i] = BLEND (src[i], dest[i], alpha);
 }
 
-int blit_overlay_surfacealphacolorkey (VisVideo *dest, VisVideo *src)
+static void surfacealpha32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
 {
-	int x, y;
-	uint8_t *destbuf = visual_video_get_pixels (dest);
-	uint8_t *srcbuf = visual_video_get_pixels (src);
-	uint8_t alpha = src->alpha;
+	uint8_t *d = dest + x * 4;
+	const uint8_t *s = src + x * 4;
 
-	if (dest->depth == VISUAL_VIDEO_DEPTH_8BIT) {
-		VisPalette *pal = src->pal;
+	for (; x < width; x++) {
+		d[0] = BLEND (s[0], d[0], alpha);
+		d[1] = BLEND (s[1], d[1], alpha);
+		d[2] = BLEND (s[2], d[2], alpha);
 
-		if (pal == NULL) {
-			blit_overlay_noalpha (dest, src);
+		d += 4;
+		s += 4;
+	}
+}
 
-			return VISUAL_OK;
-		}
+static void surfacealphacolorkey8_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	for (; x < width; x++) {
+		if (src[x] != key)
+			dest[x] = BLEND (src[x], dest[x], alpha);
+	}
+}
 
-		int index = visual_palette_find_color (pal, src->colorkey);
+static void surfacealphacolorkey16_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	rgb16_t *d = (rgb16_t *) dest;
+	const rgb16_t *s = (const rgb16_t *) src;
+
+	for (; x < width; x++) {
+		if (((const uint16_t *) src)[x] != key) {
+			d[x].r = BLEND (s[x].r, d[x].r, alpha);
+			d[x].g = BLEND (s[x].g, d[x].g, alpha);
+			d[x].b = BLEND (s[x].b, d[x].b, alpha);
+		}
+	}
+}
 
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				if (*srcbuf != index)
-					*destbuf = ((alpha * (*srcbuf - *destbuf) >> 8) + *destbuf);
+static void surfacealphacolorkey24_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	uint8_t *d = dest + x * 3;
+	const uint8_t *s = src + x * 3;
+	uint8_t r = key >> 16;
+	uint8_t g = key >> 8;
+	uint8_t b = key;
+
+	for (; x < width; x++) {
+		if (b != s[0] || g != s[1] || r != s[2]) {
+			d[0] = BLEND (s[0], d[0], alpha);
+			d[1] = BLEND (s[1], d[1], alpha);
+			d[2] = BLEND (s[2], d[2], alpha);
+		}
 
-				destbuf += dest->bpp;
-				srcbuf += src->bpp;
-			}
+		d += 3;
+		s += 3;
+	}
+}
 
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf += src->pitch - (src->width * src->bpp);
+static void surfacealphacolorkey32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	uint8_t *d = dest + x * 4;
+	const uint8_t *s = src + x * 4;
+
+	for (; x < width; x++) {
+		if (*((const uint32_t *) s) != key) {
+			d[0] = BLEND (s[0], d[0], alpha);
+			d[1] = BLEND (s[1], d[1], alpha);
+			d[2] = BLEND (s[2], d[2], alpha);
 		}
 
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_16BIT) {
-		uint16_t color = visual_color_to_uint16 (src->colorkey);
+		d += 4;
+		s += 4;
+	}
+}
 
-		for (y = 0; y < src->height; y++) {
-			rgb16_t *destr = (rgb16_t *) destbuf;
-			rgb16_t *srcr  = (rgb16_t *) srcbuf;
+#if VISUAL_LITTLE_ENDIAN == 1
 
-			for (x = 0; x < src->width; x++) {
-				if (color != *((uint16_t *) srcr)) {
-					destr->r = (alpha * (srcr->r - destr->r) >> 8) + destr->r;
-					destr->g = (alpha * (srcr->g - destr->g) >> 8) + destr->g;
-					destr->b = (alpha * (srcr->b - destr->b) >> 8) + destr->b;
-				}
+#if defined(VISUAL_HAVE_SSE2)
 
-				destr++;
-				srcr++;
-			}
+/* The blend runs on 16 bit lanes. Only the low 16 bits of alpha * (s - d)
+ * are kept, shifting those down by 8 leaves the low byte of the arithmetic
+ * shift, and the low byte of that plus d is the result. */
+static inline __m128i blend_sse2 (__m128i d, __m128i s, __m128i alpha_lo, __m128i alpha_hi)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i low_bytes = _mm_set1_epi16 (0x00ff);
+	__m128i dl = _mm_unpacklo_epi8 (d, zero);
+	__m128i dh = _mm_unpackhi_epi8 (d, zero);
+	__m128i lo, hi;
 
-			destbuf += dest->pitch;
-			srcbuf += src->pitch;
-		}
+	lo = _mm_mullo_epi16 (_mm_sub_epi16 (_mm_unpacklo_epi8 (s, zero), dl), alpha_lo);
+	hi = _mm_mullo_epi16 (_mm_sub_epi16 (_mm_unpackhi_epi8 (s, zero), dh), alpha_hi);
 
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_24BIT) {
-		uint8_t r = src->colorkey->r;
-		uint8_t g = src->colorkey->g;
-		uint8_t b = src->colorkey->b;
-
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				if (b != *srcbuf && g != *(srcbuf + 1) && r != *(srcbuf + 2)) {
-					destbuf[0] = (alpha * (srcbuf[0] - destbuf[0]) >> 8) + destbuf[0];
-					destbuf[1] = (alpha * (srcbuf[1] - destbuf[1]) >> 8) + destbuf[1];
-					destbuf[2] = (alpha * (srcbuf[2] - destbuf[2]) >> 8) + destbuf[2];
-				}
-
-				destbuf += dest->bpp;
-				srcbuf += src->bpp;
-			}
-
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf += src->pitch - (src->width * src->bpp);
-		}
+	lo = _mm_and_si128 (_mm_add_epi16 (_mm_srli_epi16 (lo, 8), dl), low_bytes);
+	hi = _mm_and_si128 (_mm_add_epi16 (_mm_srli_epi16 (hi, 8), dh), low_bytes);
 
-	} else if (dest->depth == VISUAL_VIDEO_DEPTH_32BIT) {
-		uint32_t color = visual_color_to_uint32 (src->colorkey);
+	return _mm_packus_epi16 (lo, hi);
+}
 
-		for (y = 0; y < src->height; y++) {
-			for (x = 0; x < src->width; x++) {
-				if (color == *((uint32_t *) destbuf)) {
-					destbuf[0] = (alpha * (srcbuf[0] - destbuf[0]) >> 8) + destbuf[0];
-					destbuf[1] = (alpha * (srcbuf[1] - destbuf[1]) >> 8) + destbuf[1];
-					destbuf[2] = (alpha * (srcbuf[2] - destbuf[2]) >> 8) + destbuf[2];
-				}
+/* Same on the 5, 6 and 5 bit fields of eight rgb16 pixels, the products fit
+ * in 16 bits there so the shift can be a real arithmetic one */
+static inline __m128i blend_rgb16_sse2 (__m128i d, __m128i s, __m128i alpha)
+{
+	const __m128i mask_g = _mm_set1_epi16 (0x3f);
+	const __m128i mask_b = _mm_set1_epi16 (0x1f);
+	__m128i dr = _mm_srli_epi16 (d, 11);
+	__m128i dg = _mm_and_si128 (_mm_srli_epi16 (d, 5), mask_g);
+	__m128i db = _mm_and_si128 (d, mask_b);
+	__m128i r, g, b;
+
+	r = _mm_sub_epi16 (_mm_srli_epi16 (s, 11), dr);
+	g = _mm_sub_epi16 (_mm_and_si128 (_mm_srli_epi16 (s, 5), mask_g), dg);
+	b = _mm_sub_epi16 (_mm_and_si128 (s, mask_b), db);
+
+	r = _mm_add_epi16 (_mm_srai_epi16 (_mm_mullo_epi16 (r, alpha), 8), dr);
+	g = _mm_add_epi16 (_mm_srai_epi16 (_mm_mullo_epi16 (g, alpha), 8), dg);
+	b = _mm_add_epi16 (_mm_srai_epi16 (_mm_mullo_epi16 (b, alpha), 8), db);
+
+	return _mm_or_si128 (_mm_or_si128 (_mm_slli_epi16 (r, 11), _mm_slli_epi16 (g, 5)), b);
+}
 
-				destbuf += dest->bpp;
-				srcbuf += src->bpp;
-			}
+static inline __m128i select_sse2 (__m128i mask, __m128i a, __m128i b)
+{
+	return _mm_or_si128 (_mm_and_si128 (mask, a), _mm_andnot_si128 (mask, b));
+}
 
-			destbuf += dest->pitch - (dest->width * dest->bpp);
-			srcbuf += src->pitch - (src->width * src->bpp);
-		}
+/* Surface alpha for every byte, 16 per iteration */
+static inline int blend_bytes_sse2 (uint8_t *dest, const uint8_t *src, int i, int count, uint8_t alpha)
+{
+	const __m128i a = _mm_set1_epi16 (alpha);
+
+	for (; i + 16 <= count; i += 16) {
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dest + i));
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + i));
+
+		_mm_storeu_si128 ((__m128i *) (dest + i), blend_sse2 (d, s, a, a));
 	}
 
-	return VISUAL_OK;
+	return i;
+}
+
+static void alphasrc32_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i color_mask = _mm_set1_epi32 (0x00ffffff);
+
+	for (; x + 4 <= width; x += 4) {
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x * 4));
+		__m128i a = _mm_srli_epi32 (s, 24);
+		__m128i d;
+
+		/* Fully transparent pixels are common in overlays, skip them */
+		if (_mm_movemask_epi8 (_mm_cmpeq_epi32 (a, zero)) == 0xffff)
+			continue;
+
+		d = _mm_loadu_si128 ((const __m128i *) (dest + x * 4));
+
+		/* Pixel alpha on the color bytes, 0 on the alpha byte so it stays */
+		a = _mm_or_si128 (a, _mm_slli_epi32 (a, 8));
+		a = _mm_and_si128 (_mm_or_si128 (a, _mm_slli_epi32 (a, 16)), color_mask);
+
+		d = blend_sse2 (d, s, _mm_unpacklo_epi8 (a, zero), _mm_unpackhi_epi8 (a, zero));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4), d);
+	}
+
+	alphasrc32_span_c (dest, src, x, width, alpha, key);
+}
+
+static void premultiplied32_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i ones = _mm_cmpeq_epi32 (zero, zero);
+	const __m128i half = _mm_set1_epi16 (128);
+
+	for (; x + 4 <= width; x += 4) {
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x * 4));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dest + x * 4));
+		__m128i a = _mm_srli_epi32 (s, 24);
+		__m128i lo, hi;
+
+		/* 255 - alpha on all four bytes */
+		a = _mm_or_si128 (a, _mm_slli_epi32 (a, 8));
+		a = _mm_xor_si128 (_mm_or_si128 (a, _mm_slli_epi32 (a, 16)), ones);
+
+		lo = _mm_add_epi16 (_mm_mullo_epi16 (_mm_unpacklo_epi8 (d, zero), _mm_unpacklo_epi8 (a, zero)), half);
+		hi = _mm_add_epi16 (_mm_mullo_epi16 (_mm_unpackhi_epi8 (d, zero), _mm_unpackhi_epi8 (a, zero)), half);
+
+		lo = _mm_srli_epi16 (_mm_add_epi16 (lo, _mm_srli_epi16 (lo, 8)), 8);
+		hi = _mm_srli_epi16 (_mm_add_epi16 (hi, _mm_srli_epi16 (hi, 8)), 8);
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4), _mm_adds_epu8 (s, _mm_packus_epi16 (lo, hi)));
+	}
+
+	premultiplied32_span_c (dest, src, x, width, alpha, key);
+}
+
+static void colorkey8_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m128i k = _mm_set1_epi8 (key);
+
+	for (; x + 16 <= width; x += 16) {
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dest + x));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x), select_sse2 (_mm_cmpeq_epi8 (s, k), d, s));
+	}
+
+	colorkey8_span_c (dest, src, x, width, alpha, key);
+}
+
+static void colorkey16_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m128i k = _mm_set1_epi16 (key);
+
+	for (; x + 8 <= width; x += 8) {
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x * 2));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dest + x * 2));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 2), select_sse2 (_mm_cmpeq_epi16 (s, k), d, s));
+	}
+
+	colorkey16_span_c (dest, src, x, width, alpha, key);
+}
+
+static void colorkey32_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m128i k = _mm_set1_epi32 (key);
+
+	for (; x + 4 <= width; x += 4) {
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x * 4));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dest + x * 4));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4), select_sse2 (_mm_cmpeq_epi32 (s, k), d, s));
+	}
+
+	colorkey32_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealpha8_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	x = blend_bytes_sse2 (dest, src, x, width, alpha);
+
+	surfacealpha8_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealpha16_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m128i a = _mm_set1_epi16 (alpha);
+
+	for (; x + 8 <= width; x += 8) {
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x * 2));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dest + x * 2));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 2), blend_rgb16_sse2 (d, s, a));
+	}
+
+	surfacealpha16_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealpha24_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	int i = blend_bytes_sse2 (dest, src, x * 3, width * 3, alpha);
+
+	/* The bytes past the last full vector, finished by the C version */
+	surfacealpha8_span_c (dest, src, i, width * 3, alpha, key);
+}
+
+static void surfacealpha32_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m128i a = _mm_set_epi16 (0, alpha, alpha, alpha, 0, alpha, alpha, alpha);
+
+	for (; x + 4 <= width; x += 4) {
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x * 4));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dest + x * 4));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4), blend_sse2 (d, s, a, a));
+	}
+
+	surfacealpha32_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealphacolorkey8_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m128i a = _mm_set1_epi16 (alpha);
+	const __m128i k = _mm_set1_epi8 (key);
+
+	for (; x + 16 <= width; x += 16) {
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dest + x));
+
+		d = select_sse2 (_mm_cmpeq_epi8 (s, k), d, blend_sse2 (d, s, a, a));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x), d);
+	}
+
+	surfacealphacolorkey8_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealphacolorkey16_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m128i a = _mm_set1_epi16 (alpha);
+	const __m128i k = _mm_set1_epi16 (key);
+
+	for (; x + 8 <= width; x += 8) {
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x * 2));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dest + x * 2));
+
+		d = select_sse2 (_mm_cmpeq_epi16 (s, k), d, blend_rgb16_sse2 (d, s, a));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 2), d);
+	}
+
+	surfacealphacolorkey16_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealphacolorkey32_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m128i a = _mm_set_epi16 (0, alpha, alpha, alpha, 0, alpha, alpha, alpha);
+	const __m128i k = _mm_set1_epi32 (key);
+
+	for (; x + 4 <= width; x += 4) {
+		__m128i s = _mm_loadu_si128 ((const __m128i *) (src + x * 4));
+		__m128i d = _mm_loadu_si128 ((const __m128i *) (dest + x * 4));
+
+		d = select_sse2 (_mm_cmpeq_epi32 (s, k), d, blend_sse2 (d, s, a, a));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4), d);
+	}
+
+	surfacealphacolorkey32_span_c (dest, src, x, width, alpha, key);
+}
+
+#endif /* VISUAL_HAVE_SSE2 */
+
+#if defined(VISUAL_HAVE_AVX2)
+
+/* The SSE2 blends on 32 bytes. Unpacking and packing both stay within
+ * the 128 bit halves, so the byte order comes out unchanged. */
+
+VISUAL_TARGET_AVX2
+static inline __m256i blend_avx2 (__m256i d, __m256i s, __m256i alpha_lo, __m256i alpha_hi)
+{
+	const __m256i zero = _mm256_setzero_si256 ();
+	const __m256i low_bytes = _mm256_set1_epi16 (0x00ff);
+	__m256i dl = _mm256_unpacklo_epi8 (d, zero);
+	__m256i dh = _mm256_unpackhi_epi8 (d, zero);
+	__m256i lo, hi;
+
+	lo = _mm256_mullo_epi16 (_mm256_sub_epi16 (_mm256_unpacklo_epi8 (s, zero), dl), alpha_lo);
+	hi = _mm256_mullo_epi16 (_mm256_sub_epi16 (_mm256_unpackhi_epi8 (s, zero), dh), alpha_hi);
+
+	lo = _mm256_and_si256 (_mm256_add_epi16 (_mm256_srli_epi16 (lo, 8), dl), low_bytes);
+	hi = _mm256_and_si256 (_mm256_add_epi16 (_mm256_srli_epi16 (hi, 8), dh), low_bytes);
+
+	return _mm256_packus_epi16 (lo, hi);
+}
+
+VISUAL_TARGET_AVX2
+static inline int blend_bytes_avx2 (uint8_t *dest, const uint8_t *src, int i, int count, uint8_t alpha)
+{
+	const __m256i a = _mm256_set1_epi16 (alpha);
+
+	for (; i + 32 <= count; i += 32) {
+		__m256i d = _mm256_loadu_si256 ((const __m256i *) (dest + i));
+		__m256i s = _mm256_loadu_si256 ((const __m256i *) (src + i));
+
+		_mm256_storeu_si256 ((__m256i *) (dest + i), blend_avx2 (d, s, a, a));
+	}
+
+	return i;
+}
+
+VISUAL_TARGET_AVX2
+static void alphasrc32_span_avx2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m256i zero = _mm256_setzero_si256 ();
+	const __m256i color_mask = _mm256_set1_epi32 (0x00ffffff);
+
+	for (; x + 8 <= width; x += 8) {
+		__m256i s = _mm256_loadu_si256 ((const __m256i *) (src + x * 4));
+		__m256i a = _mm256_srli_epi32 (s, 24);
+		__m256i d;
+
+		if (_mm256_testz_si256 (a, a))
+			continue;
+
+		d = _mm256_loadu_si256 ((const __m256i *) (dest + x * 4));
+
+		a = _mm256_or_si256 (a, _mm256_slli_epi32 (a, 8));
+		a = _mm256_and_si256 (_mm256_or_si256 (a, _mm256_slli_epi32 (a, 16)), color_mask);
+
+		d = blend_avx2 (d, s, _mm256_unpacklo_epi8 (a, zero), _mm256_unpackhi_epi8 (a, zero));
+
+		_mm256_storeu_si256 ((__m256i *) (dest + x * 4), d);
+	}
+
+	alphasrc32_span_c (dest, src, x, width, alpha, key);
+}
+
+VISUAL_TARGET_AVX2
+static void premultiplied32_span_avx2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m256i zero = _mm256_setzero_si256 ();
+	const __m256i ones = _mm256_cmpeq_epi32 (zero, zero);
+	const __m256i half = _mm256_set1_epi16 (128);
+
+	for (; x + 8 <= width; x += 8) {
+		__m256i s = _mm256_loadu_si256 ((const __m256i *) (src + x * 4));
+		__m256i d = _mm256_loadu_si256 ((const __m256i *) (dest + x * 4));
+		__m256i a = _mm256_srli_epi32 (s, 24);
+		__m256i lo, hi;
+
+		a = _mm256_or_si256 (a, _mm256_slli_epi32 (a, 8));
+		a = _mm256_xor_si256 (_mm256_or_si256 (a, _mm256_slli_epi32 (a, 16)), ones);
+
+		lo = _mm256_add_epi16 (_mm256_mullo_epi16 (_mm256_unpacklo_epi8 (d, zero), _mm256_unpacklo_epi8 (a, zero)), half);
+		hi = _mm256_add_epi16 (_mm256_mullo_epi16 (_mm256_unpackhi_epi8 (d, zero), _mm256_unpackhi_epi8 (a, zero)), half);
+
+		lo = _mm256_srli_epi16 (_mm256_add_epi16 (lo, _mm256_srli_epi16 (lo, 8)), 8);
+		hi = _mm256_srli_epi16 (_mm256_add_epi16 (hi, _mm256_srli_epi16 (hi, 8)), 8);
+
+		_mm256_storeu_si256 ((__m256i *) (dest + x * 4), _mm256_adds_epu8 (s, _mm256_packus_epi16 (lo, hi)));
+	}
+
+	premultiplied32_span_c (dest, src, x, width, alpha, key);
+}
+
+VISUAL_TARGET_AVX2
+static void colorkey32_span_avx2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m256i k = _mm256_set1_epi32 (key);
+
+	for (; x + 8 <= width; x += 8) {
+		__m256i s = _mm256_loadu_si256 ((const __m256i *) (src + x * 4));
+		__m256i d = _mm256_loadu_si256 ((const __m256i *) (dest + x * 4));
+
+		_mm256_storeu_si256 ((__m256i *) (dest + x * 4), _mm256_blendv_epi8 (s, d, _mm256_cmpeq_epi32 (s, k)));
+	}
+
+	colorkey32_span_c (dest, src, x, width, alpha, key);
+}
+
+VISUAL_TARGET_AVX2
+static void surfacealpha8_span_avx2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	x = blend_bytes_avx2 (dest, src, x, width, alpha);
+
+	surfacealpha8_span_c (dest, src, x, width, alpha, key);
+}
+
+VISUAL_TARGET_AVX2
+static void surfacealpha24_span_avx2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	int i = blend_bytes_avx2 (dest, src, x * 3, width * 3, alpha);
+
+	surfacealpha8_span_c (dest, src, i, width * 3, alpha, key);
 }
+
+VISUAL_TARGET_AVX2
+static void surfacealpha32_span_avx2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m256i a = _mm256_set1_epi64x ((int64_t) alpha << 32 | alpha << 16 | alpha);
+
+	for (; x + 8 <= width; x += 8) {
+		__m256i s = _mm256_loadu_si256 ((const __m256i *) (src + x * 4));
+		__m256i d = _mm256_loadu_si256 ((const __m256i *) (dest + x * 4));
+
+		_mm256_storeu_si256 ((__m256i *) (dest + x * 4), blend_avx2 (d, s, a, a));
+	}
+
+	surfacealpha32_span_c (dest, src, x, width, alpha, key);
+}
+
+VISUAL_TARGET_AVX2
+static void surfacealphacolorkey32_span_avx2 (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const __m256i a = _mm256_set1_epi64x ((int64_t) alpha << 32 | alpha << 16 | alpha);
+	const __m256i k = _mm256_set1_epi32 (key);
+
+	for (; x + 8 <= width; x += 8) {
+		__m256i s = _mm256_loadu_si256 ((const __m256i *) (src + x * 4));
+		__m256i d = _mm256_loadu_si256 ((const __m256i *) (dest + x * 4));
+
+		d = _mm256_blendv_epi8 (blend_avx2 (d, s, a, a), d, _mm256_cmpeq_epi32 (s, k));
+
+		_mm256_storeu_si256 ((__m256i *) (dest + x * 4), d);
+	}
+
+	surfacealphacolorkey32_span_c (dest, src, x, width, alpha, key);
+}
+
+#endif /* VISUAL_HAVE_AVX2 */
+
+#if defined(VISUAL_HAVE_NEON)
+
+/* Widening subtract and a modulo 2^16 multiply, the narrowing shift keeps
+ * bits 8 to 15 and the final add wraps, like the SSE2 version */
+static inline uint8x8_t blend_neon (uint8x8_t d, uint8x8_t s, uint8x8_t alpha)
+{
+	uint16x8_t t = vmulq_u16 (vsubl_u8 (s, d), vmovl_u8 (alpha));
+
+	return vadd_u8 (vshrn_n_u16 (t, 8), d);
+}
+
+static inline uint8x16_t blendq_neon (uint8x16_t d, uint8x16_t s, uint8x16_t alpha)
+{
+	return vcombine_u8 (blend_neon (vget_low_u8 (d), vget_low_u8 (s), vget_low_u8 (alpha)),
+			blend_neon (vget_high_u8 (d), vget_high_u8 (s), vget_high_u8 (alpha)));
+}
+
+/* d * inv_alpha / 255 rounded, vraddhn adds the rounding 128 */
+static inline uint8x8_t scale_inv_neon (uint8x8_t d, uint8x8_t inv_alpha)
+{
+	uint16x8_t t = vmull_u8 (d, inv_alpha);
+
+	return vraddhn_u16 (t, vrshrq_n_u16 (t, 8));
+}
+
+static inline uint8x16_t over_premultiplied_neon (uint8x16_t d, uint8x16_t s, uint8x16_t inv_alpha)
+{
+	uint8x16_t t = vcombine_u8 (scale_inv_neon (vget_low_u8 (d), vget_low_u8 (inv_alpha)),
+			scale_inv_neon (vget_high_u8 (d), vget_high_u8 (inv_alpha)));
+
+	return vqaddq_u8 (s, t);
+}
+
+static inline uint16x8_t blend_rgb16_neon (uint16x8_t d, uint16x8_t s, int16x8_t alpha)
+{
+	const uint16x8_t mask_g = vdupq_n_u16 (0x3f);
+	const uint16x8_t mask_b = vdupq_n_u16 (0x1f);
+	int16x8_t dr = vreinterpretq_s16_u16 (vshrq_n_u16 (d, 11));
+	int16x8_t dg = vreinterpretq_s16_u16 (vandq_u16 (vshrq_n_u16 (d, 5), mask_g));
+	int16x8_t db = vreinterpretq_s16_u16 (vandq_u16 (d, mask_b));
+	int16x8_t r, g, b;
+
+	r = vsubq_s16 (vreinterpretq_s16_u16 (vshrq_n_u16 (s, 11)), dr);
+	g = vsubq_s16 (vreinterpretq_s16_u16 (vandq_u16 (vshrq_n_u16 (s, 5), mask_g)), dg);
+	b = vsubq_s16 (vreinterpretq_s16_u16 (vandq_u16 (s, mask_b)), db);
+
+	r = vaddq_s16 (vshrq_n_s16 (vmulq_s16 (r, alpha), 8), dr);
+	g = vaddq_s16 (vshrq_n_s16 (vmulq_s16 (g, alpha), 8), dg);
+	b = vaddq_s16 (vshrq_n_s16 (vmulq_s16 (b, alpha), 8), db);
+
+	return vorrq_u16 (vorrq_u16 (vshlq_n_u16 (vreinterpretq_u16_s16 (r), 11),
+				vshlq_n_u16 (vreinterpretq_u16_s16 (g), 5)), vreinterpretq_u16_s16 (b));
+}
+
+static inline int blend_bytes_neon (uint8_t *dest, const uint8_t *src, int i, int count, uint8_t alpha)
+{
+	const uint8x16_t a = vdupq_n_u8 (alpha);
+
+	for (; i + 16 <= count; i += 16)
+		vst1q_u8 (dest + i, blendq_neon (vld1q_u8 (dest + i), vld1q_u8 (src + i), a));
+
+	return i;
+}
+
+/* The 32 bit versions deinterleave 16 pixels into channel planes, so the
+ * pixel alpha is a plain vector and the dest alpha plane is left as is */
+
+static void alphasrc32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x4_t s = vld4q_u8 (src + x * 4);
+		uint8x16x4_t d = vld4q_u8 (dest + x * 4);
+
+		d.val[0] = blendq_neon (d.val[0], s.val[0], s.val[3]);
+		d.val[1] = blendq_neon (d.val[1], s.val[1], s.val[3]);
+		d.val[2] = blendq_neon (d.val[2], s.val[2], s.val[3]);
+
+		vst4q_u8 (dest + x * 4, d);
+	}
+
+	alphasrc32_span_c (dest, src, x, width, alpha, key);
+}
+
+static void premultiplied32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x4_t s = vld4q_u8 (src + x * 4);
+		uint8x16x4_t d = vld4q_u8 (dest + x * 4);
+		uint8x16_t inv_alpha = vmvnq_u8 (s.val[3]);
+
+		d.val[0] = over_premultiplied_neon (d.val[0], s.val[0], inv_alpha);
+		d.val[1] = over_premultiplied_neon (d.val[1], s.val[1], inv_alpha);
+		d.val[2] = over_premultiplied_neon (d.val[2], s.val[2], inv_alpha);
+		d.val[3] = over_premultiplied_neon (d.val[3], s.val[3], inv_alpha);
+
+		vst4q_u8 (dest + x * 4, d);
+	}
+
+	premultiplied32_span_c (dest, src, x, width, alpha, key);
+}
+
+static void colorkey8_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const uint8x16_t k = vdupq_n_u8 (key);
+
+	for (; x + 16 <= width; x += 16) {
+		uint8x16_t s = vld1q_u8 (src + x);
+
+		vst1q_u8 (dest + x, vbslq_u8 (vceqq_u8 (s, k), vld1q_u8 (dest + x), s));
+	}
+
+	colorkey8_span_c (dest, src, x, width, alpha, key);
+}
+
+static void colorkey16_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const uint16x8_t k = vdupq_n_u16 (key);
+	uint16_t *d = (uint16_t *) dest;
+	const uint16_t *s = (const uint16_t *) src;
+
+	for (; x + 8 <= width; x += 8) {
+		uint16x8_t sv = vld1q_u16 (s + x);
+
+		vst1q_u16 (d + x, vbslq_u16 (vceqq_u16 (sv, k), vld1q_u16 (d + x), sv));
+	}
+
+	colorkey16_span_c (dest, src, x, width, alpha, key);
+}
+
+static void colorkey32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const uint32x4_t k = vdupq_n_u32 (key);
+	uint32_t *d = (uint32_t *) dest;
+	const uint32_t *s = (const uint32_t *) src;
+
+	for (; x + 4 <= width; x += 4) {
+		uint32x4_t sv = vld1q_u32 (s + x);
+
+		vst1q_u32 (d + x, vbslq_u32 (vceqq_u32 (sv, k), vld1q_u32 (d + x), sv));
+	}
+
+	colorkey32_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealpha8_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	x = blend_bytes_neon (dest, src, x, width, alpha);
+
+	surfacealpha8_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealpha16_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const int16x8_t a = vdupq_n_s16 (alpha);
+	uint16_t *d = (uint16_t *) dest;
+	const uint16_t *s = (const uint16_t *) src;
+
+	for (; x + 8 <= width; x += 8)
+		vst1q_u16 (d + x, blend_rgb16_neon (vld1q_u16 (d + x), vld1q_u16 (s + x), a));
+
+	surfacealpha16_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealpha24_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	int i = blend_bytes_neon (dest, src, x * 3, width * 3, alpha);
+
+	surfacealpha8_span_c (dest, src, i, width * 3, alpha, key);
+}
+
+static void surfacealpha32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const uint8x16_t a = vdupq_n_u8 (alpha);
+
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x4_t s = vld4q_u8 (src + x * 4);
+		uint8x16x4_t d = vld4q_u8 (dest + x * 4);
+
+		d.val[0] = blendq_neon (d.val[0], s.val[0], a);
+		d.val[1] = blendq_neon (d.val[1], s.val[1], a);
+		d.val[2] = blendq_neon (d.val[2], s.val[2], a);
+
+		vst4q_u8 (dest + x * 4, d);
+	}
+
+	surfacealpha32_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealphacolorkey8_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const uint8x16_t a = vdupq_n_u8 (alpha);
+	const uint8x16_t k = vdupq_n_u8 (key);
+
+	for (; x + 16 <= width; x += 16) {
+		uint8x16_t s = vld1q_u8 (src + x);
+		uint8x16_t d = vld1q_u8 (dest + x);
+
+		vst1q_u8 (dest + x, vbslq_u8 (vceqq_u8 (s, k), d, blendq_neon (d, s, a)));
+	}
+
+	surfacealphacolorkey8_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealphacolorkey16_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const int16x8_t a = vdupq_n_s16 (alpha);
+	const uint16x8_t k = vdupq_n_u16 (key);
+	uint16_t *d = (uint16_t *) dest;
+	const uint16_t *s = (const uint16_t *) src;
+
+	for (; x + 8 <= width; x += 8) {
+		uint16x8_t sv = vld1q_u16 (s + x);
+		uint16x8_t dv = vld1q_u16 (d + x);
+
+		vst1q_u16 (d + x, vbslq_u16 (vceqq_u16 (sv, k), dv, blend_rgb16_neon (dv, sv, a)));
+	}
+
+	surfacealphacolorkey16_span_c (dest, src, x, width, alpha, key);
+}
+
+static void surfacealphacolorkey32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, uint8_t alpha, uint32_t key)
+{
+	const uint8x16_t a = vdupq_n_u8 (alpha);
+	const uint8x16_t kb = vdupq_n_u8 (key);
+	const uint8x16_t kg = vdupq_n_u8 (key >> 8);
+	const uint8x16_t kr = vdupq_n_u8 (key >> 16);
+	const uint8x16_t ka = vdupq_n_u8 (key >> 24);
+
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x4_t s = vld4q_u8 (src + x * 4);
+		uint8x16x4_t d = vld4q_u8 (dest + x * 4);
+		uint8x16_t keyed;
+
+		keyed = vandq_u8 (vandq_u8 (vceqq_u8 (s.val[0], kb), vceqq_u8 (s.val[1], kg)),
+				vandq_u8 (vceqq_u8 (s.val[2], kr), vceqq_u8 (s.val[3], ka)));
+
+		d.val[0] = vbslq_u8 (keyed, d.val[0], blendq_neon (d.val[0], s.val[0], a));
+		d.val[1] = vbslq_u8 (keyed, d.val[1], blendq_neon (d.val[1], s.val[1], a));
+		d.val[2] = vbslq_u8 (keyed, d.val[2], blendq_neon (d.val[2], s.val[2], a));
+
+		vst4q_u8 (dest + x * 4, d);
+	}
+
+	surfacealphacolorkey32_span_c (dest, src, x, width, alpha, key);
+}
+
+#endif /* VISUAL_HAVE_NEON */
+
+#endif /* VISUAL_LITTLE_ENDIAN */
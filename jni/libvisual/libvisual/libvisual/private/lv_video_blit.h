@@ -3,8 +3,12 @@
 
 #include "lv_video.h"
 
+/* Picks the fastest compose routines for this CPU */
+void visual_video_blit_initialize (void);
+
 int blit_overlay_noalpha      (VisVideo *dest, VisVideo *src);
 int blit_overlay_alphasrc     (VisVideo *dest, VisVideo *src);
+int blit_overlay_alphasrc_premultiplied (VisVideo *dest, VisVideo *src);
 int blit_overlay_colorkey     (VisVideo *dest, VisVideo *src);
 int blit_overlay_surfacealpha (VisVideo *dest, VisVideo *src);
 int blit_overlay_surfacealphacolorkey (VisVideo *dest, VisVideo *src);
@@ -1,5 +1,8 @@
+#include "config.h"
 #include "lv_video_convert.h"
 #include "lv_common.h"
+#include "lv_cpu.h"
+#include "lv_simd.h"
 
 #pragma pack(1)
 
@@ -13,12 +16,137 @@ typedef struct {
 
 #pragma pack()
 
+/* Converts pixels x to width - 1 of row y, dest and src point at the start of the row */
+typedef void (*ConvertSpanFunc) (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+
+/* Ordered dither thresholds for down conversions to 16 bit. The 5 bit
+ * channels add threshold / 2, the 6 bit green channel threshold / 4, so
+ * every channel gets an offset below its quantization step. */
+static const uint8_t dither_4x4[4][4] = {
+	{  0,  8,  2, 10 },
+	{ 12,  4, 14,  6 },
+	{  3, 11,  1,  9 },
+	{ 15,  7, 13,  5 }
+};
+
+#define DITHER_ADD(c, t)	((c) + (t) > 255 ? 255 : (c) + (t))
+
+static void convert_rows (VisVideo *dest, VisVideo *src, ConvertSpanFunc span);
+
+static void rgb16_to_rgb24_span_c  (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void rgb16_to_argb32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void rgb24_to_rgb16_span_c  (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void rgb24_to_argb32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void argb32_to_rgb16_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void argb32_to_rgb24_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void flip_color16_span_c    (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void flip_color24_span_c    (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void flip_color32_span_c    (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+
+#if VISUAL_LITTLE_ENDIAN == 1
+
+#if defined(VISUAL_HAVE_SSE2)
+static void rgb16_to_argb32_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void argb32_to_rgb16_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void flip_color16_span_sse2    (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void flip_color32_span_sse2    (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+#endif
+
+#if defined(VISUAL_HAVE_SSSE3)
+static void rgb16_to_rgb24_span_ssse3  (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void rgb24_to_rgb16_span_ssse3  (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void rgb24_to_argb32_span_ssse3 (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void argb32_to_rgb24_span_ssse3 (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void flip_color24_span_ssse3    (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+#endif
+
+#if defined(VISUAL_HAVE_NEON)
+static void rgb16_to_rgb24_span_neon  (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void rgb16_to_argb32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void rgb24_to_rgb16_span_neon  (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void rgb24_to_argb32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void argb32_to_rgb16_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void argb32_to_rgb24_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void flip_color16_span_neon    (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void flip_color24_span_neon    (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+static void flip_color32_span_neon    (uint8_t *dest, const uint8_t *src, int x, int width, int y);
+#endif
+
+#endif /* VISUAL_LITTLE_ENDIAN */
+
+/* Fastest versions, set by visual_video_convert_initialize() */
+static ConvertSpanFunc rgb16_to_rgb24_span  = rgb16_to_rgb24_span_c;
+static ConvertSpanFunc rgb16_to_argb32_span = rgb16_to_argb32_span_c;
+static ConvertSpanFunc rgb24_to_rgb16_span  = rgb24_to_rgb16_span_c;
+static ConvertSpanFunc rgb24_to_argb32_span = rgb24_to_argb32_span_c;
+static ConvertSpanFunc argb32_to_rgb16_span = argb32_to_rgb16_span_c;
+static ConvertSpanFunc argb32_to_rgb24_span = argb32_to_rgb24_span_c;
+static ConvertSpanFunc flip_color16_span    = flip_color16_span_c;
+static ConvertSpanFunc flip_color24_span    = flip_color24_span_c;
+static ConvertSpanFunc flip_color32_span    = flip_color32_span_c;
+
+void visual_video_convert_initialize (void)
+{
+#if VISUAL_LITTLE_ENDIAN == 1
+
+#if defined(VISUAL_HAVE_SSE2)
+	if (visual_cpu_has_sse2 ()) {
+		rgb16_to_argb32_span = rgb16_to_argb32_span_sse2;
+		argb32_to_rgb16_span = argb32_to_rgb16_span_sse2;
+		flip_color16_span    = flip_color16_span_sse2;
+		flip_color32_span    = flip_color32_span_sse2;
+	}
+#endif
+
+#if defined(VISUAL_HAVE_SSSE3)
+	if (visual_cpu_has_ssse3 ()) {
+		rgb16_to_rgb24_span  = rgb16_to_rgb24_span_ssse3;
+		rgb24_to_rgb16_span  = rgb24_to_rgb16_span_ssse3;
+		rgb24_to_argb32_span = rgb24_to_argb32_span_ssse3;
+		argb32_to_rgb24_span = argb32_to_rgb24_span_ssse3;
+		flip_color24_span    = flip_color24_span_ssse3;
+	}
+#endif
+
+#if defined(VISUAL_HAVE_NEON)
+	if (visual_cpu_has_neon ()) {
+		rgb16_to_rgb24_span  = rgb16_to_rgb24_span_neon;
+		rgb16_to_argb32_span = rgb16_to_argb32_span_neon;
+		rgb24_to_rgb16_span  = rgb24_to_rgb16_span_neon;
+		rgb24_to_argb32_span = rgb24_to_argb32_span_neon;
+		argb32_to_rgb16_span = argb32_to_rgb16_span_neon;
+		argb32_to_rgb24_span = argb32_to_rgb24_span_neon;
+		flip_color16_span    = flip_color16_span_neon;
+		flip_color24_span    = flip_color24_span_neon;
+		flip_color32_span    = flip_color32_span_neon;
+	}
+#endif
+
+#endif /* VISUAL_LITTLE_ENDIAN */
+}
+
 void visual_video_convert_get_smallest (VisVideo *dest, VisVideo *src, int *width, int *height)
 {
 	*width = dest->width > src->width ? src->width : dest->width;
 	*height = dest->height > src->height ? src->height : dest->height;
 }
 
+static void convert_rows (VisVideo *dest, VisVideo *src, ConvertSpanFunc span)
+{
+	uint8_t *dbuf = visual_video_get_pixels (dest);
+	const uint8_t *sbuf = visual_video_get_pixels (src);
+	int w, h, y;
+
+	visual_video_convert_get_smallest (dest, src, &w, &h);
+
+	for (y = 0; y < h; y++) {
+		span (dbuf, sbuf, 0, w, y);
+
+		dbuf += dest->pitch;
+		sbuf += src->pitch;
+	}
+}
+
 void visual_video_index8_to_rgb16 (VisVideo *dest, VisVideo *src)
 {
 	int x, y, i;
@@ -177,77 +305,12 @@ void visual_video_rgb16_to_index8 (VisVideo *dest, VisVideo *src)
 
 void visual_video_rgb16_to_rgb24 (VisVideo *dest, VisVideo *src)
 {
-	int x, y;
-	int w;
-	int h;
-
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	rgb16_t *sbuf = visual_video_get_pixels (src);
-
-	int ddiff;
-	int sdiff;
-
-	visual_video_convert_get_smallest (dest, src, &w, &h);
-
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = (src->pitch  / src->bpp) - w;
-
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-#if VISUAL_LITTLE_ENDIAN == 1
-			*(dbuf++) = sbuf->b << 3;
-			*(dbuf++) = sbuf->g << 2;
-			*(dbuf++) = sbuf->r << 3;
-#else
-			*(dbuf++) = sbuf->r << 3;
-			*(dbuf++) = sbuf->g << 2;
-			*(dbuf++) = sbuf->b << 3;
-#endif /* VISUAL_LITTLE_ENDIAN */
-			sbuf++;
-		}
-
-		dbuf += ddiff;
-		sbuf += sdiff;
-	}
+	convert_rows (dest, src, rgb16_to_rgb24_span);
 }
 
 void visual_video_rgb16_to_argb32 (VisVideo *dest, VisVideo *src)
 {
-	int x, y;
-	int w;
-	int h;
-
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	rgb16_t *sbuf = visual_video_get_pixels (src);
-
-	int ddiff;
-	int sdiff;
-
-	visual_video_convert_get_smallest (dest, src, &w, &h);
-
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = (src->pitch  / src->bpp) - w;
-
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-#if VISUAL_LITTLE_ENDIAN == 1
-			*(dbuf++) = sbuf->b << 3;
-			*(dbuf++) = sbuf->g << 2;
-			*(dbuf++) = sbuf->r << 3;
-			*(dbuf++) = 255;
-#else
-			*(dbuf++) = 255;
-			*(dbuf++) = sbuf->r << 3;
-			*(dbuf++) = sbuf->g << 2;
-			*(dbuf++) = sbuf->b << 3;
-#endif /* VISUAL_LITTLE_ENDIAN */
-
-			sbuf++;
-		}
-
-		dbuf += ddiff;
-		sbuf += sdiff;
-	}
+	convert_rows (dest, src, rgb16_to_argb32_span);
 }
 
 void visual_video_rgb24_to_index8 (VisVideo *dest, VisVideo *src)
@@ -298,75 +361,12 @@ void visual_video_rgb24_to_index8 (VisVideo *dest, VisVideo *src)
 
 void visual_video_rgb24_to_rgb16 (VisVideo *dest, VisVideo *src)
 {
-	int x, y;
-	int w;
-	int h;
-
-	rgb16_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
-
-	int ddiff;
-	int sdiff;
-
-	visual_video_convert_get_smallest (dest, src, &w, &h);
-
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = (src->pitch / src->bpp) - w;
-
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-#if VISUAL_LITTLE_ENDIAN == 1
-			dbuf->b = *(sbuf++) >> 3;
-			dbuf->g = *(sbuf++) >> 2;
-			dbuf->r = *(sbuf++) >> 3;
-#else
-			dbuf->r = *(sbuf++) >> 3;
-			dbuf->g = *(sbuf++) >> 2;
-			dbuf->b = *(sbuf++) >> 3;
-#endif
-			dbuf++;
-		}
-
-		dbuf += ddiff;
-		sbuf += sdiff;
-	}
+	convert_rows (dest, src, rgb24_to_rgb16_span);
 }
 
 void visual_video_rgb24_to_argb32 (VisVideo *dest, VisVideo *src)
 {
-	int x, y;
-	int w;
-	int h;
-
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
-
-	int ddiff;
-	int sdiff;
-
-	visual_video_convert_get_smallest (dest, src, &w, &h);
-
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = src->pitch - (w * src->bpp);
-
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
-#if VISUAL_LITTLE_ENDIAN == 1
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = 255;
-#else
-			*(dbuf++) = 255;
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-#endif /* VISUAL_LITTLE_ENDIAN */
-		}
-
-		dbuf += ddiff;
-		sbuf += sdiff;
-	}
+	convert_rows (dest, src, rgb24_to_argb32_span);
 }
 
 void visual_video_argb32_to_index8 (VisVideo *dest, VisVideo *src)
@@ -420,145 +420,572 @@ void visual_video_argb32_to_index8 (VisVideo *dest, VisVideo *src)
 
 void visual_video_argb32_to_rgb16 (VisVideo *dest, VisVideo *src)
 {
-	int x, y;
-	int w;
-	int h;
+	convert_rows (dest, src, argb32_to_rgb16_span);
+}
 
-	rgb16_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
+void visual_video_argb32_to_rgb24 (VisVideo *dest, VisVideo *src)
+{
+	convert_rows (dest, src, argb32_to_rgb24_span);
+}
 
-	int ddiff;
-	int sdiff;
+void visual_video_flip_pixel_bytes_color16 (VisVideo *dest, VisVideo *src)
+{
+	convert_rows (dest, src, flip_color16_span);
+}
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+void visual_video_flip_pixel_bytes_color24 (VisVideo *dest, VisVideo *src)
+{
+	convert_rows (dest, src, flip_color24_span);
+}
 
-	ddiff = (dest->pitch / dest->bpp) - w;
-	sdiff = src->pitch - (w * src->bpp);
+void visual_video_flip_pixel_bytes_color32 (VisVideo *dest, VisVideo *src)
+{
+	convert_rows (dest, src, flip_color32_span);
+}
+
+/* Plain C versions */
+
+static void rgb16_to_rgb24_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	const uint16_t *s = (const uint16_t *) src;
+	uint8_t *d = dest + x * 3;
+
+	for (; x < width; x++) {
+		uint16_t p = s[x];
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
 #if VISUAL_LITTLE_ENDIAN == 1
-			dbuf->b = *(sbuf++) >> 3;
-			dbuf->g = *(sbuf++) >> 2;
-			dbuf->r = *(sbuf++) >> 3;
-			sbuf++;
+		*(d++) = (p << 3) & 0xf8;
+		*(d++) = (p >> 3) & 0xfc;
+		*(d++) = (p >> 8) & 0xf8;
 #else
-			sbuf++;
-			dbuf->r = *(sbuf++) >> 3;
-			dbuf->g = *(sbuf++) >> 2;
-			dbuf->b = *(sbuf++) >> 3;
+		*(d++) = (p >> 8) & 0xf8;
+		*(d++) = (p >> 3) & 0xfc;
+		*(d++) = (p << 3) & 0xf8;
 #endif /* VISUAL_LITTLE_ENDIAN */
+	}
+}
 
-			dbuf++;
-		}
+static void rgb16_to_argb32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	const uint16_t *s = (const uint16_t *) src;
+	uint8_t *d = dest + x * 4;
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+	for (; x < width; x++) {
+		uint16_t p = s[x];
+
+#if VISUAL_LITTLE_ENDIAN == 1
+		*(d++) = (p << 3) & 0xf8;
+		*(d++) = (p >> 3) & 0xfc;
+		*(d++) = (p >> 8) & 0xf8;
+		*(d++) = 255;
+#else
+		*(d++) = 255;
+		*(d++) = (p >> 8) & 0xf8;
+		*(d++) = (p >> 3) & 0xfc;
+		*(d++) = (p << 3) & 0xf8;
+#endif /* VISUAL_LITTLE_ENDIAN */
 	}
 }
 
-void visual_video_argb32_to_rgb24 (VisVideo *dest, VisVideo *src)
+static void rgb24_to_rgb16_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y)
 {
-	int x, y;
-	int w;
-	int h;
+	const uint8_t *dither = dither_4x4[y & 3];
+	const uint8_t *s = src + x * 3;
+	uint16_t *d = (uint16_t *) dest;
+	int r, g, b;
 
-	uint8_t *dbuf = visual_video_get_pixels (dest);
-	uint8_t *sbuf = visual_video_get_pixels (src);
+	for (; x < width; x++) {
+		int t = dither[x & 3];
 
-	int ddiff;
-	int sdiff;
+#if VISUAL_LITTLE_ENDIAN == 1
+		b = *(s++);
+		g = *(s++);
+		r = *(s++);
+#else
+		r = *(s++);
+		g = *(s++);
+		b = *(s++);
+#endif /* VISUAL_LITTLE_ENDIAN */
 
-	visual_video_convert_get_smallest (dest, src, &w, &h);
+		d[x] = (DITHER_ADD (r, t >> 1) >> 3) << 11 |
+			(DITHER_ADD (g, t >> 2) >> 2) << 5 |
+			(DITHER_ADD (b, t >> 1) >> 3);
+	}
+}
 
-	ddiff = dest->pitch - (w * dest->bpp);
-	sdiff = src->pitch - (w * src->bpp);
+static void rgb24_to_argb32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	const uint8_t *s = src + x * 3;
+	uint8_t *d = dest + x * 4;
 
-	for (y = 0; y < h; y++) {
-		for (x = 0; x < w; x++) {
+	for (; x < width; x++) {
 #if VISUAL_LITTLE_ENDIAN == 1
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			sbuf++;
+		*(d++) = *(s++);
+		*(d++) = *(s++);
+		*(d++) = *(s++);
+		*(d++) = 255;
 #else
-			sbuf++;
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
-			*(dbuf++) = *(sbuf++);
+		*(d++) = 255;
+		*(d++) = *(s++);
+		*(d++) = *(s++);
+		*(d++) = *(s++);
 #endif /* VISUAL_LITTLE_ENDIAN */
-		}
+	}
+}
 
-		dbuf += ddiff;
-		sbuf += sdiff;
+static void argb32_to_rgb16_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	const uint8_t *dither = dither_4x4[y & 3];
+	const uint8_t *s = src + x * 4;
+	uint16_t *d = (uint16_t *) dest;
+	int r, g, b;
+
+	for (; x < width; x++) {
+		int t = dither[x & 3];
+
+#if VISUAL_LITTLE_ENDIAN == 1
+		b = *(s++);
+		g = *(s++);
+		r = *(s++);
+		s++;
+#else
+		s++;
+		r = *(s++);
+		g = *(s++);
+		b = *(s++);
+#endif /* VISUAL_LITTLE_ENDIAN */
+
+		d[x] = (DITHER_ADD (r, t >> 1) >> 3) << 11 |
+			(DITHER_ADD (g, t >> 2) >> 2) << 5 |
+			(DITHER_ADD (b, t >> 1) >> 3);
 	}
 }
 
-void visual_video_flip_pixel_bytes_color16 (VisVideo *dest, VisVideo *src)
+static void argb32_to_rgb24_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y)
 {
-	rgb16_t *destbuf, *srcbuf;
-	int x, y;
-	int pitchdiff = (dest->pitch - (dest->width * dest->bpp)) >> 1;
-
-	destbuf = (rgb16_t *) visual_video_get_pixels (dest);
-	srcbuf  = (rgb16_t *) visual_video_get_pixels (src);
-
-	for (y = 0; y < dest->height; y++) {
-		for (x = 0; x < dest->width; x++) {
-			destbuf->b = srcbuf->r;
-			destbuf->g = srcbuf->g;
-			destbuf->r = srcbuf->b;
-			destbuf++;
-			srcbuf++;
-		}
+	const uint8_t *s = src + x * 4;
+	uint8_t *d = dest + x * 3;
 
-		destbuf += pitchdiff;
+	for (; x < width; x++) {
+#if VISUAL_LITTLE_ENDIAN == 1
+		*(d++) = *(s++);
+		*(d++) = *(s++);
+		*(d++) = *(s++);
+		s++;
+#else
+		s++;
+		*(d++) = *(s++);
+		*(d++) = *(s++);
+		*(d++) = *(s++);
+#endif /* VISUAL_LITTLE_ENDIAN */
 	}
 }
 
-void visual_video_flip_pixel_bytes_color24 (VisVideo *dest, VisVideo *src)
+static void flip_color16_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y)
 {
-	uint8_t *destbuf, *srcbuf;
-	int x, y;
-	int pitchdiff = dest->pitch - (dest->width * dest->bpp);
+	const uint16_t *s = (const uint16_t *) src;
+	uint16_t *d = (uint16_t *) dest;
 
-	destbuf = visual_video_get_pixels (dest);
-	srcbuf = visual_video_get_pixels (src);
+	for (; x < width; x++) {
+		uint16_t p = s[x];
 
-	for (y = 0; y < dest->height; y++) {
-		for (x = 0; x < dest->width; x++) {
-			*(destbuf + 2) = *(srcbuf);
-			*(destbuf + 1) = *(srcbuf + 1);
-			*(destbuf) = *(srcbuf + 2);
+		d[x] = (p >> 11) | (p & 0x07e0) | (p << 11);
+	}
+}
 
-			destbuf += dest->bpp;
-			srcbuf += src->bpp;
-		}
+static void flip_color24_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	const uint8_t *s = src + x * 3;
+	uint8_t *d = dest + x * 3;
 
-		destbuf += pitchdiff;
+	for (; x < width; x++) {
+		uint8_t t = s[0];
+
+		d[1] = s[1];
+		d[0] = s[2];
+		d[2] = t;
+
+		d += 3;
+		s += 3;
 	}
 }
 
-void visual_video_flip_pixel_bytes_color32 (VisVideo *dest, VisVideo *src)
+static void flip_color32_span_c (uint8_t *dest, const uint8_t *src, int x, int width, int y)
 {
-	uint8_t *destbuf, *srcbuf;
-	int x, y;
-	int pitchdiff = dest->pitch - (dest->width * dest->bpp);
+	const uint8_t *s = src + x * 4;
+	uint8_t *d = dest + x * 4;
 
-	destbuf = visual_video_get_pixels (dest);
-	srcbuf = visual_video_get_pixels (src);
+	for (; x < width; x++) {
+		uint8_t t0 = s[0];
+		uint8_t t1 = s[1];
 
-	for (y = 0; y < dest->height; y++) {
-		for (x = 0; x < dest->width; x++) {
-			destbuf[0] = srcbuf[3];
-			destbuf[1] = srcbuf[2];
-			destbuf[2] = srcbuf[1];
-			destbuf[3] = srcbuf[0];
+		d[0] = s[3];
+		d[1] = s[2];
+		d[2] = t1;
+		d[3] = t0;
 
-			destbuf += dest->bpp;
-			srcbuf += src->bpp;
-		}
+		d += 4;
+		s += 4;
+	}
+}
+
+
+#if VISUAL_LITTLE_ENDIAN == 1
+
+#if defined(VISUAL_HAVE_SSE2)
+
+/* Dither offsets for four argb32 pixels starting at a multiple of 4 */
+static __m128i dither_argb32_sse2 (int y)
+{
+	const uint8_t *t = dither_4x4[y & 3];
+
+	return _mm_setr_epi8 (t[0] >> 1, t[0] >> 2, t[0] >> 1, 0,
+			t[1] >> 1, t[1] >> 2, t[1] >> 1, 0,
+			t[2] >> 1, t[2] >> 2, t[2] >> 1, 0,
+			t[3] >> 1, t[3] >> 2, t[3] >> 1, 0);
+}
+
+/* Four argb32 pixels to rgb565, one per 32 bit lane */
+static inline __m128i pack_rgb16_sse2 (__m128i p)
+{
+	__m128i r = _mm_and_si128 (_mm_srli_epi32 (p, 8), _mm_set1_epi32 (0xf800));
+	__m128i g = _mm_and_si128 (_mm_srli_epi32 (p, 5), _mm_set1_epi32 (0x07e0));
+	__m128i b = _mm_and_si128 (_mm_srli_epi32 (p, 3), _mm_set1_epi32 (0x001f));
+
+	/* Sign extend so the signed saturating pack keeps the bits */
+	return _mm_srai_epi32 (_mm_slli_epi32 (_mm_or_si128 (_mm_or_si128 (r, g), b), 16), 16);
+}
+
+/* Eight rgb565 pixels to two vectors of argb32 */
+static inline void unpack_rgb16_sse2 (__m128i p, __m128i *lo, __m128i *hi)
+{
+	__m128i b = _mm_and_si128 (_mm_slli_epi16 (p, 3), _mm_set1_epi16 (0x00f8));
+	__m128i g = _mm_and_si128 (_mm_srli_epi16 (p, 3), _mm_set1_epi16 (0x00fc));
+	__m128i r = _mm_and_si128 (_mm_srli_epi16 (p, 8), _mm_set1_epi16 (0x00f8));
+
+	__m128i bg = _mm_or_si128 (b, _mm_slli_epi16 (g, 8));
+	__m128i ra = _mm_or_si128 (r, _mm_set1_epi16 ((short) 0xff00));
+
+	*lo = _mm_unpacklo_epi16 (bg, ra);
+	*hi = _mm_unpackhi_epi16 (bg, ra);
+}
+
+static void rgb16_to_argb32_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	for (; x + 8 <= width; x += 8) {
+		__m128i lo, hi;
+
+		unpack_rgb16_sse2 (_mm_loadu_si128 ((const __m128i *) (src + x * 2)), &lo, &hi);
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4), lo);
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4 + 16), hi);
+	}
+
+	rgb16_to_argb32_span_c (dest, src, x, width, y);
+}
+
+static void argb32_to_rgb16_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	__m128i dither = dither_argb32_sse2 (y);
+
+	for (; x + 8 <= width; x += 8) {
+		__m128i p0 = _mm_adds_epu8 (_mm_loadu_si128 ((const __m128i *) (src + x * 4)), dither);
+		__m128i p1 = _mm_adds_epu8 (_mm_loadu_si128 ((const __m128i *) (src + x * 4 + 16)), dither);
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 2),
+				_mm_packs_epi32 (pack_rgb16_sse2 (p0), pack_rgb16_sse2 (p1)));
+	}
+
+	argb32_to_rgb16_span_c (dest, src, x, width, y);
+}
+
+static void flip_color16_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	for (; x + 8 <= width; x += 8) {
+		__m128i p = _mm_loadu_si128 ((const __m128i *) (src + x * 2));
+
+		p = _mm_or_si128 (_mm_or_si128 (_mm_srli_epi16 (p, 11), _mm_slli_epi16 (p, 11)),
+				_mm_and_si128 (p, _mm_set1_epi16 (0x07e0)));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 2), p);
+	}
+
+	flip_color16_span_c (dest, src, x, width, y);
+}
+
+static void flip_color32_span_sse2 (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	for (; x + 4 <= width; x += 4) {
+		__m128i p = _mm_loadu_si128 ((const __m128i *) (src + x * 4));
+
+		p = _mm_or_si128 (
+				_mm_or_si128 (_mm_slli_epi32 (p, 24), _mm_srli_epi32 (p, 24)),
+				_mm_or_si128 (_mm_and_si128 (_mm_slli_epi32 (p, 8), _mm_set1_epi32 (0x00ff0000)),
+					_mm_and_si128 (_mm_srli_epi32 (p, 8), _mm_set1_epi32 (0x0000ff00))));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4), p);
+	}
+
+	flip_color32_span_c (dest, src, x, width, y);
+}
+
+#endif /* VISUAL_HAVE_SSE2 */
+
+#if defined(VISUAL_HAVE_SSSE3)
+
+/* The rgb24 versions move four pixels through 16 byte loads and stores.
+ * Those reach 4 bytes into the next pixels, which is why they stop 6
+ * pixels before the end of the row, and why the stores are done in
+ * order so the next iteration overwrites the excess. */
+
+VISUAL_TARGET_SSSE3
+static void rgb16_to_rgb24_span_ssse3 (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	const __m128i shuffle = _mm_setr_epi8 (0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	for (; x + 10 <= width; x += 8) {
+		__m128i lo, hi;
+
+		unpack_rgb16_sse2 (_mm_loadu_si128 ((const __m128i *) (src + x * 2)), &lo, &hi);
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 3), _mm_shuffle_epi8 (lo, shuffle));
+		_mm_storeu_si128 ((__m128i *) (dest + x * 3 + 12), _mm_shuffle_epi8 (hi, shuffle));
+	}
+
+	rgb16_to_rgb24_span_c (dest, src, x, width, y);
+}
+
+VISUAL_TARGET_SSSE3
+static void rgb24_to_rgb16_span_ssse3 (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	const __m128i shuffle = _mm_setr_epi8 (0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	__m128i dither = dither_argb32_sse2 (y);
+
+	for (; x + 10 <= width; x += 8) {
+		__m128i p0 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (src + x * 3)), shuffle);
+		__m128i p1 = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (src + x * 3 + 12)), shuffle);
+
+		p0 = _mm_adds_epu8 (p0, dither);
+		p1 = _mm_adds_epu8 (p1, dither);
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 2),
+				_mm_packs_epi32 (pack_rgb16_sse2 (p0), pack_rgb16_sse2 (p1)));
+	}
 
-		destbuf += pitchdiff;
+	rgb24_to_rgb16_span_c (dest, src, x, width, y);
+}
+
+VISUAL_TARGET_SSSE3
+static void rgb24_to_argb32_span_ssse3 (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	const __m128i shuffle = _mm_setr_epi8 (0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alpha = _mm_set1_epi32 (0xff000000);
+
+	for (; x + 6 <= width; x += 4) {
+		__m128i p = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *) (src + x * 3)), shuffle);
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4), _mm_or_si128 (p, alpha));
 	}
+
+	rgb24_to_argb32_span_c (dest, src, x, width, y);
+}
+
+VISUAL_TARGET_SSSE3
+static void argb32_to_rgb24_span_ssse3 (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	const __m128i shuffle = _mm_setr_epi8 (0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+	for (; x + 6 <= width; x += 4) {
+		__m128i p = _mm_loadu_si128 ((const __m128i *) (src + x * 4));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 3), _mm_shuffle_epi8 (p, shuffle));
+	}
+
+	argb32_to_rgb24_span_c (dest, src, x, width, y);
 }
+
+VISUAL_TARGET_SSSE3
+static void flip_color24_span_ssse3 (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	/* The last four bytes are passed through, so flipping in place works */
+	const __m128i shuffle = _mm_setr_epi8 (2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15);
+
+	for (; x + 6 <= width; x += 4) {
+		__m128i p = _mm_loadu_si128 ((const __m128i *) (src + x * 3));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 3), _mm_shuffle_epi8 (p, shuffle));
+	}
+
+	flip_color24_span_c (dest, src, x, width, y);
+}
+
+#endif /* VISUAL_HAVE_SSSE3 */
+
+#if defined(VISUAL_HAVE_NEON)
+
+/* Eight pixels worth of dither offsets for one channel */
+static uint8x8_t dither_channel_neon (int y, int shift)
+{
+	const uint8_t *t = dither_4x4[y & 3];
+	uint8_t offsets[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		offsets[i] = t[i & 3] >> shift;
+
+	return vld1_u8 (offsets);
+}
+
+static inline uint16x8_t pack_rgb16_neon (uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+	uint16x8_t p = vshll_n_u8 (r, 8);
+
+	p = vsriq_n_u16 (p, vshll_n_u8 (g, 8), 5);
+	p = vsriq_n_u16 (p, vshll_n_u8 (b, 8), 11);
+
+	return p;
+}
+
+static inline uint8x8x4_t unpack_rgb16_neon (uint16x8_t p)
+{
+	uint8x8x4_t v;
+
+	v.val[0] = vshl_n_u8 (vmovn_u16 (p), 3);
+	v.val[1] = vand_u8 (vshrn_n_u16 (p, 3), vdup_n_u8 (0xfc));
+	v.val[2] = vand_u8 (vshrn_n_u16 (p, 8), vdup_n_u8 (0xf8));
+	v.val[3] = vdup_n_u8 (255);
+
+	return v;
+}
+
+static void rgb16_to_rgb24_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	for (; x + 8 <= width; x += 8) {
+		uint8x8x4_t p = unpack_rgb16_neon (vld1q_u16 ((const uint16_t *) (src + x * 2)));
+		uint8x8x3_t v;
+
+		v.val[0] = p.val[0];
+		v.val[1] = p.val[1];
+		v.val[2] = p.val[2];
+
+		vst3_u8 (dest + x * 3, v);
+	}
+
+	rgb16_to_rgb24_span_c (dest, src, x, width, y);
+}
+
+static void rgb16_to_argb32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	for (; x + 8 <= width; x += 8)
+		vst4_u8 (dest + x * 4, unpack_rgb16_neon (vld1q_u16 ((const uint16_t *) (src + x * 2))));
+
+	rgb16_to_argb32_span_c (dest, src, x, width, y);
+}
+
+static void rgb24_to_rgb16_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	uint8x8_t dither5 = dither_channel_neon (y, 1);
+	uint8x8_t dither6 = dither_channel_neon (y, 2);
+
+	for (; x + 8 <= width; x += 8) {
+		uint8x8x3_t p = vld3_u8 (src + x * 3);
+
+		vst1q_u16 ((uint16_t *) (dest + x * 2),
+				pack_rgb16_neon (vqadd_u8 (p.val[2], dither5),
+					vqadd_u8 (p.val[1], dither6),
+					vqadd_u8 (p.val[0], dither5)));
+	}
+
+	rgb24_to_rgb16_span_c (dest, src, x, width, y);
+}
+
+static void rgb24_to_argb32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x3_t p = vld3q_u8 (src + x * 3);
+		uint8x16x4_t v;
+
+		v.val[0] = p.val[0];
+		v.val[1] = p.val[1];
+		v.val[2] = p.val[2];
+		v.val[3] = vdupq_n_u8 (255);
+
+		vst4q_u8 (dest + x * 4, v);
+	}
+
+	rgb24_to_argb32_span_c (dest, src, x, width, y);
+}
+
+static void argb32_to_rgb16_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	uint8x8_t dither5 = dither_channel_neon (y, 1);
+	uint8x8_t dither6 = dither_channel_neon (y, 2);
+
+	for (; x + 8 <= width; x += 8) {
+		uint8x8x4_t p = vld4_u8 (src + x * 4);
+
+		vst1q_u16 ((uint16_t *) (dest + x * 2),
+				pack_rgb16_neon (vqadd_u8 (p.val[2], dither5),
+					vqadd_u8 (p.val[1], dither6),
+					vqadd_u8 (p.val[0], dither5)));
+	}
+
+	argb32_to_rgb16_span_c (dest, src, x, width, y);
+}
+
+static void argb32_to_rgb24_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x4_t p = vld4q_u8 (src + x * 4);
+		uint8x16x3_t v;
+
+		v.val[0] = p.val[0];
+		v.val[1] = p.val[1];
+		v.val[2] = p.val[2];
+
+		vst3q_u8 (dest + x * 3, v);
+	}
+
+	argb32_to_rgb24_span_c (dest, src, x, width, y);
+}
+
+static void flip_color16_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	for (; x + 8 <= width; x += 8) {
+		uint16x8_t p = vld1q_u16 ((const uint16_t *) (src + x * 2));
+
+		p = vorrq_u16 (vorrq_u16 (vshrq_n_u16 (p, 11), vshlq_n_u16 (p, 11)),
+				vandq_u16 (p, vdupq_n_u16 (0x07e0)));
+
+		vst1q_u16 ((uint16_t *) (dest + x * 2), p);
+	}
+
+	flip_color16_span_c (dest, src, x, width, y);
+}
+
+static void flip_color24_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	for (; x + 16 <= width; x += 16) {
+		uint8x16x3_t p = vld3q_u8 (src + x * 3);
+		uint8x16_t t = p.val[0];
+
+		p.val[0] = p.val[2];
+		p.val[2] = t;
+
+		vst3q_u8 (dest + x * 3, p);
+	}
+
+	flip_color24_span_c (dest, src, x, width, y);
+}
+
+static void flip_color32_span_neon (uint8_t *dest, const uint8_t *src, int x, int width, int y)
+{
+	for (; x + 4 <= width; x += 4)
+		vst1q_u8 (dest + x * 4, vrev32q_u8 (vld1q_u8 (src + x * 4)));
+
+	flip_color32_span_c (dest, src, x, width, y);
+}
+
+#endif /* VISUAL_HAVE_NEON */
+
+#endif /* VISUAL_LITTLE_ENDIAN */
@@ -3,6 +3,9 @@
 
 #include "lv_video.h"
 
+/* Picks the fastest conversion routines for this CPU */
+void visual_video_convert_initialize (void);
+
 void visual_video_convert_get_smallest (VisVideo *dest, VisVideo *src, int *width, int *height);
 
 void visual_video_index8_to_rgb16  (VisVideo *dest, VisVideo *src);
@@ -1,5 +1,10 @@
+#include "config.h"
 #include "lv_video_scale.h"
 #include "lv_common.h"
+#include "lv_cpu.h"
+#include "lv_worker_pool.h"
+#include "lv_simd.h"
+#include <string.h>
 
 #pragma pack(1)
 
@@ -7,10 +12,6 @@
    'b', the scale functions are very much pixel format agnostic. They
    only assume the number of components. */
 
-typedef struct {
-	uint16_t r:5, g:6, b:5;
-} color16_t;
-
 typedef struct {
 	uint8_t r, g, b;
 } color24_t;
@@ -188,291 +189,875 @@ void visual_video_scale_nearest_color32 (VisVideo *dest, VisVideo *src)
 	}
 }
 
+/* Bilinear and area scaling
+ *
+ * Both run on bands of destination rows which are spread over the
+ * scaler's VisWorkerPool. Pixels are handled as 1, 3 or 4 channels of 8
+ * bits; 16 bit pixels are expanded to 4 channels of which the last one
+ * stays zero, and are packed again once a destination row is done.
+ *
+ * Bilinear interpolates the two source rows around a destination row
+ * into an intermediate row of 16 bit values with a 7 bit weight, then
+ * interpolates between neighbouring pixels of that row with another 7 bit
+ * weight. The C and SIMD versions give identical results.
+ *
+ * Area averages all source pixels a destination pixel covers, weighted
+ * by the covered fraction, with 12 bit weights per axis. */
+
+#define SCALE_FRAC_BITS		7
+#define SCALE_ONE		(1 << SCALE_FRAC_BITS)
+#define SCALE_SHIFT		(SCALE_FRAC_BITS * 2)
+#define SCALE_ROUND		(1 << (SCALE_SHIFT - 1))
+
+#define AREA_WEIGHT_BITS	12
+#define AREA_ONE		(1 << AREA_WEIGHT_BITS)
+#define AREA_SHIFT		(AREA_WEIGHT_BITS * 2)
+#define AREA_ROUND		(1 << (AREA_SHIFT - 1))
+
+/* Smallest band of rows worth handing to another thread */
+#define SCALE_MIN_TILE_ROWS	16
+
+/* Extra intermediate row entries, SIMD versions read up to 8 values from the last tap */
+#define SCALE_ROW_PAD		8
+
+typedef struct {
+	int		*start;		/* First source pixel of every destination pixel */
+	int		*count;		/* Number of source pixels */
+	int		*first;		/* Index of the first weight */
+	uint16_t	*weight;	/* Weights, summing to AREA_ONE per destination pixel */
+} AreaTaps;
+
+typedef struct {
+	VisVideo	*dest;
+	VisVideo	*src;
+	int		 channels;	/* Channels per pixel in the intermediate rows */
+	int		 packed16;	/* Pixels are 16 bit and are expanded to 4 channels */
+
+	/* Bilinear: left tap of each destination pixel in the intermediate
+	 * row, and the left and right weight packed as (right << 16) | left */
+	int32_t		*xoffset;
+	uint32_t	*xweight;
+
+	/* Area */
+	AreaTaps	 xtaps;
+	AreaTaps	 ytaps;
+} ScaleJob;
+
+typedef void (*ScaleLerpRowFunc) (int16_t *dest, const uint8_t *top, const uint8_t *bottom, int count, int frac);
+typedef void (*ScaleLerpRow16Func) (int16_t *dest, const uint16_t *top, const uint16_t *bottom, int width, int frac);
+typedef void (*ScaleFilterRowFunc) (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width);
+typedef void (*ScalePackRow16Func) (uint16_t *dest, const uint8_t *src, int width);
+
+static void lerp_row_c (int16_t *dest, const uint8_t *top, const uint8_t *bottom, int count, int frac);
+static void lerp_row16_c (int16_t *dest, const uint16_t *top, const uint16_t *bottom, int width, int frac);
+static void filter_row1_c (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width);
+static void filter_row3_c (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width);
+static void filter_row4_c (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width);
+static void pack_row16_c (uint16_t *dest, const uint8_t *src, int width);
+static void unpack_row16 (uint8_t *dest, const uint16_t *src, int width);
+
+#if defined(VISUAL_HAVE_SSE2)
+static void lerp_row_sse2 (int16_t *dest, const uint8_t *top, const uint8_t *bottom, int count, int frac);
+static void lerp_row16_sse2 (int16_t *dest, const uint16_t *top, const uint16_t *bottom, int width, int frac);
+static void filter_row1_sse2 (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width);
+static void filter_row3_sse2 (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width);
+static void filter_row4_sse2 (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width);
+static void pack_row16_sse2 (uint16_t *dest, const uint8_t *src, int width);
+#endif
+
+#if defined(VISUAL_HAVE_NEON)
+static void lerp_row_neon (int16_t *dest, const uint8_t *top, const uint8_t *bottom, int count, int frac);
+static void lerp_row16_neon (int16_t *dest, const uint16_t *top, const uint16_t *bottom, int width, int frac);
+static void filter_row1_neon (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width);
+static void filter_row3_neon (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width);
+static void filter_row4_neon (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width);
+static void pack_row16_neon (uint16_t *dest, const uint8_t *src, int width);
+#endif
+
+/* Fastest versions, set by visual_video_scale_initialize() */
+static ScaleLerpRowFunc   lerp_row    = lerp_row_c;
+static ScaleLerpRow16Func lerp_row16  = lerp_row16_c;
+static ScaleFilterRowFunc filter_row1 = filter_row1_c;
+static ScaleFilterRowFunc filter_row3 = filter_row3_c;
+static ScaleFilterRowFunc filter_row4 = filter_row4_c;
+static ScalePackRow16Func pack_row16  = pack_row16_c;
+
+static VisWorkerPool *scale_pool = NULL;
+
+static void scale_run (ScaleJob *job, VisWorkerFunc func);
+static void scale_bilinear (VisVideo *dest, VisVideo *src);
+static void scale_bilinear_tile (void *data, int index, int count);
+static void scale_area (VisVideo *dest, VisVideo *src);
+static void scale_area_tile (void *data, int index, int count);
+static void area_taps_init (AreaTaps *taps, int src_size, int dest_size);
+static void area_taps_free (AreaTaps *taps);
+
+
+void visual_video_scale_initialize (void)
+{
+#if defined(VISUAL_HAVE_SSE2)
+	if (visual_cpu_has_sse2 ()) {
+		lerp_row    = lerp_row_sse2;
+		lerp_row16  = lerp_row16_sse2;
+		filter_row1 = filter_row1_sse2;
+		filter_row3 = filter_row3_sse2;
+		filter_row4 = filter_row4_sse2;
+		pack_row16  = pack_row16_sse2;
+	}
+#endif
+
+#if defined(VISUAL_HAVE_NEON)
+	if (visual_cpu_has_neon ()) {
+		lerp_row    = lerp_row_neon;
+		lerp_row16  = lerp_row16_neon;
+		filter_row1 = filter_row1_neon;
+		filter_row3 = filter_row3_neon;
+		filter_row4 = filter_row4_neon;
+		pack_row16  = pack_row16_neon;
+	}
+#endif
+
+	if (scale_pool == NULL)
+		scale_pool = visual_worker_pool_new (0);
+}
+
+void visual_video_scale_deinitialize (void)
+{
+	if (scale_pool != NULL)
+		visual_object_unref (VISUAL_OBJECT (scale_pool));
+
+	scale_pool = NULL;
+}
+
+void visual_video_scale_set_threads (int threads)
+{
+	visual_return_if_fail (scale_pool != NULL);
+
+	visual_worker_pool_set_threads (scale_pool, threads);
+}
+
+int visual_video_scale_get_threads (void)
+{
+	if (scale_pool == NULL)
+		return 1;
+
+	return visual_worker_pool_get_threads (scale_pool);
+}
+
 void visual_video_scale_bilinear_color8 (VisVideo *dest, VisVideo *src)
 {
-	uint32_t y;
-	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	uint8_t *dest_pixel, *src_pixel_rowu, *src_pixel_rowl;
+	scale_bilinear (dest, src);
+}
 
-	dest_pixel = visual_video_get_pixels (dest);
+void visual_video_scale_bilinear_color16 (VisVideo *dest, VisVideo *src)
+{
+	scale_bilinear (dest, src);
+}
 
-	du = ((src->width - 1)  << 16) / dest->width;
-	dv = ((src->height - 1) << 16) / dest->height;
-	v = 0;
+void visual_video_scale_bilinear_color24 (VisVideo *dest, VisVideo *src)
+{
+	scale_bilinear (dest, src);
+}
 
-	for (y = dest->height; y--; v += dv) {
-		uint32_t x;
-		uint32_t fracU, fracV;     /* fixed point 24.8 [0,1[    */
+void visual_video_scale_bilinear_color32 (VisVideo *dest, VisVideo *src)
+{
+	scale_bilinear (dest, src);
+}
 
-		if (v >> 16 >= src->height - 1)
-			v -= 0x10000;
+void visual_video_scale_area_color8 (VisVideo *dest, VisVideo *src)
+{
+	scale_area (dest, src);
+}
 
-		src_pixel_rowu = (uint8_t *) src->pixel_rows[v >> 16];
-		src_pixel_rowl = (uint8_t *) src->pixel_rows[(v >> 16) + 1];
+void visual_video_scale_area_color16 (VisVideo *dest, VisVideo *src)
+{
+	scale_area (dest, src);
+}
 
-		/* fracV = frac(v) = v & 0xffff */
-		/* fixed point format convertion: fracV >>= 8) */
-		fracV = (v & 0xffff) >> 8;
-		u = 0;
+void visual_video_scale_area_color24 (VisVideo *dest, VisVideo *src)
+{
+	scale_area (dest, src);
+}
 
-		for (x = dest->width - 1; x--; u += du) {
-			uint8_t cul, cll, cur, clr;
-			uint32_t ul, ll, ur, lr; /* fixed point 16.16 [0,1[   */
-			uint32_t b0; /* fixed point 16.16 [0,255[ */
+void visual_video_scale_area_color32 (VisVideo *dest, VisVideo *src)
+{
+	scale_area (dest, src);
+}
 
-			/* fracU = frac(u) = u & 0xffff */
-			/* fixed point format convertion: fracU >>= 8) */
-			fracU  = (u & 0xffff) >> 8;
+static void scale_job_init (ScaleJob *job, VisVideo *dest, VisVideo *src)
+{
+	visual_mem_set (job, 0, sizeof (ScaleJob));
 
-			/* notice 0x100 = 1.0 (fixed point 24.8) */
-			ul = (0x100 - fracU) * (0x100 - fracV);
-			ll = (0x100 - fracU) * fracV;
-			ur = fracU * (0x100 - fracV);
-			lr = fracU * fracV;
+	job->dest = dest;
+	job->src = src;
+	job->packed16 = dest->bpp == 2;
+	job->channels = job->packed16 ? 4 : dest->bpp;
+}
 
-			cul = src_pixel_rowu[u >> 16];
-			cll = src_pixel_rowl[u >> 16];
-			cur = src_pixel_rowu[(u >> 16) + 1];
-			clr = src_pixel_rowl[(u >> 16) + 1];
+static void scale_run (ScaleJob *job, VisWorkerFunc func)
+{
+	int threads = visual_video_scale_get_threads ();
+	int tiles = threads > 1 ? threads * 2 : 1;
 
-			b0 = ul * cul;
-			b0 += ll * cll;
-			b0 += ur * cur;
-			b0 += lr * clr;
+	if (tiles * SCALE_MIN_TILE_ROWS > job->dest->height)
+		tiles = job->dest->height / SCALE_MIN_TILE_ROWS;
 
-			*dest_pixel++ = b0 >> 16;
-		}
+	if (tiles < 1)
+		tiles = 1;
 
-		dest_pixel += dest->pitch - (dest->width - 1);
+	if (scale_pool != NULL) {
+		visual_worker_pool_run (scale_pool, func, job, tiles);
+	} else {
+		int i;
 
+		for (i = 0; i < tiles; i++)
+			func (job, i, tiles);
 	}
 }
 
-void visual_video_scale_bilinear_color16 (VisVideo *dest, VisVideo *src)
+static void scale_bilinear (VisVideo *dest, VisVideo *src)
 {
-	uint32_t y;
-	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	color16_t *dest_pixel, *src_pixel_rowu, *src_pixel_rowl;
-	dest_pixel = visual_video_get_pixels (dest);
+	ScaleJob job;
+	uint32_t u, du; /* fixed point 16.16 */
+	int x;
+
+	if (dest->width < 1 || dest->height < 1 || src->width < 1 || src->height < 1)
+		return;
+
+	scale_job_init (&job, dest, src);
+
+	job.xoffset = visual_mem_new0 (int32_t, dest->width);
+	job.xweight = visual_mem_new0 (uint32_t, dest->width);
+
+	du = ((src->width - 1) << 16) / dest->width;
+	u = 0;
+
+	for (x = 0; x < dest->width; x++, u += du) {
+		uint32_t frac = (u & 0xffff) >> (16 - SCALE_FRAC_BITS);
+
+		job.xoffset[x] = (u >> 16) * job.channels;
+		job.xweight[x] = (frac << 16) | (SCALE_ONE - frac);
+	}
+
+	scale_run (&job, scale_bilinear_tile);
+
+	visual_mem_free (job.xoffset);
+	visual_mem_free (job.xweight);
+}
+
+static void scale_bilinear_tile (void *data, int index, int count)
+{
+	ScaleJob *job = data;
+	VisVideo *dest = job->dest;
+	VisVideo *src = job->src;
+	int channels = job->channels;
+	int ystart = dest->height * index / count;
+	int yend = dest->height * (index + 1) / count;
+	int16_t *row;
+	uint8_t *line = NULL;
+	uint32_t v, dv; /* fixed point 16.16 */
+	int rowsize = (src->width + 1) * channels;
+	int y, c;
+
+	/* The entry past the last pixel repeats it, so the right tap of a
+	 * one pixel wide source stays inside the row */
+	row = visual_mem_malloc0 ((rowsize + SCALE_ROW_PAD) * sizeof (int16_t));
+
+	if (job->packed16)
+		line = visual_mem_malloc (dest->width * 4);
 
-	du = ((src->width - 1)  << 16) / dest->width;
 	dv = ((src->height - 1) << 16) / dest->height;
-	v = 0;
+	v = ystart * dv;
 
-	for (y = dest->height; y--; v += dv) {
-		uint32_t x;
-		uint32_t fracU, fracV;     /* fixed point 24.8 [0,1[    */
+	for (y = ystart; y < yend; y++, v += dv) {
+		int sy = v >> 16;
+		int frac = (v & 0xffff) >> (16 - SCALE_FRAC_BITS);
+		const uint8_t *top, *bottom;
+		uint8_t *dest_pixel = dest->pixel_rows[y];
 
-		if (v >> 16 >= src->height - 1)
-			v -= 0x10000;
+		if (sy >= src->height - 1) {
+			sy = src->height - 1;
+			frac = 0;
+		}
+
+		top = src->pixel_rows[sy];
+		bottom = frac != 0 ? src->pixel_rows[sy + 1] : top;
+
+		if (job->packed16)
+			lerp_row16 (row, (const uint16_t *) top, (const uint16_t *) bottom, src->width, frac);
+		else
+			lerp_row (row, top, bottom, src->width * channels, frac);
+
+		for (c = 0; c < channels; c++)
+			row[src->width * channels + c] = row[(src->width - 1) * channels + c];
+
+		switch (channels) {
+			case 1:
+				filter_row1 (dest_pixel, row, job->xoffset, job->xweight, dest->width);
+				break;
 
-		src_pixel_rowu = (color16_t *) src->pixel_rows[v >> 16];
-		src_pixel_rowl = (color16_t *) src->pixel_rows[(v >> 16) + 1];
+			case 3:
+				filter_row3 (dest_pixel, row, job->xoffset, job->xweight, dest->width);
+				break;
 
-		/* fracV = frac(v) = v & 0xffff */
-		/* fixed point format convertion: fracV >>= 8) */
-		fracV = (v & 0xffff) >> 8;
-		u = 0.0;
+			default:
+				if (job->packed16) {
+					filter_row4 (line, row, job->xoffset, job->xweight, dest->width);
+					pack_row16 ((uint16_t *) dest_pixel, line, dest->width);
+				} else {
+					filter_row4 (dest_pixel, row, job->xoffset, job->xweight, dest->width);
+				}
 
-		for (x = dest->width - 1; x--; u += du) {
-			color16_t cul, cll, cur, clr, b;
-			uint32_t ul, ll, ur, lr; /* fixed point 16.16 [0,1[	  */
-			uint32_t b2, b1, b0;	 /* fixed point 16.16 [0,255[ */
+				break;
+		}
+	}
 
-			/* fracU = frac(u) = u & 0xffff */
-			/* fixed point format convertion: fracU >>= 8) */
-			fracU  = (u & 0xffff) >> 8;
+	if (line != NULL)
+		visual_mem_free (line);
+
+	visual_mem_free (row);
+}
 
-			/* notice 0x100 = 1.0 (fixed point 24.8) */
-			ul = (0x100 - fracU) * (0x100 - fracV);
-			ll = (0x100 - fracU) * fracV;
-			ur = fracU * (0x100 - fracV);
-			lr = fracU * fracV;
+static void area_taps_init (AreaTaps *taps, int src_size, int dest_size)
+{
+	int d, s, n;
 
-			cul = src_pixel_rowu[u >> 16];
-			cll = src_pixel_rowl[u >> 16];
-			cur = src_pixel_rowu[(u >> 16) + 1];
-			clr = src_pixel_rowl[(u >> 16) + 1];
+	/* Positions are measured in units of which a source pixel spans
+	 * dest_size and a destination pixel src_size, keeping them exact */
 
-			b0 = ul * cul.r;
-			b1 = ul * cul.g;
-			b2 = ul * cul.b;
+	taps->start  = visual_mem_new0 (int, dest_size);
+	taps->count  = visual_mem_new0 (int, dest_size);
+	taps->first  = visual_mem_new0 (int, dest_size);
+	taps->weight = visual_mem_new0 (uint16_t, src_size + dest_size);
 
-			b0 += ll * cll.r;
-			b1 += ll * cll.g;
-			b2 += ll * cll.b;
+	n = 0;
 
-			b0 += ur * cur.r;
-			b1 += ur * cur.g;
-			b2 += ur * cur.b;
+	for (d = 0; d < dest_size; d++) {
+		int begin = d * src_size;
+		int end = begin + src_size;
+		int first = begin / dest_size;
+		int last = (end - 1) / dest_size;
 
-			b0 += lr * clr.r;
-			b1 += lr * clr.g;
-			b2 += lr * clr.b;
+		taps->start[d] = first;
+		taps->count[d] = last - first + 1;
+		taps->first[d] = n;
 
-			b.r = b0 >> 16;
-			b.g = b1 >> 16;
-			b.b = b2 >> 16;
+		for (s = first; s <= last; s++) {
+			int from = (s * dest_size > begin ? s * dest_size : begin) - begin;
+			int to = ((s + 1) * dest_size < end ? (s + 1) * dest_size : end) - begin;
 
-			*dest_pixel++ = b;
+			/* Rounding the running sum makes the weights add up to AREA_ONE */
+			taps->weight[n++] = (int64_t) to * AREA_ONE / src_size - (int64_t) from * AREA_ONE / src_size;
 		}
+	}
+}
+
+static void area_taps_free (AreaTaps *taps)
+{
+	visual_mem_free (taps->start);
+	visual_mem_free (taps->count);
+	visual_mem_free (taps->first);
+	visual_mem_free (taps->weight);
+}
+
+static void scale_area (VisVideo *dest, VisVideo *src)
+{
+	ScaleJob job;
+
+	if (dest->width < 1 || dest->height < 1 || src->width < 1 || src->height < 1)
+		return;
+
+	scale_job_init (&job, dest, src);
+
+	area_taps_init (&job.xtaps, src->width, dest->width);
+	area_taps_init (&job.ytaps, src->height, dest->height);
 
-		dest_pixel += (dest->pitch / dest->bpp) - ((dest->width - 1));
+	scale_run (&job, scale_area_tile);
+
+	area_taps_free (&job.xtaps);
+	area_taps_free (&job.ytaps);
+}
+
+static void scale_area_tile (void *data, int index, int count)
+{
+	ScaleJob *job = data;
+	VisVideo *dest = job->dest;
+	VisVideo *src = job->src;
+	AreaTaps *xtaps = &job->xtaps;
+	AreaTaps *ytaps = &job->ytaps;
+	int channels = job->channels;
+	int ystart = dest->height * index / count;
+	int yend = dest->height * (index + 1) / count;
+	int rowsize = src->width * channels;
+	uint32_t *sums;
+	uint8_t *line;
+	int x, y, i, k, c;
+
+	sums = visual_mem_new0 (uint32_t, rowsize);
+	line = visual_mem_malloc ((rowsize > dest->width * 4 ? rowsize : dest->width * 4));
+
+	for (y = ystart; y < yend; y++) {
+		uint8_t *dest_pixel = dest->pixel_rows[y];
+		uint8_t *out;
+
+		/* Weighted sum of the source rows, at most 255 * AREA_ONE */
+		visual_mem_set (sums, 0, rowsize * sizeof (uint32_t));
+
+		for (k = 0; k < ytaps->count[y]; k++) {
+			const uint8_t *src_pixel = src->pixel_rows[ytaps->start[y] + k];
+			uint32_t weight = ytaps->weight[ytaps->first[y] + k];
+
+			if (job->packed16) {
+				unpack_row16 (line, (const uint16_t *) src_pixel, src->width);
+				src_pixel = line;
+			}
+
+			for (i = 0; i < rowsize; i++)
+				sums[i] += src_pixel[i] * weight;
+		}
+
+		out = job->packed16 ? line : dest_pixel;
+
+		for (x = 0; x < dest->width; x++) {
+			const uint32_t *sum = sums + xtaps->start[x] * channels;
+			const uint16_t *weight = xtaps->weight + xtaps->first[x];
+
+			for (c = 0; c < channels; c++) {
+				uint32_t value = AREA_ROUND;
+
+				for (k = 0; k < xtaps->count[x]; k++)
+					value += sum[k * channels + c] * weight[k];
+
+				*(out++) = value >> AREA_SHIFT;
+			}
+		}
+
+		if (job->packed16)
+			pack_row16 ((uint16_t *) dest_pixel, line, dest->width);
 	}
+
+	visual_mem_free (line);
+	visual_mem_free (sums);
 }
 
-void visual_video_scale_bilinear_color24 (VisVideo *dest, VisVideo *src)
+/* Plain C versions */
+
+static inline void rgb16_channels (uint16_t p, int *c0, int *c1, int *c2)
 {
-	uint32_t y;
-	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	color24_t *dest_pixel, *src_pixel_rowu, *src_pixel_rowl;
-	dest_pixel = visual_video_get_pixels (dest);
+	*c0 = (p << 3) & 0xf8;
+	*c1 = (p >> 3) & 0xfc;
+	*c2 = (p >> 8) & 0xf8;
+}
 
-	du = ((src->width - 1)  << 16) / dest->width;
-	dv = ((src->height - 1) << 16) / dest->height;
-	v = 0;
+static void lerp_row_c (int16_t *dest, const uint8_t *top, const uint8_t *bottom, int count, int frac)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		dest[i] = top[i] * (SCALE_ONE - frac) + bottom[i] * frac;
+}
 
-	for (y = dest->height; y--; v += dv) {
-		uint32_t x;
-		uint32_t fracU, fracV;     /* fixed point 24.8 [0,1[    */
+static void lerp_row16_c (int16_t *dest, const uint16_t *top, const uint16_t *bottom, int width, int frac)
+{
+	int x;
 
-		if (v >> 16 >= src->height - 1)
-			v -= 0x10000;
+	for (x = 0; x < width; x++) {
+		int t0, t1, t2, b0, b1, b2;
 
-		src_pixel_rowu = (color24_t *) src->pixel_rows[v >> 16];
-		src_pixel_rowl = (color24_t *) src->pixel_rows[(v >> 16) + 1];
+		rgb16_channels (top[x], &t0, &t1, &t2);
+		rgb16_channels (bottom[x], &b0, &b1, &b2);
 
-		/* fracV = frac(v) = v & 0xffff */
-		/* fixed point format convertion: fracV >>= 8) */
-		fracV = (v & 0xffff) >> 8;
-		u = 0;
+		*(dest++) = t0 * (SCALE_ONE - frac) + b0 * frac;
+		*(dest++) = t1 * (SCALE_ONE - frac) + b1 * frac;
+		*(dest++) = t2 * (SCALE_ONE - frac) + b2 * frac;
+		*(dest++) = 0;
+	}
+}
+
+static inline uint8_t filter_tap (const int16_t *left, int channels, uint32_t weight)
+{
+	return (left[0] * (weight & 0xffff) + left[channels] * (weight >> 16) + SCALE_ROUND) >> SCALE_SHIFT;
+}
 
-		for (x = dest->width - 1; x--; u += du) {
-			color24_t cul, cll, cur, clr, b;
-			uint32_t ul, ll, ur, lr; /* fixed point 16.16 [0,1[   */
-			uint32_t b2, b1, b0;	 /* fixed point 16.16 [0,255[ */
+static void filter_row1_c (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width)
+{
+	int x;
 
-			/* fracU = frac(u) = u & 0xffff */
-			/* fixed point format convertion: fracU >>= 8) */
-			fracU  = (u & 0xffff) >> 8;
+	for (x = 0; x < width; x++)
+		*(dest++) = filter_tap (row + xoffset[x], 1, xweight[x]);
+}
 
-			/* notice 0x100 = 1.0 (fixed point 24.8) */
-			ul = (0x100 - fracU) * (0x100 - fracV);
-			ll = (0x100 - fracU) * fracV;
-			ur = fracU * (0x100 - fracV);
-			lr = fracU * fracV;
+static void filter_row3_c (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width)
+{
+	int x;
 
-			cul = src_pixel_rowu[u >> 16];
-			cll = src_pixel_rowl[u >> 16];
-			cur = src_pixel_rowu[(u >> 16) + 1];
-			clr = src_pixel_rowl[(u >> 16) + 1];
+	for (x = 0; x < width; x++) {
+		const int16_t *left = row + xoffset[x];
 
-			b0 = ul * cul.r;
-			b1 = ul * cul.g;
-			b2 = ul * cul.b;
+		*(dest++) = filter_tap (left,     3, xweight[x]);
+		*(dest++) = filter_tap (left + 1, 3, xweight[x]);
+		*(dest++) = filter_tap (left + 2, 3, xweight[x]);
+	}
+}
 
-			b0 += ll * cll.r;
-			b1 += ll * cll.g;
-			b2 += ll * cll.b;
+static void filter_row4_c (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width)
+{
+	int x;
 
-			b0 += ur * cur.r;
-			b1 += ur * cur.g;
-			b2 += ur * cur.b;
+	for (x = 0; x < width; x++) {
+		const int16_t *left = row + xoffset[x];
 
-			b0 += lr * clr.r;
-			b1 += lr * clr.g;
-			b2 += lr * clr.b;
+		*(dest++) = filter_tap (left,     4, xweight[x]);
+		*(dest++) = filter_tap (left + 1, 4, xweight[x]);
+		*(dest++) = filter_tap (left + 2, 4, xweight[x]);
+		*(dest++) = filter_tap (left + 3, 4, xweight[x]);
+	}
+}
 
-			b.r = b0 >> 16;
-			b.g = b1 >> 16;
-			b.b = b2 >> 16;
+static void pack_row16_c (uint16_t *dest, const uint8_t *src, int width)
+{
+	int x;
 
-			*dest_pixel++ = b;
-		}
+	for (x = 0; x < width; x++, src += 4)
+		dest[x] = (src[2] >> 3) << 11 | (src[1] >> 2) << 5 | (src[0] >> 3);
+}
+
+static void unpack_row16 (uint8_t *dest, const uint16_t *src, int width)
+{
+	int x;
 
-		dest_pixel += (dest->pitch / dest->bpp) - ((dest->width - 1));
+	for (x = 0; x < width; x++) {
+		int c0, c1, c2;
+
+		rgb16_channels (src[x], &c0, &c1, &c2);
+
+		*(dest++) = c0;
+		*(dest++) = c1;
+		*(dest++) = c2;
+		*(dest++) = 0;
 	}
 }
 
-void visual_video_scale_bilinear_color32 (VisVideo *dest, VisVideo *src)
+#if defined(VISUAL_HAVE_SSE2)
+
+static void lerp_row_sse2 (int16_t *dest, const uint8_t *top, const uint8_t *bottom, int count, int frac)
 {
-	uint32_t y;
-	uint32_t u, v, du, dv; /* fixed point 16.16 */
-	uint32_t *dest_pixel, *src_pixel_rowu, *src_pixel_rowl;
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i wtop = _mm_set1_epi16 (SCALE_ONE - frac);
+	const __m128i wbottom = _mm_set1_epi16 (frac);
+	int i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		__m128i t = _mm_loadu_si128 ((const __m128i *) (top + i));
+		__m128i b = _mm_loadu_si128 ((const __m128i *) (bottom + i));
+
+		__m128i lo = _mm_add_epi16 (_mm_mullo_epi16 (_mm_unpacklo_epi8 (t, zero), wtop),
+				_mm_mullo_epi16 (_mm_unpacklo_epi8 (b, zero), wbottom));
+		__m128i hi = _mm_add_epi16 (_mm_mullo_epi16 (_mm_unpackhi_epi8 (t, zero), wtop),
+				_mm_mullo_epi16 (_mm_unpackhi_epi8 (b, zero), wbottom));
+
+		_mm_storeu_si128 ((__m128i *) (dest + i), lo);
+		_mm_storeu_si128 ((__m128i *) (dest + i + 8), hi);
+	}
 
-	dest_pixel = visual_video_get_pixels (dest);
+	lerp_row_c (dest + i, top + i, bottom + i, count - i, frac);
+}
 
-	du = ((src->width - 1)  << 16) / dest->width;
-	dv = ((src->height - 1) << 16) / dest->height;
-	v = 0;
+static void lerp_row16_sse2 (int16_t *dest, const uint16_t *top, const uint16_t *bottom, int width, int frac)
+{
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i wtop = _mm_set1_epi16 (SCALE_ONE - frac);
+	const __m128i wbottom = _mm_set1_epi16 (frac);
+	const __m128i mask0 = _mm_set1_epi16 (0xf8);
+	const __m128i mask1 = _mm_set1_epi16 (0xfc);
+	int x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		__m128i t = _mm_loadu_si128 ((const __m128i *) (top + x));
+		__m128i b = _mm_loadu_si128 ((const __m128i *) (bottom + x));
+		__m128i c0, c1, c2, c01, c2z;
+
+		c0 = _mm_add_epi16 (_mm_mullo_epi16 (_mm_and_si128 (_mm_slli_epi16 (t, 3), mask0), wtop),
+				_mm_mullo_epi16 (_mm_and_si128 (_mm_slli_epi16 (b, 3), mask0), wbottom));
+		c1 = _mm_add_epi16 (_mm_mullo_epi16 (_mm_and_si128 (_mm_srli_epi16 (t, 3), mask1), wtop),
+				_mm_mullo_epi16 (_mm_and_si128 (_mm_srli_epi16 (b, 3), mask1), wbottom));
+		c2 = _mm_add_epi16 (_mm_mullo_epi16 (_mm_and_si128 (_mm_srli_epi16 (t, 8), mask0), wtop),
+				_mm_mullo_epi16 (_mm_and_si128 (_mm_srli_epi16 (b, 8), mask0), wbottom));
+
+		c01 = _mm_unpacklo_epi16 (c0, c1);
+		c2z = _mm_unpacklo_epi16 (c2, zero);
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4), _mm_unpacklo_epi32 (c01, c2z));
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4 + 8), _mm_unpackhi_epi32 (c01, c2z));
+
+		c01 = _mm_unpackhi_epi16 (c0, c1);
+		c2z = _mm_unpackhi_epi16 (c2, zero);
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4 + 16), _mm_unpacklo_epi32 (c01, c2z));
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4 + 24), _mm_unpackhi_epi32 (c01, c2z));
+	}
 
-	for (y = dest->height; y--; v += dv) {
-		uint32_t x;
-		uint32_t fracU, fracV;     /* fixed point 24.8 [0,1[    */
+	lerp_row16_c (dest + x * 4, top + x, bottom + x, width - x, frac);
+}
 
-		if (v >> 16 >= src->height - 1)
-			v -= 0x10000;
+/* Weighs the channels of the left tap (low half of taps) against those of
+ * the right tap, starting at value right in taps */
+static inline __m128i filter_taps_sse2 (__m128i taps, __m128i right, uint32_t weight)
+{
+	__m128i pairs = _mm_unpacklo_epi16 (taps, right);
+	__m128i sum = _mm_madd_epi16 (pairs, _mm_set1_epi32 (weight));
 
-		src_pixel_rowu = (uint32_t *) src->pixel_rows[v >> 16];
-		src_pixel_rowl = (uint32_t *) src->pixel_rows[(v >> 16) + 1];
+	return _mm_srai_epi32 (_mm_add_epi32 (sum, _mm_set1_epi32 (SCALE_ROUND)), SCALE_SHIFT);
+}
 
-		/* fracV = frac(v) = v & 0xffff */
-		/* fixed point format convertion: fracV >>= 8) */
-		fracV = (v & 0xffff) >> 8;
-		u = 0;
+static void filter_row1_sse2 (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width)
+{
+	const __m128i round = _mm_set1_epi32 (SCALE_ROUND);
+	int x;
+
+	for (x = 0; x + 4 <= width; x += 4) {
+		uint32_t pair[4];
+		__m128i sum;
+		int k;
+
+		for (k = 0; k < 4; k++)
+			memcpy (&pair[k], row + xoffset[x + k], sizeof (uint32_t));
+
+		sum = _mm_madd_epi16 (_mm_loadu_si128 ((const __m128i *) pair),
+				_mm_loadu_si128 ((const __m128i *) (xweight + x)));
+		sum = _mm_srai_epi32 (_mm_add_epi32 (sum, round), SCALE_SHIFT);
+		sum = _mm_packs_epi32 (sum, sum);
+
+		pair[0] = _mm_cvtsi128_si32 (_mm_packus_epi16 (sum, sum));
+		memcpy (dest + x, &pair[0], 4);
+	}
 
-		for (x = dest->width - 1; x--; u += du) {
-			union {
-				uint8_t  c8[4];
-				uint32_t c32;
-			} cul, cll, cur, clr, b;
-			uint32_t ul, ll, ur, lr; /* fixed point 16.16 [0,1[   */
-			uint32_t b3, b2, b1, b0; /* fixed point 16.16 [0,255[ */
-
-			/* fracU = frac(u) = u & 0xffff */
-			/* fixed point format convertion: fracU >>= 8) */
-			fracU  = (u & 0xffff) >> 8;
-
-			/* notice 0x100 = 1.0 (fixed point 24.8) */
-			ul = (0x100 - fracU) * (0x100 - fracV);
-			ll = (0x100 - fracU) * fracV;
-			ur = fracU * (0x100 - fracV);
-			lr = fracU * fracV;
-
-			cul.c32 = src_pixel_rowu[u >> 16];
-			cll.c32 = src_pixel_rowl[u >> 16];
-			cur.c32 = src_pixel_rowu[(u >> 16) + 1];
-			clr.c32 = src_pixel_rowl[(u >> 16) + 1];
-
-			b0 = ul * cul.c8[0];
-			b1 = ul * cul.c8[1];
-			b2 = ul * cul.c8[2];
-			b3 = ul * cul.c8[3];
-
-			b0 += ll * cll.c8[0];
-			b1 += ll * cll.c8[1];
-			b2 += ll * cll.c8[2];
-			b3 += ll * cll.c8[3];
-
-			b0 += ur * cur.c8[0];
-			b1 += ur * cur.c8[1];
-			b2 += ur * cur.c8[2];
-			b3 += ur * cur.c8[3];
-
-			b0 += lr * clr.c8[0];
-			b1 += lr * clr.c8[1];
-			b2 += lr * clr.c8[2];
-			b3 += lr * clr.c8[3];
-
-			b.c8[0] = b0 >> 16;
-			b.c8[1] = b1 >> 16;
-			b.c8[2] = b2 >> 16;
-			b.c8[3] = b3 >> 16;
-
-			*dest_pixel++ = b.c32;
+	filter_row1_c (dest + x, row, xoffset + x, xweight + x, width - x);
+}
+
+static void filter_row3_sse2 (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width)
+{
+	int x;
+
+	/* Every pixel is stored as 4 bytes, the next one overwrites the
+	 * excess, so the last pixel is left to the C version */
+	for (x = 0; x + 5 <= width; x += 4) {
+		__m128i s[4], packed;
+		uint32_t pixel;
+		int k;
+
+		for (k = 0; k < 4; k++) {
+			__m128i taps = _mm_loadu_si128 ((const __m128i *) (row + xoffset[x + k]));
+
+			s[k] = filter_taps_sse2 (taps, _mm_srli_si128 (taps, 6), xweight[x + k]);
 		}
 
-		dest_pixel += (dest->pitch / dest->bpp) - ((dest->width - 1));
+		packed = _mm_packus_epi16 (_mm_packs_epi32 (s[0], s[1]), _mm_packs_epi32 (s[2], s[3]));
+
+		for (k = 0; k < 4; k++) {
+			pixel = _mm_cvtsi128_si32 (packed);
+			memcpy (dest + (x + k) * 3, &pixel, 4);
+
+			packed = _mm_srli_si128 (packed, 4);
+		}
+	}
+
+	filter_row3_c (dest + x * 3, row, xoffset + x, xweight + x, width - x);
+}
+
+static void filter_row4_sse2 (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width)
+{
+	int x;
+
+	for (x = 0; x + 4 <= width; x += 4) {
+		__m128i s[4];
+		int k;
+
+		for (k = 0; k < 4; k++) {
+			__m128i taps = _mm_loadu_si128 ((const __m128i *) (row + xoffset[x + k]));
+
+			s[k] = filter_taps_sse2 (taps, _mm_srli_si128 (taps, 8), xweight[x + k]);
+		}
+
+		_mm_storeu_si128 ((__m128i *) (dest + x * 4),
+				_mm_packus_epi16 (_mm_packs_epi32 (s[0], s[1]), _mm_packs_epi32 (s[2], s[3])));
+	}
+
+	filter_row4_c (dest + x * 4, row, xoffset + x, xweight + x, width - x);
+}
+
+/* Four pixels of 4 channels to 565, one per 32 bit lane, sign extended */
+static inline __m128i pack_rgb16_sse2 (__m128i p)
+{
+	__m128i c2 = _mm_and_si128 (_mm_srli_epi32 (p, 8), _mm_set1_epi32 (0xf800));
+	__m128i c1 = _mm_and_si128 (_mm_srli_epi32 (p, 5), _mm_set1_epi32 (0x07e0));
+	__m128i c0 = _mm_and_si128 (_mm_srli_epi32 (p, 3), _mm_set1_epi32 (0x001f));
+
+	return _mm_srai_epi32 (_mm_slli_epi32 (_mm_or_si128 (_mm_or_si128 (c2, c1), c0), 16), 16);
+}
+
+static void pack_row16_sse2 (uint16_t *dest, const uint8_t *src, int width)
+{
+	int x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		__m128i p0 = _mm_loadu_si128 ((const __m128i *) (src + x * 4));
+		__m128i p1 = _mm_loadu_si128 ((const __m128i *) (src + x * 4 + 16));
+
+		_mm_storeu_si128 ((__m128i *) (dest + x),
+				_mm_packs_epi32 (pack_rgb16_sse2 (p0), pack_rgb16_sse2 (p1)));
+	}
+
+	pack_row16_c (dest + x, src + x * 4, width - x);
+}
+
+#endif /* VISUAL_HAVE_SSE2 */
+
+#if defined(VISUAL_HAVE_NEON)
+
+static void lerp_row_neon (int16_t *dest, const uint8_t *top, const uint8_t *bottom, int count, int frac)
+{
+	const uint8x8_t wtop = vdup_n_u8 (SCALE_ONE - frac);
+	const uint8x8_t wbottom = vdup_n_u8 (frac);
+	int i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		uint8x16_t t = vld1q_u8 (top + i);
+		uint8x16_t b = vld1q_u8 (bottom + i);
 
+		uint16x8_t lo = vmlal_u8 (vmull_u8 (vget_low_u8 (t), wtop), vget_low_u8 (b), wbottom);
+		uint16x8_t hi = vmlal_u8 (vmull_u8 (vget_high_u8 (t), wtop), vget_high_u8 (b), wbottom);
+
+		vst1q_u16 ((uint16_t *) (dest + i), lo);
+		vst1q_u16 ((uint16_t *) (dest + i + 8), hi);
 	}
+
+	lerp_row_c (dest + i, top + i, bottom + i, count - i, frac);
 }
+
+static void lerp_row16_neon (int16_t *dest, const uint16_t *top, const uint16_t *bottom, int width, int frac)
+{
+	const uint16x8_t wtop = vdupq_n_u16 (SCALE_ONE - frac);
+	const uint16x8_t wbottom = vdupq_n_u16 (frac);
+	const uint16x8_t mask0 = vdupq_n_u16 (0xf8);
+	const uint16x8_t mask1 = vdupq_n_u16 (0xfc);
+	int x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		uint16x8_t t = vld1q_u16 (top + x);
+		uint16x8_t b = vld1q_u16 (bottom + x);
+		uint16x8x4_t c;
+
+		c.val[0] = vmlaq_u16 (vmulq_u16 (vandq_u16 (vshlq_n_u16 (t, 3), mask0), wtop),
+				vandq_u16 (vshlq_n_u16 (b, 3), mask0), wbottom);
+		c.val[1] = vmlaq_u16 (vmulq_u16 (vandq_u16 (vshrq_n_u16 (t, 3), mask1), wtop),
+				vandq_u16 (vshrq_n_u16 (b, 3), mask1), wbottom);
+		c.val[2] = vmlaq_u16 (vmulq_u16 (vandq_u16 (vshrq_n_u16 (t, 8), mask0), wtop),
+				vandq_u16 (vshrq_n_u16 (b, 8), mask0), wbottom);
+		c.val[3] = vdupq_n_u16 (0);
+
+		vst4q_u16 ((uint16_t *) (dest + x * 4), c);
+	}
+
+	lerp_row16_c (dest + x * 4, top + x, bottom + x, width - x, frac);
+}
+
+static inline uint16x4_t filter_taps_neon (uint16x4_t left, uint16x4_t right, uint32_t weight)
+{
+	uint32x4_t sum = vmull_n_u16 (left, weight & 0xffff);
+
+	sum = vmlal_n_u16 (sum, right, weight >> 16);
+
+	return vrshrn_n_u32 (sum, SCALE_SHIFT);
+}
+
+static void filter_row1_neon (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width)
+{
+	int x;
+
+	for (x = 0; x + 4 <= width; x += 4) {
+		uint16x4x2_t taps = vld2_u16 ((const uint16_t *) xweight + x * 2);
+		uint16x4_t left = vdup_n_u16 (0), right = vdup_n_u16 (0);
+		uint32x4_t sum;
+		uint32_t pixels;
+
+		left  = vset_lane_u16 (row[xoffset[x]],         left, 0);
+		right = vset_lane_u16 (row[xoffset[x] + 1],     right, 0);
+		left  = vset_lane_u16 (row[xoffset[x + 1]],     left, 1);
+		right = vset_lane_u16 (row[xoffset[x + 1] + 1], right, 1);
+		left  = vset_lane_u16 (row[xoffset[x + 2]],     left, 2);
+		right = vset_lane_u16 (row[xoffset[x + 2] + 1], right, 2);
+		left  = vset_lane_u16 (row[xoffset[x + 3]],     left, 3);
+		right = vset_lane_u16 (row[xoffset[x + 3] + 1], right, 3);
+
+		/* Weights are stored as (right << 16) | left, vld2 splits them */
+		sum = vmlal_u16 (vmull_u16 (left, taps.val[0]), right, taps.val[1]);
+
+		pixels = vget_lane_u32 (vreinterpret_u32_u8 (vmovn_u16 (vcombine_u16 (vrshrn_n_u32 (sum, SCALE_SHIFT),
+								vdup_n_u16 (0)))), 0);
+		memcpy (dest + x, &pixels, 4);
+	}
+
+	filter_row1_c (dest + x, row, xoffset + x, xweight + x, width - x);
+}
+
+static void filter_row3_neon (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width)
+{
+	int x;
+
+	/* Every pixel is stored as 4 bytes, the next one overwrites the
+	 * excess, so the last pixel is left to the C version */
+	for (x = 0; x + 3 <= width; x += 2) {
+		uint16x8_t t0 = vld1q_u16 ((const uint16_t *) (row + xoffset[x]));
+		uint16x8_t t1 = vld1q_u16 ((const uint16_t *) (row + xoffset[x + 1]));
+		uint32x2_t packed;
+		uint32_t pixel;
+
+		packed = vreinterpret_u32_u8 (vmovn_u16 (vcombine_u16 (
+					filter_taps_neon (vget_low_u16 (t0), vget_low_u16 (vextq_u16 (t0, t0, 3)), xweight[x]),
+					filter_taps_neon (vget_low_u16 (t1), vget_low_u16 (vextq_u16 (t1, t1, 3)), xweight[x + 1]))));
+
+		pixel = vget_lane_u32 (packed, 0);
+		memcpy (dest + x * 3, &pixel, 4);
+
+		pixel = vget_lane_u32 (packed, 1);
+		memcpy (dest + x * 3 + 3, &pixel, 4);
+	}
+
+	filter_row3_c (dest + x * 3, row, xoffset + x, xweight + x, width - x);
+}
+
+static void filter_row4_neon (uint8_t *dest, const int16_t *row, const int32_t *xoffset, const uint32_t *xweight, int width)
+{
+	int x;
+
+	for (x = 0; x + 2 <= width; x += 2) {
+		uint16x8_t t0 = vld1q_u16 ((const uint16_t *) (row + xoffset[x]));
+		uint16x8_t t1 = vld1q_u16 ((const uint16_t *) (row + xoffset[x + 1]));
+
+		vst1_u8 (dest + x * 4, vmovn_u16 (vcombine_u16 (
+					filter_taps_neon (vget_low_u16 (t0), vget_high_u16 (t0), xweight[x]),
+					filter_taps_neon (vget_low_u16 (t1), vget_high_u16 (t1), xweight[x + 1]))));
+	}
+
+	filter_row4_c (dest + x * 4, row, xoffset + x, xweight + x, width - x);
+}
+
+static void pack_row16_neon (uint16_t *dest, const uint8_t *src, int width)
+{
+	int x;
+
+	for (x = 0; x + 8 <= width; x += 8) {
+		uint8x8x4_t p = vld4_u8 (src + x * 4);
+		uint16x8_t packed = vshll_n_u8 (p.val[2], 8);
+
+		packed = vsriq_n_u16 (packed, vshll_n_u8 (p.val[1], 8), 5);
+		packed = vsriq_n_u16 (packed, vshll_n_u8 (p.val[0], 8), 11);
+
+		vst1q_u16 (dest + x, packed);
+	}
+
+	pack_row16_c (dest + x, src + x * 4, width - x);
+}
+
+#endif /* VISUAL_HAVE_NEON */
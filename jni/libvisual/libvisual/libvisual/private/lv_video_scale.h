@@ -3,6 +3,10 @@
 
 #include "lv_video.h"
 
+/* Picks the fastest scaling routines for this CPU and sets up the worker threads */
+void visual_video_scale_initialize (void);
+void visual_video_scale_deinitialize (void);
+
 void visual_video_zoom_color8  (VisVideo *dest, VisVideo *src);
 void visual_video_zoom_color16 (VisVideo *dest, VisVideo *src);
 void visual_video_zoom_color24 (VisVideo *dest, VisVideo *src);
@@ -18,4 +22,9 @@ void visual_video_scale_bilinear_color16 (VisVideo *dest, VisVideo *src);
 void visual_video_scale_bilinear_color24 (VisVideo *dest, VisVideo *src);
 void visual_video_scale_bilinear_color32 (VisVideo *dest, VisVideo *src);
 
+void visual_video_scale_area_color8  (VisVideo *dest, VisVideo *src);
+void visual_video_scale_area_color16 (VisVideo *dest, VisVideo *src);
+void visual_video_scale_area_color24 (VisVideo *dest, VisVideo *src);
+void visual_video_scale_area_color32 (VisVideo *dest, VisVideo *src);
+
 #endif /* _LV_VIDEO_SCALE_H */
@@ -38,6 +38,10 @@ struct _VisMutex {
     pthread_mutex_t mutex;
 };
 
+struct _VisCond {
+    pthread_cond_t cond;
+};
+
 int visual_thread_initialize (void)
 {
     return TRUE;
@@ -155,4 +159,53 @@ int visual_mutex_unlock (VisMutex *mutex)
     return VISUAL_OK;
 }
 
+VisCond *visual_cond_new (void)
+{
+    VisCond *cond;
+
+    cond = visual_mem_new0 (VisCond, 1);
+
+    pthread_cond_init (&cond->cond, NULL);
+
+    return cond;
+}
+
+int visual_cond_free (VisCond *cond)
+{
+    visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+    pthread_cond_destroy (&cond->cond);
+
+    return visual_mem_free (cond);
+}
+
+int visual_cond_wait (VisCond *cond, VisMutex *mutex)
+{
+    visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+    visual_return_val_if_fail (mutex != NULL, -VISUAL_ERROR_MUTEX_NULL);
+
+    if (pthread_cond_wait (&cond->cond, &mutex->mutex) != 0)
+        return -VISUAL_ERROR_COND_WAIT_FAILURE;
+
+    return VISUAL_OK;
+}
+
+int visual_cond_signal (VisCond *cond)
+{
+    visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+    pthread_cond_signal (&cond->cond);
+
+    return VISUAL_OK;
+}
+
+int visual_cond_broadcast (VisCond *cond)
+{
+    visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+    pthread_cond_broadcast (&cond->cond);
+
+    return VISUAL_OK;
+}
+
 #endif /* VISUAL_THREAD_MODEL_POSIX */
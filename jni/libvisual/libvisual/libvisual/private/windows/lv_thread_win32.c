@@ -24,6 +24,7 @@
 #include "lv_common.h"
 #include "gettext.h"
 #include <windows.h>
+#include <limits.h>
 
 
 struct _VisThread {
@@ -35,6 +36,12 @@ struct _VisMutex {
     HANDLE handle;
 };
 
+struct _VisCond {
+    CRITICAL_SECTION lock;
+    HANDLE semaphore;
+    LONG waiters;
+};
+
 int visual_thread_initialize (void)
 {
     return TRUE;
@@ -151,3 +158,92 @@ int visual_mutex_unlock (VisMutex *mutex)
 
     return 0;
 }
+
+VisCond *visual_cond_new (void)
+{
+    VisCond *cond;
+    HANDLE semaphore;
+
+    semaphore = CreateSemaphore (NULL, 0, LONG_MAX, NULL);
+    if (!semaphore) {
+        return NULL;
+    }
+
+    cond = visual_mem_new0 (VisCond, 1);
+    cond->semaphore = semaphore;
+    cond->waiters = 0;
+
+    InitializeCriticalSection (&cond->lock);
+
+    return cond;
+}
+
+int visual_cond_free (VisCond *cond)
+{
+    visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+    DeleteCriticalSection (&cond->lock);
+    CloseHandle (cond->semaphore);
+
+    return visual_mem_free (cond);
+}
+
+int visual_cond_wait (VisCond *cond, VisMutex *mutex)
+{
+    DWORD result;
+
+    visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+    visual_return_val_if_fail (mutex != NULL, -VISUAL_ERROR_MUTEX_NULL);
+
+    EnterCriticalSection (&cond->lock);
+    cond->waiters++;
+    LeaveCriticalSection (&cond->lock);
+
+    // Releasing the mutex and starting the wait is not atomic here, but the
+    // semaphore keeps any signal sent in between so no wakeup gets lost.
+    result = SignalObjectAndWait (mutex->handle, cond->semaphore, INFINITE, FALSE);
+
+    WaitForSingleObject (mutex->handle, INFINITE);
+
+    if (result != WAIT_OBJECT_0) {
+        EnterCriticalSection (&cond->lock);
+        cond->waiters--;
+        LeaveCriticalSection (&cond->lock);
+
+        return -VISUAL_ERROR_COND_WAIT_FAILURE;
+    }
+
+    return VISUAL_OK;
+}
+
+int visual_cond_signal (VisCond *cond)
+{
+    visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+    EnterCriticalSection (&cond->lock);
+
+    if (cond->waiters > 0) {
+        cond->waiters--;
+        ReleaseSemaphore (cond->semaphore, 1, NULL);
+    }
+
+    LeaveCriticalSection (&cond->lock);
+
+    return VISUAL_OK;
+}
+
+int visual_cond_broadcast (VisCond *cond)
+{
+    visual_return_val_if_fail (cond != NULL, -VISUAL_ERROR_COND_NULL);
+
+    EnterCriticalSection (&cond->lock);
+
+    if (cond->waiters > 0) {
+        ReleaseSemaphore (cond->semaphore, cond->waiters, NULL);
+        cond->waiters = 0;
+    }
+
+    LeaveCriticalSection (&cond->lock);
+
+    return VISUAL_OK;
+}
@@ -5,26 +5,88 @@
 
 #define TIMES	500
 
-int main (int argc, char **argv)
+/* Composes a 640x400 overlay onto a frame of the same depth with every
+ * compose type, and reports the time per frame */
+
+static VisVideo *new_frame (VisVideoDepth depth, uint32_t seed)
+{
+	VisVideo *video;
+	uint8_t *pixels;
+	int i, size;
+
+	video = visual_video_new ();
+	visual_video_set_depth (video, depth);
+	visual_video_set_dimension (video, 640, 400);
+	visual_video_allocate_buffer (video);
+
+	pixels = visual_video_get_pixels (video);
+	size = visual_video_get_size (video);
+
+	/* Noise, with every eighth pixel black so colorkeys match something */
+	for (i = 0; i < size; i++) {
+		seed = seed * 1664525 + 1013904223;
+		pixels[i] = (i / video->bpp) % 8 == 0 ? 0 : seed >> 24;
+	}
+
+	return video;
+}
+
+static void bench_compose (VisVideoDepth depth, VisVideoComposeType type, const char *name)
 {
 	VisVideo *dest, *src;
+	VisPalette *pal;
+	VisTimer *timer;
 	int i;
 
-	visual_init (&argc, &argv);
+	dest = new_frame (depth, 1);
+	src  = new_frame (depth, 2);
+
+	/* An all black palette, the default black colorkey is index 0 */
+	pal = visual_palette_new (256);
+	visual_video_set_palette (src, pal);
 
-	dest = visual_video_new ();
-	visual_video_set_depth (dest, VISUAL_VIDEO_DEPTH_32BIT);
-	visual_video_set_dimension (dest, 640, 400);
-	visual_video_allocate_buffer (dest);
+	visual_video_set_compose_type (src, type);
+	visual_video_set_compose_surface (src, 160);
 
-	src = visual_video_new ();
-	visual_video_copy_attrs (src, dest);
-	visual_video_allocate_buffer (src);
+	timer = visual_timer_new ();
+	visual_timer_start (timer);
 
 	for (i = 0; i < TIMES; i++)
 		visual_video_blit (dest, src, 0, 0, TRUE);
 
-	printf ("Blit overlay %d times\n", TIMES);
+	printf ("Compose bench depth %2d, %-18s: %.3f ms per frame\n",
+			visual_video_depth_value_from_enum (depth), name,
+			visual_timer_elapsed_usecs (timer) / 1000.0 / TIMES);
+
+	visual_timer_free (timer);
+
+	visual_object_unref (VISUAL_OBJECT (dest));
+	visual_object_unref (VISUAL_OBJECT (src));
+	visual_palette_free (pal);
+}
+
+int main (int argc, char **argv)
+{
+	static const VisVideoDepth depths[] = {
+		VISUAL_VIDEO_DEPTH_8BIT,
+		VISUAL_VIDEO_DEPTH_16BIT,
+		VISUAL_VIDEO_DEPTH_24BIT,
+		VISUAL_VIDEO_DEPTH_32BIT
+	};
+	int i;
+
+	visual_init (&argc, &argv);
+
+	bench_compose (VISUAL_VIDEO_DEPTH_32BIT, VISUAL_VIDEO_COMPOSE_TYPE_SRC, "source alpha");
+	bench_compose (VISUAL_VIDEO_DEPTH_32BIT, VISUAL_VIDEO_COMPOSE_TYPE_SRC_PREMULTIPLIED, "premultiplied");
+
+	for (i = 0; i < 4; i++) {
+		bench_compose (depths[i], VISUAL_VIDEO_COMPOSE_TYPE_COLORKEY, "colorkey");
+		bench_compose (depths[i], VISUAL_VIDEO_COMPOSE_TYPE_SURFACE, "surface alpha");
+		bench_compose (depths[i], VISUAL_VIDEO_COMPOSE_TYPE_SURFACECOLORKEY, "surface colorkey");
+	}
+
+	visual_quit ();
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,73 @@
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define FRAMES		4096
+#define TIMES		10000
+
+/* Feeds interleaved stereo PCM into a VisAudio the way input plugins do
+ * and reads it back like an actor, for a few sample formats. Besides the
+ * time taken it reports how many visual_mem allocations every upload
+ * needs once the channels exist, which should be none */
+
+static void bench_format (VisAudio *audio, VisAudioSampleFormatType format, const char *name)
+{
+	VisBuffer *pcm;
+	VisBuffer *sample;
+	VisTimer *timer;
+	uint32_t allocs;
+	int i;
+
+	pcm = visual_buffer_new_allocate (FRAMES * 2 * visual_audio_sample_format_get_size (format));
+	visual_buffer_fill (pcm, 0);
+
+	sample = visual_buffer_new_allocate (512 * sizeof (float));
+
+	/* Warm up, creates the channels */
+	visual_audio_samplepool_input (audio->samplepool, pcm, VISUAL_AUDIO_SAMPLE_RATE_44100,
+			format, VISUAL_AUDIO_SAMPLE_CHANNEL_STEREO);
+
+	timer = visual_timer_new ();
+
+	allocs = visual_mem_get_alloc_count ();
+
+	visual_timer_start (timer);
+
+	for (i = 0; i < TIMES; i++) {
+		visual_audio_samplepool_input (audio->samplepool, pcm, VISUAL_AUDIO_SAMPLE_RATE_44100,
+				format, VISUAL_AUDIO_SAMPLE_CHANNEL_STEREO);
+
+		visual_audio_get_sample (audio, sample, VISUAL_AUDIO_CHANNEL_LEFT);
+		visual_audio_get_sample (audio, sample, VISUAL_AUDIO_CHANNEL_RIGHT);
+	}
+
+	printf ("Audio input bench %d times %d frames %s: %.3f secs, %.2f allocations per upload\n",
+			TIMES, FRAMES, name, visual_timer_elapsed_secs (timer),
+			(double) (visual_mem_get_alloc_count () - allocs) / TIMES);
+
+	visual_timer_free (timer);
+
+	visual_buffer_free (sample);
+	visual_buffer_free (pcm);
+}
+
+int main (int argc, char **argv)
+{
+	VisAudio *audio;
+
+	visual_init (&argc, &argv);
+
+	audio = visual_audio_new ();
+
+	bench_format (audio, VISUAL_AUDIO_SAMPLE_FORMAT_U8, "U8");
+	bench_format (audio, VISUAL_AUDIO_SAMPLE_FORMAT_S16, "S16");
+	bench_format (audio, VISUAL_AUDIO_SAMPLE_FORMAT_S32, "S32");
+	bench_format (audio, VISUAL_AUDIO_SAMPLE_FORMAT_FLOAT, "FLOAT");
+
+	visual_object_unref (VISUAL_OBJECT (audio));
+
+	visual_quit ();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,86 @@
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DEPTH		VISUAL_VIDEO_DEPTH_32BIT
+#define WIDTH		640
+#define HEIGHT		400
+#define TIMES		500
+
+/* Runs a VisBin into a malloc()ed buffer standing in for a window or
+ * bitmap, once rendering into the bin video followed by a convert and
+ * once rendering straight into the buffer using visual_bin_run_to_video */
+
+int main (int argc, char **argv)
+{
+	VisBin *bin;
+	VisActor *actor;
+	VisInput *input;
+	VisVideo *video;
+	VisVideo *dest;
+	VisTimer *timer;
+	void *pixels;
+	int i;
+
+	visual_init (&argc, &argv);
+
+	actor = visual_actor_new (argc > 1 ? argv[1] : "lv_scope");
+	input = visual_input_new (argc > 2 ? argv[2] : "debug");
+
+	if (actor == NULL || input == NULL) {
+		printf ("Failed to load the actor or input plugin\n");
+
+		return EXIT_FAILURE;
+	}
+
+	video = visual_video_new_with_buffer (WIDTH, HEIGHT, DEPTH);
+
+	pixels = malloc (WIDTH * HEIGHT * visual_video_bpp_from_depth (DEPTH));
+
+	dest = visual_video_new ();
+	visual_video_set_depth (dest, DEPTH);
+	visual_video_set_dimension (dest, WIDTH, HEIGHT);
+	visual_video_set_buffer (dest, pixels);
+
+	bin = visual_bin_new ();
+	visual_bin_set_supported_depth (bin, VISUAL_VIDEO_DEPTH_ALL);
+	visual_bin_set_depth (bin, DEPTH);
+	visual_bin_connect (bin, actor, input);
+	visual_bin_set_video (bin, video);
+	visual_bin_realize (bin);
+	visual_bin_sync (bin, FALSE);
+	visual_bin_depth_changed (bin);
+
+	timer = visual_timer_new ();
+
+	visual_timer_start (timer);
+
+	for (i = 0; i < TIMES; i++) {
+		visual_bin_run (bin);
+		visual_video_convert_depth (dest, video);
+	}
+
+	printf ("Bin throughput bench %d times, run and convert: %.3f secs\n", TIMES,
+			visual_timer_elapsed_secs (timer));
+
+	visual_timer_start (timer);
+
+	for (i = 0; i < TIMES; i++)
+		visual_bin_run_to_video (bin, dest);
+
+	printf ("Bin throughput bench %d times, run to video: %.3f secs\n", TIMES,
+			visual_timer_elapsed_secs (timer));
+
+	visual_timer_free (timer);
+
+	visual_object_unref (VISUAL_OBJECT (bin));
+	visual_object_unref (VISUAL_OBJECT (dest));
+	visual_object_unref (VISUAL_OBJECT (video));
+
+	free (pixels);
+
+	visual_quit ();
+
+	return EXIT_SUCCESS;
+}
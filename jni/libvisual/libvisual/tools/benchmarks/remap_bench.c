@@ -0,0 +1,118 @@
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define TIMES		500
+
+/* Warps a frame through a zoom and rotate map with every fetch method
+ * and depth, with and without fading, once per thread count from 1 up to
+ * the number of CPUs, and reports the time per frame */
+
+static VisVideo *new_frame (VisVideoDepth depth, int width, int height)
+{
+	VisVideo *video;
+
+	video = visual_video_new ();
+	visual_video_set_depth (video, depth);
+	visual_video_set_dimension (video, width, height);
+	visual_video_allocate_buffer (video);
+
+	visual_mem_set (visual_video_get_pixels (video), 0x5a, visual_video_get_size (video));
+
+	return video;
+}
+
+static VisRemap *new_map (VisRemapFetch fetch, int width, int height)
+{
+	VisRemap *remap;
+	float cx = width / 2.0f, cy = height / 2.0f;
+	int x, y, tap;
+
+	remap = visual_remap_new (width, height, fetch);
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			float dx = (x - cx) * 0.97f, dy = (y - cy) * 0.97f;
+			float sx = cx + dx * 0.9986f - dy * 0.0523f;
+			float sy = cy + dx * 0.0523f + dy * 0.9986f;
+
+			visual_remap_set_point (remap, x, y, sx, sy);
+
+			/* Spread the taps like a small blur */
+			if (fetch == VISUAL_REMAP_FETCH_AVERAGE4) {
+				for (tap = 0; tap < 4; tap++)
+					visual_remap_set_tap (remap, x, y, tap, sx + (tap & 1 ? 1 : -1), sy + (tap & 2 ? 1 : -1));
+			}
+		}
+	}
+
+	return remap;
+}
+
+static void bench_remap (VisVideoDepth depth, VisRemapFetch fetch, int fade, int width, int height)
+{
+	static const char *fetch_names[] = { "nearest", "weighted", "average4" };
+	VisVideo *dest, *src;
+	VisRemap *remap;
+	VisTimer *timer;
+	int i;
+
+	src  = new_frame (depth, width, height);
+	dest = new_frame (depth, width, height);
+	remap = new_map (fetch, width, height);
+
+	if (fade) {
+		visual_remap_set_fade (remap, 250);
+		visual_remap_set_decay (remap, 1);
+	}
+
+	/* Warm up, starts the worker threads */
+	visual_remap_apply (remap, dest, src);
+
+	timer = visual_timer_new ();
+	visual_timer_start (timer);
+
+	for (i = 0; i < TIMES; i++)
+		visual_remap_apply (remap, dest, src);
+
+	printf ("Remap bench %d threads, depth %2d, %-8s %-7s %4dx%-4d: %.3f ms per frame\n",
+			visual_remap_get_threads (), visual_video_depth_value_from_enum (depth),
+			fetch_names[fetch], fade ? "faded" : "", width, height,
+			visual_timer_elapsed_usecs (timer) / 1000.0 / TIMES);
+
+	visual_timer_free (timer);
+
+	visual_object_unref (VISUAL_OBJECT (remap));
+	visual_object_unref (VISUAL_OBJECT (dest));
+	visual_object_unref (VISUAL_OBJECT (src));
+}
+
+int main (int argc, char **argv)
+{
+	static const VisVideoDepth depths[] = {
+		VISUAL_VIDEO_DEPTH_8BIT,
+		VISUAL_VIDEO_DEPTH_32BIT
+	};
+	int ncpu, threads, i, fetch;
+
+	visual_init (&argc, &argv);
+
+	ncpu = visual_cpu_get_caps ()->nrcpu;
+
+	for (threads = 1; threads <= ncpu; threads = threads * 2 > ncpu && threads < ncpu ? ncpu : threads * 2) {
+		visual_remap_set_threads (threads);
+
+		for (i = 0; i < 2; i++) {
+			for (fetch = VISUAL_REMAP_FETCH_NEAREST; fetch <= VISUAL_REMAP_FETCH_AVERAGE4; fetch++) {
+				bench_remap (depths[i], fetch, FALSE, 640, 400);
+				bench_remap (depths[i], fetch, TRUE, 640, 400);
+			}
+		}
+	}
+
+	visual_quit ();
+
+	return EXIT_SUCCESS;
+}
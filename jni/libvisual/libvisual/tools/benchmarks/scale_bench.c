@@ -4,31 +4,80 @@
 #include <stdlib.h>
 
 #define TIMES		500
-#define DEPTH		VISUAL_VIDEO_DEPTH_32BIT
-#define INTERPOL	VISUAL_VIDEO_SCALE_BILINEAR
 
-int main (int argc, char **argv)
+/* Scales frames up with bilinear filtering and down with area filtering
+ * for every depth, once per thread count from 1 up to the number of CPUs,
+ * and reports the time per frame */
+
+static VisVideo *new_frame (VisVideoDepth depth, int width, int height)
 {
+	VisVideo *video;
+
+	video = visual_video_new ();
+	visual_video_set_depth (video, depth);
+	visual_video_set_dimension (video, width, height);
+	visual_video_allocate_buffer (video);
+
+	visual_mem_set (visual_video_get_pixels (video), 0x5a, visual_video_get_size (video));
+
+	return video;
+}
+
+static void bench_scale (VisVideoDepth depth, VisVideoScaleMethod method,
+		int src_width, int src_height, int dest_width, int dest_height)
+{
+	static const char *method_names[] = { "nearest", "bilinear", "area" };
 	VisVideo *dest, *src;
+	VisTimer *timer;
 	int i;
 
-	visual_init (&argc, &argv);
+	src  = new_frame (depth, src_width, src_height);
+	dest = new_frame (depth, dest_width, dest_height);
 
-	dest = visual_video_new ();
-	visual_video_set_depth (dest, DEPTH);
-	visual_video_set_dimension (dest, 640, 400);
-	visual_video_allocate_buffer (dest);
+	/* Warm up, starts the worker threads */
+	visual_video_scale (dest, src, method);
 
-	src = visual_video_new ();
-	visual_video_set_depth (src, DEPTH);
-	visual_video_set_dimension (src, 320, 200);
-	visual_video_allocate_buffer (src);
+	timer = visual_timer_new ();
+	visual_timer_start (timer);
 
 	for (i = 0; i < TIMES; i++)
-		visual_video_scale (dest, src, INTERPOL);
+		visual_video_scale (dest, src, method);
+
+	printf ("Scale bench %d threads, depth %2d, %-8s %4dx%-4d to %4dx%-4d: %.3f ms per frame\n",
+			visual_video_scale_get_threads (), visual_video_depth_value_from_enum (depth),
+			method_names[method], src_width, src_height, dest_width, dest_height,
+			visual_timer_elapsed_usecs (timer) / 1000.0 / TIMES);
+
+	visual_timer_free (timer);
+
+	visual_object_unref (VISUAL_OBJECT (dest));
+	visual_object_unref (VISUAL_OBJECT (src));
+}
+
+int main (int argc, char **argv)
+{
+	static const VisVideoDepth depths[] = {
+		VISUAL_VIDEO_DEPTH_8BIT,
+		VISUAL_VIDEO_DEPTH_16BIT,
+		VISUAL_VIDEO_DEPTH_24BIT,
+		VISUAL_VIDEO_DEPTH_32BIT
+	};
+	int ncpu, threads, i;
+
+	visual_init (&argc, &argv);
+
+	ncpu = visual_cpu_get_caps ()->nrcpu;
+
+	for (threads = 1; threads <= ncpu; threads = threads * 2 > ncpu && threads < ncpu ? ncpu : threads * 2) {
+		visual_video_scale_set_threads (threads);
+
+		for (i = 0; i < 4; i++) {
+			bench_scale (depths[i], VISUAL_VIDEO_SCALE_BILINEAR, 320, 200, 640, 400);
+			bench_scale (depths[i], VISUAL_VIDEO_SCALE_AREA, 1280, 800, 320, 200);
+		}
+	}
 
-	printf ("Scale bench overlay %d times, depth %d, interpol %d\n", TIMES,
-			DEPTH, INTERPOL);
+	visual_quit ();
 
 	return EXIT_SUCCESS;
 }
@@ -0,0 +1,62 @@
+#include <libvisual/libvisual.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define TIMES		10000
+
+/* Times visual_audio_get_spectrum_for_sample() the way actors call it,
+ * for a range of power of two and odd transform sizes */
+
+static void bench_size (int samples)
+{
+	VisBuffer *sample;
+	VisBuffer *spectrum;
+	VisTimer *timer;
+	float *data;
+	int times;
+	int i;
+
+	sample = visual_buffer_new_allocate (samples * sizeof (float));
+	spectrum = visual_buffer_new_allocate (samples / 2 * sizeof (float));
+
+	data = visual_buffer_get_data (sample);
+
+	for (i = 0; i < samples; i++)
+		data[i] = sinf (i * 0.1f) * 0.5f + sinf (i * 0.73f) * 0.25f;
+
+	/* Brute force transforms are much slower, keep the run short */
+	times = visual_math_is_power_of_2 (samples) ? TIMES : TIMES / 100;
+
+	timer = visual_timer_new ();
+	visual_timer_start (timer);
+
+	for (i = 0; i < times; i++)
+		visual_audio_get_spectrum_for_sample (spectrum, sample, TRUE);
+
+	printf ("Spectrum bench %d times %d samples: %.3f secs, %.2f usecs per spectrum\n",
+			times, samples, visual_timer_elapsed_secs (timer),
+			visual_timer_elapsed_secs (timer) * 1000000.0 / times);
+
+	visual_timer_free (timer);
+
+	visual_buffer_free (spectrum);
+	visual_buffer_free (sample);
+}
+
+int main (int argc, char **argv)
+{
+	visual_init (&argc, &argv);
+
+	bench_size (256);
+	bench_size (512);
+	bench_size (1024);
+	bench_size (2048);
+	bench_size (4096);
+	bench_size (1000);
+
+	visual_quit ();
+
+	return EXIT_SUCCESS;
+}
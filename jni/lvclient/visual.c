@@ -348,6 +348,22 @@ JNIEXPORT void JNICALL Java_org_libvisual_android_VisBin_binSync(JNIEnv * env, j
 }
 
 
+/** VisBin.pipelineStart() */
+JNIEXPORT jint JNICALL Java_org_libvisual_android_VisBin_binPipelineStart(JNIEnv * env, jobject  obj, jint bin, jint latency)
+{    
+    VisBin *b = (VisBin *) bin;
+    return visual_bin_pipeline_start(b, latency);
+}
+
+
+/** VisBin.pipelineStop() */
+JNIEXPORT void JNICALL Java_org_libvisual_android_VisBin_binPipelineStop(JNIEnv * env, jobject  obj, jint bin)
+{    
+    VisBin *b = (VisBin *) bin;
+    visual_bin_pipeline_stop(b);
+}
+
+
 /** VisBin.depthChanged() */
 JNIEXPORT void JNICALL Java_org_libvisual_android_VisBin_binDepthChanged(JNIEnv * env, jobject  obj, jint bin)
 {    
@@ -77,23 +77,41 @@ JNIEXPORT void JNICALL Java_org_libvisual_android_LibVisualBitmapView_renderVisu
     /* start fps timing */
     fps_startFrame(&_v.fps);
 
-    /* run libvisual pipeline */
-    visual_bin_run(b);
-
-        
     /* lock bitmap for drawing */
     int ret;
     void *pixels;
     if ((ret = AndroidBitmap_lockPixels(env, bitmap, &pixels)) < 0) 
     {
         LOGE("AndroidBitmap_lockPixels() failed ! error=%d", ret);
+        return;
     }
 
     /* set buffer to pixels */
     visual_video_set_buffer(bvideo, pixels);
-    
-    /* depth transform */
-    visual_video_convert_depth(bvideo, b->actvideo);
+
+    if(visual_bin_is_pipelined(b))
+    {
+        /* pick up the newest frame the render thread finished */
+        VisVideo *frame;
+        if((frame = visual_bin_pipeline_acquire_frame(b)))
+        {
+            /* depth transform */
+            visual_video_convert_depth(bvideo, frame);
+            
+            /* hand frame back to the render thread */
+            visual_bin_pipeline_release_frame(b, frame);
+        }
+        else
+        {
+            LOGE("visual_bin_pipeline_acquire_frame() failed");
+        }
+    }
+    else
+    {
+        /* run libvisual pipeline, rendering straight into the
+           bitmap when it matches the actor video, else converting */
+        visual_bin_run_to_video(b, bvideo);
+    }
 
         
     /* unlock bitmap */
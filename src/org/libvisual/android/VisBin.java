@@ -44,6 +44,8 @@ public class VisBin
     private native int binSwitchActorByName(int binPtr, String name);
     private native int binGetMorph(int binPtr);
     private native int binGetActor(int binPtr);
+    private native int binPipelineStart(int binPtr, int latency);
+    private native void binPipelineStop(int binPtr);
         
     public int VisBin;
 
@@ -113,6 +115,17 @@ public class VisBin
     {
         return new VisActor(binGetActor(VisBin));
     }
+
+    /** render on background threads, stop before switching actors */
+    public boolean pipelineStart(int latency)
+    {
+        return (binPipelineStart(VisBin, latency) == 0);
+    }
+
+    public void pipelineStop()
+    {
+        binPipelineStop(VisBin);
+    }
         
     @Override
     public void finalize()